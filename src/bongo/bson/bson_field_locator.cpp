@@ -0,0 +1,111 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/bson/bson_field_locator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "bongo/bson/bsonobj.h"
+#include "bongo/platform/bits.h"
+
+#if defined(_M_AMD64) || defined(__amd64__)
+#include <emmintrin.h>
+#define BONGO_HAVE_SSE2_FIELD_LOCATOR
+#endif
+
+namespace bongo {
+
+BSONFieldLocator::BSONFieldLocator(StringData fieldName) : _fieldName(fieldName) {
+    std::memset(_pattern, 0, sizeof(_pattern));
+    const size_t numNameBytes = std::min(_fieldName.size(), kVectorSize);
+    if (numNameBytes) {
+        std::memcpy(_pattern, _fieldName.rawData(), numNameBytes);
+    }
+
+    const size_t numMatchedBytes = std::min(_fieldName.size() + 1, kVectorSize);
+    _patternMask = (uint32_t(1) << numMatchedBytes) - 1;
+}
+
+BSONElement BSONFieldLocator::find(const BSONObj& obj) const {
+    const int objSize = obj.objsize();
+    if (objSize == 0) {
+        return BSONElement();
+    }
+
+    const char* pos = obj.objdata() + 4;
+    const char* const end = obj.objdata() + objSize;
+    const size_t nameSize = _fieldName.size();
+
+    // The last byte of the object is the EOO that terminates it.
+    while (pos < end - 1 && *pos != EOO) {
+        const char* const fieldName = pos + 1;
+        size_t fieldNameSize;
+        bool matches;
+
+#if defined(BONGO_HAVE_SSE2_FIELD_LOCATOR)
+        if (end - fieldName >= static_cast<std::ptrdiff_t>(kVectorSize)) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fieldName));
+            const __m128i pattern = _mm_load_si128(reinterpret_cast<const __m128i*>(_pattern));
+            const uint32_t nulMask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()));
+            const uint32_t equalMask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern));
+            const bool patternMatches = (equalMask & _patternMask) == _patternMask;
+
+            if (nulMask) {
+                fieldNameSize = countTrailingZeros64(nulMask);
+                matches = patternMatches && fieldNameSize == nameSize;
+            } else {
+                // The field name is longer than the vector, so compare the rest of it, if the
+                // sought name is that long too.
+                fieldNameSize = kVectorSize + std::strlen(fieldName + kVectorSize);
+                matches = patternMatches && fieldNameSize == nameSize &&
+                    std::memcmp(fieldName + kVectorSize,
+                                _fieldName.rawData() + kVectorSize,
+                                nameSize - kVectorSize) == 0;
+            }
+        } else
+#endif
+        {
+            fieldNameSize = std::strlen(fieldName);
+            matches = fieldNameSize == nameSize &&
+                (nameSize == 0 || std::memcmp(fieldName, _fieldName.rawData(), nameSize) == 0);
+        }
+
+        const BSONElement element(pos, fieldNameSize + 1, BSONElement::FieldNameSizeTag());
+        if (matches) {
+            return element;
+        }
+        pos += element.size();
+    }
+
+    return BSONElement();
+}
+
+}  // namespace bongo
@@ -0,0 +1,80 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "bongo/base/string_data.h"
+#include "bongo/bson/bsonelement.h"
+
+namespace bongo {
+
+class BSONObj;
+
+/**
+ * Finds a top-level field of BSON objects by name, with the same result as BSONObj::getField().
+ *
+ * The walk over the object's elements compares each field name with the sought one and finds its
+ * terminating NUL with one 16-byte vector comparison, rather than byte by byte. This uses SSE2 on
+ * x86-64; other platforms, and field names too close to the end of the object for a 16-byte load,
+ * take an equivalent scalar path.
+ *
+ * Building a locator prepares the comparison, so callers that look up the same field in many
+ * objects, like the paths of a query, should keep one around.
+ */
+class BSONFieldLocator {
+public:
+    /**
+     * 'fieldName' must outlive the locator.
+     */
+    explicit BSONFieldLocator(StringData fieldName);
+
+    /**
+     * Returns the first top-level element of 'obj' named by this locator, or EOO if there is none.
+     */
+    BSONElement find(const BSONObj& obj) const;
+
+    StringData fieldName() const {
+        return _fieldName;
+    }
+
+private:
+    static const size_t kVectorSize = 16;
+
+    StringData _fieldName;
+
+    // The first bytes of the field name, followed by its NUL terminator if that fits.
+    alignas(16) char _pattern[kVectorSize];
+
+    // The bits of the comparison with '_pattern' that must all be set for a field name to match,
+    // which cover the field name and its terminator, or all of the pattern.
+    uint32_t _patternMask;
+};
+
+}  // namespace bongo
@@ -0,0 +1,113 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kDefault
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/bson/bson_field_locator.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bongo/db/jsobj.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/log.h"
+#include "bongo/util/timer.h"
+
+namespace {
+
+using namespace bongo;
+
+const int kNumFields = 256;
+const int kNumLookups = 200000;
+
+BSONObj makeWideDocument(const std::string& fieldNamePrefix) {
+    BSONObjBuilder bob;
+    for (int i = 0; i < kNumFields; ++i) {
+        bob.append(fieldNamePrefix + std::to_string(i), i);
+    }
+    return bob.obj();
+}
+
+BSONElement findByIteration(const BSONObj& obj, StringData name) {
+    BSONObjIterator it(obj);
+    while (it.more()) {
+        BSONElement e = it.next();
+        if (name == e.fieldNameStringData()) {
+            return e;
+        }
+    }
+    return BSONElement();
+}
+
+void logResult(const std::string& testName, long long micros) {
+    log() << "THROUGHPUT " << testName << ": "
+          << static_cast<long long>(kNumLookups) * 1000000 / std::max(micros, 1LL)
+          << " lookups/sec";
+}
+
+/**
+ * Looks up fields spread across a wide document, first by iterating over its elements and
+ * comparing each field name, then with one BSONFieldLocator per field.
+ */
+void runLookups(const std::string& testName, const std::string& fieldNamePrefix) {
+    const BSONObj doc = makeWideDocument(fieldNamePrefix);
+    const std::vector<std::string> names = {fieldNamePrefix + "10",
+                                            fieldNamePrefix + "128",
+                                            fieldNamePrefix + "250",
+                                            fieldNamePrefix + "missing"};
+    std::vector<BSONFieldLocator> locators(names.begin(), names.end());
+
+    long long iterationSum = 0;
+    Timer iterationTimer;
+    for (int i = 0; i < kNumLookups; ++i) {
+        iterationSum += findByIteration(doc, names[i % names.size()]).numberInt();
+    }
+    logResult(testName + " iteration", iterationTimer.micros());
+
+    long long locatorSum = 0;
+    Timer locatorTimer;
+    for (int i = 0; i < kNumLookups; ++i) {
+        locatorSum += locators[i % locators.size()].find(doc).numberInt();
+    }
+    logResult(testName + " locator", locatorTimer.micros());
+
+    ASSERT_EQ(iterationSum, locatorSum);
+}
+
+TEST(BSONFieldLocatorPerf, ShortFieldNames) {
+    runLookups("ShortFieldNames", "f");
+}
+
+TEST(BSONFieldLocatorPerf, LongFieldNames) {
+    runLookups("LongFieldNames", "someRatherLongFieldName_");
+}
+
+}  // namespace
@@ -0,0 +1,168 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/bson/bson_field_locator.h"
+
+#include <string>
+#include <vector>
+
+#include "bongo/db/jsobj.h"
+#include "bongo/unittest/unittest.h"
+
+namespace {
+
+using namespace bongo;
+
+/**
+ * Finds 'name' in 'obj' one element at a time, as BSONObj::getField() used to.
+ */
+BSONElement findByIteration(const BSONObj& obj, StringData name) {
+    BSONObjIterator it(obj);
+    while (it.more()) {
+        BSONElement e = it.next();
+        if (name == e.fieldNameStringData()) {
+            return e;
+        }
+    }
+    return BSONElement();
+}
+
+void assertFindsSameElement(const BSONObj& obj, StringData name) {
+    BSONElement expected = findByIteration(obj, name);
+    BSONElement actual = BSONFieldLocator(name).find(obj);
+    ASSERT_EQ(expected.eoo(), actual.eoo()) << name;
+    if (!expected.eoo()) {
+        ASSERT_EQ(expected.rawdata(), actual.rawdata()) << name;
+        ASSERT_EQ(expected.size(), actual.size()) << name;
+    }
+}
+
+std::vector<std::string> fieldNamesOfEveryLength(size_t maxLength) {
+    std::vector<std::string> names;
+    for (size_t length = 1; length <= maxLength; ++length) {
+        std::string name;
+        for (size_t i = 0; i < length; ++i) {
+            name.push_back('a' + (i % 26));
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+TEST(BSONFieldLocatorTest, FindsFieldsOfEveryLength) {
+    const auto names = fieldNamesOfEveryLength(40);
+    BSONObjBuilder bob;
+    for (size_t i = 0; i < names.size(); ++i) {
+        bob.append(names[i], static_cast<int>(i));
+    }
+    BSONObj obj = bob.obj();
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        BSONElement e = BSONFieldLocator(names[i]).find(obj);
+        ASSERT_FALSE(e.eoo()) << names[i];
+        ASSERT_EQ(static_cast<int>(i), e.numberInt());
+        assertFindsSameElement(obj, names[i]);
+    }
+}
+
+TEST(BSONFieldLocatorTest, DoesNotMatchPrefixesOrExtensions) {
+    BSONObj obj = BSON("abc" << 1 << "abcdefghijklmnopq" << 2 << "abcdefghijklmnop" << 3);
+    ASSERT_TRUE(BSONFieldLocator("ab").find(obj).eoo());
+    ASSERT_TRUE(BSONFieldLocator("abcd").find(obj).eoo());
+    ASSERT_TRUE(BSONFieldLocator("abcdefghijklmno").find(obj).eoo());
+    ASSERT_TRUE(BSONFieldLocator("abcdefghijklmnopqr").find(obj).eoo());
+    ASSERT_EQ(1, BSONFieldLocator("abc").find(obj).numberInt());
+    ASSERT_EQ(2, BSONFieldLocator("abcdefghijklmnopq").find(obj).numberInt());
+    ASSERT_EQ(3, BSONFieldLocator("abcdefghijklmnop").find(obj).numberInt());
+}
+
+TEST(BSONFieldLocatorTest, ReturnsFirstOfDuplicateFields) {
+    BSONObj obj = BSON("a" << 1 << "b" << 2 << "a" << 3);
+    ASSERT_EQ(1, BSONFieldLocator("a").find(obj).numberInt());
+}
+
+TEST(BSONFieldLocatorTest, FindsFieldsNearTheEndOfTheObject) {
+    // The last few elements leave fewer than 16 bytes between their names and the end of the
+    // object.
+    const auto names = fieldNamesOfEveryLength(20);
+    for (const auto& name : names) {
+        BSONObj obj = BSON("first" << 1 << name << true);
+        ASSERT_TRUE(BSONFieldLocator(name).find(obj).boolean()) << name;
+        assertFindsSameElement(obj, name);
+        assertFindsSameElement(obj, name + "x");
+        assertFindsSameElement(obj, "missing");
+    }
+}
+
+TEST(BSONFieldLocatorTest, FieldNameContainingValueBytes) {
+    // The name is found even though a string value earlier in the object holds the same bytes.
+    BSONObj obj = BSON("s"
+                       << "target"
+                       << "target"
+                       << 7);
+    ASSERT_EQ(7, BSONFieldLocator("target").find(obj).numberInt());
+}
+
+TEST(BSONFieldLocatorTest, EmptyFieldName) {
+    BSONObj obj = BSON("a" << 1 << "" << 2);
+    ASSERT_EQ(2, BSONFieldLocator("").find(obj).numberInt());
+    ASSERT_TRUE(BSONFieldLocator("").find(BSON("a" << 1)).eoo());
+}
+
+TEST(BSONFieldLocatorTest, EmptyObject) {
+    ASSERT_TRUE(BSONFieldLocator("a").find(BSONObj()).eoo());
+}
+
+TEST(BSONFieldLocatorTest, MatchesGetFieldOnVariedTypes) {
+    BSONObj obj = BSON("_id" << OID::gen() << "name"
+                             << "a string value"
+                             << "nested"
+                             << BSON("a" << 1)
+                             << "array"
+                             << BSON_ARRAY(1 << 2 << 3)
+                             << "aVeryLongFieldNameIndeed"
+                             << 3.5
+                             << "null"
+                             << BSONNULL);
+    for (auto&& name : {"_id",
+                        "name",
+                        "nested",
+                        "array",
+                        "aVeryLongFieldNameIndeed",
+                        "aVeryLongFieldNameIndee",
+                        "null",
+                        "a",
+                        "nul"}) {
+        assertFindsSameElement(obj, name);
+        ASSERT_EQ(obj.getField(name).rawdata(), findByIteration(obj, name).rawdata());
+    }
+}
+
+}  // namespace
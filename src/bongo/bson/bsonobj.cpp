@@ -32,6 +32,7 @@
 #include "bongo/db/jsobj.h"
 
 #include "bongo/base/data_range.h"
+#include "bongo/bson/bson_field_locator.h"
 #include "bongo/bson/bson_validate.h"
 #include "bongo/db/json.h"
 #include "bongo/util/allocator.h"
@@ -482,17 +483,7 @@ void BSONObj::getFields(unsigned n, const char** fieldNames, BSONElement* fields
 }
 
 BSONElement BSONObj::getField(StringData name) const {
-    BSONObjIterator i(*this);
-    while (i.more()) {
-        BSONElement e = i.next();
-        // We know that e has a cached field length since BSONObjIterator::next internally
-        // called BSONElement::size on the BSONElement that it returned, so it is more
-        // efficient to re-use that information by obtaining the field name as a
-        // StringData, which will be pre-populated with the cached length.
-        if (name == e.fieldNameStringData())
-            return e;
-    }
-    return BSONElement();
+    return BSONFieldLocator(name).find(*this);
 }
 
 int BSONObj::getIntField(StringData name) const {
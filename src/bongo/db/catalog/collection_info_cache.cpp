@@ -34,21 +34,49 @@
 
 #include "bongo/db/catalog/collection_info_cache.h"
 
+#include <algorithm>
+
+#include "bongo/bson/simple_bsonobj_comparator.h"
 #include "bongo/db/catalog/collection.h"
+#include "bongo/db/commands/server_status_metric.h"
 #include "bongo/db/concurrency/d_concurrency.h"
 #include "bongo/db/fts/fts_spec.h"
+#include "bongo/db/index/index_access_method.h"
 #include "bongo/db/index/index_descriptor.h"
 #include "bongo/db/index_legacy.h"
 #include "bongo/db/query/plan_cache.h"
 #include "bongo/db/query/planner_ixselect.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/service_context.h"
 #include "bongo/db/ttl_collection_cache.h"
 #include "bongo/util/clock_source.h"
 #include "bongo/util/debug_util.h"
 #include "bongo/util/log.h"
+#include "bongo/util/scopeguard.h"
 
 namespace bongo {
 
+namespace {
+
+ServerStatusMetricField<Counter64> displayPlanCacheHits("query.planCache.hits",
+                                                        &planCacheMetrics.hits);
+ServerStatusMetricField<Counter64> displayPlanCacheMisses("query.planCache.misses",
+                                                          &planCacheMetrics.misses);
+ServerStatusMetricField<Counter64> displayPlanCacheContended("query.planCache.contended",
+                                                             &planCacheMetrics.contended);
+ServerStatusMetricField<Counter64> displayPlanCacheEvictions("query.planCache.evictions",
+                                                             &planCacheMetrics.evictions);
+ServerStatusMetricField<Counter64> displayPlanCacheFeedbackBatches(
+    "query.planCache.feedbackBatches", &planCacheMetrics.feedbackBatches);
+ServerStatusMetricField<Counter64> displayPlanCacheReplansPerformed(
+    "query.planCache.replans.performed", &planCacheMetrics.replansPerformed);
+ServerStatusMetricField<Counter64> displayPlanCacheReplansAvoided(
+    "query.planCache.replans.avoided", &planCacheMetrics.replansAvoided);
+ServerStatusMetricField<Counter64> displayPlanCacheReplansDeferred(
+    "query.planCache.replans.deferred", &planCacheMetrics.replansDeferred);
+
+}  // namespace
+
 CollectionInfoCache::CollectionInfoCache(Collection* collection)
     : _collection(collection),
       _keysComputed(false),
@@ -229,6 +257,11 @@ void CollectionInfoCache::droppedIndex(OperationContext* txn, StringData indexNa
 void CollectionInfoCache::rebuildIndexData(OperationContext* txn) {
     clearQueryCache();
 
+    {
+        stdx::lock_guard<stdx::mutex> lk(_statisticsMutex);
+        _statistics.reset();
+    }
+
     _keysComputed = false;
     computeIndexKeys(txn);
     updatePlanCacheIndexEntries(txn);
@@ -237,4 +270,94 @@ void CollectionInfoCache::rebuildIndexData(OperationContext* txn) {
 CollectionIndexUsageMap CollectionInfoCache::getIndexUsageStats() const {
     return _indexUsageTracker.getUsageStats();
 }
+
+std::shared_ptr<const CollectionStatistics> CollectionInfoCache::getCollectionStatistics(
+    OperationContext* txn) {
+    // This requires "some" lock, and MODE_IS is an expression for that, for now.
+    dassert(txn->lockState()->isCollectionLockedForMode(_collection->ns().ns(), MODE_IS));
+
+    const long long numRecords = _collection->numRecords(txn);
+    const Date_t now = getGlobalServiceContext()->getFastClockSource()->now();
+    {
+        stdx::lock_guard<stdx::mutex> lk(_statisticsMutex);
+        if (_samplingStatistics || (_statistics && !_statistics->isStale(numRecords, now))) {
+            return _statistics;
+        }
+        _samplingStatistics = true;
+    }
+
+    std::shared_ptr<const CollectionStatistics> statistics;
+    ON_BLOCK_EXIT([&] {
+        stdx::lock_guard<stdx::mutex> lk(_statisticsMutex);
+        _samplingStatistics = false;
+        if (statistics) {
+            _statistics = statistics;
+        }
+    });
+    statistics = sampleCollectionStatistics(txn, numRecords, now);
+    return statistics;
+}
+
+std::shared_ptr<const CollectionStatistics> CollectionInfoCache::sampleCollectionStatistics(
+    OperationContext* txn, long long numRecords, Date_t now) {
+    const size_t sampleSize = std::max(1, internalQueryStatisticsSampleSize.load());
+
+    // Small collections are read whole, as a random cursor would return the same records often.
+    RecordStore* recordStore = _collection->getRecordStore();
+    std::unique_ptr<RecordCursor> cursor = numRecords <= static_cast<long long>(sampleSize)
+        ? recordStore->getCursor(txn)
+        : recordStore->getRandomCursor(txn);
+    if (!cursor) {
+        return nullptr;
+    }
+
+    struct SampledIndex {
+        const IndexDescriptor* descriptor;
+        const IndexCatalogEntry* entry;
+        std::vector<BSONObj> keys;
+    };
+    std::vector<SampledIndex> indexes;
+    IndexCatalog::IndexIterator ii = _collection->getIndexCatalog()->getIndexIterator(txn, false);
+    while (ii.more()) {
+        const IndexDescriptor* descriptor = ii.next();
+        // Only the keys of btree indexes are ordered by the values of the indexed fields.
+        if (descriptor->getAccessMethodName() == IndexNames::BTREE) {
+            indexes.push_back({descriptor, ii.catalogEntry(descriptor), {}});
+        }
+    }
+
+    size_t numSampled = 0;
+    while (numSampled < sampleSize) {
+        auto record = cursor->next();
+        if (!record) {
+            break;
+        }
+        ++numSampled;
+
+        const BSONObj doc = record->data.releaseToBson();
+        for (auto& index : indexes) {
+            const MatchExpression* filter = index.entry->getFilterExpression();
+            if (filter && !filter->matchesBSON(doc)) {
+                continue;
+            }
+            BSONObjSet keys = SimpleBSONObjComparator::kInstance.makeBSONObjSet();
+            index.entry->accessMethod()->getKeys(
+                doc, IndexAccessMethod::GetKeysMode::kRelaxConstraints, &keys, nullptr);
+            index.keys.insert(index.keys.end(), keys.begin(), keys.end());
+        }
+    }
+
+    auto statistics = std::make_shared<CollectionStatistics>(numRecords, numSampled, now);
+    for (auto& index : indexes) {
+        statistics->addIndex(index.descriptor->indexName(),
+                             index.descriptor->keyPattern().firstElementFieldName(),
+                             index.entry->getCollator() != nullptr,
+                             IndexStatistics::build(&index.keys, numSampled, numRecords));
+    }
+
+    LOG(1) << _collection->ns().ns() << ": gathered query planning statistics on "
+           << indexes.size() << " indexes from " << numSampled << " of " << numRecords
+           << " documents";
+    return statistics;
+}
 }
@@ -30,10 +30,14 @@
 
 #pragma once
 
+#include <memory>
+
 #include "bongo/db/collection_index_usage_tracker.h"
+#include "bongo/db/query/collection_statistics.h"
 #include "bongo/db/query/plan_cache.h"
 #include "bongo/db/query/query_settings.h"
 #include "bongo/db/update_index_data.h"
+#include "bongo/stdx/mutex.h"
 
 namespace bongo {
 
@@ -75,6 +79,13 @@ public:
      */
     CollectionIndexUsageMap getIndexUsageStats() const;
 
+    /**
+     * Returns statistics on the values in this collection's indexes, sampling the collection if
+     * none have been gathered yet or if they are stale. Returns nullptr if the collection cannot
+     * be sampled. While one query samples the collection, others get the previous statistics.
+     */
+    std::shared_ptr<const CollectionStatistics> getCollectionStatistics(OperationContext* txn);
+
     /**
      * Builds internal cache state based on the current state of the Collection's IndexCatalog
      */
@@ -124,8 +135,17 @@ private:
     // Tracks index usage statistics for this collection.
     CollectionIndexUsageTracker _indexUsageTracker;
 
+    // Statistics for cost-based plan selection. Queries share them under intent locks, so they are
+    // guarded by '_statisticsMutex'.
+    stdx::mutex _statisticsMutex;
+    std::shared_ptr<const CollectionStatistics> _statistics;
+    bool _samplingStatistics = false;
+
     void computeIndexKeys(OperationContext* txn);
     void updatePlanCacheIndexEntries(OperationContext* txn);
+    std::shared_ptr<const CollectionStatistics> sampleCollectionStatistics(OperationContext* txn,
+                                                                           long long numRecords,
+                                                                           Date_t now);
 
     /**
      * Rebuilds cached information that is dependent on index composition. Must be called
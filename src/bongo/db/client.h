@@ -132,6 +132,20 @@ public:
      */
     static void destroy();
 
+    /**
+     * Detaches the Client bound to the current thread and returns it. The current thread must
+     * have a Client.
+     *
+     * Together with setCurrent(), this allows the work of a single Client to migrate between
+     * threads, as happens when a ServiceExecutor runs requests on a shared pool of workers.
+     */
+    static ServiceContext::UniqueClient releaseCurrent();
+
+    /**
+     * Binds "client" to the current thread. The current thread must not already have a Client.
+     */
+    static void setCurrent(ServiceContext::UniqueClient client);
+
     std::string clientAddress(bool includePort = false) const;
     const std::string& desc() const {
         return _desc;
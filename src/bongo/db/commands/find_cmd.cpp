@@ -350,17 +350,24 @@ public:
         BSONObj obj;
         PlanExecutor::ExecState state = PlanExecutor::ADVANCED;
         long long numResults = 0;
-        while (!FindCommon::enoughForFirstBatch(originalQR, numResults) &&
-               PlanExecutor::ADVANCED == (state = exec->getNext(&obj, NULL))) {
-            // If we can't fit this result inside the current batch, then we stash it for later.
-            if (!FindCommon::haveSpaceForNext(obj, numResults, firstBatch.bytesUsed())) {
-                exec->enqueue(obj);
-                break;
-            }
+        {
+            // The reader hands unused results back to the executor when it goes out of scope.
+            BatchedResultReader reader(exec.get(),
+                                       originalQR.getEffectiveBatchSize().value_or(
+                                           QueryRequest::kDefaultBatchSize));
+            while (!FindCommon::enoughForFirstBatch(originalQR, numResults) &&
+                   PlanExecutor::ADVANCED == (state = reader.getNext(&obj))) {
+                // If we can't fit this result inside the current batch, then we stash it for
+                // later.
+                if (!FindCommon::haveSpaceForNext(obj, numResults, firstBatch.bytesUsed())) {
+                    reader.putBack();
+                    break;
+                }
 
-            // Add result to output buffer.
-            firstBatch.append(obj);
-            numResults++;
+                // Add result to output buffer.
+                firstBatch.append(obj);
+                numResults++;
+            }
         }
 
         // Throw an assertion if query execution fails for any reason.
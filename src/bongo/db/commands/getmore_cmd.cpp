@@ -518,12 +518,14 @@ public:
         // timeout to the user.
         BSONObj obj;
         try {
+            // The reader hands unused results back to the executor when it goes out of scope.
+            BatchedResultReader reader(exec, request.batchSize.value_or(0));
             while (!FindCommon::enoughForGetMore(request.batchSize.value_or(0), *numResults) &&
-                   PlanExecutor::ADVANCED == (*state = exec->getNext(&obj, NULL))) {
+                   PlanExecutor::ADVANCED == (*state = reader.getNext(&obj))) {
                 // If adding this object will cause us to exceed the message size limit, then we
                 // stash it for later.
                 if (!FindCommon::haveSpaceForNext(obj, *numResults, nextBatch->bytesUsed())) {
-                    exec->enqueue(obj);
+                    reader.putBack();
                     break;
                 }
 
@@ -433,6 +433,14 @@ Status PlanCacheListPlans::list(OperationContext* txn,
                 scoreBob.append("score", entry->feedback[i]->score);
             }
             scoresBob.doneFast();
+
+            // The distribution of trial period works over every cached run, including those
+            // whose feedback is no longer kept.
+            BSONObjBuilder trialWorksBob(feedbackBob.subobjStart("trialWorks"));
+            trialWorksBob.appendNumber("nruns", static_cast<long long>(entry->performance.numRuns));
+            trialWorksBob.append("mean", entry->performance.meanWorks);
+            trialWorksBob.append("stdDev", entry->performance.stdDev());
+            trialWorksBob.doneFast();
         }
         feedbackBob.doneFast();
 
@@ -48,6 +48,7 @@
 #include "bongo/db/stats/counters.h"
 #include "bongo/platform/process_id.h"
 #include "bongo/transport/message_compressor_registry.h"
+#include "bongo/transport/service_executor.h"
 #include "bongo/transport/transport_layer.h"
 #include "bongo/util/log.h"
 #include "bongo/util/net/hostname_canonicalization.h"
@@ -282,6 +283,10 @@ public:
         BSONObjBuilder b;
         networkCounter.append(b);
         appendMessageCompressionStats(&b);
+        if (auto executor = txn->getServiceContext()->getServiceExecutor()) {
+            BSONObjBuilder section(b.subobjStart("serviceExecutorTaskStats"));
+            executor->appendStats(&section);
+        }
         return b.obj();
     }
 
@@ -314,7 +314,8 @@ LockResult LockerImpl<IsForMMAPV1>::lockGlobalBegin(LockMode mode) {
         auto holder = ticketHolders[mode];
         if (holder) {
             _clientState.store(reader ? kQueuedReader : kQueuedWriter);
-            holder->waitForTicket();
+            holder->waitForTicket(_hasYieldedTicket ? TicketHolder::Priority::kLow
+                                                    : TicketHolder::Priority::kNormal);
         }
         _clientState.store(reader ? kActiveReader : kActiveWriter);
         _modeForTicket = mode;
@@ -394,6 +395,9 @@ bool LockerImpl<IsForMMAPV1>::unlockGlobal() {
         }
     }
 
+    // Done with the global lock, rather than yielding it, so whatever runs next on this locker
+    // starts out at normal priority again.
+    _hasYieldedTicket = false;
     return true;
 }
 
@@ -599,6 +603,7 @@ bool LockerImpl<IsForMMAPV1>::saveLockStateAndUnlock(Locker::LockSnapshot* state
     // The global lock must have been acquired just once
     stateOut->globalMode = globalRequest->mode;
     invariant(unlock(resourceIdGlobal));
+    _hasYieldedTicket = true;
 
     // Next, the non-global locks.
     for (LockRequestsMap::Iterator it = _requests.begin(); !it.finished(); it.next()) {
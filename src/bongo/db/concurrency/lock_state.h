@@ -222,6 +222,11 @@ private:
     // Mode for which the Locker acquired a ticket, or MODE_NONE if no ticket was acquired.
     LockMode _modeForTicket = MODE_NONE;
 
+    // Set once this locker has given up its ticket to yield, and cleared when it releases the
+    // global lock for good. An operation that yields is a long running one, so until then it
+    // waits for tickets at low priority, behind short operations.
+    bool _hasYieldedTicket = false;
+
     // Indicates whether the client is active reader/writer or is queued.
     AtomicWord<ClientState> _clientState{kInactive};
 
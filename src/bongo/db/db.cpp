@@ -120,7 +120,7 @@
 #include "bongo/stdx/future.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/stdx/thread.h"
-#include "bongo/transport/transport_layer_legacy.h"
+#include "bongo/transport/transport_layer_factory.h"
 #include "bongo/util/assert_util.h"
 #include "bongo/util/cmdline_utils/censor_cmdline.h"
 #include "bongo/util/concurrency/task.h"
@@ -473,23 +473,21 @@ ExitCode _initAndListen(int listenPort) {
 
     checked_cast<ServiceContextBongoD*>(getGlobalServiceContext())->createLockFile();
 
-    transport::TransportLayerLegacy::Options options;
-    options.port = listenPort;
-    options.ipList = serverGlobalParams.bind_ip;
-
     auto sep =
         stdx::make_unique<ServiceEntryPointBongod>(getGlobalServiceContext()->getTransportLayer());
     auto sepPtr = sep.get();
 
     getGlobalServiceContext()->setServiceEntryPoint(std::move(sep));
+    getGlobalServiceContext()->setServiceExecutor(transport::makeServiceExecutor());
 
     // Create, start, and attach the TL
-    auto transportLayer = stdx::make_unique<transport::TransportLayerLegacy>(options, sepPtr);
-    auto res = transportLayer->setup();
-    if (!res.isOK()) {
-        error() << "Failed to set up listener: " << res;
+    auto swTransportLayer =
+        transport::makeAndSetupTransportLayer(serverGlobalParams.bind_ip, listenPort, sepPtr);
+    if (!swTransportLayer.isOK()) {
+        error() << "Failed to set up listener: " << swTransportLayer.getStatus();
         return EXIT_NET_ERROR;
     }
+    auto transportLayer = std::move(swTransportLayer.getValue());
 
     std::shared_ptr<DbWebServer> dbWebServer;
     if (serverGlobalParams.isHttpInterfaceEnabled) {
@@ -718,6 +716,14 @@ ExitCode _initAndListen(int listenPort) {
     // operation context anymore
     startupOpCtx.reset();
 
+    if (auto svcExec = getGlobalServiceContext()->getServiceExecutor()) {
+        auto status = svcExec->start();
+        if (!status.isOK()) {
+            error() << "Failed to start the service executor: " << status;
+            return EXIT_NET_ERROR;
+        }
+    }
+
     auto start = getGlobalServiceContext()->addAndStartTransportLayer(std::move(transportLayer));
     if (!start.isOK()) {
         error() << "Failed to start the listener: " << start.toString();
@@ -961,6 +967,15 @@ static void shutdownTask() {
     if (serviceContext)
         serviceContext->setKillAllOperations();
 
+    // Stop handing requests to the service executor, and give in-flight ones (which have just
+    // been interrupted) a chance to finish.
+    if (serviceContext && serviceContext->getServiceExecutor()) {
+        auto status = serviceContext->getServiceExecutor()->shutdown();
+        if (!status.isOK()) {
+            log(LogComponent::kNetwork) << "shutdown: " << status;
+        }
+    }
+
     ReplicaSetMonitor::shutdown();
     if (auto sr = grid.shardRegistry()) {  // TODO: race: sr is a naked pointer
         sr->shutdown();
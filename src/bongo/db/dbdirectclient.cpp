@@ -128,6 +128,8 @@ bool DBDirectClient::call(Message& toSend, Message& response, bool assertOk, str
     assembleResponse(_txn, toSend, dbResponse, kHostAndPortForDirectClient);
     verify(!dbResponse.response.empty());
     response = std::move(dbResponse.response);
+    // The reply is parsed in place, so it cannot keep any out-of-line segments.
+    response.flatten();
 
     return true;
 }
@@ -173,10 +173,40 @@ T DbMessage::readAndAdvance() {
     return t;
 }
 
-OpQueryReplyBuilder::OpQueryReplyBuilder() : _buffer(32768) {
+OpQueryReplyBuilder::OpQueryReplyBuilder() : OpQueryReplyBuilder(32768) {}
+
+OpQueryReplyBuilder::OpQueryReplyBuilder(int initialBufferSize) : _buffer(initialBufferSize) {
     _buffer.skip(sizeof(QueryResult::Value));
 }
 
+void OpQueryReplyBuilder::appendResult(const BSONObj& obj) {
+    const char* data = obj.objdata();
+    const int size = obj.objsize();
+    const char* const previousEnd = _lastResultEnd;
+    _lastResultEnd = data + size;
+
+    if (obj.isOwned()) {
+        if (!_outOfLine.empty()) {
+            auto& last = _outOfLine.back();
+            if (last.offset == _buffer.len() && last.data + last.len == data) {
+                last.len += size;
+                _outOfLineBytes += size;
+                return;
+            }
+        }
+
+        // Objects at adjacent addresses can only come from the same allocation, so a result that
+        // starts where the previous one ended is the second of a run worth splicing.
+        if (size >= Message::kMinOutOfLineSegmentBytes || data == previousEnd) {
+            _outOfLine.push_back({_buffer.len(), obj, data, size});
+            _outOfLineBytes += size;
+            return;
+        }
+    }
+
+    obj.appendSelfToBufBuilder(_buffer);
+}
+
 void OpQueryReplyBuilder::send(const transport::SessionHandle& session,
                                int queryResultFlags,
                                const Message& requestMsg,
@@ -201,11 +231,16 @@ void OpQueryReplyBuilder::putInMessage(
     Message* out, int queryResultFlags, int nReturned, int startingFrom, long long cursorId) {
     QueryResult::View qr = _buffer.buf();
     qr.setResultFlags(queryResultFlags);
-    qr.msgdata().setLen(_buffer.len());
+    qr.msgdata().setLen(_buffer.len() + _outOfLineBytes);
     qr.msgdata().setOperation(opReply);
     qr.setCursorId(cursorId);
     qr.setStartingFrom(startingFrom);
     qr.setNReturned(nReturned);
+    for (auto&& range : _outOfLine) {
+        out->addSegment(range.offset, range.owner.sharedBuffer(), range.data, range.len);
+    }
+    _outOfLine.clear();
+    _outOfLineBytes = 0;
     out->setData(_buffer.release());  // transport will free
 }
 
@@ -30,6 +30,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "bongo/base/static_assert.h"
 #include "bongo/bson/bson_validate.h"
 #include "bongo/client/constants.h"
@@ -337,6 +339,12 @@ class OpQueryReplyBuilder {
 public:
     OpQueryReplyBuilder();
 
+    /**
+     * Reserves 'initialBufferSize' bytes for the reply up front, for callers that know it is
+     * going to be large and would otherwise pay for the buffer being grown and copied.
+     */
+    explicit OpQueryReplyBuilder(int initialBufferSize);
+
     /**
      * Returns the BufBuilder that should be used for placing result objects. It will be positioned
      * where the first (or next) object should go.
@@ -348,6 +356,22 @@ public:
         return _buffer;
     }
 
+    /**
+     * Appends 'obj' as the next result object. Owned objects are spliced into the reply without
+     * copying when they are large, or when they directly follow the previous result in the memory
+     * of the same buffer (as the documents of a batch received from a shard do), so that the reply
+     * can be sent with a gather write. Other objects are copied into bufBuilderForResults().
+     */
+    void appendResult(const BSONObj& obj);
+
+    /**
+     * Returns the size of the reply so far, including the header and results that were spliced
+     * in rather than copied.
+     */
+    int bytesUsed() const {
+        return _buffer.len() + _outOfLineBytes;
+    }
+
     /**
      * Finishes the reply and transfers the message buffer into 'out'.
      */
@@ -373,7 +397,19 @@ public:
     void sendCommandReply(const transport::SessionHandle& session, const Message& requestMsg);
 
 private:
+    // A range of memory spliced into the reply after the first 'offset' bytes of _buffer. 'owner'
+    // keeps it alive.
+    struct OutOfLineRange {
+        int offset;
+        BSONObj owner;
+        const char* data;
+        int len;
+    };
+
     BufBuilder _buffer;
+    std::vector<OutOfLineRange> _outOfLine;
+    int _outOfLineBytes = 0;
+    const char* _lastResultEnd = nullptr;
 };
 
 void replyToQuery(int queryResultFlags,
@@ -333,6 +333,7 @@ public:
         Command::execCommand(txn, c, cmdRequest, &cmdReplyBuilder);
 
         auto cmdReplyMsg = cmdReplyBuilder.done();
+        cmdReplyMsg.flatten();
         rpc::CommandReply cmdReply{&cmdReplyMsg};
 
         responseCode = 200;
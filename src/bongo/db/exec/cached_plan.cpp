@@ -32,6 +32,8 @@
 
 #include "bongo/db/exec/cached_plan.h"
 
+#include <algorithm>
+
 #include "bongo/db/catalog/collection.h"
 #include "bongo/db/concurrency/write_conflict_exception.h"
 #include "bongo/db/exec/multi_plan.h"
@@ -81,10 +83,17 @@ Status CachedPlanStage::pickBestPlan(PlanYieldPolicy* yieldPolicy) {
     size_t maxWorksBeforeReplan =
         static_cast<size_t>(internalQueryCacheEvictionRatio * _decisionWorks);
 
+    // If earlier runs of the cached plan often took longer than that, the trial period is
+    // extended up to what would be significantly slow for it. Only runs which finished their
+    // trial period are recorded, so this is based on how long runs actually took.
+    PlanCache* cache = _collection->infoCache()->getPlanCache();
+    const size_t maxTrialWorks =
+        std::max(maxWorksBeforeReplan, cache->getSignificantTrialWorks(*_canonicalQuery));
+
     // The trial period ends without replanning if the cached plan produces this many results.
     size_t numResults = MultiPlanStage::getTrialPeriodNumToReturn(*_canonicalQuery);
 
-    for (size_t i = 0; i < maxWorksBeforeReplan; ++i) {
+    for (size_t i = 0; i < maxTrialWorks; ++i) {
         // Might need to yield between calls to work due to the timer elapsing.
         Status yieldStatus = tryYield(yieldPolicy);
         if (!yieldStatus.isOK()) {
@@ -104,13 +113,13 @@ Status CachedPlanStage::pickBestPlan(PlanYieldPolicy* yieldPolicy) {
             if (_results.size() >= numResults) {
                 // Once a plan returns enough results, stop working. Update cache with stats
                 // from this run and return.
-                updatePlanCache();
+                updatePlanCache(i >= maxWorksBeforeReplan);
                 return Status::OK();
             }
         } else if (PlanStage::IS_EOF == state) {
             // Cached plan hit EOF quickly enough. No need to replan. Update cache with stats
             // from this run and return.
-            updatePlanCache();
+            updatePlanCache(i >= maxWorksBeforeReplan);
             return Status::OK();
         } else if (PlanStage::NEED_YIELD == state) {
             if (id == WorkingSet::INVALID_ID) {
@@ -160,9 +169,30 @@ Status CachedPlanStage::pickBestPlan(PlanYieldPolicy* yieldPolicy) {
         }
     }
 
-    // If we're here, the trial period took more than 'maxWorksBeforeReplan' work cycles. This
-    // plan is taking too long, so we replan from scratch.
-    LOG(1) << "Execution of cached plan required " << maxWorksBeforeReplan
+    // If we're here, the trial period took more than 'maxTrialWorks' work cycles. Unless another
+    // query of this shape replanned recently, we replan from scratch.
+    if (cache->shouldReplan(*_canonicalQuery, getClock()->now()) ==
+        PlanCache::ReplanDecision::kRateLimited) {
+        planCacheMetrics.replansAvoided.increment();
+        LOG(1) << "Execution of cached plan required " << maxTrialWorks
+               << " works, but was originally cached with only " << _decisionWorks
+               << " works. Not replanning, as the query shape was replanned recently: "
+               << redact(_canonicalQuery->toStringShort());
+        return Status::OK();
+    }
+
+    if (internalQueryCacheBackgroundReplan.load()) {
+        // Leave replanning to the next query of this shape and keep running the cached plan.
+        planCacheMetrics.replansDeferred.increment();
+        cache->remove(*_canonicalQuery);
+        LOG(1) << "Execution of cached plan required " << maxTrialWorks
+               << " works, but was originally cached with only " << _decisionWorks
+               << " works. Evicting cache entry without replanning query: "
+               << redact(_canonicalQuery->toStringShort());
+        return Status::OK();
+    }
+
+    LOG(1) << "Execution of cached plan required " << maxTrialWorks
            << " works, but was originally cached with only " << _decisionWorks
            << " works. Evicting cache entry and replanning query: "
            << redact(_canonicalQuery->toStringShort())
@@ -202,6 +232,7 @@ Status CachedPlanStage::replan(PlanYieldPolicy* yieldPolicy, bool shouldCache) {
     _children.clear();
 
     _specificStats.replanned = true;
+    planCacheMetrics.replansPerformed.increment();
 
     // Use the query planning module to plan the whole query.
     std::vector<QuerySolution*> rawSolutions;
@@ -325,10 +356,21 @@ const SpecificStats* CachedPlanStage::getSpecificStats() const {
     return &_specificStats;
 }
 
-void CachedPlanStage::updatePlanCache() {
+void CachedPlanStage::updatePlanCache(bool exceededWorksBudget) {
+    if (exceededWorksBudget) {
+        // The trial period was extended because earlier runs took as long, so the cached plan
+        // was kept where it used to be replanned.
+        planCacheMetrics.replansAvoided.increment();
+        LOG(1) << "Execution of cached plan required more than the "
+               << static_cast<size_t>(internalQueryCacheEvictionRatio * _decisionWorks)
+               << " works it was budgeted, but no more than earlier runs. Not replanning query: "
+               << redact(_canonicalQuery->toStringShort());
+    }
+
     std::unique_ptr<PlanCacheEntryFeedback> feedback = stdx::make_unique<PlanCacheEntryFeedback>();
     feedback->stats = getStats();
     feedback->score = PlanRanker::scoreTree(feedback->stats->children[0].get());
+    feedback->trialWorks = feedback->stats->children[0]->common.works;
 
     PlanCache* cache = _collection->infoCache()->getPlanCache();
     Status fbs = cache->feedback(*_canonicalQuery, feedback.release());
@@ -82,19 +82,22 @@ public:
      * 'yieldPolicy'.
      *
      * Feedback from the trial period is passed to the plan cache. If the performance is lower
-     * than expected, the old plan is evicted and a new plan is selected from scratch (again
-     * yielding according to 'yieldPolicy'). Otherwise, the cached plan is run.
+     * than expected, and than earlier runs of the cached plan, the old plan is evicted and a new
+     * plan is selected from scratch (again yielding according to 'yieldPolicy'), or, with
+     * internalQueryCacheBackgroundReplan, left for the next query of this shape to select.
+     * Otherwise, the cached plan is run.
      */
     Status pickBestPlan(PlanYieldPolicy* yieldPolicy);
 
 private:
     /**
      * Passes stats from the trial period run of the cached plan to the plan cache.
+     * 'exceededWorksBudget' says whether the trial period had to be extended past its budget.
      *
      * If the plan cache entry is deleted before we get a chance to update it, then this
      * is a no-op.
      */
-    void updatePlanCache();
+    void updatePlanCache(bool exceededWorksBudget);
 
     /**
      * Uses the QueryPlanner and the MultiPlanStage to re-generate candidate plans for this
@@ -61,11 +61,16 @@ CollectionScan::CollectionScan(OperationContext* txn,
     : PlanStage(kStageType, txn),
       _workingSet(workingSet),
       _filter(filter),
+      _compiledFilter(filter ? make_unique<CompiledMatchExpression>(filter) : nullptr),
       _params(params),
       _isDead(false),
       _wsidForFetch(_workingSet->allocate()) {
     // Explain reports the direction of the collection scan.
     _specificStats.direction = params.direction;
+
+    // Only forward scans are bounded.
+    invariant(params.direction == CollectionScanParams::FORWARD ||
+              (params.end.isNull() && !params.skipToStart));
 }
 
 PlanStage::StageState CollectionScan::doWork(WorkingSetID* out) {
@@ -132,8 +137,21 @@ PlanStage::StageState CollectionScan::doWork(WorkingSetID* out) {
             return PlanStage::NEED_TIME;
         }
 
-        if (_lastSeenId.isNull() && !_params.start.isNull()) {
+        if (_skippingToStart) {
+            // Only one record is skipped per call, so that skipping can yield like any other work.
+            record = _cursor->next();
+            if (record && record->id < _params.start) {
+                return PlanStage::NEED_TIME;
+            }
+            _skippingToStart = false;
+        } else if (_lastSeenId.isNull() && !_params.start.isNull()) {
             record = _cursor->seekExact(_params.start);
+            if (!record && _params.skipToStart) {
+                // 'start' has been deleted, so find the first record after it from the beginning.
+                _cursor = _params.collection->getCursor(getOpCtx());
+                _skippingToStart = true;
+                return PlanStage::NEED_TIME;
+            }
         } else {
             // See if the record we're about to access is in memory. If not, pass a fetch
             // request up.
@@ -155,6 +173,10 @@ PlanStage::StageState CollectionScan::doWork(WorkingSetID* out) {
         return PlanStage::NEED_YIELD;
     }
 
+    if (record && !_params.end.isNull() && record->id >= _params.end) {
+        record = boost::none;
+    }
+
     if (!record) {
         // We just hit EOF. If we are tailable and have already returned data, leave us in a
         // state to pick up where we left off on the next call to work(). Otherwise EOF is
@@ -179,14 +201,85 @@ PlanStage::StageState CollectionScan::doWork(WorkingSetID* out) {
     return returnIfMatches(member, id, out);
 }
 
+PlanStage::StageState CollectionScan::doWorkBatch(size_t maxResults,
+                                                  std::vector<WorkingSetID>* out,
+                                                  WorkingSetID* id) {
+    // Creating and positioning the cursor, as well as tailable and bounded scans, take the path of
+    // a single call to work().
+    if (maxResults == 1 || !_cursor || _isDead || _commonStats.isEOF || _params.tailable ||
+        0 != _params.maxScan || (_lastSeenId.isNull() && !_params.start.isNull())) {
+        return PlanStage::doWorkBatch(maxResults, out, id);
+    }
+
+    const SnapshotId snapshotId = getOpCtx()->recoveryUnit()->getSnapshotId();
+    WorkingSetBatchObjCopier copier(_workingSet);
+    const size_t numBefore = out->size();
+    size_t numExamined = 0;
+
+    // Examining at most 'maxResults' records keeps a selective filter from holding on to the
+    // caller for longer than that many calls to work() would.
+    while (numExamined < maxResults) {
+        boost::optional<Record> record;
+        try {
+            // Anything that needs a yield ends the batch, and is then handled by doWork().
+            if (_cursor->fetcherForNext()) {
+                break;
+            }
+            record = _cursor->next();
+        } catch (const WriteConflictException& wce) {
+            break;
+        }
+
+        if (!record || (!_params.end.isNull() && record->id >= _params.end)) {
+            _commonStats.isEOF = true;
+            break;
+        }
+
+        ++numExamined;
+        _lastSeenId = record->id;
+
+        WorkingSetID memberId = _workingSet->allocate();
+        WorkingSetMember* member = _workingSet->get(memberId);
+        member->recordId = record->id;
+        member->obj = {snapshotId, record->data.releaseToBson()};
+        _workingSet->transitionToRecordIdAndObj(memberId);
+
+        WorkingSetID resultId;
+        if (PlanStage::ADVANCED == returnIfMatches(member, memberId, &resultId)) {
+            // The cursor only keeps the current record valid, so copy the result before moving on.
+            copier.add(resultId);
+            out->push_back(resultId);
+        }
+    }
+    copier.done();
+
+    const size_t numRejected = numExamined - (out->size() - numBefore);
+    if (out->size() > numBefore) {
+        _commonStats.works += numRejected;
+        _commonStats.needTime += numRejected;
+        return PlanStage::ADVANCED;
+    }
+
+    if (numExamined == 0) {
+        return doWork(id);
+    }
+
+    // Every record examined was filtered out. The last of them is accounted for by our caller.
+    _commonStats.works += numRejected - 1;
+    _commonStats.needTime += numRejected - 1;
+    *id = WorkingSet::INVALID_ID;
+    return PlanStage::NEED_TIME;
+}
+
 PlanStage::StageState CollectionScan::returnIfMatches(WorkingSetMember* member,
                                                       WorkingSetID memberID,
                                                       WorkingSetID* out) {
     ++_specificStats.docsTested;
 
-    if (Filter::passes(member, _filter)) {
+    if (Filter::passes(member, _compiledFilter.get())) {
         if (_params.stopApplyingFilterAfterFirstMatch) {
             _filter = nullptr;
+            _compiledFilter.reset();
         }
         *out = memberID;
         return PlanStage::ADVANCED;
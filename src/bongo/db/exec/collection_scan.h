@@ -32,6 +32,7 @@
 
 #include "bongo/db/exec/collection_scan_common.h"
 #include "bongo/db/exec/plan_stage.h"
+#include "bongo/db/matcher/compiled_match_expression.h"
 #include "bongo/db/matcher/expression.h"
 #include "bongo/db/record_id.h"
 
@@ -55,6 +56,9 @@ public:
                    const MatchExpression* filter);
 
     StageState doWork(WorkingSetID* out) final;
+    StageState doWorkBatch(size_t maxResults,
+                           std::vector<WorkingSetID>* out,
+                           WorkingSetID* id) final;
     bool isEOF() final;
 
     void doInvalidate(OperationContext* txn, const RecordId& dl, InvalidationType type) final;
@@ -86,6 +90,9 @@ private:
     // The filter is not owned by us.
     const MatchExpression* _filter;
 
+    // '_filter' compiled for matching documents, or null if there is no filter.
+    std::unique_ptr<CompiledMatchExpression> _compiledFilter;
+
     std::unique_ptr<SeekableRecordCursor> _cursor;
 
     CollectionScanParams _params;
@@ -94,6 +101,10 @@ private:
 
     RecordId _lastSeenId;  // Null if nothing has been returned from _cursor yet.
 
+    // Set while reading from the beginning of the collection to the first record after a deleted
+    // '_params.start'.
+    bool _skippingToStart = false;
+
     // We allocate a working set member with this id on construction of the stage. It gets used for
     // all fetch requests. This should only be used for passing up the Fetcher for a NEED_YIELD, and
     // should remain in the INVALID state.
@@ -48,6 +48,14 @@ struct CollectionScanParams {
     // not being invalidated before the first call to work(...).
     RecordId start;
 
+    // If not null, a forward scan ends before the first record at or after 'end'.
+    RecordId end;
+
+    // If set, a forward scan does not end when 'start' has been deleted before the first call to
+    // work(...). It reads from the beginning of the collection instead, skipping the records that
+    // come before 'start' one call to work(...) at a time.
+    bool skipToStart = false;
+
     Direction direction = FORWARD;
 
     // Do we want the scan to be 'tailable'?  Only meaningful if the collection is capped.
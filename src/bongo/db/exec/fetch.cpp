@@ -58,6 +58,7 @@ FetchStage::FetchStage(OperationContext* txn,
       _collection(collection),
       _ws(ws),
       _filter(filter),
+      _compiledFilter(filter ? make_unique<CompiledMatchExpression>(filter) : nullptr),
       _idRetrying(WorkingSet::INVALID_ID) {
     _children.emplace_back(child);
 }
@@ -71,6 +72,10 @@ bool FetchStage::isEOF() {
         return false;
     }
 
+    if (!_pendingIds.empty()) {
+        return false;
+    }
+
     return child()->isEOF();
 }
 
@@ -82,7 +87,11 @@ PlanStage::StageState FetchStage::doWork(WorkingSetID* out) {
     // Either retry the last WSM we worked on or get a new one from our child.
     WorkingSetID id;
     StageState status;
-    if (_idRetrying == WorkingSet::INVALID_ID) {
+    if (_idRetrying == WorkingSet::INVALID_ID && !_pendingIds.empty()) {
+        status = ADVANCED;
+        id = _pendingIds.front();
+        _pendingIds.pop_front();
+    } else if (_idRetrying == WorkingSet::INVALID_ID) {
         status = child()->work(&id);
     } else {
         status = ADVANCED;
@@ -150,9 +159,111 @@ PlanStage::StageState FetchStage::doWork(WorkingSetID* out) {
     return status;
 }
 
+PlanStage::StageState FetchStage::doWorkBatch(size_t maxResults,
+                                              std::vector<WorkingSetID>* out,
+                                              WorkingSetID* id) {
+    // A document being retried, and anything else that isn't a plain read of a batch, goes through
+    // doWork().
+    if (maxResults == 1 || WorkingSet::INVALID_ID != _idRetrying) {
+        return PlanStage::doWorkBatch(maxResults, out, id);
+    }
+
+    if (_pendingIds.empty()) {
+        if (isEOF()) {
+            return PlanStage::IS_EOF;
+        }
+
+        _childBatch.clear();
+        const size_t childWorksBefore = child()->getCommonStats()->works;
+        StageState status = child()->workBatch(maxResults, &_childBatch, id);
+        accountForChildNeedTime(childWorksBefore, _childBatch.size());
+        if (PlanStage::ADVANCED != status) {
+            if (PlanStage::FAILURE == status || PlanStage::DEAD == status) {
+                // If a stage fails, it may create a status WSM to indicate why it
+                // failed, in which case 'id' is valid.  If ID is invalid, we
+                // create our own error message.
+                if (WorkingSet::INVALID_ID == *id) {
+                    bongoutils::str::stream ss;
+                    ss << "fetch stage failed to read in results from child";
+                    Status status(ErrorCodes::InternalError, ss);
+                    *id = WorkingSetCommon::allocateStatusMember(_ws, status);
+                }
+            }
+            return status;
+        }
+        _pendingIds.assign(_childBatch.begin(), _childBatch.end());
+    }
+
+    WorkingSetBatchObjCopier copier(_ws);
+    const size_t numBefore = out->size();
+    size_t numRejected = 0;
+    while (!_pendingIds.empty() && out->size() - numBefore < maxResults) {
+        const WorkingSetID memberId = _pendingIds.front();
+        WorkingSetMember* member = _ws->get(memberId);
+
+        if (member->hasObj()) {
+            ++_specificStats.alreadyHasObj;
+        } else {
+            verify(WorkingSetMember::RID_AND_IDX == member->getState());
+            verify(member->hasRecordId());
+
+            // Anything that needs a yield ends the batch, and is then handled by doWork().
+            try {
+                if (!_cursor)
+                    _cursor = _collection->getCursor(getOpCtx());
+
+                if (_cursor->fetcherForId(member->recordId)) {
+                    break;
+                }
+
+                if (!WorkingSetCommon::fetch(getOpCtx(), _ws, memberId, _cursor)) {
+                    _pendingIds.pop_front();
+                    _ws->free(memberId);
+                    ++numRejected;
+                    continue;
+                }
+            } catch (const WriteConflictException& wce) {
+                break;
+            }
+        }
+
+        _pendingIds.pop_front();
+        WorkingSetID resultId;
+        if (PlanStage::ADVANCED == returnIfMatches(member, memberId, &resultId)) {
+            // The cursor only keeps the document it read last valid, so copy it before moving on.
+            copier.add(resultId);
+            out->push_back(resultId);
+        } else {
+            ++numRejected;
+        }
+    }
+    copier.done();
+
+    if (out->size() > numBefore) {
+        _commonStats.works += numRejected;
+        _commonStats.needTime += numRejected;
+        return PlanStage::ADVANCED;
+    }
+
+    if (numRejected == 0) {
+        return doWork(id);
+    }
+
+    // Every document was filtered out. The last of them is accounted for by our caller.
+    _commonStats.works += numRejected - 1;
+    _commonStats.needTime += numRejected - 1;
+    *id = WorkingSet::INVALID_ID;
+    return PlanStage::NEED_TIME;
+}
+
 void FetchStage::doSaveState() {
     if (_cursor)
         _cursor->saveUnpositioned();
+
+    // Documents that came with our child's batch are only valid until it is over.
+    for (auto pendingId : _pendingIds) {
+        _ws->get(pendingId)->makeObjOwnedIfNeeded();
+    }
 }
 
 void FetchStage::doRestoreState() {
@@ -180,6 +291,13 @@ void FetchStage::doInvalidate(OperationContext* txn, const RecordId& dl, Invalid
             WorkingSetCommon::fetchAndInvalidateRecordId(txn, member, _collection);
         }
     }
+
+    for (auto pendingId : _pendingIds) {
+        WorkingSetMember* member = _ws->get(pendingId);
+        if (member->hasRecordId() && (member->recordId == dl)) {
+            WorkingSetCommon::fetchAndInvalidateRecordId(txn, member, _collection);
+        }
+    }
 }
 
 PlanStage::StageState FetchStage::returnIfMatches(WorkingSetMember* member,
@@ -201,7 +319,7 @@ PlanStage::StageState FetchStage::returnIfMatches(WorkingSetMember* member,
     // predicate.
     ++_specificStats.docsExamined;
 
-    if (Filter::passes(member, _filter)) {
+    if (Filter::passes(member, _compiledFilter.get())) {
         *out = memberID;
         return PlanStage::ADVANCED;
     } else {
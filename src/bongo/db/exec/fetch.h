@@ -28,10 +28,13 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
+#include <vector>
 
 #include "bongo/db/exec/plan_stage.h"
 #include "bongo/db/jsobj.h"
+#include "bongo/db/matcher/compiled_match_expression.h"
 #include "bongo/db/matcher/expression.h"
 #include "bongo/db/record_id.h"
 
@@ -59,6 +62,9 @@ public:
 
     bool isEOF() final;
     StageState doWork(WorkingSetID* out) final;
+    StageState doWorkBatch(size_t maxResults,
+                           std::vector<WorkingSetID>* out,
+                           WorkingSetID* id) final;
 
     void doSaveState() final;
     void doRestoreState() final;
@@ -95,9 +101,17 @@ private:
     // The filter is not owned by us.
     const MatchExpression* _filter;
 
+    // '_filter' compiled for matching documents, or null if there is no filter.
+    std::unique_ptr<CompiledMatchExpression> _compiledFilter;
+
     // If not Null, we use this rather than asking our child what to do next.
     WorkingSetID _idRetrying;
 
+    // Results of our child's last batch that we have yet to work on, in order. After _idRetrying,
+    // we use these rather than asking our child what to do next.
+    std::deque<WorkingSetID> _pendingIds;
+    std::vector<WorkingSetID> _childBatch;
+
     // Stats
     FetchStats _specificStats;
 };
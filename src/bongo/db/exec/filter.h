@@ -29,6 +29,7 @@
 #pragma once
 
 #include "bongo/db/exec/working_set.h"
+#include "bongo/db/matcher/compiled_match_expression.h"
 #include "bongo/db/matcher/expression.h"
 #include "bongo/db/matcher/matchable.h"
 
@@ -157,6 +158,20 @@ public:
         return filter->matches(&doc, NULL);
     }
 
+    /**
+     * Like passes() above, for a filter compiled with CompiledMatchExpression. Members without a
+     * document are matched with the filter's MatchExpression.
+     */
+    static bool passes(WorkingSetMember* wsm, const CompiledMatchExpression* filter) {
+        if (NULL == filter) {
+            return true;
+        }
+        if (!wsm->hasObj()) {
+            return passes(wsm, filter->getExpression());
+        }
+        return filter->matchesBSON(wsm->obj.value());
+    }
+
     static bool passes(const BSONObj& keyData,
                        const BSONObj& keyPattern,
                        const MatchExpression* filter) {
@@ -236,6 +236,40 @@ PlanStage::StageState IndexScan::doWork(WorkingSetID* out) {
     return PlanStage::ADVANCED;
 }
 
+PlanStage::StageState IndexScan::doWorkBatch(size_t maxResults,
+                                             std::vector<WorkingSetID>* out,
+                                             WorkingSetID* id) {
+    // Every result owns its copy of the key (see doWork()), so a batch stays valid after the
+    // cursor moves on. Keys that don't produce a result count towards 'maxResults' as well, so
+    // that a batch never does more units of work than our caller asked for.
+    const size_t numBefore = out->size();
+    size_t numNeedTime = 0;
+    StageState state = PlanStage::NEED_TIME;
+    for (size_t numUnits = 0; numUnits < maxResults; ++numUnits) {
+        state = doWork(id);
+        if (PlanStage::ADVANCED == state) {
+            out->push_back(*id);
+        } else if (PlanStage::NEED_TIME == state) {
+            ++numNeedTime;
+        } else {
+            break;
+        }
+    }
+
+    if (out->size() > numBefore) {
+        // Hitting the end of the scan or a write conflict leaves us in a state that reports it
+        // again on the next call.
+        state = PlanStage::ADVANCED;
+    } else if (PlanStage::NEED_TIME == state) {
+        // Our caller accounts for the last unit of work.
+        --numNeedTime;
+    }
+
+    _commonStats.works += numNeedTime;
+    _commonStats.needTime += numNeedTime;
+    return state;
+}
+
 bool IndexScan::isEOF() {
     return _commonStats.isEOF;
 }
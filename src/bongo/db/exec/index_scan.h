@@ -96,6 +96,9 @@ public:
               const MatchExpression* filter);
 
     StageState doWork(WorkingSetID* out) final;
+    StageState doWorkBatch(size_t maxResults,
+                           std::vector<WorkingSetID>* out,
+                           WorkingSetID* id) final;
     bool isEOF() final;
     void doSaveState() final;
     void doRestoreState() final;
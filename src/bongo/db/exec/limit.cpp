@@ -28,6 +28,8 @@
 
 #include "bongo/db/exec/limit.h"
 
+#include <algorithm>
+
 #include "bongo/db/exec/scoped_timer.h"
 #include "bongo/db/exec/working_set_common.h"
 #include "bongo/stdx/memory.h"
@@ -86,6 +88,37 @@ PlanStage::StageState LimitStage::doWork(WorkingSetID* out) {
     return status;
 }
 
+PlanStage::StageState LimitStage::doWorkBatch(size_t maxResults,
+                                              std::vector<WorkingSetID>* out,
+                                              WorkingSetID* id) {
+    if (0 == _numToReturn) {
+        // We've returned as many results as we're limited to.
+        return PlanStage::IS_EOF;
+    }
+
+    const size_t numBefore = out->size();
+    const size_t childWorksBefore = child()->getCommonStats()->works;
+    StageState status =
+        child()->workBatch(std::min(maxResults, static_cast<size_t>(_numToReturn)), out, id);
+    accountForChildNeedTime(childWorksBefore, out->size() - numBefore);
+
+    if (PlanStage::ADVANCED == status) {
+        _numToReturn -= out->size() - numBefore;
+    } else if (PlanStage::FAILURE == status || PlanStage::DEAD == status) {
+        // If a stage fails, it may create a status WSM to indicate why it
+        // failed, in which case 'id' is valid.  If ID is invalid, we
+        // create our own error message.
+        if (WorkingSet::INVALID_ID == *id) {
+            bongoutils::str::stream ss;
+            ss << "limit stage failed to read in results from child";
+            Status status(ErrorCodes::InternalError, ss);
+            *id = WorkingSetCommon::allocateStatusMember(_ws, status);
+        }
+    }
+
+    return status;
+}
+
 unique_ptr<PlanStageStats> LimitStage::getStats() {
     _commonStats.isEOF = isEOF();
     unique_ptr<PlanStageStats> ret = make_unique<PlanStageStats>(_commonStats, STAGE_LIMIT);
@@ -0,0 +1,561 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kQuery
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/exec/parallel_collection_scan.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "bongo/db/catalog/collection.h"
+#include "bongo/db/client.h"
+#include "bongo/db/concurrency/write_conflict_exception.h"
+#include "bongo/db/db_raii.h"
+#include "bongo/db/exec/working_set.h"
+#include "bongo/db/exec/working_set_common.h"
+#include "bongo/db/matcher/compiled_match_expression.h"
+#include "bongo/db/matcher/expression_parser.h"
+#include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
+#include "bongo/db/operation_context.h"
+#include "bongo/db/query/collation/collator_interface.h"
+#include "bongo/db/storage/record_store.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/util/concurrency/work_stealing_thread_pool.h"
+#include "bongo/util/log.h"
+#include "bongo/util/bongoutils/str.h"
+#include "bongo/util/processinfo.h"
+
+namespace bongo {
+
+using std::unique_ptr;
+using std::vector;
+using stdx::make_unique;
+
+// static
+const char* ParallelCollectionScan::kStageType = "PARALLEL_COLLSCAN";
+
+namespace {
+
+// How many records a thread reads from its range before it hands over the matches and lets go of
+// its lock.
+const size_t kRecordsPerBatch = 1024;
+
+// A batch also ends once its matches take up this many bytes.
+const size_t kMaxBatchBytes = 1024 * 1024;
+
+// Ranges are not rescheduled while matches of at least this many bytes wait to be returned.
+const size_t kMaxBufferedBytes = 16 * 1024 * 1024;
+
+// How many records are sampled for each range when choosing the boundaries between ranges.
+const size_t kSamplesPerPartition = 16;
+
+// How many of the last records read from a range are kept to find the range's place again.
+const size_t kNumResumePoints = 4;
+
+// The longest that work() waits for a batch before returning NEED_TIME, so that the query can
+// yield its locks to a waiting writer, which the threads may be queued behind.
+const Milliseconds kMaxWaitForBatch(1);
+
+/**
+ * Returns the pool whose threads scan ranges for every ParallelCollectionScan. It has a thread
+ * per core, each with its own Client, and is never destroyed.
+ */
+WorkStealingThreadPool* getScanPool() {
+    static WorkStealingThreadPool* const pool = [] {
+        ProcessInfo processInfo;
+        WorkStealingThreadPool::Options options;
+        options.poolName = "ParallelCollectionScan";
+        options.numThreads = std::max<size_t>(
+            1, processInfo.getNumAvailableCores().value_or(processInfo.getNumCores()));
+        options.onCreateThread = [](const std::string& threadName) {
+            Client::initThread(threadName.c_str());
+        };
+        auto pool = new WorkStealingThreadPool(std::move(options));
+        pool->startup();
+        return pool;
+    }();
+    return pool;
+}
+
+}  // namespace
+
+class ParallelCollectionScan::ScanState
+    : public std::enable_shared_from_this<ParallelCollectionScan::ScanState> {
+public:
+    using Batch = vector<std::pair<RecordId, BSONObj>>;
+
+    ScanState(const Collection* collection,
+              const BSONObj& filterObj,
+              const CollatorInterface* collator)
+        : _collection(collection),
+          _nss(collection->ns()),
+          _filterObj(filterObj.getOwned()),
+          _collator(collator ? collator->clone() : nullptr) {
+        if (!_filterObj.isEmpty()) {
+            auto statusWithMatcher = MatchExpressionParser::parse(
+                _filterObj, ExtensionsCallbackDisallowExtensions(), _collator.get());
+            invariantOK(statusWithMatcher.getStatus());
+            _filter = std::move(statusWithMatcher.getValue());
+            _compiledFilter = make_unique<CompiledMatchExpression>(_filter.get());
+        }
+    }
+
+    const MatchExpression* getFilter() const {
+        return _filter.get();
+    }
+
+    /**
+     * Splits the collection at 'boundaries', which must be sorted and distinct, and schedules a
+     * scan of each range.
+     */
+    void start(const vector<RecordId>& boundaries) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _partitions.resize(boundaries.size() + 1);
+        for (size_t i = 0; i < boundaries.size(); ++i) {
+            _partitions[i].end = boundaries[i];
+            _partitions[i + 1].start = boundaries[i];
+        }
+        _numPartitionsLeft = _partitions.size();
+        _scheduleIdlePartitions_inlock();
+    }
+
+    /**
+     * Moves the oldest batch of matches into 'batch', waiting for at most 'maxWait' for one.
+     * Leaves 'batch' empty if there is none yet, and sets 'isDone' if there will be none. Returns
+     * the error that stopped a range from being scanned, if any.
+     */
+    Status takeBatch(Milliseconds maxWait, Batch* batch, bool* isDone) {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _batchReady.wait_for(lk, maxWait.toSystemDuration(), [this] {
+            return !_status.isOK() || !_batches.empty() || _numPartitionsLeft == 0;
+        });
+        if (!_status.isOK()) {
+            return _status;
+        }
+
+        if (_batches.empty()) {
+            *isDone = _numPartitionsLeft == 0;
+            return Status::OK();
+        }
+
+        *batch = std::move(_batches.front().first);
+        _bufferedBytes -= _batches.front().second;
+        _batches.pop_front();
+        _scheduleIdlePartitions_inlock();
+        return Status::OK();
+    }
+
+    /**
+     * Stops scheduling ranges, and drops the matches that have not been taken. Scans already
+     * running finish their current batch.
+     */
+    void cancel() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _cancelled = true;
+        _batches.clear();
+        _bufferedBytes = 0;
+    }
+
+    void getStats(ParallelCollectionScanStats* stats) const {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        stats->docsTested = _docsTested;
+        stats->numPartitions = _partitions.size();
+        stats->numBatches = _numBatches;
+    }
+
+private:
+    struct Partition {
+        // The range is [start, end). A null 'start' is the beginning of the collection, and a null
+        // 'end' is its end.
+        RecordId start;
+        RecordId end;
+
+        // The last records read from the range, oldest first.
+        vector<RecordId> resumePoints;
+
+        bool scheduled = false;
+        bool done = false;
+    };
+
+    void _scheduleIdlePartitions_inlock() {
+        for (size_t i = 0; i < _partitions.size(); ++i) {
+            Partition& partition = _partitions[i];
+            if (_cancelled || !_status.isOK() || _bufferedBytes >= kMaxBufferedBytes) {
+                return;
+            }
+            if (partition.scheduled || partition.done) {
+                continue;
+            }
+
+            auto self = shared_from_this();
+            Status status = getScanPool()->schedule([self, i] { self->_scanPartition(i); });
+            if (!status.isOK()) {
+                _status = status;
+                _batchReady.notify_all();
+                return;
+            }
+            partition.scheduled = true;
+        }
+    }
+
+    /**
+     * Reads the next batch of the range at 'index' with an OperationContext of its own, then
+     * hands it over and reschedules the range if there is room for more matches.
+     */
+    void _scanPartition(size_t index) {
+        vector<RecordId> resumePoints;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_cancelled || !_status.isOK()) {
+                _partitions[index].scheduled = false;
+                return;
+            }
+            resumePoints = _partitions[index].resumePoints;
+        }
+
+        Batch batch;
+        size_t batchBytes = 0;
+        size_t numExamined = 0;
+        bool isDone = false;
+        Status status = Status::OK();
+        try {
+            auto opCtx = cc().makeOperationContext();
+            while (true) {
+                try {
+                    isDone = _readBatch(
+                        opCtx.get(), index, &resumePoints, &batch, &batchBytes, &numExamined);
+                    break;
+                } catch (const WriteConflictException&) {
+                    // Read the batch again in a new snapshot.
+                    batch.clear();
+                    batchBytes = 0;
+                    numExamined = 0;
+                    opCtx->recoveryUnit()->abandonSnapshot();
+                }
+            }
+        } catch (const DBException& ex) {
+            status = ex.toStatus();
+        }
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        Partition& partition = _partitions[index];
+        partition.scheduled = false;
+        if (!status.isOK()) {
+            if (_status.isOK()) {
+                _status = status;
+            }
+            _batchReady.notify_all();
+            return;
+        }
+
+        _docsTested += numExamined;
+        ++_numBatches;
+        partition.resumePoints = std::move(resumePoints);
+        if (isDone) {
+            partition.done = true;
+            --_numPartitionsLeft;
+        }
+        if (!_cancelled && !batch.empty()) {
+            _bufferedBytes += batchBytes;
+            _batches.emplace_back(std::move(batch), batchBytes);
+        }
+        _batchReady.notify_all();
+        _scheduleIdlePartitions_inlock();
+    }
+
+    /**
+     * Reads the records of the range at 'index' that follow 'resumePoints', up to the end of the
+     * batch, and adds those that match to 'batch'. Returns true if the range has been read to its
+     * end.
+     */
+    bool _readBatch(OperationContext* opCtx,
+                    size_t index,
+                    vector<RecordId>* resumePoints,
+                    Batch* batch,
+                    size_t* batchBytes,
+                    size_t* numExamined) {
+        AutoGetCollection autoColl(opCtx, _nss, MODE_IS);
+        if (autoColl.getCollection() != _collection) {
+            uasserted(ErrorCodes::QueryPlanKilled,
+                      str::stream() << "collection " << _nss.ns()
+                                    << " was dropped during a parallel collection scan");
+        }
+
+        const RecordId end = _partitions[index].end;
+        unique_ptr<SeekableRecordCursor> cursor = _collection->getCursor(opCtx);
+        boost::optional<Record> record = _seekToRange(opCtx, index, *resumePoints, &cursor);
+
+        while (record && (end.isNull() || record->id < end)) {
+            ++*numExamined;
+            BSONObj obj = record->data.releaseToBson();
+            if (!_compiledFilter || _compiledFilter->matchesBSON(obj)) {
+                *batchBytes += obj.objsize();
+                batch->emplace_back(record->id, obj.getOwned());
+            }
+
+            if (resumePoints->size() == kNumResumePoints) {
+                resumePoints->erase(resumePoints->begin());
+            }
+            resumePoints->push_back(record->id);
+
+            if (*numExamined >= kRecordsPerBatch || *batchBytes >= kMaxBatchBytes) {
+                return false;
+            }
+            record = cursor->next();
+        }
+        return true;
+    }
+
+    /**
+     * Returns the first record of the range at 'index' that comes after 'resumePoints', leaving
+     * 'cursor' positioned on it.
+     *
+     * The cursor is placed by seeking to the latest record known not to come after that one: one
+     * of 'resumePoints', or the start of this range or of an earlier one. Any of these may have
+     * been deleted since, in which case the next is tried, and the scan reads from the beginning
+     * of the collection if all of them are gone.
+     */
+    boost::optional<Record> _seekToRange(OperationContext* opCtx,
+                                         size_t index,
+                                         const vector<RecordId>& resumePoints,
+                                         unique_ptr<SeekableRecordCursor>* cursor) {
+        vector<RecordId> seekPoints(resumePoints.rbegin(), resumePoints.rend());
+        for (size_t i = index + 1; i-- > 1;) {
+            seekPoints.push_back(_partitions[i].start);
+        }
+
+        boost::optional<Record> record;
+        for (const RecordId& seekPoint : seekPoints) {
+            record = (*cursor)->seekExact(seekPoint);
+            if (record) {
+                break;
+            }
+        }
+        if (!record) {
+            if (!seekPoints.empty()) {
+                *cursor = _collection->getCursor(opCtx);
+            }
+            record = (*cursor)->next();
+        }
+
+        const RecordId& start = _partitions[index].start;
+        const RecordId lastRead = resumePoints.empty() ? RecordId() : resumePoints.back();
+        while (record &&
+               (lastRead.isNull() ? (!start.isNull() && record->id < start)
+                                  : record->id <= lastRead)) {
+            record = (*cursor)->next();
+        }
+        return record;
+    }
+
+    // The threads only read through it once they have checked, under a collection lock of their
+    // own, that it is still the collection named '_nss'.
+    const Collection* const _collection;
+    const NamespaceString _nss;
+
+    const BSONObj _filterObj;
+    const unique_ptr<CollatorInterface> _collator;
+    unique_ptr<MatchExpression> _filter;
+    unique_ptr<CompiledMatchExpression> _compiledFilter;
+
+    // Guards everything below.
+    mutable stdx::mutex _mutex;
+    stdx::condition_variable _batchReady;
+
+    vector<Partition> _partitions;
+    size_t _numPartitionsLeft = 0;
+
+    // Batches of matches with their sizes in bytes, oldest first.
+    std::deque<std::pair<Batch, size_t>> _batches;
+    size_t _bufferedBytes = 0;
+
+    bool _cancelled = false;
+    Status _status = Status::OK();
+
+    size_t _docsTested = 0;
+    size_t _numBatches = 0;
+};
+
+ParallelCollectionScan::ParallelCollectionScan(OperationContext* txn,
+                                               const Collection* collection,
+                                               size_t numWorkers,
+                                               WorkingSet* workingSet,
+                                               const BSONObj& filterObj,
+                                               const CollatorInterface* collator)
+    : PlanStage(kStageType, txn),
+      _collection(collection),
+      _workingSet(workingSet),
+      _numWorkers(std::max<size_t>(1, numWorkers)),
+      _state(std::make_shared<ScanState>(collection, filterObj, collator)) {
+    _specificStats.numWorkers = _numWorkers;
+}
+
+ParallelCollectionScan::~ParallelCollectionScan() {
+    _state->cancel();
+}
+
+// static
+vector<RecordId> ParallelCollectionScan::choosePartitionBoundaries(OperationContext* txn,
+                                                                  const Collection* collection,
+                                                                  size_t numPartitions) {
+    vector<RecordId> samples;
+    if (numPartitions > 1) {
+        try {
+            auto cursor = collection->getRecordStore()->getRandomCursor(txn);
+            while (cursor && samples.size() < numPartitions * kSamplesPerPartition) {
+                auto record = cursor->next();
+                if (!record) {
+                    break;
+                }
+                samples.push_back(record->id);
+            }
+        } catch (const WriteConflictException&) {
+            // Split the collection at the boundaries sampled so far.
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    samples.erase(std::unique(samples.begin(), samples.end()), samples.end());
+
+    vector<RecordId> boundaries;
+    for (size_t i = 1; i < numPartitions && !samples.empty(); ++i) {
+        const RecordId& boundary = samples[i * samples.size() / numPartitions];
+        if (boundaries.empty() || boundaries.back() < boundary) {
+            boundaries.push_back(boundary);
+        }
+    }
+    return boundaries;
+}
+
+void ParallelCollectionScan::startScan() {
+    // Split the collection into '_numWorkers' ranges of about the same size.
+    _started = true;
+    _state->start(choosePartitionBoundaries(getOpCtx(), _collection, _numWorkers));
+}
+
+PlanStage::StageState ParallelCollectionScan::doWork(WorkingSetID* out) {
+    if (_commonStats.isEOF) {
+        return PlanStage::IS_EOF;
+    }
+
+    if (!_started) {
+        startScan();
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_TIME;
+    }
+
+    if (_nextResult == _results.size()) {
+        StageState state = getNextBatch(out);
+        if (PlanStage::ADVANCED != state) {
+            return state;
+        }
+    }
+
+    *out = allocateResult();
+    return PlanStage::ADVANCED;
+}
+
+PlanStage::StageState ParallelCollectionScan::doWorkBatch(size_t maxResults,
+                                                          vector<WorkingSetID>* out,
+                                                          WorkingSetID* id) {
+    // Waiting for a batch takes the path of a single call to work().
+    if (_nextResult == _results.size()) {
+        return PlanStage::doWorkBatch(maxResults, out, id);
+    }
+
+    const size_t numBefore = out->size();
+    while (out->size() - numBefore < maxResults && _nextResult < _results.size()) {
+        out->push_back(allocateResult());
+    }
+    return PlanStage::ADVANCED;
+}
+
+PlanStage::StageState ParallelCollectionScan::getNextBatch(WorkingSetID* out) {
+    _results.clear();
+    _nextResult = 0;
+
+    bool isDone = false;
+    Status status = _state->takeBatch(kMaxWaitForBatch, &_results, &isDone);
+    _state->getStats(&_specificStats);
+    if (!status.isOK()) {
+        *out = WorkingSetCommon::allocateStatusMember(_workingSet, status);
+        return PlanStage::FAILURE;
+    }
+
+    if (isDone) {
+        _commonStats.isEOF = true;
+        return PlanStage::IS_EOF;
+    }
+
+    if (_results.empty()) {
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_TIME;
+    }
+    return PlanStage::ADVANCED;
+}
+
+WorkingSetID ParallelCollectionScan::allocateResult() {
+    auto& result = _results[_nextResult++];
+
+    WorkingSetID id = _workingSet->allocate();
+    WorkingSetMember* member = _workingSet->get(id);
+    member->recordId = result.first;
+    member->obj = {getOpCtx()->recoveryUnit()->getSnapshotId(), result.second};
+    _workingSet->transitionToRecordIdAndObj(id);
+    result.second = BSONObj();
+    return id;
+}
+
+bool ParallelCollectionScan::isEOF() {
+    return _commonStats.isEOF;
+}
+
+unique_ptr<PlanStageStats> ParallelCollectionScan::getStats() {
+    // Add a BSON representation of the filter to the stats tree, if there is one.
+    if (const MatchExpression* filter = _state->getFilter()) {
+        BSONObjBuilder bob;
+        filter->serialize(&bob);
+        _commonStats.filter = bob.obj();
+    }
+
+    _state->getStats(&_specificStats);
+    unique_ptr<PlanStageStats> ret =
+        make_unique<PlanStageStats>(_commonStats, STAGE_PARALLEL_COLLSCAN);
+    ret->specific = make_unique<ParallelCollectionScanStats>(_specificStats);
+    return ret;
+}
+
+const SpecificStats* ParallelCollectionScan::getSpecificStats() const {
+    return &_specificStats;
+}
+
+}  // namespace bongo
@@ -0,0 +1,144 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "bongo/db/exec/plan_stage.h"
+#include "bongo/db/exec/plan_stats.h"
+#include "bongo/db/jsobj.h"
+#include "bongo/db/record_id.h"
+
+namespace bongo {
+
+class Collection;
+class CollatorInterface;
+class MatchExpression;
+class OperationContext;
+class WorkingSet;
+
+/**
+ * Scans a collection with several threads. The RecordId space is split into ranges, using
+ * boundaries sampled from the record store's random cursor, and each range is read and filtered
+ * by a thread of a process-wide pool. Matching documents come back in no particular order.
+ *
+ * Each range is read in batches. For every batch a thread takes its own OperationContext and
+ * collection lock, reads on from where the range left off, then releases the lock before handing
+ * the owned matches to this stage. Threads therefore never wait for the query while holding a
+ * lock, and a range whose results are not being consumed is not rescheduled until they are.
+ *
+ * Only usable by read-only plans whose yield policy lets them yield, on storage engines with
+ * document-level locking: ranges are read outside the query's snapshot, and the stage does not
+ * wait on its threads for longer than a short interval while the query holds its locks.
+ */
+class ParallelCollectionScan final : public PlanStage {
+public:
+    /**
+     * 'filterObj' is parsed again, with 'collator', so that the threads have a filter which does
+     * not depend on this stage or the query outliving them.
+     */
+    ParallelCollectionScan(OperationContext* txn,
+                           const Collection* collection,
+                           size_t numWorkers,
+                           WorkingSet* workingSet,
+                           const BSONObj& filterObj,
+                           const CollatorInterface* collator);
+
+    ~ParallelCollectionScan();
+
+    StageState doWork(WorkingSetID* out) final;
+    StageState doWorkBatch(size_t maxResults,
+                           std::vector<WorkingSetID>* out,
+                           WorkingSetID* id) final;
+    bool isEOF() final;
+
+    StageType stageType() const final {
+        return STAGE_PARALLEL_COLLSCAN;
+    }
+
+    std::unique_ptr<PlanStageStats> getStats() final;
+
+    const SpecificStats* getSpecificStats() const final;
+
+    static const char* kStageType;
+
+    /**
+     * Returns up to 'numPartitions' - 1 sorted, distinct boundaries which split 'collection' into
+     * ranges of about the same size, chosen by sampling the record store's random cursor. Returns
+     * fewer, possibly none, if the collection is too small or cannot be sampled.
+     */
+    static std::vector<RecordId> choosePartitionBoundaries(OperationContext* txn,
+                                                           const Collection* collection,
+                                                           size_t numPartitions);
+
+    /**
+     * State shared with the threads scanning the collection's ranges, which may outlive this
+     * stage.
+     */
+    class ScanState;
+
+private:
+    /**
+     * Splits the collection into ranges and starts scanning them.
+     */
+    void startScan();
+
+    /**
+     * Moves the next batch of results into '_results', waiting briefly for one if there is none.
+     * Returns NEED_TIME if there is no batch yet, IS_EOF once every range has been scanned,
+     * FAILURE if a range could not be scanned, and ADVANCED if there are results to return.
+     */
+    StageState getNextBatch(WorkingSetID* out);
+
+    /**
+     * Puts the next result in '_results' in a new working set member.
+     */
+    WorkingSetID allocateResult();
+
+    // Not owned by us.
+    const Collection* _collection;
+
+    // WorkingSet is not owned by us.
+    WorkingSet* _workingSet;
+
+    const size_t _numWorkers;
+
+    std::shared_ptr<ScanState> _state;
+    bool _started = false;
+
+    // The batch of results being returned, and the position of the next one.
+    std::vector<std::pair<RecordId, BSONObj>> _results;
+    size_t _nextResult = 0;
+
+    ParallelCollectionScanStats _specificStats;
+};
+
+}  // namespace bongo
@@ -56,6 +56,54 @@ PlanStage::StageState PlanStage::work(WorkingSetID* out) {
     return workResult;
 }
 
+PlanStage::StageState PlanStage::workBatch(size_t maxResults,
+                                           std::vector<WorkingSetID>* out,
+                                           WorkingSetID* id) {
+    invariant(_opCtx);
+    invariant(maxResults > 0);
+    ScopedTimer timer(getClock(), &_commonStats.executionTimeMillis);
+
+    const size_t numBefore = out->size();
+    StageState workResult = doWorkBatch(maxResults, out, id);
+    const size_t numAdvanced = out->size() - numBefore;
+
+    if (StageState::ADVANCED == workResult) {
+        invariant(numAdvanced > 0 && numAdvanced <= maxResults);
+        _commonStats.works += numAdvanced;
+        _commonStats.advanced += numAdvanced;
+        return workResult;
+    }
+
+    invariant(numAdvanced == 0);
+    ++_commonStats.works;
+    if (StageState::NEED_TIME == workResult) {
+        ++_commonStats.needTime;
+    } else if (StageState::NEED_YIELD == workResult) {
+        ++_commonStats.needYield;
+    }
+
+    return workResult;
+}
+
+PlanStage::StageState PlanStage::doWorkBatch(size_t maxResults,
+                                             std::vector<WorkingSetID>* out,
+                                             WorkingSetID* id) {
+    StageState state = doWork(id);
+    if (StageState::ADVANCED == state) {
+        out->push_back(*id);
+    }
+    return state;
+}
+
+void PlanStage::accountForChildNeedTime(size_t childWorksBefore, size_t numChildResults) {
+    // workBatch() already counts one unit of work for a batch that produced no results.
+    const size_t numChildWorks = child()->getCommonStats()->works - childWorksBefore;
+    const size_t numCounted = std::max(numChildResults, size_t(1));
+    invariant(numChildWorks >= numCounted);
+    _commonStats.works += numChildWorks - numCounted;
+    _commonStats.needTime += numChildWorks - numCounted;
+}
+
 void PlanStage::saveState() {
     ++_commonStats.yields;
     for (auto&& child : _children) {
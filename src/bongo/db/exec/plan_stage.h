@@ -188,6 +188,24 @@ public:
      */
     StageState work(WorkingSetID* out);
 
+    /**
+     * Performs units of work on the query until up to 'maxResults' results have been produced,
+     * and appends them to 'out' in the order in which work() would have returned them. This
+     * amortizes the cost of a work() call through the stage tree over a batch of results.
+     *
+     * Returns ADVANCED if at least one result was appended. The batch may stop short of
+     * 'maxResults' at any point, for instance to let the caller yield; whatever made it stop is
+     * reported by the next call. Otherwise, nothing is appended and the return value and '*id'
+     * are what work(id) would have returned, with NEED_TIME meaning that the stage did some
+     * work without producing results.
+     *
+     * The results of a batch are all valid at the same time, until the next call to work(),
+     * workBatch() or saveState(). The caller must free them from the working set when done.
+     *
+     * Stages that don't override doWorkBatch() produce batches of a single result.
+     */
+    StageState workBatch(size_t maxResults, std::vector<WorkingSetID>* out, WorkingSetID* id);
+
     /**
      * Returns true if no more work can be done on the query / out of results.
      */
@@ -308,6 +326,14 @@ public:
         return &_commonStats;
     }
 
+    /**
+     * Records the number of results the query planner expects this stage to produce, so that
+     * explain can report it next to the number actually produced.
+     */
+    void setEstimatedNReturned(double estimatedNReturned) {
+        _commonStats.estimatedNReturned = estimatedNReturned;
+    }
+
     /**
      * Get stats specific to this stage. Some stages may not have specific stats, in which
      * case they return NULL. The pointer is *not* owned by the caller.
@@ -324,6 +350,26 @@ protected:
      */
     virtual StageState doWork(WorkingSetID* out) = 0;
 
+    /**
+     * Produces a batch of results.  See comment at workBatch() above.
+     *
+     * Implementations account in '_commonStats' for units of work that produced no result, other
+     * than one that is reported by returning something other than ADVANCED, so that a batched plan
+     * reports the same work as one run with work().  The default performs a single unit of work
+     * with doWork().
+     */
+    virtual StageState doWorkBatch(size_t maxResults,
+                                   std::vector<WorkingSetID>* out,
+                                   WorkingSetID* id);
+
+    /**
+     * For a doWorkBatch() that passed the call on to its only child. Given the child's work count
+     * from before that call and the number of results the child produced, accounts for the units
+     * of work that the child did without producing a result, each of which work() would have
+     * reported to us as NEED_TIME.
+     */
+    void accountForChildNeedTime(size_t childWorksBefore, size_t numChildResults);
+
     /**
      * Saves any stage-specific state required to resume where it was if the underlying data
      * changes.
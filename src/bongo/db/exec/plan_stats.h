@@ -65,6 +65,7 @@ struct CommonStats {
           needTime(0),
           needYield(0),
           executionTimeMillis(0),
+          estimatedNReturned(-1),
           isEOF(false) {}
     // String giving the type of the stage. Not owned.
     const char* stageTypeStr;
@@ -87,6 +88,10 @@ struct CommonStats {
     // Time elapsed while working inside this stage.
     long long executionTimeMillis;
 
+    // The number of results the query planner expected this stage to produce, or a negative value
+    // if it made no estimate.
+    double estimatedNReturned;
+
     // TODO: have some way of tracking WSM sizes (or really any series of #s).  We can measure
     // the size of our inputs and the size of our outputs.  We can do a lot with the WS here.
 
@@ -208,6 +213,23 @@ struct CollectionScanStats : public SpecificStats {
     int direction;
 };
 
+struct ParallelCollectionScanStats : public SpecificStats {
+    SpecificStats* clone() const final {
+        ParallelCollectionScanStats* specific = new ParallelCollectionScanStats(*this);
+        return specific;
+    }
+
+    // How many documents did the threads check against the filter?
+    size_t docsTested = 0;
+
+    // How many threads may scan at once, and into how many ranges the collection was split.
+    size_t numWorkers = 0;
+    size_t numPartitions = 0;
+
+    // How many batches of documents the threads read.
+    size_t numBatches = 0;
+};
+
 struct CountStats : public SpecificStats {
     CountStats() : nCounted(0), nSkipped(0), recordStoreCount(false) {}
 
@@ -327,6 +349,43 @@ struct DistinctScanStats : public SpecificStats {
     BSONObj indexBounds;
 };
 
+struct SkipScanStats : public SpecificStats {
+    SpecificStats* clone() const final {
+        SkipScanStats* specific = new SkipScanStats(*this);
+        // BSON objects have to be explicitly copied.
+        specific->keyPattern = keyPattern.getOwned();
+        specific->collation = collation.getOwned();
+        specific->indexBounds = indexBounds.getOwned();
+        return specific;
+    }
+
+    // How many keys did we look at?
+    size_t keysExamined = 0;
+
+    // How many times did we seek, and how many of those seeks moved on to the next distinct value
+    // of the leading fields?
+    size_t seeks = 0;
+    size_t prefixesSkipped = 0;
+
+    BSONObj keyPattern;
+
+    BSONObj collation;
+
+    // Properties of the index used for the skip scan.
+    std::string indexName;
+    int indexVersion = 0;
+
+    bool isPartial = false;
+    bool isSparse = false;
+    bool isUnique = false;
+
+    // How many leading fields of the key pattern are skipped through.
+    int prefixLen = 0;
+
+    // A BSON representation of the skip scan's index bounds.
+    BSONObj indexBounds;
+};
+
 struct EnsureSortedStats : public SpecificStats {
     EnsureSortedStats() : nDropped(0) {}
 
@@ -508,7 +567,7 @@ struct ProjectionStats : public SpecificStats {
 };
 
 struct SortStats : public SpecificStats {
-    SortStats() : forcedFetches(0), memUsage(0), memLimit(0) {}
+    SortStats() : forcedFetches(0), memUsage(0), memLimit(0), usedDisk(false) {}
 
     SpecificStats* clone() const final {
         SortStats* specific = new SortStats(*this);
@@ -524,6 +583,9 @@ struct SortStats : public SpecificStats {
     // What's our memory limit?
     size_t memLimit;
 
+    // Did we spill sorted runs to disk?
+    bool usedDisk;
+
     // The number of results to return from the sort.
     size_t limit;
 
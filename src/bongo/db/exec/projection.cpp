@@ -227,6 +227,44 @@ PlanStage::StageState ProjectionStage::doWork(WorkingSetID* out) {
     return status;
 }
 
+PlanStage::StageState ProjectionStage::doWorkBatch(size_t maxResults,
+                                                   std::vector<WorkingSetID>* out,
+                                                   WorkingSetID* id) {
+    const size_t numBefore = out->size();
+    const size_t childWorksBefore = child()->getCommonStats()->works;
+    StageState status = child()->workBatch(maxResults, out, id);
+    accountForChildNeedTime(childWorksBefore, out->size() - numBefore);
+
+    if (PlanStage::ADVANCED == status) {
+        for (size_t i = numBefore; i < out->size(); ++i) {
+            // Punt to our specific projection impl.
+            Status projStatus = transform(_ws->get((*out)[i]));
+            if (!projStatus.isOK()) {
+                // The error ends the query, so the rest of the batch is of no use.
+                warning() << "Couldn't execute projection, status = " << redact(projStatus);
+                for (size_t j = numBefore; j < out->size(); ++j) {
+                    _ws->free((*out)[j]);
+                }
+                out->resize(numBefore);
+                *id = WorkingSetCommon::allocateStatusMember(_ws, projStatus);
+                return PlanStage::FAILURE;
+            }
+        }
+    } else if (PlanStage::FAILURE == status || PlanStage::DEAD == status) {
+        // If a stage fails, it may create a status WSM to indicate why it
+        // failed, in which case 'id' is valid.  If ID is invalid, we
+        // create our own error message.
+        if (WorkingSet::INVALID_ID == *id) {
+            bongoutils::str::stream ss;
+            ss << "projection stage failed to read in results from child";
+            Status status(ErrorCodes::InternalError, ss);
+            *id = WorkingSetCommon::allocateStatusMember(_ws, status);
+        }
+    }
+
+    return status;
+}
+
 unique_ptr<PlanStageStats> ProjectionStage::getStats() {
     _commonStats.isEOF = isEOF();
     unique_ptr<PlanStageStats> ret = make_unique<PlanStageStats>(_commonStats, STAGE_PROJECTION);
@@ -27,6 +27,9 @@
 */
 
 #include "bongo/db/exec/skip.h"
+
+#include <algorithm>
+
 #include "bongo/db/exec/scoped_timer.h"
 #include "bongo/db/exec/working_set_common.h"
 #include "bongo/stdx/memory.h"
@@ -87,6 +90,49 @@ PlanStage::StageState SkipStage::doWork(WorkingSetID* out) {
     return status;
 }
 
+PlanStage::StageState SkipStage::doWorkBatch(size_t maxResults,
+                                             std::vector<WorkingSetID>* out,
+                                             WorkingSetID* id) {
+    const size_t numBefore = out->size();
+    const size_t childWorksBefore = child()->getCommonStats()->works;
+    StageState status = child()->workBatch(maxResults, out, id);
+    accountForChildNeedTime(childWorksBefore, out->size() - numBefore);
+
+    if (PlanStage::ADVANCED == status) {
+        // If we're still skipping results, drop them from the front of the batch.
+        const size_t numToDrop =
+            std::min(out->size() - numBefore, static_cast<size_t>(std::max(_toSkip, 0LL)));
+        for (size_t i = numBefore; i < numBefore + numToDrop; ++i) {
+            _ws->free((*out)[i]);
+        }
+        out->erase(out->begin() + numBefore, out->begin() + numBefore + numToDrop);
+        _toSkip -= numToDrop;
+
+        if (out->size() == numBefore) {
+            // The last result dropped is accounted for by our caller.
+            _commonStats.works += numToDrop - 1;
+            _commonStats.needTime += numToDrop - 1;
+            *id = WorkingSet::INVALID_ID;
+            return PlanStage::NEED_TIME;
+        }
+
+        _commonStats.works += numToDrop;
+        _commonStats.needTime += numToDrop;
+    } else if (PlanStage::FAILURE == status || PlanStage::DEAD == status) {
+        // If a stage fails, it may create a status WSM to indicate why it
+        // failed, in which case 'id' is valid.  If ID is invalid, we
+        // create our own error message.
+        if (WorkingSet::INVALID_ID == *id) {
+            bongoutils::str::stream ss;
+            ss << "skip stage failed to read in results from child";
+            Status status(ErrorCodes::InternalError, ss);
+            *id = WorkingSetCommon::allocateStatusMember(_ws, status);
+        }
+    }
+
+    return status;
+}
+
 unique_ptr<PlanStageStats> SkipStage::getStats() {
     _commonStats.isEOF = isEOF();
     _specificStats.skip = _toSkip;
@@ -0,0 +1,188 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/exec/skip_scan.h"
+
+#include "bongo/db/concurrency/write_conflict_exception.h"
+#include "bongo/db/exec/scoped_timer.h"
+#include "bongo/db/exec/working_set.h"
+#include "bongo/db/index/index_access_method.h"
+#include "bongo/db/index/index_descriptor.h"
+#include "bongo/stdx/memory.h"
+
+namespace bongo {
+
+using std::unique_ptr;
+using stdx::make_unique;
+
+// static
+const char* SkipScan::kStageType = "SKIP_SCAN";
+
+SkipScan::SkipScan(OperationContext* txn, const SkipScanParams& params, WorkingSet* workingSet)
+    : PlanStage(kStageType, txn),
+      _workingSet(workingSet),
+      _descriptor(params.descriptor),
+      _iam(params.descriptor->getIndexCatalog()->getIndex(params.descriptor)),
+      _params(params),
+      _checker(&_params.bounds, _descriptor->keyPattern(), 1) {
+    invariant(_params.prefixLen > 0);
+    invariant(static_cast<size_t>(_params.prefixLen) < _params.bounds.fields.size());
+
+    _specificStats.keyPattern = _descriptor->keyPattern();
+    if (BSONElement collationElement = _descriptor->getInfoElement("collation")) {
+        invariant(collationElement.isABSONObj());
+        _specificStats.collation = collationElement.Obj().getOwned();
+    }
+    _specificStats.indexName = _descriptor->indexName();
+    _specificStats.indexVersion = static_cast<int>(_descriptor->version());
+    _specificStats.isUnique = _descriptor->unique();
+    _specificStats.isSparse = _descriptor->isSparse();
+    _specificStats.isPartial = _descriptor->isPartial();
+    _specificStats.prefixLen = _params.prefixLen;
+
+    // Set up our initial seek. If there is no valid data, just mark as EOF.
+    _commonStats.isEOF = !_checker.getStartSeekPoint(&_seekPoint);
+}
+
+PlanStage::StageState SkipScan::doWork(WorkingSetID* out) {
+    if (_commonStats.isEOF)
+        return PlanStage::IS_EOF;
+
+    boost::optional<IndexKeyEntry> kv;
+    try {
+        if (!_cursor)
+            _cursor = _iam->newCursor(getOpCtx(), true);
+
+        if (_needSeek) {
+            ++_specificStats.seeks;
+            if (_seekPoint.prefixExclusive && _seekPoint.prefixLen <= _params.prefixLen) {
+                ++_specificStats.prefixesSkipped;
+            }
+            kv = _cursor->seek(_seekPoint);
+        } else {
+            kv = _cursor->next();
+        }
+    } catch (const WriteConflictException& wce) {
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_YIELD;
+    }
+
+    if (!kv) {
+        _commonStats.isEOF = true;
+        _cursor.reset();
+        return PlanStage::IS_EOF;
+    }
+
+    ++_specificStats.keysExamined;
+
+    switch (_checker.checkKey(kv->key, &_seekPoint)) {
+        case IndexBoundsChecker::MUST_ADVANCE:
+            // Either the trailing fields are outside their bounds for this prefix, or the prefix
+            // has no more keys within them. The checker has adjusted the _seekPoint, whose prefix
+            // must outlive the cursor's position should we yield before seeking.
+            _seekPoint.keyPrefix = _seekPoint.keyPrefix.getOwned();
+            _needSeek = true;
+            return PlanStage::NEED_TIME;
+
+        case IndexBoundsChecker::DONE:
+            // There won't be a next time.
+            _commonStats.isEOF = true;
+            _cursor.reset();
+            return PlanStage::IS_EOF;
+
+        case IndexBoundsChecker::VALID:
+            _needSeek = false;
+
+            if (!kv->key.isOwned())
+                kv->key = kv->key.getOwned();
+
+            // Package up the result for the caller.
+            WorkingSetID id = _workingSet->allocate();
+            WorkingSetMember* member = _workingSet->get(id);
+            member->recordId = kv->loc;
+            member->keyData.push_back(IndexKeyDatum(_descriptor->keyPattern(), kv->key, _iam));
+            _workingSet->transitionToRecordIdAndIdx(id);
+
+            *out = id;
+            return PlanStage::ADVANCED;
+    }
+    BONGO_UNREACHABLE;
+}
+
+bool SkipScan::isEOF() {
+    return _commonStats.isEOF;
+}
+
+void SkipScan::doSaveState() {
+    if (!_cursor)
+        return;
+
+    // If we are about to seek, where the cursor is doesn't matter.
+    if (_needSeek) {
+        _cursor->saveUnpositioned();
+        return;
+    }
+
+    _cursor->save();
+}
+
+void SkipScan::doRestoreState() {
+    if (_cursor)
+        _cursor->restore();
+}
+
+void SkipScan::doDetachFromOperationContext() {
+    if (_cursor)
+        _cursor->detachFromOperationContext();
+}
+
+void SkipScan::doReattachToOperationContext() {
+    if (_cursor)
+        _cursor->reattachToOperationContext(getOpCtx());
+}
+
+unique_ptr<PlanStageStats> SkipScan::getStats() {
+    // Serialize the bounds to BSON if we have not done so already. This is done here rather than in
+    // the constructor in order to avoid the expensive serialization operation unless the query is
+    // being explained.
+    if (_specificStats.indexBounds.isEmpty()) {
+        _specificStats.indexBounds = _params.bounds.toBSON();
+    }
+
+    unique_ptr<PlanStageStats> ret = make_unique<PlanStageStats>(_commonStats, STAGE_SKIP_SCAN);
+    ret->specific = make_unique<SkipScanStats>(_specificStats);
+    return ret;
+}
+
+const SpecificStats* SkipScan::getSpecificStats() const {
+    return &_specificStats;
+}
+
+}  // namespace bongo
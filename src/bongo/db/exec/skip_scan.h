@@ -0,0 +1,117 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "bongo/db/exec/plan_stage.h"
+#include "bongo/db/index/index_access_method.h"
+#include "bongo/db/jsobj.h"
+#include "bongo/db/query/index_bounds.h"
+#include "bongo/db/record_id.h"
+
+namespace bongo {
+
+class IndexAccessMethod;
+class IndexDescriptor;
+class WorkingSet;
+
+struct SkipScanParams {
+    // What index are we traversing?
+    const IndexDescriptor* descriptor = nullptr;
+
+    // The bounds to scan.  The first 'prefixLen' fields are expected to be unconstrained.
+    IndexBounds bounds;
+
+    // How many leading fields of the index's key pattern we skip through the distinct values of.
+    // For example, if we use an index {a: 1, b: 1} to answer a predicate on 'b' alone, the
+    // prefix length is 1.
+    int prefixLen = 0;
+};
+
+/**
+ * Scans an index whose leading fields have no predicates by seeking through the distinct values
+ * of those fields and, under each, only reading the keys within the bounds on the fields that
+ * follow.  When the leading fields have few distinct values this examines far fewer keys than a
+ * scan of the whole index.
+ *
+ * Like DistinctScan, this relies on the IndexBoundsChecker to compute where to seek next, but it
+ * returns every key within the bounds rather than the first key of each distinct value.  The
+ * index must not be multikey, as results are not deduplicated.
+ *
+ * Sub-stage preconditions: None.  Is a leaf and consumes no stage data.
+ */
+class SkipScan final : public PlanStage {
+public:
+    SkipScan(OperationContext* txn, const SkipScanParams& params, WorkingSet* workingSet);
+
+    StageState doWork(WorkingSetID* out) final;
+    bool isEOF() final;
+    void doSaveState() final;
+    void doRestoreState() final;
+    void doDetachFromOperationContext() final;
+    void doReattachToOperationContext() final;
+
+    StageType stageType() const final {
+        return STAGE_SKIP_SCAN;
+    }
+
+    std::unique_ptr<PlanStageStats> getStats() final;
+
+    const SpecificStats* getSpecificStats() const final;
+
+    static const char* kStageType;
+
+private:
+    // The WorkingSet we annotate with results.  Not owned by us.
+    WorkingSet* _workingSet;
+
+    // Index access.
+    const IndexDescriptor* _descriptor;  // owned by Collection -> IndexCatalog
+    const IndexAccessMethod* _iam;       // owned by Collection -> IndexCatalog
+
+    // The cursor we use to navigate the tree.
+    std::unique_ptr<SortedDataInterface::Cursor> _cursor;
+
+    SkipScanParams _params;
+
+    // _checker gives us our start key and tells us where to seek to whenever a key falls outside
+    // the bounds.
+    IndexBoundsChecker _checker;
+    IndexSeekPoint _seekPoint;
+
+    // True if the next key must be found by seeking to '_seekPoint' rather than by advancing
+    // the cursor.
+    bool _needSeek = true;
+
+    // Stats
+    SkipScanStats _specificStats;
+};
+
+}  // namespace bongo
@@ -31,6 +31,8 @@
 #include "bongo/db/exec/sort.h"
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
 
 #include "bongo/db/catalog/collection.h"
 #include "bongo/db/exec/scoped_timer.h"
@@ -41,7 +43,10 @@
 #include "bongo/db/query/find_common.h"
 #include "bongo/db/query/query_knobs.h"
 #include "bongo/db/query/query_planner.h"
+#include "bongo/db/storage/key_string.h"
+#include "bongo/db/storage/storage_options.h"
 #include "bongo/stdx/memory.h"
+#include "bongo/util/bufreader.h"
 #include "bongo/util/log.h"
 
 namespace bongo {
@@ -51,20 +56,197 @@ using std::unique_ptr;
 using std::vector;
 using stdx::make_unique;
 
+namespace {
+
+// The most fields an Ordering can describe.
+const int kMaxOrderingFields = 32;
+
+/**
+ * Sort keys are encoded only if every field sorts on a value, rather than on a $meta, and there
+ * are few enough of them for an Ordering.
+ */
+bool canEncodeSortKeys(const BSONObj& pattern) {
+    if (pattern.nFields() > kMaxOrderingFields) {
+        return false;
+    }
+    for (BSONElement elt : pattern) {
+        if (!elt.isNumber()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 // static
 const char* SortStage::kStageType = "SORT";
 
-SortStage::WorkingSetComparator::WorkingSetComparator(BSONObj p) : pattern(p) {}
+int SortStage::SortableKey::compare(const SortableKey& other) const {
+    dassert(!isEmpty() && !other.isEmpty());
+    const size_t lhsSize = _encoded.size();
+    const size_t rhsSize = other._encoded.size();
+    const int cmp = memcmp(_encoded.data(), other._encoded.data(), std::min(lhsSize, rhsSize));
+    if (cmp) {
+        return cmp;
+    }
+    return lhsSize < rhsSize ? -1 : (lhsSize == rhsSize ? 0 : 1);
+}
+
+void SortStage::SortableKey::serializeForSorter(BufBuilder& buf) const {
+    buf.appendNum(static_cast<int>(_encoded.size()));
+    buf.appendBuf(_encoded.data(), _encoded.size());
+}
+
+// static
+SortStage::SortableKey SortStage::SortableKey::deserializeForSorter(
+    BufReader& buf, const SorterDeserializeSettings&) {
+    const int size = buf.read<LittleEndian<int>>();
+    const char* data = static_cast<const char*>(buf.skip(size));
+    return SortableKey(std::string(data, size));
+}
+
+SortStage::SortableMember::SortableMember(const WorkingSetMember& member, long long sequence)
+    : _recordId(member.hasRecordId() ? member.recordId : RecordId()),
+      _sequence(sequence),
+      _obj(member.obj) {
+    if (member.hasComputed(WSM_COMPUTED_TEXT_SCORE)) {
+        _computed |= kTextScore;
+        _textScore = static_cast<const TextScoreComputedData*>(
+                         member.getComputed(WSM_COMPUTED_TEXT_SCORE))
+                         ->getScore();
+    }
+    if (member.hasComputed(WSM_COMPUTED_GEO_DISTANCE)) {
+        _computed |= kGeoDistance;
+        _geoDistance = static_cast<const GeoDistanceComputedData*>(
+                           member.getComputed(WSM_COMPUTED_GEO_DISTANCE))
+                           ->getDist();
+    }
+    if (member.hasComputed(WSM_INDEX_KEY)) {
+        _computed |= kIndexKey;
+        _indexKey =
+            static_cast<const IndexKeyComputedData*>(member.getComputed(WSM_INDEX_KEY))->getKey();
+    }
+    if (member.hasComputed(WSM_GEO_NEAR_POINT)) {
+        _computed |= kGeoNearPoint;
+        _geoNearPoint =
+            static_cast<const GeoNearPointComputedData*>(member.getComputed(WSM_GEO_NEAR_POINT))
+                ->getPoint();
+    }
+    if (member.hasComputed(WSM_SORT_KEY)) {
+        _computed |= kSortKey;
+        _sortKey =
+            static_cast<const SortKeyComputedData*>(member.getComputed(WSM_SORT_KEY))->getSortKey();
+    }
+}
+
+WorkingSetID SortStage::SortableMember::allocateMember(WorkingSet* ws, bool dropRecordId) const {
+    WorkingSetID id = ws->allocate();
+    WorkingSetMember* member = ws->get(id);
+    member->obj = Snapshotted<BSONObj>(_obj.snapshotId(), _obj.value().getOwned());
+
+    if (_computed & kTextScore) {
+        member->addComputed(new TextScoreComputedData(_textScore));
+    }
+    if (_computed & kGeoDistance) {
+        member->addComputed(new GeoDistanceComputedData(_geoDistance));
+    }
+    if (_computed & kIndexKey) {
+        member->addComputed(new IndexKeyComputedData(_indexKey));
+    }
+    if (_computed & kGeoNearPoint) {
+        member->addComputed(new GeoNearPointComputedData(_geoNearPoint));
+    }
+    if (_computed & kSortKey) {
+        member->addComputed(new SortKeyComputedData(_sortKey));
+    }
+
+    if (_recordId.isNull() || dropRecordId) {
+        ws->transitionToOwnedObj(id);
+    } else {
+        member->recordId = _recordId;
+        ws->transitionToRecordIdAndObj(id);
+    }
+    return id;
+}
+
+void SortStage::SortableMember::serializeForSorter(BufBuilder& buf) const {
+    _recordId.serializeForSorter(buf);
+    buf.appendNum(_sequence);
+    _obj.value().serializeForSorter(buf);
+    buf.appendNum(static_cast<char>(_computed));
+    if (_computed & kTextScore) {
+        buf.appendNum(_textScore);
+    }
+    if (_computed & kGeoDistance) {
+        buf.appendNum(_geoDistance);
+    }
+    if (_computed & kIndexKey) {
+        _indexKey.serializeForSorter(buf);
+    }
+    if (_computed & kGeoNearPoint) {
+        _geoNearPoint.serializeForSorter(buf);
+    }
+    if (_computed & kSortKey) {
+        _sortKey.serializeForSorter(buf);
+    }
+}
+
+// static
+SortStage::SortableMember SortStage::SortableMember::deserializeForSorter(
+    BufReader& buf, const SorterDeserializeSettings&) {
+    SortableMember out;
+    out._recordId = RecordId::deserializeForSorter(buf, RecordId::SorterDeserializeSettings());
+    out._sequence = buf.read<LittleEndian<long long>>();
+    out._obj.setValue(BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings()));
+    out._computed = buf.read<char>();
+    if (out._computed & kTextScore) {
+        out._textScore = buf.read<LittleEndian<double>>();
+    }
+    if (out._computed & kGeoDistance) {
+        out._geoDistance = buf.read<LittleEndian<double>>();
+    }
+    if (out._computed & kIndexKey) {
+        out._indexKey =
+            BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings());
+    }
+    if (out._computed & kGeoNearPoint) {
+        out._geoNearPoint =
+            BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings());
+    }
+    if (out._computed & kSortKey) {
+        out._sortKey = BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings());
+    }
+    return out;
+}
+
+int SortStage::SortableMember::memUsageForSorter() const {
+    return sizeof(SortableMember) + _obj.value().objsize() + _indexKey.objsize() +
+        _geoNearPoint.objsize() + _sortKey.objsize();
+}
+
+SortStage::SortableMember SortStage::SortableMember::getOwned() const {
+    SortableMember out(*this);
+    out._obj.setValue(_obj.value().getOwned());
+    out._indexKey = _indexKey.getOwned();
+    out._geoNearPoint = _geoNearPoint.getOwned();
+    out._sortKey = _sortKey.getOwned();
+    return out;
+}
+
+int SortStage::SortableComparator::operator()(const SortableData& lhs,
+                                              const SortableData& rhs) const {
+    if (!lhs.first.isEmpty() && !rhs.first.isEmpty()) {
+        return lhs.first.compare(rhs.first);
+    }
 
-bool SortStage::WorkingSetComparator::operator()(const SortableDataItem& lhs,
-                                                 const SortableDataItem& rhs) const {
     // False means ignore field names.
-    int result = lhs.sortKey.woCompare(rhs.sortKey, pattern, false);
+    int result = lhs.second.sortKey().woCompare(rhs.second.sortKey(), _pattern, false);
     if (0 != result) {
-        return result < 0;
+        return result;
     }
     // Indices use RecordId as an additional sort key so we must as well.
-    return lhs.recordId < rhs.recordId;
+    return lhs.second.recordId().compare(rhs.second.recordId());
 }
 
 SortStage::SortStage(OperationContext* opCtx,
@@ -76,20 +258,28 @@ SortStage::SortStage(OperationContext* opCtx,
       _ws(ws),
       _pattern(params.pattern),
       _limit(params.limit),
+      _allowDiskUse(params.allowDiskUse && !storageGlobalParams.readOnly),
+      _sortKeyPattern(FindCommon::transformSortSpec(_pattern)),
+      _encodeSortKeys(canEncodeSortKeys(_pattern)),
+      _ordering(Ordering::make(_encodeSortKeys ? _sortKeyPattern : BSONObj())),
       _sorted(false),
-      _resultIterator(_data.end()),
       _memUsage(0) {
     _children.emplace_back(child);
 
-    BSONObj sortComparator = FindCommon::transformSortSpec(_pattern);
-    _sortKeyComparator = stdx::make_unique<WorkingSetComparator>(sortComparator);
-
-    // If limit > 1, we need to initialize _dataSet here to maintain ordered set of data items while
-    // fetching from the child stage.
-    if (_limit > 1) {
-        const WorkingSetComparator& cmp = *_sortKeyComparator;
-        _dataSet.reset(new SortableDataItemSet(cmp));
+    // Without disk use the memory limit is enforced by doWork(), which fails the query rather
+    // than have the Sorter throw.
+    SortOptions opts;
+    opts.limit = _limit;
+    opts.extSortAllowed = _allowDiskUse;
+    if (_allowDiskUse) {
+        opts.maxMemoryUsageBytes =
+            static_cast<size_t>(internalQueryExecMaxBlockingSortBytes.load());
+        opts.tempDir = storageGlobalParams.dbpath + "/_tmp";
+    } else {
+        opts.maxMemoryUsageBytes = std::numeric_limits<size_t>::max();
     }
+    _sorter.reset(Sorter<SortableKey, SortableMember>::make(
+        opts, SortableComparator(_sortKeyPattern)));
 }
 
 SortStage::~SortStage() {}
@@ -97,12 +287,22 @@ SortStage::~SortStage() {}
 bool SortStage::isEOF() {
     // We're done when our child has no more results, we've sorted the child's results, and
     // we've returned all sorted results.
-    return child()->isEOF() && _sorted && (_data.end() == _resultIterator);
+    return child()->isEOF() && _sorted && !_resultIterator->more();
+}
+
+SortStage::SortableKey SortStage::makeSortableKey(const SortableMember& member) const {
+    // A KeyString only has room for the type information of a key that fits in an index.
+    if (!_encodeSortKeys ||
+        member.sortKey().objsize() > static_cast<int>(KeyString::TypeBits::kMaxKeyBytes)) {
+        return SortableKey();
+    }
+    KeyString ks(KeyString::Version::V1, member.sortKey(), _ordering, member.recordId());
+    return SortableKey(std::string(ks.getBuffer(), ks.getSize()));
 }
 
 PlanStage::StageState SortStage::doWork(WorkingSetID* out) {
     const size_t maxBytes = static_cast<size_t>(internalQueryExecMaxBlockingSortBytes.load());
-    if (_memUsage > maxBytes) {
+    if (!_allowDiskUse && _memUsage > maxBytes) {
         bongoutils::str::stream ss;
         ss << "Sort operation used more than the maximum " << maxBytes
            << " bytes of RAM. Add an index, or specify a smaller limit.";
@@ -121,41 +321,29 @@ PlanStage::StageState SortStage::doWork(WorkingSetID* out) {
         StageState code = child()->work(&id);
 
         if (PlanStage::ADVANCED == code) {
-            // Add it into the map for quick invalidation if it has a valid RecordId.
-            // A RecordId may be invalidated at any time (during a yield).  We need to get into
-            // the WorkingSet as quickly as possible to handle it.
             WorkingSetMember* member = _ws->get(id);
 
             // Planner must put a fetch before we get here.
             verify(member->hasObj());
 
-            // We might be sorting something that was invalidated at some point.
-            if (member->hasRecordId()) {
-                _wsidByRecordId[member->recordId] = id;
-            }
-
-            SortableDataItem item;
-            item.wsid = id;
+            // The result outlives its WorkingSetMember, so take an owned copy of the object. We
+            // sort on the sort key in the WSM's computed data. This must have been generated by a
+            // SortKeyGeneratorStage descendent in the execution tree.
+            member->obj.setValue(member->obj.value().getOwned());
+            invariant(member->hasComputed(WSM_SORT_KEY));
+            SortableMember sortable(*member, _numBuffered++);
+            _ws->free(id);
 
-            // We extract the sort key from the WSM's computed data. This must have been generated
-            // by a SortKeyGeneratorStage descendent in the execution tree.
-            auto sortKeyComputedData =
-                static_cast<const SortKeyComputedData*>(member->getComputed(WSM_SORT_KEY));
-            item.sortKey = sortKeyComputedData->getSortKey();
-
-            if (member->hasRecordId()) {
-                // The RecordId breaks ties when sorting two WSMs with the same sort key.
-                item.recordId = member->recordId;
-            }
-
-            addToBuffer(item);
+            _sorter->add(makeSortableKey(sortable), sortable);
+            _memUsage = std::max(_memUsage, _sorter->memUsed());
 
             return PlanStage::NEED_TIME;
         } else if (PlanStage::IS_EOF == code) {
             // TODO: We don't need the lock for this.  We could ask for a yield and do this work
             // unlocked.  Also, this is performing a lot of work for one call to work(...)
-            sortBuffer();
-            _resultIterator = _data.begin();
+            _specificStats.usedDisk = _sorter->numFiles() > 0;
+            _resultIterator.reset(_sorter->done());
+            _sorter.reset();
             _sorted = true;
             return PlanStage::NEED_TIME;
         } else if (PlanStage::FAILURE == code || PlanStage::DEAD == code) {
@@ -177,18 +365,21 @@ PlanStage::StageState SortStage::doWork(WorkingSetID* out) {
         return code;
     }
 
-    // Returning results.
-    verify(_resultIterator != _data.end());
+    // Returning results. The result is only valid until the iterator is used again, so it is
+    // copied into a WorkingSetMember right away.
     verify(_sorted);
-    *out = _resultIterator->wsid;
-    _resultIterator++;
-
-    // If we're returning something, take it out of our DL -> WSID map so that future
-    // calls to invalidate don't cause us to take action for a DL we're done with.
-    WorkingSetMember* member = _ws->get(*out);
-    if (member->hasRecordId()) {
-        _wsidByRecordId.erase(member->recordId);
+    const SortableData data = _resultIterator->next();
+    bool dropRecordId = false;
+    if (!_invalidatedRecordIds.empty() && !data.second.recordId().isNull()) {
+        // The same RecordId may have been read again since it was invalidated, so the entry is
+        // kept for any other copy of it still to be returned.
+        auto it = _invalidatedRecordIds.find(data.second.recordId());
+        dropRecordId = it != _invalidatedRecordIds.end() && data.second.sequence() < it->second;
+        if (dropRecordId) {
+            ++_specificStats.forcedFetches;
+        }
     }
+    *out = data.second.allocateMember(_ws, dropRecordId);
 
     return PlanStage::ADVANCED;
 }
@@ -196,25 +387,11 @@ PlanStage::StageState SortStage::doWork(WorkingSetID* out) {
 void SortStage::doInvalidate(OperationContext* txn, const RecordId& dl, InvalidationType type) {
     // If we have a deletion, we can fetch and carry on.
     // If we have a mutation, it's easier to fetch and use the previous document.
-    // So, no matter what, fetch and keep the doc in play.
-
-    // _data contains indices into the WorkingSet, not actual data.  If a WorkingSetMember in
-    // the WorkingSet needs to change state as a result of a RecordId invalidation, it will still
-    // be at the same spot in the WorkingSet.  As such, we don't need to modify _data.
-    DataMap::iterator it = _wsidByRecordId.find(dl);
-
-    // If we're holding on to data that's got the RecordId we're invalidating...
-    if (_wsidByRecordId.end() != it) {
-        // Grab the WSM that we're nuking.
-        WorkingSetMember* member = _ws->get(it->second);
-        verify(member->recordId == dl);
-
-        WorkingSetCommon::fetchAndInvalidateRecordId(txn, member, _collection);
-
-        // Remove the RecordId from our set of active DLs.
-        _wsidByRecordId.erase(it);
-        ++_specificStats.forcedFetches;
-    }
+    // So, no matter what, keep the doc in play.
+    //
+    // Every buffered result already holds an owned copy of its object, so all that is left to do
+    // is forget the RecordId of the results buffered so far when they are returned.
+    _invalidatedRecordIds[dl] = _numBuffered;
 }
 
 unique_ptr<PlanStageStats> SortStage::getStats() {
@@ -235,109 +412,9 @@ const SpecificStats* SortStage::getSpecificStats() const {
     return &_specificStats;
 }
 
-/**
- * addToBuffer() and sortBuffer() work differently based on the
- * configured limit. addToBuffer() is also responsible for
- * performing some accounting on the overall memory usage to
- * make sure we're not using too much memory.
- *
- * limit == 0:
- *     addToBuffer() - Adds item to vector.
- *     sortBuffer() - Sorts vector.
- * limit == 1:
- *     addToBuffer() - Replaces first item in vector with max of
- *                     current and new item.
- *                     Updates memory usage if item was replaced.
- *     sortBuffer() - Does nothing.
- * limit > 1:
- *     addToBuffer() - Does not update vector. Adds item to set.
- *                     If size of set exceeds limit, remove item from set
- *                     with lowest key. Updates memory usage accordingly.
- *     sortBuffer() - Copies items from set to vectors.
- */
-void SortStage::addToBuffer(const SortableDataItem& item) {
-    // Holds ID of working set member to be freed at end of this function.
-    WorkingSetID wsidToFree = WorkingSet::INVALID_ID;
-
-    WorkingSetMember* member = _ws->get(item.wsid);
-    if (_limit == 0) {
-        // Ensure that the BSONObj underlying the WorkingSetMember is owned in case we yield.
-        member->makeObjOwnedIfNeeded();
-        _data.push_back(item);
-        _memUsage += member->getMemUsage();
-    } else if (_limit == 1) {
-        if (_data.empty()) {
-            member->makeObjOwnedIfNeeded();
-            _data.push_back(item);
-            _memUsage = member->getMemUsage();
-            return;
-        }
-        wsidToFree = item.wsid;
-        const WorkingSetComparator& cmp = *_sortKeyComparator;
-        // Compare new item with existing item in vector.
-        if (cmp(item, _data[0])) {
-            wsidToFree = _data[0].wsid;
-            member->makeObjOwnedIfNeeded();
-            _data[0] = item;
-            _memUsage = member->getMemUsage();
-        }
-    } else {
-        // Update data item set instead of vector
-        // Limit not reached - insert and return
-        vector<SortableDataItem>::size_type limit(_limit);
-        if (_dataSet->size() < limit) {
-            member->makeObjOwnedIfNeeded();
-            _dataSet->insert(item);
-            _memUsage += member->getMemUsage();
-            return;
-        }
-        // Limit will be exceeded - compare with item with lowest key
-        // If new item does not have a lower key value than last item,
-        // do nothing.
-        wsidToFree = item.wsid;
-        SortableDataItemSet::const_iterator lastItemIt = --(_dataSet->end());
-        const SortableDataItem& lastItem = *lastItemIt;
-        const WorkingSetComparator& cmp = *_sortKeyComparator;
-        if (cmp(item, lastItem)) {
-            _memUsage -= _ws->get(lastItem.wsid)->getMemUsage();
-            _memUsage += member->getMemUsage();
-            wsidToFree = lastItem.wsid;
-            // According to std::set iterator validity rules,
-            // it does not matter which of erase()/insert() happens first.
-            // Here, we choose to erase first to release potential resources
-            // used by the last item and to keep the scope of the iterator to a minimum.
-            _dataSet->erase(lastItemIt);
-            member->makeObjOwnedIfNeeded();
-            _dataSet->insert(item);
-        }
-    }
-
-    // If the working set ID is valid, remove from
-    // RecordId invalidation map and free from working set.
-    if (wsidToFree != WorkingSet::INVALID_ID) {
-        WorkingSetMember* member = _ws->get(wsidToFree);
-        if (member->hasRecordId()) {
-            _wsidByRecordId.erase(member->recordId);
-        }
-        _ws->free(wsidToFree);
-    }
-}
-
-void SortStage::sortBuffer() {
-    if (_limit == 0) {
-        const WorkingSetComparator& cmp = *_sortKeyComparator;
-        std::sort(_data.begin(), _data.end(), cmp);
-    } else if (_limit == 1) {
-        // Buffer contains either 0 or 1 item so it is already in a sorted state.
-        return;
-    } else {
-        // Set already contains items in sorted order, so we simply copy the items
-        // from the set to the vector.
-        // Release the memory for the set after the copy.
-        vector<SortableDataItem> newData(_dataSet->begin(), _dataSet->end());
-        _data.swap(newData);
-        _dataSet.reset();
-    }
-}
-
 }  // namespace bongo
+
+#include "bongo/db/sorter/sorter.cpp"
+BONGO_CREATE_SORTER(bongo::SortStage::SortableKey,
+                    bongo::SortStage::SortableMember,
+                    bongo::SortStage::SortableComparator);
@@ -28,25 +28,27 @@
 
 #pragma once
 
-#include <set>
-#include <vector>
+#include <string>
+#include <utility>
 
 #include "bongo/db/exec/plan_stage.h"
 #include "bongo/db/exec/sort_key_generator.h"
 #include "bongo/db/exec/working_set.h"
 #include "bongo/db/jsobj.h"
-#include "bongo/db/query/index_bounds.h"
 #include "bongo/db/record_id.h"
+#include "bongo/db/sorter/sorter.h"
+#include "bongo/db/storage/snapshot.h"
 #include "bongo/platform/unordered_map.h"
 
 namespace bongo {
 
 class BtreeKeyGenerator;
+class BufReader;
 
 // Parameters that must be provided to a SortStage
 class SortStageParams {
 public:
-    SortStageParams() : collection(NULL), limit(0) {}
+    SortStageParams() : collection(NULL), limit(0), allowDiskUse(false) {}
 
     // Used for resolving RecordIds to BSON
     const Collection* collection;
@@ -56,11 +58,20 @@ public:
 
     // Equal to 0 for no limit.
     size_t limit;
+
+    // Whether the sort may spill to temporary files once it holds more than
+    // internalQueryExecMaxBlockingSortBytes, rather than fail.
+    bool allowDiskUse;
 };
 
 /**
  * Sorts the input received from the child according to the sort pattern provided.
  *
+ * The results are buffered in a Sorter, which keeps only the best 'limit' of them when there is a
+ * limit, and which writes sorted runs to temporary files and merges them at the end when the
+ * buffered results outgrow the memory limit and 'allowDiskUse' is set. The results are compared on
+ * a KeyString encoding of their sort key.
+ *
  * Preconditions:
  *   -- For each field in 'pattern', all inputs in the child must handle a getFieldDotted for that
  *   field.
@@ -89,7 +100,129 @@ public:
 
     static const char* kStageType;
 
+    /**
+     * The sort key of a buffered result in a form that orders with a single memcmp(): the
+     * KeyString encoding of the sort key followed by the result's RecordId, which breaks ties the
+     * way an index would. Empty when the sort key cannot be encoded, in which case the results are
+     * compared on their BSON sort keys instead.
+     */
+    class SortableKey {
+    public:
+        struct SorterDeserializeSettings {};
+
+        SortableKey() = default;
+        explicit SortableKey(std::string encoded) : _encoded(std::move(encoded)) {}
+
+        bool isEmpty() const {
+            return _encoded.empty();
+        }
+
+        /**
+         * Compares with the semantics of memcmp(). Neither key may be empty.
+         */
+        int compare(const SortableKey& other) const;
+
+        void serializeForSorter(BufBuilder& buf) const;
+        static SortableKey deserializeForSorter(BufReader& buf, const SorterDeserializeSettings&);
+        int memUsageForSorter() const {
+            return sizeof(SortableKey) + _encoded.capacity();
+        }
+        SortableKey getOwned() const {
+            return *this;
+        }
+
+    private:
+        std::string _encoded;
+    };
+
+    /**
+     * What a WorkingSetMember carries through the sort, held outside of the WorkingSet so that the
+     * Sorter can buffer it and spill it to disk.
+     */
+    class SortableMember {
+    public:
+        struct SorterDeserializeSettings {};
+
+        SortableMember() = default;
+
+        /**
+         * Copies the RecordId, object and computed data of 'member', which must have an object.
+         * 'sequence' is the number of members the sort stage buffered before this one.
+         */
+        SortableMember(const WorkingSetMember& member, long long sequence);
+
+        /**
+         * Allocates a member of 'ws' holding an owned copy of everything copied into this one,
+         * less the RecordId if 'dropRecordId' is set.
+         */
+        WorkingSetID allocateMember(WorkingSet* ws, bool dropRecordId) const;
+
+        const RecordId& recordId() const {
+            return _recordId;
+        }
+        long long sequence() const {
+            return _sequence;
+        }
+        const BSONObj& sortKey() const {
+            return _sortKey;
+        }
+
+        /**
+         * The snapshot the object was read in is not written out, so that a member read back
+         * from disk looks to a later update or delete as if it had been read in an older one.
+         */
+        void serializeForSorter(BufBuilder& buf) const;
+        static SortableMember deserializeForSorter(BufReader& buf,
+                                                   const SorterDeserializeSettings&);
+        int memUsageForSorter() const;
+        SortableMember getOwned() const;
+
+    private:
+        // Bits of '_computed' saying which computed data the member had.
+        static const int kTextScore = 1 << WSM_COMPUTED_TEXT_SCORE;
+        static const int kGeoDistance = 1 << WSM_COMPUTED_GEO_DISTANCE;
+        static const int kIndexKey = 1 << WSM_INDEX_KEY;
+        static const int kGeoNearPoint = 1 << WSM_GEO_NEAR_POINT;
+        static const int kSortKey = 1 << WSM_SORT_KEY;
+
+        RecordId _recordId;
+        long long _sequence = 0;
+        Snapshotted<BSONObj> _obj;
+
+        int _computed = 0;
+        double _textScore = 0;
+        double _geoDistance = 0;
+        BSONObj _indexKey;
+        BSONObj _geoNearPoint;
+        BSONObj _sortKey;
+    };
+
+    typedef std::pair<SortableKey, SortableMember> SortableData;
+
+    /**
+     * Orders buffered results on their encoded sort keys, or on their BSON sort keys and then
+     * their RecordIds when either encoded key is empty. The two agree, as a KeyString orders the
+     * way BSONObj::woCompare() does.
+     *
+     * We are comparing keys generated by the SortKeyGenerator, which are already ordered with
+     * respect the collation. Therefore, we explicitly avoid comparing using a collator here.
+     */
+    class SortableComparator {
+    public:
+        explicit SortableComparator(BSONObj pattern) : _pattern(std::move(pattern)) {}
+
+        int operator()(const SortableData& lhs, const SortableData& rhs) const;
+
+    private:
+        BSONObj _pattern;
+    };
+
 private:
+    /**
+     * Returns the encoded sort key for 'member', or an empty key if it cannot be encoded.
+     */
+    SortableKey makeSortableKey(const SortableMember& member) const;
+
     //
     // Query Stage
     //
@@ -106,77 +239,42 @@ private:
     // Equal to 0 for no limit.
     size_t _limit;
 
+    // Whether the sorter may spill to disk instead of failing once it exceeds the memory limit.
+    bool _allowDiskUse;
+
     //
     // Data storage
     //
 
-    // Have we sorted our data? If so, we can access _resultIterator. If not,
-    // we're still populating _data.
-    bool _sorted;
+    // The sort pattern with directions for $meta fields, used to compare BSON sort keys.
+    BSONObj _sortKeyPattern;
 
-    // Collection of working set members to sort with their respective sort key.
-    struct SortableDataItem {
-        WorkingSetID wsid;
-        BSONObj sortKey;
-        // Since we must replicate the behavior of a covered sort as much as possible we use the
-        // RecordId to break sortKey ties.
-        // See sorta.js.
-        RecordId recordId;
-    };
+    // Whether sort keys are encoded as KeyStrings. False when the pattern sorts on a $meta field,
+    // whose sort key element is named, or has too many fields to describe with an Ordering.
+    bool _encodeSortKeys;
+    Ordering _ordering;
 
-    // Comparison object for data buffers (vector and set). Items are compared on (sortKey, loc).
-    // This is also how the items are ordered in the indices. Keys are compared using
-    // BSONObj::woCompare() with RecordId as a tie-breaker.
-    //
-    // We are comparing keys generated by the SortKeyGenerator, which are already ordered with
-    // respect the collation. Therefore, we explicitly avoid comparing using a collator here.
-    struct WorkingSetComparator {
-        explicit WorkingSetComparator(BSONObj p);
+    // Have we sorted our data? If so, we can access _resultIterator. If not,
+    // we're still populating _sorter.
+    bool _sorted;
 
-        bool operator()(const SortableDataItem& lhs, const SortableDataItem& rhs) const;
+    // Buffers the results until the child is EOF. Released once the results are sorted.
+    std::unique_ptr<Sorter<SortableKey, SortableMember>> _sorter;
 
-        BSONObj pattern;
-    };
+    // Iterates through the sorted results.
+    std::unique_ptr<SortIteratorInterface<SortableKey, SortableMember>> _resultIterator;
 
-    /**
-     * Inserts one item into data buffer (vector or set).
-     * If limit is exceeded, remove item with lowest key.
-     */
-    void addToBuffer(const SortableDataItem& item);
+    // How many results have been buffered, used as the sequence number of the next one.
+    long long _numBuffered = 0;
 
-    /**
-     * Sorts data buffer.
-     * Assumes no more items will be added to buffer.
-     * If data is stored in set, copy set
-     * contents to vector and clear set.
-     */
-    void sortBuffer();
-
-    // Comparator for data buffer
-    // Initialization follows sort key generator
-    std::unique_ptr<WorkingSetComparator> _sortKeyComparator;
-
-    // The data we buffer and sort.
-    // _data will contain sorted data when all data is gathered
-    // and sorted.
-    // When _limit is greater than 1 and not all data has been gathered from child stage,
-    // _dataSet is used instead to maintain an ordered set of the incomplete data set.
-    // When the data set is complete, we copy the items from _dataSet to _data which will
-    // be used to provide the results of this stage through _resultIterator.
-    std::vector<SortableDataItem> _data;
-    typedef std::set<SortableDataItem, WorkingSetComparator> SortableDataItemSet;
-    std::unique_ptr<SortableDataItemSet> _dataSet;
-
-    // Iterates through _data post-sort returning it.
-    std::vector<SortableDataItem>::iterator _resultIterator;
-
-    // We buffer a lot of data and we want to look it up by RecordId quickly upon invalidation.
-    typedef unordered_map<RecordId, WorkingSetID, RecordId::Hasher> DataMap;
-    DataMap _wsidByRecordId;
+    // The number of results buffered when each RecordId was last invalidated. A result buffered
+    // before then is returned without its RecordId, as its object was copied when it was buffered.
+    // One buffered after then was read again since, so it keeps its RecordId.
+    unordered_map<RecordId, long long, RecordId::Hasher> _invalidatedRecordIds;
 
     SortStats _specificStats;
 
-    // The usage in bytes of all buffered data that we're sorting.
+    // The most memory in bytes that the data buffered for sorting has used.
     size_t _memUsage;
 };
 
@@ -0,0 +1,171 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kQuery
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/exec/sort.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "bongo/db/exec/plan_stats.h"
+#include "bongo/db/exec/working_set_computed_data.h"
+#include "bongo/db/operation_context_noop.h"
+#include "bongo/db/query/query_knobs.h"
+#include "bongo/db/service_context_noop.h"
+#include "bongo/db/storage/storage_options.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/unittest/temp_dir.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/log.h"
+#include "bongo/util/processinfo.h"
+#include "bongo/util/scopeguard.h"
+#include "bongo/util/timer.h"
+
+namespace {
+
+using namespace bongo;
+
+const int kNumDocs = 1000 * 1000;
+
+// Sorted runs are spilled once this much memory is buffered.
+const int kMaxBlockingSortBytes = 4 * 1024 * 1024;
+
+/**
+ * Produces 'numDocs' documents of the form {a: <int>, pad: <string>} in a scrambled order of
+ * 'a', along with the sort keys a SortKeyGeneratorStage would compute for the pattern {a: 1}.
+ */
+class GeneratorStage final : public PlanStage {
+public:
+    GeneratorStage(OperationContext* opCtx, WorkingSet* ws, int numDocs)
+        : PlanStage("GENERATOR", opCtx), _ws(ws), _numDocs(numDocs), _pad(64, 'x') {}
+
+    StageState doWork(WorkingSetID* out) final {
+        if (isEOF()) {
+            return PlanStage::IS_EOF;
+        }
+        const int a = static_cast<int>((_next++ * 7919LL) % _numDocs);
+
+        *out = _ws->allocate();
+        WorkingSetMember* member = _ws->get(*out);
+        member->obj = Snapshotted<BSONObj>(SnapshotId(), BSON("a" << a << "pad" << _pad));
+        member->addComputed(new SortKeyComputedData(BSON("" << a)));
+        _ws->transitionToOwnedObj(*out);
+        return PlanStage::ADVANCED;
+    }
+
+    bool isEOF() final {
+        return _next >= _numDocs;
+    }
+
+    StageType stageType() const final {
+        return STAGE_QUEUED_DATA;
+    }
+
+    std::unique_ptr<PlanStageStats> getStats() final {
+        return stdx::make_unique<PlanStageStats>(_commonStats, STAGE_QUEUED_DATA);
+    }
+
+    const SpecificStats* getSpecificStats() const final {
+        return nullptr;
+    }
+
+private:
+    WorkingSet* _ws;
+    const int _numDocs;
+    const std::string _pad;
+    int _next = 0;
+};
+
+/**
+ * Sorts 'kNumDocs' documents on {a: 1}, keeping at most 'limit' of them, and reports the sort
+ * rate along with the memory the sort stage and the process used.
+ */
+void runSort(long long limit) {
+    auto service = stdx::make_unique<ServiceContextNoop>();
+    auto client = service->makeClient("sort_perf_test");
+    OperationContextNoop opCtx(client.get(), 0);
+
+    unittest::TempDir tempDir("sort_perf_test");
+    const std::string oldDbPath = storageGlobalParams.dbpath;
+    const int oldMaxBytes = internalQueryExecMaxBlockingSortBytes.load();
+    ON_BLOCK_EXIT([oldDbPath, oldMaxBytes] {
+        storageGlobalParams.dbpath = oldDbPath;
+        internalQueryExecMaxBlockingSortBytes.store(oldMaxBytes);
+    });
+    storageGlobalParams.dbpath = tempDir.path();
+    internalQueryExecMaxBlockingSortBytes.store(kMaxBlockingSortBytes);
+
+    WorkingSet ws;
+    SortStageParams params;
+    params.pattern = BSON("a" << 1);
+    params.limit = limit;
+    params.allowDiskUse = true;
+    SortStage sort(&opCtx, params, &ws, new GeneratorStage(&opCtx, &ws, kNumDocs));
+
+    Timer timer;
+    long long numResults = 0;
+    int expected = 0;
+    WorkingSetID id = WorkingSet::INVALID_ID;
+    PlanStage::StageState state = PlanStage::NEED_TIME;
+    while (state != PlanStage::IS_EOF) {
+        state = sort.work(&id);
+        ASSERT_NOT_EQUALS(state, PlanStage::FAILURE);
+        if (state == PlanStage::ADVANCED) {
+            ASSERT_EQ(ws.get(id)->obj.value()["a"].numberInt(), expected++);
+            ws.free(id);
+            ++numResults;
+        }
+    }
+    const long long micros = timer.micros();
+
+    ASSERT_EQ(numResults, limit ? std::min(limit, static_cast<long long>(kNumDocs)) : kNumDocs);
+    const auto stats = sort.getStats();
+    const auto sortStats = static_cast<const SortStats*>(stats->specific.get());
+    log() << "THROUGHPUT limit " << limit << ": "
+          << kNumDocs * 1000000LL / std::max(micros, 1LL) << " docs/sec, "
+          << sortStats->memUsage / (1024 * 1024) << "MB peak sort memory, usedDisk: "
+          << sortStats->usedDisk << ", " << ProcessInfo().getResidentSize() << "MB resident";
+}
+
+TEST(SortStagePerf, FullSortSpillsToDisk) {
+    runSort(0);
+}
+
+TEST(SortStagePerf, TopOne) {
+    runSort(1);
+}
+
+TEST(SortStagePerf, TopHundred) {
+    runSort(100);
+}
+
+}  // namespace
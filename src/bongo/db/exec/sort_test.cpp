@@ -37,11 +37,15 @@
 #include "bongo/db/operation_context_noop.h"
 #include "bongo/db/query/collation/collator_factory_mock.h"
 #include "bongo/db/query/collation/collator_interface_mock.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/service_context.h"
 #include "bongo/db/service_context_noop.h"
+#include "bongo/db/storage/storage_options.h"
 #include "bongo/stdx/memory.h"
+#include "bongo/unittest/temp_dir.h"
 #include "bongo/unittest/unittest.h"
 #include "bongo/util/clock_source_mock.h"
+#include "bongo/util/scopeguard.h"
 
 using namespace bongo;
 
@@ -157,6 +161,29 @@ public:
         }
     }
 
+    /**
+     * Returns a sort stage over 'numDocs' documents of the form {a: <int>, pad: <string>}, in
+     * which 'a' takes every value in [0, numDocs) exactly once.
+     */
+    std::unique_ptr<SortStage> makeSortOverManyDocs(WorkingSet* ws,
+                                                    const SortStageParams& params,
+                                                    int numDocs) {
+        auto queuedDataStage = stdx::make_unique<QueuedDataStage>(getOpCtx(), ws);
+        const std::string pad(100, 'x');
+        for (int i = 0; i < numDocs; ++i) {
+            WorkingSetID id = ws->allocate();
+            WorkingSetMember* wsm = ws->get(id);
+            BSONObj obj = BSON("a" << (i * 7919) % numDocs << "pad" << pad);
+            wsm->obj = Snapshotted<BSONObj>(SnapshotId(), obj);
+            wsm->transitionToOwnedObj();
+            queuedDataStage->pushBack(id);
+        }
+
+        auto sortKeyGen = stdx::make_unique<SortKeyGeneratorStage>(
+            getOpCtx(), queuedDataStage.release(), ws, params.pattern, BSONObj(), nullptr);
+        return stdx::make_unique<SortStage>(getOpCtx(), params, ws, sortKeyGen.release());
+    }
+
 private:
     OperationContext* _opCtx;
 
@@ -319,4 +346,102 @@ TEST_F(SortStageTest, SortDescendingWithCollation) {
              "{input: [{a: 'ba'}, {a: 'aa'}, {a: 'ab'}]}",
              "{output: [{a: 'ab'}, {a: 'ba'}, {a: 'aa'}]}");
 }
+
+//
+// Sorting more data than the memory limit allows
+//
+
+TEST_F(SortStageTest, SortFailsAboveMemoryLimitWithoutDiskUse) {
+    const int oldMaxBytes = internalQueryExecMaxBlockingSortBytes.load();
+    ON_BLOCK_EXIT([oldMaxBytes] { internalQueryExecMaxBlockingSortBytes.store(oldMaxBytes); });
+    internalQueryExecMaxBlockingSortBytes.store(16 * 1024);
+
+    WorkingSet ws;
+    SortStageParams params;
+    params.pattern = BSON("a" << 1);
+    auto sort = makeSortOverManyDocs(&ws, params, 1000);
+
+    WorkingSetID id = WorkingSet::INVALID_ID;
+    PlanStage::StageState state = PlanStage::NEED_TIME;
+    while (state == PlanStage::NEED_TIME) {
+        state = sort->work(&id);
+    }
+    ASSERT_EQUALS(state, PlanStage::FAILURE);
+}
+
+TEST_F(SortStageTest, SortSpillsToDiskWhenAllowed) {
+    unittest::TempDir tempDir("sort_stage_test");
+    const std::string oldDbPath = storageGlobalParams.dbpath;
+    const int oldMaxBytes = internalQueryExecMaxBlockingSortBytes.load();
+    ON_BLOCK_EXIT([oldDbPath, oldMaxBytes] {
+        storageGlobalParams.dbpath = oldDbPath;
+        internalQueryExecMaxBlockingSortBytes.store(oldMaxBytes);
+    });
+    storageGlobalParams.dbpath = tempDir.path();
+    internalQueryExecMaxBlockingSortBytes.store(16 * 1024);
+
+    const int numDocs = 1000;
+    WorkingSet ws;
+    SortStageParams params;
+    params.pattern = BSON("a" << -1);
+    params.allowDiskUse = true;
+    auto sort = makeSortOverManyDocs(&ws, params, numDocs);
+
+    WorkingSetID id = WorkingSet::INVALID_ID;
+    PlanStage::StageState state = PlanStage::NEED_TIME;
+    int expected = numDocs - 1;
+    while (state != PlanStage::IS_EOF) {
+        state = sort->work(&id);
+        ASSERT_NOT_EQUALS(state, PlanStage::FAILURE);
+        if (state == PlanStage::ADVANCED) {
+            // Results read back from disk keep their sort key for a merging sort above us.
+            WorkingSetMember* member = ws.get(id);
+            ASSERT_TRUE(member->hasComputed(WSM_SORT_KEY));
+            ASSERT_EQUALS(member->obj.value()["a"].numberInt(), expected);
+            --expected;
+            ws.free(id);
+        }
+    }
+    ASSERT_EQUALS(expected, -1);
+
+    auto stats = static_cast<const SortStats*>(sort->getSpecificStats());
+    ASSERT_TRUE(stats->usedDisk);
+}
+
+TEST_F(SortStageTest, SortWithLimitStaysInMemoryWhenDiskUseAllowed) {
+    unittest::TempDir tempDir("sort_stage_test");
+    const std::string oldDbPath = storageGlobalParams.dbpath;
+    const int oldMaxBytes = internalQueryExecMaxBlockingSortBytes.load();
+    ON_BLOCK_EXIT([oldDbPath, oldMaxBytes] {
+        storageGlobalParams.dbpath = oldDbPath;
+        internalQueryExecMaxBlockingSortBytes.store(oldMaxBytes);
+    });
+    storageGlobalParams.dbpath = tempDir.path();
+    internalQueryExecMaxBlockingSortBytes.store(16 * 1024);
+
+    WorkingSet ws;
+    SortStageParams params;
+    params.pattern = BSON("a" << 1);
+    params.limit = 5;
+    params.allowDiskUse = true;
+    auto sort = makeSortOverManyDocs(&ws, params, 1000);
+
+    WorkingSetID id = WorkingSet::INVALID_ID;
+    PlanStage::StageState state = PlanStage::NEED_TIME;
+    int expected = 0;
+    while (state != PlanStage::IS_EOF) {
+        state = sort->work(&id);
+        ASSERT_NOT_EQUALS(state, PlanStage::FAILURE);
+        if (state == PlanStage::ADVANCED) {
+            ASSERT_EQUALS(ws.get(id)->obj.value()["a"].numberInt(), expected);
+            ++expected;
+            ws.free(id);
+        }
+    }
+    ASSERT_EQUALS(expected, 5);
+
+    // Only the top five results are ever kept.
+    auto stats = static_cast<const SortStats*>(sort->getSpecificStats());
+    ASSERT_FALSE(stats->usedDisk);
+}
 }  // namespace
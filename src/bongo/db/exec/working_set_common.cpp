@@ -207,4 +207,27 @@ std::string WorkingSetCommon::toStatusString(const BSONObj& obj) {
     return status.toString();
 }
 
+void WorkingSetBatchObjCopier::add(WorkingSetID id) {
+    const BSONObj& obj = _workingSet->get(id)->obj.value();
+    if (obj.isOwned()) {
+        return;
+    }
+    _copies.emplace_back(id, _buffer.len());
+    _buffer.appendBuf(obj.objdata(), obj.objsize());
+}
+
+void WorkingSetBatchObjCopier::done() {
+    if (_copies.empty()) {
+        return;
+    }
+
+    ConstSharedBuffer buffer = _buffer.release();
+    for (auto&& copy : _copies) {
+        BSONObj obj(buffer.get() + copy.second);
+        obj.shareOwnershipWith(buffer);
+        _workingSet->get(copy.first)->obj.setValue(obj);
+    }
+    _copies.clear();
+}
+
 }  // namespace bongo
@@ -28,6 +28,10 @@
 
 #pragma once
 
+#include <utility>
+#include <vector>
+
+#include "bongo/bson/util/builder.h"
 #include "bongo/db/exec/working_set.h"
 #include "bongo/util/unowned_ptr.h"
 
@@ -133,4 +137,35 @@ public:
     static std::string toStatusString(const BSONObj& obj);
 };
 
+/**
+ * Collects the documents of a batch of working set members produced by a stage's doWorkBatch().
+ *
+ * A record cursor only guarantees the document it returned last, so a stage that reads a batch of
+ * documents from one must copy each of them before moving the cursor on. This copies them back to
+ * back into a single buffer, rather than into an allocation per document, and points the members
+ * at the copies once the batch is complete.
+ */
+class WorkingSetBatchObjCopier {
+    BONGO_DISALLOW_COPYING(WorkingSetBatchObjCopier);
+
+public:
+    explicit WorkingSetBatchObjCopier(WorkingSet* workingSet) : _workingSet(workingSet) {}
+
+    /**
+     * Copies the object of member 'id' unless it is already owned. The member must be left alone
+     * until done() is called.
+     */
+    void add(WorkingSetID id);
+
+    /**
+     * Makes the objects of all members passed to add() refer to their copies.
+     */
+    void done();
+
+private:
+    WorkingSet* const _workingSet;
+    BufBuilder _buffer{0};
+    std::vector<std::pair<WorkingSetID, int>> _copies;  // Member and offset of its copy.
+};
+
 }  // namespace bongo
@@ -0,0 +1,223 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/matcher/compiled_match_expression.h"
+
+#include <cmath>
+
+#include "bongo/db/matcher/expression_leaf.h"
+
+namespace bongo {
+
+namespace {
+
+/**
+ * Returns true if 'expr' matches a document exactly when it matches the value of its field, for
+ * documents in which that field does not hold an array.
+ */
+bool isFieldPredicate(const MatchExpression* expr) {
+    switch (expr->matchType()) {
+        case MatchExpression::EQ:
+        case MatchExpression::LT:
+        case MatchExpression::LTE:
+        case MatchExpression::GT:
+        case MatchExpression::GTE:
+        case MatchExpression::REGEX:
+        case MatchExpression::MOD:
+        case MatchExpression::EXISTS:
+        case MatchExpression::MATCH_IN:
+        case MatchExpression::BITS_ALL_SET:
+        case MatchExpression::BITS_ALL_CLEAR:
+        case MatchExpression::BITS_ANY_SET:
+        case MatchExpression::BITS_ANY_CLEAR: {
+            const StringData path = static_cast<const LeafMatchExpression*>(expr)->path();
+            return !path.empty() && path.find('.') == std::string::npos;
+        }
+        default:
+            return false;
+    }
+}
+
+template <typename T>
+bool compareValues(MatchExpression::MatchType matchType, const T& lhs, const T& rhs) {
+    switch (matchType) {
+        case MatchExpression::LT:
+            return lhs < rhs;
+        case MatchExpression::LTE:
+            return lhs <= rhs;
+        case MatchExpression::EQ:
+            return lhs == rhs;
+        case MatchExpression::GT:
+            return lhs > rhs;
+        case MatchExpression::GTE:
+            return lhs >= rhs;
+        default:
+            BONGO_UNREACHABLE;
+    }
+}
+
+}  // namespace
+
+CompiledMatchExpression::CompiledMatchExpression(const MatchExpression* expr) : _expr(expr) {
+    if (_expr) {
+        compile(_expr);
+    }
+}
+
+void CompiledMatchExpression::compile(const MatchExpression* expr) {
+    if (MatchExpression::AND == expr->matchType()) {
+        for (size_t i = 0; i < expr->numChildren(); ++i) {
+            compile(expr->getChild(i));
+        }
+        return;
+    }
+
+    if (!isFieldPredicate(expr) || _predicates.size() == kMaxFieldPredicates) {
+        _residuals.push_back(expr);
+        return;
+    }
+
+    FieldPredicate pred;
+    pred.expr = static_cast<const LeafMatchExpression*>(expr);
+    pred.fieldName = pred.expr->path();
+    pred.specialization = Specialization::kNone;
+
+    if (ComparisonMatchExpression::isComparisonMatchExpression(expr)) {
+        const auto* comparison = static_cast<const ComparisonMatchExpression*>(expr);
+        const BSONElement& rhs = comparison->getData();
+        switch (rhs.type()) {
+            case NumberInt:
+                pred.specialization = Specialization::kInt;
+                pred.intValue = rhs._numberInt();
+                break;
+            case NumberLong:
+                pred.specialization = Specialization::kLong;
+                pred.longValue = rhs._numberLong();
+                break;
+            case NumberDouble:
+                // NaN only compares equal to NaN, which the generic comparison handles.
+                if (!std::isnan(rhs._numberDouble())) {
+                    pred.specialization = Specialization::kDouble;
+                    pred.doubleValue = rhs._numberDouble();
+                }
+                break;
+            case String:
+                // Strings are compared binarily unless there is a collator.
+                if (!comparison->getCollator()) {
+                    pred.specialization = Specialization::kString;
+                    pred.stringValue = rhs.valueStringData();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    _predicates.push_back(pred);
+}
+
+bool CompiledMatchExpression::matchesBSON(const BSONObj& doc) const {
+    if (!_predicates.empty()) {
+        // Only the first occurrence of a field counts, as with BSONObj::getField().
+        uint64_t seen = 0;
+        const uint64_t allSeen = _predicates.size() == kMaxFieldPredicates
+            ? ~uint64_t(0)
+            : (uint64_t(1) << _predicates.size()) - 1;
+
+        BSONObjIterator it(doc);
+        while (seen != allSeen && it.more()) {
+            const BSONElement elt = it.next();
+            const StringData fieldName = elt.fieldNameStringData();
+            for (size_t i = 0; i < _predicates.size(); ++i) {
+                const uint64_t bit = uint64_t(1) << i;
+                if ((seen & bit) || _predicates[i].fieldName != fieldName) {
+                    continue;
+                }
+                seen |= bit;
+                if (!matchesFieldPredicate(_predicates[i], elt, doc)) {
+                    return false;
+                }
+            }
+        }
+
+        // Predicates on missing fields are evaluated against EOO, as the generic path does.
+        for (size_t i = 0; seen != allSeen && i < _predicates.size(); ++i) {
+            if (!(seen & (uint64_t(1) << i)) && !_predicates[i].expr->matchesSingleElement({})) {
+                return false;
+            }
+        }
+    }
+
+    for (const MatchExpression* residual : _residuals) {
+        if (!residual->matchesBSON(doc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompiledMatchExpression::matchesFieldPredicate(const FieldPredicate& pred,
+                                                    const BSONElement& elt,
+                                                    const BSONObj& doc) {
+    if (Array == elt.type()) {
+        // Let the generic path expand the array.
+        return pred.expr->matchesBSON(doc);
+    }
+
+    const MatchExpression::MatchType matchType = pred.expr->matchType();
+    switch (pred.specialization) {
+        case Specialization::kInt:
+            if (NumberInt == elt.type()) {
+                return compareValues(matchType, elt._numberInt(), pred.intValue);
+            }
+            break;
+        case Specialization::kLong:
+            if (NumberLong == elt.type()) {
+                return compareValues(matchType, elt._numberLong(), pred.longValue);
+            }
+            break;
+        case Specialization::kDouble:
+            if (NumberDouble == elt.type() && !std::isnan(elt._numberDouble())) {
+                return compareValues(matchType, elt._numberDouble(), pred.doubleValue);
+            }
+            break;
+        case Specialization::kString:
+            if (String == elt.type()) {
+                return compareValues(matchType, elt.valueStringData().compare(pred.stringValue), 0);
+            }
+            break;
+        case Specialization::kNone:
+            break;
+    }
+
+    return pred.expr->matchesSingleElement(elt);
+}
+
+}  // namespace bongo
@@ -0,0 +1,117 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/base/string_data.h"
+#include "bongo/bson/bsonobj.h"
+#include "bongo/db/matcher/expression.h"
+
+namespace bongo {
+
+class LeafMatchExpression;
+
+/**
+ * A MatchExpression flattened for matching whole BSON documents.
+ *
+ * The conjuncts of the expression that are simple predicates on top-level fields, such as {a: 5}
+ * or {b: {$gte: "x"}}, are evaluated together in one pass over the document's fields, instead of
+ * through an ElementIterator per predicate. A predicate only takes the generic path, which expands
+ * arrays, for documents in which its field holds an array. Comparisons against a number or string
+ * skip the type dispatch of ComparisonMatchExpression when the field has the same type. The
+ * remaining conjuncts are evaluated with MatchExpression::matchesBSON().
+ */
+class CompiledMatchExpression {
+    BONGO_DISALLOW_COPYING(CompiledMatchExpression);
+
+public:
+    /**
+     * 'expr' must outlive the CompiledMatchExpression, and must not be modified while it is in
+     * use. A null 'expr' matches every document.
+     */
+    explicit CompiledMatchExpression(const MatchExpression* expr);
+
+    /**
+     * Returns the same result as 'expr'->matchesBSON('doc').
+     */
+    bool matchesBSON(const BSONObj& doc) const;
+
+    const MatchExpression* getExpression() const {
+        return _expr;
+    }
+
+    /**
+     * Returns the number of predicates that are evaluated in the pass over the document's fields.
+     */
+    size_t numFieldPredicates() const {
+        return _predicates.size();
+    }
+
+private:
+    // The value types for which a comparison has its own code.
+    enum class Specialization { kNone, kInt, kLong, kDouble, kString };
+
+    struct FieldPredicate {
+        StringData fieldName;
+        const LeafMatchExpression* expr;
+        Specialization specialization;
+
+        // The operand of a specialized comparison.
+        union {
+            int intValue;
+            long long longValue;
+            double doubleValue;
+        };
+        StringData stringValue;
+    };
+
+    // A bit per field predicate records which ones have seen their field.
+    static const size_t kMaxFieldPredicates = 64;
+
+    void compile(const MatchExpression* expr);
+
+    /**
+     * Evaluates 'pred' against 'elt', the value of its field in 'doc'.
+     */
+    static bool matchesFieldPredicate(const FieldPredicate& pred,
+                                      const BSONElement& elt,
+                                      const BSONObj& doc);
+
+    const MatchExpression* const _expr;
+
+    std::vector<FieldPredicate> _predicates;
+
+    // Conjuncts evaluated with MatchExpression::matchesBSON().
+    std::vector<const MatchExpression*> _residuals;
+};
+
+}  // namespace bongo
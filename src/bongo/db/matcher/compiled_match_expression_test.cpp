@@ -0,0 +1,191 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include <limits>
+
+#include "bongo/db/json.h"
+#include "bongo/db/matcher/compiled_match_expression.h"
+#include "bongo/db/matcher/expression_parser.h"
+#include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
+#include "bongo/db/query/collation/collator_interface_mock.h"
+#include "bongo/unittest/unittest.h"
+
+namespace bongo {
+namespace {
+
+std::unique_ptr<MatchExpression> parse(const BSONObj& query,
+                                       const CollatorInterface* collator = nullptr) {
+    auto statusWithMatcher =
+        MatchExpressionParser::parse(query, ExtensionsCallbackDisallowExtensions(), collator);
+    ASSERT_OK(statusWithMatcher.getStatus());
+    return std::move(statusWithMatcher.getValue());
+}
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+std::vector<BSONObj> testDocuments() {
+    return {BSONObj(),
+            BSON("a" << 5),
+            BSON("a" << 5LL),
+            BSON("a" << 5.0),
+            BSON("a" << 5.5),
+            BSON("a" << 4),
+            BSON("a" << 6),
+            BSON("a" << -1),
+            BSON("a" << kNaN),
+            BSON("a"
+                 << "x"),
+            BSON("a"
+                 << "xyz"),
+            BSON("a"
+                 << "X"),
+            BSON("a" << BSONNULL),
+            BSON("a" << BSONUndefined),
+            BSON("a" << BSON_ARRAY(1 << 5 << 9)),
+            BSON("a" << BSON_ARRAY(BSON_ARRAY(5))),
+            BSON("a" << BSONArray()),
+            BSON("a" << BSON("b" << 5)),
+            BSON("a" << true),
+            BSON("a" << MINKEY),
+            BSON("a" << MAXKEY),
+            BSON("b" << 5 << "a" << 5),
+            BSON("a" << 4 << "a" << 5),
+            BSON("a" << 5 << "b"
+                     << "x"),
+            BSON("a" << 5 << "b" << BSON_ARRAY("x"
+                                               << "y")),
+            BSON("a" << 6 << "b"
+                     << "y"
+                     << "c"
+                     << 1)};
+}
+
+std::vector<BSONObj> testQueries() {
+    return {BSONObj(),
+            fromjson("{a: 5}"),
+            fromjson("{a: NumberLong(5)}"),
+            fromjson("{a: 5.0}"),
+            fromjson("{a: {$lt: 5}}"),
+            fromjson("{a: {$lte: 5}}"),
+            fromjson("{a: {$gt: 5}}"),
+            fromjson("{a: {$gte: 5.5}}"),
+            fromjson("{a: {$gt: NumberLong(4)}}"),
+            BSON("a" << kNaN),
+            BSON("a" << BSON("$lte" << kNaN)),
+            fromjson("{a: 'x'}"),
+            fromjson("{a: {$gte: 'x'}}"),
+            fromjson("{a: {$lt: 'xz'}}"),
+            fromjson("{a: null}"),
+            fromjson("{a: {$gte: null}}"),
+            fromjson("{a: {$lt: {$maxKey: 1}}}"),
+            fromjson("{a: {$gt: {$minKey: 1}}}"),
+            fromjson("{a: [5]}"),
+            fromjson("{a: {b: 5}}"),
+            fromjson("{a: {$exists: true}}"),
+            fromjson("{a: {$exists: false}}"),
+            fromjson("{a: {$in: [4, 'x', null]}}"),
+            fromjson("{a: {$mod: [2, 1]}}"),
+            fromjson("{a: /^x/}"),
+            fromjson("{a: {$bitsAllSet: 4}}"),
+            fromjson("{a: {$gt: 4, $lt: 6}}"),
+            fromjson("{a: 5, b: 'x'}"),
+            fromjson("{b: 'y', a: {$gte: 5}, c: {$exists: false}}"),
+            fromjson("{$and: [{a: {$gte: 5}}, {$and: [{b: {$exists: true}}]}]}"),
+            fromjson("{$or: [{a: 5}, {b: 'x'}]}"),
+            fromjson("{a: 5, $or: [{b: 'x'}, {c: 1}]}"),
+            fromjson("{'a.b': 5}"),
+            fromjson("{a: {$size: 3}}"),
+            fromjson("{a: {$elemMatch: {$gt: 4}}}"),
+            fromjson("{a: {$not: {$gt: 5}}}"),
+            fromjson("{a: {$type: 'string'}}")};
+}
+
+TEST(CompiledMatchExpression, NullExpressionMatchesEverything) {
+    CompiledMatchExpression compiled(nullptr);
+    for (auto&& doc : testDocuments()) {
+        ASSERT_TRUE(compiled.matchesBSON(doc));
+    }
+}
+
+TEST(CompiledMatchExpression, MatchesLikeExpression) {
+    for (auto&& query : testQueries()) {
+        auto expr = parse(query);
+        CompiledMatchExpression compiled(expr.get());
+        ASSERT_EQUALS(expr.get(), compiled.getExpression());
+        for (auto&& doc : testDocuments()) {
+            ASSERT_EQUALS(expr->matchesBSON(doc), compiled.matchesBSON(doc))
+                << "query: " << query << ", document: " << doc;
+        }
+    }
+}
+
+TEST(CompiledMatchExpression, MatchesLikeExpressionWithCollator) {
+    CollatorInterfaceMock collator(CollatorInterfaceMock::MockType::kToLowerString);
+    for (auto&& query : testQueries()) {
+        auto expr = parse(query, &collator);
+        CompiledMatchExpression compiled(expr.get());
+        for (auto&& doc : testDocuments()) {
+            ASSERT_EQUALS(expr->matchesBSON(doc), compiled.matchesBSON(doc))
+                << "query: " << query << ", document: " << doc;
+        }
+    }
+}
+
+TEST(CompiledMatchExpression, FlattensTopLevelFieldPredicates) {
+    const BSONObj query = fromjson("{$and: [{a: 1, b: {$gt: 2}}, {c: {$in: [1, 2]}}], 'd.e': 1}");
+    auto expr = parse(query);
+    CompiledMatchExpression compiled(expr.get());
+    ASSERT_EQUALS(3U, compiled.numFieldPredicates());
+
+    const BSONObj orQuery = fromjson("{$or: [{a: 1}, {b: 1}]}");
+    auto orExpr = parse(orQuery);
+    ASSERT_EQUALS(0U, CompiledMatchExpression(orExpr.get()).numFieldPredicates());
+}
+
+TEST(CompiledMatchExpression, ManyFieldPredicates) {
+    BSONObjBuilder queryBuilder;
+    BSONObjBuilder docBuilder;
+    for (int i = 0; i < 80; ++i) {
+        queryBuilder.append(str::stream() << "f" << i, BSON("$gte" << i));
+        docBuilder.append(str::stream() << "f" << (79 - i), 79 - i);
+    }
+    const BSONObj query = queryBuilder.obj();
+    auto expr = parse(query);
+    CompiledMatchExpression compiled(expr.get());
+    ASSERT_EQUALS(64U, compiled.numFieldPredicates());
+
+    const BSONObj doc = docBuilder.obj();
+    ASSERT_TRUE(compiled.matchesBSON(doc));
+    ASSERT_FALSE(compiled.matchesBSON(doc.removeField("f70")));
+    ASSERT_FALSE(compiled.matchesBSON(doc.removeField("f3")));
+}
+
+}  // namespace
+}  // namespace bongo
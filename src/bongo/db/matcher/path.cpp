@@ -39,6 +39,12 @@ Status ElementPath::init(StringData path) {
     _shouldTraverseNonleafArrays = true;
     _shouldTraverseLeafArray = true;
     _fieldRef.parse(path);
+
+    _partLocators.clear();
+    _partLocators.reserve(_fieldRef.numParts());
+    for (size_t i = 0; i < _fieldRef.numParts(); ++i) {
+        _partLocators.emplace_back(_fieldRef.getPart(i));
+    }
     return Status::OK();
 }
 
@@ -191,7 +197,8 @@ bool BSONElementIterator::more() {
 
     if (_state == BEGIN) {
         size_t idxPath = 0;
-        BSONElement e = getFieldDottedOrArray(_context, _path->fieldRef(), &idxPath);
+        BSONElement e = getFieldDottedOrArray(
+            _context, _path->fieldRef(), _path->partLocators(), &idxPath);
 
         if (e.type() != Array) {
             _next.reset(e, BSONElement(), false);
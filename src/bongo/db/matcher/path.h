@@ -30,16 +30,24 @@
 
 #pragma once
 
+#include <vector>
 
+#include "bongo/base/disallow_copying.h"
 #include "bongo/base/status.h"
 #include "bongo/base/string_data.h"
+#include "bongo/bson/bson_field_locator.h"
 #include "bongo/bson/bsonobj.h"
 #include "bongo/db/field_ref.h"
 
 namespace bongo {
 
 class ElementPath {
+    // The locators refer to the parts of '_fieldRef', so a copy would leave them dangling.
+    BONGO_DISALLOW_COPYING(ElementPath);
+
 public:
+    ElementPath() = default;
+
     Status init(StringData path);
 
     void setTraverseNonleafArrays(bool b) {
@@ -52,6 +60,14 @@ public:
     const FieldRef& fieldRef() const {
         return _fieldRef;
     }
+
+    /**
+     * One locator per part of fieldRef(), so that each document is searched without preparing
+     * the field names again.
+     */
+    const std::vector<BSONFieldLocator>& partLocators() const {
+        return _partLocators;
+    }
     bool shouldTraverseNonleafArrays() const {
         return _shouldTraverseNonleafArrays;
     }
@@ -61,6 +77,7 @@ public:
 
 private:
     FieldRef _fieldRef;
+    std::vector<BSONFieldLocator> _partLocators;
     bool _shouldTraverseNonleafArrays;
     bool _shouldTraverseLeafArray;
 };
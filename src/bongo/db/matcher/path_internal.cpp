@@ -40,7 +40,13 @@ bool isAllDigits(StringData str) {
     return true;
 }
 
-BSONElement getFieldDottedOrArray(const BSONObj& doc, const FieldRef& path, size_t* idxPath) {
+namespace {
+
+template <typename GetPart>
+BSONElement getFieldDottedOrArrayImpl(const BSONObj& doc,
+                                      const FieldRef& path,
+                                      size_t* idxPath,
+                                      const GetPart& getPart) {
     if (path.numParts() == 0)
         return doc.getField("");
 
@@ -50,7 +56,7 @@ BSONElement getFieldDottedOrArray(const BSONObj& doc, const FieldRef& path, size
     bool stop = false;
     size_t partNum = 0;
     while (partNum < path.numParts() && !stop) {
-        res = curr.getField(path.getPart(partNum));
+        res = getPart(curr, partNum);
 
         switch (res.type()) {
             case EOO:
@@ -78,5 +84,25 @@ BSONElement getFieldDottedOrArray(const BSONObj& doc, const FieldRef& path, size
     return res;
 }
 
+}  // namespace
+
+BSONElement getFieldDottedOrArray(const BSONObj& doc, const FieldRef& path, size_t* idxPath) {
+    return getFieldDottedOrArrayImpl(
+        doc, path, idxPath, [&path](const BSONObj& obj, size_t partNum) {
+            return obj.getField(path.getPart(partNum));
+        });
+}
+
+BSONElement getFieldDottedOrArray(const BSONObj& doc,
+                                  const FieldRef& path,
+                                  const std::vector<BSONFieldLocator>& partLocators,
+                                  size_t* idxPath) {
+    invariant(partLocators.size() == path.numParts());
+    return getFieldDottedOrArrayImpl(
+        doc, path, idxPath, [&partLocators](const BSONObj& obj, size_t partNum) {
+            return partLocators[partNum].find(obj);
+        });
+}
+
 
 }  // namespace bongo
@@ -31,8 +31,10 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include "bongo/base/string_data.h"
+#include "bongo/bson/bson_field_locator.h"
 #include "bongo/db/field_ref.h"
 #include "bongo/db/jsobj.h"
 
@@ -44,4 +46,13 @@ bool isAllDigits(StringData str);
 // Replaces getFieldDottedOrArray without recursion nor std::string manipulation
 BSONElement getFieldDottedOrArray(const BSONObj& doc, const FieldRef& path, size_t* idxPath);
 
+/**
+ * Same as above, but looks up each part of 'path' with the matching entry of 'partLocators',
+ * which must hold one locator per part.
+ */
+BSONElement getFieldDottedOrArray(const BSONObj& doc,
+                                  const FieldRef& path,
+                                  const std::vector<BSONFieldLocator>& partLocators,
+                                  size_t* idxPath);
+
 }  // namespace bongo
@@ -265,6 +265,7 @@ static WriteResult::SingleResult createIndex(OperationContext* txn,
     rpc::CommandReplyBuilder cmdReplyBuilder;
     Command::findCommand("createIndexes")->run(txn, cmdRequest, &cmdReplyBuilder);
     auto cmdReplyMsg = cmdReplyBuilder.done();
+    cmdReplyMsg.flatten();
     rpc::CommandReply cmdReply(&cmdReplyMsg);
     auto cmdResult = cmdReply.getCommandReply();
     uassertStatusOK(getStatusFromCommandResult(cmdResult));
@@ -163,6 +163,23 @@ private:
 
 class AccumulatorSum final : public Accumulator {
 public:
+    /**
+     * The running total of a $sum. It is kept apart from the accumulator so that GroupHashTable
+     * can store it inline for each group.
+     */
+    struct State {
+        /**
+         * Adds 'input' to the total if it is numeric, widening the type of the total as needed.
+         */
+        void add(const Value& input);
+
+        Value getValue(bool toBeMerged) const;
+
+        BSONType totalType = NumberInt;
+        DoubleDoubleSummation nonDecimalTotal;
+        Decimal128 decimalTotal;
+    };
+
     explicit AccumulatorSum(const boost::intrusive_ptr<ExpressionContext>& expCtx);
 
     void processInternal(const Value& input, bool merging) final;
@@ -182,9 +199,7 @@ public:
     }
 
 private:
-    BSONType totalType = NumberInt;
-    DoubleDoubleSummation nonDecimalTotal;
-    Decimal128 decimalTotal;
+    State _state;
 };
 
 
@@ -251,6 +266,30 @@ private:
 
 class AccumulatorAvg final : public Accumulator {
 public:
+    /**
+     * The running total and count of an $avg, kept apart from the accumulator for the same reason
+     * as AccumulatorSum::State.
+     */
+    struct State {
+        /**
+         * Adds 'input' to the total and counts it if it is numeric.
+         */
+        void add(const Value& input);
+
+        Value getValue(bool toBeMerged) const;
+
+        /**
+         * The total of all values is partitioned between those that are decimals, and those that
+         * are not decimals, so the decimal total needs to add the non-decimal.
+         */
+        Decimal128 getDecimalTotal() const;
+
+        bool isDecimal = false;
+        DoubleDoubleSummation nonDecimalTotal;
+        Decimal128 decimalTotal;
+        long long count = 0;
+    };
+
     explicit AccumulatorAvg(const boost::intrusive_ptr<ExpressionContext>& expCtx);
 
     void processInternal(const Value& input, bool merging) final;
@@ -262,16 +301,7 @@ public:
         const boost::intrusive_ptr<ExpressionContext>& expCtx);
 
 private:
-    /**
-     * The total of all values is partitioned between those that are decimals, and those that are
-     * not decimals, so the decimal total needs to add the non-decimal.
-     */
-    Decimal128 _getDecimalTotal() const;
-
-    bool _isDecimal;
-    DoubleDoubleSummation _nonDecimalTotal;
-    Decimal128 _decimalTotal;
-    long long _count;
+    State _state;
 };
 
 
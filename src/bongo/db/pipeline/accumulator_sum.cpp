@@ -55,16 +55,9 @@ const char subTotalErrorName[] = "subTotalError";  // Used for extra precision.
 }  // namespace
 
 
-void AccumulatorSum::processInternal(const Value& input, bool merging) {
-    if (!input.numeric()) {
-        if (merging && input.getType() == Object) {
-            // Process merge document, see getValue() below.
-            nonDecimalTotal.addDouble(
-                input[subTotalName].getDouble());              // Sum without adjusting type.
-            processInternal(input[subTotalErrorName], false);  // Sum adjusting for type of error.
-        }
+void AccumulatorSum::State::add(const Value& input) {
+    if (!input.numeric())
         return;
-    }
 
     // Upgrade to the widest type required to hold the result.
     totalType = Value::getWidestNumeric(totalType, input.getType());
@@ -84,12 +77,30 @@ void AccumulatorSum::processInternal(const Value& input, bool merging) {
     }
 }
 
+void AccumulatorSum::processInternal(const Value& input, bool merging) {
+    if (!input.numeric()) {
+        if (merging && input.getType() == Object) {
+            // Process merge document, see getValue() below.
+            _state.nonDecimalTotal.addDouble(
+                input[subTotalName].getDouble());  // Sum without adjusting type.
+            _state.add(input[subTotalErrorName]);  // Sum adjusting for type of error.
+        }
+        return;
+    }
+
+    _state.add(input);
+}
+
 intrusive_ptr<Accumulator> AccumulatorSum::create(
     const boost::intrusive_ptr<ExpressionContext>& expCtx) {
     return new AccumulatorSum(expCtx);
 }
 
 Value AccumulatorSum::getValue(bool toBeMerged) const {
+    return _state.getValue(toBeMerged);
+}
+
+Value AccumulatorSum::State::getValue(bool toBeMerged) const {
     switch (totalType) {
         case NumberInt:
             if (nonDecimalTotal.fitsLong())
@@ -141,8 +152,6 @@ AccumulatorSum::AccumulatorSum(const boost::intrusive_ptr<ExpressionContext>& ex
 }
 
 void AccumulatorSum::reset() {
-    totalType = NumberInt;
-    nonDecimalTotal = {};
-    decimalTotal = {};
+    _state = {};
 }
 }  // namespace bongo
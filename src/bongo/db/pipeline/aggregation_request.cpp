@@ -55,6 +55,7 @@ const StringData AggregationRequest::kCollationName = "collation"_sd;
 const StringData AggregationRequest::kExplainName = "explain"_sd;
 const StringData AggregationRequest::kAllowDiskUseName = "allowDiskUse"_sd;
 const StringData AggregationRequest::kHintName = "hint"_sd;
+const StringData AggregationRequest::kParallelismName = "parallelism"_sd;
 
 const long long AggregationRequest::kDefaultBatchSize = 101;
 
@@ -132,6 +133,19 @@ StatusWith<AggregationRequest> AggregationRequest::parseFromBSON(NamespaceString
                                   << " must be specified as a string representing an index"
                                   << " name, or an object representing an index's key pattern");
             }
+        } else if (kParallelismName == fieldName) {
+            if (!elem.isNumber()) {
+                return {ErrorCodes::TypeMismatch,
+                        str::stream() << kParallelismName << " must be a number, not a "
+                                      << typeName(elem.type())};
+            }
+            const long long parallelism = elem.safeNumberLong();
+            if (parallelism <= 0) {
+                return {ErrorCodes::BadValue,
+                        str::stream() << kParallelismName << " must be positive, not "
+                                      << elem.number()};
+            }
+            request.setParallelism(parallelism);
         } else if (kExplainName == fieldName) {
             if (elem.type() != BSONType::Bool) {
                 return {ErrorCodes::TypeMismatch,
@@ -191,7 +205,9 @@ Document AggregationRequest::serializeToCommandObj() const {
         // Only serialize batchSize when explain is false.
         {kCursorName, _explain ? Value() : Value(Document{{kBatchSizeName, _batchSize}})},
         // Only serialize a hint if one was specified.
-        {kHintName, _hint.isEmpty() ? Value() : Value(_hint)}};
+        {kHintName, _hint.isEmpty() ? Value() : Value(_hint)},
+        // Only serialize parallelism if different than its default.
+        {kParallelismName, _parallelism == 1 ? Value() : Value(_parallelism)}};
 }
 
 }  // namespace bongo
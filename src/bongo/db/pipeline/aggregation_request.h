@@ -55,6 +55,7 @@ public:
     static const StringData kExplainName;
     static const StringData kAllowDiskUseName;
     static const StringData kHintName;
+    static const StringData kParallelismName;
 
     static const long long kDefaultBatchSize;
 
@@ -124,6 +125,15 @@ public:
         return _hint;
     }
 
+    /**
+     * The number of threads the user would like the leading stages of the pipeline to be run
+     * with. This is a hint: it is 1 unless specified, and is ignored when the pipeline cannot be
+     * run in parallel.
+     */
+    long long getParallelism() const {
+        return _parallelism;
+    }
+
     //
     // Setters for optional fields.
     //
@@ -144,6 +154,11 @@ public:
         _hint = hint.getOwned();
     }
 
+    void setParallelism(long long parallelism) {
+        uassert(40396, "parallelism must be positive", parallelism > 0);
+        _parallelism = parallelism;
+    }
+
     void setExplain(bool isExplain) {
         _explain = isExplain;
     }
@@ -181,6 +196,8 @@ private:
     // {$hint: <String>}, where <String> is the index name hinted.
     BSONObj _hint;
 
+    long long _parallelism = 1;
+
     bool _explain = false;
     bool _allowDiskUse = false;
     bool _fromRouter = false;
@@ -45,6 +45,18 @@ using std::vector;
 const DocumentStorage DocumentStorage::kEmptyDoc;
 
 Position DocumentStorage::findField(StringData requested) const {
+    Position pos = findFieldInBuffer(requested);
+    if (pos.found() || _bson.isEmpty())
+        return pos;
+
+    // The field may be in the backing BSON and not looked up yet.
+    BSONElement elem = _bson[requested];
+    if (elem.eoo())
+        return Position();
+    return const_cast<DocumentStorage*>(this)->cacheBsonField(elem);
+}
+
+Position DocumentStorage::findFieldInBuffer(StringData requested) const {
     int reqSize = requested.size();  // get size calculation out of the way if needed
 
     if (_numFields >= HASH_TAB_MIN) {  // hash lookup
@@ -61,9 +73,9 @@ Position DocumentStorage::findField(StringData requested) const {
             pos = elem.nextCollision;
         }
     } else {  // linear scan
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+        for (const ValueElement* it = _firstElement; it != end(); it = it->next()) {
             if (it->nameLen == reqSize && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
-                return it.position();
+                return Position(it->ptr() - _buffer);
             }
         }
     }
@@ -72,7 +84,34 @@ Position DocumentStorage::findField(StringData requested) const {
     return Position();
 }
 
+Position DocumentStorage::findCachedBsonField(const BSONElement& elem) const {
+    if (_numFields == 0)
+        return Position();
+
+    // Only the first of several fields with the same name is ever looked up, so the offset tells
+    // whether this is the field that was.
+    const Position pos = findFieldInBuffer(elem.fieldNameStringData());
+    if (!pos.found() || getField(pos).bsonOffset != elem.rawdata() - _bson.objdata())
+        return Position();
+    return pos;
+}
+
+Position DocumentStorage::cacheBsonField(const BSONElement& elem) {
+    if (!_buffer)
+        reserveBsonFields();
+
+    const Position pos =
+        appendElement(elem.fieldNameStringData(), elem.rawdata() - _bson.objdata());
+    elementAt(pos).val = Value(elem);
+    return pos;
+}
+
 Value& DocumentStorage::appendField(StringData name) {
+    _modified = true;
+    return elementAt(appendElement(name, ValueElement::kInserted)).val;
+}
+
+Position DocumentStorage::appendElement(StringData name, int bsonOffset) {
     Position pos = getNextPosition();
     const int nameSize = name.size();
 
@@ -80,10 +119,11 @@ Value& DocumentStorage::appendField(StringData name) {
     const Position nextCollision;
     const Value value;
 
-    // Make room for new field (and padding at end for alignment)
+    // Make room for new field (and padding at end for alignment). Fields are cached while someone
+    // may be holding on to a reference into the buffer, so it must outlive a move.
     const unsigned newUsed = ValueElement::align(_usedBytes + sizeof(ValueElement) + nameSize);
     if (_buffer + newUsed > _bufferEnd)
-        alloc(newUsed);
+        alloc(newUsed, bsonOffset != ValueElement::kInserted);
     _usedBytes = newUsed;
 
     // Append structure of a ValueElement
@@ -93,6 +133,7 @@ Value& DocumentStorage::appendField(StringData name) {
     dest += sizeof(x)
     append(value);
     append(nextCollision);
+    append(bsonOffset);
     append(nameSize);
     name.copyTo(dest, true);
 // Padding for alignment handled above
@@ -110,12 +151,12 @@ Value& DocumentStorage::appendField(StringData name) {
         rehash();
     }
 
-    return getField(pos).val;
+    return pos;
 }
 
 // Call after adding field to _fields and increasing _numFields
 void DocumentStorage::addFieldToHashTable(Position pos) {
-    ValueElement& elem = getField(pos);
+    ValueElement& elem = elementAt(pos);
     elem.nextCollision = Position();
 
     const unsigned bucket = bucketForKey(elem.nameSD());
@@ -123,15 +164,16 @@ void DocumentStorage::addFieldToHashTable(Position pos) {
     Position* posPtr = &_hashTab[bucket];
     while (posPtr->found()) {
         // collision: walk links and add new to end
-        posPtr = &getField(*posPtr).nextCollision;
+        posPtr = &elementAt(*posPtr).nextCollision;
     }
     *posPtr = Position(pos.index);
 }
 
-void DocumentStorage::alloc(unsigned newSize) {
+void DocumentStorage::alloc(unsigned newSize, bool retainOldBuffer) {
     const bool firstAlloc = !_buffer;
     const bool doingRehash = needRehash();
     const size_t oldCapacity = _bufferEnd - _buffer;
+    const size_t oldAllocatedBytes = allocatedBytes();
 
     // make new bucket count big enough
     while (needRehash() || hashTabBuckets() < HASH_TAB_INIT_SIZE)
@@ -161,9 +203,33 @@ void DocumentStorage::alloc(unsigned newSize) {
                 memcpy(_hashTab, oldBuf.get() + oldCapacity, hashTabBytes());
             }
         }
+
+        if (retainOldBuffer) {
+            _oldBuffers.push_back(std::move(oldBuf));
+            _oldBuffersBytes += oldAllocatedBytes;
+        }
     }
 }
 
+void DocumentStorage::reserveBsonFields() {
+    fassert(40397, !_buffer);
+
+    size_t numFields = 0;
+    unsigned newSize = 0;
+    BSONForEach(elem, _bson) {
+        ++numFields;
+        newSize =
+            ValueElement::align(newSize + sizeof(ValueElement) + elem.fieldNameStringData().size());
+    }
+
+    unsigned buckets = HASH_TAB_INIT_SIZE;
+    while (buckets < numFields)
+        buckets *= 2;
+    _hashTabMask = buckets - 1;
+
+    alloc(newSize);
+}
+
 void DocumentStorage::reserveFields(size_t expectedFields) {
     fassert(16487, !_buffer);
 
@@ -197,12 +263,14 @@ intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
     out->_usedBytes = _usedBytes;
     out->_numFields = _numFields;
     out->_hashTabMask = _hashTabMask;
+    out->_bson = _bson;
+    out->_modified = _modified;
     out->_metaFields = _metaFields;
     out->_textScore = _textScore;
     out->_randVal = _randVal;
 
     // Tell values that they have been memcpyed (updates ref counts)
-    for (DocumentStorageIterator it = out->iteratorAll(); !it.atEnd(); it.advance()) {
+    for (ValueElement* it = out->_firstElement; it != out->end(); it = it->next()) {
         it->val.memcpyed();
     }
 
@@ -212,21 +280,66 @@ intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
 DocumentStorage::~DocumentStorage() {
     std::unique_ptr<char[]> deleteBufferAtScopeEnd(_buffer);
 
-    for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+    for (ValueElement* it = _firstElement; it != end(); it = it->next()) {
         it->val.~Value();  // explicit destructor call
     }
 }
 
-Document::Document(const BSONObj& bson) {
-    MutableDocument md(bson.nFields());
+size_t DocumentStorage::getApproximateSize() const {
+    size_t size = sizeof(DocumentStorage);
+    size += allocatedBytes();
+    size += _oldBuffersBytes;
+    size += _bson.objsize();
 
-    BSONObjIterator it(bson);
-    while (it.more()) {
-        BSONElement bsonElement(it.next());
-        md.addField(bsonElement.fieldNameStringData(), Value(bsonElement));
+    for (const ValueElement* it = _firstElement; it != end(); it = it->next()) {
+        size += it->val.getApproximateSize();
+        size -= sizeof(Value);  // already accounted for above
     }
 
-    *this = md.freeze();
+    return size;
+}
+
+DocumentStorageIterator::DocumentStorageIterator(const DocumentStorage& storage)
+    : _storage(&storage), _bsonIt(storage._bson), _insertedOffset(0) {
+    advance();
+}
+
+StringData DocumentStorageIterator::fieldName() const {
+    // Names in the backing BSON stay put even if the buffer moves.
+    return _bsonElement.eoo() ? _storage->getField(_cached).nameSD()
+                              : _bsonElement.fieldNameStringData();
+}
+
+Value DocumentStorageIterator::value() const {
+    return _cached.found() ? _storage->getField(_cached).val : Value(_bsonElement);
+}
+
+void DocumentStorageIterator::advance() {
+    while (_bsonIt.more()) {
+        _bsonElement = _bsonIt.next();
+        _cached = _storage->findCachedBsonField(_bsonElement);
+        if (!_cached.found() || !_storage->getField(_cached).val.missing())
+            return;
+    }
+    _bsonElement = BSONElement();
+
+    // Positions are used rather than pointers, since looking up a field while iterating may move
+    // the buffer.
+    while (_insertedOffset < _storage->_usedBytes) {
+        _cached = Position(_insertedOffset);
+        const ValueElement& elem = _storage->getField(_cached);
+        _insertedOffset =
+            ValueElement::align(_insertedOffset + sizeof(ValueElement) + elem.nameLen);
+        if (elem.bsonOffset == ValueElement::kInserted && !elem.val.missing())
+            return;
+    }
+    _cached = Position();
+}
+
+Document::Document(const BSONObj& bson) {
+    if (!bson.isEmpty()) {
+        _storage.reset(new DocumentStorage(bson.getOwned()));
+    }
 }
 
 Document::Document(std::initializer_list<std::pair<StringData, ImplicitValue>> initializerList) {
@@ -247,12 +360,26 @@ BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d
 }
 
 void Document::toBson(BSONObjBuilder* pBuilder) const {
+    if (!storage().isModified()) {
+        pBuilder->appendElements(storage().bson());
+        return;
+    }
+
+    // Fields that were never looked up, including whole subdocuments, are copied verbatim.
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
-        *pBuilder << it->nameSD() << it->val;
+        if (BSONElement elem = it.uncachedBsonElement()) {
+            pBuilder->append(elem);
+        } else {
+            *pBuilder << it.fieldName() << it.value();
+        }
     }
 }
 
 BSONObj Document::toBson() const {
+    if (!storage().isModified() && !storage().bson().isEmpty()) {
+        return storage().bson();
+    }
+
     BSONObjBuilder bb;
     toBson(&bb);
     return bb.obj();
@@ -272,6 +399,20 @@ BSONObj Document::toBsonWithMetaData() const {
 }
 
 Document Document::fromBsonWithMetaData(const BSONObj& bson) {
+    // Most documents carry no metadata, and can be backed by their BSON as they are.
+    bool hasMetaData = false;
+    BSONForEach(elem, bson) {
+        auto fieldName = elem.fieldNameStringData();
+        if (fieldName[0] == '$' &&
+            (fieldName == metaFieldTextScore || fieldName == metaFieldRandVal)) {
+            hasMetaData = true;
+            break;
+        }
+    }
+    if (!hasMetaData) {
+        return Document(bson);
+    }
+
     MutableDocument md;
 
     BSONObjIterator it(bson);
@@ -363,23 +504,15 @@ size_t Document::getApproximateSize() const {
     if (!_storage)
         return 0;  // we've allocated no memory
 
-    size_t size = sizeof(DocumentStorage);
-    size += storage().allocatedBytes();
-
-    for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
-        size += it->val.getApproximateSize();
-        size -= sizeof(Value);  // already accounted for above
-    }
-
-    return size;
+    return storage().getApproximateSize();
 }
 
 void Document::hash_combine(size_t& seed,
                             const StringData::ComparatorInterface* stringComparator) const {
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
-        StringData name = it->nameSD();
+        StringData name = it.fieldName();
         boost::hash_range(seed, name.rawData(), name.rawData() + name.size());
-        it->val.hash_combine(seed, stringComparator);
+        it.value().hash_combine(seed, stringComparator);
     }
 }
 
@@ -400,21 +533,21 @@ int Document::compare(const Document& rL,
         if (rIt.atEnd())
             return 1;  // right document is shorter
 
-        const ValueElement& rField = rIt.get();
-        const ValueElement& lField = lIt.get();
+        const Value rValue = rIt.value();
+        const Value lValue = lIt.value();
 
         // For compatibility with BSONObj::woCompare() consider the canonical type of values
         // before considerting their names.
-        const int rCType = canonicalizeBSONType(rField.val.getType());
-        const int lCType = canonicalizeBSONType(lField.val.getType());
+        const int rCType = canonicalizeBSONType(rValue.getType());
+        const int lCType = canonicalizeBSONType(lValue.getType());
         if (lCType != rCType)
             return lCType < rCType ? -1 : 1;
 
-        const int nameCmp = lField.nameSD().compare(rField.nameSD());
+        const int nameCmp = lIt.fieldName().compare(rIt.fieldName());
         if (nameCmp)
             return nameCmp;  // field names are unequal
 
-        const int valueCmp = Value::compare(lField.val, rField.val, stringComparator);
+        const int valueCmp = Value::compare(lValue, rValue, stringComparator);
         if (valueCmp)
             return valueCmp;  // fields are unequal
 
@@ -431,7 +564,7 @@ string Document::toString() const {
     const char* prefix = "{";
 
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
-        out << prefix << it->nameSD() << ": " << it->val.toString();
+        out << prefix << it.fieldName() << ": " << it.value().toString();
         prefix = ", ";
     }
     out << '}';
@@ -444,8 +577,8 @@ void Document::serializeForSorter(BufBuilder& buf) const {
     buf.appendNum(numElems);
 
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
-        buf.appendStr(it->nameSD(), /*NUL byte*/ true);
-        it->val.serializeForSorter(buf);
+        buf.appendStr(it.fieldName(), /*NUL byte*/ true);
+        it.value().serializeForSorter(buf);
     }
 
     if (hasTextScore()) {
@@ -64,6 +64,11 @@ class Position;
  *  pass and return by Value. Note that the data in a Document is
  *  immutable, but you can replace a Document instance with assignment.
  *
+ *  A Document backed by a BSONObj converts its fields into Values the first
+ *  time they are looked up, which changes its storage even through const
+ *  methods. Copies of a Document share that storage, so they must not be
+ *  read from more than one thread at a time.
+ *
  *  See Also: Value class in Value.h
  */
 class Document {
@@ -93,7 +98,10 @@ public:
     /// Empty Document (does no allocation)
     Document() {}
 
-    /// Create a new Document deep-converted from the given BSONObj.
+    /**
+     * Create a new Document backed by (an owned copy of) the given BSONObj. Its fields are only
+     * converted into Values as they are looked up.
+     */
     explicit Document(const BSONObj& bson);
 
     /**
@@ -583,7 +591,7 @@ public:
     Document::FieldPair next() {
         verify(more());
 
-        Document::FieldPair fp(_it->nameSD(), _it->val);
+        Document::FieldPair fp(_it.fieldName(), _it.value());
         _it.advance();
         return fp;
     }
@@ -32,8 +32,11 @@
 
 #include <bitset>
 #include <boost/intrusive_ptr.hpp>
+#include <memory>
+#include <vector>
 
 #include "bongo/base/static_assert.h"
+#include "bongo/bson/bsonobj.h"
 #include "bongo/db/pipeline/value.h"
 #include "bongo/util/intrusive_counter.h"
 
@@ -78,8 +81,12 @@ class ValueElement {
     BONGO_DISALLOW_COPYING(ValueElement);
 
 public:
+    // The bsonOffset of a field that is not read from the backing BSON.
+    static const int kInserted = -1;
+
     Value val;
     Position nextCollision;  // Position of next field with same hashBucket
+    const int bsonOffset;    // offset of the field in the backing BSON, or kInserted
     const int nameLen;       // doesn't include '\0'
     const char _name[1];     // pointer to start of name (use nameSD instead)
 
@@ -124,61 +131,58 @@ private:
 };
 // Real size is sizeof(ValueElement) + nameLen
 #pragma pack()
-BONGO_STATIC_ASSERT(sizeof(ValueElement) == (sizeof(Value) + sizeof(Position) + sizeof(int) + 1));
+BONGO_STATIC_ASSERT(sizeof(ValueElement) ==
+                    (sizeof(Value) + sizeof(Position) + 2 * sizeof(int) + 1));
+
+class DocumentStorage;
 
-// This is an internal class for Document. See FieldIterator for the public version.
+/**
+ * This is an internal class for Document. See FieldIterator for the public version.
+ *
+ * Fields are visited in order, skipping those that have been removed: first the fields of the
+ * backing BSON, then the fields that were inserted. Fields of the backing BSON are not cached as
+ * they are passed, so the iterator never changes the DocumentStorage.
+ */
 class DocumentStorageIterator {
 public:
-    // DocumentStorage::iterator() and iteratorAll() are easier to use
-    DocumentStorageIterator(const ValueElement* first, const ValueElement* end, bool includeMissing)
-        : _first(first), _it(first), _end(end), _includeMissing(includeMissing) {
-        if (!_includeMissing)
-            skipMissing();
-    }
+    // DocumentStorage::iterator() is easier to use
+    explicit DocumentStorageIterator(const DocumentStorage& storage);
 
     bool atEnd() const {
-        return _it == _end;
-    }
-
-    const ValueElement& get() const {
-        return *_it;
+        return _bsonElement.eoo() && !_cached.found();
     }
 
-    Position position() const {
-        return Position(_it->ptr() - _first->ptr());
-    }
+    StringData fieldName() const;
+    Value value() const;
 
-    void advance() {
-        advanceOne();
-        if (!_includeMissing)
-            skipMissing();
+    /**
+     * Returns the current field as it appears in the backing BSON if it has not been looked up
+     * since, or EOO otherwise.
+     */
+    BSONElement uncachedBsonElement() const {
+        return _cached.found() ? BSONElement() : _bsonElement;
     }
 
-    const ValueElement* operator->() {
-        return _it;
-    }
-    const ValueElement& operator*() {
-        return *_it;
-    }
+    void advance();
 
 private:
-    void advanceOne() {
-        _it = _it->next();
-    }
+    const DocumentStorage* _storage;
 
-    void skipMissing() {
-        while (!atEnd() && _it->val.missing()) {
-            advanceOne();
-        }
-    }
+    BSONObjIterator _bsonIt;
+    BSONElement _bsonElement;  // the current field if read from the backing BSON, else EOO
 
-    const ValueElement* _first;
-    const ValueElement* _it;
-    const ValueElement* _end;
-    bool _includeMissing;
+    Position _cached;          // the current field's place in the cache, if it has one
+    unsigned _insertedOffset;  // where to look for the next inserted field
 };
 
-/// Storage class used by both Document and MutableDocument
+/**
+ * Storage class used by both Document and MutableDocument.
+ *
+ * A DocumentStorage may be backed by a BSONObj, in which case each of its fields is only converted
+ * into a ValueElement the first time it is looked up. Fields that have been looked up, as well as
+ * those that were inserted, live in the buffer below; fields that never were are read straight
+ * from the BSON, so that a document passing through the pipeline untouched is never converted.
+ */
 class DocumentStorage : public RefCountable {
 public:
     DocumentStorage()
@@ -187,10 +191,17 @@ public:
           _usedBytes(0),
           _numFields(0),
           _hashTabMask(0),
+          _modified(false),
           _metaFields(),
           _textScore(0),
           _randVal(0) {}
 
+    /// Backs this storage with 'bson', which must be owned.
+    explicit DocumentStorage(BSONObj bson) : DocumentStorage() {
+        dassert(bson.isOwned());
+        _bson = std::move(bson);
+    }
+
     ~DocumentStorage();
 
     enum MetaType : char {
@@ -205,7 +216,7 @@ public:
     }
 
     size_t size() const {
-        // can't use _numFields because it includes removed Fields
+        // can't use _numFields because it includes removed and cached Fields
         size_t count = 0;
         for (DocumentStorageIterator it = iterator(); !it.atEnd(); it.advance())
             count++;
@@ -217,13 +228,15 @@ public:
         return Position(_usedBytes);
     }
 
-    /// Returns the position of the named field (may be missing) or Position()
+    /**
+     * Returns the position of the named field (may be missing) or Position(). A field of the
+     * backing BSON is cached in order to have a position.
+     */
     Position findField(StringData name) const;
 
     // Document uses these
     const ValueElement& getField(Position pos) const {
-        verify(pos.found());
-        return *(_firstElement->plusBytes(pos.index));
+        return elementAt(pos);
     }
     Value getField(StringData name) const {
         Position pos = findField(name);
@@ -234,8 +247,8 @@ public:
 
     // MutableDocument uses these
     ValueElement& getField(Position pos) {
-        verify(pos.found());
-        return *(_firstElement->plusBytes(pos.index));
+        _modified = true;
+        return elementAt(pos);
     }
     Value& getField(StringData name) {
         Position pos = findField(name);
@@ -254,19 +267,26 @@ public:
 
     /// This skips missing values
     DocumentStorageIterator iterator() const {
-        return DocumentStorageIterator(_firstElement, end(), false);
-    }
-
-    /// This includes missing values
-    DocumentStorageIterator iteratorAll() const {
-        return DocumentStorageIterator(_firstElement, end(), true);
+        return DocumentStorageIterator(*this);
     }
 
     /// Shallow copy of this. Caller owns memory.
     boost::intrusive_ptr<DocumentStorage> clone() const;
 
-    size_t allocatedBytes() const {
-        return !_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes());
+    /// Approximate bytes used by this storage, including the Values in it.
+    size_t getApproximateSize() const;
+
+    /**
+     * Returns the backing BSON, which is empty if there is none.
+     *
+     * No field has been added to or changed in this storage, nor exposed to be changed, unless
+     * isModified(), in which case the BSON may no longer reflect its fields.
+     */
+    const BSONObj& bson() const {
+        return _bson;
+    }
+    bool isModified() const {
+        return _modified;
     }
 
     /**
@@ -305,13 +325,50 @@ public:
     }
 
 private:
+    friend class DocumentStorageIterator;
+
+    const ValueElement& elementAt(Position pos) const {
+        verify(pos.found());
+        return *(_firstElement->plusBytes(pos.index));
+    }
+    ValueElement& elementAt(Position pos) {
+        verify(pos.found());
+        return *(_firstElement->plusBytes(pos.index));
+    }
+
     /// Same as lastElement->next() or firstElement() if empty.
     const ValueElement* end() const {
         return _firstElement ? _firstElement->plusBytes(_usedBytes) : nullptr;
     }
 
-    /// Allocates space in _buffer. Copies existing data if there is any.
-    void alloc(unsigned newSize);
+    /// Returns the position of the named field if it is in the buffer, or Position().
+    Position findFieldInBuffer(StringData name) const;
+
+    /// Returns the position of 'elem', a field of the backing BSON, if it has been cached.
+    Position findCachedBsonField(const BSONElement& elem) const;
+
+    /**
+     * Converts 'elem', a field of the backing BSON, into a ValueElement. This does not change the
+     * document's contents, so it is done on lookups through a const DocumentStorage, which are
+     * therefore not safe to make from several threads at once.
+     */
+    Position cacheBsonField(const BSONElement& elem);
+
+    /**
+     * Allocates a buffer with room for every field of the backing BSON, so that caching them
+     * never moves it. This is only valid to call before anything is added to the buffer.
+     */
+    void reserveBsonFields();
+
+    /// Adds a ValueElement with missing Value at the end of the buffer.
+    Position appendElement(StringData name, int bsonOffset);
+
+    /**
+     * Allocates space in _buffer. Copies existing data if there is any. If 'retainOldBuffer' is
+     * true, the old buffer is kept alive for as long as this storage so that references into it
+     * stay valid.
+     */
+    void alloc(unsigned newSize, bool retainOldBuffer = false);
 
     /// Call after adding field to _buffer and increasing _numFields
     void addFieldToHashTable(Position pos);
@@ -324,6 +381,10 @@ private:
         return hashTabBuckets() * sizeof(Position);
     }
 
+    size_t allocatedBytes() const {
+        return !_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes());
+    }
+
     /// rehash on buffer growth if load-factor > .5 (attempt to keep lf < 1 when full)
     bool needRehash() const {
         return _numFields * 2 > hashTabBuckets();
@@ -348,8 +409,8 @@ private:
     /// Adds all fields to the hash table
     void rehash() {
         hashTabInit();
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance())
-            addFieldToHashTable(it.position());
+        for (const ValueElement* it = _firstElement; it != end(); it = it->next())
+            addFieldToHashTable(Position(it->ptr() - _buffer));
     }
 
     enum {
@@ -379,9 +440,17 @@ private:
     };
 
     unsigned _usedBytes;    // position where next field would start
-    unsigned _numFields;    // this includes removed fields
+    unsigned _numFields;    // this includes removed and cached fields
     unsigned _hashTabMask;  // equal to hashTabBuckets()-1 but used more often
 
+    BSONObj _bson;   // the fields that are not in _buffer come from here
+    bool _modified;  // see isModified()
+
+    // Buffers replaced while caching, which may still be referenced, and their total size. See
+    // alloc().
+    std::vector<std::unique_ptr<char[]>> _oldBuffers;
+    size_t _oldBuffersBytes = 0;
+
     std::bitset<MetaType::NUM_FIELDS> _metaFields;
     double _textScore;
     double _randVal;
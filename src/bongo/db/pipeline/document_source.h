@@ -46,6 +46,7 @@
 #include "bongo/db/pipeline/dependencies.h"
 #include "bongo/db/pipeline/document.h"
 #include "bongo/db/pipeline/expression_context.h"
+#include "bongo/db/pipeline/field_path.h"
 #include "bongo/db/pipeline/lite_parsed_document_source.h"
 #include "bongo/db/pipeline/pipeline.h"
 #include "bongo/db/pipeline/value.h"
@@ -507,6 +508,11 @@ public:
     // Wraps bongod-specific functions to allow linking into bongos.
     class BongodInterface {
     public:
+        struct CollectionSizeEstimate {
+            long long numRecords;
+            long long dataSize;
+        };
+
         virtual ~BongodInterface(){};
 
         /**
@@ -575,6 +581,21 @@ public:
             const std::vector<BSONObj>& rawPipeline,
             const boost::intrusive_ptr<ExpressionContext>& expCtx) = 0;
 
+        /**
+         * Returns the number of records and the size of the data of the collection 'nss', or
+         * boost::none if it does not exist.
+         */
+        virtual boost::optional<CollectionSizeEstimate> getCollectionSizeEstimate(
+            const NamespaceString& nss) = 0;
+
+        /**
+         * Returns whether the collection 'nss' has an index which can answer equality predicates
+         * on 'path' under the collation 'collator'.
+         */
+        virtual bool hasEqualityIndexOn(const NamespaceString& nss,
+                                        const FieldPath& path,
+                                        const CollatorInterface* collator) = 0;
+
         // Add new methods as needed.
     };
 
@@ -28,6 +28,8 @@
 
 #include "bongo/platform/basic.h"
 
+#include <numeric>
+
 #include "bongo/db/jsobj.h"
 #include "bongo/db/pipeline/accumulation_statement.h"
 #include "bongo/db/pipeline/accumulator.h"
@@ -38,6 +40,7 @@
 #include "bongo/db/pipeline/lite_parsed_document_source.h"
 #include "bongo/db/pipeline/value.h"
 #include "bongo/db/pipeline/value_comparator.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/stdx/memory.h"
 
 namespace bongo {
@@ -115,6 +118,18 @@ DocumentSource::GetNextResult DocumentSourceGroup::getNextSpilled() {
 
 DocumentSource::GetNextResult DocumentSourceGroup::getNextStandard() {
     // Not spilled, and not streaming.
+    if (_groupTable) {
+        if (_groupTablePosition == _groupTable->size())
+            return GetNextResult::makeEOF();
+
+        Document out = makeDocument(_groupTablePosition, pExpCtx->inShard);
+
+        if (++_groupTablePosition == _groupTable->size())
+            dispose();
+
+        return std::move(out);
+    }
+
     if (_groups->empty())
         return GetNextResult::makeEOF();
 
@@ -172,6 +187,7 @@ DocumentSource::GetNextResult DocumentSourceGroup::getNextStreaming() {
 void DocumentSourceGroup::dispose() {
     // Free our resources.
     _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
+    _groupTable.reset();
     _sorterIterator.reset();
 
     // Make us look done.
@@ -496,17 +512,19 @@ DocumentSource::GetNextResult DocumentSourceGroup::initialize() {
 
     dassert(numAccumulators == vpExpression.size());
 
-    // Barring any pausing, this loop exhausts 'pSource' and populates '_groups'.
-    GetNextResult input = pSource->getNext();
+    // Decide how to hold the groups before the first document arrives, and stick with it should
+    // we be re-entered after a pause.
+    if (!_groupTable && _groups->empty() && _sortedFiles.empty() && !_doingMerge &&
+        internalDocumentSourceGroupUseHashTable.load() &&
+        GroupHashTable::canHandle(vpAccumulatorFactory)) {
+        _groupTable = stdx::make_unique<GroupHashTable>(pExpCtx, vpAccumulatorFactory);
+    }
+
+    // Barring any pausing, this loop exhausts 'pSource' and populates '_groups'. When there is a
+    // '_groupTable', loadGroupTable() has already exhausted 'pSource' and the loop does not run.
+    GetNextResult input = _groupTable ? loadGroupTable() : pSource->getNext();
     for (; input.isAdvanced(); input = pSource->getNext()) {
-        if (_memoryUsageBytes > _maxMemoryUsageBytes) {
-            uassert(16945,
-                    "Exceeded memory limit for $group, but didn't allow external sort."
-                    " Pass allowDiskUse:true to opt in.",
-                    _extSortAllowed);
-            _sortedFiles.push_back(spill());
-            _memoryUsageBytes = 0;
-        }
+        spillIfOverMemoryLimit();
 
         _variables->setRoot(input.releaseDocument());
 
@@ -567,12 +585,13 @@ DocumentSource::GetNextResult DocumentSourceGroup::initialize() {
             // Do any final steps necessary to prepare to output results.
             if (!_sortedFiles.empty()) {
                 _spilled = true;
-                if (!_groups->empty()) {
+                if (!_groups->empty() || (_groupTable && !_groupTable->empty())) {
                     _sortedFiles.push_back(spill());
                 }
 
                 // We won't be using groups again so free its memory.
                 _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
+                _groupTable.reset();
 
                 _sorterIterator.reset(Sorter<Value, Value>::Iterator::merge(
                     _sortedFiles, SortOptions(), SorterComparator(pExpCtx->getValueComparator())));
@@ -599,7 +618,96 @@ DocumentSource::GetNextResult DocumentSourceGroup::initialize() {
     BONGO_UNREACHABLE;
 }
 
+DocumentSource::GetNextResult DocumentSourceGroup::loadGroupTable() {
+    const size_t numAccumulators = vpExpression.size();
+
+    // The group keys of a batch of documents, and the inputs to each accumulator.
+    vector<Value> ids;
+    vector<vector<Value>> inputs(numAccumulators);
+    ids.reserve(kGroupHashTableBatchSize);
+    for (auto&& accumulatorInputs : inputs) {
+        accumulatorInputs.reserve(kGroupHashTableBatchSize);
+    }
+    vector<uint32_t> groups;
+
+    GetNextResult input = pSource->getNext();
+    while (input.isAdvanced()) {
+        ids.clear();
+        for (auto&& accumulatorInputs : inputs) {
+            accumulatorInputs.clear();
+        }
+
+        // Evaluate the batch. The last document fetched is left in 'input', either for the next
+        // batch or to be returned.
+        for (; input.isAdvanced() && ids.size() < kGroupHashTableBatchSize;
+             input = pSource->getNext()) {
+            _variables->setRoot(input.releaseDocument());
+            ids.push_back(computeId(_variables.get()));
+            for (size_t i = 0; i < numAccumulators; i++) {
+                inputs[i].push_back(vpExpression[i]->evaluate(_variables.get()));
+            }
+
+            // We are done with the ROOT document so release it.
+            _variables->clearRoot();
+        }
+
+        const size_t numInserted = _groupTable->findOrInsert(ids, &groups);
+        for (size_t i = 0; i < numAccumulators; i++) {
+            _groupTable->process(i, groups, inputs[i]);
+        }
+
+        // Unlike the loop in initialize(), check the memory usage after every batch including the
+        // last, since a whole batch may have gone over the limit.
+        _memoryUsageBytes = _groupTable->getMemoryUsageBytes();
+        spillIfOverMemoryLimit();
+
+        if (kDebugBuild && !storageGlobalParams.readOnly) {
+            // In debug mode, spill every time a batch has a duplicate id to stress merge logic.
+            if (numInserted < ids.size() &&  // has a dup
+                !_groupTable->empty() &&     // wasn't just spilled for its memory usage
+                !pExpCtx->inRouter &&        // can't spill to disk in router
+                !_extSortAllowed &&          // don't change behavior when testing external sort
+                _sortedFiles.size() < 20) {  // don't open too many FDs
+
+                _sortedFiles.push_back(spill());
+                _memoryUsageBytes = 0;
+            }
+        }
+    }
+    return input;
+}
+
+void DocumentSourceGroup::spillIfOverMemoryLimit() {
+    if (_memoryUsageBytes > _maxMemoryUsageBytes) {
+        uassert(16945,
+                "Exceeded memory limit for $group, but didn't allow external sort."
+                " Pass allowDiskUse:true to opt in.",
+                _extSortAllowed);
+        _sortedFiles.push_back(spill());
+        _memoryUsageBytes = 0;
+    }
+}
+
 shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
+    if (_groupTable) {
+        vector<uint32_t> groups(_groupTable->size());
+        std::iota(groups.begin(), groups.end(), 0);
+
+        const ValueComparator& valueComparator = pExpCtx->getValueComparator();
+        stable_sort(groups.begin(), groups.end(), [&](uint32_t lhs, uint32_t rhs) {
+            return valueComparator.evaluate(_groupTable->getId(lhs) < _groupTable->getId(rhs));
+        });
+
+        SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
+        for (auto group : groups) {
+            writer.addAlreadySorted(_groupTable->getId(group), getMergeableValues(group));
+        }
+
+        _groupTable->clear();
+
+        return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+    }
+
     vector<const GroupsMap::value_type*> ptrs;  // using pointers to speed sorting
     ptrs.reserve(_groups->size());
     for (GroupsMap::const_iterator it = _groups->begin(), end = _groups->end(); it != end; ++it) {
@@ -845,6 +953,39 @@ Document DocumentSourceGroup::makeDocument(const Value& id,
     return out.freeze();
 }
 
+Document DocumentSourceGroup::makeDocument(uint32_t group, bool mergeableOutput) {
+    const size_t n = vFieldName.size();
+    MutableDocument out(1 + n);
+
+    out.addField("_id", expandId(_groupTable->getId(group)));
+
+    for (size_t i = 0; i < n; ++i) {
+        Value val = _groupTable->getValue(i, group, mergeableOutput);
+        // As above, return null rather than missing so that return objects are predictable.
+        out.addField(vFieldName[i], val.missing() ? Value(BSONNULL) : std::move(val));
+    }
+
+    return out.freeze();
+}
+
+Value DocumentSourceGroup::getMergeableValues(uint32_t group) const {
+    const size_t numAccumulators = vpAccumulatorFactory.size();
+    switch (numAccumulators) {  // mirrors switch in spill()
+        case 0:
+            return Value();
+        case 1:
+            return _groupTable->getValue(0, group, /*toBeMerged=*/true);
+        default: {
+            vector<Value> accums;
+            accums.reserve(numAccumulators);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                accums.push_back(_groupTable->getValue(i, group, /*toBeMerged=*/true));
+            }
+            return Value(std::move(accums));
+        }
+    }
+}
+
 intrusive_ptr<DocumentSource> DocumentSourceGroup::getShardSource() {
     return this;  // No modifications necessary when on shard
 }
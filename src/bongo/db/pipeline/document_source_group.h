@@ -34,6 +34,7 @@
 #include "bongo/db/pipeline/accumulation_statement.h"
 #include "bongo/db/pipeline/accumulator.h"
 #include "bongo/db/pipeline/document_source.h"
+#include "bongo/db/pipeline/group_hash_table.h"
 #include "bongo/db/sorter/sorter.h"
 
 namespace bongo {
@@ -45,6 +46,9 @@ public:
 
     static const size_t kDefaultMaxMemoryUsageBytes = 100 * 1024 * 1024;
 
+    // The number of input documents that are grouped together when using a GroupHashTable.
+    static const size_t kGroupHashTableBatchSize = 128;
+
     // Virtuals from DocumentSource.
     boost::intrusive_ptr<DocumentSource> optimize() final;
     GetDepsReturn getDependencies(DepsTracker* deps) const final;
@@ -127,6 +131,13 @@ private:
      */
     GetNextResult initialize();
 
+    /**
+     * Exhausts 'pSource' into '_groupTable', a batch of documents at a time, and returns the first
+     * result that is not kAdvanced. Used by initialize() when the accumulators can be held by a
+     * GroupHashTable.
+     */
+    GetNextResult loadGroupTable();
+
     /**
      * Spill groups map to disk and returns an iterator to the file. Note: Since a sorted $group
      * does not exhaust the previous stage before returning, and thus does not maintain as large a
@@ -134,7 +145,20 @@ private:
      */
     std::shared_ptr<Sorter<Value, Value>::Iterator> spill();
 
+    /**
+     * Spills the groups to disk if they take up more than '_maxMemoryUsageBytes', or throws if
+     * that is not allowed.
+     */
+    void spillIfOverMemoryLimit();
+
     Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
+    Document makeDocument(uint32_t group, bool mergeableOutput);
+
+    /**
+     * Returns the state of every accumulator of 'group' in '_groupTable', in the form that spill()
+     * writes it.
+     */
+    Value getMergeableValues(uint32_t group) const;
 
     /**
      * Computes the internal representation of the group key.
@@ -179,8 +203,13 @@ private:
     std::vector<std::shared_ptr<Sorter<Value, Value>::Iterator>> _sortedFiles;
     bool _spilled;
 
+    // Holds the groups in place of '_groups' when all of the accumulators are supported by
+    // GroupHashTable and we are neither streaming nor merging.
+    std::unique_ptr<GroupHashTable> _groupTable;
+
     // Only used when '_spilled' is false.
     GroupsMap::iterator groupsIterator;
+    uint32_t _groupTablePosition = 0;
 
     // Only used when '_spilled' is true.
     std::unique_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
@@ -0,0 +1,223 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kQuery
+
+#include "bongo/platform/basic.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "bongo/bson/bsonobjbuilder.h"
+#include "bongo/db/pipeline/aggregation_context_fixture.h"
+#include "bongo/db/pipeline/document.h"
+#include "bongo/db/pipeline/document_source_group.h"
+#include "bongo/db/pipeline/document_source_match.h"
+#include "bongo/db/pipeline/document_source_mock.h"
+#include "bongo/db/query/query_knobs.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/log.h"
+#include "bongo/util/scopeguard.h"
+#include "bongo/util/timer.h"
+
+namespace bongo {
+namespace {
+
+using boost::intrusive_ptr;
+
+const int kNumDocs = 20000;
+const int kNumFields = 200;
+const int kNumGroups = 100;
+
+const int kNumNarrowDocs = 200000;
+
+/**
+ * Produces Documents from a vector of BSON objects the way DocumentSourceCursor does, either
+ * backed lazily by the BSON or with every top-level field converted up front.
+ */
+class BsonDocumentSource final : public DocumentSourceMock {
+public:
+    BsonDocumentSource(const std::vector<BSONObj>& objs, bool materialize)
+        : DocumentSourceMock({}), _objs(objs), _materialize(materialize) {}
+
+    GetNextResult getNext() override {
+        if (_pos == _objs.size())
+            return GetNextResult::makeEOF();
+
+        const BSONObj& obj = _objs[_pos++];
+        if (!_materialize)
+            return Document::fromBsonWithMetaData(obj);
+
+        MutableDocument doc(obj.nFields());
+        for (auto&& elem : obj) {
+            doc.addField(elem.fieldNameStringData(), Value(elem));
+        }
+        return doc.freeze();
+    }
+
+private:
+    const std::vector<BSONObj>& _objs;
+    const bool _materialize;
+    size_t _pos = 0;
+};
+
+/**
+ * Documents with 'kNumFields' fields of mixed types, of which the pipelines below only look at
+ * two.
+ */
+std::vector<BSONObj> makeWideDocuments() {
+    std::vector<BSONObj> objs;
+    objs.reserve(kNumDocs);
+    for (int i = 0; i < kNumDocs; ++i) {
+        BSONObjBuilder bob;
+        bob.append("key", i % kNumGroups);
+        bob.append("num", i);
+        for (int f = 2; f < kNumFields; ++f) {
+            const std::string name = str::stream() << "f" << f;
+            switch (f % 3) {
+                case 0:
+                    bob.append(name, f * i);
+                    break;
+                case 1:
+                    bob.append(name, "a string field of moderate length");
+                    break;
+                default:
+                    bob.append(name, BSON("x" << i << "y" << BSON_ARRAY(1 << 2 << 3)));
+                    break;
+            }
+        }
+        objs.push_back(bob.obj());
+    }
+    return objs;
+}
+
+using DocumentSourceGroupPerfTest = AggregationContextFixture;
+
+/**
+ * Runs {$match: {num: {$gte: 0}}}, {$group: {_id: '$key', total: {$sum: '$num'}}} over wide
+ * documents and reports the document throughput.
+ */
+void runMatchGroup(const intrusive_ptr<ExpressionContext>& expCtx,
+                   const std::vector<BSONObj>& objs,
+                   bool materialize) {
+    BsonDocumentSource source(objs, materialize);
+    auto match = DocumentSourceMatch::createFromBson(
+        BSON("$match" << BSON("num" << BSON("$gte" << 0))).firstElement(), expCtx);
+    auto group = DocumentSourceGroup::createFromBson(
+        BSON("$group" << BSON("_id"
+                              << "$key"
+                              << "total"
+                              << BSON("$sum"
+                                      << "$num")))
+            .firstElement(),
+        expCtx);
+    match->setSource(&source);
+    group->setSource(match.get());
+
+    Timer timer;
+    int numGroups = 0;
+    for (auto next = group->getNext(); next.isAdvanced(); next = group->getNext()) {
+        ++numGroups;
+    }
+    const long long micros = timer.micros();
+
+    ASSERT_EQ(numGroups, kNumGroups);
+    log() << "THROUGHPUT " << (materialize ? "materialized" : "lazy") << " documents: "
+          << static_cast<long long>(objs.size()) * 1000000 / std::max(micros, 1LL)
+          << " docs/sec";
+}
+
+TEST_F(DocumentSourceGroupPerfTest, MatchGroupOverWideDocuments) {
+    const std::vector<BSONObj> objs = makeWideDocuments();
+    runMatchGroup(getExpCtx(), objs, true);
+    runMatchGroup(getExpCtx(), objs, false);
+}
+
+/**
+ * Runs a $group with $sum, $avg, $min and $max over 'kNumNarrowDocs' documents with 'numGroups'
+ * distinct keys, with and without a GroupHashTable, and reports the document throughput of each.
+ */
+void runGroupByCardinality(const intrusive_ptr<ExpressionContext>& expCtx, int numGroups) {
+    std::deque<DocumentSource::GetNextResult> docs;
+    for (int i = 0; i < kNumNarrowDocs; ++i) {
+        docs.push_back(Document{{"key", i % numGroups}, {"num", i}});
+    }
+
+    const BSONObj spec = BSON("$group" << BSON("_id"
+                                               << "$key"
+                                               << "sum"
+                                               << BSON("$sum"
+                                                       << "$num")
+                                               << "avg"
+                                               << BSON("$avg"
+                                                       << "$num")
+                                               << "min"
+                                               << BSON("$min"
+                                                       << "$num")
+                                               << "max"
+                                               << BSON("$max"
+                                                       << "$num")));
+
+    const bool oldUseHashTable = internalDocumentSourceGroupUseHashTable.load();
+    ON_BLOCK_EXIT([oldUseHashTable] {
+        internalDocumentSourceGroupUseHashTable.store(oldUseHashTable);
+    });
+
+    for (bool useHashTable : {false, true}) {
+        internalDocumentSourceGroupUseHashTable.store(useHashTable);
+        auto source = DocumentSourceMock::create(docs);
+        auto group = DocumentSourceGroup::createFromBson(spec.firstElement(), expCtx);
+        group->setSource(source.get());
+
+        Timer timer;
+        int numResults = 0;
+        for (auto next = group->getNext(); next.isAdvanced(); next = group->getNext()) {
+            ++numResults;
+        }
+        const long long micros = timer.micros();
+
+        ASSERT_EQ(numResults, numGroups);
+        log() << "THROUGHPUT " << numGroups << " groups, "
+              << (useHashTable ? "GroupHashTable" : "Accumulator map") << ": "
+              << static_cast<long long>(kNumNarrowDocs) * 1000000 / std::max(micros, 1LL)
+              << " docs/sec";
+    }
+}
+
+TEST_F(DocumentSourceGroupPerfTest, LowCardinalityGroup) {
+    runGroupByCardinality(getExpCtx(), 16);
+}
+
+TEST_F(DocumentSourceGroupPerfTest, HighCardinalityGroup) {
+    runGroupByCardinality(getExpCtx(), 50000);
+}
+
+}  // namespace
+}  // namespace bongo
@@ -47,12 +47,14 @@
 #include "bongo/db/pipeline/expression.h"
 #include "bongo/db/pipeline/expression_context_for_test.h"
 #include "bongo/db/pipeline/value_comparator.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/query/query_test_service_context.h"
 #include "bongo/dbtests/dbtests.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/stdx/unordered_set.h"
 #include "bongo/unittest/temp_dir.h"
 #include "bongo/unittest/unittest.h"
+#include "bongo/util/scopeguard.h"
 
 namespace bongo {
 
@@ -192,6 +194,146 @@ TEST_F(DocumentSourceGroupTest, ShouldCorrectlyTrackMemoryUsageBetweenPauses) {
     ASSERT_THROWS_CODE(group->getNext(), UserException, 16945);
 }
 
+/**
+ * Runs a $group with the _id field path and accumulators in 'spec' over 'inputs', either with or
+ * without a GroupHashTable, and returns the results ordered by _id.
+ */
+vector<Document> runGroup(
+    const intrusive_ptr<ExpressionContext>& expCtx,
+    const BSONObj& spec,
+    deque<DocumentSource::GetNextResult> inputs,
+    bool useHashTable,
+    size_t maxMemoryUsageBytes = DocumentSourceGroup::kDefaultMaxMemoryUsageBytes) {
+    const bool oldUseHashTable = internalDocumentSourceGroupUseHashTable.load();
+    ON_BLOCK_EXIT([oldUseHashTable] {
+        internalDocumentSourceGroupUseHashTable.store(oldUseHashTable);
+    });
+    internalDocumentSourceGroupUseHashTable.store(useHashTable);
+
+    VariablesIdGenerator idGen;
+    VariablesParseState vps(&idGen);
+    intrusive_ptr<Expression> groupByExpression;
+    vector<AccumulationStatement> accumulationStatements;
+    for (auto&& elem : spec) {
+        if (elem.fieldNameStringData() == "_id") {
+            groupByExpression = ExpressionFieldPath::parse(expCtx, elem.str(), vps);
+        } else {
+            accumulationStatements.push_back(
+                AccumulationStatement::parseAccumulationStatement(expCtx, elem, vps));
+        }
+    }
+    auto group = DocumentSourceGroup::create(expCtx,
+                                             groupByExpression,
+                                             std::move(accumulationStatements),
+                                             idGen.getIdCount(),
+                                             maxMemoryUsageBytes);
+    auto mock = DocumentSourceMock::create(std::move(inputs));
+    group->setSource(mock.get());
+
+    vector<Document> results;
+    for (auto result = group->getNext(); result.isAdvanced(); result = group->getNext()) {
+        results.push_back(result.releaseDocument());
+    }
+    const ValueComparator& valueComparator = expCtx->getValueComparator();
+    std::sort(results.begin(), results.end(), [&](const Document& lhs, const Document& rhs) {
+        return valueComparator.evaluate(lhs["_id"] < rhs["_id"]);
+    });
+    return results;
+}
+
+void assertSameResults(const vector<Document>& expected, const vector<Document>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_DOCUMENT_EQ(expected[i], actual[i]);
+    }
+}
+
+const BSONObj kEveryHashTableAccumulator = BSON("_id"
+                                                << "$k"
+                                                << "sum"
+                                                << BSON("$sum"
+                                                        << "$v")
+                                                << "avg"
+                                                << BSON("$avg"
+                                                        << "$v")
+                                                << "min"
+                                                << BSON("$min"
+                                                        << "$v")
+                                                << "max"
+                                                << BSON("$max"
+                                                        << "$v")
+                                                << "first"
+                                                << BSON("$first"
+                                                        << "$v")
+                                                << "last"
+                                                << BSON("$last"
+                                                        << "$v")
+                                                << "push"
+                                                << BSON("$push"
+                                                        << "$v"));
+
+TEST_F(DocumentSourceGroupTest, HashTableShouldProduceTheSameResultsAsAccumulators) {
+    // Cover every kind of input the accumulators treat differently, including a missing 'v', and
+    // keys of several types.
+    const vector<Value> values = {Value(1),
+                                  Value(2LL),
+                                  Value(3.5),
+                                  Value(std::numeric_limits<long long>::max()),
+                                  Value("str"_sd),
+                                  Value(BSONNULL),
+                                  Value(),
+                                  Value(vector<Value>{Value(1), Value(2)})};
+    const vector<Value> keys = {Value(0), Value(1.0), Value("a"_sd), Value(BSONNULL), Value()};
+
+    deque<DocumentSource::GetNextResult> inputs;
+    for (size_t i = 0; i < 1000; ++i) {
+        MutableDocument doc;
+        doc.addField("k", keys[i % keys.size()]);
+        doc.addField("v", values[(i / keys.size()) % values.size()]);
+        inputs.push_back(doc.freeze());
+    }
+
+    auto expected = runGroup(getExpCtx(), kEveryHashTableAccumulator, inputs, false);
+    auto actual = runGroup(getExpCtx(), kEveryHashTableAccumulator, inputs, true);
+    // 0 and 1.0 are different groups, while null and missing are the same.
+    ASSERT_EQ(expected.size(), 4UL);
+    assertSameResults(expected, actual);
+}
+
+TEST_F(DocumentSourceGroupTest, HashTableShouldSpillAndMergeGroups) {
+    auto expCtx = getExpCtx();
+    TempDir tempDir("DocumentSourceGroupTest");
+    expCtx->tempDir = tempDir.path();
+    expCtx->extSortAllowed = true;
+    const size_t maxMemoryUsageBytes = 4000;
+
+    deque<DocumentSource::GetNextResult> inputs;
+    for (int i = 0; i < 2000; ++i) {
+        inputs.push_back(Document{{"k", i % 300}, {"v", i}});
+        if (i % 500 == 0) {
+            inputs.push_back(DocumentSource::GetNextResult::makePauseExecution());
+        }
+    }
+
+    auto expected = runGroup(expCtx, kEveryHashTableAccumulator, inputs, false);
+    auto actual = runGroup(expCtx, kEveryHashTableAccumulator, inputs, true, maxMemoryUsageBytes);
+    ASSERT_EQ(expected.size(), 300UL);
+    assertSameResults(expected, actual);
+}
+
+TEST_F(DocumentSourceGroupTest, HashTableShouldErrorIfNotAllowedToSpillToDisk) {
+    auto expCtx = getExpCtx();
+    expCtx->inRouter = true;  // Disallow external sort.
+
+    deque<DocumentSource::GetNextResult> inputs;
+    for (int i = 0; i < 2000; ++i) {
+        inputs.push_back(Document{{"k", i}, {"v", i}});
+    }
+
+    ASSERT_THROWS_CODE(
+        runGroup(expCtx, kEveryHashTableAccumulator, inputs, true, 4000), UserException, 16945);
+}
+
 BSONObj toBson(const intrusive_ptr<DocumentSource>& source) {
     vector<Value> arr;
     source->serializeToArray(arr);
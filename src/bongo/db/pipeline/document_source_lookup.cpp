@@ -30,6 +30,8 @@
 
 #include "bongo/db/pipeline/document_source_lookup.h"
 
+#include <algorithm>
+
 #include "bongo/base/init.h"
 #include "bongo/db/jsobj.h"
 #include "bongo/db/matcher/expression_algo.h"
@@ -37,6 +39,7 @@
 #include "bongo/db/pipeline/expression.h"
 #include "bongo/db/pipeline/expression_context.h"
 #include "bongo/db/pipeline/value.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/stdx/memory.h"
 
 namespace bongo {
@@ -54,7 +57,8 @@ DocumentSourceLookUp::DocumentSourceLookUp(NamespaceString fromNs,
       _as(std::move(as)),
       _localField(std::move(localField)),
       _foreignField(foreignField),
-      _foreignFieldFieldName(std::move(foreignField)) {
+      _foreignFieldFieldName(std::move(foreignField)),
+      _cache(pExpCtx->getValueComparator()) {
     const auto& resolvedNamespace = pExpCtx->getResolvedNamespace(_fromNs);
     _fromExpCtx = pExpCtx->copyWith(resolvedNamespace.ns);
     _fromPipeline = resolvedNamespace.pipeline;
@@ -97,6 +101,19 @@ const char* DocumentSourceLookUp::getSourceName() const {
 
 namespace {
 
+// How many foreign documents a hash join can read for the cost of one indexed query of the foreign
+// collection.
+const long long kIndexedQueryCost = 100;
+
+// Bounds the size of the values that a batch of input documents queries the foreign collection
+// for, well below the largest query allowed.
+const int kMaxBatchQueryBytes = BSONObjMaxUserSize / 4;
+
+// The fields of the documents a batch caches for each of its matches.
+const StringData kCachedQueryField = "query"_sd;
+const StringData kCachedPositionField = "position"_sd;
+const StringData kCachedMatchField = "match"_sd;
+
 /**
  * Constructs a query of the following shape:
  *  {$or: [
@@ -116,6 +133,56 @@ BSONObj buildEqualityOrQuery(const std::string& fieldName, const vector<Value>&
     return orBuilder.obj();
 }
 
+/**
+ * Constructs a $match stage which finds every foreign document whose 'foreignFieldName' is found
+ * under one of 'keys' by LookupHashJoin::getForeignKeys(), and maybe some others:
+ *  {$match: {$and: [{$or: [
+ *    {'foreignFieldName': {$in: [<keys>]}},
+ *    {'foreignFieldName': {$eq: null}},
+ *    {'foreignFieldName': {$eq: <regex key>}},
+ *    ...
+ *  ]}, 'additionalFilter']}}
+ */
+BSONObj makeMatchStageFromKeys(const ValueUnorderedSet& keys,
+                               const std::string& foreignFieldName,
+                               const BSONObj& additionalFilter) {
+    // Null and undefined are both found by an equality with null. A regular expression is only
+    // found by an equality, as $in would match strings against it.
+    vector<Value> inKeys;
+    vector<Value> equalityKeys;
+    bool findNullish = false;
+    for (auto&& key : keys) {
+        if (key.nullish()) {
+            findNullish = true;
+        } else if (key.getType() == RegEx) {
+            equalityKeys.push_back(key);
+        } else {
+            inKeys.push_back(key);
+        }
+    }
+    if (findNullish) {
+        equalityKeys.push_back(Value(BSONNULL));
+    }
+
+    BSONObjBuilder match;
+    BSONObjBuilder query(match.subobjStart("$match"));
+    BSONArrayBuilder andObj(query.subarrayStart("$and"));
+    {
+        BSONObjBuilder joiningObj(andObj.subobjStart());
+        BSONArrayBuilder orObj(joiningObj.subarrayStart("$or"));
+        if (!inKeys.empty()) {
+            orObj.append(BSON(foreignFieldName << BSON("$in" << Value(std::move(inKeys)))));
+        }
+        for (auto&& key : equalityKeys) {
+            orObj.append(BSON(foreignFieldName << BSON("$eq" << key)));
+        }
+    }
+    andObj.append(additionalFilter);
+    andObj.doneFast();
+    query.doneFast();
+    return match.obj();
+}
+
 }  // namespace
 
 DocumentSource::GetNextResult DocumentSourceLookUp::getNext() {
@@ -129,43 +196,341 @@ DocumentSource::GetNextResult DocumentSourceLookUp::getNext() {
                                 ->getQuery();
     }
 
-    if (_handlingUnwind) {
-        return unwindResult();
+    if (!_joinPlanned) {
+        _hashJoinThreshold = computeHashJoinThreshold(&_estimatedForeignBytes);
+        _batchSize = computeBatchSize();
+        _joinPlanned = true;
     }
 
-    auto nextInput = pSource->getNext();
-    if (!nextInput.isAdvanced()) {
-        return nextInput;
+    if (_handlingUnwind) {
+        return unwindResult();
     }
-    auto inputDoc = nextInput.releaseDocument();
 
     // If we have not absorbed a $unwind, we cannot absorb a $match. If we have absorbed a $unwind,
     // '_handlingUnwind' would be set to true, and we would not have made it here.
     invariant(!_matchSrc);
 
-    auto matchStage =
-        makeMatchStageFromInput(inputDoc, _localField, _foreignFieldFieldName, BSONObj());
-    // We've already allocated space for the trailing $match stage in '_fromPipeline'.
-    _fromPipeline.back() = matchStage;
-    auto pipeline = uassertStatusOK(_bongod->makePipeline(_fromPipeline, _fromExpCtx));
+    auto nextInput = getNextInput();
+    if (!nextInput.isAdvanced()) {
+        return nextInput;
+    }
+    auto inputDoc = nextInput.releaseDocument();
 
     std::vector<Value> results;
     int objsize = 0;
-    while (auto result = pipeline->getNext()) {
+    while (auto result = getNextMatch()) {
         objsize += result->getApproximateSize();
         uassert(4568,
                 str::stream() << "Total size of documents in " << _fromNs.coll() << " matching "
-                              << matchStage
+                              << makeMatchStageFromInput(
+                                     inputDoc, _localField, _foreignFieldFieldName, BSONObj())
                               << " exceeds maximum document size",
                 objsize <= BSONObjMaxInternalSize);
         results.emplace_back(std::move(*result));
     }
+    _pipeline.reset();
 
     MutableDocument output(std::move(inputDoc));
     output.setNestedField(_as, Value(std::move(results)));
     return output.freeze();
 }
 
+boost::optional<long long> DocumentSourceLookUp::computeHashJoinThreshold(
+    long long* estimatedForeignBytes) const {
+    if (!internalDocumentSourceLookupUseHashJoin.load() ||
+        !LookupHashJoin::canJoinOn(_foreignField)) {
+        return boost::none;
+    }
+
+    auto foreignSize = _bongod->getCollectionSizeEstimate(_fromExpCtx->ns);
+    if (!foreignSize) {
+        // Querying a collection which does not exist costs next to nothing.
+        return boost::none;
+    }
+    *estimatedForeignBytes = foreignSize->dataSize;
+
+    const bool extSortAllowed = pExpCtx->extSortAllowed && !pExpCtx->inRouter;
+    if (!extSortAllowed &&
+        foreignSize->dataSize > internalDocumentSourceLookupHashJoinMaxMemoryBytes.load()) {
+        return boost::none;
+    }
+
+    // Without an index, each query scans the whole foreign collection, so hashing it right away
+    // costs no more than the first query would. A view's pipeline is run before the query, so the
+    // indexes of the collection it is defined on are not considered.
+    const bool queryingView = _fromPipeline.size() > 1;
+    if (queryingView ||
+        !_bongod->hasEqualityIndexOn(_fromExpCtx->ns, _foreignField, _fromExpCtx->getCollator())) {
+        return 0LL;
+    }
+
+    // With an index, each query only reads its matches, but parsing and planning it costs about as
+    // much as hashing 'kIndexedQueryCost' foreign documents. How many input documents there will be
+    // is not known up front, so the nested loop join carries on until the queries made so far have
+    // cost as much as reading the foreign collection once.
+    return foreignSize->numRecords / kIndexedQueryCost;
+}
+
+int DocumentSourceLookUp::computeBatchSize() const {
+    // The matches of a batch are routed back to its input documents by the keys of a hash join.
+    if (!LookupHashJoin::canJoinOn(_foreignField)) {
+        return 1;
+    }
+    return std::max(1, internalDocumentSourceLookupBatchSize.load());
+}
+
+DocumentSource::GetNextResult DocumentSourceLookUp::getNextInput() {
+    if (_hashJoin && _hashJoin->isSpilled()) {
+        return getNextSpilledInput();
+    }
+
+    if (!_batch.empty()) {
+        return getNextBatchedInput();
+    }
+    if (_pendingInput) {
+        // A batch was cut short by this pause or EOF, and has now been returned in full.
+        auto pendingInput = std::move(*_pendingInput);
+        _pendingInput = boost::none;
+        return pendingInput;
+    }
+
+    auto nextInput = pSource->getNext();
+    if (!nextInput.isAdvanced()) {
+        return nextInput;
+    }
+
+    // The hash join is only built once there is an input document to join, so that an empty input
+    // does not read the foreign collection.
+    if (!_hashJoin && _hashJoinThreshold && _numInputs >= *_hashJoinThreshold) {
+        buildHashJoin();
+        if (_hashJoin && _hashJoin->isSpilled()) {
+            _hashJoin->addLocalDocument(nextInput.releaseDocument());
+            return getNextSpilledInput();
+        }
+    }
+    ++_numInputs;
+
+    if (_hashJoin) {
+        _matches = _hashJoin->probe(nextInput.getDocument());
+        _matchIndex = 0;
+    } else if (_batchSize > 1) {
+        queryBatch(nextInput.releaseDocument());
+        return getNextBatchedInput();
+    } else {
+        BSONObj filter = _additionalFilter.value_or(BSONObj());
+        auto matchStage = makeMatchStageFromInput(
+            nextInput.getDocument(), _localField, _foreignFieldFieldName, filter);
+        // We've already allocated space for the trailing $match stage in '_fromPipeline'.
+        _fromPipeline.back() = matchStage;
+        _pipeline = uassertStatusOK(_bongod->makePipeline(_fromPipeline, _fromExpCtx));
+        ++_numQueries;
+    }
+    return nextInput;
+}
+
+void DocumentSourceLookUp::queryBatch(Document firstInput) {
+    const auto& comparator = pExpCtx->getValueComparator();
+    auto addToBatch = [&](Document input) {
+        auto keys = LookupHashJoin::getLocalKeys(comparator, input.getNestedField(_localField));
+        _batch.emplace_back(std::move(input), std::move(keys));
+    };
+
+    int batchBytes = firstInput.getNestedField(_localField).getApproximateSize();
+    addToBatch(std::move(firstInput));
+
+    // Stop short of the input document which a hash join would take over from.
+    while (_batch.size() < static_cast<size_t>(_batchSize) && batchBytes < kMaxBatchQueryBytes &&
+           (!_hashJoinThreshold || _numInputs < *_hashJoinThreshold)) {
+        auto nextInput = pSource->getNext();
+        if (!nextInput.isAdvanced()) {
+            _pendingInput = std::move(nextInput);
+            break;
+        }
+        ++_numInputs;
+        batchBytes += nextInput.getDocument().getNestedField(_localField).getApproximateSize();
+        addToBatch(nextInput.releaseDocument());
+    }
+
+    // Only the keys which are not cached already are queried for. Nothing is evicted until the
+    // next batch, so the whole batch can be matched from the cache.
+    _cache.evictDownTo(internalDocumentSourceLookupCacheMaxMemoryBytes.load());
+    const long long queryId = _numQueries;
+    auto queried = comparator.makeUnorderedValueSet();
+
+    // An input document is matched in the order of the query which found its matches, which can
+    // only be done if they were all found by the same query. Its keys are queried for again if
+    // any of them was not, which may in turn leave other input documents matched by two queries.
+    auto needsQuery = [&](const std::vector<Value>& keys) {
+        boost::optional<long long> matchedBy;
+        for (auto&& key : keys) {
+            long long foundBy = queryId;
+            if (!queried.count(key)) {
+                auto cached = _cache[key];
+                if (!cached) {
+                    return true;
+                }
+                if (cached->empty()) {
+                    continue;
+                }
+                foundBy = cached->front()[kCachedQueryField].getLong();
+            }
+            if (matchedBy && *matchedBy != foundBy) {
+                return true;
+            }
+            matchedBy = foundBy;
+        }
+        return false;
+    };
+    for (bool addedKeys = true; addedKeys;) {
+        addedKeys = false;
+        for (auto&& input : _batch) {
+            if (needsQuery(input.second)) {
+                for (auto&& key : input.second) {
+                    addedKeys |= queried.insert(key).second;
+                }
+            }
+        }
+    }
+    for (auto&& input : _batch) {
+        for (auto&& key : input.second) {
+            if (!queried.count(key)) {
+                ++_numKeysFromCache;
+            }
+        }
+    }
+    if (queried.empty()) {
+        return;
+    }
+
+    for (auto&& key : queried) {
+        _cache.erase(key);
+        _cache.insertKey(key);
+    }
+    _fromPipeline.back() = makeMatchStageFromKeys(
+        queried, _foreignFieldFieldName, _additionalFilter.value_or(BSONObj()));
+    auto pipeline = uassertStatusOK(_bongod->makePipeline(_fromPipeline, _fromExpCtx));
+    ++_numQueries;
+    _numKeysQueried += queried.size();
+
+    // Each match is cached along with the query which found it and its position in the results.
+    long long position = 0;
+    while (auto result = pipeline->getNext()) {
+        auto foreignKeys =
+            LookupHashJoin::getForeignKeys(comparator, result->getField(_foreignFieldFieldName));
+        Document cached{{kCachedQueryField, queryId},
+                        {kCachedPositionField, position++},
+                        {kCachedMatchField, std::move(*result)}};
+        // The query may find documents under keys which were not queried for, and so may not be
+        // cached in full.
+        for (auto&& key : foreignKeys) {
+            if (queried.count(key)) {
+                _cache.insert(key, cached);
+            }
+        }
+    }
+}
+
+DocumentSource::GetNextResult DocumentSourceLookUp::getNextBatchedInput() {
+    auto input = std::move(_batch.front());
+    _batch.pop_front();
+
+    // The matches are put back in the order the query returned them. A foreign document found
+    // under more than one key of the input document is only matched once.
+    std::vector<std::pair<long long, Document>> matches;
+    for (auto&& key : input.second) {
+        auto cached = _cache[key];
+        invariant(cached);
+        for (auto&& match : *cached) {
+            matches.emplace_back(match[kCachedPositionField].getLong(),
+                                 match[kCachedMatchField].getDocument());
+        }
+    }
+    if (input.second.size() > 1) {
+        using PositionedMatch = std::pair<long long, Document>;
+        std::sort(matches.begin(),
+                  matches.end(),
+                  [](const PositionedMatch& lhs, const PositionedMatch& rhs) {
+                      return lhs.first < rhs.first;
+                  });
+        matches.erase(std::unique(matches.begin(),
+                                  matches.end(),
+                                  [](const PositionedMatch& lhs, const PositionedMatch& rhs) {
+                                      return lhs.first == rhs.first;
+                                  }),
+                      matches.end());
+    }
+
+    _matches.clear();
+    _matchIndex = 0;
+    for (auto&& match : matches) {
+        _matches.push_back(std::move(match.second));
+    }
+    return std::move(input.first);
+}
+
+DocumentSource::GetNextResult DocumentSourceLookUp::getNextSpilledInput() {
+    // A spilled hash join joins every input document before returning the first of them.
+    while (!_inputExhausted) {
+        auto nextInput = pSource->getNext();
+        if (nextInput.isPaused()) {
+            return nextInput;
+        }
+        if (nextInput.isEOF()) {
+            _hashJoin->doneAddingLocalDocuments();
+            _inputExhausted = true;
+            break;
+        }
+        _hashJoin->addLocalDocument(nextInput.releaseDocument());
+    }
+
+    auto joined = _hashJoin->getNextJoined();
+    if (!joined) {
+        return GetNextResult::makeEOF();
+    }
+    _matches = std::move(joined->second);
+    _matchIndex = 0;
+    return std::move(joined->first);
+}
+
+boost::optional<Document> DocumentSourceLookUp::getNextMatch() {
+    if (_pipeline) {
+        return _pipeline->getNext();
+    }
+
+    if (_matchIndex == _matches.size()) {
+        _matches.clear();
+        return boost::none;
+    }
+    return _matches[_matchIndex++];
+}
+
+void DocumentSourceLookUp::buildHashJoin() {
+    _pipeline.reset();
+
+    auto hashJoin = stdx::make_unique<LookupHashJoin>(
+        pExpCtx->getValueComparator(),
+        _localField,
+        _foreignField,
+        internalDocumentSourceLookupHashJoinMaxMemoryBytes.load(),
+        pExpCtx->extSortAllowed && !pExpCtx->inRouter,
+        pExpCtx->tempDir,
+        _estimatedForeignBytes);
+
+    // The trailing $match only applies a $match absorbed along with an $unwind, if there is one.
+    _fromPipeline.back() = BSON("$match" << _additionalFilter.value_or(BSONObj()));
+    auto pipeline = uassertStatusOK(_bongod->makePipeline(_fromPipeline, _fromExpCtx));
+    ++_numQueries;
+    while (auto result = pipeline->getNext()) {
+        if (!hashJoin->addForeignDocument(std::move(*result))) {
+            _hashJoinThreshold = boost::none;
+            return;
+        }
+    }
+
+    hashJoin->doneAddingForeignDocuments();
+    _hashJoin = std::move(hashJoin);
+}
+
 DocumentSource::GetModPathsReturn DocumentSourceLookUp::getModifiedPaths() const {
     std::set<std::string> modifiedPaths{_as.fullPath()};
     if (_unwindSrc) {
@@ -282,6 +647,10 @@ Pipeline::SourceContainer::iterator DocumentSourceLookUp::doOptimizeAt(
 
 void DocumentSourceLookUp::dispose() {
     _pipeline.reset();
+    _hashJoin.reset();
+    _matches.clear();
+    _batch.clear();
+    _cache.clear();
     pSource->dispose();
 }
 
@@ -366,23 +735,16 @@ DocumentSource::GetNextResult DocumentSourceLookUp::unwindResult() {
     // Loop until we get a document that has at least one match.
     // Note we may return early from this loop if our source stage is exhausted or if the unwind
     // source was asked to return empty arrays and we get a document without a match.
-    while (!_pipeline || !_nextValue) {
-        auto nextInput = pSource->getNext();
+    while (!_nextValue) {
+        auto nextInput = getNextInput();
         if (!nextInput.isAdvanced()) {
             return nextInput;
         }
 
         _input = nextInput.releaseDocument();
 
-        BSONObj filter = _additionalFilter.value_or(BSONObj());
-        auto matchStage =
-            makeMatchStageFromInput(*_input, _localField, _foreignFieldFieldName, filter);
-        // We've already allocated space for the trailing $match stage in '_fromPipeline'.
-        _fromPipeline.back() = matchStage;
-        _pipeline = uassertStatusOK(_bongod->makePipeline(_fromPipeline, _fromExpCtx));
-
         _cursorIndex = 0;
-        _nextValue = _pipeline->getNext();
+        _nextValue = getNextMatch();
 
         if (_unwindSrc->preserveNullAndEmptyArrays() && !_nextValue) {
             // There were no results for this cursor, but the $unwind was asked to preserve empty
@@ -400,7 +762,7 @@ DocumentSource::GetNextResult DocumentSourceLookUp::unwindResult() {
 
     invariant(bool(_input) && bool(_nextValue));
     auto currentValue = *_nextValue;
-    _nextValue = _pipeline->getNext();
+    _nextValue = getNextMatch();
 
     // Move input document into output if this is the last or only result, otherwise perform a copy.
     MutableDocument output(_nextValue ? *_input : std::move(*_input));
@@ -439,6 +801,27 @@ void DocumentSourceLookUp::serializeToArray(std::vector<Value>& array, bool expl
                           ->getQuery());
         }
 
+        if (_bongod) {
+            long long estimatedForeignBytes = 0;
+            const auto threshold = computeHashJoinThreshold(&estimatedForeignBytes);
+            output[getSourceName()]["joinStrategy"] =
+                Value(threshold && *threshold == 0 ? "hashJoin"_sd : "nestedLoop"_sd);
+            if (threshold && *threshold > 0) {
+                output[getSourceName()]["hashJoinAfterInputs"] = Value(*threshold);
+            }
+            if (!threshold || *threshold > 0) {
+                output[getSourceName()]["batchSize"] = Value(computeBatchSize());
+            }
+
+            // How often the foreign collection was queried, and for how many values, by the time
+            // of the explain.
+            output[getSourceName()]["probes"] =
+                Value(DOC("inputs" << _numInputs << "queries" << _numQueries << "keysQueried"
+                                   << _numKeysQueried
+                                   << "keysFromCache"
+                                   << _numKeysFromCache));
+        }
+
         array.push_back(Value(output.freeze()));
     } else {
         array.push_back(Value(output.freeze()));
@@ -32,6 +32,7 @@
 #include "bongo/db/pipeline/document_source_match.h"
 #include "bongo/db/pipeline/document_source_unwind.h"
 #include "bongo/db/pipeline/expression.h"
+#include "bongo/db/pipeline/lookup_hash_join.h"
 #include "bongo/db/pipeline/lookup_set_cache.h"
 #include "bongo/db/pipeline/value_comparator.h"
 
@@ -40,6 +41,10 @@ namespace bongo {
 /**
  * Queries separate collection for equality matches with documents in the pipeline collection.
  * Adds matching documents to a new array field in the input document.
+ *
+ * The foreign collection is either queried once per batch of input documents (a nested loop join),
+ * or read once into a LookupHashJoin which each input document is then looked up in (a hash join).
+ * See computeHashJoinThreshold() for how the two are chosen between.
  */
 class DocumentSourceLookUp final : public DocumentSourceNeedsBongod,
                                    public SplittableDocumentSource {
@@ -127,6 +132,57 @@ private:
 
     GetNextResult unwindResult();
 
+    /**
+     * Returns the number of input documents after which a hash join is expected to be cheaper than
+     * carrying on with a nested loop join, or boost::none if a hash join should not be used. Sets
+     * 'estimatedForeignBytes' to the size of the foreign collection if it is known.
+     */
+    boost::optional<long long> computeHashJoinThreshold(long long* estimatedForeignBytes) const;
+
+    /**
+     * Returns how many input documents a nested loop join matches with a single query. Batches
+     * are only used on a 'foreignField' which LookupHashJoin can join on, as its keys are used to
+     * tell which input documents the matches of a batch belong to.
+     */
+    int computeBatchSize() const;
+
+    /**
+     * Returns the next input document, having set up the matches of the foreign collection for it
+     * to be read by getNextMatch(). Switches to a hash join once '_hashJoinThreshold' is reached.
+     */
+    GetNextResult getNextInput();
+
+    /**
+     * Fills '_batch' with 'firstInput' and the input documents after it, and queries the foreign
+     * collection once for those of their keys which are not in '_cache', caching the matches. The
+     * keys of an input document whose matches would otherwise come from more than one query are
+     * all queried for again.
+     */
+    void queryBatch(Document firstInput);
+
+    /**
+     * Does the work of getNextInput() for the next input document of '_batch', matching it from
+     * '_cache' in the order the foreign collection was queried in.
+     */
+    GetNextResult getNextBatchedInput();
+
+    /**
+     * Does the work of getNextInput() once the hash join has spilled.
+     */
+    GetNextResult getNextSpilledInput();
+
+    /**
+     * Returns the next match of the foreign collection for the last input document, or boost::none
+     * once there are no more.
+     */
+    boost::optional<Document> getNextMatch();
+
+    /**
+     * Reads the foreign collection into '_hashJoin'. Leaves '_hashJoin' unset and clears
+     * '_hashJoinThreshold' if the foreign collection did not fit in memory and may not be spilled.
+     */
+    void buildHashJoin();
+
     NamespaceString _fromNs;
     FieldPath _as;
     FieldPath _localField;
@@ -153,6 +209,37 @@ private:
     boost::intrusive_ptr<Pipeline> _pipeline;
     boost::optional<Document> _input;
     boost::optional<Document> _nextValue;
+
+    // Set on the first call to getNext(). The number of input documents joined so far is counted
+    // in '_numInputs' to decide when to switch to a hash join.
+    bool _joinPlanned = false;
+    boost::optional<long long> _hashJoinThreshold;
+    long long _numInputs = 0;
+    long long _estimatedForeignBytes = 0;
+
+    // Only set once joining by a hash join. '_matches' holds the matches of the last input document
+    // not yet returned by getNextMatch(). If the hash join was spilled, every input document has
+    // been handed to it once '_inputExhausted' is set.
+    std::unique_ptr<LookupHashJoin> _hashJoin;
+    std::vector<Document> _matches;
+    size_t _matchIndex = 0;
+    bool _inputExhausted = false;
+
+    // Used by a nested loop join with a '_batchSize' over 1. '_batch' holds the input documents of
+    // the current batch not yet returned along with their keys, and '_pendingInput' the pause or
+    // EOF which cut the batch short, if any. The matches of every key queried for are kept in
+    // '_cache' for as long as they fit in it, each along with the query which found it and its
+    // position in the results.
+    int _batchSize = 1;
+    std::deque<std::pair<Document, std::vector<Value>>> _batch;
+    boost::optional<GetNextResult> _pendingInput;
+    LookupSetCache _cache;
+
+    // Reported by explain. Counts the queries of the foreign collection, and the keys queried for
+    // or found in '_cache' by batches.
+    long long _numQueries = 0;
+    long long _numKeysQueried = 0;
+    long long _numKeysFromCache = 0;
 };
 
 }  // namespace bongo
@@ -30,6 +30,7 @@
 
 #include <boost/intrusive_ptr.hpp>
 #include <deque>
+#include <map>
 #include <vector>
 
 #include "bongo/bson/bsonmisc.h"
@@ -43,6 +44,9 @@
 #include "bongo/db/pipeline/field_path.h"
 #include "bongo/db/pipeline/stub_bongod_interface.h"
 #include "bongo/db/pipeline/value.h"
+#include "bongo/db/query/query_knobs.h"
+#include "bongo/unittest/temp_dir.h"
+#include "bongo/util/scopeguard.h"
 
 namespace bongo {
 namespace {
@@ -171,8 +175,31 @@ public:
         return pipeline;
     }
 
+    boost::optional<CollectionSizeEstimate> getCollectionSizeEstimate(
+        const NamespaceString& ns) final {
+        return CollectionSizeEstimate{_numRecords ? *_numRecords
+                                                  : static_cast<long long>(_mockResults.size()),
+                                      0};
+    }
+
+    bool hasEqualityIndexOn(const NamespaceString& ns,
+                            const FieldPath& path,
+                            const CollatorInterface* collator) final {
+        return _hasEqualityIndex;
+    }
+
+    void setNumRecords(long long numRecords) {
+        _numRecords = numRecords;
+    }
+
+    void setHasEqualityIndex(bool hasEqualityIndex) {
+        _hasEqualityIndex = hasEqualityIndex;
+    }
+
 private:
     deque<DocumentSource::GetNextResult> _mockResults;
+    boost::optional<long long> _numRecords;
+    bool _hasEqualityIndex = false;
 };
 
 TEST_F(DocumentSourceLookUpTest, ShouldPropagatePauses) {
@@ -277,6 +304,300 @@ TEST_F(DocumentSourceLookUpTest, ShouldPropagatePausesWhileUnwinding) {
     ASSERT_TRUE(lookup->getNext().isEOF());
 }
 
+/**
+ * Runs a $lookup of 'foreignContents' on the "foreignId" field of 'inputs', with the hash join
+ * enabled or not, and returns its results. Without the hash join, the foreign collection is queried
+ * once per 'batchSize' input documents.
+ */
+vector<Document> runLookup(const intrusive_ptr<ExpressionContextForTest>& expCtx,
+                           deque<DocumentSource::GetNextResult> inputs,
+                           deque<DocumentSource::GetNextResult> foreignContents,
+                           bool useHashJoin,
+                           int batchSize = 1) {
+    const bool oldUseHashJoin = internalDocumentSourceLookupUseHashJoin.load();
+    const int oldBatchSize = internalDocumentSourceLookupBatchSize.load();
+    ON_BLOCK_EXIT([oldUseHashJoin, oldBatchSize] {
+        internalDocumentSourceLookupUseHashJoin.store(oldUseHashJoin);
+        internalDocumentSourceLookupBatchSize.store(oldBatchSize);
+    });
+    internalDocumentSourceLookupUseHashJoin.store(useHashJoin);
+    internalDocumentSourceLookupBatchSize.store(batchSize);
+
+    NamespaceString fromNs("test", "foreign");
+    expCtx->setResolvedNamespace(fromNs, {fromNs, std::vector<BSONObj>{}});
+    auto lookupSpec = Document{{"$lookup",
+                                Document{{"from", fromNs.coll()},
+                                         {"localField", "foreignId"_sd},
+                                         {"foreignField", "fk"_sd},
+                                         {"as", "foreignDocs"_sd}}}}
+                          .toBson();
+    auto parsed = DocumentSourceLookUp::createFromBson(lookupSpec.firstElement(), expCtx);
+    auto lookup = static_cast<DocumentSourceLookUp*>(parsed.get());
+    auto mockLocalSource = DocumentSourceMock::create(std::move(inputs));
+    lookup->setSource(mockLocalSource.get());
+    lookup->injectBongodInterface(
+        std::make_shared<MockBongodInterface>(std::move(foreignContents)));
+
+    vector<Document> results;
+    for (auto next = lookup->getNext(); !next.isEOF(); next = lookup->getNext()) {
+        if (next.isAdvanced()) {
+            results.push_back(next.releaseDocument());
+        }
+    }
+    return results;
+}
+
+deque<DocumentSource::GetNextResult> joinInputs() {
+    return {Document{{"_id", 0}, {"foreignId", 1}},
+            Document{{"_id", 1}},
+            Document{{"_id", 2}, {"foreignId", vector<Value>{Value(1), Value(2), Value(1)}}},
+            DocumentSource::GetNextResult::makePauseExecution(),
+            Document{{"_id", 3}, {"foreignId", BSONNULL}},
+            Document{{"_id", 4}, {"foreignId", vector<Value>{Value(1), Value(2)}}},
+            Document{{"_id", 5}, {"foreignId", 3}},
+            Document{{"_id", 6}, {"foreignId", 2.0}}};
+}
+
+deque<DocumentSource::GetNextResult> joinForeignContents() {
+    return {Document{{"_id", 0}, {"fk", 1}},
+            Document{{"_id", 1}, {"fk", 2LL}},
+            Document{{"_id", 2}},
+            Document{{"_id", 3}, {"fk", vector<Value>{Value(1), Value(2)}}},
+            Document{{"_id", 4}, {"fk", BSONNULL}},
+            Document{{"_id", 5}, {"fk", 1.0}},
+            Document{{"_id", 6}, {"fk", vector<Value>{Value(BSONNULL), Value(2)}}}};
+}
+
+void assertSameResults(const vector<Document>& expected, const vector<Document>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_DOCUMENT_EQ(expected[i], actual[i]);
+    }
+}
+
+TEST_F(DocumentSourceLookUpTest, HashJoinShouldMatchNestedLoopJoin) {
+    auto expected = runLookup(getExpCtx(), joinInputs(), joinForeignContents(), false);
+    ASSERT_EQ(7U, expected.size());
+
+    // An array is joined on each of its elements, and each foreign document is found only once.
+    vector<Value> foreignIds;
+    for (auto&& foreignDoc : expected[2]["foreignDocs"].getArray()) {
+        foreignIds.push_back(foreignDoc["_id"]);
+    }
+    ASSERT_VALUE_EQ(Value(foreignIds),
+                    Value(vector<Value>{Value(0), Value(1), Value(3), Value(5), Value(6)}));
+
+    assertSameResults(expected, runLookup(getExpCtx(), joinInputs(), joinForeignContents(), true));
+}
+
+TEST_F(DocumentSourceLookUpTest, HashJoinShouldSpillToDiskIfAllowed) {
+    const int oldMaxMemoryBytes = internalDocumentSourceLookupHashJoinMaxMemoryBytes.load();
+    ON_BLOCK_EXIT([oldMaxMemoryBytes] {
+        internalDocumentSourceLookupHashJoinMaxMemoryBytes.store(oldMaxMemoryBytes);
+    });
+
+    auto expected = runLookup(getExpCtx(), joinInputs(), joinForeignContents(), false);
+
+    auto expCtx = getExpCtx();
+    unittest::TempDir tempDir("DocumentSourceLookUpTest");
+    expCtx->tempDir = tempDir.path();
+    expCtx->extSortAllowed = true;
+    internalDocumentSourceLookupHashJoinMaxMemoryBytes.store(1);
+    assertSameResults(expected, runLookup(expCtx, joinInputs(), joinForeignContents(), true));
+}
+
+TEST_F(DocumentSourceLookUpTest, HashJoinShouldFallBackToNestedLoopJoinIfNotAllowedToSpill) {
+    const int oldMaxMemoryBytes = internalDocumentSourceLookupHashJoinMaxMemoryBytes.load();
+    ON_BLOCK_EXIT([oldMaxMemoryBytes] {
+        internalDocumentSourceLookupHashJoinMaxMemoryBytes.store(oldMaxMemoryBytes);
+    });
+
+    auto expected = runLookup(getExpCtx(), joinInputs(), joinForeignContents(), false);
+
+    internalDocumentSourceLookupHashJoinMaxMemoryBytes.store(1);
+    assertSameResults(expected, runLookup(getExpCtx(), joinInputs(), joinForeignContents(), true));
+}
+
+TEST_F(DocumentSourceLookUpTest, HashJoinShouldUnwindMatchesInForeignOrder) {
+    auto expCtx = getExpCtx();
+    NamespaceString fromNs("test", "foreign");
+    expCtx->setResolvedNamespace(fromNs, {fromNs, std::vector<BSONObj>{}});
+
+    auto lookupSpec = Document{{"$lookup",
+                                Document{{"from", fromNs.coll()},
+                                         {"localField", "foreignId"_sd},
+                                         {"foreignField", "fk"_sd},
+                                         {"as", "foreignDoc"_sd}}}}
+                          .toBson();
+    auto parsed = DocumentSourceLookUp::createFromBson(lookupSpec.firstElement(), expCtx);
+    auto lookup = static_cast<DocumentSourceLookUp*>(parsed.get());
+
+    const bool preserveNullAndEmptyArrays = true;
+    const boost::optional<std::string> includeArrayIndex = std::string("arrIndex");
+    lookup->setUnwindStage(DocumentSourceUnwind::create(
+        expCtx, "foreignDoc", preserveNullAndEmptyArrays, includeArrayIndex));
+
+    auto mockLocalSource = DocumentSourceMock::create(
+        {Document{{"foreignId", 1}}, Document{{"foreignId", 3}}, Document{{"foreignId", 2}}});
+    lookup->setSource(mockLocalSource.get());
+
+    deque<DocumentSource::GetNextResult> mockForeignContents{Document{{"_id", 0}, {"fk", 2}},
+                                                             Document{{"_id", 1}, {"fk", 1}},
+                                                             Document{{"_id", 2}, {"fk", 2}}};
+    lookup->injectBongodInterface(
+        std::make_shared<MockBongodInterface>(std::move(mockForeignContents)));
+
+    auto next = lookup->getNext();
+    ASSERT_TRUE(next.isAdvanced());
+    ASSERT_DOCUMENT_EQ(next.releaseDocument(),
+                       (Document{{"foreignId", 1},
+                                 {"foreignDoc", Document{{"_id", 1}, {"fk", 1}}},
+                                 {"arrIndex", 0LL}}));
+
+    next = lookup->getNext();
+    ASSERT_TRUE(next.isAdvanced());
+    ASSERT_DOCUMENT_EQ(next.releaseDocument(),
+                       (Document{{"foreignId", 3}, {"arrIndex", BSONNULL}}));
+
+    next = lookup->getNext();
+    ASSERT_TRUE(next.isAdvanced());
+    ASSERT_DOCUMENT_EQ(next.releaseDocument(),
+                       (Document{{"foreignId", 2},
+                                 {"foreignDoc", Document{{"_id", 0}, {"fk", 2}}},
+                                 {"arrIndex", 0LL}}));
+
+    next = lookup->getNext();
+    ASSERT_TRUE(next.isAdvanced());
+    ASSERT_DOCUMENT_EQ(next.releaseDocument(),
+                       (Document{{"foreignId", 2},
+                                 {"foreignDoc", Document{{"_id", 2}, {"fk", 2}}},
+                                 {"arrIndex", 1LL}}));
+
+    ASSERT_TRUE(lookup->getNext().isEOF());
+}
+
+TEST_F(DocumentSourceLookUpTest, ShouldExplainJoinStrategy) {
+    auto expCtx = getExpCtx();
+    NamespaceString fromNs("test", "foreign");
+    expCtx->setResolvedNamespace(fromNs, {fromNs, std::vector<BSONObj>{}});
+
+    auto lookupSpec = Document{{"$lookup",
+                                Document{{"from", fromNs.coll()},
+                                         {"localField", "foreignId"_sd},
+                                         {"foreignField", "_id"_sd},
+                                         {"as", "foreignDocs"_sd}}}}
+                          .toBson();
+    auto parsed = DocumentSourceLookUp::createFromBson(lookupSpec.firstElement(), expCtx);
+    auto lookup = static_cast<DocumentSourceLookUp*>(parsed.get());
+    auto bongod = std::make_shared<MockBongodInterface>(deque<DocumentSource::GetNextResult>{});
+    bongod->setNumRecords(1000);
+    lookup->injectBongodInterface(bongod);
+
+    // Without an index on the foreign field, the foreign collection is hashed right away.
+    vector<Value> explain;
+    lookup->serializeToArray(explain, true);
+    ASSERT_EQ(1U, explain.size());
+    ASSERT_VALUE_EQ(explain[0]["$lookup"]["joinStrategy"], Value("hashJoin"_sd));
+    ASSERT_TRUE(explain[0]["$lookup"]["hashJoinAfterInputs"].missing());
+
+    // With one, it is only hashed once the indexed queries would have cost as much.
+    bongod->setHasEqualityIndex(true);
+    explain.clear();
+    lookup->serializeToArray(explain, true);
+    ASSERT_EQ(1U, explain.size());
+    ASSERT_VALUE_EQ(explain[0]["$lookup"]["joinStrategy"], Value("nestedLoop"_sd));
+    ASSERT_VALUE_EQ(explain[0]["$lookup"]["hashJoinAfterInputs"], Value(10LL));
+}
+
+/**
+ * Sorts the matches of each of 'results' by _id, as a batch may find them in another order than
+ * querying once per input document does.
+ */
+TEST_F(DocumentSourceLookUpTest, BatchedNestedLoopJoinShouldMatchQueryingPerInput) {
+    auto expected = runLookup(getExpCtx(), joinInputs(), joinForeignContents(), false);
+    ASSERT_EQ(7U, expected.size());
+
+    // The matches must also be in the same order, including those of the input documents whose
+    // keys were cached by different batches.
+    for (int batchSize : {2, 3, 100}) {
+        assertSameResults(
+            expected,
+            runLookup(getExpCtx(), joinInputs(), joinForeignContents(), false, batchSize));
+    }
+}
+
+TEST_F(DocumentSourceLookUpTest, BatchedNestedLoopJoinShouldQueryOnlyForUncachedKeys) {
+    const bool oldUseHashJoin = internalDocumentSourceLookupUseHashJoin.load();
+    const int oldBatchSize = internalDocumentSourceLookupBatchSize.load();
+    ON_BLOCK_EXIT([oldUseHashJoin, oldBatchSize] {
+        internalDocumentSourceLookupUseHashJoin.store(oldUseHashJoin);
+        internalDocumentSourceLookupBatchSize.store(oldBatchSize);
+    });
+    internalDocumentSourceLookupUseHashJoin.store(false);
+    internalDocumentSourceLookupBatchSize.store(3);
+
+    auto expCtx = getExpCtx();
+    NamespaceString fromNs("test", "foreign");
+    expCtx->setResolvedNamespace(fromNs, {fromNs, std::vector<BSONObj>{}});
+    auto lookupSpec = Document{{"$lookup",
+                                Document{{"from", fromNs.coll()},
+                                         {"localField", "foreignId"_sd},
+                                         {"foreignField", "fk"_sd},
+                                         {"as", "foreignDocs"_sd}}}}
+                          .toBson();
+    auto parsed = DocumentSourceLookUp::createFromBson(lookupSpec.firstElement(), expCtx);
+    auto lookup = static_cast<DocumentSourceLookUp*>(parsed.get());
+
+    // The pause cuts the first batch short. The last batch only needs keys which are cached.
+    auto mockLocalSource =
+        DocumentSourceMock::create({Document{{"foreignId", 1}},
+                                    Document{{"foreignId", 1}},
+                                    DocumentSource::GetNextResult::makePauseExecution(),
+                                    Document{{"foreignId", 2}},
+                                    Document{{"foreignId", 2}},
+                                    Document{{"foreignId", 3}},
+                                    Document{{"foreignId", 1}},
+                                    Document{{"foreignId", 3}},
+                                    Document{{"foreignId", 2}}});
+    lookup->setSource(mockLocalSource.get());
+
+    deque<DocumentSource::GetNextResult> mockForeignContents{
+        Document{{"_id", 0}, {"fk", 1}},
+        Document{{"_id", 1}, {"fk", 2}},
+        Document{{"_id", 2}, {"fk", vector<Value>{Value(1), Value(3)}}}};
+    lookup->injectBongodInterface(
+        std::make_shared<MockBongodInterface>(std::move(mockForeignContents)));
+
+    const std::map<int, size_t> expectedNumMatches{{1, 2U}, {2, 1U}, {3, 1U}};
+    size_t numResults = 0;
+    for (int i = 0; i < 2; ++i) {
+        auto next = lookup->getNext();
+        ASSERT_TRUE(next.isAdvanced());
+        ASSERT_EQ(2U, next.getDocument()["foreignDocs"].getArrayLength());
+        ++numResults;
+    }
+    ASSERT_TRUE(lookup->getNext().isPaused());
+    for (auto next = lookup->getNext(); !next.isEOF(); next = lookup->getNext()) {
+        ASSERT_TRUE(next.isAdvanced());
+        auto result = next.releaseDocument();
+        ASSERT_EQ(expectedNumMatches.at(result["foreignId"].getInt()),
+                  result["foreignDocs"].getArrayLength());
+        ++numResults;
+    }
+    ASSERT_EQ(8U, numResults);
+
+    vector<Value> explain;
+    lookup->serializeToArray(explain, true);
+    ASSERT_EQ(1U, explain.size());
+    ASSERT_VALUE_EQ(explain[0]["$lookup"]["joinStrategy"], Value("nestedLoop"_sd));
+    ASSERT_VALUE_EQ(explain[0]["$lookup"]["batchSize"], Value(3));
+    ASSERT_VALUE_EQ(explain[0]["$lookup"]["probes"],
+                    Value(Document{{"inputs", 8LL},
+                                   {"queries", 2LL},
+                                   {"keysQueried", 3LL},
+                                   {"keysFromCache", 3LL}}));
+}
+
 TEST_F(DocumentSourceLookUpTest, LookupReportsAsFieldIsModified) {
     auto expCtx = getExpCtx();
     NamespaceString fromNs("test", "foreign");
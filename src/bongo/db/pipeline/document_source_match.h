@@ -32,6 +32,7 @@
 #include <utility>
 
 #include "bongo/client/connpool.h"
+#include "bongo/db/matcher/compiled_match_expression.h"
 #include "bongo/db/matcher/matcher.h"
 #include "bongo/db/pipeline/document_source.h"
 
@@ -150,6 +151,10 @@ private:
 
     std::unique_ptr<MatchExpression> _expression;
 
+    // '_expression' compiled for matching, on the first call to getNext(). The pipeline is
+    // optimized, which may replace '_expression', before it is executed.
+    std::unique_ptr<CompiledMatchExpression> _compiledExpression;
+
     // Cache the dependencies so that we know what fields we need to serialize to BSON for matching.
     DepsTracker _dependencies;
 
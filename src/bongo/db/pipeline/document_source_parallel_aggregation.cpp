@@ -0,0 +1,338 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kQuery
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/pipeline/document_source_parallel_aggregation.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "bongo/db/catalog/collection.h"
+#include "bongo/db/client.h"
+#include "bongo/db/concurrency/d_concurrency.h"
+#include "bongo/db/db_raii.h"
+#include "bongo/db/operation_context.h"
+#include "bongo/db/pipeline/pipeline.h"
+#include "bongo/db/pipeline/pipeline_d.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/util/concurrency/work_stealing_thread_pool.h"
+#include "bongo/util/bongoutils/str.h"
+#include "bongo/util/processinfo.h"
+#include "bongo/util/scopeguard.h"
+
+namespace bongo {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+namespace {
+
+/**
+ * Returns the pool whose threads run the ranges of every DocumentSourceParallelAggregation. It has
+ * a thread per core, each with its own Client, and is never destroyed.
+ */
+WorkStealingThreadPool* getAggregationPool() {
+    static WorkStealingThreadPool* const pool = [] {
+        ProcessInfo processInfo;
+        WorkStealingThreadPool::Options options;
+        options.poolName = "ParallelAggregation";
+        options.numThreads = std::max<size_t>(
+            1, processInfo.getNumAvailableCores().value_or(processInfo.getNumCores()));
+        options.onCreateThread = [](const std::string& threadName) {
+            Client::initThread(threadName.c_str());
+        };
+        auto pool = new WorkStealingThreadPool(std::move(options));
+        pool->startup();
+        return pool;
+    }();
+    return pool;
+}
+
+}  // namespace
+
+class DocumentSourceParallelAggregation::PartitionState
+    : public std::enable_shared_from_this<DocumentSourceParallelAggregation::PartitionState> {
+public:
+    PartitionState(const Collection* collection, vector<RecordId> boundaries)
+        : _collection(collection),
+          _nss(collection->ns()),
+          _boundaries(std::move(boundaries)),
+          _operations(_boundaries.size() + 1, nullptr) {}
+
+    size_t getNumPartitions() const {
+        return _boundaries.size() + 1;
+    }
+
+    /**
+     * Schedules each of 'pipelines' to be run over the range with the same index. The pipelines
+     * must not be attached to an OperationContext.
+     */
+    void start(vector<intrusive_ptr<Pipeline>> pipelines) {
+        invariant(pipelines.size() == getNumPartitions());
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _numPartitionsLeft = pipelines.size();
+        for (size_t i = 0; i < pipelines.size() && !_cancelled && _status.isOK(); ++i) {
+            auto self = shared_from_this();
+            auto pipeline = std::move(pipelines[i]);
+            Status status = getAggregationPool()->schedule(
+                [self, i, pipeline] { self->_runPartition(i, pipeline); });
+            if (!status.isOK()) {
+                _status = status;
+                _resultsReady.notify_all();
+            }
+        }
+    }
+
+    /**
+     * Moves the results of a range which has been run into 'results', waiting for one if need be.
+     * Sets 'isDone' instead if every range has had its results taken, or the ranges have been
+     * cancelled. Throws if 'opCtx' is interrupted while waiting, or if a range could not be run.
+     */
+    void takeResults(OperationContext* opCtx, vector<Document>* results, bool* isDone) {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        opCtx->waitForConditionOrInterrupt(_resultsReady, lk, [this] {
+            return _cancelled || !_status.isOK() || !_results.empty() || _numPartitionsLeft == 0;
+        });
+        uassertStatusOK(_status);
+
+        if (_results.empty()) {
+            *isDone = true;
+            return;
+        }
+
+        *results = std::move(_results.front());
+        _results.pop_front();
+    }
+
+    /**
+     * Stops the ranges which have yet to be run from running, interrupts those being run, and
+     * drops the results which have not been taken.
+     */
+    void cancel() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _cancelled = true;
+        _results.clear();
+        _resultsReady.notify_all();
+        for (OperationContext* opCtx : _operations) {
+            if (opCtx) {
+                stdx::lock_guard<Client> clientLock(*opCtx->getClient());
+                opCtx->markKilled();
+            }
+        }
+    }
+
+private:
+    /**
+     * Runs 'pipeline' over the range at 'index' with an OperationContext of its own, and hands
+     * over what it outputs.
+     */
+    void _runPartition(size_t index, intrusive_ptr<Pipeline> pipeline) {
+        vector<Document> results;
+        Status status = Status::OK();
+        try {
+            auto opCtx = cc().makeOperationContext();
+            {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                if (_cancelled) {
+                    return;
+                }
+                _operations[index] = opCtx.get();
+            }
+            ON_BLOCK_EXIT([this, index] {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                _operations[index] = nullptr;
+            });
+
+            results = _runPipeline(opCtx.get(), index, std::move(pipeline));
+        } catch (const DBException& ex) {
+            status = ex.toStatus();
+        }
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_cancelled) {
+            return;
+        }
+        if (!status.isOK()) {
+            if (_status.isOK()) {
+                _status = status;
+            }
+        } else {
+            --_numPartitionsLeft;
+            if (!results.empty()) {
+                _results.push_back(std::move(results));
+            }
+        }
+        _resultsReady.notify_all();
+    }
+
+    vector<Document> _runPipeline(OperationContext* opCtx,
+                                  size_t index,
+                                  intrusive_ptr<Pipeline> pipeline) {
+        pipeline->reattachToOperationContext(opCtx);
+        ON_BLOCK_EXIT([&] {
+            // The PlanExecutor of the pipeline's cursor may only be destroyed under a lock on the
+            // collection, which it may still be registered with.
+            Lock::DBLock dbLock(opCtx->lockState(), _nss.db(), MODE_IS);
+            Lock::CollectionLock collLock(opCtx->lockState(), _nss.ns(), MODE_IS);
+            pipeline.reset();
+        });
+
+        {
+            AutoGetCollection autoColl(opCtx, _nss, MODE_IS);
+            if (autoColl.getCollection() != _collection) {
+                uasserted(ErrorCodes::QueryPlanKilled,
+                          str::stream() << "collection " << _nss.ns()
+                                        << " was dropped during a parallel aggregation");
+            }
+
+            const RecordId start = index == 0 ? RecordId() : _boundaries[index - 1];
+            const RecordId end = index == _boundaries.size() ? RecordId() : _boundaries[index];
+            PipelineD::addPartitionCursorSource(autoColl.getCollection(), pipeline, start, end);
+        }
+
+        vector<Document> results;
+        while (auto next = pipeline->getNext()) {
+            results.push_back(std::move(*next));
+        }
+        return results;
+    }
+
+    // Only compared with the collection the threads find, never dereferenced by them.
+    const Collection* const _collection;
+    const NamespaceString _nss;
+
+    // The ranges are [null, _boundaries[0]), [_boundaries[0], _boundaries[1]), ..., [_boundaries
+    // [n - 1], null), where a null RecordId is an end of the collection.
+    const vector<RecordId> _boundaries;
+
+    // Guards everything below.
+    stdx::mutex _mutex;
+    stdx::condition_variable _resultsReady;
+
+    // The OperationContext running each range, or null if the range is not being run.
+    vector<OperationContext*> _operations;
+
+    size_t _numPartitionsLeft = 0;
+
+    // The results of the ranges which have been run, but not yet taken.
+    std::deque<vector<Document>> _results;
+
+    bool _cancelled = false;
+    Status _status = Status::OK();
+};
+
+DocumentSourceParallelAggregation::DocumentSourceParallelAggregation(
+    const Collection* collection,
+    vector<BSONObj> partitionPipeline,
+    vector<RecordId> boundaries,
+    const intrusive_ptr<ExpressionContext>& expCtx)
+    : DocumentSource(expCtx),
+      _partitionPipeline(std::move(partitionPipeline)),
+      _numPartitions(boundaries.size() + 1),
+      _state(std::make_shared<PartitionState>(collection, std::move(boundaries))) {}
+
+intrusive_ptr<DocumentSourceParallelAggregation> DocumentSourceParallelAggregation::create(
+    const Collection* collection,
+    vector<BSONObj> partitionPipeline,
+    vector<RecordId> boundaries,
+    const intrusive_ptr<ExpressionContext>& expCtx) {
+    return new DocumentSourceParallelAggregation(
+        collection, std::move(partitionPipeline), std::move(boundaries), expCtx);
+}
+
+DocumentSourceParallelAggregation::~DocumentSourceParallelAggregation() {
+    _state->cancel();
+}
+
+const char* DocumentSourceParallelAggregation::getSourceName() const {
+    return "$parallelAggregation";
+}
+
+void DocumentSourceParallelAggregation::start() {
+    vector<intrusive_ptr<Pipeline>> pipelines;
+    for (size_t i = 0; i < _numPartitions; ++i) {
+        // Each copy outputs the partial state of its groups, as it would on a shard.
+        auto expCtx = pExpCtx->copyWith(pExpCtx->ns);
+        expCtx->inShard = true;
+
+        auto pipeline = uassertStatusOK(Pipeline::parse(_partitionPipeline, expCtx));
+        pipeline->optimizePipeline();
+        pipeline->detachFromOperationContext();
+        pipelines.push_back(std::move(pipeline));
+    }
+
+    _started = true;
+    _state->start(std::move(pipelines));
+}
+
+DocumentSource::GetNextResult DocumentSourceParallelAggregation::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    if (!_started) {
+        start();
+    }
+
+    if (_nextResult == _results.size()) {
+        _results.clear();
+        _nextResult = 0;
+
+        bool isDone = false;
+        _state->takeResults(pExpCtx->opCtx, &_results, &isDone);
+        if (isDone) {
+            return GetNextResult::makeEOF();
+        }
+    }
+
+    return std::move(_results[_nextResult++]);
+}
+
+void DocumentSourceParallelAggregation::dispose() {
+    _state->cancel();
+    _results.clear();
+    _nextResult = 0;
+}
+
+Value DocumentSourceParallelAggregation::serialize(bool explain) const {
+    // We never parse a DocumentSourceParallelAggregation, so we only serialize for explain.
+    if (!explain) {
+        return Value();
+    }
+
+    vector<Value> partitionPipeline(_partitionPipeline.begin(), _partitionPipeline.end());
+    return Value(DOC(getSourceName() << DOC("numPartitions"
+                                            << static_cast<long long>(_numPartitions)
+                                            << "pipeline"
+                                            << Value(std::move(partitionPipeline)))));
+}
+
+}  // namespace bongo
@@ -0,0 +1,104 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "bongo/db/pipeline/document_source.h"
+#include "bongo/db/record_id.h"
+
+namespace bongo {
+
+class Collection;
+
+/**
+ * Runs the stages of an aggregation up to its first $group as several pipelines at once, each over
+ * a range of the collection's RecordIds, and returns the partial groups they output for the
+ * merging half of the $group to combine. The pipeline is split just as a sharded aggregation's is
+ * split between the shards and the merger, with the ranges standing in for the shards.
+ *
+ * Each range is run by a thread of a process-wide pool, with an OperationContext, an
+ * ExpressionContext and a parsed copy of the pipeline of its own, since neither the expressions
+ * nor the documents of a pipeline may be used by several threads at once. A thread only locks the
+ * collection while its cursor reads a batch, so the aggregation never waits for it while holding
+ * a lock. Every copy of the $group has the memory limit of a $group of its own.
+ */
+class DocumentSourceParallelAggregation final : public DocumentSource {
+public:
+    // virtuals from DocumentSource
+    GetNextResult getNext() final;
+    const char* getSourceName() const final;
+    Value serialize(bool explain = false) const final;
+    bool isValidInitialSource() const final {
+        return true;
+    }
+    void dispose() final;
+
+    /**
+     * Creates a source which runs 'partitionPipeline' over each of the ranges that 'boundaries'
+     * split 'collection' into. 'partitionPipeline' is the serialization of the stages a sharded
+     * aggregation would run on the shards, and 'boundaries' must be sorted and distinct.
+     */
+    static boost::intrusive_ptr<DocumentSourceParallelAggregation> create(
+        const Collection* collection,
+        std::vector<BSONObj> partitionPipeline,
+        std::vector<RecordId> boundaries,
+        const boost::intrusive_ptr<ExpressionContext>& expCtx);
+
+    ~DocumentSourceParallelAggregation();
+
+    /**
+     * State shared with the threads running the ranges, which may outlive this stage.
+     */
+    class PartitionState;
+
+private:
+    DocumentSourceParallelAggregation(const Collection* collection,
+                                      std::vector<BSONObj> partitionPipeline,
+                                      std::vector<RecordId> boundaries,
+                                      const boost::intrusive_ptr<ExpressionContext>& expCtx);
+
+    /**
+     * Parses a copy of the pipeline for each range, and starts running them.
+     */
+    void start();
+
+    const std::vector<BSONObj> _partitionPipeline;
+    const size_t _numPartitions;
+
+    std::shared_ptr<PartitionState> _state;
+    bool _started = false;
+
+    // The results of the range being returned, and the position of the next one.
+    std::vector<Document> _results;
+    size_t _nextResult = 0;
+};
+
+}  // namespace bongo
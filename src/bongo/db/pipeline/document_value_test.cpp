@@ -112,6 +112,105 @@ TEST(DocumentConstruction, FromEmptyDocumentClone) {
     ASSERT_DOCUMENT_EQ(document, documentClone);
 }
 
+TEST(DocumentFromBson, UnmodifiedDocumentConvertsBackToTheSameBson) {
+    BSONObj obj = fromjson("{a: 1, b: {c: [1, {d: 2}]}, e: 'str'}");
+    Document document = fromBson(obj);
+    ASSERT_VALUE_EQ(Value(2), document.getNestedField(FieldPath("b.c")).getArray()[1]["d"]);
+    ASSERT_EQUALS(obj.objdata(), toBson(document).objdata());
+}
+
+TEST(DocumentFromBson, ModifiedFieldsKeepTheirPlace) {
+    Document document = fromBson(fromjson("{a: 1, b: {c: 1, d: 'x'}, e: 2, f: 3}"));
+    MutableDocument md(document);
+    md.remove("a");
+    md["b"]["c"] = Value(10);
+    md.setField("f", Value("y"_sd));
+    md.addField("g", Value(4));
+    Document modified = md.freeze();
+
+    ASSERT_EQUALS(4U, modified.size());
+    ASSERT_BSONOBJ_EQ(fromjson("{b: {c: 10, d: 'x'}, e: 2, f: 'y', g: 4}"), toBson(modified));
+    ASSERT_DOCUMENT_EQ(DOC("b" << DOC("c" << 10 << "d"
+                                          << "x"_sd)
+                               << "e"
+                               << 2
+                               << "f"
+                               << "y"_sd
+                               << "g"
+                               << 4),
+                       modified);
+    ASSERT_BSONOBJ_EQ(fromjson("{a: 1, b: {c: 1, d: 'x'}, e: 2, f: 3}"), toBson(document));
+}
+
+TEST(DocumentFromBson, LooksUpTheFirstOfDuplicateFields) {
+    Document document = fromBson(BSON("a" << 1 << "b" << 2 << "a" << 3));
+    ASSERT_EQUALS(3U, document.size());
+    ASSERT_VALUE_EQ(Value(1), document["a"]);
+    ASSERT_EQUALS(3, getNthField(document, 2).second.getInt());
+
+    MutableDocument md(document);
+    md["a"] = Value(10);
+    ASSERT_BSONOBJ_EQ(BSON("a" << 10 << "b" << 2 << "a" << 3), toBson(md.freeze()));
+}
+
+TEST(DocumentFromBson, FieldNamesStayValidWhileFieldsAreLookedUp) {
+    BSONObjBuilder bob;
+    for (int i = 0; i < 100; ++i) {
+        bob.append(str::stream() << "field" << i, i);
+    }
+    MutableDocument md(fromBson(bob.obj()));
+    md.addField("inserted", Value(true));
+    Document document = md.freeze();
+
+    vector<StringData> names;
+    for (FieldIterator it(document); it.more();) {
+        names.push_back(it.next().first);
+    }
+
+    // Looking fields up caches them, which may move the memory holding the inserted field.
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_VALUE_EQ(Value(i), document[std::string(str::stream() << "field" << i)]);
+    }
+    ASSERT_EQUALS(101U, names.size());
+    ASSERT_EQUALS("field7", names[7]);
+    ASSERT_EQUALS("inserted", names[100]);
+}
+
+TEST(DocumentFromBson, LookingUpFieldsDoesNotGrowTheApproximateSize) {
+    BSONObjBuilder bob;
+    for (int i = 0; i < 100; ++i) {
+        bob.append(str::stream() << "field" << i, i);
+    }
+    Document document = fromBson(bob.obj());
+
+    // The first lookup makes room for every field, and ints take no memory beyond their Value.
+    ASSERT_VALUE_EQ(Value(0), document["field0"]);
+    const size_t size = document.getApproximateSize();
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_VALUE_EQ(Value(i), document[std::string(str::stream() << "field" << i)]);
+    }
+    ASSERT_EQUALS(size, document.getApproximateSize());
+}
+
+TEST(DocumentFromBson, ApproximateSizeCountsBuffersKeptWhileFieldsAreLookedUp) {
+    BSONObjBuilder bob;
+    for (int i = 0; i < 100; ++i) {
+        bob.append(str::stream() << "field" << i, i);
+    }
+    MutableDocument md(fromBson(bob.obj()));
+    md.addField("inserted", Value(true));
+    Document document = md.freeze();
+    const size_t size = document.getApproximateSize();
+
+    // The buffer was sized for the inserted field alone, so it moves as fields are cached. The
+    // buffers it moved out of are kept alive, and counted.
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_VALUE_EQ(Value(i), document[std::string(str::stream() << "field" << i)]);
+    }
+    ASSERT_GREATER_THAN_OR_EQUALS(document.getApproximateSize(),
+                                  size + 100 * sizeof(ValueElement));
+}
+
 /** Add Document fields. */
 class AddField {
 public:
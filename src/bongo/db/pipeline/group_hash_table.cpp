@@ -0,0 +1,379 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/pipeline/group_hash_table.h"
+
+#include <limits>
+
+#include "bongo/db/pipeline/expression_context.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/util/assert_util.h"
+
+namespace bongo {
+
+/**
+ * The state of one accumulator for every group in the table, indexed by group.
+ */
+class GroupHashTable::Column {
+public:
+    virtual ~Column() = default;
+
+    /**
+     * Appends the initial state for a new group.
+     */
+    virtual void addGroup() = 0;
+
+    virtual void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) = 0;
+
+    virtual Value getValue(uint32_t group, bool toBeMerged) const = 0;
+
+    virtual void clear() = 0;
+
+    size_t getMemoryUsageBytes() const {
+        return _memUsageBytes;
+    }
+
+protected:
+    size_t _memUsageBytes = 0;
+};
+
+namespace {
+
+template <typename State>
+class ColumnOf : public GroupHashTable::Column {
+public:
+    void addGroup() final {
+        _states.emplace_back();
+        _memUsageBytes += sizeof(State);
+    }
+
+    void clear() final {
+        std::vector<State>().swap(_states);
+        _memUsageBytes = 0;
+    }
+
+protected:
+    std::vector<State> _states;
+};
+
+class SumColumn final : public ColumnOf<AccumulatorSum::State> {
+public:
+    void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) final {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            _states[groups[i]].add(inputs[i]);
+        }
+    }
+
+    Value getValue(uint32_t group, bool toBeMerged) const final {
+        return _states[group].getValue(toBeMerged);
+    }
+};
+
+class AvgColumn final : public ColumnOf<AccumulatorAvg::State> {
+public:
+    void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) final {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            _states[groups[i]].add(inputs[i]);
+        }
+    }
+
+    Value getValue(uint32_t group, bool toBeMerged) const final {
+        return _states[group].getValue(toBeMerged);
+    }
+};
+
+/**
+ * Mirrors AccumulatorMinMax.
+ */
+class MinMaxColumn final : public ColumnOf<Value> {
+public:
+    MinMaxColumn(const ValueComparator& comparator, AccumulatorMinMax::Sense sense)
+        : _comparator(comparator), _sense(sense) {}
+
+    void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) final {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            const Value& input = inputs[i];
+            // nullish values should have no impact on result
+            if (input.nullish())
+                continue;
+
+            Value& val = _states[groups[i]];
+            if (val.missing() || compare(val, input) * _sense > 0) {
+                _memUsageBytes += input.getApproximateSize();
+                _memUsageBytes -= val.getApproximateSize();
+                val = input;
+            }
+        }
+    }
+
+    Value getValue(uint32_t group, bool toBeMerged) const final {
+        const Value& val = _states[group];
+        return val.missing() ? Value(BSONNULL) : val;
+    }
+
+private:
+    int compare(const Value& lhs, const Value& rhs) const {
+        // As in GroupHashTable::isSameKey(), skip the comparator for integers of the same type.
+        if (lhs.getType() == rhs.getType()) {
+            switch (lhs.getType()) {
+                case NumberInt:
+                    return lhs.getInt() < rhs.getInt() ? -1 : lhs.getInt() > rhs.getInt();
+                case NumberLong:
+                    return lhs.getLong() < rhs.getLong() ? -1 : lhs.getLong() > rhs.getLong();
+                default:
+                    break;
+            }
+        }
+        return _comparator.compare(lhs, rhs);
+    }
+
+    const ValueComparator _comparator;
+    const AccumulatorMinMax::Sense _sense;
+};
+
+struct FirstState {
+    bool haveFirst = false;
+    Value first;
+};
+
+/**
+ * Mirrors AccumulatorFirst, which remembers the first value even if it is missing.
+ */
+class FirstColumn final : public ColumnOf<FirstState> {
+public:
+    void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) final {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            FirstState& state = _states[groups[i]];
+            if (!state.haveFirst) {
+                state.haveFirst = true;
+                state.first = inputs[i];
+                _memUsageBytes += state.first.getApproximateSize() - sizeof(Value);
+            }
+        }
+    }
+
+    Value getValue(uint32_t group, bool toBeMerged) const final {
+        return _states[group].first;
+    }
+};
+
+/**
+ * Mirrors AccumulatorLast.
+ */
+class LastColumn final : public ColumnOf<Value> {
+public:
+    void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) final {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            Value& last = _states[groups[i]];
+            _memUsageBytes += inputs[i].getApproximateSize();
+            _memUsageBytes -= last.getApproximateSize();
+            last = inputs[i];
+        }
+    }
+
+    Value getValue(uint32_t group, bool toBeMerged) const final {
+        return _states[group];
+    }
+};
+
+/**
+ * Mirrors AccumulatorPush.
+ */
+class PushColumn final : public ColumnOf<std::vector<Value>> {
+public:
+    void process(const std::vector<uint32_t>& groups, const std::vector<Value>& inputs) final {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            if (!inputs[i].missing()) {
+                _states[groups[i]].push_back(inputs[i]);
+                _memUsageBytes += inputs[i].getApproximateSize();
+            }
+        }
+    }
+
+    Value getValue(uint32_t group, bool toBeMerged) const final {
+        return Value(_states[group]);
+    }
+};
+
+std::unique_ptr<GroupHashTable::Column> makeColumn(Accumulator::Factory factory,
+                                                   const ValueComparator& comparator) {
+    if (factory == &AccumulatorSum::create)
+        return stdx::make_unique<SumColumn>();
+    if (factory == &AccumulatorAvg::create)
+        return stdx::make_unique<AvgColumn>();
+    if (factory == &AccumulatorMin::create)
+        return stdx::make_unique<MinMaxColumn>(comparator, AccumulatorMinMax::MIN);
+    if (factory == &AccumulatorMax::create)
+        return stdx::make_unique<MinMaxColumn>(comparator, AccumulatorMinMax::MAX);
+    if (factory == &AccumulatorFirst::create)
+        return stdx::make_unique<FirstColumn>();
+    if (factory == &AccumulatorLast::create)
+        return stdx::make_unique<LastColumn>();
+    if (factory == &AccumulatorPush::create)
+        return stdx::make_unique<PushColumn>();
+    return nullptr;
+}
+
+/**
+ * Spreads the bits of 'hash', since the slot is picked from its low bits alone and Value hashes of
+ * small numbers differ mostly in their high bits.
+ */
+uint64_t mixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+}  // namespace
+
+bool GroupHashTable::canHandle(const std::vector<Accumulator::Factory>& factories) {
+    for (auto&& factory : factories) {
+        if (!makeColumn(factory, ValueComparator())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+GroupHashTable::GroupHashTable(const boost::intrusive_ptr<ExpressionContext>& expCtx,
+                               const std::vector<Accumulator::Factory>& factories)
+    : _comparator(expCtx->getValueComparator()), _slots(kInitialCapacity) {
+    for (auto&& factory : factories) {
+        _columns.push_back(makeColumn(factory, _comparator));
+        invariant(_columns.back());
+    }
+}
+
+GroupHashTable::~GroupHashTable() = default;
+
+bool GroupHashTable::isSameKey(const Value& lhs, const Value& rhs) const {
+    // Integer keys are common, and much cheaper to compare directly than through the comparator.
+    if (lhs.getType() == rhs.getType()) {
+        switch (lhs.getType()) {
+            case NumberInt:
+                return lhs.getInt() == rhs.getInt();
+            case NumberLong:
+                return lhs.getLong() == rhs.getLong();
+            default:
+                break;
+        }
+    }
+    return _comparator.evaluate(lhs == rhs);
+}
+
+size_t GroupHashTable::findSlot(const Value& id, uint64_t hash) const {
+    const size_t mask = _slots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const uint32_t entry = _slots[slot];
+        if (entry == 0)
+            return slot;
+
+        const uint32_t group = entry - 1;
+        if (_hashes[group] == hash && isSameKey(_ids[group], id))
+            return slot;
+    }
+}
+
+void GroupHashTable::grow() {
+    std::vector<uint32_t>(_slots.size() * 2).swap(_slots);
+    const size_t mask = _slots.size() - 1;
+    for (size_t group = 0; group < _ids.size(); ++group) {
+        size_t slot = _hashes[group] & mask;
+        while (_slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        _slots[slot] = group + 1;
+    }
+}
+
+size_t GroupHashTable::findOrInsert(const std::vector<Value>& ids, std::vector<uint32_t>* groups) {
+    groups->resize(ids.size());
+    const size_t oldSize = _ids.size();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const uint64_t hash = mixHash(_comparator.hash(ids[i]));
+        size_t slot = findSlot(ids[i], hash);
+        if (_slots[slot] != 0) {
+            (*groups)[i] = _slots[slot] - 1;
+            continue;
+        }
+
+        invariant(_ids.size() < std::numeric_limits<uint32_t>::max());
+        const uint32_t group = _ids.size();
+        _ids.push_back(ids[i]);
+        _hashes.push_back(hash);
+        _idsBytes += ids[i].getApproximateSize();
+        for (auto&& column : _columns) {
+            column->addGroup();
+        }
+
+        if (_ids.size() * 2 > _slots.size()) {
+            grow();
+        } else {
+            _slots[slot] = group + 1;
+        }
+        (*groups)[i] = group;
+    }
+    return _ids.size() - oldSize;
+}
+
+void GroupHashTable::process(size_t accumulator,
+                             const std::vector<uint32_t>& groups,
+                             const std::vector<Value>& inputs) {
+    dassert(groups.size() == inputs.size());
+    _columns[accumulator]->process(groups, inputs);
+}
+
+Value GroupHashTable::getValue(size_t accumulator, uint32_t group, bool toBeMerged) const {
+    return _columns[accumulator]->getValue(group, toBeMerged);
+}
+
+size_t GroupHashTable::getMemoryUsageBytes() const {
+    size_t bytes = _idsBytes + _hashes.capacity() * sizeof(uint64_t) +
+        _slots.capacity() * sizeof(uint32_t);
+    for (auto&& column : _columns) {
+        bytes += column->getMemoryUsageBytes();
+    }
+    return bytes;
+}
+
+void GroupHashTable::clear() {
+    std::vector<uint32_t>(kInitialCapacity).swap(_slots);
+    std::vector<Value>().swap(_ids);
+    std::vector<uint64_t>().swap(_hashes);
+    _idsBytes = 0;
+    for (auto&& column : _columns) {
+        column->clear();
+    }
+}
+
+}  // namespace bongo
@@ -0,0 +1,144 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/intrusive_ptr.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/db/pipeline/accumulator.h"
+#include "bongo/db/pipeline/value.h"
+#include "bongo/db/pipeline/value_comparator.h"
+
+namespace bongo {
+
+class ExpressionContext;
+
+/**
+ * Maps the group keys of a $group stage to the state of its accumulators, for stages whose
+ * accumulators are all among $sum, $avg, $min, $max, $first, $last and $push.
+ *
+ * Keys are kept in one flat open-addressing array indexed by a densely numbered group, and each
+ * accumulator keeps the state of every group inline in a column of its own. Documents are added a
+ * batch at a time: the keys of the batch are looked up together, and then each column folds in its
+ * inputs for the whole batch, so that the accumulators are dispatched on once per batch rather than
+ * once per document.
+ *
+ * The state of $push, $min, $max, $first and $last grows with its input, and is counted in
+ * getMemoryUsageBytes() so that the caller can spill the table before it outgrows its budget.
+ */
+class GroupHashTable {
+    BONGO_DISALLOW_COPYING(GroupHashTable);
+
+public:
+    class Column;
+
+    /**
+     * Returns whether a table can hold the state of accumulators created by 'factories'.
+     */
+    static bool canHandle(const std::vector<Accumulator::Factory>& factories);
+
+    /**
+     * Creates an empty table for the accumulators created by 'factories', which must satisfy
+     * canHandle(). Keys are compared and hashed with the ValueComparator of 'expCtx'.
+     */
+    GroupHashTable(const boost::intrusive_ptr<ExpressionContext>& expCtx,
+                   const std::vector<Accumulator::Factory>& factories);
+    ~GroupHashTable();
+
+    /**
+     * Looks up the group of each of 'ids', adding a group with fresh accumulator state for ids not
+     * seen before, and sets (*groups)[i] to the group of ids[i]. Returns the number of groups
+     * added.
+     */
+    size_t findOrInsert(const std::vector<Value>& ids, std::vector<uint32_t>* groups);
+
+    /**
+     * Folds inputs[i] into the state of accumulator 'accumulator' for group groups[i], for every
+     * i. The vectors must have the same length.
+     */
+    void process(size_t accumulator,
+                 const std::vector<uint32_t>& groups,
+                 const std::vector<Value>& inputs);
+
+    /**
+     * Returns the result of accumulator 'accumulator' for 'group', in the same form as
+     * Accumulator::getValue().
+     */
+    Value getValue(size_t accumulator, uint32_t group, bool toBeMerged) const;
+
+    const Value& getId(uint32_t group) const {
+        return _ids[group];
+    }
+
+    /**
+     * Groups are numbered from zero in the order they were added.
+     */
+    size_t size() const {
+        return _ids.size();
+    }
+
+    bool empty() const {
+        return _ids.empty();
+    }
+
+    size_t getMemoryUsageBytes() const;
+
+    /**
+     * Removes all groups and releases their memory.
+     */
+    void clear();
+
+private:
+    static const size_t kInitialCapacity = 16;
+
+    /**
+     * Returns the slot where the group for 'id' is, or where it would be inserted.
+     */
+    size_t findSlot(const Value& id, uint64_t hash) const;
+
+    void grow();
+
+    bool isSameKey(const Value& lhs, const Value& rhs) const;
+
+    ValueComparator _comparator;
+
+    // Each slot holds one more than the number of the group it refers to, or 0 if empty. The
+    // number of slots is a power of two, and is kept at least twice the number of groups.
+    std::vector<uint32_t> _slots;
+    std::vector<Value> _ids;
+    std::vector<uint64_t> _hashes;
+    size_t _idsBytes = 0;
+
+    std::vector<std::unique_ptr<Column>> _columns;
+};
+
+}  // namespace bongo
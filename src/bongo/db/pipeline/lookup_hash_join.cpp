@@ -0,0 +1,383 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/pipeline/lookup_hash_join.h"
+
+#include <algorithm>
+
+#include "bongo/base/error_codes.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/util/assert_util.h"
+
+namespace bongo {
+
+namespace {
+
+// Bounds the number of files open at once while spilling.
+const size_t kMaxPartitions = 64;
+
+/**
+ * Orders the documents written out by a spilled join by their positions in their input.
+ */
+class PositionComparator {
+public:
+    int operator()(const std::pair<Value, Document>& lhs,
+                   const std::pair<Value, Document>& rhs) const {
+        const long long lhsPos = lhs.first.getLong();
+        const long long rhsPos = rhs.first.getLong();
+        return lhsPos < rhsPos ? -1 : (lhsPos > rhsPos ? 1 : 0);
+    }
+};
+
+}  // namespace
+
+bool LookupHashJoin::canJoinOn(const FieldPath& foreignField) {
+    return foreignField.getPathLength() == 1;
+}
+
+LookupHashJoin::LookupHashJoin(const ValueComparator& comparator,
+                               FieldPath localField,
+                               FieldPath foreignField,
+                               size_t maxMemoryUsageBytes,
+                               bool extSortAllowed,
+                               std::string tempDir,
+                               long long estimatedForeignBytes)
+    : _comparator(comparator),
+      _localField(std::move(localField)),
+      _foreignFieldName(foreignField.fullPath()),
+      _maxMemoryUsageBytes(maxMemoryUsageBytes),
+      _extSortAllowed(extSortAllowed),
+      _tempDir(std::move(tempDir)),
+      _estimatedForeignBytes(estimatedForeignBytes),
+      _table(_comparator.makeUnorderedValueMap<std::vector<size_t>>()) {
+    invariant(canJoinOn(foreignField));
+}
+
+LookupHashJoin::~LookupHashJoin() = default;
+
+std::vector<Value> LookupHashJoin::getForeignKeys(const ValueComparator& comparator,
+                                                   Value value) {
+    if (!value.isArray()) {
+        // Equality with null matches a missing field.
+        return {value.missing() ? Value(BSONNULL) : std::move(value)};
+    }
+
+    // An array is matched both as a whole and by each of its elements.
+    std::vector<Value> keys{value};
+    auto seen = comparator.makeUnorderedValueSet();
+    seen.insert(value);
+    for (auto&& elem : value.getArray()) {
+        if (seen.insert(elem).second) {
+            keys.push_back(elem);
+        }
+    }
+    return keys;
+}
+
+std::vector<Value> LookupHashJoin::getLocalKeys(const ValueComparator& comparator, Value value) {
+    if (!value.isArray()) {
+        uassert(ErrorCodes::BadValue,
+                "cannot compare to undefined",
+                value.getType() != BSONType::Undefined);
+        if (value.nullish()) {
+            // An equality with null also matches undefined, which is kept under its own key since
+            // the elements of an array value are matched with $in, which does not.
+            return {Value(BSONNULL), Value(BSONUndefined)};
+        }
+        return {std::move(value)};
+    }
+
+    // An array holding a regular expression is matched as a $or of equalities rather than with
+    // $in, which lets its null elements match undefined as well.
+    const auto& elems = value.getArray();
+    const bool matchedAsOr = std::any_of(
+        elems.begin(), elems.end(), [](const Value& elem) { return elem.getType() == RegEx; });
+
+    std::vector<Value> keys;
+    auto seen = comparator.makeUnorderedValueSet();
+    for (auto&& elem : elems) {
+        uassert(ErrorCodes::BadValue,
+                "cannot compare to undefined",
+                elem.getType() != BSONType::Undefined);
+        if (seen.insert(elem).second) {
+            keys.push_back(elem);
+        }
+    }
+    if (matchedAsOr && seen.count(Value(BSONNULL))) {
+        keys.push_back(Value(BSONUndefined));
+    }
+    return keys;
+}
+
+std::vector<Value> LookupHashJoin::foreignKeysOf(const Document& doc) const {
+    return getForeignKeys(_comparator, doc.getField(_foreignFieldName));
+}
+
+std::vector<Value> LookupHashJoin::localKeysOf(const Document& local) const {
+    return getLocalKeys(_comparator, local.getNestedField(_localField));
+}
+
+std::vector<size_t> LookupHashJoin::getPartitions(const std::vector<Value>& keys) const {
+    std::vector<size_t> partitions;
+    for (auto&& key : keys) {
+        partitions.push_back(_comparator.hash(key) % _numPartitions);
+    }
+    if (partitions.empty()) {
+        partitions.push_back(0);
+    }
+
+    std::sort(partitions.begin(), partitions.end());
+    partitions.erase(std::unique(partitions.begin(), partitions.end()), partitions.end());
+    return partitions;
+}
+
+void LookupHashJoin::addToTable(long long seq, Document doc, const std::vector<Value>& keys) {
+    const size_t pos = _foreignDocs.size();
+    _memoryUsageBytes += doc.getApproximateSize() + sizeof(std::pair<long long, Document>);
+    _foreignDocs.emplace_back(seq, std::move(doc));
+
+    for (auto&& key : keys) {
+        auto& positions = _table[key];
+        if (positions.empty()) {
+            _memoryUsageBytes += key.getApproximateSize();
+        }
+        positions.push_back(pos);
+        _memoryUsageBytes += sizeof(size_t);
+    }
+}
+
+void LookupHashJoin::clearTable() {
+    _foreignDocs.clear();
+    _table.clear();
+    _memoryUsageBytes = 0;
+}
+
+std::vector<size_t> LookupHashJoin::lookUp(const std::vector<Value>& keys) const {
+    std::vector<size_t> positions;
+    for (auto&& key : keys) {
+        auto it = _table.find(key);
+        if (it != _table.end()) {
+            positions.insert(positions.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    if (keys.size() > 1) {
+        // A foreign document may be found under more than one of the keys.
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    }
+    return positions;
+}
+
+bool LookupHashJoin::addForeignDocument(Document doc) {
+    const long long seq = _numForeignDocs++;
+    const auto keys = foreignKeysOf(doc);
+
+    if (_spilled) {
+        for (auto partition : getPartitions(keys)) {
+            writeToPartition(&_foreignWriters, partition, seq, doc);
+        }
+        return true;
+    }
+
+    addToTable(seq, std::move(doc), keys);
+    if (_memoryUsageBytes > _maxMemoryUsageBytes) {
+        if (!_extSortAllowed) {
+            return false;
+        }
+        spill();
+    }
+    return true;
+}
+
+void LookupHashJoin::spill() {
+    invariant(!_spilled);
+
+    // Aim for partitions which take up no more than half of the memory budget when they are read
+    // back, going by whichever of the estimate and what was read so far is larger.
+    const long long expectedBytes =
+        std::max(_estimatedForeignBytes, 2 * static_cast<long long>(_memoryUsageBytes));
+    const long long partitionBytes = std::max<long long>(1, _maxMemoryUsageBytes / 2);
+    _numPartitions =
+        std::min(kMaxPartitions, std::max<size_t>(2, expectedBytes / partitionBytes + 1));
+
+    _foreignWriters.resize(_numPartitions);
+    _spilled = true;
+
+    for (auto&& entry : _foreignDocs) {
+        for (auto partition : getPartitions(foreignKeysOf(entry.second))) {
+            writeToPartition(&_foreignWriters, partition, entry.first, entry.second);
+        }
+    }
+    clearTable();
+}
+
+void LookupHashJoin::writeToPartition(std::vector<std::unique_ptr<Writer>>* writers,
+                                      size_t partition,
+                                      long long seq,
+                                      const Document& doc) {
+    // Writers are only created once they have something to write, as the sorter does not read
+    // back empty files.
+    auto& writer = (*writers)[partition];
+    if (!writer) {
+        writer = stdx::make_unique<Writer>(SortOptions().TempDir(_tempDir));
+    }
+    writer->addAlreadySorted(Value(seq), doc);
+}
+
+void LookupHashJoin::doneAddingForeignDocuments() {
+    if (!_spilled) {
+        return;
+    }
+
+    for (auto&& writer : _foreignWriters) {
+        _foreignPartitions.emplace_back(writer ? writer->done() : nullptr);
+    }
+    _foreignWriters.clear();
+    _localWriters.resize(_numPartitions);
+}
+
+std::vector<Document> LookupHashJoin::probe(const Document& local) const {
+    invariant(!_spilled);
+
+    std::vector<Document> matches;
+    for (auto pos : lookUp(localKeysOf(local))) {
+        matches.push_back(_foreignDocs[pos].second);
+    }
+    return matches;
+}
+
+void LookupHashJoin::addLocalDocument(Document local) {
+    invariant(_spilled);
+
+    const long long seq = _numLocalDocs++;
+    for (auto partition : getPartitions(localKeysOf(local))) {
+        writeToPartition(&_localWriters, partition, seq, local);
+    }
+}
+
+void LookupHashJoin::doneAddingLocalDocuments() {
+    invariant(_spilled && !_output);
+
+    std::vector<std::shared_ptr<Iterator>> joinedPartitions;
+    for (size_t partition = 0; partition < _numPartitions; ++partition) {
+        if (!_localWriters[partition]) {
+            continue;
+        }
+        std::unique_ptr<Iterator> foreignDocs = std::move(_foreignPartitions[partition]);
+        std::unique_ptr<Iterator> localDocs(_localWriters[partition]->done());
+        _localWriters[partition].reset();
+
+        // A partition is read back whole, even if a common key makes it outgrow the memory budget.
+        clearTable();
+        while (foreignDocs && foreignDocs->more()) {
+            auto next = foreignDocs->next();
+            const auto keys = foreignKeysOf(next.second);
+            addToTable(next.first.getLong(), std::move(next.second), keys);
+        }
+
+        // The keys of an input document which hash into other partitions are not in the table, so
+        // each partition adds only the matches found under its own keys.
+        Writer joined(SortOptions().TempDir(_tempDir));
+        while (localDocs->more()) {
+            auto next = localDocs->next();
+            std::vector<Value> matches;
+            for (auto pos : lookUp(localKeysOf(next.second))) {
+                matches.push_back(Value(std::vector<Value>{Value(_foreignDocs[pos].first),
+                                                           Value(_foreignDocs[pos].second)}));
+            }
+            joined.addAlreadySorted(next.first,
+                                    Document{{"local", next.second}, {"matches", matches}});
+        }
+        joinedPartitions.emplace_back(joined.done());
+    }
+
+    clearTable();
+    _foreignPartitions.clear();
+    _localWriters.clear();
+    _output.reset(Iterator::merge(joinedPartitions, SortOptions(), PositionComparator()));
+}
+
+boost::optional<std::pair<Document, std::vector<Document>>> LookupHashJoin::getNextJoined() {
+    invariant(_output);
+
+    if (!_nextOutput) {
+        if (!_output->more()) {
+            return boost::none;
+        }
+        _nextOutput = _output->next();
+    }
+
+    const long long seq = _nextOutput->first.getLong();
+    Document local = _nextOutput->second["local"].getDocument();
+
+    std::vector<std::pair<long long, Document>> matches;
+    auto addMatches = [&matches](const Document& joined) {
+        for (auto&& match : joined["matches"].getArray()) {
+            matches.emplace_back(match[0].getLong(), match[1].getDocument());
+        }
+    };
+
+    addMatches(_nextOutput->second);
+    _nextOutput = boost::none;
+    while (_output->more()) {
+        auto next = _output->next();
+        if (next.first.getLong() != seq) {
+            _nextOutput = std::move(next);
+            break;
+        }
+        addMatches(next.second);
+    }
+
+    // An input document found in several partitions may have found a foreign document with keys
+    // in more than one of them.
+    using Match = std::pair<long long, Document>;
+    std::sort(matches.begin(), matches.end(), [](const Match& lhs, const Match& rhs) {
+        return lhs.first < rhs.first;
+    });
+    matches.erase(std::unique(matches.begin(),
+                              matches.end(),
+                              [](const Match& lhs, const Match& rhs) {
+                                  return lhs.first == rhs.first;
+                              }),
+                  matches.end());
+
+    std::vector<Document> docs;
+    docs.reserve(matches.size());
+    for (auto&& match : matches) {
+        docs.push_back(std::move(match.second));
+    }
+    return std::make_pair(std::move(local), std::move(docs));
+}
+
+}  // namespace bongo
+
+#include "bongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
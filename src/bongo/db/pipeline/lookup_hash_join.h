@@ -0,0 +1,227 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/db/pipeline/document.h"
+#include "bongo/db/pipeline/field_path.h"
+#include "bongo/db/pipeline/value.h"
+#include "bongo/db/pipeline/value_comparator.h"
+#include "bongo/db/sorter/sorter.h"
+
+namespace bongo {
+
+/**
+ * Joins the input documents of a $lookup stage with the documents of its foreign collection by
+ * hashing the foreign documents on the value of 'foreignField'. A foreign document is found by each
+ * value which an equality predicate on 'foreignField' would match it with: the value itself, each
+ * element of an array value, and null if the field is missing, null or undefined.
+ *
+ * All foreign documents are added before any input document is joined. While they fit in
+ * 'maxMemoryUsageBytes' they are kept in a single in-memory table, and input documents are joined
+ * one at a time by probe(). Once they outgrow it, and if 'extSortAllowed' is set, the foreign
+ * documents are split by the hash of their keys into partitions which are written to disk. The
+ * input documents must then all be added with addLocalDocument(), and are partitioned the same
+ * way. Each partition is joined in turn, and getNextJoined() returns the input documents in the
+ * order they were added.
+ *
+ * The matches of an input document are returned in the order their foreign documents were added.
+ */
+class LookupHashJoin {
+    BONGO_DISALLOW_COPYING(LookupHashJoin);
+
+public:
+    /**
+     * Returns whether a hash join can match the semantics of an equality predicate on
+     * 'foreignField'. Only paths of a single field are supported, as the query language's
+     * treatment of arrays along a dotted path is not mirrored here.
+     */
+    static bool canJoinOn(const FieldPath& foreignField);
+
+    /**
+     * Returns the distinct keys under which a foreign document whose 'foreignField' holds 'value'
+     * is found.
+     */
+    static std::vector<Value> getForeignKeys(const ValueComparator& comparator, Value value);
+
+    /**
+     * Returns the distinct keys which an input document whose 'localField' holds 'value' is joined
+     * on. These are the elements of an array, or otherwise the value itself. A missing or null
+     * value joins as both null and undefined. Throws if 'value' is or holds undefined.
+     *
+     * An input document matches exactly the foreign documents found under any of its keys.
+     */
+    static std::vector<Value> getLocalKeys(const ValueComparator& comparator, Value value);
+
+    /**
+     * Values are hashed and compared with 'comparator', which must outlive this join. The
+     * 'estimatedForeignBytes' are used to choose how many partitions to spill into.
+     */
+    LookupHashJoin(const ValueComparator& comparator,
+                   FieldPath localField,
+                   FieldPath foreignField,
+                   size_t maxMemoryUsageBytes,
+                   bool extSortAllowed,
+                   std::string tempDir,
+                   long long estimatedForeignBytes);
+    ~LookupHashJoin();
+
+    /**
+     * Adds the next document of the foreign collection. Returns false if the foreign documents no
+     * longer fit in memory and spilling them to disk is not allowed, in which case the join cannot
+     * be used.
+     */
+    bool addForeignDocument(Document doc);
+
+    /**
+     * Must be called once every foreign document has been added.
+     */
+    void doneAddingForeignDocuments();
+
+    /**
+     * Returns whether the foreign documents were spilled to disk, in which case input documents
+     * are joined with addLocalDocument() and getNextJoined() rather than probe().
+     */
+    bool isSpilled() const {
+        return _spilled;
+    }
+
+    /**
+     * Returns the foreign documents which 'local' joins with. Must not be called once spilled.
+     */
+    std::vector<Document> probe(const Document& local) const;
+
+    /**
+     * Adds the next input document of a spilled join.
+     */
+    void addLocalDocument(Document local);
+
+    /**
+     * Must be called once every input document of a spilled join has been added. Joins each
+     * partition in turn.
+     */
+    void doneAddingLocalDocuments();
+
+    /**
+     * Returns the next input document of a spilled join along with the foreign documents it joins
+     * with, or boost::none once every input document has been returned.
+     */
+    boost::optional<std::pair<Document, std::vector<Document>>> getNextJoined();
+
+    size_t getMemoryUsageBytes() const {
+        return _memoryUsageBytes;
+    }
+
+private:
+    using Iterator = SortIteratorInterface<Value, Document>;
+    using Writer = SortedFileWriter<Value, Document>;
+
+    /**
+     * Returns the keys of the foreign document 'doc', or of the input document 'local'.
+     */
+    std::vector<Value> foreignKeysOf(const Document& doc) const;
+    std::vector<Value> localKeysOf(const Document& local) const;
+
+    /**
+     * Returns the distinct partitions which 'keys' hash into. An input document without any keys
+     * still needs to be returned, so it is assigned to the first partition.
+     */
+    std::vector<size_t> getPartitions(const std::vector<Value>& keys) const;
+
+    /**
+     * Adds the foreign document 'doc', found under 'keys', to the in-memory table.
+     */
+    void addToTable(long long seq, Document doc, const std::vector<Value>& keys);
+
+    /**
+     * Empties the in-memory table.
+     */
+    void clearTable();
+
+    /**
+     * Returns the positions in '_foreignDocs' of the foreign documents found under any of 'keys',
+     * in increasing order.
+     */
+    std::vector<size_t> lookUp(const std::vector<Value>& keys) const;
+
+    /**
+     * Writes the in-memory table to disk, split into partitions, and empties it.
+     */
+    void spill();
+
+    /**
+     * Writes 'doc', at position 'seq' of its input, to 'partition' of 'writers'.
+     */
+    void writeToPartition(std::vector<std::unique_ptr<Writer>>* writers,
+                          size_t partition,
+                          long long seq,
+                          const Document& doc);
+
+    const ValueComparator _comparator;
+    const FieldPath _localField;
+    const std::string _foreignFieldName;
+    const size_t _maxMemoryUsageBytes;
+    const bool _extSortAllowed;
+    const std::string _tempDir;
+    const long long _estimatedForeignBytes;
+
+    // The foreign documents held in memory along with their positions in the foreign input, and a
+    // table from each key to the positions in '_foreignDocs' of the documents found under it.
+    std::vector<std::pair<long long, Document>> _foreignDocs;
+    ValueUnorderedMap<std::vector<size_t>> _table;
+    size_t _memoryUsageBytes = 0;
+    long long _numForeignDocs = 0;
+
+    bool _spilled = false;
+    size_t _numPartitions = 0;
+    long long _numLocalDocs = 0;
+
+    // Used only once spilled. Each partition writes out its foreign and input documents keyed by
+    // their positions in their inputs, which keeps every file in that order. Partitions which
+    // nothing was written to are left null.
+    std::vector<std::unique_ptr<Writer>> _foreignWriters;
+    std::vector<std::unique_ptr<Writer>> _localWriters;
+    std::vector<std::unique_ptr<Iterator>> _foreignPartitions;
+
+    // Merges the joined input documents of every partition back into their original order. An
+    // input document which is found in several partitions is returned by each of them, and these
+    // are combined by getNextJoined(), which buffers the first result of the next input document in
+    // '_nextOutput'.
+    std::unique_ptr<Iterator> _output;
+    boost::optional<std::pair<Value, Document>> _nextOutput;
+};
+
+}  // namespace bongo
@@ -96,31 +96,25 @@ public:
      * likely we don't want to evict it (i.e., we want to make sure it isn't at the back).
      */
     void insert(Value key, Document doc) {
-        // Get an iterator to the middle of the container.
-        size_t middle = size() / 2;
-        auto it = _container.begin();
-        std::advance(it, middle);
-        const auto keySize = key.getApproximateSize();
         const auto docSize = doc.getApproximateSize();
-
-        // Find the cache entry, or create one if it doesn't exist yet.
-        auto insertionResult = _container.insert(it, {std::move(key), {}});
-        if (insertionResult.second) {
-            _memoryUsage += keySize;
-        } else {
-            // We did not insert due to a duplicate key. Update the cached doc, moving it to the
-            // middle of the cache.
-            _container.relocate(it, insertionResult.first);
-        }
+        auto it = findOrInsertKey(std::move(key));
 
         // Add the doc to the cache entry.
-        _container.modify(insertionResult.first,
-                          [&doc](std::pair<Value, std::vector<Document>>& entry) {
-                              entry.second.push_back(std::move(doc));
-                          });
+        _container.modify(it, [&doc](std::pair<Value, std::vector<Document>>& entry) {
+            entry.second.push_back(std::move(doc));
+        });
         _memoryUsage += docSize;
     }
 
+    /**
+     * Insert "key" without any values if it is not already present, and move it to the middle of
+     * the cache as insert() does. This lets a key which was looked up and found to have no values
+     * be cached as well.
+     */
+    void insertKey(Value key) {
+        findOrInsertKey(std::move(key));
+    }
+
     /**
      * Evict the least-recently-used item.
      */
@@ -129,18 +123,17 @@ public:
             return;
         }
 
-        const Cached& pair = _container.back();
-
-        size_t keySize = pair.first.getApproximateSize();
-        invariant(keySize <= _memoryUsage);
-        _memoryUsage -= keySize;
+        eraseEntry(std::prev(_container.end()));
+    }
 
-        for (auto&& elem : pair.second) {
-            size_t valueSize = static_cast<size_t>(elem.getApproximateSize());
-            invariant(valueSize <= _memoryUsage);
-            _memoryUsage -= valueSize;
+    /**
+     * Remove "key" and its values from the cache, if it is present.
+     */
+    void erase(const Value& key) {
+        auto it = boost::multi_index::get<1>(_container).find(key);
+        if (it != boost::multi_index::get<1>(_container).end()) {
+            eraseEntry(boost::multi_index::project<0>(_container, it));
         }
-        _container.erase(std::prev(_container.end()));
     }
 
     /**
@@ -191,6 +184,44 @@ public:
     }
 
 private:
+    /**
+     * Returns the entry for "key", creating it if it doesn't exist yet, having moved it to the
+     * middle of the cache.
+     */
+    IndexedContainer::iterator findOrInsertKey(Value key) {
+        // Get an iterator to the middle of the container.
+        size_t middle = size() / 2;
+        auto it = _container.begin();
+        std::advance(it, middle);
+        const auto keySize = key.getApproximateSize();
+
+        // Find the cache entry, or create one if it doesn't exist yet.
+        auto insertionResult = _container.insert(it, {std::move(key), {}});
+        if (insertionResult.second) {
+            _memoryUsage += keySize;
+        } else {
+            // We did not insert due to a duplicate key. Move the entry to the middle of the cache.
+            _container.relocate(it, insertionResult.first);
+        }
+        return insertionResult.first;
+    }
+
+    /**
+     * Erases the entry at "it", no longer counting its memory usage.
+     */
+    void eraseEntry(IndexedContainer::iterator it) {
+        size_t keySize = it->first.getApproximateSize();
+        invariant(keySize <= _memoryUsage);
+        _memoryUsage -= keySize;
+
+        for (auto&& elem : it->second) {
+            size_t valueSize = static_cast<size_t>(elem.getApproximateSize());
+            invariant(valueSize <= _memoryUsage);
+            _memoryUsage -= valueSize;
+        }
+        _container.erase(it);
+    }
+
     IndexedContainer _container;
 
     size_t _memoryUsage = 0;
@@ -119,6 +119,38 @@ TEST(LookupSetCacheTest, InsertDoesPutKeyInMiddle) {
     ASSERT_TRUE(cache[Value(1)]);
 }
 
+TEST(LookupSetCacheTest, InsertKeyDoesCacheKeyWithoutValues) {
+    LookupSetCache cache(defaultComparator);
+
+    cache.insertKey(Value(0));
+    cache.insert(Value(1), intToDoc(1));
+    cache.insertKey(Value(1));
+
+    ASSERT_TRUE(cache[Value(0)]);
+    ASSERT_TRUE(cache[Value(0)]->empty());
+    ASSERT_EQ(1U, cache[Value(1)]->size());
+    ASSERT_FALSE(cache[Value(2)]);
+
+    cache.evictDownTo(0);
+    ASSERT_EQ(0U, cache.size());
+}
+
+TEST(LookupSetCacheTest, EraseDoesRemoveKeyAndItsMemoryUsage) {
+    LookupSetCache cache(defaultComparator);
+
+    cache.insert(Value(0), intToDoc(0));
+    cache.insert(Value(1), intToDoc(1));
+    cache.erase(Value(0));
+    cache.erase(Value(2));
+
+    ASSERT_FALSE(cache[Value(0)]);
+    ASSERT_EQ(1U, cache[Value(1)]->size());
+
+    // Only the remaining key and value are counted.
+    cache.evictDownTo(Value(1).getApproximateSize() + intToDoc(1).getApproximateSize());
+    ASSERT_TRUE(cache[Value(1)]);
+}
+
 TEST(LookupSetCacheTest, EvictDoesRespectMemoryUsage) {
     LookupSetCache cache(defaultComparator);
 
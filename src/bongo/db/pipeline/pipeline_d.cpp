@@ -37,29 +37,41 @@
 #include "bongo/db/catalog/collection.h"
 #include "bongo/db/catalog/database.h"
 #include "bongo/db/catalog/document_validation.h"
+#include "bongo/db/catalog/index_catalog.h"
+#include "bongo/db/catalog/index_catalog_entry.h"
+#include "bongo/db/client.h"
 #include "bongo/db/concurrency/d_concurrency.h"
 #include "bongo/db/concurrency/write_conflict_exception.h"
 #include "bongo/db/db_raii.h"
 #include "bongo/db/dbdirectclient.h"
+#include "bongo/db/exec/collection_scan.h"
 #include "bongo/db/exec/fetch.h"
 #include "bongo/db/exec/index_iterator.h"
 #include "bongo/db/exec/multi_iterator.h"
+#include "bongo/db/exec/parallel_collection_scan.h"
 #include "bongo/db/exec/shard_filter.h"
 #include "bongo/db/exec/working_set.h"
 #include "bongo/db/index/index_access_method.h"
+#include "bongo/db/index/index_descriptor.h"
+#include "bongo/db/index_names.h"
 #include "bongo/db/matcher/extensions_callback_real.h"
 #include "bongo/db/namespace_string.h"
 #include "bongo/db/pipeline/document_source.h"
 #include "bongo/db/pipeline/document_source_cursor.h"
+#include "bongo/db/pipeline/document_source_group.h"
 #include "bongo/db/pipeline/document_source_match.h"
 #include "bongo/db/pipeline/document_source_merge_cursors.h"
+#include "bongo/db/pipeline/document_source_parallel_aggregation.h"
 #include "bongo/db/pipeline/document_source_sample.h"
 #include "bongo/db/pipeline/document_source_sample_from_random_cursor.h"
+#include "bongo/db/pipeline/document_source_single_document_transformation.h"
 #include "bongo/db/pipeline/document_source_sort.h"
 #include "bongo/db/pipeline/pipeline.h"
 #include "bongo/db/query/collation/collator_interface.h"
 #include "bongo/db/query/get_executor.h"
 #include "bongo/db/query/plan_summary_stats.h"
+#include "bongo/db/query/planner_ixselect.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/query/query_planner.h"
 #include "bongo/db/s/collection_sharding_state.h"
 #include "bongo/db/s/sharded_connection_info.h"
@@ -69,6 +81,7 @@
 #include "bongo/db/stats/top.h"
 #include "bongo/db/storage/record_store.h"
 #include "bongo/db/storage/sorted_data_interface.h"
+#include "bongo/db/storage/storage_engine.h"
 #include "bongo/s/chunk_version.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/util/log.h"
@@ -210,6 +223,46 @@ public:
         return pipeline;
     }
 
+    boost::optional<CollectionSizeEstimate> getCollectionSizeEstimate(
+        const NamespaceString& nss) final {
+        AutoGetCollectionForRead autoColl(_ctx->opCtx, nss);
+
+        Collection* collection = autoColl.getCollection();
+        if (!collection) {
+            return boost::none;
+        }
+
+        return CollectionSizeEstimate{
+            static_cast<long long>(collection->numRecords(_ctx->opCtx)),
+            static_cast<long long>(collection->dataSize(_ctx->opCtx))};
+    }
+
+    bool hasEqualityIndexOn(const NamespaceString& nss,
+                            const FieldPath& path,
+                            const CollatorInterface* collator) final {
+        AutoGetCollectionForRead autoColl(_ctx->opCtx, nss);
+
+        Collection* collection = autoColl.getCollection();
+        if (!collection) {
+            return false;
+        }
+
+        // Sparse and partial indexes do not hold every document, and so cannot answer every
+        // equality predicate.
+        auto it = collection->getIndexCatalog()->getIndexIterator(_ctx->opCtx, false);
+        while (it.more()) {
+            const IndexDescriptor* desc = it.next();
+            const auto type = IndexNames::findPluginName(desc->keyPattern());
+            if ((type == IndexNames::BTREE || type == IndexNames::HASHED) && !desc->isSparse() &&
+                !desc->isPartial() &&
+                path.fullPath() == desc->keyPattern().firstElementFieldName() &&
+                CollatorInterface::collatorsMatch(it.catalogEntry(desc)->getCollator(), collator)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
 private:
     intrusive_ptr<ExpressionContext> _ctx;
     DBDirectClient _client;
@@ -332,6 +385,84 @@ StatusWith<std::unique_ptr<PlanExecutor>> attemptToGetExecutor(
     return getExecutor(
         txn, collection, std::move(cq.getValue()), PlanExecutor::YIELD_AUTO, plannerOpts);
 }
+
+/**
+ * Returns true if an index of 'collection' could be used to answer the predicates of 'match'.
+ */
+bool canUseIndex(OperationContext* txn, Collection* collection, const DocumentSourceMatch& match) {
+    unordered_set<std::string> fields;
+    QueryPlannerIXSelect::getFields(match.getMatchExpression(), "", &fields);
+    if (fields.empty()) {
+        return false;
+    }
+
+    IndexCatalog::IndexIterator ii = collection->getIndexCatalog()->getIndexIterator(txn, false);
+    while (ii.more()) {
+        if (fields.count(ii.next()->keyPattern().firstElementFieldName())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns how many ranges of 'collection' the stages of the pipeline up to its first $group may be
+ * run over at once, or 1 if they must be run by the aggregation's own thread.
+ */
+size_t getNumAggregationPartitions(OperationContext* txn,
+                                   Collection* collection,
+                                   const AggregationRequest& aggRequest,
+                                   const Pipeline::SourceContainer& sources) {
+    const long long maxWorkers = std::min<long long>(
+        aggRequest.getParallelism(), internalQueryParallelAggregationMaxWorkers.load());
+    if (maxWorkers <= 1) {
+        return 1;
+    }
+
+    // The threads read the collection in snapshots and under locks of their own, as those of a
+    // parallel collection scan do.
+    StorageEngine* storageEngine = txn->getServiceContext()->getGlobalStorageEngine();
+    Locker* locker = txn->lockState();
+    if (!storageEngine->supportsDocLocking() ||
+        txn->recoveryUnit()->isReadingFromMajorityCommittedSnapshot() ||
+        txn->getClient()->isInDirectClient() || locker->isWriteLocked() || locker->isR()) {
+        return 1;
+    }
+
+    if (collection->isCapped() ||
+        collection->numRecords(txn) < internalQueryParallelCollScanMinRecords.load() ||
+        ShardingState::get(txn)->needCollectionMetadata(txn, collection->ns().ns())) {
+        return 1;
+    }
+
+    // Each range is read with a collection scan, so a pipeline which is hinted, or whose leading
+    // $match could be answered with an index, is left to the aggregation's own thread.
+    if (!aggRequest.getHint().isEmpty()) {
+        return 1;
+    }
+
+    // Only filters and projections may come before the $group.
+    bool isLeadingMatch = true;
+    for (auto&& source : sources) {
+        if (dynamic_cast<DocumentSourceGroup*>(source.get())) {
+            return maxWorkers;
+        }
+
+        auto match = dynamic_cast<DocumentSourceMatch*>(source.get());
+        if (match && !match->isTextQuery()) {
+            if (isLeadingMatch && canUseIndex(txn, collection, *match)) {
+                return 1;
+            }
+            continue;
+        }
+        isLeadingMatch = false;
+        if (dynamic_cast<DocumentSourceSingleDocumentTransformation*>(source.get())) {
+            continue;
+        }
+        return 1;
+    }
+    return 1;
+}
 }  // namespace
 
 void PipelineD::prepareCursorSource(Collection* collection,
@@ -364,6 +495,11 @@ void PipelineD::prepareCursorSource(Collection* collection,
             return;  // don't need a cursor
         }
 
+        if (collection && aggRequest &&
+            prepareParallelAggregation(collection, *aggRequest, pipeline)) {
+            return;
+        }
+
         auto sampleStage = dynamic_cast<DocumentSourceSample*>(sources.front().get());
         // Optimize an initial $sample stage if possible.
         if (collection && sampleStage) {
@@ -445,6 +581,82 @@ void PipelineD::prepareCursorSource(Collection* collection,
         collection, pipeline, expCtx, std::move(exec), deps, queryObj, sortObj, projForQuery);
 }
 
+bool PipelineD::prepareParallelAggregation(Collection* collection,
+                                           const AggregationRequest& aggRequest,
+                                           const intrusive_ptr<Pipeline>& pipeline) {
+    auto expCtx = pipeline->getContext();
+    const size_t numPartitions =
+        getNumAggregationPartitions(expCtx->opCtx, collection, aggRequest, pipeline->_sources);
+    if (numPartitions <= 1) {
+        return false;
+    }
+
+    auto boundaries =
+        ParallelCollectionScan::choosePartitionBoundaries(expCtx->opCtx, collection, numPartitions);
+    if (boundaries.empty()) {
+        return false;
+    }
+
+    // Split the pipeline as for a sharded aggregation. The stages which merge the partial groups
+    // are left in 'pipeline', and the rest are run over each range.
+    auto partitionPipeline = pipeline->splitForSharded();
+    std::vector<BSONObj> serializedPartitionPipeline;
+    for (auto&& stage : partitionPipeline->serialize()) {
+        serializedPartitionPipeline.push_back(stage.getDocument().toBson());
+    }
+
+    pipeline->addInitialSource(DocumentSourceParallelAggregation::create(
+        collection, std::move(serializedPartitionPipeline), std::move(boundaries), expCtx));
+    pipeline->optimizePipeline();
+    return true;
+}
+
+void PipelineD::addPartitionCursorSource(Collection* collection,
+                                         const intrusive_ptr<Pipeline>& pipeline,
+                                         const RecordId& start,
+                                         const RecordId& end) {
+    auto expCtx = pipeline->getContext();
+    OperationContext* txn = expCtx->opCtx;
+
+    // If a $match query is pulled into the scan, the $match is redundant, and can be removed from
+    // the pipeline.
+    const BSONObj queryObj = pipeline->getInitialQuery();
+    if (!queryObj.isEmpty()) {
+        invariant(dynamic_cast<DocumentSourceMatch*>(pipeline->_sources.front().get()));
+        pipeline->_sources.pop_front();
+    }
+
+    auto qr = stdx::make_unique<QueryRequest>(expCtx->ns);
+    qr->setFilter(queryObj);
+    qr->setCollation(expCtx->getCollator() ? expCtx->getCollator()->getSpec().toBSON()
+                                           : expCtx->collation);
+    auto cq = uassertStatusOK(CanonicalQuery::canonicalize(
+        txn, std::move(qr), ExtensionsCallbackReal(txn, &expCtx->ns)));
+
+    CollectionScanParams params;
+    params.collection = collection;
+    params.start = start;
+    params.end = end;
+    params.skipToStart = true;
+
+    auto ws = stdx::make_unique<WorkingSet>();
+    auto root = stdx::make_unique<CollectionScan>(
+        txn, params, ws.get(), queryObj.isEmpty() ? nullptr : cq->root());
+    auto exec = uassertStatusOK(PlanExecutor::make(txn,
+                                                   std::move(ws),
+                                                   std::move(root),
+                                                   std::move(cq),
+                                                   collection,
+                                                   PlanExecutor::YIELD_AUTO));
+
+    addCursorSource(collection,
+                    pipeline,
+                    expCtx,
+                    std::move(exec),
+                    pipeline->getDependencies(DepsTracker::MetadataAvailable::kNoMetadata),
+                    queryObj);
+}
+
 StatusWith<std::unique_ptr<PlanExecutor>> PipelineD::prepareExecutor(
     OperationContext* txn,
     Collection* collection,
@@ -496,6 +708,13 @@ StatusWith<std::unique_ptr<PlanExecutor>> PipelineD::prepareExecutor(
         plannerOpts |= QueryPlannerParams::NO_UNCOVERED_PROJECTIONS;
     }
 
+    // The collection may be scanned by several threads, which return documents in no particular
+    // order, when a $group follows straight after the query.
+    const auto& sources = pipeline->getSources();
+    if (!sources.empty() && dynamic_cast<DocumentSourceGroup*>(sources.front().get())) {
+        plannerOpts |= QueryPlannerParams::PARALLEL_COLLSCAN;
+    }
+
     BSONObj emptyProjection;
     if (sortStage) {
         // See if the query system can provide a non-blocking sort.
@@ -46,6 +46,7 @@ class PlanExecutor;
 struct PlanSummaryStats;
 class BSONObj;
 struct DepsTracker;
+class RecordId;
 
 /*
   PipelineD is an extension of the Pipeline class, but with additional
@@ -79,6 +80,19 @@ public:
                                     const AggregationRequest* aggRequest,
                                     const boost::intrusive_ptr<Pipeline>& pipeline);
 
+    /**
+     * Adds a DocumentSourceCursor which reads the records of 'collection' from 'start' up to, but
+     * not including, 'end' to the front of 'pipeline', which is one of the copies that a
+     * DocumentSourceParallelAggregation runs. A null 'start' or 'end' is an end of the collection.
+     * An initial $match is folded into the scan.
+     *
+     * Callers must take care to ensure that 'collection' is locked in at least IS-mode.
+     */
+    static void addPartitionCursorSource(Collection* collection,
+                                         const boost::intrusive_ptr<Pipeline>& pipeline,
+                                         const RecordId& start,
+                                         const RecordId& end);
+
     static std::string getPlanSummaryStr(const boost::intrusive_ptr<Pipeline>& pPipeline);
 
     static void getPlanSummaryStats(const boost::intrusive_ptr<Pipeline>& pPipeline,
@@ -87,6 +101,15 @@ public:
 private:
     PipelineD();  // does not exist:  prevent instantiation
 
+    /**
+     * Replaces the stages of 'pipeline' up to and including the partial half of its first $group
+     * with a DocumentSourceParallelAggregation, if 'aggRequest' asks for parallelism and they can
+     * be run in parallel. Returns whether it did.
+     */
+    static bool prepareParallelAggregation(Collection* collection,
+                                           const AggregationRequest& aggRequest,
+                                           const boost::intrusive_ptr<Pipeline>& pipeline);
+
     /**
      * Creates a PlanExecutor to be used in the initial cursor source. If the query system can use
      * an index to provide a more efficient sort or projection, the sort and/or projection will be
@@ -92,5 +92,16 @@ public:
         const boost::intrusive_ptr<ExpressionContext>& expCtx) override {
         BONGO_UNREACHABLE;
     }
+
+    boost::optional<CollectionSizeEstimate> getCollectionSizeEstimate(
+        const NamespaceString& nss) override {
+        BONGO_UNREACHABLE;
+    }
+
+    bool hasEqualityIndexOn(const NamespaceString& nss,
+                            const FieldPath& path,
+                            const CollatorInterface* collator) override {
+        BONGO_UNREACHABLE;
+    }
 };
 }  // namespace bongo
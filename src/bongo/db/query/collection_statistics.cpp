@@ -0,0 +1,271 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/query/collection_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace bongo {
+
+namespace {
+
+// How many buckets a histogram is built with.
+const size_t kHistogramBuckets = 64;
+
+// Statistics are gathered again once the number of records in the collection has drifted by more
+// than this fraction, or this many records, whichever is more.
+const double kMaxRecordDriftRatio = 0.2;
+const double kMinRecordDrift = 100;
+
+// Statistics are gathered again once they are this old, as updates can change the distribution
+// of values without changing the number of records.
+const Minutes kMaxAge(10);
+
+/**
+ * Returns where 'value' lies between 'low' and 'high', as a fraction of the distance between them.
+ * Values that cannot be interpolated are assumed to lie halfway.
+ */
+double interpolate(const BSONElement& low, const BSONElement& high, const BSONElement& value) {
+    double lowPos, highPos, valuePos;
+    if (low.isNumber() && high.isNumber() && value.isNumber()) {
+        lowPos = low.numberDouble();
+        highPos = high.numberDouble();
+        valuePos = value.numberDouble();
+    } else if (low.type() == Date && high.type() == Date && value.type() == Date) {
+        lowPos = low.date().toMillisSinceEpoch();
+        highPos = high.date().toMillisSinceEpoch();
+        valuePos = value.date().toMillisSinceEpoch();
+    } else {
+        return 0.5;
+    }
+
+    if (!(highPos > lowPos)) {
+        return 0.5;
+    }
+    return std::max(0.0, std::min(1.0, (valuePos - lowPos) / (highPos - lowPos)));
+}
+
+/**
+ * Compares the first 'numFields' fields of the keys 'lhs' and 'rhs'.
+ */
+int compareKeyPrefixes(const BSONObj& lhs, const BSONObj& rhs, size_t numFields) {
+    BSONObjIterator lhsIt(lhs);
+    BSONObjIterator rhsIt(rhs);
+    for (size_t i = 0; i < numFields && lhsIt.more() && rhsIt.more(); ++i) {
+        const int cmp = lhsIt.next().woCompare(rhsIt.next(), false);
+        if (cmp != 0) {
+            return cmp;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Estimates the number of distinct values of the first 'numFields' fields among 'populationSize'
+ * keys, from the sorted sample 'keys', using the Guaranteed-Error Estimator of Charikar et al.:
+ * values seen more than once in the sample are likely frequent and are counted once, while each
+ * value seen only once stands for sqrt(populationSize / sampleSize) distinct values.
+ */
+double estimateDistinct(const std::vector<BSONObj>& keys, size_t numFields, double populationSize) {
+    double seenOnce = 0;
+    double seenRepeatedly = 0;
+    for (size_t i = 0; i < keys.size();) {
+        size_t runEnd = i + 1;
+        while (runEnd < keys.size() && compareKeyPrefixes(keys[i], keys[runEnd], numFields) == 0) {
+            ++runEnd;
+        }
+        if (runEnd - i == 1) {
+            ++seenOnce;
+        } else {
+            ++seenRepeatedly;
+        }
+        i = runEnd;
+    }
+
+    const double distinctInSample = seenOnce + seenRepeatedly;
+    const double scale = std::sqrt(std::max(1.0, populationSize / keys.size()));
+    return std::max(distinctInSample,
+                    std::min(populationSize, seenOnce * scale + seenRepeatedly));
+}
+
+}  // namespace
+
+KeyHistogram KeyHistogram::build(const std::vector<BSONObj>& values, size_t maxBuckets) {
+    invariant(maxBuckets > 0);
+
+    KeyHistogram histogram;
+    histogram._numValues = values.size();
+    const double valuesPerBucket =
+        std::max(1.0, static_cast<double>(values.size()) / static_cast<double>(maxBuckets));
+
+    Bucket bucket;
+    for (size_t i = 0; i < values.size();) {
+        const BSONElement value = values[i].firstElement();
+        size_t runEnd = i + 1;
+        while (runEnd < values.size() &&
+               values[runEnd].firstElement().woCompare(value, false) == 0) {
+            ++runEnd;
+        }
+        const double runLength = runEnd - i;
+
+        // The smallest value ends the first bucket, so that no sampled value precedes the first
+        // bucket, and the largest value ends the last one.
+        if (histogram._buckets.empty() || runEnd == values.size() ||
+            bucket.numBelow + runLength >= valuesPerBucket) {
+            BSONObjBuilder bob;
+            bob.appendAs(value, "");
+            bucket.upperBound = bob.obj();
+            bucket.numEqual = runLength;
+            histogram._buckets.push_back(std::move(bucket));
+            bucket = Bucket();
+        } else {
+            bucket.numBelow += runLength;
+            ++bucket.numDistinctBelow;
+        }
+        i = runEnd;
+    }
+
+    return histogram;
+}
+
+double KeyHistogram::countBelow(const BSONElement& value, bool inclusive) const {
+    double count = 0;
+    BSONElement previousBound;
+    for (const auto& bucket : _buckets) {
+        const BSONElement bound = bucket.upperBound.firstElement();
+        const int cmp = value.woCompare(bound, false);
+        if (cmp > 0) {
+            count += bucket.numBelow + bucket.numEqual;
+            previousBound = bound;
+            continue;
+        }
+        if (cmp == 0) {
+            return count + bucket.numBelow + (inclusive ? bucket.numEqual : 0);
+        }
+        if (bucket.numBelow == 0) {
+            return count;
+        }
+
+        // 'value' lies strictly inside this bucket. Assume that the values in the bucket are
+        // spread evenly, and that each distinct one occurs equally often.
+        double below = bucket.numBelow * interpolate(previousBound, bound, value);
+        if (inclusive) {
+            below += bucket.numBelow / bucket.numDistinctBelow;
+        }
+        return count + std::min(below, bucket.numBelow);
+    }
+    return count;
+}
+
+double KeyHistogram::estimateFraction(const BSONElement& low,
+                                      bool lowInclusive,
+                                      const BSONElement& high,
+                                      bool highInclusive) const {
+    if (_numValues == 0) {
+        return 0;
+    }
+    if (low.woCompare(high, false) > 0) {
+        return estimateFraction(high, highInclusive, low, lowInclusive);
+    }
+
+    const double count = countBelow(high, highInclusive) - countBelow(low, !lowInclusive);
+    return std::max(0.0, std::min(1.0, count / _numValues));
+}
+
+IndexStatistics IndexStatistics::build(std::vector<BSONObj>* keys,
+                                       size_t numRecordsSampled,
+                                       long long numRecords) {
+    IndexStatistics stats;
+    if (numRecordsSampled == 0) {
+        return stats;
+    }
+
+    std::sort(keys->begin(), keys->end(), [](const BSONObj& lhs, const BSONObj& rhs) {
+        return lhs.woCompare(rhs, BSONObj(), false) < 0;
+    });
+
+    stats.keysPerRecord = static_cast<double>(keys->size()) / numRecordsSampled;
+    stats.numKeys = stats.keysPerRecord * numRecords;
+    stats.leadingField = KeyHistogram::build(*keys, kHistogramBuckets);
+
+    const size_t numFields = keys->empty() ? 0 : keys->front().nFields();
+    for (size_t i = 1; i <= numFields; ++i) {
+        stats.distinctPrefixCounts.push_back(estimateDistinct(*keys, i, stats.numKeys));
+    }
+    return stats;
+}
+
+double IndexStatistics::distinctPrefixes(size_t numFields) const {
+    if (numFields == 0 || distinctPrefixCounts.empty()) {
+        return 1;
+    }
+    const size_t index = std::min(numFields, distinctPrefixCounts.size()) - 1;
+    return std::max(1.0, distinctPrefixCounts[index]);
+}
+
+CollectionStatistics::CollectionStatistics(long long numRecords,
+                                           size_t numRecordsSampled,
+                                           Date_t sampledAt)
+    : _numRecords(numRecords), _numRecordsSampled(numRecordsSampled), _sampledAt(sampledAt) {}
+
+void CollectionStatistics::addIndex(const std::string& indexName,
+                                    const std::string& leadingFieldPath,
+                                    bool hasCollation,
+                                    IndexStatistics stats) {
+    _indexes[indexName] = std::move(stats);
+    if (!hasCollation &&
+        _fieldHistogramIndexes.find(leadingFieldPath) == _fieldHistogramIndexes.end()) {
+        _fieldHistogramIndexes[leadingFieldPath] = indexName;
+    }
+}
+
+const IndexStatistics* CollectionStatistics::getIndex(StringData indexName) const {
+    auto it = _indexes.find(indexName);
+    return it == _indexes.end() ? nullptr : &it->second;
+}
+
+const KeyHistogram* CollectionStatistics::getFieldHistogram(StringData path) const {
+    auto it = _fieldHistogramIndexes.find(path);
+    if (it == _fieldHistogramIndexes.end()) {
+        return nullptr;
+    }
+    const IndexStatistics* stats = getIndex(it->second);
+    return stats ? &stats->leadingField : nullptr;
+}
+
+bool CollectionStatistics::isStale(long long numRecords, Date_t now) const {
+    const double drift = std::abs(static_cast<double>(numRecords - _numRecords));
+    return drift > std::max(kMinRecordDrift, _numRecords * kMaxRecordDriftRatio) ||
+        now - _sampledAt > kMaxAge;
+}
+
+}  // namespace bongo
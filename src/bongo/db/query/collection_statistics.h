@@ -0,0 +1,189 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "bongo/db/jsobj.h"
+#include "bongo/util/string_map.h"
+#include "bongo/util/time_support.h"
+
+namespace bongo {
+
+/**
+ * An equi-depth histogram over the values of a single field, built from a sample of those values.
+ *
+ * Each bucket ends at a sampled value and counts the sampled values equal to that bound apart from
+ * the values that fall strictly between it and the previous bound, so that values which repeat
+ * often are estimated exactly rather than averaged across a bucket.
+ */
+class KeyHistogram {
+public:
+    /**
+     * Builds a histogram with about 'maxBuckets' buckets from 'values', which must be in
+     * ascending order. The first element of each object is the value; field names are ignored.
+     */
+    static KeyHistogram build(const std::vector<BSONObj>& values, size_t maxBuckets);
+
+    /**
+     * Returns the fraction of the sampled values that lie between 'low' and 'high'. If 'low' sorts
+     * after 'high', the bounds are swapped, so that the interval of a reversed index scan can be
+     * passed as is.
+     */
+    double estimateFraction(const BSONElement& low,
+                            bool lowInclusive,
+                            const BSONElement& high,
+                            bool highInclusive) const;
+
+    size_t numBuckets() const {
+        return _buckets.size();
+    }
+
+    /**
+     * Returns the number of values the histogram was built from.
+     */
+    double numValues() const {
+        return _numValues;
+    }
+
+private:
+    struct Bucket {
+        // Holds the bound as its only element.
+        BSONObj upperBound;
+
+        // The number of sampled values equal to 'upperBound'.
+        double numEqual = 0;
+
+        // The number of sampled values, and distinct sampled values, strictly between the previous
+        // bucket's bound and 'upperBound'.
+        double numBelow = 0;
+        double numDistinctBelow = 0;
+    };
+
+    /**
+     * Returns the number of sampled values that sort before 'value', or at or before it if
+     * 'inclusive' is true.
+     */
+    double countBelow(const BSONElement& value, bool inclusive) const;
+
+    std::vector<Bucket> _buckets;
+    double _numValues = 0;
+};
+
+/**
+ * Statistics on the keys of a single index, gathered from a sample of the collection's documents.
+ */
+struct IndexStatistics {
+    /**
+     * Builds the statistics of an index from the keys it generated for 'numRecordsSampled'
+     * randomly chosen documents of a collection holding 'numRecords' records. 'keys' is sorted
+     * in place.
+     */
+    static IndexStatistics build(std::vector<BSONObj>* keys,
+                                 size_t numRecordsSampled,
+                                 long long numRecords);
+
+    /**
+     * Returns the estimated number of distinct values taken by the first 'numFields' fields of the
+     * key across the whole index.
+     */
+    double distinctPrefixes(size_t numFields) const;
+
+    // The estimated number of keys in the index.
+    double numKeys = 0;
+
+    // The average number of keys generated for each record of the collection. This is below 1 for
+    // sparse and partial indexes, and above 1 for multikey indexes.
+    double keysPerRecord = 0;
+
+    // Histogram of the values of the first field of the key.
+    KeyHistogram leadingField;
+
+    // The i-th entry is the estimated number of distinct values of the first i + 1 fields of the
+    // key.
+    std::vector<double> distinctPrefixCounts;
+};
+
+/**
+ * Statistics on a collection and its indexes, used to estimate the cost of candidate query plans.
+ * Instances are immutable once built, and are shared between the queries that plan against them.
+ */
+class CollectionStatistics {
+public:
+    CollectionStatistics(long long numRecords, size_t numRecordsSampled, Date_t sampledAt);
+
+    /**
+     * Adds the statistics of the index 'indexName', whose first key field is 'leadingFieldPath'.
+     * An index without a collation should be passed with 'hasCollation' false, as only those
+     * indexes' histograms are used to estimate the selectivity of predicates that do not use the
+     * index.
+     */
+    void addIndex(const std::string& indexName,
+                  const std::string& leadingFieldPath,
+                  bool hasCollation,
+                  IndexStatistics stats);
+
+    /**
+     * Returns the statistics of the index 'indexName', or nullptr if it has none.
+     */
+    const IndexStatistics* getIndex(StringData indexName) const;
+
+    /**
+     * Returns a histogram of the values of the field 'path', if an index without a collation leads
+     * with it, and nullptr otherwise.
+     */
+    const KeyHistogram* getFieldHistogram(StringData path) const;
+
+    /**
+     * Returns true if these statistics should be gathered again, because the collection now holds
+     * 'numRecords' records, or because they were gathered too long before 'now'.
+     */
+    bool isStale(long long numRecords, Date_t now) const;
+
+    long long numRecords() const {
+        return _numRecords;
+    }
+
+    size_t numRecordsSampled() const {
+        return _numRecordsSampled;
+    }
+
+private:
+    const long long _numRecords;
+    const size_t _numRecordsSampled;
+    const Date_t _sampledAt;
+
+    StringMap<IndexStatistics> _indexes;
+
+    // Maps a field path to the name of an index without a collation that leads with that path.
+    StringMap<std::string> _fieldHistogramIndexes;
+};
+
+}  // namespace bongo
@@ -0,0 +1,177 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/query/collection_statistics.h"
+
+#include "bongo/unittest/unittest.h"
+
+namespace bongo {
+namespace {
+
+std::vector<BSONObj> makeValues(int begin, int end) {
+    std::vector<BSONObj> values;
+    for (int i = begin; i < end; ++i) {
+        values.push_back(BSON("" << i));
+    }
+    return values;
+}
+
+TEST(KeyHistogramTest, EstimatesUniformValues) {
+    auto histogram = KeyHistogram::build(makeValues(0, 1000), 64);
+    ASSERT_LESS_THAN_OR_EQUALS(histogram.numBuckets(), 65U);
+    ASSERT_EQ(1000, histogram.numValues());
+
+    auto values = BSON("" << 0 << "" << 99 << "" << 500 << "" << 2000 << "" << 3000);
+    std::vector<BSONElement> elts;
+    values.elems(elts);
+
+    ASSERT_APPROX_EQUAL(0.1, histogram.estimateFraction(elts[0], true, elts[1], true), 0.02);
+    ASSERT_APPROX_EQUAL(0.5, histogram.estimateFraction(elts[2], true, elts[3], true), 0.02);
+    ASSERT_APPROX_EQUAL(0.001, histogram.estimateFraction(elts[2], true, elts[2], true), 0.001);
+    ASSERT_EQ(0, histogram.estimateFraction(elts[3], true, elts[4], true));
+}
+
+TEST(KeyHistogramTest, EstimatesFrequentValuesExactly) {
+    std::vector<BSONObj> values(900, BSON("" << 7));
+    auto others = makeValues(100, 200);
+    values.insert(values.end(), others.begin(), others.end());
+    auto histogram = KeyHistogram::build(values, 16);
+
+    auto bounds = BSON("" << 7 << "" << 8 << "" << 199);
+    std::vector<BSONElement> elts;
+    bounds.elems(elts);
+
+    ASSERT_APPROX_EQUAL(0.9, histogram.estimateFraction(elts[0], true, elts[0], true), 1e-9);
+    ASSERT_EQ(0, histogram.estimateFraction(elts[0], false, elts[0], false));
+    ASSERT_APPROX_EQUAL(0.1, histogram.estimateFraction(elts[1], true, elts[2], true), 0.01);
+}
+
+TEST(KeyHistogramTest, AcceptsReversedBounds) {
+    auto histogram = KeyHistogram::build(makeValues(0, 1000), 64);
+    auto bounds = BSON("" << 100 << "" << 300);
+    std::vector<BSONElement> elts;
+    bounds.elems(elts);
+
+    ASSERT_EQ(histogram.estimateFraction(elts[0], true, elts[1], false),
+              histogram.estimateFraction(elts[1], false, elts[0], true));
+}
+
+TEST(KeyHistogramTest, EstimatesValuesOfMixedTypes) {
+    std::vector<BSONObj> values = makeValues(0, 500);
+    for (int i = 0; i < 500; ++i) {
+        values.push_back(BSON("" << std::string(str::stream() << "s" << 1000 + i)));
+    }
+    auto histogram = KeyHistogram::build(values, 32);
+
+    BSONObjBuilder bob;
+    bob.appendMinForType("", String);
+    bob.appendMaxForType("", String);
+    auto bounds = bob.obj();
+    std::vector<BSONElement> elts;
+    bounds.elems(elts);
+
+    ASSERT_APPROX_EQUAL(0.5, histogram.estimateFraction(elts[0], true, elts[1], true), 0.05);
+}
+
+TEST(KeyHistogramTest, EmptyHistogramEstimatesNothing) {
+    auto histogram = KeyHistogram::build({}, 8);
+    auto value = BSON("" << 1);
+    const BSONElement elt = value.firstElement();
+    ASSERT_EQ(0, histogram.estimateFraction(elt, true, elt, true));
+}
+
+TEST(IndexStatisticsTest, CountsDistinctPrefixes) {
+    // Keys on {a: 1, b: 1} where 'a' takes 10 values and 'b' 100 values for each of them.
+    std::vector<BSONObj> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(BSON("" << i % 10 << "" << i % 100));
+    }
+    auto stats = IndexStatistics::build(&keys, 1000, 1000);
+
+    ASSERT_EQ(1.0, stats.keysPerRecord);
+    ASSERT_EQ(1000, stats.numKeys);
+    ASSERT_EQ(2U, stats.distinctPrefixCounts.size());
+    ASSERT_EQ(10, stats.distinctPrefixes(1));
+    ASSERT_EQ(100, stats.distinctPrefixes(2));
+    ASSERT_EQ(1, stats.distinctPrefixes(0));
+}
+
+TEST(IndexStatisticsTest, ScalesUpValuesSeenOnce) {
+    auto keys = makeValues(0, 1000);
+    auto stats = IndexStatistics::build(&keys, 1000, 100000);
+
+    ASSERT_EQ(100000, stats.numKeys);
+    ASSERT_GREATER_THAN(stats.distinctPrefixes(1), 1000);
+    ASSERT_LESS_THAN_OR_EQUALS(stats.distinctPrefixes(1), 100000);
+}
+
+TEST(IndexStatisticsTest, CountsKeysPerRecord) {
+    // A sparse index that only half of the sampled documents have keys in.
+    auto keys = makeValues(0, 500);
+    auto stats = IndexStatistics::build(&keys, 1000, 10000);
+    ASSERT_EQ(0.5, stats.keysPerRecord);
+    ASSERT_EQ(5000, stats.numKeys);
+
+    // A multikey index with three keys for each document.
+    keys = makeValues(0, 3000);
+    stats = IndexStatistics::build(&keys, 1000, 10000);
+    ASSERT_EQ(3, stats.keysPerRecord);
+    ASSERT_EQ(30000, stats.numKeys);
+}
+
+TEST(CollectionStatisticsTest, LooksUpFieldHistograms) {
+    CollectionStatistics stats(1000, 1000, Date_t());
+    auto keys = makeValues(0, 10);
+    stats.addIndex("a_1", "a", false, IndexStatistics::build(&keys, 10, 1000));
+    keys = makeValues(0, 10);
+    stats.addIndex("b_1_collated", "b", true, IndexStatistics::build(&keys, 10, 1000));
+
+    ASSERT(stats.getIndex("a_1"));
+    ASSERT(stats.getIndex("b_1_collated"));
+    ASSERT_FALSE(stats.getIndex("c_1"));
+
+    ASSERT_EQ(&stats.getIndex("a_1")->leadingField, stats.getFieldHistogram("a"));
+    ASSERT_FALSE(stats.getFieldHistogram("b"));
+    ASSERT_FALSE(stats.getFieldHistogram("c"));
+}
+
+TEST(CollectionStatisticsTest, BecomesStale) {
+    const Date_t sampledAt = Date_t::fromMillisSinceEpoch(1000000);
+    CollectionStatistics stats(10000, 1000, sampledAt);
+
+    ASSERT_FALSE(stats.isStale(10000, sampledAt));
+    ASSERT_FALSE(stats.isStale(11000, sampledAt + Minutes(1)));
+    ASSERT_TRUE(stats.isStale(13000, sampledAt));
+    ASSERT_TRUE(stats.isStale(7000, sampledAt));
+    ASSERT_TRUE(stats.isStale(10000, sampledAt + Hours(1)));
+}
+
+}  // namespace
+}  // namespace bongo
@@ -30,6 +30,8 @@
 
 #include "bongo/db/query/explain.h"
 
+#include <cmath>
+
 #include "bongo/base/owned_pointer_vector.h"
 #include "bongo/bson/util/builder.h"
 #include "bongo/db/exec/cached_plan.h"
@@ -40,6 +42,7 @@
 #include "bongo/db/exec/multi_plan.h"
 #include "bongo/db/exec/near.h"
 #include "bongo/db/exec/pipeline_proxy.h"
+#include "bongo/db/exec/skip_scan.h"
 #include "bongo/db/exec/text.h"
 #include "bongo/db/exec/working_set_common.h"
 #include "bongo/db/keypattern.h"
@@ -135,6 +138,9 @@ size_t getKeysExamined(StageType type, const SpecificStats* specific) {
     } else if (STAGE_DISTINCT_SCAN == type) {
         const DistinctScanStats* spec = static_cast<const DistinctScanStats*>(specific);
         return spec->keysExamined;
+    } else if (STAGE_SKIP_SCAN == type) {
+        const SkipScanStats* spec = static_cast<const SkipScanStats*>(specific);
+        return spec->keysExamined;
     }
 
     return 0;
@@ -162,6 +168,10 @@ size_t getDocsExamined(StageType type, const SpecificStats* specific) {
     } else if (STAGE_TEXT_OR == type) {
         const TextOrStats* spec = static_cast<const TextOrStats*>(specific);
         return spec->fetches;
+    } else if (STAGE_PARALLEL_COLLSCAN == type) {
+        const ParallelCollectionScanStats* spec =
+            static_cast<const ParallelCollectionScanStats*>(specific);
+        return spec->docsTested;
     }
 
     return 0;
@@ -185,6 +195,10 @@ void addStageSummaryStr(const PlanStage* stage, StringBuilder& sb) {
         const DistinctScanStats* spec = static_cast<const DistinctScanStats*>(specific);
         const KeyPattern keyPattern{spec->keyPattern};
         sb << " " << keyPattern;
+    } else if (STAGE_SKIP_SCAN == stage->stageType()) {
+        const SkipScanStats* spec = static_cast<const SkipScanStats*>(specific);
+        const KeyPattern keyPattern{spec->keyPattern};
+        sb << " " << keyPattern;
     } else if (STAGE_GEO_NEAR_2D == stage->stageType()) {
         const NearStats* spec = static_cast<const NearStats*>(specific);
         const KeyPattern keyPattern{spec->keyPattern};
@@ -267,6 +281,12 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         bob->append("filter", stats.common.filter);
     }
 
+    // The number of results the planner expected, to compare with 'nReturned' below.
+    if (stats.common.estimatedNReturned >= 0) {
+        bob->appendNumber("estimatedNReturned",
+                          static_cast<long long>(std::llround(stats.common.estimatedNReturned)));
+    }
+
     // Some top-level exec stats get pulled out of the root stage.
     if (verbosity >= ExplainCommon::EXEC_STATS) {
         bob->appendNumber("nReturned", stats.common.advanced);
@@ -311,6 +331,15 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         if (verbosity >= ExplainCommon::EXEC_STATS) {
             bob->appendNumber("docsExamined", spec->docsTested);
         }
+    } else if (STAGE_PARALLEL_COLLSCAN == stats.stageType) {
+        ParallelCollectionScanStats* spec =
+            static_cast<ParallelCollectionScanStats*>(stats.specific.get());
+        bob->appendNumber("numWorkers", spec->numWorkers);
+        if (verbosity >= ExplainCommon::EXEC_STATS) {
+            bob->appendNumber("docsExamined", spec->docsTested);
+            bob->appendNumber("numPartitions", spec->numPartitions);
+            bob->appendNumber("numBatches", spec->numBatches);
+        }
     } else if (STAGE_COUNT == stats.stageType) {
         CountStats* spec = static_cast<CountStats*>(stats.specific.get());
 
@@ -477,6 +506,31 @@ void Explain::statsToBSON(const PlanStageStats& stats,
     } else if (STAGE_SKIP == stats.stageType) {
         SkipStats* spec = static_cast<SkipStats*>(stats.specific.get());
         bob->appendNumber("skipAmount", spec->skip);
+    } else if (STAGE_SKIP_SCAN == stats.stageType) {
+        SkipScanStats* spec = static_cast<SkipScanStats*>(stats.specific.get());
+
+        bob->append("keyPattern", spec->keyPattern);
+        bob->append("indexName", spec->indexName);
+        if (!spec->collation.isEmpty()) {
+            bob->append("collation", spec->collation);
+        }
+        bob->appendBool("isUnique", spec->isUnique);
+        bob->appendBool("isSparse", spec->isSparse);
+        bob->appendBool("isPartial", spec->isPartial);
+        bob->append("indexVersion", spec->indexVersion);
+        bob->append("prefixLength", spec->prefixLen);
+
+        if ((topLevelBob->len() + spec->indexBounds.objsize()) > kMaxStatsBSONSize) {
+            bob->append("warning", "index bounds omitted due to BSON size limit");
+        } else {
+            bob->append("indexBounds", spec->indexBounds);
+        }
+
+        if (verbosity >= ExplainCommon::EXEC_STATS) {
+            bob->appendNumber("keysExamined", spec->keysExamined);
+            bob->appendNumber("seeks", spec->seeks);
+            bob->appendNumber("prefixesSkipped", spec->prefixesSkipped);
+        }
     } else if (STAGE_SORT == stats.stageType) {
         SortStats* spec = static_cast<SortStats*>(stats.specific.get());
         bob->append("sortPattern", spec->sortPattern);
@@ -484,6 +538,7 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         if (verbosity >= ExplainCommon::EXEC_STATS) {
             bob->appendNumber("memUsage", spec->memUsage);
             bob->appendNumber("memLimit", spec->memLimit);
+            bob->appendBool("usedDisk", spec->usedDisk);
         }
 
         if (spec->limit > 0) {
@@ -884,6 +939,11 @@ void Explain::getSummaryStats(const PlanExecutor& exec, PlanSummaryStats* statsO
             const DistinctScanStats* distinctScanStats =
                 static_cast<const DistinctScanStats*>(distinctScan->getSpecificStats());
             statsOut->indexesUsed.insert(distinctScanStats->indexName);
+        } else if (STAGE_SKIP_SCAN == stages[i]->stageType()) {
+            const SkipScan* skipScan = static_cast<const SkipScan*>(stages[i]);
+            const SkipScanStats* skipScanStats =
+                static_cast<const SkipScanStats*>(skipScan->getSpecificStats());
+            statsOut->indexesUsed.insert(skipScanStats->indexName);
         } else if (STAGE_TEXT == stages[i]->stageType()) {
             const TextStage* textStage = static_cast<const TextStage*>(stages[i]);
             const TextStats* textStats =
@@ -32,6 +32,8 @@
 
 #include "bongo/db/query/find.h"
 
+#include <algorithm>
+
 #include "bongo/client/dbclientinterface.h"
 #include "bongo/db/catalog/collection.h"
 #include "bongo/db/catalog/database_holder.h"
@@ -49,6 +51,7 @@
 #include "bongo/db/query/get_executor.h"
 #include "bongo/db/query/internal_plans.h"
 #include "bongo/db/query/plan_summary_stats.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/query/query_planner_params.h"
 #include "bongo/db/repl/replication_coordinator_global.h"
 #include "bongo/db/s/collection_sharding_state.h"
@@ -72,6 +75,44 @@ using stdx::make_unique;
 // Failpoint for checking whether we've received a getmore.
 BONGO_FP_DECLARE(failReceivedGetmore);
 
+BatchedResultReader::BatchedResultReader(PlanExecutor* exec, long long maxResults)
+    : _exec(exec), _maxResults(maxResults) {}
+
+BatchedResultReader::~BatchedResultReader() {
+    _exec->enqueueFront(_batch.begin() + _position, _batch.end());
+}
+
+PlanExecutor::ExecState BatchedResultReader::getNext(BSONObj* objOut) {
+    if (_position == _batch.size()) {
+        long long toFetch = std::max(internalQueryExecBatchSize.load(), 1);
+        if (_maxResults) {
+            toFetch = std::min(toFetch, std::max(_maxResults - _numHandedOut, 1LL));
+        }
+
+        _batch.clear();
+        _position = 0;
+        PlanExecutor::ExecState state = _exec->getNextBatch(toFetch, &_batch);
+        if (PlanExecutor::ADVANCED != state) {
+            if (!_batch.empty()) {
+                // The error object describing why the executor is DEAD or FAILED.
+                *objOut = _batch.back();
+                _batch.clear();
+            }
+            return state;
+        }
+    }
+
+    ++_numHandedOut;
+    *objOut = _batch[_position++];
+    return PlanExecutor::ADVANCED;
+}
+
+void BatchedResultReader::putBack() {
+    invariant(_position > 0);
+    --_position;
+    --_numHandedOut;
+}
+
 bool isCursorTailable(const ClientCursor* cursor) {
     return cursor->queryOptions() & QueryOption_CursorTailable;
 }
@@ -164,7 +205,7 @@ void endQueryOp(OperationContext* txn,
 namespace {
 
 /**
- * Uses 'cursor' to fill out 'bb' with the batch of result documents to
+ * Uses 'cursor' to fill out 'reply' with the batch of result documents to
  * be returned by this getMore.
  *
  * Returns the number of documents in the batch in 'numResults', which must be initialized to
@@ -177,23 +218,25 @@ namespace {
  */
 void generateBatch(int ntoreturn,
                    ClientCursor* cursor,
-                   BufBuilder* bb,
+                   OpQueryReplyBuilder* reply,
                    int* numResults,
                    Timestamp* slaveReadTill,
                    PlanExecutor::ExecState* state) {
     PlanExecutor* exec = cursor->getExecutor();
 
     BSONObj obj;
+    BatchedResultReader reader(exec, ntoreturn);
     while (!FindCommon::enoughForGetMore(ntoreturn, *numResults) &&
-           PlanExecutor::ADVANCED == (*state = exec->getNext(&obj, NULL))) {
+           PlanExecutor::ADVANCED == (*state = reader.getNext(&obj))) {
         // If we can't fit this result inside the current batch, then we stash it for later.
-        if (!FindCommon::haveSpaceForNext(obj, *numResults, bb->len())) {
-            exec->enqueue(obj);
+        if (!FindCommon::haveSpaceForNext(obj, *numResults, reply->bytesUsed())) {
+            reader.putBack();
             break;
         }
 
-        // Add result to output buffer.
-        bb->appendBuf((void*)obj.objdata(), obj.objsize());
+        // Add result to output buffer. Results that still point into the storage engine's memory
+        // are copied straight into the reply; owned ones may be spliced in without a copy.
+        reply->appendResult(obj);
 
         // Count the result.
         (*numResults)++;
@@ -306,8 +349,7 @@ Message getMore(OperationContext* txn,
     const int InitialBufSize =
         512 + sizeof(QueryResult::Value) + FindCommon::kMaxBytesToReturnToClientAtOnce;
 
-    BufBuilder bb(InitialBufSize);
-    bb.skip(sizeof(QueryResult::Value));
+    OpQueryReplyBuilder reply(InitialBufSize);
 
     if (!ccPin.isOK()) {
         invariant(ccPin == ErrorCodes::CursorNotFound);
@@ -392,7 +434,7 @@ Message getMore(OperationContext* txn,
         PlanSummaryStats preExecutionStats;
         Explain::getSummaryStats(*exec, &preExecutionStats);
 
-        generateBatch(ntoreturn, cc, &bb, &numResults, &slaveReadTill, &state);
+        generateBatch(ntoreturn, cc, &reply, &numResults, &slaveReadTill, &state);
 
         // If this is an await data cursor, and we hit EOF without generating any results, then
         // we block waiting for new data to arrive.
@@ -416,7 +458,7 @@ Message getMore(OperationContext* txn,
 
             // We woke up because either the timed_wait expired, or there was more data. Either
             // way, attempt to generate another batch of results.
-            generateBatch(ntoreturn, cc, &bb, &numResults, &slaveReadTill, &state);
+            generateBatch(ntoreturn, cc, &reply, &numResults, &slaveReadTill, &state);
         }
 
         PlanSummaryStats postExecutionStats;
@@ -487,15 +529,10 @@ Message getMore(OperationContext* txn,
         }
     }
 
-    QueryResult::View qr = bb.buf();
-    qr.msgdata().setLen(bb.len());
-    qr.msgdata().setOperation(opReply);
-    qr.setResultFlags(resultFlags);
-    qr.setCursorId(cursorid);
-    qr.setStartingFrom(startingResult);
-    qr.setNReturned(numResults);
+    Message response;
+    reply.putInMessage(&response, resultFlags, numResults, startingResult, cursorid);
     LOG(5) << "getMore returned " << numResults << " results\n";
-    return Message(bb.release());
+    return response;
 }
 
 std::string runQuery(OperationContext* txn,
@@ -587,11 +624,10 @@ std::string runQuery(OperationContext* txn,
     uassertStatusOK(serveReadsStatus);
 
     // Run the query.
-    // bb is used to hold query results
+    // reply is used to hold query results
     // this buffer should contain either requested documents per query or
     // explain information, but not both
-    BufBuilder bb(FindCommon::kInitReplyBufferSize);
-    bb.skip(sizeof(QueryResult::Value));
+    OpQueryReplyBuilder reply(FindCommon::kInitReplyBufferSize);
 
     // How many results have we obtained from the executor?
     int numResults = 0;
@@ -608,32 +644,38 @@ std::string runQuery(OperationContext* txn,
         curOp.setPlanSummary_inlock(Explain::getPlanSummary(exec.get()));
     }
 
-    while (PlanExecutor::ADVANCED == (state = exec->getNext(&obj, NULL))) {
-        // If we can't fit this result inside the current batch, then we stash it for later.
-        if (!FindCommon::haveSpaceForNext(obj, numResults, bb.len())) {
-            exec->enqueue(obj);
-            break;
-        }
+    {
+        // The reader hands unused results back to the executor when it goes out of scope.
+        BatchedResultReader reader(exec.get(),
+                                   qr.getEffectiveBatchSize().value_or(
+                                       QueryRequest::kDefaultBatchSize));
+        while (PlanExecutor::ADVANCED == (state = reader.getNext(&obj))) {
+            // If we can't fit this result inside the current batch, then we stash it for later.
+            if (!FindCommon::haveSpaceForNext(obj, numResults, reply.bytesUsed())) {
+                reader.putBack();
+                break;
+            }
 
-        // Add result to output buffer.
-        bb.appendBuf((void*)obj.objdata(), obj.objsize());
+            // Add result to output buffer.
+            reply.appendResult(obj);
 
-        // Count the result.
-        ++numResults;
+            // Count the result.
+            ++numResults;
 
-        // Possibly note slave's position in the oplog.
-        if (qr.isOplogReplay()) {
-            BSONElement e = obj["ts"];
-            if (Date == e.type() || bsonTimestamp == e.type()) {
-                slaveReadTill = e.timestamp();
+            // Possibly note slave's position in the oplog.
+            if (qr.isOplogReplay()) {
+                BSONElement e = obj["ts"];
+                if (Date == e.type() || bsonTimestamp == e.type()) {
+                    slaveReadTill = e.timestamp();
+                }
             }
-        }
 
-        if (FindCommon::enoughForFirstBatch(qr, numResults)) {
-            LOG(5) << "Enough for first batch, wantMore=" << qr.wantMore()
-                   << " ntoreturn=" << qr.getNToReturn().value_or(0)
-                   << " numResults=" << numResults;
-            break;
+            if (FindCommon::enoughForFirstBatch(qr, numResults)) {
+                LOG(5) << "Enough for first batch, wantMore=" << qr.wantMore()
+                       << " ntoreturn=" << qr.getNToReturn().value_or(0)
+                       << " numResults=" << numResults;
+                break;
+            }
         }
     }
 
@@ -700,17 +742,9 @@ std::string runQuery(OperationContext* txn,
         endQueryOp(txn, collection, *exec, numResults, ccId);
     }
 
-    // Fill out the output buffer's header.
-    QueryResult::View queryResultView = bb.buf();
-    queryResultView.setCursorId(ccId);
-    queryResultView.setResultFlagsToOk();
-    queryResultView.msgdata().setLen(bb.len());
-    queryResultView.msgdata().setOperation(opReply);
-    queryResultView.setStartingFrom(0);
-    queryResultView.setNReturned(numResults);
-
-    // Add the results from the query into the output buffer.
-    result.setData(bb.release());
+    // Fill out the output buffer's header and add the results from the query into the output
+    // message.
+    reply.putInMessage(&result, ResultFlag_AwaitCapable, numResults, /*startingFrom*/ 0, ccId);
 
     // curOp.debug().exhaust is set above.
     return curOp.debug().exhaust ? nss.ns() : "";
@@ -29,7 +29,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
+#include "bongo/base/disallow_copying.h"
 #include "bongo/db/clientcursor.h"
 #include "bongo/db/dbmessage.h"
 #include "bongo/db/operation_context.h"
@@ -41,6 +43,45 @@ namespace bongo {
 class NamespaceString;
 class OperationContext;
 
+/**
+ * Hands out the results of a PlanExecutor one at a time, for building a find or getMore reply,
+ * while pulling them from the executor several at a time with PlanExecutor::getNextBatch().
+ *
+ * Results that were pulled but not handed out, or that were handed back with putBack(), are
+ * returned to the executor when the reader is destroyed, so that the next batch starts with them.
+ * The reader must therefore be destroyed before the executor is saved or returned to a cursor.
+ */
+class BatchedResultReader {
+    BONGO_DISALLOW_COPYING(BatchedResultReader);
+
+public:
+    /**
+     * 'maxResults' is the most results the reply can take, or zero if it is only bounded by size.
+     */
+    BatchedResultReader(PlanExecutor* exec, long long maxResults);
+
+    ~BatchedResultReader();
+
+    /**
+     * Like PlanExecutor::getNext() for the documents of a reply. Results are valid until the
+     * reader is destroyed.
+     */
+    PlanExecutor::ExecState getNext(BSONObj* objOut);
+
+    /**
+     * Hands back the result last returned by getNext(), which did not fit in the reply.
+     */
+    void putBack();
+
+private:
+    PlanExecutor* const _exec;
+    const long long _maxResults;
+    long long _numHandedOut = 0;
+
+    std::vector<BSONObj> _batch;
+    size_t _position = 0;
+};
+
 /**
  * Whether or not the ClientCursor* is tailable.
  */
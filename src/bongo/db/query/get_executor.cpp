@@ -64,6 +64,7 @@
 #include "bongo/db/query/index_bounds_builder.h"
 #include "bongo/db/query/internal_plans.h"
 #include "bongo/db/query/plan_cache.h"
+#include "bongo/db/query/plan_cost_estimator.h"
 #include "bongo/db/query/plan_executor.h"
 #include "bongo/db/query/planner_access.h"
 #include "bongo/db/query/planner_analysis.h"
@@ -80,6 +81,7 @@
 #include "bongo/db/server_parameters.h"
 #include "bongo/db/service_context.h"
 #include "bongo/db/storage/oplog_hack.h"
+#include "bongo/db/storage/storage_engine.h"
 #include "bongo/db/storage/storage_options.h"
 #include "bongo/scripting/engine.h"
 #include "bongo/stdx/memory.h"
@@ -119,6 +121,58 @@ void filterAllowedIndexEntries(const AllowedIndicesFilter& allowedIndicesFilter,
 namespace {
 // The body is below in the "count hack" section but getExecutor calls it.
 bool turnIxscanIntoCount(QuerySolution* soln);
+
+/**
+ * Returns how many threads may scan 'collection' for 'canonicalQuery', if it is answered by a
+ * collection scan alone, or 1 if the query's own thread must do the scan.
+ */
+size_t getNumCollScanWorkers(OperationContext* txn,
+                             Collection* collection,
+                             const CanonicalQuery& canonicalQuery) {
+    const int maxWorkers = internalQueryParallelCollScanMaxWorkers.load();
+    if (maxWorkers <= 1) {
+        return 1;
+    }
+
+    // The threads read the collection in snapshots and under locks of their own. That needs
+    // document-level locking, and rules out majority reads and callers holding locks which the
+    // query cannot yield while it waits for the threads.
+    StorageEngine* storageEngine = txn->getServiceContext()->getGlobalStorageEngine();
+    Locker* locker = txn->lockState();
+    if (!storageEngine->supportsDocLocking() ||
+        txn->recoveryUnit()->isReadingFromMajorityCommittedSnapshot() ||
+        txn->getClient()->isInDirectClient() || locker->isWriteLocked() || locker->isR()) {
+        return 1;
+    }
+
+    if (collection->isCapped() ||
+        collection->numRecords(txn) < internalQueryParallelCollScanMinRecords.load()) {
+        return 1;
+    }
+
+    // The documents come back in no particular order, so queries that depend on the order of the
+    // collection, or that stop early, keep to a single thread. $where cannot be evaluated by
+    // several threads at once.
+    const QueryRequest& qr = canonicalQuery.getQueryRequest();
+    if (qr.isTailable() || qr.isOplogReplay() || qr.isSnapshot() || qr.getMaxScan() ||
+        qr.getLimit() || qr.getNToReturn() || !qr.getSort()["$natural"].eoo() ||
+        !qr.getHint()["$natural"].eoo() ||
+        QueryPlannerCommon::hasNode(canonicalQuery.root(), MatchExpression::WHERE)) {
+        return 1;
+    }
+
+    return maxWorkers;
+}
+
+/**
+ * Lets the collection scan at the root of 'solution', if any, use 'numWorkers' threads. A scan
+ * below another stage is left alone, as that stage may depend on the order of the collection.
+ */
+void setCollScanWorkers(QuerySolution* solution, size_t numWorkers) {
+    if (STAGE_COLLSCAN == solution->root->getType()) {
+        static_cast<CollectionScanNode*>(solution->root.get())->numWorkers = numWorkers;
+    }
+}
 }  // namespace
 
 
@@ -188,6 +242,10 @@ void fillOutPlannerParams(OperationContext* txn,
         plannerParams->options |= QueryPlannerParams::INDEX_INTERSECTION;
     }
 
+    if (internalQueryPlannerEnableSkipScan.load()) {
+        plannerParams->options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    }
+
     plannerParams->options |= QueryPlannerParams::SPLIT_LIMITED_SORT;
 
     // Doc-level locking storage engines cannot answer predicates implicitly via exact index
@@ -418,8 +476,28 @@ StatusWith<PrepareExecutionResult> prepareExecution(OperationContext* opCtx,
         }
     }
 
+    // Estimate the cost of each solution from statistics on the collection, and drop those that
+    // are too expensive to be worth a trial run.
+    if (internalQueryPlannerEnableCostBasedPruning.load()) {
+        auto statistics = collection->infoCache()->getCollectionStatistics(opCtx);
+        if (statistics) {
+            const size_t numPruned = PlanCostEstimator(*statistics).pruneSolutions(
+                &solutions, internalQueryPlannerCostPruningRatio.load());
+            if (numPruned > 0) {
+                LOG(2) << "Pruned " << numPruned << " of " << numPruned + solutions.size()
+                       << " candidate plans by estimated cost: "
+                       << redact(canonicalQuery->toStringShort());
+            }
+        }
+    }
+
     if (1 == solutions.size()) {
         // Only one possible plan.  Run it.  Build the stages from the solution.
+        if (plannerParams.options & QueryPlannerParams::PARALLEL_COLLSCAN) {
+            setCollScanWorkers(solutions[0],
+                               getNumCollScanWorkers(opCtx, collection, *canonicalQuery));
+        }
+
         PlanStage* rawRoot;
         verify(
             StageBuilder::build(opCtx, collection, *canonicalQuery, *solutions[0], ws, &rawRoot));
@@ -623,6 +701,9 @@ StatusWith<unique_ptr<PlanExecutor>> getExecutorFind(OperationContext* txn,
     }
 
     size_t options = QueryPlannerParams::DEFAULT;
+    if (PlanExecutor::YIELD_AUTO == yieldPolicy) {
+        options |= QueryPlannerParams::PARALLEL_COLLSCAN;
+    }
     if (ShardingState::get(txn)->needCollectionMetadata(txn, nss.ns())) {
         options |= QueryPlannerParams::INCLUDE_SHARD_FILTER;
     }
@@ -1280,7 +1361,10 @@ StatusWith<unique_ptr<PlanExecutor>> getExecutorCount(OperationContext* txn,
             txn, std::move(ws), std::move(root), request.getNs().ns(), yieldPolicy);
     }
 
-    const size_t plannerOptions = QueryPlannerParams::IS_COUNT;
+    size_t plannerOptions = QueryPlannerParams::IS_COUNT;
+    if (PlanExecutor::YIELD_AUTO == yieldPolicy) {
+        plannerOptions |= QueryPlannerParams::PARALLEL_COLLSCAN;
+    }
     StatusWith<PrepareExecutionResult> executionResult =
         prepareExecution(txn, collection, ws.get(), std::move(cq), plannerOptions);
     if (!executionResult.isOK()) {
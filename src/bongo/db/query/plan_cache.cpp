@@ -48,6 +48,9 @@
 #include <memory>
 
 namespace bongo {
+
+PlanCacheMetrics planCacheMetrics;
+
 namespace {
 
 // Delimiters for cache key encoding.
@@ -60,6 +63,18 @@ const char kEncodeSortSection = '~';
 const char kEncodeProjectionSection = '|';
 const char kEncodeCollationSection = '#';
 
+/**
+ * Acquires 'mutex', counting the acquisition as contended if another thread holds it.
+ */
+stdx::unique_lock<stdx::mutex> lockShardMutex(stdx::mutex& mutex) {
+    stdx::unique_lock<stdx::mutex> lk(mutex, stdx::try_to_lock);
+    if (!lk.owns_lock()) {
+        planCacheMetrics.contended.increment();
+        lk.lock();
+    }
+    return lk;
+}
+
 /**
  * Encode user-provided string. Cache key delimiters seen in the
  * user string are escaped with a backslash.
@@ -360,6 +375,36 @@ PlanCacheEntry::~PlanCacheEntry() {
     }
 }
 
+//
+// PlanCacheEntryPerformance
+//
+
+void PlanCacheEntryPerformance::record(size_t works) {
+    ++numRuns;
+    const double delta = works - meanWorks;
+    meanWorks += delta / numRuns;
+    sumSquaredDeviations += delta * (works - meanWorks);
+}
+
+double PlanCacheEntryPerformance::stdDev() const {
+    if (numRuns < 2) {
+        return 0;
+    }
+    return sqrt(sumSquaredDeviations / (numRuns - 1));
+}
+
+double PlanCacheEntryPerformance::zScore(size_t works) const {
+    return (works - meanWorks) / std::max(stdDev(), 1.0);
+}
+
+double PlanCacheEntryPerformance::worksAtZScore(double zScore) const {
+    return meanWorks + zScore * std::max(stdDev(), 1.0);
+}
+
+//
+// PlanCacheEntry
+//
+
 PlanCacheEntry* PlanCacheEntry::clone() const {
     OwnedPointerVector<QuerySolution> solutions;
     for (size_t i = 0; i < plannerData.size(); ++i) {
@@ -380,8 +425,11 @@ PlanCacheEntry* PlanCacheEntry::clone() const {
         PlanCacheEntryFeedback* fb = new PlanCacheEntryFeedback();
         fb->stats.reset(feedback[i]->stats->clone());
         fb->score = feedback[i]->score;
+        fb->trialWorks = feedback[i]->trialWorks;
         entry->feedback.push_back(fb);
     }
+    entry->performance = performance;
+    entry->lastReplanDate = lastReplanDate;
     return entry;
 }
 
@@ -470,6 +518,7 @@ SolutionCacheData* SolutionCacheData::clone() const {
     }
     other->solnType = this->solnType;
     other->wholeIXSolnDir = this->wholeIXSolnDir;
+    other->skipScanPrefixLen = this->skipScanPrefixLen;
     other->indexFilterApplied = this->indexFilterApplied;
     return other;
 }
@@ -483,6 +532,11 @@ std::string SolutionCacheData::toString() const {
                                  << "tree=" << this->tree->toString() << ")";
         case COLLSCAN_SOLN:
             return "(collection scan)";
+        case SKIP_SCAN_SOLN:
+            verify(this->tree.get());
+            return str::stream() << "(skip scan solution: "
+                                 << "prefixLen=" << this->skipScanPrefixLen << "; "
+                                 << "tree=" << this->tree->toString() << ")";
         case USE_INDEX_TAGS_SOLN:
             verify(this->tree.get());
             return str::stream() << "(index-tagged expression tree: "
@@ -495,9 +549,13 @@ std::string SolutionCacheData::toString() const {
 // PlanCache
 //
 
-PlanCache::PlanCache() : _cache(internalQueryCacheSize.load()) {}
+PlanCache::PlanCache() : PlanCache("") {}
 
-PlanCache::PlanCache(const std::string& ns) : _cache(internalQueryCacheSize.load()), _ns(ns) {}
+PlanCache::PlanCache(const std::string& ns)
+    : _maxShardSize(std::max(
+          static_cast<size_t>(1),
+          (std::max(0, internalQueryCacheSize.load()) + kNumShards - 1) / kNumShards)),
+      _ns(ns) {}
 
 PlanCache::~PlanCache() {}
 
@@ -633,6 +691,52 @@ void PlanCache::encodeKeyForProj(const BSONObj& projObj, StringBuilder* keyBuild
     }
 }
 
+PlanCache::Shard& PlanCache::shardFor(const PlanCacheKey& key) const {
+    return _shards[std::hash<PlanCacheKey>()(key) % kNumShards];
+}
+
+std::shared_ptr<PlanCache::ShardEntry> PlanCache::lookup(Shard& shard,
+                                                         const PlanCacheKey& key) const {
+    std::shared_ptr<const ShardMap> snapshot = std::atomic_load(&shard.snapshot);
+    auto it = snapshot->find(key);
+    if (it == snapshot->end()) {
+        return nullptr;
+    }
+    it->second->lastUsed.store(shard.clock.addAndFetch(1));
+    return it->second;
+}
+
+void PlanCache::flushFeedback(Shard& shard) const {
+    std::vector<std::pair<PlanCacheKey, std::unique_ptr<PlanCacheEntryFeedback>>> batch;
+    {
+        stdx::unique_lock<stdx::mutex> feedbackLock = lockShardMutex(shard.feedbackMutex);
+        batch.swap(shard.pendingFeedback);
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+    const ShardMap& snapshot = *shard.snapshot;
+    for (auto& keyAndFeedback : batch) {
+        // Feedback for entries removed since it was queued is dropped.
+        auto it = snapshot.find(keyAndFeedback.first);
+        if (it == snapshot.end()) {
+            continue;
+        }
+
+        PlanCacheEntry* entry = it->second->entry.get();
+        entry->performance.record(keyAndFeedback.second->trialWorks);
+
+        // We store up to a constant number of feedback entries.
+        std::vector<PlanCacheEntryFeedback*>& feedback = entry->feedback;
+        if (feedback.size() < static_cast<size_t>(internalQueryCacheFeedbacksStored.load())) {
+            feedback.push_back(keyAndFeedback.second.release());
+        }
+    }
+    planCacheMetrics.feedbackBatches.increment();
+}
+
 Status PlanCache::add(const CanonicalQuery& query,
                       const std::vector<QuerySolution*>& solns,
                       PlanRankingDecision* why) {
@@ -674,12 +778,45 @@ Status PlanCache::add(const CanonicalQuery& query,
     }
     entry->projection = projBuilder.obj();
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    std::unique_ptr<PlanCacheEntry> evictedEntry = _cache.add(computeKey(query), entry);
+    PlanCacheKey key = computeKey(query);
+    Shard& shard = shardFor(key);
+    auto newEntry = std::make_shared<ShardEntry>(std::unique_ptr<PlanCacheEntry>(entry),
+                                                 shard.clock.addAndFetch(1));
+
+    std::shared_ptr<ShardEntry> evictedEntry;
+    {
+        stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+        auto newSnapshot = std::make_shared<ShardMap>(*shard.snapshot);
+        std::shared_ptr<ShardEntry>& slot = (*newSnapshot)[key];
+        if (slot) {
+            // The previous entry's feedback is not carried over, but when it was last
+            // replanned is, so that its replacement is not replanned again straight away.
+            newEntry->entry->lastReplanDate = slot->entry->lastReplanDate;
+        }
+        slot = std::move(newEntry);
+
+        if (newSnapshot->size() > _maxShardSize) {
+            auto leastRecent = newSnapshot->end();
+            for (auto it = newSnapshot->begin(); it != newSnapshot->end(); ++it) {
+                if (it->first != key &&
+                    (leastRecent == newSnapshot->end() ||
+                     it->second->lastUsed.load() < leastRecent->second->lastUsed.load())) {
+                    leastRecent = it;
+                }
+            }
+            if (leastRecent != newSnapshot->end()) {
+                evictedEntry = std::move(leastRecent->second);
+                newSnapshot->erase(leastRecent);
+            }
+        }
+
+        std::atomic_store(&shard.snapshot, std::shared_ptr<const ShardMap>(std::move(newSnapshot)));
+    }
 
-    if (NULL != evictedEntry.get()) {
+    if (evictedEntry) {
+        planCacheMetrics.evictions.increment();
         LOG(1) << _ns << ": plan cache maximum size exceeded - "
-               << "removed least recently used entry " << redact(evictedEntry->toString());
+               << "removed least recently used entry " << redact(evictedEntry->entry->toString());
     }
 
     return Status::OK();
@@ -689,15 +826,14 @@ Status PlanCache::get(const CanonicalQuery& query, CachedSolution** crOut) const
     PlanCacheKey key = computeKey(query);
     verify(crOut);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(key, &entry);
-    if (!cacheStatus.isOK()) {
-        return cacheStatus;
+    std::shared_ptr<ShardEntry> shardEntry = lookup(shardFor(key), key);
+    if (!shardEntry) {
+        planCacheMetrics.misses.increment();
+        return Status(ErrorCodes::NoSuchKey, "no such key in cache");
     }
-    invariant(entry);
+    planCacheMetrics.hits.increment();
 
-    *crOut = new CachedSolution(key, *entry);
+    *crOut = new CachedSolution(key, *shardEntry->entry);
 
     return Status::OK();
 }
@@ -708,31 +844,89 @@ Status PlanCache::feedback(const CanonicalQuery& cq, PlanCacheEntryFeedback* fee
     }
     std::unique_ptr<PlanCacheEntryFeedback> autoFeedback(feedback);
     PlanCacheKey ck = computeKey(cq);
+    Shard& shard = shardFor(ck);
+
+    if (!std::atomic_load(&shard.snapshot)->count(ck)) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in cache");
+    }
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(ck, &entry);
-    if (!cacheStatus.isOK()) {
-        return cacheStatus;
+    bool batchFull;
+    {
+        stdx::unique_lock<stdx::mutex> feedbackLock = lockShardMutex(shard.feedbackMutex);
+        shard.pendingFeedback.emplace_back(std::move(ck), std::move(autoFeedback));
+        batchFull = shard.pendingFeedback.size() >= kFeedbackBatchSize;
     }
-    invariant(entry);
 
-    // We store up to a constant number of feedback entries.
-    if (entry->feedback.size() < static_cast<size_t>(internalQueryCacheFeedbacksStored.load())) {
-        entry->feedback.push_back(autoFeedback.release());
+    if (batchFull) {
+        flushFeedback(shard);
     }
 
     return Status::OK();
 }
 
+size_t PlanCache::getSignificantTrialWorks(const CanonicalQuery& cq) const {
+    PlanCacheKey key = computeKey(cq);
+    Shard& shard = shardFor(key);
+
+    // The performance is only modified under the write lock, which we need to hold to read it.
+    flushFeedback(shard);
+    stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+    std::shared_ptr<ShardEntry> shardEntry = lookup(shard, key);
+    if (!shardEntry) {
+        return 0;
+    }
+
+    const PlanCacheEntryPerformance& performance = shardEntry->entry->performance;
+    if (performance.numRuns < static_cast<size_t>(internalQueryCacheReplanMinRuns.load())) {
+        return 0;
+    }
+    return static_cast<size_t>(
+        ceil(performance.worksAtZScore(internalQueryCacheReplanZScore.load())));
+}
+
+PlanCache::ReplanDecision PlanCache::shouldReplan(const CanonicalQuery& cq, Date_t now) {
+    PlanCacheKey key = computeKey(cq);
+    Shard& shard = shardFor(key);
+
+    stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+    std::shared_ptr<ShardEntry> shardEntry = lookup(shard, key);
+    if (!shardEntry) {
+        return ReplanDecision::kReplan;
+    }
+    PlanCacheEntry* entry = shardEntry->entry.get();
+
+    if (now - entry->lastReplanDate <
+        Milliseconds(internalQueryCacheReplanIntervalMillis.load())) {
+        return ReplanDecision::kRateLimited;
+    }
+
+    entry->lastReplanDate = now;
+    return ReplanDecision::kReplan;
+}
+
 Status PlanCache::remove(const CanonicalQuery& canonicalQuery) {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.remove(computeKey(canonicalQuery));
+    PlanCacheKey key = computeKey(canonicalQuery);
+    Shard& shard = shardFor(key);
+
+    stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+    if (!shard.snapshot->count(key)) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in cache");
+    }
+    auto newSnapshot = std::make_shared<ShardMap>(*shard.snapshot);
+    newSnapshot->erase(key);
+    std::atomic_store(&shard.snapshot, std::shared_ptr<const ShardMap>(std::move(newSnapshot)));
+    return Status::OK();
 }
 
 void PlanCache::clear() {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    _cache.clear();
+    for (Shard& shard : _shards) {
+        {
+            stdx::unique_lock<stdx::mutex> feedbackLock = lockShardMutex(shard.feedbackMutex);
+            shard.pendingFeedback.clear();
+        }
+        stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+        std::atomic_store(&shard.snapshot, std::make_shared<const ShardMap>());
+    }
     _writeOperations.store(0);
 }
 
@@ -747,40 +941,59 @@ PlanCacheKey PlanCache::computeKey(const CanonicalQuery& cq) const {
 Status PlanCache::getEntry(const CanonicalQuery& query, PlanCacheEntry** entryOut) const {
     PlanCacheKey key = computeKey(query);
     verify(entryOut);
+    Shard& shard = shardFor(key);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(key, &entry);
-    if (!cacheStatus.isOK()) {
-        return cacheStatus;
+    // Feedback is only modified under the write lock, which we need to hold to copy it.
+    flushFeedback(shard);
+    stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+    std::shared_ptr<ShardEntry> shardEntry = lookup(shard, key);
+    if (!shardEntry) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in cache");
     }
-    invariant(entry);
 
-    *entryOut = entry->clone();
+    *entryOut = shardEntry->entry->clone();
 
     return Status::OK();
 }
 
 std::vector<PlanCacheEntry*> PlanCache::getAllEntries() const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
+    // Entries are returned most recently used first, as when the cache was a single LRU list.
+    // Ticks from different shards are not comparable, so this order is only approximate.
+    std::vector<std::pair<unsigned long long, PlanCacheEntry*>> entriesByRecency;
+    for (Shard& shard : _shards) {
+        flushFeedback(shard);
+        stdx::unique_lock<stdx::mutex> writeLock = lockShardMutex(shard.writeMutex);
+        for (const auto& keyAndEntry : *shard.snapshot) {
+            entriesByRecency.emplace_back(keyAndEntry.second->lastUsed.load(),
+                                          keyAndEntry.second->entry->clone());
+        }
+    }
+    std::stable_sort(entriesByRecency.begin(),
+                     entriesByRecency.end(),
+                     [](const std::pair<unsigned long long, PlanCacheEntry*>& lhs,
+                        const std::pair<unsigned long long, PlanCacheEntry*>& rhs) {
+                         return lhs.first > rhs.first;
+                     });
+
     std::vector<PlanCacheEntry*> entries;
-    typedef std::list<std::pair<PlanCacheKey, PlanCacheEntry*>>::const_iterator ConstIterator;
-    for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
-        PlanCacheEntry* entry = i->second;
-        entries.push_back(entry->clone());
+    for (const auto& recencyAndEntry : entriesByRecency) {
+        entries.push_back(recencyAndEntry.second);
     }
 
     return entries;
 }
 
 bool PlanCache::contains(const CanonicalQuery& cq) const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.hasKey(computeKey(cq));
+    PlanCacheKey key = computeKey(cq);
+    return std::atomic_load(&shardFor(key).snapshot)->count(key) > 0;
 }
 
 size_t PlanCache::size() const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.size();
+    size_t size = 0;
+    for (const Shard& shard : _shards) {
+        size += std::atomic_load(&shard.snapshot)->size();
+    }
+    return size;
 }
 
 void PlanCache::notifyOfIndexEntries(const std::vector<IndexEntry>& indexEntries) {
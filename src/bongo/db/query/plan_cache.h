@@ -28,17 +28,21 @@
 
 #pragma once
 
+#include <array>
 #include <boost/optional/optional.hpp>
+#include <memory>
 #include <set>
 
+#include "bongo/base/counter.h"
 #include "bongo/db/exec/plan_stats.h"
 #include "bongo/db/query/canonical_query.h"
 #include "bongo/db/query/index_tag.h"
-#include "bongo/db/query/lru_key_value.h"
 #include "bongo/db/query/plan_cache_indexability.h"
 #include "bongo/db/query/query_planner_params.h"
 #include "bongo/platform/atomic_word.h"
 #include "bongo/stdx/mutex.h"
+#include "bongo/stdx/unordered_map.h"
+#include "bongo/util/time_support.h"
 
 namespace bongo {
 
@@ -60,6 +64,45 @@ struct PlanCacheEntryFeedback {
     // The "goodness" score produced by the plan ranker
     // corresponding to 'stats'.
     double score;
+
+    // The number of work cycles the cached plan took to finish its trial period.
+    size_t trialWorks = 0;
+};
+
+/**
+ * The distribution of trial period work cycles over the runs of a cached plan which finished
+ * their trial period, kept as a running mean and variance. Runs which were stopped before the
+ * end of their trial period are not recorded, as their works are only a lower bound.
+ */
+struct PlanCacheEntryPerformance {
+    /**
+     * Adds a run which took 'works' work cycles to the distribution.
+     */
+    void record(size_t works);
+
+    /**
+     * Returns the standard deviation of the recorded runs, or 0 if there are fewer than two.
+     */
+    double stdDev() const;
+
+    /**
+     * Returns how many standard deviations 'works' lies above the mean of the recorded runs.
+     * The standard deviation is taken to be at least one work cycle, so that a plan which has
+     * always taken the same number of works does not make every slower run infinitely unlikely.
+     */
+    double zScore(size_t works) const;
+
+    /**
+     * Returns the number of works which lies 'zScore' standard deviations above the mean, the
+     * inverse of zScore().
+     */
+    double worksAtZScore(double zScore) const;
+
+    size_t numRuns = 0;
+    double meanWorks = 0;
+
+    // The sum of squared differences from the mean, as maintained by Welford's algorithm.
+    double sumSquaredDeviations = 0;
 };
 
 // TODO: Replace with opaque type.
@@ -151,6 +194,7 @@ struct SolutionCacheData {
         : tree(nullptr),
           solnType(USE_INDEX_TAGS_SOLN),
           wholeIXSolnDir(1),
+          skipScanPrefixLen(0),
           indexFilterApplied(false) {}
 
     // Make a deep copy.
@@ -174,6 +218,10 @@ struct SolutionCacheData {
         // The cached plan is a collection scan.
         COLLSCAN_SOLN,
 
+        // The cached plan skips through the leading fields of
+        // the index stored in 'tree'.
+        SKIP_SCAN_SOLN,
+
         // Build the solution by using 'tree'
         // to tag the match expression.
         USE_INDEX_TAGS_SOLN
@@ -184,6 +232,10 @@ struct SolutionCacheData {
     // for WHOLE_IXSCAN_SOLN.
     int wholeIXSolnDir;
 
+    // The number of leading index fields skipped through.
+    // Used only for SKIP_SCAN_SOLN.
+    int skipScanPrefixLen;
+
     // True if index filter was applied.
     bool indexFilterApplied;
 };
@@ -279,13 +331,54 @@ public:
     // Annotations from cached runs.  The CachedPlanStage provides these stats about its
     // runs when they complete.
     std::vector<PlanCacheEntryFeedback*> feedback;
+
+    // The distribution of trial period works over all cached runs which provided feedback,
+    // including those no longer kept in 'feedback'.
+    PlanCacheEntryPerformance performance;
+
+    // When the CachedPlanStage last decided to replan this query shape.  Carried over when the
+    // entry is replaced by the result of that replan.
+    Date_t lastReplanDate;
 };
 
+/**
+ * Process-wide counters for all plan caches, reported by serverStatus under
+ * metrics.query.planCache.
+ */
+struct PlanCacheMetrics {
+    // Lookups through get() which did or did not find an entry.
+    Counter64 hits;
+    Counter64 misses;
+
+    // Writers which found a shard's write or feedback lock already held and had to wait.
+    Counter64 contended;
+
+    // Entries removed to keep a shard within its share of internalQueryCacheSize.
+    Counter64 evictions;
+
+    // Batches of queued feedback applied to a shard.
+    Counter64 feedbackBatches;
+
+    // Cached plans which exceeded their trial period budget and were replanned, were kept
+    // because the slowdown was not significant or the shape was replanned too recently, or had
+    // their entry evicted so that the next query of the shape replans.
+    Counter64 replansPerformed;
+    Counter64 replansAvoided;
+    Counter64 replansDeferred;
+};
+
+extern PlanCacheMetrics planCacheMetrics;
+
 /**
  * Caches the best solution to a query.  Aside from the (CanonicalQuery -> QuerySolution)
  * mapping, the cache contains information on why that mapping was made and statistics on the
  * cache entry's actual performance on subsequent runs.
  *
+ * The cache is split into shards by the hash of the query shape.  Each shard publishes an
+ * immutable snapshot of its contents, so lookups only load the current snapshot and never wait
+ * on a writer.  Writers copy the snapshot under the shard's write lock and publish the copy.
+ * Feedback is queued per shard and applied in batches.  Eviction approximates LRU order within
+ * each shard using a recency tick that lookups bump without taking a lock.
  */
 class PlanCache {
 private:
@@ -349,6 +442,38 @@ public:
      */
     Status feedback(const CanonicalQuery& cq, PlanCacheEntryFeedback* feedback);
 
+    /**
+     * Returns the number of work cycles above which a trial period of the cached plan for 'cq'
+     * is a significant regression: internalQueryCacheReplanZScore standard deviations above the
+     * mean of the entry's recorded runs.
+     *
+     * Returns 0 if there is no entry for 'cq' or it has recorded fewer than
+     * internalQueryCacheReplanMinRuns runs.
+     */
+    size_t getSignificantTrialWorks(const CanonicalQuery& cq) const;
+
+    /**
+     * The outcome of shouldReplan().
+     */
+    enum class ReplanDecision {
+        // No other caller has replanned the shape recently.
+        kReplan,
+
+        // The shape was replanned too recently.
+        kRateLimited,
+    };
+
+    /**
+     * Called by the CachedPlanStage when the cached plan for 'cq' has significantly regressed.
+     *
+     * A shape is replanned at most once every internalQueryCacheReplanIntervalMillis; when
+     * kReplan is returned the caller is expected to replan and the shape's replan time is set to
+     * 'now'.
+     *
+     * Returns kReplan if there is no entry for 'cq'.
+     */
+    ReplanDecision shouldReplan(const CanonicalQuery& cq, Date_t now);
+
     /**
      * Remove the entry corresponding to 'ck' from the cache.  Returns Status::OK() if the plan
      * was present and removed and an error status otherwise.
@@ -392,7 +517,6 @@ public:
 
     /**
      * Returns true if there is an entry in the cache for the 'query'.
-     * Internally calls hasKey() on the LRU cache.
      */
     bool contains(const CanonicalQuery& cq) const;
 
@@ -410,15 +534,72 @@ public:
      */
     void notifyOfIndexEntries(const std::vector<IndexEntry>& indexEntries);
 
+    // The number of shards the cache is split into.
+    static const size_t kNumShards = 16;
+
+    // The number of feedback entries queued on a shard before they are applied.
+    static const size_t kFeedbackBatchSize = 32;
+
 private:
+    /**
+     * A cache entry together with the tick of the shard's clock at which it was last used.
+     * Entries are shared between successive snapshots of a shard.  Apart from 'lastUsed' and
+     * the entry's feedback, performance and replan date, which are only touched under the
+     * shard's write lock, they are immutable once published.
+     */
+    struct ShardEntry {
+        ShardEntry(std::unique_ptr<PlanCacheEntry> entry, unsigned long long lastUsed)
+            : entry(std::move(entry)), lastUsed(lastUsed) {}
+
+        const std::unique_ptr<PlanCacheEntry> entry;
+        AtomicUInt64 lastUsed;
+    };
+
+    using ShardMap = stdx::unordered_map<PlanCacheKey, std::shared_ptr<ShardEntry>>;
+
+    struct Shard {
+        Shard() : snapshot(std::make_shared<const ShardMap>()) {}
+
+        // The current contents of the shard.  Readers take a reference with
+        // std::atomic_load(); it is only replaced, with std::atomic_store(), under 'writeMutex'.
+        std::shared_ptr<const ShardMap> snapshot;
+
+        // Serializes writers to the shard.
+        stdx::mutex writeMutex;
+
+        // Advanced on every lookup to order entries for eviction.
+        AtomicUInt64 clock;
+
+        // Protects 'pendingFeedback'.  Never acquired while holding 'writeMutex'.
+        stdx::mutex feedbackMutex;
+        std::vector<std::pair<PlanCacheKey, std::unique_ptr<PlanCacheEntryFeedback>>>
+            pendingFeedback;
+    };
+
     void encodeKeyForMatch(const MatchExpression* tree, StringBuilder* keyBuilder) const;
     void encodeKeyForSort(const BSONObj& sortObj, StringBuilder* keyBuilder) const;
     void encodeKeyForProj(const BSONObj& projObj, StringBuilder* keyBuilder) const;
 
-    LRUKeyValue<PlanCacheKey, PlanCacheEntry> _cache;
+    Shard& shardFor(const PlanCacheKey& key) const;
+
+    /**
+     * Returns the entry for 'key' in the shard's current snapshot, marking it as recently used,
+     * or nullptr if there is none.  Takes no locks.
+     */
+    std::shared_ptr<ShardEntry> lookup(Shard& shard, const PlanCacheKey& key) const;
+
+    /**
+     * Applies the feedback queued on 'shard' to its entries.  Must not be called with the
+     * shard's write lock held.
+     */
+    void flushFeedback(Shard& shard) const;
+
+    // Mutable so that lookups from const methods can bump the recency of an entry and so that
+    // readers of feedback can apply the feedback queued for the shard first.
+    mutable std::array<Shard, kNumShards> _shards;
 
-    // Protects _cache.
-    mutable stdx::mutex _cacheMutex;
+    // The most entries kept in each shard.
+    const size_t _maxShardSize;
 
     // Counter for write notifications since initialization or last clear() invocation.  Starts
     // at 0.
@@ -0,0 +1,146 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kQuery
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/query/plan_cache.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bongo/db/jsobj.h"
+#include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
+#include "bongo/db/query/plan_ranker.h"
+#include "bongo/db/query/query_solution.h"
+#include "bongo/db/query/query_test_service_context.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/log.h"
+#include "bongo/util/timer.h"
+
+namespace {
+
+using namespace bongo;
+
+const int kNumShapes = 64;
+const int kLookupsPerThread = 50000;
+
+// One in this many lookups is followed by feedback, as a CachedPlanStage does after its trial.
+const int kFeedbackInterval = 16;
+
+std::unique_ptr<CanonicalQuery> canonicalize(const BSONObj& queryObj) {
+    QueryTestServiceContext serviceContext;
+    auto txn = serviceContext.makeOperationContext();
+
+    auto qr = stdx::make_unique<QueryRequest>(NamespaceString("test.collection"));
+    qr->setFilter(queryObj);
+    auto statusWithCQ = CanonicalQuery::canonicalize(
+        txn.get(), std::move(qr), ExtensionsCallbackDisallowExtensions());
+    ASSERT_OK(statusWithCQ.getStatus());
+    return std::move(statusWithCQ.getValue());
+}
+
+PlanRankingDecision* createDecision() {
+    auto why = stdx::make_unique<PlanRankingDecision>();
+    auto stats = stdx::make_unique<PlanStageStats>(CommonStats("COLLSCAN"), STAGE_COLLSCAN);
+    stats->specific = stdx::make_unique<CollectionScanStats>();
+    why->stats.mutableVector().push_back(stats.release());
+    why->scores.push_back(0U);
+    why->candidateOrder.push_back(0U);
+    return why.release();
+}
+
+/**
+ * Fills a plan cache with 'kNumShapes' query shapes and then has 'numThreads' threads look them
+ * up concurrently, reporting the aggregate lookup rate.
+ */
+void runLookups(int numThreads) {
+    PlanCache planCache("test.collection");
+    std::vector<std::unique_ptr<CanonicalQuery>> queries;
+    for (int i = 0; i < kNumShapes; ++i) {
+        queries.push_back(canonicalize(BSON(std::string(str::stream() << "f" << i) << 1)));
+
+        QuerySolution qs;
+        qs.cacheData = stdx::make_unique<SolutionCacheData>();
+        qs.cacheData->solnType = SolutionCacheData::COLLSCAN_SOLN;
+        qs.cacheData->tree = stdx::make_unique<PlanCacheIndexTree>();
+        std::vector<QuerySolution*> solns{&qs};
+        ASSERT_OK(planCache.add(*queries.back(), solns, createDecision()));
+    }
+
+    const long long hitsBefore = planCacheMetrics.hits.get();
+    std::vector<stdx::thread> threads;
+    Timer timer;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&planCache, &queries, t] {
+            for (int i = 0; i < kLookupsPerThread; ++i) {
+                const CanonicalQuery& cq = *queries[(i + t * 7) % kNumShapes];
+                CachedSolution* rawCachedSolution;
+                invariantOK(planCache.get(cq, &rawCachedSolution));
+                delete rawCachedSolution;
+
+                if (i % kFeedbackInterval == 0) {
+                    auto feedback = stdx::make_unique<PlanCacheEntryFeedback>();
+                    feedback->stats =
+                        stdx::make_unique<PlanStageStats>(CommonStats("COLLSCAN"), STAGE_COLLSCAN);
+                    feedback->score = 1;
+                    invariantOK(planCache.feedback(cq, feedback.release()));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const long long micros = timer.micros();
+
+    const long long numLookups = static_cast<long long>(numThreads) * kLookupsPerThread;
+    ASSERT_EQ(planCacheMetrics.hits.get() - hitsBefore, numLookups);
+    log() << "THROUGHPUT " << numThreads << " thread(s): "
+          << numLookups * 1000000 / std::max(micros, 1LL) << " lookups/sec, "
+          << planCacheMetrics.contended.get() << " contended lock acquisitions so far";
+}
+
+TEST(PlanCachePerf, OneThread) {
+    runLookups(1);
+}
+
+TEST(PlanCachePerf, FourThreads) {
+    runLookups(4);
+}
+
+TEST(PlanCachePerf, SixteenThreads) {
+    runLookups(16);
+}
+
+}  // namespace
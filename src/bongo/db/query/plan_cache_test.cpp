@@ -33,6 +33,7 @@
 #include "bongo/db/query/plan_cache.h"
 
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <ostream>
 
@@ -422,6 +423,175 @@ TEST(PlanCacheTest, AddValidSolution) {
     ASSERT_EQUALS(planCache.size(), 1U);
 }
 
+/**
+ * Adds an entry for 'cq' to 'planCache' with a single collection scan solution.
+ */
+void addCollscanEntry(PlanCache* planCache, const CanonicalQuery& cq) {
+    QuerySolution qs;
+    qs.cacheData.reset(new SolutionCacheData());
+    qs.cacheData->solnType = SolutionCacheData::COLLSCAN_SOLN;
+    qs.cacheData->tree.reset(new PlanCacheIndexTree());
+    std::vector<QuerySolution*> solns;
+    solns.push_back(&qs);
+    ASSERT_OK(planCache->add(cq, solns, createDecision(1U)));
+}
+
+PlanCacheEntryFeedback* createFeedback(double score) {
+    unique_ptr<PlanCacheEntryFeedback> feedback(new PlanCacheEntryFeedback());
+    feedback->stats.reset(new PlanStageStats(CommonStats("COLLSCAN"), STAGE_COLLSCAN));
+    feedback->score = score;
+    return feedback.release();
+}
+
+TEST(PlanCacheTest, RemoveAndClear) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cqA(canonicalize("{a: 1}"));
+    unique_ptr<CanonicalQuery> cqB(canonicalize("{b: 1}"));
+    addCollscanEntry(&planCache, *cqA);
+    addCollscanEntry(&planCache, *cqB);
+    ASSERT_EQUALS(planCache.size(), 2U);
+
+    ASSERT_OK(planCache.remove(*cqA));
+    ASSERT_NOT_OK(planCache.remove(*cqA));
+    ASSERT_FALSE(planCache.contains(*cqA));
+    ASSERT_TRUE(planCache.contains(*cqB));
+
+    planCache.clear();
+    ASSERT_EQUALS(planCache.size(), 0U);
+    CachedSolution* rawCachedSolution;
+    ASSERT_NOT_OK(planCache.get(*cqB, &rawCachedSolution));
+}
+
+TEST(PlanCacheTest, EvictionKeepsRecentlyUsedEntries) {
+    const int oldCacheSize = internalQueryCacheSize.load();
+    ON_BLOCK_EXIT([oldCacheSize] { internalQueryCacheSize.store(oldCacheSize); });
+    internalQueryCacheSize.store(2 * PlanCache::kNumShards);
+
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> hotQuery(canonicalize("{hot: 1}"));
+    addCollscanEntry(&planCache, *hotQuery);
+
+    // Looking the hot query up before every add keeps it ahead of any entry it shares a shard
+    // with, so it must survive however many other shapes are added.
+    for (int i = 0; i < 500; ++i) {
+        CachedSolution* rawCachedSolution;
+        ASSERT_OK(planCache.get(*hotQuery, &rawCachedSolution));
+        delete rawCachedSolution;
+
+        const std::string fieldName = str::stream() << "f" << i;
+        unique_ptr<CanonicalQuery> cq(canonicalize(BSON(fieldName << 1)));
+        addCollscanEntry(&planCache, *cq);
+        ASSERT_LESS_THAN_OR_EQUALS(planCache.size(), 2 * PlanCache::kNumShards);
+    }
+    ASSERT_TRUE(planCache.contains(*hotQuery));
+}
+
+TEST(PlanCacheTest, FeedbackIsVisibleThroughGetEntry) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+    unique_ptr<CanonicalQuery> uncachedQuery(canonicalize("{b: 1}"));
+    addCollscanEntry(&planCache, *cq);
+
+    // Fewer feedback entries than fill a batch are still applied before the entry is read.
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_OK(planCache.feedback(*cq, createFeedback(i)));
+    }
+    ASSERT_NOT_OK(planCache.feedback(*uncachedQuery, createFeedback(0)));
+
+    PlanCacheEntry* rawEntry;
+    ASSERT_OK(planCache.getEntry(*cq, &rawEntry));
+    unique_ptr<PlanCacheEntry> entry(rawEntry);
+    ASSERT_EQUALS(entry->feedback.size(), 3U);
+    ASSERT_EQUALS(entry->feedback[2]->score, 2);
+
+    // Feedback beyond what is stored per entry is dropped once applied.
+    const size_t numStored = internalQueryCacheFeedbacksStored.load();
+    for (size_t i = 0; i < numStored + PlanCache::kFeedbackBatchSize; ++i) {
+        ASSERT_OK(planCache.feedback(*cq, createFeedback(i)));
+    }
+    ASSERT_OK(planCache.getEntry(*cq, &rawEntry));
+    entry.reset(rawEntry);
+    ASSERT_EQUALS(entry->feedback.size(), numStored);
+}
+
+TEST(PlanCacheTest, EntryPerformanceTracksMeanAndStdDev) {
+    PlanCacheEntryPerformance performance;
+    ASSERT_EQUALS(performance.stdDev(), 0);
+
+    for (size_t works : {2, 4, 4, 4, 5, 5, 7, 9}) {
+        performance.record(works);
+    }
+    ASSERT_EQUALS(performance.numRuns, 8U);
+    ASSERT_APPROX_EQUAL(performance.meanWorks, 5.0, 1e-9);
+    ASSERT_APPROX_EQUAL(performance.stdDev(), std::sqrt(32.0 / 7), 1e-9);
+    ASSERT_APPROX_EQUAL(performance.zScore(9), 4 / std::sqrt(32.0 / 7), 1e-9);
+
+    // A plan which always takes the same number of works still has a finite z-score.
+    PlanCacheEntryPerformance constant;
+    for (int i = 0; i < 5; ++i) {
+        constant.record(10);
+    }
+    ASSERT_APPROX_EQUAL(constant.zScore(13), 3.0, 1e-9);
+}
+
+PlanCacheEntryFeedback* createFeedbackWithWorks(size_t trialWorks) {
+    PlanCacheEntryFeedback* feedback = createFeedback(1);
+    feedback->trialWorks = trialWorks;
+    return feedback;
+}
+
+TEST(PlanCacheTest, SignificantTrialWorksFollowRecordedRuns) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+    ASSERT_EQUALS(planCache.getSignificantTrialWorks(*cq), 0U);
+    addCollscanEntry(&planCache, *cq);
+
+    // Without enough recorded runs, the trial period is not extended.
+    const int minRuns = internalQueryCacheReplanMinRuns.load();
+    for (int i = 0; i < minRuns - 1; ++i) {
+        ASSERT_OK(planCache.feedback(*cq, createFeedbackWithWorks(i % 2 ? 90 : 10)));
+    }
+    ASSERT_EQUALS(planCache.getSignificantTrialWorks(*cq), 0U);
+
+    ASSERT_OK(planCache.feedback(*cq, createFeedbackWithWorks(10)));
+    PlanCacheEntry* rawEntry;
+    ASSERT_OK(planCache.getEntry(*cq, &rawEntry));
+    unique_ptr<PlanCacheEntry> entry(rawEntry);
+    const double expected =
+        entry->performance.worksAtZScore(internalQueryCacheReplanZScore.load());
+    ASSERT_GREATER_THAN(expected, 100);
+    ASSERT_EQUALS(planCache.getSignificantTrialWorks(*cq),
+                  static_cast<size_t>(std::ceil(expected)));
+}
+
+TEST(PlanCacheTest, ShouldReplanIsRateLimited) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+    addCollscanEntry(&planCache, *cq);
+    const Date_t start = Date_t::fromMillisSinceEpoch(1000000);
+
+    // By default, every caller may replan.
+    ASSERT(PlanCache::ReplanDecision::kReplan == planCache.shouldReplan(*cq, start));
+    ASSERT(PlanCache::ReplanDecision::kReplan == planCache.shouldReplan(*cq, start));
+
+    // With a replan interval, only one caller may replan the shape within it, even once the
+    // entry has been replaced.
+    const int oldReplanInterval = internalQueryCacheReplanIntervalMillis.load();
+    ON_BLOCK_EXIT(
+        [oldReplanInterval] { internalQueryCacheReplanIntervalMillis.store(oldReplanInterval); });
+    internalQueryCacheReplanIntervalMillis.store(1000);
+
+    const Date_t later = start + Milliseconds(1000);
+    ASSERT(PlanCache::ReplanDecision::kReplan == planCache.shouldReplan(*cq, later));
+    ASSERT(PlanCache::ReplanDecision::kRateLimited ==
+           planCache.shouldReplan(*cq, later + Milliseconds(1)));
+    addCollscanEntry(&planCache, *cq);
+    ASSERT(PlanCache::ReplanDecision::kRateLimited ==
+           planCache.shouldReplan(*cq, later + Milliseconds(1)));
+    ASSERT(PlanCache::ReplanDecision::kReplan ==
+           planCache.shouldReplan(*cq, later + Milliseconds(1000)));
+}
+
 /**
  * Each test in the CachePlanSelectionTest suite goes through
  * the following flow:
@@ -1040,6 +1210,15 @@ TEST_F(CachePlanSelectionTest, CollscanNoUsefulIndices) {
     assertPlanCacheRecoversSolution(BSON("b" << 4), "{cscan: {filter: {b: 4}, dir: 1}}");
 }
 
+TEST_F(CachePlanSelectionTest, SkipScanNoUsefulIndices) {
+    params.options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    addIndex(BSON("a" << 1 << "b" << 1), "a_1_b_1");
+    runQuery(BSON("b" << 4));
+    assertPlanCacheRecoversSolution(BSON("b" << 4),
+                                    "{fetch: {filter: {b: 4}, node: {skipScan: "
+                                    "{pattern: {a: 1, b: 1}, prefixLen: 1}}}}");
+}
+
 TEST_F(CachePlanSelectionTest, CollscanOrWithoutEnoughIndices) {
     addIndex(BSON("a" << 1), "a_1");
     BSONObj query = fromjson("{$or: [{a: 20}, {b: 21}]}");
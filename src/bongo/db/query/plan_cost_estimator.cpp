@@ -0,0 +1,384 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/query/plan_cost_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "bongo/db/matcher/expression_leaf.h"
+#include "bongo/db/query/collection_statistics.h"
+#include "bongo/db/query/query_solution.h"
+
+namespace bongo {
+
+namespace {
+
+// The cost of examining one index key, and of moving to the next interval of the index bounds.
+const double kIndexKeyCost = 1.0;
+const double kIndexSeekCost = 2.0;
+
+// The cost of examining one document during a collection scan, which reads the collection in
+// order, and of fetching one document by RecordId, which reads it out of order.
+const double kCollectionScanDocCost = 1.0;
+const double kFetchDocCost = 3.0;
+
+// The cost of adding one result to a hash table or merging it with other sorted results, and of
+// one comparison during a blocking sort.
+const double kMergeCost = 0.2;
+const double kSortCompareCost = 0.2;
+
+// Selectivities assumed for predicates on fields without a histogram.
+const double kDefaultEqualitySelectivity = 0.1;
+const double kDefaultRangeSelectivity = 1.0 / 3.0;
+const double kDefaultOtherSelectivity = 0.5;
+
+bool isAllValues(const OrderedIntervalList& oil) {
+    if (oil.intervals.size() != 1) {
+        return false;
+    }
+    const Interval& interval = oil.intervals[0];
+    return (interval.start.type() == MinKey && interval.end.type() == MaxKey) ||
+        (interval.start.type() == MaxKey && interval.end.type() == MinKey);
+}
+
+bool isAllPoints(const OrderedIntervalList& oil) {
+    return std::all_of(oil.intervals.begin(), oil.intervals.end(), [](const Interval& interval) {
+        return interval.isPoint();
+    });
+}
+
+/**
+ * Returns the fraction of the values in 'histogram' matched by the comparison 'expr'.
+ */
+double estimateComparison(const ComparisonMatchExpression* expr, const KeyHistogram& histogram) {
+    const BSONElement value = expr->getData();
+    BSONObjBuilder bob;
+    switch (expr->matchType()) {
+        case MatchExpression::EQ:
+            return histogram.estimateFraction(value, true, value, true);
+        case MatchExpression::LT:
+        case MatchExpression::LTE:
+            bob.appendMinForType("", value.type());
+            return histogram.estimateFraction(
+                bob.obj().firstElement(), true, value, expr->matchType() == MatchExpression::LTE);
+        case MatchExpression::GT:
+        case MatchExpression::GTE:
+            bob.appendMaxForType("", value.type());
+            return histogram.estimateFraction(
+                value, expr->matchType() == MatchExpression::GTE, bob.obj().firstElement(), true);
+        default:
+            return kDefaultOtherSelectivity;
+    }
+}
+
+}  // namespace
+
+PlanCostEstimator::PlanCostEstimator(const CollectionStatistics& stats) : _stats(stats) {}
+
+double PlanCostEstimator::estimateSelectivity(const MatchExpression* expr) const {
+    if (!expr) {
+        return 1.0;
+    }
+
+    switch (expr->matchType()) {
+        case MatchExpression::AND: {
+            double selectivity = 1.0;
+            for (size_t i = 0; i < expr->numChildren(); ++i) {
+                selectivity *= estimateSelectivity(expr->getChild(i));
+            }
+            return selectivity;
+        }
+        case MatchExpression::OR:
+        case MatchExpression::NOR: {
+            double notSelected = 1.0;
+            for (size_t i = 0; i < expr->numChildren(); ++i) {
+                notSelected *= 1.0 - estimateSelectivity(expr->getChild(i));
+            }
+            return expr->matchType() == MatchExpression::OR ? 1.0 - notSelected : notSelected;
+        }
+        case MatchExpression::NOT:
+            return 1.0 - estimateSelectivity(expr->getChild(0));
+        case MatchExpression::ALWAYS_FALSE:
+            return 0.0;
+        case MatchExpression::EQ:
+        case MatchExpression::LT:
+        case MatchExpression::LTE:
+        case MatchExpression::GT:
+        case MatchExpression::GTE: {
+            auto comparison = static_cast<const ComparisonMatchExpression*>(expr);
+            const KeyHistogram* histogram = _stats.getFieldHistogram(comparison->path());
+            if (histogram && !comparison->getCollator()) {
+                return estimateComparison(comparison, *histogram);
+            }
+            return expr->matchType() == MatchExpression::EQ ? kDefaultEqualitySelectivity
+                                                            : kDefaultRangeSelectivity;
+        }
+        case MatchExpression::MATCH_IN: {
+            auto in = static_cast<const InMatchExpression*>(expr);
+            const KeyHistogram* histogram = _stats.getFieldHistogram(in->path());
+            double selectivity = in->getRegexes().size() * kDefaultOtherSelectivity;
+            for (const BSONElement& value : in->getEqualities()) {
+                selectivity += histogram && !in->getCollator()
+                    ? histogram->estimateFraction(value, true, value, true)
+                    : kDefaultEqualitySelectivity;
+            }
+            return std::min(1.0, selectivity);
+        }
+        default:
+            return kDefaultOtherSelectivity;
+    }
+}
+
+double PlanCostEstimator::estimateKeyFraction(const IndexBounds& bounds,
+                                              const IndexStatistics& indexStats) const {
+    const KeyHistogram& histogram = indexStats.leadingField;
+    if (bounds.isSimpleRange) {
+        return histogram.estimateFraction(
+            bounds.startKey.firstElement(), true, bounds.endKey.firstElement(), true);
+    }
+    if (bounds.fields.empty()) {
+        return 1.0;
+    }
+
+    double fraction = 0;
+    for (const Interval& interval : bounds.fields[0].intervals) {
+        fraction += histogram.estimateFraction(
+            interval.start, interval.startInclusive, interval.end, interval.endInclusive);
+    }
+    if (!bounds.fields[0].intervals.empty()) {
+        // A value that was not sampled is assumed to be as common as half a sampled value, rather
+        // than absent.
+        fraction = std::max(fraction, 0.5 / std::max(1.0, histogram.numValues()));
+    }
+    fraction = std::min(1.0, fraction);
+
+    // While the bounds on the preceding fields are points, equality on the next field keeps the
+    // share of keys that the number of distinct prefixes says each of its values has.
+    bool prefixIsPoints = isAllPoints(bounds.fields[0]);
+    for (size_t i = 1; i < bounds.fields.size(); ++i) {
+        const OrderedIntervalList& oil = bounds.fields[i];
+        if (isAllValues(oil)) {
+            prefixIsPoints = false;
+            continue;
+        }
+
+        const double numIntervals = oil.intervals.size();
+        if (prefixIsPoints && isAllPoints(oil)) {
+            fraction *= std::min(1.0,
+                                 numIntervals * indexStats.distinctPrefixes(i) /
+                                     indexStats.distinctPrefixes(i + 1));
+        } else if (isAllPoints(oil)) {
+            fraction *= std::min(1.0, numIntervals * kDefaultEqualitySelectivity);
+            prefixIsPoints = false;
+        } else {
+            fraction *= kDefaultRangeSelectivity;
+            prefixIsPoints = false;
+        }
+    }
+    return fraction;
+}
+
+boost::optional<PlanCostEstimator::Estimate> PlanCostEstimator::estimate(
+    QuerySolutionNode* node) const {
+    std::vector<Estimate> children;
+    for (QuerySolutionNode* child : node->children) {
+        auto childEstimate = estimate(child);
+        if (!childEstimate) {
+            return boost::none;
+        }
+        children.push_back(*childEstimate);
+    }
+
+    const double numRecords = _stats.numRecords();
+    const double selectivity = estimateSelectivity(node->filter.get());
+
+    Estimate result;
+    switch (node->getType()) {
+        case STAGE_COLLSCAN:
+            result.cost = numRecords * kCollectionScanDocCost;
+            result.nReturned = numRecords * selectivity;
+            break;
+        case STAGE_IXSCAN: {
+            auto ixn = static_cast<const IndexScanNode*>(node);
+            const IndexStatistics* indexStats = _stats.getIndex(ixn->index.name);
+            if (!indexStats) {
+                return boost::none;
+            }
+            const double numKeys =
+                indexStats->numKeys * estimateKeyFraction(ixn->bounds, *indexStats);
+            const double numSeeks = ixn->bounds.isSimpleRange
+                ? 1
+                : std::max<size_t>(1, ixn->bounds.fields.front().intervals.size());
+            result.cost = numKeys * kIndexKeyCost + numSeeks * kIndexSeekCost;
+
+            // A multikey index scan returns each document once, however many keys it has.
+            const double numDocs = ixn->index.multikey
+                ? numKeys / std::max(1.0, indexStats->keysPerRecord)
+                : numKeys;
+            result.nReturned = numDocs * selectivity;
+            break;
+        }
+        case STAGE_SKIP_SCAN: {
+            auto ssn = static_cast<const SkipScanNode*>(node);
+            const IndexStatistics* indexStats = _stats.getIndex(ssn->index.name);
+            if (!indexStats) {
+                return boost::none;
+            }
+            // Under each distinct value of the leading fields we seek once to the start of the
+            // bounds and once past their end.
+            const double numKeys =
+                indexStats->numKeys * estimateKeyFraction(ssn->bounds, *indexStats);
+            const double numPrefixes = indexStats->distinctPrefixes(ssn->prefixLen);
+            result.cost = numKeys * kIndexKeyCost + 2 * numPrefixes * kIndexSeekCost;
+            result.nReturned = numKeys * selectivity;
+            break;
+        }
+        case STAGE_FETCH:
+            result.cost = children[0].cost + children[0].nReturned * kFetchDocCost;
+            result.startupCost = children[0].startupCost;
+            result.nReturned = children[0].nReturned * selectivity;
+            break;
+        case STAGE_AND_HASH:
+        case STAGE_AND_SORTED: {
+            // Assume that the children select independent sets of documents.
+            double fraction = 1.0;
+            for (const Estimate& child : children) {
+                result.cost += child.cost + child.nReturned * kMergeCost;
+                fraction *= numRecords > 0 ? std::min(1.0, child.nReturned / numRecords) : 0;
+            }
+            // Hashing reads every child but the last before producing anything.
+            result.startupCost = node->getType() == STAGE_AND_HASH
+                ? result.cost - children.back().cost
+                : 0;
+            result.nReturned = numRecords * fraction * selectivity;
+            break;
+        }
+        case STAGE_OR:
+        case STAGE_SORT_MERGE: {
+            double nReturned = 0;
+            for (const Estimate& child : children) {
+                result.cost += child.cost + child.nReturned * kMergeCost;
+                result.startupCost += child.startupCost;
+                nReturned += child.nReturned;
+            }
+            result.nReturned = std::min(numRecords, nReturned) * selectivity;
+            break;
+        }
+        case STAGE_SORT: {
+            auto sn = static_cast<const SortNode*>(node);
+            const double n = children[0].nReturned;
+            result.cost = children[0].cost + n * std::log2(std::max(2.0, n)) * kSortCompareCost;
+            result.startupCost = result.cost;
+            result.nReturned = sn->limit ? std::min<double>(sn->limit, n) : n;
+            break;
+        }
+        case STAGE_LIMIT: {
+            auto ln = static_cast<const LimitNode*>(node);
+            const Estimate& child = children[0];
+            result.nReturned = std::min<double>(ln->limit, child.nReturned);
+
+            // Only the share of the child's work that produces the results we keep is done.
+            const double fraction = child.nReturned > 0 ? result.nReturned / child.nReturned : 1.0;
+            result.startupCost = child.startupCost;
+            result.cost = child.startupCost + (child.cost - child.startupCost) * fraction;
+            break;
+        }
+        case STAGE_SKIP: {
+            auto sn = static_cast<const SkipNode*>(node);
+            result = children[0];
+            result.nReturned = std::max(0.0, children[0].nReturned - sn->skip);
+            break;
+        }
+        case STAGE_PROJECTION:
+        case STAGE_SORT_KEY_GENERATOR:
+        case STAGE_SHARDING_FILTER:
+        case STAGE_KEEP_MUTATIONS:
+        case STAGE_ENSURE_SORTED:
+            result = children[0];
+            result.nReturned *= selectivity;
+            break;
+        default:
+            return boost::none;
+    }
+
+    node->estimatedNReturned = result.nReturned;
+    return result;
+}
+
+boost::optional<double> PlanCostEstimator::estimateCost(QuerySolution* solution) const {
+    if (!solution->root) {
+        return boost::none;
+    }
+    auto rootEstimate = estimate(solution->root.get());
+    if (!rootEstimate) {
+        return boost::none;
+    }
+    return rootEstimate->cost;
+}
+
+size_t PlanCostEstimator::pruneSolutions(std::vector<QuerySolution*>* solutions,
+                                         double pruningRatio) const {
+    std::vector<std::pair<double, QuerySolution*>> costs;
+    for (QuerySolution* solution : *solutions) {
+        auto cost = estimateCost(solution);
+        if (!cost) {
+            return 0;
+        }
+        costs.emplace_back(*cost, solution);
+    }
+    if (costs.empty()) {
+        return 0;
+    }
+
+    std::stable_sort(costs.begin(),
+                     costs.end(),
+                     [](const std::pair<double, QuerySolution*>& lhs,
+                        const std::pair<double, QuerySolution*>& rhs) {
+                         return lhs.first < rhs.first;
+                     });
+
+    // Solutions costing less than one index key apart are all kept.
+    const double maxCost = std::max(1.0, costs.front().first) * pruningRatio;
+    size_t numPruned = 0;
+    solutions->clear();
+    for (const auto& cost : costs) {
+        if (cost.first <= maxCost) {
+            solutions->push_back(cost.second);
+        } else {
+            delete cost.second;
+            ++numPruned;
+        }
+    }
+    return numPruned;
+}
+
+}  // namespace bongo
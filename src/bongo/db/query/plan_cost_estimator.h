@@ -0,0 +1,94 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <vector>
+
+namespace bongo {
+
+class CollectionStatistics;
+struct IndexBounds;
+struct IndexStatistics;
+class MatchExpression;
+struct QuerySolution;
+struct QuerySolutionNode;
+
+/**
+ * Estimates the cost of executing query solutions from statistics on the collection they read, so
+ * that candidates which are clearly worse than another need not be run during plan selection.
+ *
+ * Costs are in arbitrary units, in which examining one index key costs 1. Estimating the cost of a
+ * solution also sets the 'estimatedNReturned' of each of its nodes, which explain reports next to
+ * the number of results the corresponding stage actually produced.
+ */
+class PlanCostEstimator {
+public:
+    explicit PlanCostEstimator(const CollectionStatistics& stats);
+
+    /**
+     * Returns the estimated cost of 'solution', or boost::none if it uses a stage that the cost
+     * model does not cover, such as a geo or text search, or an index without statistics.
+     */
+    boost::optional<double> estimateCost(QuerySolution* solution) const;
+
+    /**
+     * Estimates the cost of each of 'solutions', orders them from the cheapest, and deletes those
+     * which cost more than 'pruningRatio' times as much as the cheapest. Leaves 'solutions' as they
+     * are if the cost of any of them cannot be estimated. Returns the number of solutions deleted.
+     */
+    size_t pruneSolutions(std::vector<QuerySolution*>* solutions, double pruningRatio) const;
+
+    /**
+     * Returns the estimated fraction of the collection's documents that match 'expr'.
+     */
+    double estimateSelectivity(const MatchExpression* expr) const;
+
+    /**
+     * Returns the estimated fraction of the keys of an index with statistics 'indexStats' that lie
+     * within 'bounds'.
+     */
+    double estimateKeyFraction(const IndexBounds& bounds, const IndexStatistics& indexStats) const;
+
+private:
+    struct Estimate {
+        // The number of results produced.
+        double nReturned = 0;
+
+        // The cost of producing every result, and the part of it paid before the first result.
+        double cost = 0;
+        double startupCost = 0;
+    };
+
+    boost::optional<Estimate> estimate(QuerySolutionNode* node) const;
+
+    const CollectionStatistics& _stats;
+};
+
+}  // namespace bongo
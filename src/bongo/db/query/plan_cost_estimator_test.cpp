@@ -0,0 +1,269 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/query/plan_cost_estimator.h"
+
+#include "bongo/db/json.h"
+#include "bongo/db/matcher/expression_parser.h"
+#include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
+#include "bongo/db/query/collection_statistics.h"
+#include "bongo/db/query/query_solution.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/unittest/unittest.h"
+
+namespace bongo {
+namespace {
+
+const long long kNumRecords = 100000;
+const size_t kNumSampled = 1000;
+
+std::unique_ptr<MatchExpression> parseMatchExpression(const BSONObj& obj) {
+    StatusWithMatchExpression status =
+        MatchExpressionParser::parse(obj, ExtensionsCallbackDisallowExtensions(), nullptr);
+    ASSERT_OK(status.getStatus());
+    return std::move(status.getValue());
+}
+
+/**
+ * Statistics on a collection with indexes {a: 1}, where 'a' is spread evenly over 1000 values,
+ * {b: 1}, where 90% of the documents have b: 0 and the rest distinct values, and {c: 1, d: 1},
+ * where 'c' is spread evenly over 10 values and each of them comes with 10 values of 'd'.
+ */
+std::unique_ptr<CollectionStatistics> makeStatistics() {
+    auto stats = stdx::make_unique<CollectionStatistics>(kNumRecords, kNumSampled, Date_t());
+
+    std::vector<BSONObj> aKeys, bKeys, cdKeys;
+    for (size_t i = 0; i < kNumSampled; ++i) {
+        aKeys.push_back(BSON("" << static_cast<int>(i)));
+        bKeys.push_back(BSON("" << (i < 900 ? 0 : static_cast<int>(i))));
+        cdKeys.push_back(BSON("" << static_cast<int>(i / 100) << "" << static_cast<int>(i % 10)));
+    }
+    stats->addIndex("a_1", "a", false, IndexStatistics::build(&aKeys, kNumSampled, kNumRecords));
+    stats->addIndex("b_1", "b", false, IndexStatistics::build(&bKeys, kNumSampled, kNumRecords));
+    stats->addIndex(
+        "c_1_d_1", "c", false, IndexStatistics::build(&cdKeys, kNumSampled, kNumRecords));
+    return stats;
+}
+
+Interval pointInterval(int value) {
+    return Interval(BSON("" << value << "" << value), true, true);
+}
+
+IndexScanNode* makeIndexScan(const BSONObj& keyPattern,
+                             const std::string& indexName,
+                             std::vector<Interval> intervals) {
+    auto ixn = new IndexScanNode(IndexEntry(keyPattern, indexName));
+    BSONObjIterator it(keyPattern);
+    for (size_t i = 0; it.more(); ++i) {
+        OrderedIntervalList oil(it.next().fieldName());
+        if (i < intervals.size()) {
+            oil.intervals.push_back(intervals[i]);
+        } else {
+            oil.intervals.push_back(Interval(BSON("" << MINKEY << "" << MAXKEY), true, true));
+        }
+        ixn->bounds.fields.push_back(oil);
+    }
+    return ixn;
+}
+
+QuerySolution* makeSolution(QuerySolutionNode* root) {
+    auto solution = new QuerySolution();
+    solution->root.reset(root);
+    return solution;
+}
+
+QuerySolution* makeFetchSolution(IndexScanNode* ixn, const BSONObj& filter = BSONObj()) {
+    auto fetch = new FetchNode();
+    fetch->children.push_back(ixn);
+    if (!filter.isEmpty()) {
+        fetch->filter = parseMatchExpression(filter);
+    }
+    return makeSolution(fetch);
+}
+
+QuerySolution* makeCollScanSolution(const BSONObj& filter) {
+    auto csn = new CollectionScanNode();
+    csn->filter = parseMatchExpression(filter);
+    return makeSolution(csn);
+}
+
+TEST(PlanCostEstimatorTest, EstimatesIndexScanCardinality) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    std::unique_ptr<QuerySolution> aSolution(
+        makeFetchSolution(makeIndexScan(BSON("a" << 1), "a_1", {pointInterval(5)})));
+    std::unique_ptr<QuerySolution> bSolution(
+        makeFetchSolution(makeIndexScan(BSON("b" << 1), "b_1", {pointInterval(0)})));
+
+    ASSERT(estimator.estimateCost(aSolution.get()));
+    ASSERT(estimator.estimateCost(bSolution.get()));
+    ASSERT_APPROX_EQUAL(100, aSolution->root->estimatedNReturned, 1);
+    ASSERT_APPROX_EQUAL(90000, bSolution->root->estimatedNReturned, 1);
+    ASSERT_EQ(aSolution->root->estimatedNReturned,
+              aSolution->root->children[0]->estimatedNReturned);
+}
+
+TEST(PlanCostEstimatorTest, UsesDistinctPrefixesForCompoundEqualities) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    std::unique_ptr<QuerySolution> solution(makeFetchSolution(makeIndexScan(
+        BSON("c" << 1 << "d" << 1), "c_1_d_1", {pointInterval(5), pointInterval(3)})));
+    ASSERT(estimator.estimateCost(solution.get()));
+
+    // 'c' is one of 10 values, and 'd' one of the 10 values that come with each of them.
+    ASSERT_APPROX_EQUAL(1000, solution->root->estimatedNReturned, 1);
+}
+
+TEST(PlanCostEstimatorTest, EstimatesFilterSelectivityFromHistograms) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    // The parsed expressions point into these objects.
+    const BSONObj eqObj = BSON("b" << 0);
+    const BSONObj rangeObj = fromjson("{a: {$lt: 100}}");
+    const BSONObj inObj = fromjson("{a: {$in: [1, 2, 3]}}");
+    const BSONObj conjunctionObj = fromjson("{a: {$lt: 100}, b: 0}");
+    const BSONObj disjunctionObj = fromjson("{$or: [{b: 0}, {b: 0}]}");
+    const BSONObj unindexedObj = BSON("z" << 1);
+
+    auto eq = parseMatchExpression(eqObj);
+    ASSERT_APPROX_EQUAL(0.9, estimator.estimateSelectivity(eq.get()), 1e-9);
+
+    auto range = parseMatchExpression(rangeObj);
+    ASSERT_APPROX_EQUAL(0.1, estimator.estimateSelectivity(range.get()), 0.01);
+
+    auto in = parseMatchExpression(inObj);
+    ASSERT_APPROX_EQUAL(0.003, estimator.estimateSelectivity(in.get()), 0.001);
+
+    auto conjunction = parseMatchExpression(conjunctionObj);
+    ASSERT_APPROX_EQUAL(0.09, estimator.estimateSelectivity(conjunction.get()), 0.01);
+
+    auto disjunction = parseMatchExpression(disjunctionObj);
+    ASSERT_APPROX_EQUAL(0.99, estimator.estimateSelectivity(disjunction.get()), 1e-9);
+
+    // A field that no index leads with gets a default selectivity.
+    auto unindexed = parseMatchExpression(unindexedObj);
+    ASSERT_GREATER_THAN(estimator.estimateSelectivity(unindexed.get()), 0);
+    ASSERT_LESS_THAN(estimator.estimateSelectivity(unindexed.get()), 1);
+}
+
+TEST(PlanCostEstimatorTest, PrunesExpensiveSolutions) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    const BSONObj filter = BSON("a" << 5 << "b" << 0);
+    std::vector<QuerySolution*> solutions{
+        makeFetchSolution(makeIndexScan(BSON("b" << 1), "b_1", {pointInterval(0)}), filter),
+        makeCollScanSolution(filter),
+        makeFetchSolution(makeIndexScan(BSON("a" << 1), "a_1", {pointInterval(5)}), filter),
+    };
+    QuerySolution* aSolution = solutions[2];
+
+    ASSERT_EQ(2U, estimator.pruneSolutions(&solutions, 10.0));
+    ASSERT_EQ(1U, solutions.size());
+    ASSERT_EQ(aSolution, solutions[0]);
+    delete solutions[0];
+}
+
+TEST(PlanCostEstimatorTest, OrdersSolutionsWithinPruningRatio) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    const BSONObj filter = BSON("d" << 3);
+    std::vector<QuerySolution*> solutions{
+        makeFetchSolution(makeIndexScan(BSON("c" << 1 << "d" << 1), "c_1_d_1", {pointInterval(5)}),
+                          filter),
+        makeFetchSolution(makeIndexScan(BSON("c" << 1 << "d" << 1),
+                                        "c_1_d_1",
+                                        {pointInterval(5), pointInterval(3)})),
+    };
+    QuerySolution* compoundSolution = solutions[1];
+
+    ASSERT_EQ(0U, estimator.pruneSolutions(&solutions, 1000.0));
+    ASSERT_EQ(2U, solutions.size());
+    ASSERT_EQ(compoundSolution, solutions[0]);
+    for (auto solution : solutions) {
+        delete solution;
+    }
+}
+
+TEST(PlanCostEstimatorTest, LimitFavorsSolutionsWithoutBlockingSort) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    // Sorting by 'a' with an index on it, or with a blocking sort of a collection scan.
+    auto indexed = new LimitNode();
+    indexed->limit = 10;
+    auto fetch = new FetchNode();
+    fetch->children.push_back(makeIndexScan(BSON("a" << 1), "a_1", {}));
+    indexed->children.push_back(fetch);
+
+    auto sort = new SortNode();
+    sort->pattern = BSON("a" << 1);
+    sort->children.push_back(new CollectionScanNode());
+    auto blocking = new LimitNode();
+    blocking->limit = 10;
+    blocking->children.push_back(sort);
+
+    std::unique_ptr<QuerySolution> indexedSolution(makeSolution(indexed));
+    std::unique_ptr<QuerySolution> blockingSolution(makeSolution(blocking));
+    auto indexedCost = estimator.estimateCost(indexedSolution.get());
+    auto blockingCost = estimator.estimateCost(blockingSolution.get());
+    ASSERT(indexedCost);
+    ASSERT(blockingCost);
+    ASSERT_LESS_THAN(*indexedCost * 100, *blockingCost);
+    ASSERT_EQ(10, indexedSolution->root->estimatedNReturned);
+    ASSERT_EQ(10, blockingSolution->root->estimatedNReturned);
+}
+
+TEST(PlanCostEstimatorTest, DoesNotPruneWithoutStatisticsForEveryIndex) {
+    auto stats = makeStatistics();
+    PlanCostEstimator estimator(*stats);
+
+    const BSONObj filter = BSON("a" << 5 << "e" << 0);
+    std::vector<QuerySolution*> solutions{
+        makeFetchSolution(makeIndexScan(BSON("e" << 1), "e_1", {pointInterval(0)}), filter),
+        makeCollScanSolution(filter),
+        makeFetchSolution(makeIndexScan(BSON("a" << 1), "a_1", {pointInterval(5)}), filter),
+    };
+    std::vector<QuerySolution*> original = solutions;
+
+    ASSERT_FALSE(estimator.estimateCost(solutions[0]));
+    ASSERT_EQ(0U, estimator.pruneSolutions(&solutions, 10.0));
+    ASSERT(original == solutions);
+    for (auto solution : solutions) {
+        delete solution;
+    }
+}
+
+}  // namespace
+}  // namespace bongo
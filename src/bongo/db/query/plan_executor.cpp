@@ -351,6 +351,19 @@ PlanExecutor::ExecState PlanExecutor::getNext(BSONObj* objOut, RecordId* dlOut)
     return state;
 }
 
+PlanExecutor::ExecState PlanExecutor::getNextBatch(size_t maxResults,
+                                                   std::vector<BSONObj>* objsOut) {
+    invariant(maxResults > 0);
+    Snapshotted<BSONObj> errorObj;
+    ExecState state = getNextImpl(&errorObj, NULL, objsOut, maxResults);
+
+    if (PlanExecutor::DEAD == state || PlanExecutor::FAILURE == state) {
+        objsOut->push_back(errorObj.value());
+    }
+
+    return state;
+}
+
 PlanExecutor::ExecState PlanExecutor::getNextSnapshotted(Snapshotted<BSONObj>* objOut,
                                                          RecordId* dlOut) {
     // Detaching from the OperationContext means that the returned snapshot ids could be invalid.
@@ -358,7 +371,10 @@ PlanExecutor::ExecState PlanExecutor::getNextSnapshotted(Snapshotted<BSONObj>* o
     return getNextImpl(objOut, dlOut);
 }
 
-PlanExecutor::ExecState PlanExecutor::getNextImpl(Snapshotted<BSONObj>* objOut, RecordId* dlOut) {
+PlanExecutor::ExecState PlanExecutor::getNextImpl(Snapshotted<BSONObj>* objOut,
+                                                  RecordId* dlOut,
+                                                  std::vector<BSONObj>* batchOut,
+                                                  size_t maxBatchResults) {
     BONGO_FAIL_POINT_BLOCK(planExecutorAlwaysDead, customKill) {
         const BSONObj& data = customKill.getData();
         BSONElement customKillNS = data["namespace"];
@@ -379,10 +395,19 @@ PlanExecutor::ExecState PlanExecutor::getNextImpl(Snapshotted<BSONObj>* objOut,
         return PlanExecutor::DEAD;
     }
 
+    const size_t numBefore = batchOut ? batchOut->size() : 0;
+    if (!_stash.empty() && batchOut) {
+        for (size_t i = 0; i < maxBatchResults && !_stash.empty(); ++i) {
+            batchOut->push_back(_stash.front());
+            _stash.pop_front();
+        }
+        return PlanExecutor::ADVANCED;
+    }
+
     if (!_stash.empty()) {
         invariant(objOut && !dlOut);
         *objOut = {SnapshotId(), _stash.front()};
-        _stash.pop();
+        _stash.pop_front();
         return PlanExecutor::ADVANCED;
     }
 
@@ -422,12 +447,40 @@ PlanExecutor::ExecState PlanExecutor::getNextImpl(Snapshotted<BSONObj>* objOut,
         fetcher.reset();
 
         WorkingSetID id = WorkingSet::INVALID_ID;
-        PlanStage::StageState code = _root->work(&id);
+        PlanStage::StageState code;
+        if (batchOut) {
+            // A batch may do several units of work, and stops short of the next time to yield.
+            _batchIds.clear();
+            const size_t worksBefore = _root->getCommonStats()->works;
+            code = _root->workBatch(std::min(maxBatchResults, _yieldPolicy->workUnitsBeforeYield()),
+                                    &_batchIds,
+                                    &id);
+            _yieldPolicy->recordWorkUnits(_root->getCommonStats()->works - worksBefore);
+        } else {
+            code = _root->work(&id);
+        }
 
         if (code != PlanStage::NEED_YIELD)
             writeConflictsInARow = 0;
 
-        if (PlanStage::ADVANCED == code) {
+        if (PlanStage::ADVANCED == code && batchOut) {
+            for (auto resultId : _batchIds) {
+                WorkingSetMember* member = _workingSet->get(resultId);
+                if (WorkingSetMember::RID_AND_IDX == member->getState()) {
+                    if (1 == member->keyData.size()) {
+                        batchOut->push_back(member->keyData[0].keyData);
+                    }
+                } else if (member->hasObj()) {
+                    batchOut->push_back(member->obj.value());
+                }
+                _workingSet->free(resultId);
+            }
+
+            if (batchOut->size() > numBefore) {
+                return PlanExecutor::ADVANCED;
+            }
+            // None of these results had the data the caller wanted, try again.
+        } else if (PlanStage::ADVANCED == code) {
             WorkingSetMember* member = _workingSet->get(id);
             bool hasRequestedData = true;
 
@@ -573,7 +626,16 @@ void PlanExecutor::setYieldPolicy(YieldPolicy policy,
 }
 
 void PlanExecutor::enqueue(const BSONObj& obj) {
-    _stash.push(obj.getOwned());
+    _stash.push_back(obj.getOwned());
+}
+
+void PlanExecutor::enqueueFront(std::vector<BSONObj>::const_iterator begin,
+                                std::vector<BSONObj>::const_iterator end) {
+    std::deque<BSONObj> owned;
+    for (auto it = begin; it != end; ++it) {
+        owned.push_back(it->getOwned());
+    }
+    _stash.insert(_stash.begin(), owned.begin(), owned.end());
 }
 
 //
@@ -29,9 +29,11 @@
 #pragma once
 
 #include <boost/optional.hpp>
-#include <queue>
+#include <deque>
+#include <vector>
 
 #include "bongo/base/status.h"
+#include "bongo/db/exec/working_set.h"
 #include "bongo/db/invalidation_type.h"
 #include "bongo/db/query/query_solution.h"
 #include "bongo/db/storage/snapshot.h"
@@ -280,11 +282,31 @@ public:
      * For write operations, the return depends on the particulars of the write stage.
      *
      * If a YIELD_AUTO policy is set, then this method may yield.
+     *
+     * Documents are not copied out of the storage engine on their way here: unless it is owned,
+     * the BSONObj returned through objOut points into memory that is only valid until the next
+     * call to getNext() or saveState(). Callers that keep a result around for longer must take
+     * ownership of it, as enqueue() does, and should otherwise copy it straight to its
+     * destination, such as the reply being built.
      */
     ExecState getNextSnapshotted(Snapshotted<BSONObj>* objOut, RecordId* dlOut);
 
     ExecState getNext(BSONObj* objOut, RecordId* dlOut);
 
+    /**
+     * Like getNext(), but appends up to 'maxResults' results to 'objsOut' at once. The plan
+     * produces them a batch at a time where its stages support it (see PlanStage::workBatch()),
+     * which saves a pass through the stage tree per result.
+     *
+     * Returns ADVANCED if at least one result was appended. If DEAD or FAILURE is returned, a
+     * single object describing the error is appended, as getNext() would have returned it.
+     *
+     * The results are only valid until the next call to getNext(), getNextBatch() or
+     * saveState(), unless they are owned. Results that the caller doesn't consume can be
+     * handed back with enqueueFront().
+     */
+    ExecState getNextBatch(size_t maxResults, std::vector<BSONObj>* objsOut);
+
     /**
      * Returns 'true' if the plan is done producing results (or writing), 'false' otherwise.
      *
@@ -371,6 +393,14 @@ public:
      */
     void enqueue(const BSONObj& obj);
 
+    /**
+     * Stashes the results in ['begin', 'end'), which were returned by getNextBatch() but not
+     * consumed by the caller. Unlike enqueue(), these are returned again, in the same order,
+     * before any result that is already stashed.
+     */
+    void enqueueFront(std::vector<BSONObj>::const_iterator begin,
+                      std::vector<BSONObj>::const_iterator end);
+
     /**
      * Helper method which returns a set of BSONObj, where each represents a sort order of our
      * output.
@@ -378,7 +408,14 @@ public:
     BSONObjSet getOutputSorts() const;
 
 private:
-    ExecState getNextImpl(Snapshotted<BSONObj>* objOut, RecordId* dlOut);
+    /**
+     * Implements getNext() and, if 'batchOut' is not null, getNextBatch(). In the latter case,
+     * 'objOut' only receives error objects.
+     */
+    ExecState getNextImpl(Snapshotted<BSONObj>* objOut,
+                          RecordId* dlOut,
+                          std::vector<BSONObj>* batchOut = nullptr,
+                          size_t maxBatchResults = 1);
 
     /**
      * RAII approach to ensuring that plan executors are deregistered.
@@ -472,7 +509,10 @@ private:
     // A stash of results generated by this plan that the user of the PlanExecutor didn't want
     // to consume yet. We empty the queue before retrieving further results from the plan
     // stages.
-    std::queue<BSONObj> _stash;
+    std::deque<BSONObj> _stash;
+
+    // The ids of the results of the last PlanStage::workBatch() call of getNextBatch().
+    std::vector<WorkingSetID> _batchIds;
 
     enum { kUsable, kSaved, kDetached } _currentState = kUsable;
 
@@ -30,6 +30,8 @@
 
 #include "bongo/db/query/plan_yield_policy.h"
 
+#include <limits>
+
 #include "bongo/db/concurrency/write_conflict_exception.h"
 #include "bongo/db/curop.h"
 #include "bongo/db/operation_context.h"
@@ -67,6 +69,18 @@ bool PlanYieldPolicy::shouldYield() {
     return _elapsedTracker.intervalHasElapsed();
 }
 
+size_t PlanYieldPolicy::workUnitsBeforeYield() const {
+    if (!allowedToYield())
+        return std::numeric_limits<size_t>::max();
+    return _elapsedTracker.hitsBeforeMark();
+}
+
+void PlanYieldPolicy::recordWorkUnits(size_t numWorkUnits) {
+    if (!allowedToYield() || numWorkUnits <= 1)
+        return;
+    _elapsedTracker.addHits(static_cast<int32_t>(numWorkUnits - 1));
+}
+
 void PlanYieldPolicy::resetTimer() {
     _elapsedTracker.resetLastTime();
 }
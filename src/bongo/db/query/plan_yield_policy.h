@@ -59,6 +59,20 @@ public:
      */
     bool shouldYield();
 
+    /**
+     * Returns how many units of work a plan can do after a call to shouldYield() that returned
+     * false, counting the first of them, before it is time to yield again. A plan that does several
+     * units between calls to shouldYield() does no more than this many, and reports them with
+     * recordWorkUnits(), so that it yields as often as one that calls it before every unit.
+     */
+    size_t workUnitsBeforeYield() const;
+
+    /**
+     * Counts the 'numWorkUnits' units of work done since the last call to shouldYield(), which
+     * itself counted one of them, towards the time to yield.
+     */
+    void recordWorkUnits(size_t numWorkUnits);
+
     /**
      * Resets the yield timer so that we wait for a while before yielding again.
      */
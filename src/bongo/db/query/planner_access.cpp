@@ -44,6 +44,7 @@
 #include "bongo/db/query/index_bounds_builder.h"
 #include "bongo/db/query/index_tag.h"
 #include "bongo/db/query/indexability.h"
+#include "bongo/db/query/planner_ixselect.h"
 #include "bongo/db/query/query_knobs.h"
 #include "bongo/db/query/query_planner.h"
 #include "bongo/db/query/query_planner_common.h"
@@ -132,6 +133,20 @@ std::vector<bool> canProvideSortWithMergeSort(const std::vector<QuerySolutionNod
     return shouldReverseScan;
 }
 
+/**
+ * Returns true if the 'pos'-th field of 'index' takes the same value in every index key
+ * generated for a document, so that a predicate on that field can be evaluated against the index
+ * key rather than the fetched document. This holds unless the field's path has multikey
+ * components. Multikey indexes without path-level multikey information are assumed to be
+ * multikey on every path.
+ */
+bool isPathCoveredByEveryKey(const IndexEntry& index, size_t pos) {
+    if (!index.multikey) {
+        return true;
+    }
+    return !index.multikeyPaths.empty() && index.multikeyPaths[pos].empty();
+}
+
 }  // namespace
 
 namespace bongo {
@@ -518,9 +533,10 @@ bool QueryPlannerAccess::orNeedsFetch(const ScanBuildingState* scanState) {
     } else if (scanState->loosestBounds == IndexBoundsBuilder::INEXACT_FETCH) {
         return true;
     } else {
+        // handleFilterOr() only records INEXACT_COVERED for predicates on paths that are not
+        // multikey, so they can all be evaluated against the index keys.
         invariant(scanState->loosestBounds == IndexBoundsBuilder::INEXACT_COVERED);
-        const IndexEntry& index = scanState->indices[scanState->currentIndexNumber];
-        return index.multikey;
+        return false;
     }
 }
 
@@ -1201,7 +1217,7 @@ QuerySolutionNode* QueryPlannerAccess::buildIndexedDataAccess(const CanonicalQue
             if (tightness == IndexBoundsBuilder::EXACT) {
                 return soln;
             } else if (tightness == IndexBoundsBuilder::INEXACT_COVERED &&
-                       !indices[tag->index].multikey) {
+                       isPathCoveredByEveryKey(indices[tag->index], tag->pos)) {
                 verify(NULL == soln->filter.get());
                 soln->filter.reset(autoRoot.release());
                 return soln;
@@ -1280,6 +1296,72 @@ QuerySolutionNode* QueryPlannerAccess::scanWholeIndex(const IndexEntry& index,
     return solnRoot;
 }
 
+// static
+QuerySolutionNode* QueryPlannerAccess::makeSkipScan(const IndexEntry& index,
+                                                    const CanonicalQuery& query,
+                                                    const QueryPlannerParams& params,
+                                                    int prefixLen) {
+    invariant(!index.multikey);
+    invariant(prefixLen > 0 && prefixLen < index.keyPattern.nFields());
+
+    // Every field but the 'prefixLen'-th is unconstrained.
+    unique_ptr<SkipScanNode> ssn = make_unique<SkipScanNode>(index);
+    ssn->prefixLen = prefixLen;
+    ssn->bounds.fields.resize(index.keyPattern.nFields());
+    BSONElement elt;
+    BSONObjIterator it(index.keyPattern);
+    for (int i = 0; it.more(); ++i) {
+        BSONElement kpElt = it.next();
+        if (i == prefixLen) {
+            elt = kpElt;
+        } else {
+            IndexBoundsBuilder::allValuesForField(kpElt, &ssn->bounds.fields[i]);
+        }
+    }
+
+    // Only top-level predicates of an AND are known to apply to every result.
+    MatchExpression* root = query.root();
+    std::vector<MatchExpression*> predicates;
+    if (MatchExpression::AND == root->matchType()) {
+        for (size_t i = 0; i < root->numChildren(); ++i) {
+            predicates.push_back(root->getChild(i));
+        }
+    } else {
+        predicates.push_back(root);
+    }
+
+    OrderedIntervalList* oil = &ssn->bounds.fields[prefixLen];
+
+    bool bounded = false;
+    for (MatchExpression* pred : predicates) {
+        if (pred->path() != elt.fieldNameStringData() || pred->isArray() ||
+            !Indexability::nodeCanUseIndexOnOwnField(pred) ||
+            !QueryPlannerIXSelect::compatible(elt, index, pred, query.getCollator())) {
+            continue;
+        }
+
+        // The fetch below applies the whole filter, so the tightness of the bounds is moot.
+        IndexBoundsBuilder::BoundsTightness tightness;
+        if (!bounded) {
+            IndexBoundsBuilder::translate(pred, elt, index, oil, &tightness);
+            bounded = true;
+        } else {
+            IndexBoundsBuilder::translateAndIntersect(pred, elt, index, oil, &tightness);
+        }
+    }
+
+    if (!bounded) {
+        return NULL;
+    }
+
+    IndexBoundsBuilder::alignBounds(&ssn->bounds, index.keyPattern);
+
+    unique_ptr<FetchNode> fetch = make_unique<FetchNode>();
+    fetch->filter = query.root()->shallowClone();
+    fetch->children.push_back(ssn.release());
+    return fetch.release();
+}
+
 // static
 void QueryPlannerAccess::addFilterToSolutionNode(QuerySolutionNode* node,
                                                  MatchExpression* match,
@@ -1332,8 +1414,16 @@ void QueryPlannerAccess::handleFilterOr(ScanBuildingState* scanState) {
         // for affixing later.
         ++scanState->curChild;
     } else {
-        if (scanState->tightness < scanState->loosestBounds) {
-            scanState->loosestBounds = scanState->tightness;
+        // A covered predicate on a multikey path must be evaluated against the fetched
+        // document. See handleFilterAnd().
+        IndexBoundsBuilder::BoundsTightness tightness = scanState->tightness;
+        if (tightness == IndexBoundsBuilder::INEXACT_COVERED &&
+            !isPathCoveredByEveryKey(scanState->indices[scanState->currentIndexNumber],
+                                     scanState->ixtag->pos)) {
+            tightness = IndexBoundsBuilder::INEXACT_FETCH;
+        }
+        if (tightness < scanState->loosestBounds) {
+            scanState->loosestBounds = tightness;
         }
 
         // Detach 'child' and add it to 'curOr'.
@@ -1357,18 +1447,20 @@ void QueryPlannerAccess::handleFilterAnd(ScanBuildingState* scanState) {
         root->getChildVector()->erase(root->getChildVector()->begin() + scanState->curChild);
         delete child;
     } else if (scanState->tightness == IndexBoundsBuilder::INEXACT_COVERED &&
-               (INDEX_TEXT == index.type || !index.multikey)) {
+               (INDEX_TEXT == index.type ||
+                isPathCoveredByEveryKey(index, scanState->ixtag->pos))) {
         // The bounds are not exact, but the information needed to
         // evaluate the predicate is in the index key. Remove the
         // MatchExpression from its parent and attach it to the filter
         // of the index scan we're building.
         //
-        // We can only use this optimization if the index is NOT multikey.
-        // Suppose that we had the multikey index {x: 1} and a document
-        // {x: ["a", "b"]}. Now if we query for {x: /b/} the filter might
-        // ever only be applied to the index key "a". We'd incorrectly
-        // conclude that the document does not match the query :( so we
-        // gotta stick to non-multikey indices.
+        // We can only use this optimization if the predicate's path is
+        // NOT multikey. Suppose that we had the multikey index {x: 1} and
+        // a document {x: ["a", "b"]}. Now if we query for {x: /b/} the
+        // filter might ever only be applied to the index key "a". We'd
+        // incorrectly conclude that the document does not match the query
+        // :( so we gotta stick to paths the index knows are not multikey.
+        // Any key for the document then holds the path's only value.
         root->getChildVector()->erase(root->getChildVector()->begin() + scanState->curChild);
 
         addFilterToSolutionNode(scanState->currentScan.get(), child, root->matchType());
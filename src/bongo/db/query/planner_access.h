@@ -197,6 +197,18 @@ public:
                                              const QueryPlannerParams& params,
                                              int direction = 1);
 
+    /**
+     * Return a plan that answers the predicates in 'query' on the 'prefixLen'-th field of
+     * 'index' by skipping through the distinct values of the fields before it, or NULL if no
+     * top-level predicate can bound that field.
+     *
+     * The index must not be multikey.
+     */
+    static QuerySolutionNode* makeSkipScan(const IndexEntry& index,
+                                           const CanonicalQuery& query,
+                                           const QueryPlannerParams& params,
+                                           int prefixLen);
+
     /**
      * Return a plan that scans the provided index from [startKey to endKey).
      */
@@ -44,6 +44,14 @@ BONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheFeedbacksStored, int, 20);
 
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheEvictionRatio, double, 10.0);
 
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheReplanMinRuns, int, 5);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheReplanZScore, double, 3.0);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheReplanIntervalMillis, int, 0);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheBackgroundReplan, bool, false);
+
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerMaxIndexedSolutions, int, 64);
 
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryEnumerationMaxOrSolutions, int, 10);
@@ -56,16 +64,32 @@ BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableIndexIntersection, bool,
 
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableHashIntersection, bool, false);
 
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableSkipScan, bool, false);
+
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlanOrChildrenIndependently, bool, true);
 
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryMaxScansToExplode, int, 200);
 
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableCostBasedPruning, bool, false);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerCostPruningRatio, double, 10.0);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryStatisticsSampleSize, int, 1000);
+
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryExecMaxBlockingSortBytes, int, 32 * 1024 * 1024);
 
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryExecBlockingSortAllowDiskUse, bool, false);
+
 // Yield every 128 cycles or 10ms.
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldIterations, int, 128);
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldPeriodMS, int, 10);
 
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryExecBatchSize, int, 64);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryParallelCollScanMaxWorkers, int, 1);
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryParallelCollScanMinRecords, int, 100000);
+BONGO_EXPORT_SERVER_PARAMETER(internalQueryParallelAggregationMaxWorkers, int, 32);
+
 BONGO_EXPORT_SERVER_PARAMETER(internalQueryFacetBufferSizeBytes, int, 100 * 1024 * 1024);
 
 BONGO_EXPORT_SERVER_PARAMETER(internalInsertMaxBatchSize,
@@ -74,4 +98,18 @@ BONGO_EXPORT_SERVER_PARAMETER(internalInsertMaxBatchSize,
 
 BONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceCursorBatchSizeBytes, int, 4 * 1024 * 1024);
 
+BONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceGroupUseHashTable, bool, true);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupUseHashJoin, bool, true);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupHashJoinMaxMemoryBytes,
+                              int,
+                              100 * 1024 * 1024);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupBatchSize, int, 100);
+
+BONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupCacheMaxMemoryBytes,
+                              int,
+                              16 * 1024 * 1024);
+
 }  // namespace bongo
@@ -57,6 +57,10 @@ extern AtomicBool internalQueryPlannerEnableIndexIntersection;
 // Do we use hash-based intersection for rooted $and queries?
 extern AtomicBool internalQueryPlannerEnableHashIntersection;
 
+// Do we consider skip scans over indexes whose leading fields have no predicates, when no
+// other index applies?
+extern AtomicBool internalQueryPlannerEnableSkipScan;
+
 //
 // plan cache
 //
@@ -72,6 +76,21 @@ extern AtomicInt32 internalQueryCacheFeedbacksStored;
 // and replanning?
 extern AtomicDouble internalQueryCacheEvictionRatio;
 
+// How many finished trial periods must a cache entry record before a trial period which exceeds
+// its works budget may be extended rather than always causing a replan?
+extern AtomicInt32 internalQueryCacheReplanMinRuns;
+
+// How many standard deviations above the mean of the recorded trial periods may a trial period
+// which exceeds its works budget be extended to before it justifies a replan?
+extern AtomicDouble internalQueryCacheReplanZScore;
+
+// The minimum time between replans of the same query shape. 0 means no minimum.
+extern AtomicInt32 internalQueryCacheReplanIntervalMillis;
+
+// If true, a cached plan which regresses keeps running and its cache entry is evicted, so that
+// the next query of the shape replans instead of the one which detected the regression.
+extern AtomicBool internalQueryCacheBackgroundReplan;
+
 //
 // Planning and enumeration.
 //
@@ -92,18 +111,47 @@ extern AtomicBool internalQueryPlanOrChildrenIndependently;
 // during explodeForSort?
 extern AtomicInt32 internalQueryMaxScansToExplode;
 
+// Do we estimate the cost of each candidate plan from statistics on the collection, and skip the
+// trial run of candidates that are much more expensive than the cheapest one?
+extern AtomicBool internalQueryPlannerEnableCostBasedPruning;
+
+// Candidates estimated to cost more than this many times the cheapest candidate are not run.
+extern AtomicDouble internalQueryPlannerCostPruningRatio;
+
+// How many documents are sampled to gather statistics on a collection's indexes?
+extern AtomicInt32 internalQueryStatisticsSampleSize;
+
 //
 // Query execution.
 //
 
 extern AtomicInt32 internalQueryExecMaxBlockingSortBytes;
 
+// Whether a blocking sort that outgrows internalQueryExecMaxBlockingSortBytes may spill to
+// temporary files under the dbpath rather than fail.
+extern AtomicBool internalQueryExecBlockingSortAllowDiskUse;
+
 // Yield after this many "should yield?" checks.
 extern AtomicInt32 internalQueryExecYieldIterations;
 
 // Yield if it's been at least this many milliseconds since we last yielded.
 extern AtomicInt32 internalQueryExecYieldPeriodMS;
 
+// The most results that find and getMore pull from a plan at once. A value of 1 or less makes
+// them pull one result at a time.
+extern AtomicInt32 internalQueryExecBatchSize;
+
+// The most threads that a query answered by a collection scan alone may use to scan the
+// collection. A value of 1 or less keeps such scans on the query's own thread.
+extern AtomicInt32 internalQueryParallelCollScanMaxWorkers;
+
+// Collections with fewer records than this are always scanned by the query's own thread. This
+// also holds for aggregations which ask for the 'parallelism' option.
+extern AtomicInt32 internalQueryParallelCollScanMinRecords;
+
+// The most threads that an aggregation's 'parallelism' option may run its leading stages with.
+extern AtomicInt32 internalQueryParallelAggregationMaxWorkers;
+
 // Limit the size that we write without yielding to 16MB / 64 (max expected number of indexes)
 const int64_t insertVectorMaxBytes = 256 * 1024;
 
@@ -114,4 +162,24 @@ extern AtomicInt32 internalInsertMaxBatchSize;
 
 extern AtomicInt32 internalDocumentSourceCursorBatchSizeBytes;
 
+// Whether a $group whose accumulators are all $sum, $avg, $min, $max, $first, $last or $push
+// keeps its groups in a GroupHashTable rather than a map of Accumulator objects.
+extern AtomicBool internalDocumentSourceGroupUseHashTable;
+
+// Whether a $lookup may join by hashing its foreign collection once rather than querying it once
+// per input document.
+extern AtomicBool internalDocumentSourceLookupUseHashJoin;
+
+// The most memory that the hash table of a $lookup may use. Beyond it the table spills to disk if
+// allowDiskUse is set, and otherwise the $lookup goes back to querying once per input document.
+extern AtomicInt32 internalDocumentSourceLookupHashJoinMaxMemoryBytes;
+
+// The most input documents that a $lookup without a hash join matches with a single query of its
+// foreign collection. A value of 1 or less queries once per input document.
+extern AtomicInt32 internalDocumentSourceLookupBatchSize;
+
+// The most memory that a $lookup may use to cache the matches of the values it has queried its
+// foreign collection for.
+extern AtomicInt32 internalDocumentSourceLookupCacheMaxMemoryBytes;
+
 }  // namespace bongo
@@ -253,6 +253,18 @@ QuerySolution* buildWholeIXSoln(const IndexEntry& index,
     return QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
 }
 
+QuerySolution* buildSkipScanSoln(const IndexEntry& index,
+                                 const CanonicalQuery& query,
+                                 const QueryPlannerParams& params,
+                                 int prefixLen) {
+    QuerySolutionNode* solnRoot =
+        QueryPlannerAccess::makeSkipScan(index, query, params, prefixLen);
+    if (NULL == solnRoot) {
+        return NULL;
+    }
+    return QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
+}
+
 bool providesSort(const CanonicalQuery& query, const BSONObj& kp) {
     return query.getQueryRequest().getSort().isPrefixOf(kp, SimpleBSONElementComparator::kInstance);
 }
@@ -433,6 +445,16 @@ Status QueryPlanner::planFromCache(const CanonicalQuery& query,
             *out = soln;
             return Status::OK();
         }
+    } else if (SolutionCacheData::SKIP_SCAN_SOLN == winnerCacheData.solnType) {
+        // The solution skips through the leading fields of the index.
+        QuerySolution* soln = buildSkipScanSoln(
+            *winnerCacheData.tree->entry, query, params, winnerCacheData.skipScanPrefixLen);
+        if (soln == NULL) {
+            return Status(ErrorCodes::BadValue, "plan cache error: skip scan soln");
+        } else {
+            *out = soln;
+            return Status::OK();
+        }
     } else if (SolutionCacheData::COLLSCAN_SOLN == winnerCacheData.solnType) {
         // The cached solution is a collection scan. We don't cache collscans
         // with tailable==true, hence the false below.
@@ -1009,6 +1031,47 @@ Status QueryPlanner::plan(const CanonicalQuery& query,
     // No indexed plans?  We must provide a collscan if possible or else we can't run the query.
     bool collscanNeeded = (0 == out->size() && canTableScan);
 
+    // If no index applies to the query, an index whose leading fields have no predicates may
+    // still be cheaper to skip through than the collection is to scan.  The skip scans compete
+    // with the collscan (if there is one), so that a poor choice of index is not forced on us
+    // when the leading fields have many distinct values.
+    if ((params.options & QueryPlannerParams::GENERATE_SKIP_SCAN) && out->empty() &&
+        possibleToCollscan) {
+        for (size_t i = 0; i < params.indices.size(); ++i) {
+            const IndexEntry& index = params.indices[i];
+
+            // Without deduplication, each document must have exactly one key.  Documents
+            // missing from a sparse or partial index would be missing from the results.
+            if (index.type != INDEX_BTREE || index.multikey || index.sparse ||
+                index.keyPattern.nFields() < 2) {
+                continue;
+            }
+            if (index.filterExpr && !expression::isSubsetOf(query.root(), index.filterExpr)) {
+                continue;
+            }
+
+            // Skip through the fewest leading fields we can.
+            for (int prefixLen = 1; prefixLen < index.keyPattern.nFields(); ++prefixLen) {
+                QuerySolution* soln = buildSkipScanSoln(index, query, params, prefixLen);
+                if (NULL == soln) {
+                    continue;
+                }
+
+                PlanCacheIndexTree* indexTree = new PlanCacheIndexTree();
+                indexTree->setIndexEntry(index);
+                SolutionCacheData* scd = new SolutionCacheData();
+                scd->tree.reset(indexTree);
+                scd->solnType = SolutionCacheData::SKIP_SCAN_SOLN;
+                scd->skipScanPrefixLen = prefixLen;
+
+                soln->cacheData.reset(scd);
+                out->push_back(soln);
+                LOG(5) << "Planner: outputting a skip scan:" << endl << redact(soln->toString());
+                break;
+            }
+        }
+    }
+
     if (possibleToCollscan && (collscanRequested || collscanNeeded)) {
         QuerySolution* collscan = buildCollscanSoln(query, isTailable, params);
         if (NULL != collscan) {
@@ -1453,6 +1453,59 @@ TEST_F(QueryPlannerTest, CanCoverNonMultikeyDottedField) {
         "bounds: {'a.y':[[1,1,true,true]],'b.z':[[2,2,true,true]]}}}}}");
 }
 
+TEST_F(QueryPlannerTest, CanCoverFilterOnNonArrayFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{}, {0U}};
+    addIndex(BSON("a" << 1 << "b" << 1), multikeyPaths);
+    runQueryAsCommand(fromjson(
+        "{find: 'testns', filter: {a: {$mod: [2, 0]}, b: 2}, "
+        "projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {ixscan: {pattern: {a: 1, b: 1}, "
+        "filter: {a: {$mod: [2, 0]}}}}}}");
+}
+
+TEST_F(QueryPlannerTest, CannotCoverFilterOnArrayFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{}, {0U}};
+    addIndex(BSON("a" << 1 << "b" << 1), multikeyPaths);
+    runQueryAsCommand(fromjson(
+        "{find: 'testns', filter: {a: 1, b: {$mod: [2, 0]}}, "
+        "projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {fetch: {filter: {b: {$mod: [2, 0]}}, node: "
+        "{ixscan: {pattern: {a: 1, b: 1}, filter: null}}}}}}");
+}
+
+TEST_F(QueryPlannerTest, CannotCoverFilterWithoutPathLevelMultikeyInfo) {
+    addIndex(BSON("a" << 1 << "b" << 1), true);
+    runQuery(fromjson("{a: {$mod: [2, 0]}, b: 2}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{cscan: {dir: 1}}");
+    assertSolutionExists(
+        "{fetch: {filter: {a: {$mod: [2, 0]}}, node: "
+        "{ixscan: {pattern: {a: 1, b: 1}, filter: null}}}}");
+}
+
+TEST_F(QueryPlannerTest, CanCoverOrFilterOnNonArrayFieldWithPathLevelMultikeyInfo) {
+    MultikeyPaths multikeyPaths{{}, {0U}};
+    addIndex(BSON("a" << 1 << "b" << 1), multikeyPaths);
+    runQueryAsCommand(fromjson(
+        "{find: 'testns', filter: {$or: [{a: {$mod: [2, 0]}}, {a: {$mod: [3, 0]}}]}, "
+        "projection: {_id: 0, a: 1}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {cscan: {dir: 1}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, a: 1}, node: {ixscan: {pattern: {a: 1, b: 1}, "
+        "filter: {$or: [{a: {$mod: [2, 0]}}, {a: {$mod: [3, 0]}}]}}}}}");
+}
+
 TEST_F(QueryPlannerTest, ContainedOrElemMatchValue) {
     addIndex(BSON("b" << 1 << "a" << 1));
     addIndex(BSON("c" << 1 << "a" << 1));
@@ -95,6 +95,16 @@ struct QueryPlannerParams {
         // Set this if you don't want any plans with a non-covered projection stage. All projections
         // must be provided/covered by an index.
         NO_UNCOVERED_PROJECTIONS = 1 << 10,
+
+        // Set this if a plan that scans the collection may do so with several threads, when the
+        // query and the collection allow it. The documents then come back in no particular order.
+        // The caller's plan executor must be read-only and use PlanExecutor::YIELD_AUTO.
+        PARALLEL_COLLSCAN = 1 << 11,
+
+        // Set this if the planner may answer predicates on a non-leading field of an index by
+        // skipping through the distinct values of the fields before it, when no index can be
+        // used otherwise.
+        GENERATE_SKIP_SCAN = 1 << 12,
     };
 
     // See Options enum above.
@@ -5269,4 +5269,75 @@ TEST_F(QueryPlannerTest, ContainedOrPathLevelMultikeyCannotCompoundTrailingField
     assertSolutionExists("{cscan: {dir: 1}}}}");
 }
 
+//
+// Skip scans
+//
+
+TEST_F(QueryPlannerTest, SkipScanOnNonLeadingField) {
+    params.options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    addIndex(BSON("a" << 1 << "b" << 1));
+    runQuery(fromjson("{b: 5}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{cscan: {dir: 1, filter: {b: 5}}}");
+    assertSolutionExists(
+        "{fetch: {filter: {b: 5}, node: {skipScan: {pattern: {a: 1, b: 1}, prefixLen: 1, "
+        "bounds: {a: [['MinKey', 'MaxKey', true, true]], b: [[5, 5, true, true]]}}}}}");
+}
+
+TEST_F(QueryPlannerTest, SkipScanIntersectsPredicatesOnTheSameField) {
+    params.options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    addIndex(BSON("a" << 1 << "b" << 1 << "c" << 1));
+    runQuery(fromjson("{b: {$gt: 2, $lt: 4}, c: 1}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{cscan: {dir: 1}}");
+    assertSolutionExists(
+        "{fetch: {node: {skipScan: {pattern: {a: 1, b: 1, c: 1}, prefixLen: 1, "
+        "bounds: {a: [['MinKey', 'MaxKey', true, true]], b: [[2, 4, false, false]], "
+        "c: [['MinKey', 'MaxKey', true, true]]}}}}}");
+}
+
+TEST_F(QueryPlannerTest, SkipScanSkipsThroughSeveralLeadingFields) {
+    params.options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    addIndex(BSON("a" << 1 << "b" << 1 << "c" << 1));
+    runQuery(fromjson("{c: {$gte: 1, $lte: 3}}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{cscan: {dir: 1}}");
+    assertSolutionExists(
+        "{fetch: {node: {skipScan: {pattern: {a: 1, b: 1, c: 1}, prefixLen: 2, "
+        "bounds: {a: [['MinKey', 'MaxKey', true, true]], b: [['MinKey', 'MaxKey', true, true]], "
+        "c: [[1, 3, true, true]]}}}}}");
+}
+
+TEST_F(QueryPlannerTest, NoSkipScanWhenAnIndexApplies) {
+    params.options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    addIndex(BSON("a" << 1 << "b" << 1));
+    addIndex(BSON("b" << 1));
+    runQuery(fromjson("{b: 5}"));
+
+    assertNumSolutions(2U);
+    assertSolutionExists("{cscan: {dir: 1}}");
+    assertSolutionExists("{fetch: {node: {ixscan: {pattern: {b: 1}}}}}");
+}
+
+TEST_F(QueryPlannerTest, NoSkipScanOverMultikeyOrSparseIndexes) {
+    params.options |= QueryPlannerParams::GENERATE_SKIP_SCAN;
+    addIndex(BSON("a" << 1 << "b" << 1), true);
+    addIndex(BSON("c" << 1 << "b" << 1), false, true);
+    runQuery(fromjson("{b: 5}"));
+
+    assertNumSolutions(1U);
+    assertSolutionExists("{cscan: {dir: 1}}");
+}
+
+TEST_F(QueryPlannerTest, NoSkipScanUnlessRequested) {
+    addIndex(BSON("a" << 1 << "b" << 1));
+    runQuery(fromjson("{b: 5}"));
+
+    assertNumSolutions(1U);
+    assertSolutionExists("{cscan: {dir: 1}}");
+}
+
 }  // namespace
@@ -332,6 +332,36 @@ bool QueryPlannerTestLib::solutionMatches(const BSONObj& testSoln,
         }
 
         return filterMatches(filter.Obj(), collation, trueSoln);
+    } else if (STAGE_SKIP_SCAN == trueSoln->getType()) {
+        const SkipScanNode* ssn = static_cast<const SkipScanNode*>(trueSoln);
+        BSONElement el = testSoln["skipScan"];
+        if (el.eoo() || !el.isABSONObj()) {
+            return false;
+        }
+        BSONObj skipScanObj = el.Obj();
+
+        BSONElement pattern = skipScanObj["pattern"];
+        if (pattern.eoo() || !pattern.isABSONObj()) {
+            return false;
+        }
+        if (SimpleBSONObjComparator::kInstance.evaluate(pattern.Obj() != ssn->index.keyPattern)) {
+            return false;
+        }
+
+        BSONElement prefixLen = skipScanObj["prefixLen"];
+        if (!prefixLen.eoo() && prefixLen.numberInt() != ssn->prefixLen) {
+            return false;
+        }
+
+        BSONElement bounds = skipScanObj["bounds"];
+        if (!bounds.eoo()) {
+            if (!bounds.isABSONObj()) {
+                return false;
+            } else if (!boundsMatch(bounds.Obj(), ssn->bounds)) {
+                return false;
+            }
+        }
+        return true;
     } else if (STAGE_GEO_NEAR_2D == trueSoln->getType()) {
         const GeoNear2DNode* node = static_cast<const GeoNear2DNode*>(trueSoln);
         BSONElement el = testSoln["geoNear2d"];
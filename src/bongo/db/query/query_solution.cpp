@@ -224,13 +224,18 @@ CollectionScanNode::CollectionScanNode()
     : _sort(SimpleBSONObjComparator::kInstance.makeBSONObjSet()),
       tailable(false),
       direction(1),
-      maxScan(0) {}
+      maxScan(0),
+      numWorkers(1) {}
 
 void CollectionScanNode::appendToString(bongoutils::str::stream* ss, int indent) const {
     addIndent(ss, indent);
     *ss << "COLLSCAN\n";
     addIndent(ss, indent + 1);
     *ss << "ns = " << name << '\n';
+    if (numWorkers > 1) {
+        addIndent(ss, indent + 1);
+        *ss << "numWorkers = " << numWorkers << '\n';
+    }
     if (NULL != filter) {
         addIndent(ss, indent + 1);
         *ss << "filter = " << filter->toString();
@@ -247,6 +252,7 @@ QuerySolutionNode* CollectionScanNode::clone() const {
     copy->tailable = this->tailable;
     copy->direction = this->direction;
     copy->maxScan = this->maxScan;
+    copy->numWorkers = this->numWorkers;
 
     return copy;
 }
@@ -1114,6 +1120,34 @@ QuerySolutionNode* CountScanNode::clone() const {
     return copy;
 }
 
+//
+// SkipScanNode
+//
+
+void SkipScanNode::appendToString(bongoutils::str::stream* ss, int indent) const {
+    addIndent(ss, indent);
+    *ss << "SKIP_SCAN\n";
+    addIndent(ss, indent + 1);
+    *ss << "name = " << index.name << '\n';
+    addIndent(ss, indent + 1);
+    *ss << "keyPattern = " << index.keyPattern << '\n';
+    addIndent(ss, indent + 1);
+    *ss << "prefixLen = " << prefixLen << '\n';
+    addIndent(ss, indent + 1);
+    *ss << "bounds = " << bounds.toString() << '\n';
+}
+
+QuerySolutionNode* SkipScanNode::clone() const {
+    SkipScanNode* copy = new SkipScanNode(this->index);
+    cloneBaseData(copy);
+
+    copy->sorts = this->sorts;
+    copy->bounds = this->bounds;
+    copy->prefixLen = this->prefixLen;
+
+    return copy;
+}
+
 //
 // EnsureSortedNode
 //
@@ -142,6 +142,7 @@ struct QuerySolutionNode {
         if (NULL != this->filter) {
             other->filter = this->filter->shallowClone();
         }
+        other->estimatedNReturned = this->estimatedNReturned;
     }
 
     // These are owned here.
@@ -151,6 +152,10 @@ struct QuerySolutionNode {
     // filter.
     std::unique_ptr<MatchExpression> filter;
 
+    // The number of results this node is expected to produce, as estimated by PlanCostEstimator
+    // from statistics on the collection, or a negative value if no estimate was made.
+    double estimatedNReturned = -1;
+
 protected:
     /**
      * Formatting helper used by toString().
@@ -293,6 +298,10 @@ struct CollectionScanNode : public QuerySolutionNode {
 
     // maxScan option to .find() limits how many docs we look at.
     int maxScan;
+
+    // How many threads may scan the collection. If more than one, the scan is a
+    // PARALLEL_COLLSCAN, which returns documents in no particular order.
+    size_t numWorkers;
 };
 
 struct AndHashNode : public QuerySolutionNode {
@@ -940,6 +949,47 @@ struct CountScanNode : public QuerySolutionNode {
     bool endKeyInclusive;
 };
 
+/**
+ * Answers predicates on a non-leading field of an index by skipping through the distinct values
+ * of the fields before it.  See SkipScan.
+ */
+struct SkipScanNode : public QuerySolutionNode {
+    SkipScanNode(IndexEntry index)
+        : sorts(SimpleBSONObjComparator::kInstance.makeBSONObjSet()), index(std::move(index)) {}
+
+    virtual ~SkipScanNode() {}
+
+    virtual StageType getType() const {
+        return STAGE_SKIP_SCAN;
+    }
+    virtual void appendToString(bongoutils::str::stream* ss, int indent) const;
+
+    bool fetched() const {
+        return false;
+    }
+    bool hasField(const std::string& field) const {
+        return !index.keyPattern[field].eoo();
+    }
+    bool sortedByDiskLoc() const {
+        return false;
+    }
+    const BSONObjSet& getSort() const {
+        return sorts;
+    }
+
+    QuerySolutionNode* clone() const;
+
+    // Results come back sorted by the whole key pattern, but the plan is only chosen when no
+    // other index applies, so we do not provide any sort.
+    BSONObjSet sorts;
+
+    IndexEntry index;
+    IndexBounds bounds;
+    // The predicates are on the 'prefixLen'-th field of 'index.keyPattern'; the fields before it
+    // are unconstrained.
+    int prefixLen = 0;
+};
+
 /**
  * This stage drops results that are out of sorted order.
  */
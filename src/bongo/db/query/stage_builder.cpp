@@ -48,14 +48,17 @@
 #include "bongo/db/exec/limit.h"
 #include "bongo/db/exec/merge_sort.h"
 #include "bongo/db/exec/or.h"
+#include "bongo/db/exec/parallel_collection_scan.h"
 #include "bongo/db/exec/projection.h"
 #include "bongo/db/exec/shard_filter.h"
 #include "bongo/db/exec/skip.h"
+#include "bongo/db/exec/skip_scan.h"
 #include "bongo/db/exec/sort.h"
 #include "bongo/db/exec/sort_key_generator.h"
 #include "bongo/db/exec/text.h"
 #include "bongo/db/index/fts_access_method.h"
 #include "bongo/db/matcher/extensions_callback_real.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/s/collection_sharding_state.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/util/log.h"
@@ -70,9 +73,28 @@ PlanStage* buildStages(OperationContext* txn,
                        const CanonicalQuery& cq,
                        const QuerySolution& qsol,
                        const QuerySolutionNode* root,
-                       WorkingSet* ws) {
+                       WorkingSet* ws);
+
+namespace {
+
+PlanStage* buildStagesForNode(OperationContext* txn,
+                              Collection* collection,
+                              const CanonicalQuery& cq,
+                              const QuerySolution& qsol,
+                              const QuerySolutionNode* root,
+                              WorkingSet* ws) {
     if (STAGE_COLLSCAN == root->getType()) {
         const CollectionScanNode* csn = static_cast<const CollectionScanNode*>(root);
+        if (csn->numWorkers > 1) {
+            // Several threads are only planned for a scan that is filtered by the whole query.
+            return new ParallelCollectionScan(txn,
+                                              collection,
+                                              csn->numWorkers,
+                                              ws,
+                                              cq.getQueryRequest().getFilter(),
+                                              cq.getCollator());
+        }
+
         CollectionScanParams params;
         params.collection = collection;
         params.tailable = csn->tailable;
@@ -115,6 +137,7 @@ PlanStage* buildStages(OperationContext* txn,
         params.collection = collection;
         params.pattern = sn->pattern;
         params.limit = sn->limit;
+        params.allowDiskUse = internalQueryExecBlockingSortAllowDiskUse.load();
         return new SortStage(txn, params, ws, childStage);
     } else if (STAGE_SORT_KEY_GENERATOR == root->getType()) {
         const SortKeyGeneratorNode* keyGenNode = static_cast<const SortKeyGeneratorNode*>(root);
@@ -295,6 +318,21 @@ PlanStage* buildStages(OperationContext* txn,
         params.bounds = dn->bounds;
         params.fieldNo = dn->fieldNo;
         return new DistinctScan(txn, params, ws);
+    } else if (STAGE_SKIP_SCAN == root->getType()) {
+        const SkipScanNode* ssn = static_cast<const SkipScanNode*>(root);
+
+        if (NULL == collection) {
+            warning() << "Can't skip-scan null namespace";
+            return NULL;
+        }
+
+        SkipScanParams params;
+
+        params.descriptor = collection->getIndexCatalog()->findIndexByName(txn, ssn->index.name);
+        invariant(params.descriptor);
+        params.bounds = ssn->bounds;
+        params.prefixLen = ssn->prefixLen;
+        return new SkipScan(txn, params, ws);
     } else if (STAGE_COUNT_SCAN == root->getType()) {
         const CountScanNode* csn = static_cast<const CountScanNode*>(root);
 
@@ -329,6 +367,21 @@ PlanStage* buildStages(OperationContext* txn,
     }
 }
 
+}  // namespace
+
+PlanStage* buildStages(OperationContext* txn,
+                       Collection* collection,
+                       const CanonicalQuery& cq,
+                       const QuerySolution& qsol,
+                       const QuerySolutionNode* root,
+                       WorkingSet* ws) {
+    PlanStage* stage = buildStagesForNode(txn, collection, cq, qsol, root, ws);
+    if (stage && root->estimatedNReturned >= 0) {
+        stage->setEstimatedNReturned(root->estimatedNReturned);
+    }
+    return stage;
+}
+
 // static (this one is used for Cached and MultiPlanStage)
 bool StageBuilder::build(OperationContext* txn,
                          Collection* collection,
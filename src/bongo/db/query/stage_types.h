@@ -87,6 +87,10 @@ enum StageType {
     STAGE_MULTI_PLAN,
     STAGE_OPLOG_START,
     STAGE_OR,
+
+    // A collection scan whose ranges are read and filtered by several threads.
+    STAGE_PARALLEL_COLLSCAN,
+
     STAGE_PROJECTION,
 
     // Stage for running aggregation pipelines.
@@ -95,6 +99,11 @@ enum StageType {
     STAGE_QUEUED_DATA,
     STAGE_SHARDING_FILTER,
     STAGE_SKIP,
+
+    // An index scan which seeks through the distinct values of the index's leading fields to
+    // apply bounds on the fields that follow.
+    STAGE_SKIP_SCAN,
+
     STAGE_SORT,
     STAGE_SORT_KEY_GENERATOR,
     STAGE_SORT_MERGE,
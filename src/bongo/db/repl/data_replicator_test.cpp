@@ -56,6 +56,7 @@
 #include "bongo/unittest/task_executor_proxy.h"
 #include "bongo/util/concurrency/old_thread_pool.h"
 #include "bongo/util/concurrency/thread_name.h"
+#include "bongo/util/concurrency/thread_pool.h"
 #include "bongo/util/fail_point_service.h"
 #include "bongo/util/bongoutils/str.h"
 #include "bongo/util/scopeguard.h"
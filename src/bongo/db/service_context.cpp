@@ -35,6 +35,7 @@
 #include "bongo/db/operation_context.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/transport/service_entry_point.h"
+#include "bongo/transport/service_executor.h"
 #include "bongo/transport/session.h"
 #include "bongo/transport/transport_layer.h"
 #include "bongo/transport/transport_layer_manager.h"
@@ -163,6 +164,10 @@ ServiceEntryPoint* ServiceContext::getServiceEntryPoint() const {
     return _serviceEntryPoint.get();
 }
 
+transport::ServiceExecutor* ServiceContext::getServiceExecutor() const {
+    return _serviceExecutor.get();
+}
+
 Status ServiceContext::addAndStartTransportLayer(std::unique_ptr<transport::TransportLayer> tl) {
     return _transportLayerManager->addAndStartTransportLayer(std::move(tl));
 }
@@ -195,6 +200,10 @@ void ServiceContext::setServiceEntryPoint(std::unique_ptr<ServiceEntryPoint> sep
     _serviceEntryPoint = std::move(sep);
 }
 
+void ServiceContext::setServiceExecutor(std::unique_ptr<transport::ServiceExecutor> exec) {
+    _serviceExecutor = std::move(exec);
+}
+
 void ServiceContext::ClientDeleter::operator()(Client* client) const {
     ServiceContext* const service = client->getServiceContext();
     {
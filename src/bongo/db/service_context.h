@@ -51,6 +51,7 @@ class OpObserver;
 class ServiceEntryPoint;
 
 namespace transport {
+class ServiceExecutor;
 class TransportLayer;
 class TransportLayerManager;
 }  // namespace transport
@@ -325,6 +326,14 @@ public:
      */
     ServiceEntryPoint* getServiceEntryPoint() const;
 
+    /**
+     * Get the service executor for the service context, or nullptr if requests are processed on
+     * a dedicated thread per connection.
+     *
+     * See ServiceExecutor for more details.
+     */
+    transport::ServiceExecutor* getServiceExecutor() const;
+
     /**
      * Add a new TransportLayer to this service context. The new TransportLayer will
      * be added to the TransportLayerManager accessible via getTransportLayer().
@@ -386,6 +395,12 @@ public:
      */
     void setServiceEntryPoint(std::unique_ptr<ServiceEntryPoint> sep);
 
+    /**
+     * Binds the service executor to the service context. Must be called before the transport
+     * layer starts accepting sessions.
+     */
+    void setServiceExecutor(std::unique_ptr<transport::ServiceExecutor> exec);
+
 protected:
     ServiceContext();
 
@@ -419,6 +434,11 @@ private:
      */
     std::unique_ptr<ServiceEntryPoint> _serviceEntryPoint;
 
+    /**
+     * The service executor, if any
+     */
+    std::unique_ptr<transport::ServiceExecutor> _serviceExecutor;
+
     /**
      * Vector of registered observers.
      */
@@ -37,6 +37,7 @@
 #include "bongo/db/assemble_response.h"
 #include "bongo/db/client.h"
 #include "bongo/db/dbmessage.h"
+#include "bongo/db/service_context.h"
 #include "bongo/stdx/thread.h"
 #include "bongo/transport/service_entry_point_utils.h"
 #include "bongo/transport/session.h"
@@ -93,6 +94,19 @@ using transport::TransportLayer;
 ServiceEntryPointBongod::ServiceEntryPointBongod(TransportLayer* tl) : _tl(tl) {}
 
 void ServiceEntryPointBongod::startSession(transport::SessionHandle session) {
+    if (auto executor = getGlobalServiceContext()->getServiceExecutor()) {
+        launchServiceEntryStateMachine(
+            std::move(session),
+            executor,
+            [this](const transport::SessionHandle& session, Message* inMessage) {
+                _nWorkers.fetchAndAdd(1);
+                auto guard = MakeGuard([&] { _nWorkers.fetchAndSubtract(1); });
+
+                _processMessage(session, inMessage);
+            });
+        return;
+    }
+
     // Pass ownership of the transport::SessionHandle into our worker thread. When this
     // thread exits, the session will end.
     launchWrappedServiceEntryWorkerThread(
@@ -106,59 +120,65 @@ void ServiceEntryPointBongod::startSession(transport::SessionHandle session) {
 
 void ServiceEntryPointBongod::_sessionLoop(const transport::SessionHandle& session) {
     Message inMessage;
-    bool inExhaust = false;
     int64_t counter = 0;
 
     while (true) {
-        // 1. Source a Message from the client (unless we are exhausting)
-        if (!inExhaust) {
-            inMessage.reset();
-            auto status = session->sourceMessage(&inMessage).wait();
+        // 1. Source a Message from the client
+        inMessage.reset();
+        auto status = session->sourceMessage(&inMessage).wait();
 
-            if (ErrorCodes::isInterruption(status.code()) ||
-                ErrorCodes::isNetworkError(status.code())) {
-                break;
-            }
+        if (ErrorCodes::isInterruption(status.code()) ||
+            ErrorCodes::isNetworkError(status.code())) {
+            break;
+        }
 
-            // Our session may have been closed internally.
-            if (status == TransportLayer::TicketSessionClosedStatus) {
-                break;
-            }
+        // Our session may have been closed internally.
+        if (status == TransportLayer::TicketSessionClosedStatus) {
+            break;
+        }
 
-            uassertStatusOK(status);
+        uassertStatusOK(status);
+
+        // 2. Run it and reply
+        _processMessage(session, &inMessage);
+
+        if ((counter++ & 0xf) == 0) {
+            markThreadIdle();
         }
+    }
+}
 
-        // 2. Pass sourced Message up to bongod
+void ServiceEntryPointBongod::_processMessage(const transport::SessionHandle& session,
+                                              Message* inMessage) {
+    while (true) {
+        // 1. Pass the Message up to bongod
         DbResponse dbresponse;
         {
             auto opCtx = cc().makeOperationContext();
-            assembleResponse(opCtx.get(), inMessage, dbresponse, session->remote());
+            assembleResponse(opCtx.get(), *inMessage, dbresponse, session->remote());
 
             // opCtx must go out of scope here so that the operation cannot show
             // up in currentOp results after the response reaches the client
         }
 
-        // 3. Format our response, if we have one
+        // 2. Format our response, if we have one
         Message& toSink = dbresponse.response;
-        if (!toSink.empty()) {
-            toSink.header().setId(nextMessageId());
-            toSink.header().setResponseToMsgId(inMessage.header().getId());
-
-            // If this is an exhaust cursor, don't source more Messages
-            if (dbresponse.exhaustNS.size() > 0 && setExhaustMessage(&inMessage, dbresponse)) {
-                inExhaust = true;
-            } else {
-                inExhaust = false;
-            }
-
-            // 4. Sink our response to the client
-            uassertStatusOK(session->sinkMessage(toSink).wait());
-        } else {
-            inExhaust = false;
+        if (toSink.empty()) {
+            return;
         }
 
-        if ((counter++ & 0xf) == 0) {
-            markThreadIdle();
+        toSink.header().setId(nextMessageId());
+        toSink.header().setResponseToMsgId(inMessage->header().getId());
+
+        // If this is an exhaust cursor, keep running getMores without sourcing more Messages
+        const bool inExhaust =
+            dbresponse.exhaustNS.size() > 0 && setExhaustMessage(inMessage, dbresponse);
+
+        // 3. Sink our response to the client
+        uassertStatusOK(session->sinkMessage(toSink).wait());
+
+        if (!inExhaust) {
+            return;
         }
     }
 }
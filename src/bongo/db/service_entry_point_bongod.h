@@ -36,6 +36,8 @@
 
 namespace bongo {
 
+class Message;
+
 namespace transport {
 class Session;
 class TransportLayer;
@@ -43,7 +45,8 @@ class TransportLayer;
 
 /**
  * The entry point from the TransportLayer into Bongod. startSession() spawns and
- * detaches a new thread for each incoming connection (transport::Session).
+ * detaches a new thread for each incoming connection (transport::Session), unless the
+ * ServiceContext has a ServiceExecutor, in which case requests are run on its threads.
  */
 class ServiceEntryPointBongod final : public ServiceEntryPoint {
     BONGO_DISALLOW_COPYING(ServiceEntryPointBongod);
@@ -62,6 +65,12 @@ public:
 private:
     void _sessionLoop(const transport::SessionHandle& session);
 
+    /**
+     * Runs 'inMessage' and sinks the reply, if any. Exhaust cursors are iterated to completion
+     * before returning.
+     */
+    void _processMessage(const transport::SessionHandle& session, Message* inMessage);
+
     transport::TransportLayer* _tl;
     AtomicWord<std::size_t> _nWorkers;
 };
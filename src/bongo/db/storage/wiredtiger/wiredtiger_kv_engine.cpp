@@ -37,6 +37,7 @@
 #define NVALGRIND
 #endif
 
+#include <algorithm>
 #include <memory>
 
 #include "bongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
@@ -130,12 +131,24 @@ private:
 
 namespace {
 
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(wiredTigerAdaptiveConcurrentTransactions, bool, false);
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(wiredTigerAdaptiveConcurrentTransactionsMin, int, 16);
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(wiredTigerAdaptiveConcurrentTransactionsMax, int, 256);
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(wiredTigerLowPriorityTransactionMaxDelayMillis, int, 100);
+
+// How often the adaptive ticket sizers sample the ticket holders and the cache.
+const Milliseconds kTicketAdjustmentInterval(500);
+
 class TicketServerParameter : public ServerParameter {
     BONGO_DISALLOW_COPYING(TicketServerParameter);
 
 public:
-    TicketServerParameter(TicketHolder* holder, const std::string& name)
-        : ServerParameter(ServerParameterSet::getGlobal(), name, true, true), _holder(holder) {}
+    TicketServerParameter(TicketHolder* holder,
+                          const std::unique_ptr<AdaptiveTicketSizer>* sizer,
+                          const std::string& name)
+        : ServerParameter(ServerParameterSet::getGlobal(), name, true, true),
+          _holder(holder),
+          _sizer(sizer) {}
 
     virtual void append(OperationContext* txn, BSONObjBuilder& b, const std::string& name) {
         b.append(name, _holder->outof());
@@ -160,19 +173,30 @@ public:
             return Status(ErrorCodes::BadValue, str::stream() << name() << " has to be > 0");
         }
 
+        // Go through the adaptive sizer, if any, so as not to race with its adjustments.
+        if (*_sizer) {
+            return (*_sizer)->resize(newNum);
+        }
         return _holder->resize(newNum);
     }
 
 private:
     TicketHolder* _holder;
+    const std::unique_ptr<AdaptiveTicketSizer>* _sizer;
 };
 
+// Set when wiredTigerAdaptiveConcurrentTransactions is on; lives as long as the ticket holders.
+std::unique_ptr<AdaptiveTicketSizer> openWriteTransactionSizer;
+std::unique_ptr<AdaptiveTicketSizer> openReadTransactionSizer;
+
 TicketHolder openWriteTransaction(128);
 TicketServerParameter openWriteTransactionParam(&openWriteTransaction,
+                                                &openWriteTransactionSizer,
                                                 "wiredTigerConcurrentWriteTransactions");
 
 TicketHolder openReadTransaction(128);
 TicketServerParameter openReadTransactionParam(&openReadTransaction,
+                                               &openReadTransactionSizer,
                                                "wiredTigerConcurrentReadTransactions");
 
 stdx::function<bool(StringData)> initRsOplogBackgroundThreadCallback = [](StringData) -> bool {
@@ -180,6 +204,81 @@ stdx::function<bool(StringData)> initRsOplogBackgroundThreadCallback = [](String
 };
 }  // namespace
 
+/**
+ * Drives the adaptive ticket sizers, feeding them how close the cache is to making application
+ * threads evict.
+ */
+class WiredTigerKVEngine::WiredTigerTicketAdjuster : public BackgroundJob {
+public:
+    explicit WiredTigerTicketAdjuster(WiredTigerSessionCache* sessionCache)
+        : BackgroundJob(false /* deleteSelf */), _sessionCache(sessionCache) {}
+
+    virtual string name() const {
+        return "WTTicketAdjuster";
+    }
+
+    virtual void run() {
+        Client::initThread(name().c_str());
+
+        LOG(1) << "starting " << name() << " thread";
+
+        Date_t lastAdjustment = Date_t::now();
+        while (!_shuttingDown.load()) {
+            sleepFor(kTicketAdjustmentInterval);
+
+            const double pressure = _getCachePressure();
+            const Date_t now = Date_t::now();
+            openWriteTransactionSizer->adjust(now - lastAdjustment, pressure);
+            openReadTransactionSizer->adjust(now - lastAdjustment, pressure);
+            lastAdjustment = now;
+        }
+        LOG(1) << "stopping " << name() << " thread";
+    }
+
+    void shutdown() {
+        _shuttingDown.store(true);
+        wait();
+    }
+
+private:
+    /**
+     * Returns how close the cache is to its eviction triggers, beyond which application threads
+     * are made to evict pages themselves: 1.0 means a trigger has been reached, or that
+     * application threads have evicted since the last call.
+     */
+    double _getCachePressure() {
+        UniqueWiredTigerSession session = _sessionCache->getSession();
+        const auto getStat = [&session](int key) {
+            auto result = WiredTigerUtil::getStatisticsValueAs<long long>(
+                session->getSession(), "statistics:", "statistics=(fast)", key);
+            return result.isOK() ? result.getValue() : 0;
+        };
+
+        const long long maxBytes = getStat(WT_STAT_CONN_CACHE_BYTES_MAX);
+        const long long appEvictions = getStat(WT_STAT_CONN_CACHE_EVICTION_APP);
+        const bool appEvicted = appEvictions > _lastAppEvictions;
+        _lastAppEvictions = appEvictions;
+        if (maxBytes <= 0) {
+            return appEvicted ? 1.0 : 0.0;
+        }
+
+        // These are WiredTiger's default eviction_trigger and eviction_dirty_trigger.
+        const double evictionTrigger = 0.95;
+        const double dirtyEvictionTrigger = 0.20;
+        double pressure =
+            std::max(getStat(WT_STAT_CONN_CACHE_BYTES_INUSE) / (maxBytes * evictionTrigger),
+                     getStat(WT_STAT_CONN_CACHE_BYTES_DIRTY) / (maxBytes * dirtyEvictionTrigger));
+        if (appEvicted) {
+            pressure = std::max(pressure, 1.0);
+        }
+        return pressure;
+    }
+
+    WiredTigerSessionCache* _sessionCache;
+    AtomicBool _shuttingDown{false};
+    long long _lastAppEvictions = 0;
+};
+
 WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
                                        const std::string& path,
                                        ClockSource* cs,
@@ -288,6 +387,33 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
     _sizeStorer->fillCache();
 
     Locker::setGlobalThrottling(&openReadTransaction, &openWriteTransaction);
+
+    if (wiredTigerAdaptiveConcurrentTransactions && !openReadTransactionSizer) {
+        AdaptiveTicketSizer::Options options;
+        options.minTickets = wiredTigerAdaptiveConcurrentTransactionsMin;
+        options.maxTickets = wiredTigerAdaptiveConcurrentTransactionsMax;
+        uassert(40395,
+                str::stream() << "wiredTigerAdaptiveConcurrentTransactionsMin must be at least 5 "
+                                 "and at most wiredTigerAdaptiveConcurrentTransactionsMax; got "
+                              << options.minTickets
+                              << " and "
+                              << options.maxTickets,
+                options.minTickets >= 5 && options.minTickets <= options.maxTickets);
+        log() << "Adapting the number of concurrent transactions between " << options.minTickets
+              << " and " << options.maxTickets;
+
+        const Milliseconds lowPriorityMaxDelay(wiredTigerLowPriorityTransactionMaxDelayMillis);
+        openWriteTransaction.setLowPriorityMaxDelay(lowPriorityMaxDelay);
+        openReadTransaction.setLowPriorityMaxDelay(lowPriorityMaxDelay);
+        openWriteTransactionSizer =
+            stdx::make_unique<AdaptiveTicketSizer>(&openWriteTransaction, options);
+        openReadTransactionSizer =
+            stdx::make_unique<AdaptiveTicketSizer>(&openReadTransaction, options);
+    }
+    if (openReadTransactionSizer) {
+        _ticketAdjuster = stdx::make_unique<WiredTigerTicketAdjuster>(_sessionCache.get());
+        _ticketAdjuster->go();
+    }
 }
 
 
@@ -306,6 +432,10 @@ void WiredTigerKVEngine::appendGlobalStats(BSONObjBuilder& b) {
         bbb.append("out", openWriteTransaction.used());
         bbb.append("available", openWriteTransaction.available());
         bbb.append("totalTickets", openWriteTransaction.outof());
+        if (openWriteTransactionSizer) {
+            BSONObjBuilder adaptive(bbb.subobjStart("adaptive"));
+            openWriteTransactionSizer->appendStats(&adaptive);
+        }
         bbb.done();
     }
     {
@@ -313,6 +443,10 @@ void WiredTigerKVEngine::appendGlobalStats(BSONObjBuilder& b) {
         bbb.append("out", openReadTransaction.used());
         bbb.append("available", openReadTransaction.available());
         bbb.append("totalTickets", openReadTransaction.outof());
+        if (openReadTransactionSizer) {
+            BSONObjBuilder adaptive(bbb.subobjStart("adaptive"));
+            openReadTransactionSizer->appendStats(&adaptive);
+        }
         bbb.done();
     }
     bb.done();
@@ -326,6 +460,8 @@ void WiredTigerKVEngine::cleanShutdown() {
         // these must be the last things we do before _conn->close();
         if (_journalFlusher)
             _journalFlusher->shutdown();
+        if (_ticketAdjuster)
+            _ticketAdjuster->shutdown();
         _sizeStorer.reset();
         _sessionCache->shuttingDown();
 
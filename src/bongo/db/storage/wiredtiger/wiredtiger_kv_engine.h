@@ -162,6 +162,7 @@ public:
 
 private:
     class WiredTigerJournalFlusher;
+    class WiredTigerTicketAdjuster;
 
     Status _salvageIfNeeded(const char* uri);
     void _checkIdentPath(StringData ident);
@@ -185,6 +186,7 @@ private:
     bool _ephemeral;
     bool _readOnly;
     std::unique_ptr<WiredTigerJournalFlusher> _journalFlusher;  // Depends on _sizeStorer
+    std::unique_ptr<WiredTigerTicketAdjuster> _ticketAdjuster;  // Depends on _sessionCache
 
     std::string _rsOptions;
     std::string _indexOptions;
@@ -0,0 +1,329 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file tests db/pipeline/document_source_parallel_aggregation.cpp.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/db/client.h"
+#include "bongo/db/db_raii.h"
+#include "bongo/db/dbdirectclient.h"
+#include "bongo/db/json.h"
+#include "bongo/db/namespace_string.h"
+#include "bongo/db/pipeline/aggregation_request.h"
+#include "bongo/db/pipeline/document_source.h"
+#include "bongo/db/pipeline/expression_context_for_test.h"
+#include "bongo/db/pipeline/pipeline.h"
+#include "bongo/db/pipeline/pipeline_d.h"
+#include "bongo/db/query/query_knobs.h"
+#include "bongo/db/service_context.h"
+#include "bongo/db/storage/storage_engine.h"
+#include "bongo/db/storage/storage_options.h"
+#include "bongo/dbtests/dbtests.h"
+#include "bongo/util/timer.h"
+
+namespace ParallelAggregationTests {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+static const NamespaceString nss{"unittests.ParallelAggregationTests"};
+
+/**
+ * Lets aggregations of any collection ask for parallelism for the lifetime of the object.
+ */
+class ParallelAggregationKnobs {
+public:
+    ParallelAggregationKnobs()
+        : _oldMaxWorkers(internalQueryParallelAggregationMaxWorkers.load()),
+          _oldMinRecords(internalQueryParallelCollScanMinRecords.load()) {
+        internalQueryParallelAggregationMaxWorkers.store(32);
+        internalQueryParallelCollScanMinRecords.store(0);
+    }
+
+    ~ParallelAggregationKnobs() {
+        internalQueryParallelAggregationMaxWorkers.store(_oldMaxWorkers);
+        internalQueryParallelCollScanMinRecords.store(_oldMinRecords);
+    }
+
+private:
+    const int _oldMaxWorkers;
+    const int _oldMinRecords;
+};
+
+class ParallelAggregationBase {
+public:
+    ParallelAggregationBase() : _client(&_txn) {
+        insertDocuments(0, numObj());
+    }
+
+    virtual ~ParallelAggregationBase() {
+        OldClientWriteContext ctx(&_txn, nss.ns());
+        _client.dropCollection(nss.ns());
+    }
+
+    static int numObj() {
+        return 5000;
+    }
+
+    /**
+     * Inserts the documents numbered from 'begin' up to 'end'.
+     */
+    void insertDocuments(int begin, int end) {
+        OldClientWriteContext ctx(&_txn, nss.ns());
+        for (int i = begin; i < end; ++i) {
+            _client.insert(nss.ns(),
+                           BSON("_id" << i << "a" << (i % 7) << "b" << i << "c"
+                                      << "the quick brown fox jumps over the lazy dog"));
+        }
+    }
+
+    /**
+     * The threads read the collection outside the aggregation's snapshot, which needs
+     * document-level locking.
+     */
+    bool canRunInParallel() {
+        return _txn.getServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
+    }
+
+    /**
+     * Runs 'pipeline' as an aggregate with the 'parallelism' option and 'hint', if any, and returns
+     * its results. Sets 'ranInParallel' to whether its leading stages were run in parallel.
+     */
+    vector<BSONObj> aggregate(const vector<BSONObj>& pipeline,
+                              long long parallelism,
+                              bool* ranInParallel,
+                              const BSONObj& hint = BSONObj()) {
+        AggregationRequest request(nss, pipeline);
+        request.setParallelism(parallelism);
+        request.setHint(hint);
+        intrusive_ptr<ExpressionContextForTest> expCtx =
+            new ExpressionContextForTest(&_txn, request);
+        expCtx->tempDir = storageGlobalParams.dbpath + "/_tmp";
+
+        auto parsed = unittest::assertGet(Pipeline::parse(pipeline, expCtx));
+        parsed->optimizePipeline();
+        {
+            AutoGetCollectionForRead ctx(&_txn, nss);
+            PipelineD::prepareCursorSource(ctx.getCollection(), &request, parsed);
+        }
+        *ranInParallel = StringData(parsed->getSources().front()->getSourceName()) ==
+            "$parallelAggregation"_sd;
+
+        vector<BSONObj> results;
+        while (auto next = parsed->getNext()) {
+            results.push_back(next->toBson());
+        }
+        return results;
+    }
+
+    static vector<BSONObj> pipelineFromJson(const vector<std::string>& stages) {
+        vector<BSONObj> pipeline;
+        for (auto&& stage : stages) {
+            pipeline.push_back(fromjson(stage));
+        }
+        return pipeline;
+    }
+
+protected:
+    const ServiceContext::UniqueOperationContext _txnPtr = cc().makeOperationContext();
+    OperationContext& _txn = *_txnPtr;
+
+    DBDirectClient _client;
+};
+
+// The partial groups of every range merge into the groups an aggregation run by a single thread
+// outputs.
+class ParallelAggregationMatchesSerial : public ParallelAggregationBase {
+public:
+    void run() {
+        if (!canRunInParallel()) {
+            return;
+        }
+        ParallelAggregationKnobs knobs;
+
+        const std::string group =
+            "{$group: {_id: '$a', n: {$sum: 1}, total: {$sum: '$b'}, avg: {$avg: '$b'}, "
+            "min: {$min: '$b'}, max: {$max: '$b'}}}";
+        const vector<vector<std::string>> pipelines = {
+            {group, "{$sort: {_id: 1}}"},
+            {"{$match: {b: {$gte: 100}}}", "{$project: {a: 1, b: 1}}", group, "{$sort: {_id: 1}}"},
+            {"{$addFields: {a: {$mod: ['$b', 3]}}}", group, "{$sort: {_id: 1}}"},
+            {"{$group: {_id: null, n: {$sum: 1}}}"},
+            {"{$match: {b: {$lt: 0}}}", group},
+        };
+
+        for (auto&& stages : pipelines) {
+            const vector<BSONObj> pipeline = pipelineFromJson(stages);
+
+            bool ranInParallel = true;
+            const vector<BSONObj> expected = aggregate(pipeline, 1, &ranInParallel);
+            ASSERT_FALSE(ranInParallel);
+
+            for (long long parallelism : {2, 4, 7}) {
+                const vector<BSONObj> results = aggregate(pipeline, parallelism, &ranInParallel);
+                ASSERT_TRUE(ranInParallel);
+                ASSERT_EQUALS(expected.size(), results.size());
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ASSERT_BSONOBJ_EQ(expected[i], results[i]);
+                }
+            }
+        }
+    }
+};
+
+// Pipelines whose leading stages need more than the documents of a range or could use an index,
+// and collections too small to split, are run by the aggregation's own thread.
+class ParallelAggregationNotUsed : public ParallelAggregationBase {
+public:
+    void run() {
+        if (!canRunInParallel()) {
+            return;
+        }
+
+        bool ranInParallel = true;
+        const vector<vector<std::string>> pipelines = {
+            {"{$sort: {b: 1}}", "{$group: {_id: '$a', first: {$first: '$b'}}}"},
+            {"{$limit: 10}", "{$group: {_id: '$a', n: {$sum: 1}}}"},
+            {"{$match: {b: {$gte: 100}}}", "{$project: {a: 1, b: 1}}"},
+            {"{$match: {_id: {$gte: 100}}}", "{$group: {_id: '$a', n: {$sum: 1}}}"},
+        };
+        {
+            ParallelAggregationKnobs knobs;
+            for (auto&& stages : pipelines) {
+                aggregate(pipelineFromJson(stages), 4, &ranInParallel);
+                ASSERT_FALSE(ranInParallel);
+            }
+        }
+
+        const vector<BSONObj> pipeline = pipelineFromJson({"{$group: {_id: '$a'}}"});
+        {
+            ParallelAggregationKnobs knobs;
+            aggregate(pipeline, 4, &ranInParallel, BSON("_id" << 1));
+            ASSERT_FALSE(ranInParallel);
+        }
+        {
+            ParallelAggregationKnobs knobs;
+            internalQueryParallelCollScanMinRecords.store(numObj() + 1);
+            aggregate(pipeline, 4, &ranInParallel);
+            ASSERT_FALSE(ranInParallel);
+        }
+        {
+            ParallelAggregationKnobs knobs;
+            internalQueryParallelAggregationMaxWorkers.store(1);
+            aggregate(pipeline, 4, &ranInParallel);
+            ASSERT_FALSE(ranInParallel);
+        }
+    }
+};
+
+// The ranges still cover the whole collection when the records their boundaries were chosen at have
+// been removed by the time they are run.
+class ParallelAggregationRemoveBoundaries : public ParallelAggregationBase {
+public:
+    void run() {
+        if (!canRunInParallel()) {
+            return;
+        }
+        ParallelAggregationKnobs knobs;
+
+        AggregationRequest request(nss, pipelineFromJson({"{$group: {_id: null, n: {$sum: 1}}}"}));
+        request.setParallelism(4);
+        intrusive_ptr<ExpressionContextForTest> expCtx =
+            new ExpressionContextForTest(&_txn, request);
+        auto pipeline = unittest::assertGet(Pipeline::parse(request.getPipeline(), expCtx));
+        pipeline->optimizePipeline();
+        {
+            AutoGetCollectionForRead ctx(&_txn, nss);
+            PipelineD::prepareCursorSource(ctx.getCollection(), &request, pipeline);
+        }
+
+        // The ranges are not run until the first result is asked for. Removing every other
+        // document removes about half of their boundaries.
+        {
+            OldClientWriteContext ctx(&_txn, nss.ns());
+            _client.remove(nss.ns(), BSON("_id" << BSON("$mod" << BSON_ARRAY(2 << 0))));
+        }
+
+        auto result = pipeline->getNext();
+        ASSERT_TRUE(result);
+        ASSERT_EQUALS(numObj() / 2, (*result)["n"].getInt());
+        ASSERT_FALSE(pipeline->getNext());
+    }
+};
+
+// Reports how the throughput of a $group over a larger collection scales with the number of
+// ranges.
+class ParallelAggregationThroughput : public ParallelAggregationBase {
+public:
+    void run() {
+        if (!canRunInParallel()) {
+            return;
+        }
+        ParallelAggregationKnobs knobs;
+
+        const int numDocs = 200000;
+        insertDocuments(numObj(), numDocs);
+        const vector<BSONObj> pipeline = pipelineFromJson(
+            {"{$match: {a: {$lt: 6}}}",
+             "{$group: {_id: {$mod: ['$b', 1000]}, n: {$sum: 1}, avg: {$avg: '$b'}, "
+             "max: {$max: '$b'}}}"});
+
+        for (long long parallelism : {1, 2, 4, 8, 16, 32}) {
+            const int iterations = 3;
+            size_t numGroups = 0;
+            bool ranInParallel = false;
+            Timer t;
+            for (int i = 0; i < iterations; ++i) {
+                numGroups += aggregate(pipeline, parallelism, &ranInParallel).size();
+            }
+            const long long micros = std::max(t.micros(), 1LL);
+            ASSERT_EQUALS(parallelism > 1, ranInParallel);
+            unittest::log() << "parallel aggregation, parallelism " << parallelism << ": "
+                            << (numDocs * iterations * 1000000LL / micros)
+                            << " docs aggregated/sec, " << numGroups / iterations << " groups";
+        }
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("ParallelAggregation") {}
+
+    void setupTests() {
+        add<ParallelAggregationMatchesSerial>();
+        add<ParallelAggregationNotUsed>();
+        add<ParallelAggregationRemoveBoundaries>();
+        add<ParallelAggregationThroughput>();
+    }
+};
+
+SuiteInstance<All> all;
+}  // namespace ParallelAggregationTests
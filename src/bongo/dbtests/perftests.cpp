@@ -51,7 +51,9 @@
 #include "bongo/db/client.h"
 #include "bongo/db/db.h"
 #include "bongo/db/dbdirectclient.h"
+#include "bongo/db/dbmessage.h"
 #include "bongo/db/lasterror.h"
+#include "bongo/db/query/find.h"
 #include "bongo/db/storage/mmap_v1/dur_stats.h"
 #include "bongo/db/storage/mmap_v1/mmap.h"
 #include "bongo/db/storage/storage_options.h"
@@ -60,9 +62,15 @@
 #include "bongo/stdx/condition_variable.h"
 #include "bongo/stdx/thread.h"
 #include "bongo/util/log.h"
+#include "bongo/util/net/message_port.h"
 #include "bongo/util/timer.h"
 #include "bongo/util/version.h"
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 namespace PerfTests {
 
 using std::cout;
@@ -450,6 +458,278 @@ public:
     }
 };
 
+#ifndef _WIN32
+/**
+ * A MessagingPort over a local socket whose other end is read and discarded by another thread.
+ */
+class DrainedPort {
+public:
+    DrainedPort() {
+        int fds[2];
+        verify(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        _receiveFd = fds[1];
+        _port = stdx::make_unique<MessagingPort>(fds[0], SockAddr());
+        _drain = stdx::thread([this] {
+            std::vector<char> buf(1024 * 1024);
+            while (::read(_receiveFd, buf.data(), buf.size()) > 0) {
+            }
+        });
+    }
+
+    ~DrainedPort() {
+        _port.reset();
+        _drain.join();
+        ::close(_receiveFd);
+    }
+
+    void say(Message& msg) {
+        _port->say(msg);
+    }
+
+private:
+    std::unique_ptr<MessagingPort> _port;
+    int _receiveFd = -1;
+    stdx::thread _drain;
+};
+
+/**
+ * Sends getMore-style OP_REPLY messages for a 4MB batch of 1KB documents that share one buffer,
+ * as the documents of a batch received from a shard do, over a local socket that another thread
+ * drains. OpReplyCopy copies the documents into the reply; OpReplyGather splices them in and
+ * gathers the reply with a single sendmsg().
+ */
+class OpReplySend : public B {
+public:
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+
+    void prep() {
+        BufBuilder shardReply;
+        for (int i = 0; i < 4096; ++i) {
+            BSONObjBuilder doc(shardReply);
+            doc.append("_id", i);
+            doc.append("payload", string(1000, 'x'));
+        }
+        _shardReply = shardReply.release();
+
+        const char* pos = _shardReply.get();
+        for (int i = 0; i < 4096; ++i) {
+            BSONObj doc(pos);
+            doc.shareOwnershipWith(_shardReply);
+            _batch.push_back(doc);
+            pos += doc.objsize();
+        }
+
+        _port = stdx::make_unique<DrainedPort>();
+    }
+
+    void timed() {
+        OpQueryReplyBuilder reply;
+        for (auto&& doc : _batch) {
+            if (gather()) {
+                reply.appendResult(doc);
+            } else {
+                doc.appendSelfToBufBuilder(reply.bufBuilderForResults());
+            }
+        }
+        Message msg;
+        reply.putInMessage(&msg, 0, _batch.size());
+        _port->say(msg);
+    }
+
+    void post() {
+        _port.reset();
+    }
+
+protected:
+    virtual bool gather() = 0;
+
+private:
+    ConstSharedBuffer _shardReply;
+    vector<BSONObj> _batch;
+    std::unique_ptr<DrainedPort> _port;
+};
+
+class OpReplyCopy : public OpReplySend {
+public:
+    string name() {
+        return "OpReplyCopy";
+    }
+    bool gather() {
+        return false;
+    }
+};
+
+class OpReplyGather : public OpReplySend {
+public:
+    string name() {
+        return "OpReplyGather";
+    }
+    bool gather() {
+        return true;
+    }
+};
+
+/**
+ * Runs a legacy find that returns a whole collection of 32KB documents in one ~3MB batch, and
+ * sends the reply over a local socket. ScanFindUnsorted returns the documents as the collection
+ * scan reads them from the storage engine, which copies them once, straight into the reply.
+ * ScanFindSorted has them go through an in-memory sort first, so the results it returns are
+ * owned and get spliced into the reply without being copied again.
+ */
+class ScanFind : public B {
+public:
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+
+    void prep() {
+        const string payload(32 * 1024, 'x');
+        for (int i = 0; i < kNumDocs; ++i) {
+            insert(ns(), BSON("_id" << i << "k" << (kNumDocs - i) << "payload" << payload));
+        }
+        _port = stdx::make_unique<DrainedPort>();
+    }
+
+    void timed() {
+        Message request;
+        assembleQueryRequest(ns(), query(), -kNumDocs, 0, nullptr, 0, request);
+        DbMessage dbMessage(request);
+        QueryMessage queryMessage(dbMessage);
+
+        Message reply;
+        runQuery(txn(), queryMessage, NamespaceString(ns()), reply);
+        verify(QueryResult::View(reply.buf()).getNReturned() == kNumDocs);
+        _port->say(reply);
+    }
+
+    void post() {
+        _port.reset();
+    }
+
+protected:
+    virtual BSONObj query() = 0;
+
+private:
+    static const int kNumDocs = 96;
+
+    std::unique_ptr<DrainedPort> _port;
+};
+
+class ScanFindUnsorted : public ScanFind {
+public:
+    string name() {
+        return "ScanFindUnsorted";
+    }
+    BSONObj query() {
+        return BSONObj();
+    }
+};
+
+class ScanFindSorted : public ScanFind {
+public:
+    string name() {
+        return "ScanFindSorted";
+    }
+    BSONObj query() {
+        return BSON("$query" << BSONObj() << "$orderby" << BSON("k" << 1));
+    }
+};
+#endif
+
+/**
+ * Finds every other document of a collection through a compound index on {a: 1, tags: 1}, where
+ * 'tags' holds arrays and 'a' does not. MultikeyFilterCovered filters on and returns 'a' only, so
+ * it is answered from the index keys; MultikeyFilterFetched also returns 'tags', so it fetches
+ * each matching document. post() reports how many documents each had to fetch.
+ */
+class MultikeyFilter : public B {
+public:
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+
+    void prep() {
+        client()->createIndex(ns(), BSON("a" << 1 << "tags" << 1));
+        const string payload(512, 'x');
+        for (int i = 0; i < kNumDocs; ++i) {
+            insert(ns(),
+                   BSON("_id" << i << "a" << i << "tags" << BSON_ARRAY(i % 7 << i % 11)
+                              << "payload"
+                              << payload));
+        }
+    }
+
+    void timed() {
+        BSONObj fields = projection();
+        std::unique_ptr<DBClientCursor> c = client()->query(ns(), query(), 0, 0, &fields);
+        int n = 0;
+        while (c->more()) {
+            c->next();
+            ++n;
+        }
+        verify(n == kNumDocs / 2);
+    }
+
+    void post() {
+        BSONObj fields = projection();
+        std::unique_ptr<DBClientCursor> c =
+            client()->query(ns(), Query(query()).explain(), 0, 0, &fields);
+        verify(c->more());
+        BSONObj execStats = c->next()["executionStats"].Obj();
+        cout << "stats " << setw(42) << left << name() << " docsExamined per query: "
+             << execStats.getIntField("totalDocsExamined") << endl;
+    }
+
+protected:
+    virtual BSONObj projection() = 0;
+
+private:
+    static BSONObj query() {
+        return BSON("a" << BSON("$mod" << BSON_ARRAY(2 << 0)));
+    }
+
+    static const int kNumDocs = 2000;
+};
+
+class MultikeyFilterCovered : public MultikeyFilter {
+public:
+    string name() {
+        return "MultikeyFilterCovered";
+    }
+    BSONObj projection() {
+        return BSON("_id" << 0 << "a" << 1);
+    }
+};
+
+class MultikeyFilterFetched : public MultikeyFilter {
+public:
+    string name() {
+        return "MultikeyFilterFetched";
+    }
+    BSONObj projection() {
+        return BSON("_id" << 0 << "a" << 1 << "tags" << 1);
+    }
+};
 
 class All : public Suite {
 public:
@@ -463,6 +743,14 @@ public:
         add<boosttimed_mutexspeed>();
         add<stdmutexspeed>();
         add<stdtimed_mutexspeed>();
+#ifndef _WIN32
+        add<OpReplyCopy>();
+        add<OpReplyGather>();
+        add<ScanFindUnsorted>();
+        add<ScanFindSorted>();
+#endif
+        add<MultikeyFilterCovered>();
+        add<MultikeyFilterFetched>();
     }
 } myall;
 }  // namespace PerfTests
@@ -45,6 +45,7 @@
 #include "bongo/db/json.h"
 #include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
 #include "bongo/db/namespace_string.h"
+#include "bongo/db/query/explain.h"
 #include "bongo/db/query/get_executor.h"
 #include "bongo/db/query/query_knobs.h"
 #include "bongo/db/query/query_planner.h"
@@ -625,6 +626,72 @@ public:
     }
 };
 
+/**
+ * With cost-based pruning on, a candidate that statistics show to be far cheaper than the others
+ * runs without a trial, and explain reports its estimated number of results.
+ */
+class PlanRankingPruneByEstimatedCost : public PlanRankingTestBase {
+public:
+    PlanRankingPruneByEstimatedCost()
+        : _enableCostBasedPruning(internalQueryPlannerEnableCostBasedPruning.load()),
+          _statisticsSampleSize(internalQueryStatisticsSampleSize.load()) {
+        internalQueryPlannerEnableCostBasedPruning.store(true);
+
+        // Sample every document, so that the estimates are exact.
+        internalQueryStatisticsSampleSize.store(2 * N);
+    }
+
+    ~PlanRankingPruneByEstimatedCost() {
+        internalQueryPlannerEnableCostBasedPruning.store(_enableCostBasedPruning);
+        internalQueryStatisticsSampleSize.store(_statisticsSampleSize);
+    }
+
+    void run() {
+        // 'a' is very selective, 'b' is not.
+        for (int i = 0; i < N; ++i) {
+            insert(BSON("a" << i << "b" << 1));
+        }
+
+        addIndex(BSON("a" << 1));
+        addIndex(BSON("b" << 1));
+
+        AutoGetCollectionForRead ctx(&_txn, nss);
+        Collection* collection = ctx.getCollection();
+
+        auto qr = stdx::make_unique<QueryRequest>(nss);
+        qr->setFilter(fromjson("{a: 4, b: 1}"));
+        auto statusWithCQ = CanonicalQuery::canonicalize(
+            txn(), std::move(qr), ExtensionsCallbackDisallowExtensions());
+        ASSERT_OK(statusWithCQ.getStatus());
+
+        auto statusWithExec = getExecutor(txn(),
+                                          collection,
+                                          std::move(statusWithCQ.getValue()),
+                                          PlanExecutor::YIELD_MANUAL);
+        ASSERT_OK(statusWithExec.getStatus());
+        auto exec = std::move(statusWithExec.getValue());
+
+        // Only the plan using index {a: 1} is left, so no MultiPlanStage is needed.
+        ASSERT_NOT_EQUALS(STAGE_MULTI_PLAN, exec->getRootStage()->stageType());
+        ASSERT_EQUALS("IXSCAN { a: 1 }", Explain::getPlanSummary(exec.get()));
+
+        BSONObj obj;
+        ASSERT_EQUALS(PlanExecutor::ADVANCED, exec->getNext(&obj, NULL));
+        ASSERT_EQUALS(PlanExecutor::IS_EOF, exec->getNext(&obj, NULL));
+
+        BSONObjBuilder bob;
+        Explain::explainStages(exec.get(), collection, ExplainCommon::EXEC_STATS, &bob);
+        BSONObj winningPlan = bob.obj()["queryPlanner"]["winningPlan"].Obj();
+        ASSERT_EQUALS("FETCH", winningPlan["stage"].str());
+        ASSERT_EQUALS(1, winningPlan["estimatedNReturned"].numberLong());
+        ASSERT_EQUALS(1, winningPlan["inputStage"]["estimatedNReturned"].numberLong());
+    }
+
+private:
+    bool _enableCostBasedPruning;
+    int _statisticsSampleSize;
+};
+
 class All : public Suite {
 public:
     All() : Suite("query_plan_ranking") {}
@@ -642,6 +709,7 @@ public:
         add<PlanRankingAvoidBlockingSort>();
         add<PlanRankingWorkPlansLongEnough>();
         add<PlanRankingAccountForKeySkips>();
+        add<PlanRankingPruneByEstimatedCost>();
     }
 };
 
@@ -48,6 +48,7 @@
 #include "bongo/db/query/query_planner_params.h"
 #include "bongo/dbtests/dbtests.h"
 #include "bongo/stdx/memory.h"
+#include "bongo/util/scopeguard.h"
 
 namespace QueryStageCachedPlan {
 
@@ -103,6 +104,37 @@ public:
         return &_txn;
     }
 
+    /**
+     * Runs a CachedPlanStage, with a decision works of 10, whose trial period takes 'trialWorks'
+     * works before hitting EOF, and returns whether it replanned.
+     */
+    bool runCachedPlanTrial(Collection* collection,
+                            CanonicalQuery* cq,
+                            const QueryPlannerParams& plannerParams,
+                            size_t trialWorks) {
+        const size_t decisionWorks = 10;
+        auto mockChild = stdx::make_unique<QueuedDataStage>(&_txn, &_ws);
+        for (size_t i = 0; i < trialWorks; i++) {
+            mockChild->pushBack(PlanStage::NEED_TIME);
+        }
+
+        CachedPlanStage cachedPlanStage(
+            &_txn, collection, &_ws, cq, plannerParams, decisionWorks, mockChild.release());
+        PlanYieldPolicy yieldPolicy(PlanExecutor::YIELD_MANUAL,
+                                    _txn.getServiceContext()->getFastClockSource());
+        ASSERT_OK(cachedPlanStage.pickBestPlan(&yieldPolicy));
+
+        return static_cast<const CachedPlanStats*>(cachedPlanStage.getSpecificStats())->replanned;
+    }
+
+    /**
+     * The number of trial works past the threshold for replanning a plan with a decision works
+     * of 10.
+     */
+    static size_t worksPastMaxWorks() {
+        return 1U + static_cast<size_t>(internalQueryCacheEvictionRatio * 10);
+    }
+
 protected:
     const ServiceContext::UniqueOperationContext _txnPtr = cc().makeOperationContext();
     OperationContext& _txn = *_txnPtr;
@@ -250,6 +282,101 @@ public:
     }
 };
 
+/**
+ * Test that once a query shape has been replanned after hitting the works threshold, further
+ * queries of the shape which hit the threshold within the replan interval keep running the
+ * cached plan rather than replanning again.
+ */
+class QueryStageCachedPlanReplanRateLimited : public QueryStageCachedPlanBase {
+public:
+    void run() {
+        const int oldReplanInterval = internalQueryCacheReplanIntervalMillis.load();
+        ON_BLOCK_EXIT([oldReplanInterval] {
+            internalQueryCacheReplanIntervalMillis.store(oldReplanInterval);
+        });
+        internalQueryCacheReplanIntervalMillis.store(60 * 60 * 1000);
+
+        AutoGetCollectionForRead ctx(&_txn, nss);
+        Collection* collection = ctx.getCollection();
+        ASSERT(collection);
+
+        // Query can be answered by either index on "a" or index on "b".
+        auto qr = stdx::make_unique<QueryRequest>(nss);
+        qr->setFilter(fromjson("{a: {$gte: 8}, b: 1}"));
+        auto statusWithCQ = CanonicalQuery::canonicalize(
+            txn(), std::move(qr), ExtensionsCallbackDisallowExtensions());
+        ASSERT_OK(statusWithCQ.getStatus());
+        const std::unique_ptr<CanonicalQuery> cq = std::move(statusWithCQ.getValue());
+
+        QueryPlannerParams plannerParams;
+        fillOutPlannerParams(&_txn, collection, cq.get(), &plannerParams);
+
+        // The first run creates a cache entry and the second, which finds that entry, replans.
+        PlanCache* cache = collection->infoCache()->getPlanCache();
+        ASSERT_TRUE(runCachedPlanTrial(collection, cq.get(), plannerParams, worksPastMaxWorks()));
+        ASSERT_TRUE(cache->contains(*cq));
+        ASSERT_TRUE(runCachedPlanTrial(collection, cq.get(), plannerParams, worksPastMaxWorks()));
+
+        // The third is within the replan interval of the second, so it does not replan.
+        const long long replansAvoided = planCacheMetrics.replansAvoided.get();
+        ASSERT_FALSE(runCachedPlanTrial(collection, cq.get(), plannerParams, worksPastMaxWorks()));
+        ASSERT_EQ(planCacheMetrics.replansAvoided.get(), replansAvoided + 1);
+        ASSERT_TRUE(cache->contains(*cq));
+    }
+
+};
+
+/**
+ * Test that a cached plan whose earlier runs often took more works than the threshold for
+ * replanning has its trial period extended, and is replanned only when it takes significantly
+ * longer than those runs.
+ */
+class QueryStageCachedPlanExtendsTrialForSlowRuns : public QueryStageCachedPlanBase {
+public:
+    void run() {
+        AutoGetCollectionForRead ctx(&_txn, nss);
+        Collection* collection = ctx.getCollection();
+        ASSERT(collection);
+
+        // Query can be answered by either index on "a" or index on "b".
+        auto qr = stdx::make_unique<QueryRequest>(nss);
+        qr->setFilter(fromjson("{a: {$gte: 8}, b: 1}"));
+        auto statusWithCQ = CanonicalQuery::canonicalize(
+            txn(), std::move(qr), ExtensionsCallbackDisallowExtensions());
+        ASSERT_OK(statusWithCQ.getStatus());
+        const std::unique_ptr<CanonicalQuery> cq = std::move(statusWithCQ.getValue());
+
+        QueryPlannerParams plannerParams;
+        fillOutPlannerParams(&_txn, collection, cq.get(), &plannerParams);
+
+        // The first run creates a cache entry.
+        PlanCache* cache = collection->infoCache()->getPlanCache();
+        ASSERT_TRUE(runCachedPlanTrial(collection, cq.get(), plannerParams, worksPastMaxWorks()));
+        ASSERT_TRUE(cache->contains(*cq));
+
+        // Earlier runs took up to twice the threshold.
+        const size_t maxWorks = worksPastMaxWorks();
+        for (int i = 0; i < internalQueryCacheReplanMinRuns.load(); ++i) {
+            auto feedback = stdx::make_unique<PlanCacheEntryFeedback>();
+            feedback->stats =
+                stdx::make_unique<PlanStageStats>(CommonStats("COLLSCAN"), STAGE_COLLSCAN);
+            feedback->score = 1;
+            feedback->trialWorks = i % 2 ? maxWorks / 2 : maxWorks * 2;
+            ASSERT_OK(cache->feedback(*cq, feedback.release()));
+        }
+        ASSERT_GREATER_THAN(cache->getSignificantTrialWorks(*cq), maxWorks * 2);
+
+        // A run past the threshold, but within what earlier runs took, is not replanned.
+        const long long replansAvoided = planCacheMetrics.replansAvoided.get();
+        ASSERT_FALSE(runCachedPlanTrial(collection, cq.get(), plannerParams, maxWorks * 2));
+        ASSERT_EQ(planCacheMetrics.replansAvoided.get(), replansAvoided + 1);
+
+        // A run significantly slower than them is.
+        ASSERT_TRUE(runCachedPlanTrial(
+            collection, cq.get(), plannerParams, cache->getSignificantTrialWorks(*cq)));
+    }
+};
+
 class All : public Suite {
 public:
     All() : Suite("query_stage_cached_plan") {}
@@ -257,6 +384,8 @@ public:
     void setupTests() {
         add<QueryStageCachedPlanFailure>();
         add<QueryStageCachedPlanHitMaxWorks>();
+        add<QueryStageCachedPlanReplanRateLimited>();
+        add<QueryStageCachedPlanExtendsTrialForSlowRuns>();
     }
 };
 
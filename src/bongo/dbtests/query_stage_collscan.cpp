@@ -45,10 +45,13 @@
 #include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
 #include "bongo/db/namespace_string.h"
 #include "bongo/db/query/plan_executor.h"
+#include "bongo/db/query/query_knobs.h"
 #include "bongo/db/storage/record_store.h"
 #include "bongo/dbtests/dbtests.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/util/fail_point_service.h"
+#include "bongo/util/scopeguard.h"
+#include "bongo/util/timer.h"
 
 namespace QueryStageCollectionScan {
 
@@ -79,6 +82,10 @@ public:
         _client.dropCollection(nss.ns());
     }
 
+    void insert(const BSONObj& obj) {
+        _client.insert(nss.ns(), obj);
+    }
+
     void remove(const BSONObj& obj) {
         _client.remove(nss.ns(), obj);
     }
@@ -141,6 +148,97 @@ public:
         }
     }
 
+    /**
+     * Returns the "foo" values of the documents that a scan with 'filterObj' returns, pulling
+     * them 'batchSize' at a time through workBatch(), or through work() if 'batchSize' is zero.
+     */
+    vector<int> getFooValues(CollectionScanParams::Direction direction,
+                             const BSONObj& filterObj,
+                             size_t batchSize) {
+        AutoGetCollectionForRead ctx(&_txn, nss);
+
+        CollectionScanParams params;
+        params.collection = ctx.getCollection();
+        params.direction = direction;
+        params.tailable = false;
+
+        const CollatorInterface* collator = nullptr;
+        StatusWithMatchExpression statusWithMatcher = MatchExpressionParser::parse(
+            filterObj, ExtensionsCallbackDisallowExtensions(), collator);
+        verify(statusWithMatcher.isOK());
+        unique_ptr<MatchExpression> filterExpr = std::move(statusWithMatcher.getValue());
+
+        WorkingSet ws;
+        CollectionScan scan(&_txn, params, &ws, filterExpr.get());
+
+        vector<int> out;
+        vector<WorkingSetID> batch;
+        while (!scan.isEOF()) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            batch.clear();
+            PlanStage::StageState state =
+                batchSize ? scan.workBatch(batchSize, &batch, &id) : scan.work(&id);
+            if (PlanStage::ADVANCED != state) {
+                continue;
+            }
+            if (!batchSize) {
+                batch.push_back(id);
+            }
+            ASSERT_LESS_THAN_OR_EQUALS(batch.size(), std::max(batchSize, size_t(1)));
+
+            // All the results of a batch must be valid at once.
+            for (auto resultId : batch) {
+                out.push_back(ws.get(resultId)->obj.value()["foo"].numberInt());
+            }
+            for (auto resultId : batch) {
+                ws.free(resultId);
+            }
+        }
+        return out;
+    }
+
+    /**
+     * Runs a scan with 'filterObj' to the end in a yielding plan executor, pulling its results
+     * 'batchSize' at a time through getNextBatch(), or through getNext() if 'batchSize' is zero.
+     * Returns how many times the plan yielded.
+     */
+    size_t countYields(const BSONObj& filterObj, size_t batchSize) {
+        AutoGetCollectionForRead ctx(&_txn, nss);
+
+        CollectionScanParams params;
+        params.collection = ctx.getCollection();
+        params.direction = CollectionScanParams::FORWARD;
+        params.tailable = false;
+
+        const CollatorInterface* collator = nullptr;
+        StatusWithMatchExpression statusWithMatcher = MatchExpressionParser::parse(
+            filterObj, ExtensionsCallbackDisallowExtensions(), collator);
+        verify(statusWithMatcher.isOK());
+        unique_ptr<MatchExpression> filterExpr = std::move(statusWithMatcher.getValue());
+
+        unique_ptr<WorkingSet> ws = make_unique<WorkingSet>();
+        unique_ptr<PlanStage> ps =
+            make_unique<CollectionScan>(&_txn, params, ws.get(), filterExpr.get());
+
+        auto statusWithPlanExecutor = PlanExecutor::make(
+            &_txn, std::move(ws), std::move(ps), params.collection, PlanExecutor::YIELD_AUTO);
+        ASSERT_OK(statusWithPlanExecutor.getStatus());
+        unique_ptr<PlanExecutor> exec = std::move(statusWithPlanExecutor.getValue());
+
+        PlanExecutor::ExecState state;
+        if (batchSize) {
+            vector<BSONObj> batch;
+            while (PlanExecutor::ADVANCED == (state = exec->getNextBatch(batchSize, &batch))) {
+                batch.clear();
+            }
+        } else {
+            for (BSONObj obj; PlanExecutor::ADVANCED == (state = exec->getNext(&obj, NULL));) {
+            }
+        }
+        ASSERT_EQUALS(PlanExecutor::IS_EOF, state);
+        return exec->getRootStage()->getCommonStats()->yields;
+    }
+
     static int numObj() {
         return 50;
     }
@@ -399,6 +497,169 @@ public:
     }
 };
 
+//
+// Pull results a batch at a time, and expect the same results in the same order as work().
+//
+class QueryStageCollscanBatchMatchesWork : public QueryStageCollectionScanBase {
+public:
+    void run() {
+        const BSONObj filters[] = {BSONObj(), BSON("foo" << BSON("$lt" << 25)), BSON("foo" << 7)};
+        for (auto direction : {CollectionScanParams::FORWARD, CollectionScanParams::BACKWARD}) {
+            for (const auto& filter : filters) {
+                const vector<int> expected = getFooValues(direction, filter, 0);
+                for (size_t batchSize : {1, 2, 7, 64}) {
+                    ASSERT(expected == getFooValues(direction, filter, batchSize));
+                }
+            }
+        }
+    }
+};
+
+//
+// A plan pulled a batch at a time yields after as many units of work as one pulled a result at a
+// time, even when most of the records it examines are filtered out.
+//
+class QueryStageCollscanBatchYieldsAsOften : public QueryStageCollectionScanBase {
+public:
+    void run() {
+        const int oldYieldIterations = internalQueryExecYieldIterations.load();
+        const int oldYieldPeriodMS = internalQueryExecYieldPeriodMS.load();
+        ON_BLOCK_EXIT([oldYieldIterations, oldYieldPeriodMS] {
+            internalQueryExecYieldIterations.store(oldYieldIterations);
+            internalQueryExecYieldPeriodMS.store(oldYieldPeriodMS);
+        });
+
+        // Only yield based on the number of units of work done.
+        internalQueryExecYieldIterations.store(7);
+        internalQueryExecYieldPeriodMS.store(1000 * 1000 * 1000);
+
+        const BSONObj filters[] = {BSONObj(), BSON("foo" << BSON("$mod" << BSON_ARRAY(10 << 0)))};
+        for (const auto& filter : filters) {
+            const size_t expected = countYields(filter, 0);
+            ASSERT_GREATER_THAN(expected, 0U);
+            for (size_t batchSize : {2, 64}) {
+                ASSERT_EQUALS(expected, countYields(filter, batchSize));
+            }
+        }
+    }
+};
+
+//
+// A scan bounded by 'start' and 'end' returns the records from 'start' up to, but not including,
+// 'end'. With 'skipToStart' set, it still finds its place after 'start' has been deleted.
+//
+class QueryStageCollscanRange : public QueryStageCollectionScanBase {
+public:
+    void run() {
+        OldClientWriteContext ctx(&_txn, nss.ns());
+        Collection* collection = ctx.getCollection();
+
+        vector<RecordId> recordIds;
+        getRecordIds(collection, CollectionScanParams::FORWARD, &recordIds);
+        ASSERT_EQUALS(static_cast<size_t>(numObj()), recordIds.size());
+
+        for (size_t batchSize : {0, 1, 64}) {
+            ASSERT(fooRange(10, 20) ==
+                   getFooValues(collection, recordIds[10], recordIds[20], false, batchSize));
+            ASSERT(fooRange(0, 5) ==
+                   getFooValues(collection, RecordId(), recordIds[5], false, batchSize));
+            ASSERT(fooRange(40, numObj()) ==
+                   getFooValues(collection, recordIds[40], RecordId(), false, batchSize));
+        }
+
+        remove(BSON("foo" << 10));
+        for (size_t batchSize : {0, 64}) {
+            ASSERT(getFooValues(collection, recordIds[10], recordIds[20], false, batchSize)
+                       .empty());
+            ASSERT(fooRange(11, 20) ==
+                   getFooValues(collection, recordIds[10], recordIds[20], true, batchSize));
+        }
+
+        // The records before 'start' are skipped a call to work() at a time.
+        size_t numWorksToFirstResult = 0;
+        getFooValues(collection, recordIds[10], recordIds[20], true, 0, &numWorksToFirstResult);
+        ASSERT_GT(numWorksToFirstResult, 10U);
+    }
+
+private:
+    static vector<int> fooRange(int begin, int end) {
+        vector<int> values;
+        for (int i = begin; i < end; ++i) {
+            values.push_back(i);
+        }
+        return values;
+    }
+
+    vector<int> getFooValues(Collection* collection,
+                             const RecordId& start,
+                             const RecordId& end,
+                             bool skipToStart,
+                             size_t batchSize,
+                             size_t* numWorksToFirstResult = nullptr) {
+        CollectionScanParams params;
+        params.collection = collection;
+        params.start = start;
+        params.end = end;
+        params.skipToStart = skipToStart;
+
+        WorkingSet ws;
+        CollectionScan scan(&_txn, params, &ws, nullptr);
+
+        vector<int> out;
+        vector<WorkingSetID> batch;
+        while (!scan.isEOF()) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            batch.clear();
+            PlanStage::StageState state =
+                batchSize ? scan.workBatch(batchSize, &batch, &id) : scan.work(&id);
+            if (numWorksToFirstResult && out.empty()) {
+                ++*numWorksToFirstResult;
+            }
+            if (PlanStage::ADVANCED != state) {
+                continue;
+            }
+            if (!batchSize) {
+                batch.push_back(id);
+            }
+            for (auto resultId : batch) {
+                out.push_back(ws.get(resultId)->obj.value()["foo"].numberInt());
+                ws.free(resultId);
+            }
+        }
+        return out;
+    }
+};
+
+//
+// Compare the throughput of a filtered scan that is pulled a result at a time with work() against
+// one pulled a batch at a time with workBatch().
+//
+class QueryStageCollscanBatchThroughput : public QueryStageCollectionScanBase {
+public:
+    void run() {
+        const int numDocs = 20000;
+        for (int i = numObj(); i < numDocs; ++i) {
+            insert(BSON("foo" << i << "bar" << (i % 10) << "baz"
+                              << "the quick brown fox jumps over the lazy dog"));
+        }
+        const BSONObj filter = BSON("bar" << BSON("$lt" << 5));
+
+        for (size_t batchSize : {0, 64}) {
+            const int iterations = 5;
+            size_t numResults = 0;
+            Timer t;
+            for (int i = 0; i < iterations; ++i) {
+                numResults += getFooValues(CollectionScanParams::FORWARD, filter, batchSize).size();
+            }
+            const long long micros = std::max(t.micros(), 1LL);
+            unittest::log() << "collection scan, " << (batchSize ? "workBatch(64)" : "work()")
+                            << ": " << (numDocs * iterations * 1000000LL / micros)
+                            << " docs scanned/sec, " << numResults / iterations
+                            << " results per scan";
+        }
+    }
+};
+
 class All : public Suite {
 public:
     All() : Suite("QueryStageCollectionScan") {}
@@ -413,6 +674,10 @@ public:
         add<QueryStageCollscanObjectsInOrderBackward>();
         add<QueryStageCollscanInvalidateUpcomingObject>();
         add<QueryStageCollscanInvalidateUpcomingObjectBackward>();
+        add<QueryStageCollscanBatchMatchesWork>();
+        add<QueryStageCollscanRange>();
+        add<QueryStageCollscanBatchYieldsAsOften>();
+        add<QueryStageCollscanBatchThroughput>();
     }
 };
 
@@ -52,6 +52,7 @@ namespace QueryStageFetch {
 using std::set;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 using stdx::make_unique;
 
 class QueryStageFetchBase {
@@ -219,6 +220,78 @@ public:
     }
 };
 
+//
+// Test fetching and filtering a batch at a time.
+//
+class FetchStageBatch : public QueryStageFetchBase {
+public:
+    void run() {
+        OldClientWriteContext ctx(&_txn, ns());
+        Database* db = ctx.db();
+        Collection* coll = db->getCollection(ns());
+        if (!coll) {
+            WriteUnitOfWork wuow(&_txn);
+            coll = db->createCollection(&_txn, ns());
+            wuow.commit();
+        }
+
+        const int numDocs = 40;
+        for (int i = 0; i < numDocs; ++i) {
+            insert(BSON("foo" << i));
+        }
+        set<RecordId> recordIds;
+        getRecordIds(&recordIds, coll);
+        ASSERT_EQUALS(size_t(numDocs), recordIds.size());
+
+        BSONObj filterObj = BSON("foo" << BSON("$gte" << 10));
+        const CollatorInterface* collator = nullptr;
+        StatusWithMatchExpression statusWithMatcher = MatchExpressionParser::parse(
+            filterObj, ExtensionsCallbackDisallowExtensions(), collator);
+        verify(statusWithMatcher.isOK());
+        unique_ptr<MatchExpression> filterExpr = std::move(statusWithMatcher.getValue());
+
+        for (size_t batchSize : {1, 8, 64}) {
+            WorkingSet ws;
+            auto mockStage = make_unique<QueuedDataStage>(&_txn, &ws);
+            for (auto&& recordId : recordIds) {
+                WorkingSetID id = ws.allocate();
+                WorkingSetMember* mockMember = ws.get(id);
+                mockMember->recordId = recordId;
+                ws.transitionToRecordIdAndIdx(id);
+                mockStage->pushBack(id);
+            }
+
+            FetchStage fetchStage(&_txn, &ws, mockStage.release(), filterExpr.get(), coll);
+
+            set<int> seen;
+            vector<WorkingSetID> batch;
+            while (!fetchStage.isEOF()) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                batch.clear();
+                PlanStage::StageState state = fetchStage.workBatch(batchSize, &batch, &id);
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                if (PlanStage::ADVANCED != state) {
+                    continue;
+                }
+                ASSERT_LESS_THAN_OR_EQUALS(batch.size(), batchSize);
+
+                // All the documents of a batch must be valid at once.
+                for (auto resultId : batch) {
+                    WorkingSetMember* member = ws.get(resultId);
+                    ASSERT_TRUE(member->hasObj());
+                    int foo = member->obj.value()["foo"].numberInt();
+                    ASSERT_GREATER_THAN_OR_EQUALS(foo, 10);
+                    ASSERT_TRUE(seen.insert(foo).second);
+                }
+                for (auto resultId : batch) {
+                    ws.free(resultId);
+                }
+            }
+            ASSERT_EQUALS(size_t(numDocs - 10), seen.size());
+        }
+    }
+};
+
 class All : public Suite {
 public:
     All() : Suite("query_stage_fetch") {}
@@ -226,6 +299,7 @@ public:
     void setupTests() {
         add<FetchStageAlreadyFetched>();
         add<FetchStageFilter>();
+        add<FetchStageBatch>();
     }
 };
 
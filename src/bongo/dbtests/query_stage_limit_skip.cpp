@@ -42,6 +42,7 @@
 #include "bongo/db/json.h"
 #include "bongo/dbtests/dbtests.h"
 #include "bongo/stdx/memory.h"
+#include "bongo/util/timer.h"
 
 using namespace bongo;
 
@@ -50,6 +51,7 @@ namespace {
 using std::max;
 using std::min;
 using std::unique_ptr;
+using std::vector;
 using stdx::make_unique;
 
 static const int N = 50;
@@ -87,6 +89,27 @@ int countResults(PlanStage* stage) {
     return count;
 }
 
+/**
+ * Returns the "x" values of the results of 'stage', pulling them 'batchSize' at a time.
+ */
+vector<int> getBatchedResults(PlanStage* stage, WorkingSet* ws, size_t batchSize) {
+    vector<int> out;
+    vector<WorkingSetID> batch;
+    while (!stage->isEOF()) {
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        batch.clear();
+        if (PlanStage::ADVANCED != stage->workBatch(batchSize, &batch, &id)) {
+            continue;
+        }
+        ASSERT_LESS_THAN_OR_EQUALS(batch.size(), batchSize);
+        for (auto resultId : batch) {
+            out.push_back(ws->get(resultId)->obj.value()["x"].numberInt());
+            ws->free(resultId);
+        }
+    }
+    return out;
+}
+
 //
 // Insert 50 objects.  Filter/skip 0, 1, 2, ..., 100 objects and expect the right # of results.
 //
@@ -110,12 +133,82 @@ protected:
     OperationContext* const _opCtx = _uniqOpCtx.get();
 };
 
+//
+// Skip and limit with results pulled a batch at a time.
+//
+class QueryStageLimitSkipBatchTest {
+public:
+    void run() {
+        for (size_t batchSize : {1, 3, 64}) {
+            for (int skip = 0; skip <= N + 1; skip += 7) {
+                for (int limit = 1; limit <= N + 1; limit += 5) {
+                    WorkingSet ws;
+                    unique_ptr<PlanStage> stage = make_unique<LimitStage>(
+                        _opCtx,
+                        limit,
+                        &ws,
+                        new SkipStage(_opCtx, skip, &ws, getMS(_opCtx, &ws)));
+
+                    vector<int> expected;
+                    for (int x = skip; x < min(N, skip + limit); ++x) {
+                        expected.push_back(x);
+                    }
+                    ASSERT(expected == getBatchedResults(stage.get(), &ws, batchSize));
+                }
+            }
+        }
+    }
+
+protected:
+    const ServiceContext::UniqueOperationContext _uniqOpCtx = cc().makeOperationContext();
+    OperationContext* const _opCtx = _uniqOpCtx.get();
+};
+
+//
+// Compare the throughput of a skip over a limit that is pulled a result at a time with work()
+// against one pulled a batch at a time with workBatch().
+//
+class QueryStageLimitSkipBatchThroughput {
+public:
+    void run() {
+        const int numDocs = 100000;
+        for (size_t batchSize : {0, 64}) {
+            WorkingSet ws;
+            auto ms = make_unique<QueuedDataStage>(_opCtx, &ws);
+            for (int i = 0; i < numDocs; ++i) {
+                WorkingSetID id = ws.allocate();
+                WorkingSetMember* wsm = ws.get(id);
+                wsm->obj = Snapshotted<BSONObj>(SnapshotId(), BSON("x" << i));
+                wsm->transitionToOwnedObj();
+                ms->pushBack(id);
+            }
+            unique_ptr<PlanStage> stage = make_unique<SkipStage>(
+                _opCtx, 10, &ws, new LimitStage(_opCtx, numDocs, &ws, ms.release()));
+
+            Timer t;
+            const size_t numResults =
+                batchSize ? getBatchedResults(stage.get(), &ws, batchSize).size()
+                          : static_cast<size_t>(countResults(stage.get()));
+            ASSERT_EQUALS(static_cast<size_t>(numDocs - 10), numResults);
+            const long long micros = std::max(t.micros(), 1LL);
+            unittest::log() << "skip over limit, " << (batchSize ? "workBatch(64)" : "work()")
+                            << ": " << (numResults * 1000000LL / micros) << " results/sec";
+        }
+    }
+
+protected:
+    const ServiceContext::UniqueOperationContext _uniqOpCtx = cc().makeOperationContext();
+    OperationContext* const _opCtx = _uniqOpCtx.get();
+};
+
 class All : public Suite {
 public:
     All() : Suite("query_stage_limit_skip") {}
 
     void setupTests() {
         add<QueryStageLimitSkipBasicTest>();
+        add<QueryStageLimitSkipBatchTest>();
+        add<QueryStageLimitSkipBatchThroughput>();
     }
 };
 
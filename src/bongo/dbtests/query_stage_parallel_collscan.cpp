@@ -0,0 +1,353 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file tests db/exec/parallel_collection_scan.cpp.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include <algorithm>
+#include <set>
+
+#include "bongo/db/catalog/collection.h"
+#include "bongo/db/client.h"
+#include "bongo/db/db_raii.h"
+#include "bongo/db/dbdirectclient.h"
+#include "bongo/db/exec/parallel_collection_scan.h"
+#include "bongo/db/exec/working_set.h"
+#include "bongo/db/matcher/extensions_callback_disallow_extensions.h"
+#include "bongo/db/namespace_string.h"
+#include "bongo/db/query/canonical_query.h"
+#include "bongo/db/query/explain.h"
+#include "bongo/db/query/get_executor.h"
+#include "bongo/db/query/plan_executor.h"
+#include "bongo/db/query/query_knobs.h"
+#include "bongo/db/service_context.h"
+#include "bongo/db/storage/storage_engine.h"
+#include "bongo/dbtests/dbtests.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/util/timer.h"
+
+namespace QueryStageParallelCollectionScan {
+
+using std::unique_ptr;
+using std::vector;
+using stdx::make_unique;
+
+static const NamespaceString nss{"unittests.QueryStageParallelCollectionScan"};
+
+class QueryStageParallelCollectionScanBase {
+public:
+    QueryStageParallelCollectionScanBase() : _client(&_txn) {
+        OldClientWriteContext ctx(&_txn, nss.ns());
+        for (int i = 0; i < numObj(); ++i) {
+            _client.insert(nss.ns(), BSON("foo" << i << "bar" << (i % 10)));
+        }
+    }
+
+    virtual ~QueryStageParallelCollectionScanBase() {
+        OldClientWriteContext ctx(&_txn, nss.ns());
+        _client.dropCollection(nss.ns());
+    }
+
+    static int numObj() {
+        return 5000;
+    }
+
+    /**
+     * The threads read the collection outside the query's snapshot, which needs document-level
+     * locking.
+     */
+    bool canScanInParallel() {
+        return _txn.getServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
+    }
+
+    /**
+     * Scans the collection with 'numWorkers' threads and returns the 'foo' values of the
+     * documents matching 'filter', in the order they were returned.
+     */
+    vector<int> getFooValues(size_t numWorkers,
+                             const BSONObj& filter,
+                             size_t batchSize,
+                             ParallelCollectionScanStats* stats = nullptr) {
+        AutoGetCollectionForRead ctx(&_txn, nss);
+
+        WorkingSet ws;
+        auto scan = make_unique<ParallelCollectionScan>(
+            &_txn, ctx.getCollection(), numWorkers, &ws, filter, nullptr);
+
+        vector<int> values;
+        vector<WorkingSetID> ids;
+        while (!scan->isEOF()) {
+            ids.clear();
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            PlanStage::StageState state = batchSize ? scan->workBatch(batchSize, &ids, &id)
+                                                    : scan->work(&id);
+            ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+            if (!batchSize && PlanStage::ADVANCED == state) {
+                ids.push_back(id);
+            }
+            for (WorkingSetID resultId : ids) {
+                values.push_back(ws.get(resultId)->obj.value()["foo"].numberInt());
+                ws.free(resultId);
+            }
+        }
+
+        if (stats) {
+            *stats = *static_cast<const ParallelCollectionScanStats*>(scan->getSpecificStats());
+        }
+        return values;
+    }
+
+    static vector<int> sorted(vector<int> values) {
+        std::sort(values.begin(), values.end());
+        return values;
+    }
+
+protected:
+    const ServiceContext::UniqueOperationContext _txnPtr = cc().makeOperationContext();
+    OperationContext& _txn = *_txnPtr;
+
+    DBDirectClient _client;
+};
+
+/**
+ * Sets the parallel collection scan knobs for the lifetime of the object.
+ */
+class ParallelCollScanKnobs {
+public:
+    ParallelCollScanKnobs(int maxWorkers, int minRecords)
+        : _oldMaxWorkers(internalQueryParallelCollScanMaxWorkers.load()),
+          _oldMinRecords(internalQueryParallelCollScanMinRecords.load()) {
+        internalQueryParallelCollScanMaxWorkers.store(maxWorkers);
+        internalQueryParallelCollScanMinRecords.store(minRecords);
+    }
+
+    ~ParallelCollScanKnobs() {
+        internalQueryParallelCollScanMaxWorkers.store(_oldMaxWorkers);
+        internalQueryParallelCollScanMinRecords.store(_oldMinRecords);
+    }
+
+private:
+    const int _oldMaxWorkers;
+    const int _oldMinRecords;
+};
+
+// Every document is returned exactly once, whatever the number of threads.
+class QueryStageParallelCollscanReturnsEveryDocument : public QueryStageParallelCollectionScanBase {
+public:
+    void run() {
+        if (!canScanInParallel()) {
+            return;
+        }
+
+        vector<int> expected;
+        for (int i = 0; i < numObj(); ++i) {
+            expected.push_back(i);
+        }
+
+        for (size_t numWorkers : {1, 2, 4, 7}) {
+            ParallelCollectionScanStats stats;
+            ASSERT(expected == sorted(getFooValues(numWorkers, BSONObj(), 0, &stats)));
+            ASSERT_EQUALS(static_cast<size_t>(numObj()), stats.docsTested);
+            ASSERT_EQUALS(numWorkers, stats.numWorkers);
+            ASSERT_GREATER_THAN_OR_EQUALS(numWorkers, stats.numPartitions);
+            ASSERT_GREATER_THAN_OR_EQUALS(stats.numBatches, stats.numPartitions);
+        }
+    }
+};
+
+// The threads apply the filter.
+class QueryStageParallelCollscanFilters : public QueryStageParallelCollectionScanBase {
+public:
+    void run() {
+        if (!canScanInParallel()) {
+            return;
+        }
+
+        const BSONObj filter = BSON("bar" << BSON("$lt" << 3));
+        vector<int> expected;
+        for (int i = 0; i < numObj(); ++i) {
+            if (i % 10 < 3) {
+                expected.push_back(i);
+            }
+        }
+
+        ASSERT(expected == sorted(getFooValues(4, filter, 0)));
+        ASSERT(expected == sorted(getFooValues(4, filter, 64)));
+        ASSERT(getFooValues(4, BSON("bar" << 10), 64).empty());
+    }
+};
+
+// Documents removed while the collection is being scanned may or may not be returned, but every
+// other document is returned exactly once.
+class QueryStageParallelCollscanRemoveDuringScan : public QueryStageParallelCollectionScanBase {
+public:
+    void run() {
+        if (!canScanInParallel()) {
+            return;
+        }
+
+        OldClientWriteContext ctx(&_txn, nss.ns());
+        WorkingSet ws;
+        auto scan = make_unique<ParallelCollectionScan>(
+            &_txn, ctx.getCollection(), 4, &ws, BSONObj(), nullptr);
+
+        vector<int> values;
+        bool removed = false;
+        while (!scan->isEOF()) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            PlanStage::StageState state = scan->work(&id);
+            ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+            if (PlanStage::ADVANCED != state) {
+                continue;
+            }
+            values.push_back(ws.get(id)->obj.value()["foo"].numberInt());
+            ws.free(id);
+
+            if (!removed) {
+                // Remove every third document, including some each thread has yet to read.
+                _client.remove(nss.ns(), BSON("foo" << BSON("$mod" << BSON_ARRAY(3 << 0))));
+                removed = true;
+            }
+        }
+
+        std::set<int> returned;
+        for (int value : values) {
+            ASSERT(returned.insert(value).second);
+        }
+        for (int i = 0; i < numObj(); ++i) {
+            if (i % 3 != 0) {
+                ASSERT_EQUALS(1U, returned.count(i));
+            }
+        }
+    }
+};
+
+// Queries answered by a collection scan alone use the stage when the knobs allow it, unless they
+// depend on the order of the collection or are not yielded automatically.
+class QueryStageParallelCollscanPlanned : public QueryStageParallelCollectionScanBase {
+public:
+    void run() {
+        if (!canScanInParallel()) {
+            return;
+        }
+
+        {
+            ParallelCollScanKnobs knobs(4, 0);
+            ASSERT_EQUALS("PARALLEL_COLLSCAN", getPlanSummary(BSON("bar" << 3), BSONObj()));
+            ASSERT_EQUALS("COLLSCAN", getPlanSummary(BSON("bar" << 3), BSON("$natural" << 1)));
+            ASSERT_EQUALS("COLLSCAN",
+                          getPlanSummary(BSON("bar" << 3), BSONObj(), PlanExecutor::YIELD_MANUAL));
+        }
+        {
+            ParallelCollScanKnobs knobs(4, numObj() + 1);
+            ASSERT_EQUALS("COLLSCAN", getPlanSummary(BSON("bar" << 3), BSONObj()));
+        }
+        {
+            ParallelCollScanKnobs knobs(1, 0);
+            ASSERT_EQUALS("COLLSCAN", getPlanSummary(BSON("bar" << 3), BSONObj()));
+        }
+    }
+
+private:
+    std::string getPlanSummary(const BSONObj& filter,
+                               const BSONObj& sort,
+                               PlanExecutor::YieldPolicy yieldPolicy = PlanExecutor::YIELD_AUTO) {
+        AutoGetCollectionForRead ctx(&_txn, nss);
+
+        auto qr = make_unique<QueryRequest>(nss);
+        qr->setFilter(filter);
+        qr->setSort(sort);
+        auto cq = unittest::assertGet(CanonicalQuery::canonicalize(
+            &_txn, std::move(qr), ExtensionsCallbackDisallowExtensions()));
+        auto exec = unittest::assertGet(
+            getExecutorFind(&_txn, ctx.getCollection(), nss, std::move(cq), yieldPolicy));
+
+        size_t numResults = 0;
+        BSONObj obj;
+        while (PlanExecutor::ADVANCED == exec->getNext(&obj, nullptr)) {
+            ASSERT_EQUALS(3, obj["bar"].numberInt());
+            ++numResults;
+        }
+        ASSERT_EQUALS(static_cast<size_t>(numObj() / 10), numResults);
+        return Explain::getPlanSummary(exec.get());
+    }
+};
+
+class QueryStageParallelCollscanThroughput : public QueryStageParallelCollectionScanBase {
+public:
+    void run() {
+        if (!canScanInParallel()) {
+            return;
+        }
+
+        const int numDocs = 50000;
+        {
+            OldClientWriteContext ctx(&_txn, nss.ns());
+            for (int i = numObj(); i < numDocs; ++i) {
+                _client.insert(nss.ns(),
+                               BSON("foo" << i << "bar" << (i % 10) << "baz"
+                                          << "the quick brown fox jumps over the lazy dog"));
+            }
+        }
+        const BSONObj filter = BSON("bar" << BSON("$lt" << 5) << "baz" << BSON("$gt"
+                                                                              << "a"));
+
+        for (size_t numWorkers : {1, 2, 4, 8}) {
+            const int iterations = 3;
+            size_t numResults = 0;
+            Timer t;
+            for (int i = 0; i < iterations; ++i) {
+                numResults += getFooValues(numWorkers, filter, 64).size();
+            }
+            const long long micros = std::max(t.micros(), 1LL);
+            unittest::log() << "parallel collection scan, " << numWorkers << " threads: "
+                            << (numDocs * iterations * 1000000LL / micros)
+                            << " docs scanned/sec, " << numResults / iterations
+                            << " results per scan";
+        }
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("QueryStageParallelCollectionScan") {}
+
+    void setupTests() {
+        add<QueryStageParallelCollscanReturnsEveryDocument>();
+        add<QueryStageParallelCollscanFilters>();
+        add<QueryStageParallelCollscanRemoveDuringScan>();
+        add<QueryStageParallelCollscanPlanned>();
+        add<QueryStageParallelCollscanThroughput>();
+    }
+};
+
+SuiteInstance<All> all;
+}  // namespace QueryStageParallelCollectionScan
@@ -0,0 +1,232 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#include "bongo/platform/basic.h"
+
+#include "bongo/client/dbclientcursor.h"
+#include "bongo/db/catalog/collection.h"
+#include "bongo/db/catalog/database.h"
+#include "bongo/db/client.h"
+#include "bongo/db/db_raii.h"
+#include "bongo/db/dbdirectclient.h"
+#include "bongo/db/exec/plan_stage.h"
+#include "bongo/db/exec/skip_scan.h"
+#include "bongo/db/json.h"
+#include "bongo/db/namespace_string.h"
+#include "bongo/db/query/index_bounds_builder.h"
+#include "bongo/db/query/query_knobs.h"
+#include "bongo/dbtests/dbtests.h"
+#include "bongo/util/scopeguard.h"
+
+/**
+ * This file tests db/exec/skip_scan.cpp
+ */
+
+namespace QueryStageSkipScan {
+
+static const NamespaceString nss{"unittests.QueryStageSkipScan"};
+
+class SkipScanBase {
+public:
+    SkipScanBase() : _client(&_txn) {}
+
+    virtual ~SkipScanBase() {
+        _client.dropCollection(nss.ns());
+    }
+
+    void addIndex(const BSONObj& obj) {
+        ASSERT_OK(dbtests::createIndex(&_txn, nss.ns(), obj));
+    }
+
+    void insert(const BSONObj& obj) {
+        _client.insert(nss.ns(), obj);
+    }
+
+    /**
+     * Returns params for a skip scan over the index {a: 1, b: 1} with 'bOil' as the bounds on
+     * 'b'.
+     */
+    SkipScanParams makeParams(Collection* coll, const OrderedIntervalList& bOil) {
+        std::vector<IndexDescriptor*> indexes;
+        coll->getIndexCatalog()->findIndexesByKeyPattern(
+            &_txn, BSON("a" << 1 << "b" << 1), false, &indexes);
+        ASSERT_EQ(1U, indexes.size());
+
+        SkipScanParams params;
+        params.descriptor = indexes[0];
+        params.prefixLen = 1;
+        params.bounds.isSimpleRange = false;
+
+        OrderedIntervalList aOil{"a"};
+        aOil.intervals.push_back(IndexBoundsBuilder::allValues());
+        params.bounds.fields.push_back(aOil);
+        params.bounds.fields.push_back(bOil);
+        return params;
+    }
+
+    /**
+     * Works 'stage' to EOF and returns the {a, b} pairs of the keys it returns.
+     */
+    static std::vector<std::pair<int, int>> getResults(const WorkingSet& ws, SkipScan* stage) {
+        std::vector<std::pair<int, int>> results;
+        WorkingSetID wsid;
+        PlanStage::StageState state;
+        while (PlanStage::IS_EOF != (state = stage->work(&wsid))) {
+            ASSERT_NE(PlanStage::FAILURE, state);
+            ASSERT_NE(PlanStage::DEAD, state);
+            if (PlanStage::ADVANCED == state) {
+                WorkingSetMember* member = ws.get(wsid);
+                ASSERT_FALSE(member->hasObj());
+                BSONElement a;
+                BSONElement b;
+                ASSERT_TRUE(member->getFieldDotted("a", &a));
+                ASSERT_TRUE(member->getFieldDotted("b", &b));
+                results.emplace_back(a.numberInt(), b.numberInt());
+            }
+        }
+        return results;
+    }
+
+protected:
+    const ServiceContext::UniqueOperationContext _txnPtr = cc().makeOperationContext();
+    OperationContext& _txn = *_txnPtr;
+
+private:
+    DBDirectClient _client;
+};
+
+// Returns only the keys whose trailing field is within the bounds, in index order.
+class QueryStageSkipScanBasic : public SkipScanBase {
+public:
+    void run() {
+        for (int a = 0; a < 10; ++a) {
+            for (int b = 0; b < 100; ++b) {
+                insert(BSON("a" << a << "b" << b));
+            }
+        }
+        addIndex(BSON("a" << 1 << "b" << 1));
+
+        AutoGetCollectionForRead ctx(&_txn, nss);
+        Collection* coll = ctx.getCollection();
+
+        OrderedIntervalList bOil{"b"};
+        bOil.intervals.push_back(Interval(BSON("" << 50 << "" << 51), true, true));
+        bOil.intervals.push_back(Interval(BSON("" << 90 << "" << 90), true, true));
+
+        WorkingSet ws;
+        SkipScan skipScan(&_txn, makeParams(coll, bOil), &ws);
+        auto results = getResults(ws, &skipScan);
+
+        ASSERT_EQUALS(30U, results.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            ASSERT_EQUALS(static_cast<int>(i / 3), results[i].first);
+            ASSERT_EQUALS(i % 3 == 2 ? 90 : 50 + static_cast<int>(i % 3), results[i].second);
+        }
+
+        // Under each value of 'a' we examine the keys we return, the first key past each
+        // interval and the first key of the next value of 'a', but none of the others.
+        const SkipScanStats* stats = static_cast<const SkipScanStats*>(skipScan.getSpecificStats());
+        ASSERT_LESS_THAN_OR_EQUALS(stats->keysExamined, 30U + 3 * 10U);
+        ASSERT_GREATER_THAN_OR_EQUALS(stats->prefixesSkipped, 9U);
+    }
+};
+
+// Values of the leading field with no keys within the bounds produce no results.
+class QueryStageSkipScanSparseMatches : public SkipScanBase {
+public:
+    void run() {
+        for (int a = 0; a < 10; ++a) {
+            for (int b = 0; b < 10; ++b) {
+                insert(BSON("a" << a << "b" << (a % 2 ? b + 100 : b)));
+            }
+        }
+        addIndex(BSON("a" << 1 << "b" << 1));
+
+        AutoGetCollectionForRead ctx(&_txn, nss);
+        Collection* coll = ctx.getCollection();
+
+        OrderedIntervalList bOil{"b"};
+        bOil.intervals.push_back(Interval(BSON("" << 100 << "" << 101), true, false));
+
+        WorkingSet ws;
+        SkipScan skipScan(&_txn, makeParams(coll, bOil), &ws);
+        auto results = getResults(ws, &skipScan);
+
+        ASSERT_EQUALS(5U, results.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            ASSERT_EQUALS(static_cast<int>(2 * i + 1), results[i].first);
+            ASSERT_EQUALS(100, results[i].second);
+        }
+    }
+};
+
+// With skip scans enabled, the plan executor picks one for a predicate on the trailing field alone.
+class QueryStageSkipScanPlanned : public SkipScanBase {
+public:
+    void run() {
+        const bool oldEnableSkipScan = internalQueryPlannerEnableSkipScan.load();
+        ON_BLOCK_EXIT(
+            [oldEnableSkipScan] { internalQueryPlannerEnableSkipScan.store(oldEnableSkipScan); });
+        internalQueryPlannerEnableSkipScan.store(true);
+
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 1000; ++b) {
+                insert(BSON("a" << a << "b" << b));
+            }
+        }
+        addIndex(BSON("a" << 1 << "b" << 1));
+
+        DBDirectClient client(&_txn);
+        BSONObj explain;
+        ASSERT_TRUE(client.runCommand(
+            nss.db().toString(),
+            BSON("explain" << BSON("find" << nss.coll() << "filter" << BSON("b" << 7))),
+            explain));
+
+        BSONObj winningPlan = explain["queryPlanner"]["winningPlan"].Obj();
+        ASSERT_EQUALS("FETCH", winningPlan["stage"].String());
+        ASSERT_EQUALS("SKIP_SCAN", winningPlan["inputStage"]["stage"].String());
+        ASSERT_EQUALS(1, winningPlan["inputStage"]["prefixLength"].numberInt());
+
+        ASSERT_EQUALS(3U, client.count(nss.ns(), BSON("b" << 7)));
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("query_stage_skip_scan") {}
+
+    void setupTests() {
+        add<QueryStageSkipScanBasic>();
+        add<QueryStageSkipScanSparseMatches>();
+        add<QueryStageSkipScanPlanned>();
+    }
+};
+
+SuiteInstance<All> queryStageSkipScanAll;
+
+}  // namespace QueryStageSkipScan
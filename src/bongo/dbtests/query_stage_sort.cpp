@@ -513,6 +513,72 @@ public:
     }
 };
 
+// A document read again after its RecordId was invalidated, as when an update moves it ahead of an
+// index scan, keeps its RecordId. The copy read before the invalidation is returned without it.
+class QueryStageSortInvalidationBeforeReread : public QueryStageSortTestBase {
+public:
+    virtual int numObj() {
+        return 1;
+    }
+
+    void run() {
+        OldClientWriteContext ctx(&_txn, ns());
+        Database* db = ctx.db();
+        Collection* coll = db->getCollection(ns());
+        if (!coll) {
+            WriteUnitOfWork wuow(&_txn);
+            coll = db->createCollection(&_txn, ns());
+            wuow.commit();
+        }
+        fillData();
+
+        set<RecordId> recordIds;
+        getRecordIds(&recordIds, coll);
+        const RecordId recordId = *recordIds.begin();
+
+        WorkingSet ws;
+        auto queuedDataStage = make_unique<QueuedDataStage>(&_txn, &ws);
+        for (int foo : {2, 1}) {
+            WorkingSetID id = ws.allocate();
+            WorkingSetMember* member = ws.get(id);
+            member->recordId = recordId;
+            member->obj = Snapshotted<BSONObj>(SnapshotId(), BSON("foo" << foo));
+            ws.transitionToRecordIdAndObj(id);
+            queuedDataStage->pushBack(id);
+        }
+
+        SortStageParams params;
+        params.collection = coll;
+        params.pattern = BSON("foo" << 1);
+        auto keyGenStage = make_unique<SortKeyGeneratorStage>(
+            &_txn, queuedDataStage.release(), &ws, params.pattern, BSONObj(), nullptr);
+        SortStage sortStage(&_txn, params, &ws, keyGenStage.release());
+
+        // Buffer the first copy, once the sort key generator is set up, then invalidate it before
+        // the second copy is read.
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        ASSERT_EQUALS(PlanStage::NEED_TIME, sortStage.work(&id));
+        ASSERT_EQUALS(PlanStage::NEED_TIME, sortStage.work(&id));
+        sortStage.invalidate(&_txn, recordId, INVALIDATION_MUTATION);
+
+        std::vector<WorkingSetMember*> results;
+        while (!sortStage.isEOF()) {
+            id = WorkingSet::INVALID_ID;
+            if (PlanStage::ADVANCED == sortStage.work(&id)) {
+                results.push_back(ws.get(id));
+            }
+        }
+
+        ASSERT_EQUALS(2U, results.size());
+        ASSERT_EQUALS(1, results[0]->obj.value()["foo"].numberInt());
+        ASSERT_TRUE(results[0]->hasRecordId());
+        ASSERT_EQUALS(2, results[1]->obj.value()["foo"].numberInt());
+        ASSERT_FALSE(results[1]->hasRecordId());
+        ASSERT_EQUALS(
+            1U, static_cast<const SortStats*>(sortStage.getSpecificStats())->forcedFetches);
+    }
+};
+
 // Should error out if we sort with parallel arrays.
 class QueryStageSortParallelArrays : public QueryStageSortTestBase {
 public:
@@ -590,6 +656,7 @@ public:
         add<QueryStageSortDeletionInvalidation>();
         add<QueryStageSortDeletionInvalidationWithLimit<10>>();
         add<QueryStageSortDeletionInvalidationWithLimit<1>>();
+        add<QueryStageSortInvalidationBeforeReread>();
         add<QueryStageSortParallelArrays>();
     }
 };
@@ -732,6 +732,51 @@ public:
     }
 };
 
+/**
+ * A filter on a path of a multikey index that no document holds an array at is answered from the
+ * index keys, without fetching the documents; one on the path that does hold arrays is not.
+ */
+class CoveredFilterOnMultikeyIndexExplain : public ClientBase {
+public:
+    ~CoveredFilterOnMultikeyIndexExplain() {
+        _client.dropCollection(ns());
+    }
+    void run() {
+        ASSERT_OK(dbtests::createIndex(&_txn, ns(), BSON("a" << 1 << "tags" << 1)));
+        for (int i = 0; i < 10; ++i) {
+            insert(ns(), BSON("a" << i << "tags" << BSON_ARRAY(i << i + 1)));
+        }
+
+        // Covered: only 'a' is filtered on and returned, and 'a' is never an array.
+        BSONObj fields = BSON("_id" << 0 << "a" << 1);
+        BSONObj explainObj = explain(BSON("a" << BSON("$mod" << BSON_ARRAY(2 << 0))), &fields);
+        BSONObj winningPlan = explainObj["queryPlanner"]["winningPlan"].Obj();
+        ASSERT_EQUALS("PROJECTION", winningPlan.getStringField("stage"));
+        ASSERT_EQUALS("IXSCAN", winningPlan["inputStage"]["stage"].str());
+        BSONObj execStats = explainObj["executionStats"].Obj();
+        ASSERT_EQUALS(5, execStats.getIntField("nReturned"));
+        ASSERT_EQUALS(0, execStats.getIntField("totalDocsExamined"));
+
+        // Not covered: 'tags' holds arrays, so the index keys alone cannot answer the filter.
+        explainObj = explain(BSON("tags" << BSON("$mod" << BSON_ARRAY(2 << 0))), &fields);
+        execStats = explainObj["executionStats"].Obj();
+        ASSERT_EQUALS(10, execStats.getIntField("nReturned"));
+        ASSERT_EQUALS(10, execStats.getIntField("totalDocsExamined"));
+    }
+
+private:
+    static const char* ns() {
+        return "unittests.querytests.CoveredFilterOnMultikeyIndexExplain";
+    }
+
+    BSONObj explain(const BSONObj& filter, const BSONObj* fields) {
+        unique_ptr<DBClientCursor> c = _client.query(
+            ns(), Query(filter).hint(BSON("a" << 1 << "tags" << 1)).explain(), 0, 0, fields);
+        ASSERT(c->more());
+        return c->next().getOwned();
+    }
+};
+
 class BasicCount : public ClientBase {
 public:
     ~BasicCount() {
@@ -1777,6 +1822,7 @@ public:
         add<OplogReplayMode>();
         add<OplogReplaySlaveReadTill>();
         add<OplogReplayExplain>();
+        add<CoveredFilterOnMultikeyIndexExplain>();
         add<ArrayId>();
         add<UnderscoreNs>();
         add<EmptyFieldSpec>();
@@ -304,6 +304,7 @@ void AsyncMockStreamFactory::MockStream::simulateServer(
     replyBuilder->setMetadata(resp.metadata);
 
     auto replyMsg = replyBuilder->done();
+    replyMsg.flatten();
     replyMsg.header().setResponseToMsgId(messageId);
 
     {
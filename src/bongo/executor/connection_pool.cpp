@@ -39,9 +39,10 @@
 #include "bongo/util/destructor_guard.h"
 #include "bongo/util/log.h"
 #include "bongo/util/scopeguard.h"
+#include "bongo/util/timer.h"
 
 // One interesting implementation note herein concerns how setup() and
-// refresh() are invoked outside of the global lock, but setTimeout is not.
+// refresh() are invoked outside of the specific pool's lock, but setTimeout is not.
 // This implementation detail simplifies mocks, allowing them to return
 // synchronously sometimes, whereas having timeouts fire instantly adds little
 // value. In practice, dumping the locks is always safe (because we restrict
@@ -63,8 +64,24 @@ public:
     ~SpecificPool();
 
     /**
-     * Gets a connection from the specific pool. Sinks a unique_lock from the
-     * parent to preserve the lock on _mutex
+     * Acquires the lock on _mutex, recording whether (and for how long) we had
+     * to wait for it.
+     */
+    stdx::unique_lock<stdx::mutex> lock();
+
+    /**
+     * Returns true once the pool has shut down and left its parent's map. A
+     * caller that found the pool just before that must look it up again.
+     */
+    bool isShutDown(const stdx::unique_lock<stdx::mutex>& lk) const;
+
+    const HostAndPort& getHostAndPort() const {
+        return _hostAndPort;
+    }
+
+    /**
+     * Gets a connection from the specific pool. Sinks a unique_lock to
+     * preserve the lock on _mutex
      */
     void getConnection(const HostAndPort& hostAndPort,
                        Milliseconds timeout,
@@ -79,43 +96,44 @@ public:
     void processFailure(const Status& status, stdx::unique_lock<stdx::mutex> lk);
 
     /**
-     * Returns a connection to a specific pool. Sinks a unique_lock from the
-     * parent to preserve the lock on _mutex
+     * Returns a connection to a specific pool.
      */
-    void returnConnection(ConnectionInterface* connection, stdx::unique_lock<stdx::mutex> lk);
+    void returnConnection(ConnectionInterface* connection);
 
     /**
-     * Returns the number of connections currently checked out of the pool.
+     * Returns a connection to a specific pool. Sinks a unique_lock to
+     * preserve the lock on _mutex
      */
-    size_t inUseConnections(const stdx::unique_lock<stdx::mutex>& lk);
-
-    /**
-     * Returns the number of available connections in the pool.
-     */
-    size_t availableConnections(const stdx::unique_lock<stdx::mutex>& lk);
-
-    /**
-     * Returns the number of in progress connections in the pool.
-     */
-    size_t refreshingConnections(const stdx::unique_lock<stdx::mutex>& lk);
+    void returnConnection(ConnectionInterface* connection, stdx::unique_lock<stdx::mutex> lk);
 
     /**
-     * Returns the total number of connections ever created in this pool.
+     * Returns the connection counts and contention statistics of the pool.
      */
-    size_t createdConnections(const stdx::unique_lock<stdx::mutex>& lk);
+    ConnectionStatsPer getStats(const stdx::unique_lock<stdx::mutex>& lk);
 
 private:
     using OwnedConnection = std::unique_ptr<ConnectionInterface>;
     using OwnershipPool = stdx::unordered_map<ConnectionInterface*, OwnedConnection>;
-    using Request = std::pair<Date_t, GetConnectionCallback>;
+    struct Request {
+        Date_t expiration;
+        uint64_t requestedAtMicros;
+        GetConnectionCallback cb;
+    };
     struct RequestComparator {
         bool operator()(const Request& a, const Request& b) {
-            return a.first > b.first;
+            return a.expiration > b.expiration;
         }
     };
 
     void addToReady(stdx::unique_lock<stdx::mutex>& lk, OwnedConnection conn);
 
+    /**
+     * Checks out 'conn' and passes it to 'cb'. Returns with the lock released.
+     */
+    void handOut(stdx::unique_lock<stdx::mutex>& lk,
+                 OwnedConnection conn,
+                 GetConnectionCallback cb);
+
     void fulfillRequests(stdx::unique_lock<stdx::mutex>& lk);
 
     void spawnConnections(stdx::unique_lock<stdx::mutex>& lk);
@@ -132,6 +150,8 @@ private:
 
     const HostAndPort _hostAndPort;
 
+    stdx::mutex _mutex;
+
     OwnershipPool _readyPool;
     OwnershipPool _processingPool;
     OwnershipPool _droppedProcessingPool;
@@ -147,6 +167,11 @@ private:
 
     size_t _created;
 
+    size_t _lockAcquisitions;
+    size_t _contendedLockAcquisitions;
+    ConnectionWaitHistogram _lockWaitMicros;
+    ConnectionWaitHistogram _connectionWaitMicros;
+
     /**
      * The current state of the pool
      *
@@ -168,6 +193,9 @@ private:
         // hostTimeout is passed, we're waiting for any processing
         // connections to finish before shutting down
         kInShutdown,
+
+        // The pool has been removed from its parent and must not be used
+        kShutDown,
     };
 
     State _state;
@@ -189,63 +217,86 @@ ConnectionPool::ConnectionPool(std::unique_ptr<DependentTypeFactoryInterface> im
 
 ConnectionPool::~ConnectionPool() = default;
 
+ConnectionPool::PoolStripe& ConnectionPool::stripeFor(const HostAndPort& hostAndPort) const {
+    return _stripes[BONGO_HASH_NAMESPACE::hash<HostAndPort>()(hostAndPort) % kNumStripes];
+}
+
 void ConnectionPool::dropConnections(const HostAndPort& hostAndPort) {
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    std::shared_ptr<SpecificPool> pool;
+    {
+        auto& stripe = stripeFor(hostAndPort);
+        stdx::lock_guard<stdx::mutex> stripeLk(stripe.mutex);
 
-    auto iter = _pools.find(hostAndPort);
+        auto iter = stripe.pools.find(hostAndPort);
 
-    if (iter == _pools.end())
+        if (iter == stripe.pools.end())
+            return;
+
+        pool = iter->second;
+    }
+
+    auto lk = pool->lock();
+    if (pool->isShutDown(lk))
         return;
 
-    iter->second.get()->processFailure(
-        Status(ErrorCodes::PooledConnectionsDropped, "Pooled connections dropped"), std::move(lk));
+    pool->processFailure(Status(ErrorCodes::PooledConnectionsDropped, "Pooled connections dropped"),
+                         std::move(lk));
 }
 
 void ConnectionPool::get(const HostAndPort& hostAndPort,
                          Milliseconds timeout,
                          GetConnectionCallback cb) {
-    SpecificPool* pool;
+    auto& stripe = stripeFor(hostAndPort);
 
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    while (true) {
+        std::shared_ptr<SpecificPool> pool;
+        {
+            stdx::lock_guard<stdx::mutex> stripeLk(stripe.mutex);
 
-    auto iter = _pools.find(hostAndPort);
+            auto& slot = stripe.pools[hostAndPort];
+            if (!slot) {
+                slot = std::make_shared<SpecificPool>(this, hostAndPort);
+            }
+            pool = slot;
+        }
 
-    if (iter == _pools.end()) {
-        auto handle = stdx::make_unique<SpecificPool>(this, hostAndPort);
-        pool = handle.get();
-        _pools[hostAndPort] = std::move(handle);
-    } else {
-        pool = iter->second.get();
-    }
+        invariant(pool);
 
-    invariant(pool);
+        auto lk = pool->lock();
 
-    pool->getConnection(hostAndPort, timeout, std::move(lk), std::move(cb));
+        // The pool shut down between our finding it and locking it, so it's
+        // no longer in the map. Look again.
+        if (pool->isShutDown(lk))
+            continue;
+
+        pool->getConnection(hostAndPort, timeout, std::move(lk), std::move(cb));
+        return;
+    }
 }
 
 void ConnectionPool::appendConnectionStats(ConnectionPoolStats* stats) const {
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    for (auto& stripe : _stripes) {
+        std::vector<std::shared_ptr<SpecificPool>> pools;
+        {
+            stdx::lock_guard<stdx::mutex> stripeLk(stripe.mutex);
+            for (const auto& kv : stripe.pools) {
+                pools.push_back(kv.second);
+            }
+        }
 
-    for (const auto& kv : _pools) {
-        HostAndPort host = kv.first;
+        for (const auto& pool : pools) {
+            auto lk = pool->lock();
+            if (pool->isShutDown(lk))
+                continue;
 
-        auto& pool = kv.second;
-        ConnectionStatsPer hostStats{pool->inUseConnections(lk),
-                                     pool->availableConnections(lk),
-                                     pool->createdConnections(lk),
-                                     pool->refreshingConnections(lk)};
-        stats->updateStatsForHost(_name, host, hostStats);
+            stats->updateStatsForHost(_name, pool->getHostAndPort(), pool->getStats(lk));
+        }
     }
 }
 
-void ConnectionPool::returnConnection(ConnectionInterface* conn) {
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-
-    auto iter = _pools.find(conn->getHostAndPort());
-
-    invariant(iter != _pools.end());
-
-    iter->second.get()->returnConnection(conn, std::move(lk));
+void ConnectionPool::ConnectionHandleDeleter::operator()(ConnectionInterface* connection) {
+    if (_pool && connection)
+        _pool->returnConnection(connection);
 }
 
 ConnectionPool::SpecificPool::SpecificPool(ConnectionPool* parent, const HostAndPort& hostAndPort)
@@ -256,28 +307,40 @@ ConnectionPool::SpecificPool::SpecificPool(ConnectionPool* parent, const HostAnd
       _inFulfillRequests(false),
       _inSpawnConnections(false),
       _created(0),
+      _lockAcquisitions(0),
+      _contendedLockAcquisitions(0),
       _state(State::kRunning) {}
 
 ConnectionPool::SpecificPool::~SpecificPool() {
     DESTRUCTOR_GUARD(_requestTimer->cancelTimeout();)
 }
 
-size_t ConnectionPool::SpecificPool::inUseConnections(const stdx::unique_lock<stdx::mutex>& lk) {
-    return _checkedOutPool.size();
+stdx::unique_lock<stdx::mutex> ConnectionPool::SpecificPool::lock() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex, stdx::try_to_lock);
+    if (!lk.owns_lock()) {
+        // Only time the wait when there is one, to keep the uncontended path cheap.
+        Timer timer;
+        lk.lock();
+        _contendedLockAcquisitions++;
+        _lockWaitMicros.record(timer.micros());
+    }
+    _lockAcquisitions++;
+    return lk;
 }
 
-size_t ConnectionPool::SpecificPool::availableConnections(
-    const stdx::unique_lock<stdx::mutex>& lk) {
-    return _readyPool.size();
+bool ConnectionPool::SpecificPool::isShutDown(const stdx::unique_lock<stdx::mutex>& lk) const {
+    return _state == State::kShutDown;
 }
 
-size_t ConnectionPool::SpecificPool::refreshingConnections(
+ConnectionStatsPer ConnectionPool::SpecificPool::getStats(
     const stdx::unique_lock<stdx::mutex>& lk) {
-    return _processingPool.size();
-}
-
-size_t ConnectionPool::SpecificPool::createdConnections(const stdx::unique_lock<stdx::mutex>& lk) {
-    return _created;
+    ConnectionStatsPer stats{
+        _checkedOutPool.size(), _readyPool.size(), _created, _processingPool.size()};
+    stats.lockAcquisitions = _lockAcquisitions;
+    stats.contendedLockAcquisitions = _contendedLockAcquisitions;
+    stats.lockWaitMicros = _lockWaitMicros;
+    stats.connectionWaitMicros = _connectionWaitMicros;
+    return stats;
 }
 
 void ConnectionPool::SpecificPool::getConnection(const HostAndPort& hostAndPort,
@@ -288,9 +351,21 @@ void ConnectionPool::SpecificPool::getConnection(const HostAndPort& hostAndPort,
         timeout = _parent->_options.refreshTimeout;
     }
 
+    // Fast path: with nothing queued ahead of us, a healthy ready connection
+    // can be handed out directly, without queueing a request and arming the
+    // request timer for it.
+    if (_requests.empty() && !_readyPool.empty() && _readyPool.begin()->second->isHealthy()) {
+        auto conn = takeFromPool(_readyPool, _readyPool.begin()->first);
+        conn->cancelTimeout();
+        _connectionWaitMicros.record(0);
+        handOut(lk, std::move(conn), std::move(cb));
+        return;
+    }
+
+    const auto requestedAtMicros = curTimeMicros64();
     const auto expiration = _parent->_factory->now() + timeout;
 
-    _requests.push(make_pair(expiration, std::move(cb)));
+    _requests.push(Request{expiration, requestedAtMicros, std::move(cb)});
 
     updateStateInLock();
 
@@ -298,6 +373,10 @@ void ConnectionPool::SpecificPool::getConnection(const HostAndPort& hostAndPort,
     fulfillRequests(lk);
 }
 
+void ConnectionPool::SpecificPool::returnConnection(ConnectionInterface* connPtr) {
+    returnConnection(connPtr, lock());
+}
+
 void ConnectionPool::SpecificPool::returnConnection(ConnectionInterface* connPtr,
                                                     stdx::unique_lock<stdx::mutex> lk) {
     auto needsRefreshTP = connPtr->getLastUsed() + _parent->_options.refreshRequirement;
@@ -338,7 +417,7 @@ void ConnectionPool::SpecificPool::returnConnection(ConnectionInterface* connPtr
                          [this](ConnectionInterface* connPtr, Status status) {
                              connPtr->indicateUsed();
 
-                             stdx::unique_lock<stdx::mutex> lk(_parent->_mutex);
+                             auto lk = lock();
 
                              auto conn = takeFromProcessingPool(connPtr);
 
@@ -390,7 +469,7 @@ void ConnectionPool::SpecificPool::addToReady(stdx::unique_lock<stdx::mutex>& lk
     connPtr->setTimeout(_parent->_options.refreshRequirement, [this, connPtr]() {
         OwnedConnection conn;
 
-        stdx::unique_lock<stdx::mutex> lk(_parent->_mutex);
+        auto lk = lock();
 
         if (!_readyPool.count(connPtr)) {
             // We've already been checked out. We don't need to refresh
@@ -446,7 +525,7 @@ void ConnectionPool::SpecificPool::processFailure(const Status& status,
     lk.unlock();
 
     while (requestsToFail.size()) {
-        requestsToFail.top().second(status);
+        requestsToFail.top().cb(status);
         requestsToFail.pop();
     }
 }
@@ -488,22 +567,29 @@ void ConnectionPool::SpecificPool::fulfillRequests(stdx::unique_lock<stdx::mutex
         }
 
         // Grab the request and callback
-        auto cb = std::move(_requests.top().second);
+        auto cb = std::move(_requests.top().cb);
+        _connectionWaitMicros.record(curTimeMicros64() - _requests.top().requestedAtMicros);
         _requests.pop();
 
-        auto connPtr = conn.get();
+        handOut(lk, std::move(conn), std::move(cb));
+        lk.lock();
+    }
+}
+
+void ConnectionPool::SpecificPool::handOut(stdx::unique_lock<stdx::mutex>& lk,
+                                           OwnedConnection conn,
+                                           GetConnectionCallback cb) {
+    auto connPtr = conn.get();
 
-        // check out the connection
-        _checkedOutPool[connPtr] = std::move(conn);
+    // check out the connection
+    _checkedOutPool[connPtr] = std::move(conn);
 
-        updateStateInLock();
+    updateStateInLock();
 
-        // pass it to the user
-        connPtr->resetToUnknown();
-        lk.unlock();
-        cb(ConnectionHandle(connPtr, ConnectionHandleDeleter(_parent)));
-        lk.lock();
-    }
+    // pass it to the user
+    connPtr->resetToUnknown();
+    lk.unlock();
+    cb(ConnectionHandle(connPtr, ConnectionHandleDeleter(this)));
 }
 
 // spawn enough connections to satisfy open requests and minpool, while
@@ -546,7 +632,7 @@ void ConnectionPool::SpecificPool::spawnConnections(stdx::unique_lock<stdx::mute
             _parent->_options.refreshTimeout, [this](ConnectionInterface* connPtr, Status status) {
                 connPtr->indicateUsed();
 
-                stdx::unique_lock<stdx::mutex> lk(_parent->_mutex);
+                auto lk = lock();
 
                 auto conn = takeFromProcessingPool(connPtr);
 
@@ -574,7 +660,7 @@ void ConnectionPool::SpecificPool::spawnConnections(stdx::unique_lock<stdx::mute
 
 // Called every second after hostTimeout until all processing connections reap
 void ConnectionPool::SpecificPool::shutdown() {
-    stdx::unique_lock<stdx::mutex> lk(_parent->_mutex);
+    auto lk = lock();
 
     // We're racing:
     //
@@ -608,7 +694,26 @@ void ConnectionPool::SpecificPool::shutdown() {
     invariant(_requests.empty());
     invariant(_checkedOutPool.empty());
 
-    _parent->_pools.erase(_hostAndPort);
+    // Callers that found this pool before we leave the map will see kShutDown
+    // once they get the lock, and look again.
+    _state = State::kShutDown;
+    _readyPool.clear();
+    _requestTimer->cancelTimeout();
+
+    std::shared_ptr<SpecificPool> self;
+    {
+        auto& stripe = _parent->stripeFor(_hostAndPort);
+        stdx::lock_guard<stdx::mutex> stripeLk(stripe.mutex);
+
+        auto iter = stripe.pools.find(_hostAndPort);
+        invariant(iter != stripe.pools.end() && iter->second.get() == this);
+
+        self = std::move(iter->second);
+        stripe.pools.erase(iter);
+    }
+
+    // Dropping 'self' may destroy this pool, so release its mutex first.
+    lk.unlock();
 }
 
 ConnectionPool::SpecificPool::OwnedConnection ConnectionPool::SpecificPool::takeFromPool(
@@ -637,29 +742,29 @@ void ConnectionPool::SpecificPool::updateStateInLock() {
 
         // If we were already running and the timer is the same as it was
         // before, nothing to do
-        if (_state == State::kRunning && _requestTimerExpiration == _requests.top().first)
+        if (_state == State::kRunning && _requestTimerExpiration == _requests.top().expiration)
             return;
 
         _state = State::kRunning;
 
         _requestTimer->cancelTimeout();
 
-        _requestTimerExpiration = _requests.top().first;
+        _requestTimerExpiration = _requests.top().expiration;
 
-        auto timeout = _requests.top().first - _parent->_factory->now();
+        auto timeout = _requests.top().expiration - _parent->_factory->now();
 
         // We set a timer for the most recent request, then invoke each timed
         // out request we couldn't service
         _requestTimer->setTimeout(timeout, [this]() {
-            stdx::unique_lock<stdx::mutex> lk(_parent->_mutex);
+            auto lk = lock();
 
             auto now = _parent->_factory->now();
 
             while (_requests.size()) {
                 auto& x = _requests.top();
 
-                if (x.first <= now) {
-                    auto cb = std::move(x.second);
+                if (x.expiration <= now) {
+                    auto cb = std::move(x.cb);
                     _requests.pop();
 
                     lk.unlock();
@@ -677,6 +782,10 @@ void ConnectionPool::SpecificPool::updateStateInLock() {
         // If we have no requests, but someone's using a connection, we just
         // hang around until the next request or a return
 
+        // Nothing to do if that's already what we're doing
+        if (_state == State::kRunning && _requestTimerExpiration == Date_t::max())
+            return;
+
         _requestTimer->cancelTimeout();
         _state = State::kRunning;
         _requestTimerExpiration = _requestTimerExpiration.max();
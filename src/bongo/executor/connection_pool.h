@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <queue>
 
@@ -54,6 +55,11 @@ struct ConnectionPoolStats;
  *
  * The overall workflow here is to manage separate pools for each unique
  * HostAndPort. See comments on the various Options for how the pool operates.
+ *
+ * Each of those pools has its own lock, so work for one host never waits on
+ * another, and a connection is returned straight to the pool it came from.
+ * The pools themselves are found through a small number of independently
+ * locked stripes of the host map.
  */
 class ConnectionPool {
     class ConnectionHandleDeleter;
@@ -124,7 +130,14 @@ public:
     void appendConnectionStats(ConnectionPoolStats* stats) const;
 
 private:
-    void returnConnection(ConnectionInterface* connection);
+    static const size_t kNumStripes = 16;
+
+    struct PoolStripe {
+        stdx::mutex mutex;
+        stdx::unordered_map<HostAndPort, std::shared_ptr<SpecificPool>> pools;
+    };
+
+    PoolStripe& stripeFor(const HostAndPort& hostAndPort) const;
 
     std::string _name;
 
@@ -134,23 +147,24 @@ private:
 
     const std::unique_ptr<DependentTypeFactoryInterface> _factory;
 
-    // The global mutex for specific pool access and the generation counter
-    mutable stdx::mutex _mutex;
-    stdx::unordered_map<HostAndPort, std::unique_ptr<SpecificPool>> _pools;
+    // The specific pools, spread over stripes by host. A stripe's mutex only
+    // guards its map; everything else is guarded by each SpecificPool's own
+    // mutex. A SpecificPool may take its stripe's mutex while holding its own,
+    // never the other way around.
+    mutable std::array<PoolStripe, kNumStripes> _stripes;
 };
 
 class ConnectionPool::ConnectionHandleDeleter {
 public:
     ConnectionHandleDeleter() = default;
-    ConnectionHandleDeleter(ConnectionPool* pool) : _pool(pool) {}
+    ConnectionHandleDeleter(SpecificPool* pool) : _pool(pool) {}
 
-    void operator()(ConnectionInterface* connection) {
-        if (_pool && connection)
-            _pool->returnConnection(connection);
-    }
+    void operator()(ConnectionInterface* connection);
 
 private:
-    ConnectionPool* _pool = nullptr;
+    // A specific pool is never destroyed while any of its connections are
+    // checked out, so this stays valid for the life of the handle.
+    SpecificPool* _pool = nullptr;
 };
 
 /**
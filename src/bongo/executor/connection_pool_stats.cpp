@@ -30,12 +30,66 @@
 
 #include "bongo/executor/connection_pool_stats.h"
 
+#include <algorithm>
+
 #include "bongo/bson/bsonobjbuilder.h"
+#include "bongo/platform/bits.h"
 #include "bongo/util/map_util.h"
 
 namespace bongo {
 namespace executor {
 
+namespace {
+
+void appendContentionStats(const ConnectionStatsPer& stats, BSONObjBuilder* builder) {
+    if (stats.lockAcquisitions == 0) {
+        return;
+    }
+    builder->appendNumber("lockAcquisitions", stats.lockAcquisitions);
+    builder->appendNumber("contendedLockAcquisitions", stats.contendedLockAcquisitions);
+    {
+        BSONObjBuilder lockWait(builder->subobjStart("lockWaitMicros"));
+        stats.lockWaitMicros.appendToBSON(&lockWait);
+    }
+    {
+        BSONObjBuilder connectionWait(builder->subobjStart("connectionWaitMicros"));
+        stats.connectionWaitMicros.appendToBSON(&connectionWait);
+    }
+}
+
+}  // namespace
+
+void ConnectionWaitHistogram::record(uint64_t micros) {
+    const int bucket = micros == 0 ? 0 : 64 - countLeadingZeros64(micros);
+    buckets[std::min(bucket, kNumBuckets - 1)]++;
+    count++;
+    totalMicros += micros;
+}
+
+ConnectionWaitHistogram& ConnectionWaitHistogram::operator+=(
+    const ConnectionWaitHistogram& other) {
+    for (int i = 0; i < kNumBuckets; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    totalMicros += other.totalMicros;
+    return *this;
+}
+
+void ConnectionWaitHistogram::appendToBSON(BSONObjBuilder* builder) const {
+    builder->append("count", static_cast<long long>(count));
+    builder->append("totalMicros", static_cast<long long>(totalMicros));
+    BSONArrayBuilder histogram(builder->subarrayStart("histogram"));
+    for (int i = 0; i < kNumBuckets; ++i) {
+        if (buckets[i] == 0) {
+            continue;
+        }
+        BSONObjBuilder entry(histogram.subobjStart());
+        entry.append("micros", i == 0 ? 0LL : 1LL << (i - 1));
+        entry.append("count", static_cast<long long>(buckets[i]));
+    }
+}
+
 ConnectionStatsPer::ConnectionStatsPer(size_t nInUse,
                                        size_t nAvailable,
                                        size_t nCreated,
@@ -49,6 +103,10 @@ ConnectionStatsPer& ConnectionStatsPer::operator+=(const ConnectionStatsPer& oth
     available += other.available;
     created += other.created;
     refreshing += other.refreshing;
+    lockAcquisitions += other.lockAcquisitions;
+    contendedLockAcquisitions += other.contendedLockAcquisitions;
+    lockWaitMicros += other.lockWaitMicros;
+    connectionWaitMicros += other.connectionWaitMicros;
 
     return *this;
 }
@@ -66,6 +124,7 @@ void ConnectionPoolStats::updateStatsForHost(std::string pool,
     totalAvailable += newStats.available;
     totalCreated += newStats.created;
     totalRefreshing += newStats.refreshing;
+    totalContendedLockAcquisitions += newStats.contendedLockAcquisitions;
 }
 
 void ConnectionPoolStats::appendToBSON(bongo::BSONObjBuilder& result) {
@@ -73,6 +132,7 @@ void ConnectionPoolStats::appendToBSON(bongo::BSONObjBuilder& result) {
     result.appendNumber("totalAvailable", totalAvailable);
     result.appendNumber("totalCreated", totalCreated);
     result.appendNumber("totalRefreshing", totalRefreshing);
+    result.appendNumber("totalContendedLockAcquisitions", totalContendedLockAcquisitions);
 
     {
         BSONObjBuilder poolBuilder(result.subobjStart("pools"));
@@ -83,6 +143,7 @@ void ConnectionPoolStats::appendToBSON(bongo::BSONObjBuilder& result) {
             poolInfo.appendNumber("poolAvailable", poolStats.available);
             poolInfo.appendNumber("poolCreated", poolStats.created);
             poolInfo.appendNumber("poolRefreshing", poolStats.refreshing);
+            appendContentionStats(poolStats, &poolInfo);
             for (auto&& host : statsByPoolHost[pool.first]) {
                 BSONObjBuilder hostInfo(poolInfo.subobjStart(host.first.toString()));
                 auto hostStats = host.second;
@@ -102,6 +163,7 @@ void ConnectionPoolStats::appendToBSON(bongo::BSONObjBuilder& result) {
             hostInfo.appendNumber("available", hostStats.available);
             hostInfo.appendNumber("created", hostStats.created);
             hostInfo.appendNumber("refreshing", hostStats.refreshing);
+            appendContentionStats(hostStats, &hostInfo);
         }
     }
 }
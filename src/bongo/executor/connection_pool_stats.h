@@ -28,12 +28,40 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+
 #include "bongo/stdx/unordered_map.h"
 #include "bongo/util/net/hostandport.h"
 
 namespace bongo {
+
+class BSONObjBuilder;
+
 namespace executor {
 
+/**
+ * A histogram of wait times in microseconds. Bucket i counts waits in [2^(i-1), 2^i), with bucket
+ * 0 holding waits under a microsecond and the last bucket holding everything longer.
+ */
+struct ConnectionWaitHistogram {
+    static const int kNumBuckets = 32;
+
+    void record(uint64_t micros);
+
+    ConnectionWaitHistogram& operator+=(const ConnectionWaitHistogram& other);
+
+    /**
+     * Appends the count, the total wait, and the non-empty buckets, each labelled by its
+     * inclusive lower bound.
+     */
+    void appendToBSON(BSONObjBuilder* builder) const;
+
+    std::array<uint64_t, kNumBuckets> buckets{};
+    uint64_t count = 0u;
+    uint64_t totalMicros = 0u;
+};
+
 /**
  * Holds connection information for a specific pool or remote host. These objects are maintained by
  * a parent ConnectionPoolStats object and should not need to be created directly.
@@ -49,6 +77,14 @@ struct ConnectionStatsPer {
     size_t available = 0u;
     size_t created = 0u;
     size_t refreshing = 0u;
+
+    // Contention on the pool's lock. Only reported by pools that track it.
+    size_t lockAcquisitions = 0u;
+    size_t contendedLockAcquisitions = 0u;
+    ConnectionWaitHistogram lockWaitMicros;
+
+    // Time from a connection request to the connection being handed out.
+    ConnectionWaitHistogram connectionWaitMicros;
 };
 
 /**
@@ -65,6 +101,7 @@ struct ConnectionPoolStats {
     size_t totalAvailable = 0u;
     size_t totalCreated = 0u;
     size_t totalRefreshing = 0u;
+    size_t totalContendedLockAcquisitions = 0u;
 
     stdx::unordered_map<std::string, ConnectionStatsPer> statsByPool;
     stdx::unordered_map<HostAndPort, ConnectionStatsPer> statsByHost;
@@ -30,6 +30,7 @@
 #include "bongo/executor/connection_pool_test_fixture.h"
 
 #include "bongo/executor/connection_pool.h"
+#include "bongo/executor/connection_pool_stats.h"
 #include "bongo/stdx/future.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/unittest/unittest.h"
@@ -925,6 +926,54 @@ TEST_F(ConnectionPoolTest, RefreshTimeoutsDontTimeoutRequests) {
     ASSERT(!conn2);
 }
 
+/**
+ * Verify that the stats report how long requests waited for connections, and
+ * how often the pool's lock was taken.
+ */
+TEST_F(ConnectionPoolTest, StatsIncludeConnectionWaits) {
+    ConnectionPool pool(stdx::make_unique<PoolImpl>(), "test pool");
+
+    // The first get waits for setup, the second is served from the ready pool
+    ConnectionImpl::pushSetup(Status::OK());
+    for (int i = 0; i < 2; ++i) {
+        pool.get(HostAndPort(),
+                 Milliseconds(5000),
+                 [&](StatusWith<ConnectionPool::ConnectionHandle> swConn) {
+                     ASSERT(swConn.isOK());
+                     doneWith(swConn.getValue());
+                 });
+    }
+
+    ConnectionPoolStats stats;
+    pool.appendConnectionStats(&stats);
+
+    const auto& hostStats = stats.statsByHost[HostAndPort()];
+    ASSERT_EQ(1U, hostStats.available);
+    ASSERT_EQ(1U, hostStats.created);
+    ASSERT_EQ(2U, hostStats.connectionWaitMicros.count);
+    ASSERT_GTE(hostStats.lockAcquisitions, 2U);
+    ASSERT_EQ(0U, hostStats.contendedLockAcquisitions);
+}
+
+/**
+ * Verify that wait times land in power of two buckets.
+ */
+TEST(ConnectionWaitHistogramTest, Buckets) {
+    ConnectionWaitHistogram histogram;
+    histogram.record(0);
+    histogram.record(1);
+    histogram.record(3);
+    histogram.record(1000);
+    histogram.record(std::numeric_limits<uint64_t>::max());
+
+    ASSERT_EQ(1U, histogram.buckets[0]);
+    ASSERT_EQ(1U, histogram.buckets[1]);
+    ASSERT_EQ(1U, histogram.buckets[2]);
+    ASSERT_EQ(1U, histogram.buckets[10]);
+    ASSERT_EQ(1U, histogram.buckets[ConnectionWaitHistogram::kNumBuckets - 1]);
+    ASSERT_EQ(5U, histogram.count);
+}
+
 }  // namespace connection_pool_test_details
 }  // namespace executor
 }  // namespace bongo
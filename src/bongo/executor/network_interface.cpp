@@ -41,6 +41,15 @@ const unsigned int NetworkInterface::kMessagingPortKeepOpen;
 NetworkInterface::NetworkInterface() {}
 NetworkInterface::~NetworkInterface() {}
 
+std::vector<Status> NetworkInterface::startCommands(std::vector<CommandToStart>* commands) {
+    std::vector<Status> statuses;
+    statuses.reserve(commands->size());
+    for (auto&& command : *commands) {
+        statuses.push_back(startCommand(command.cbHandle, command.request, command.onFinish));
+    }
+    return statuses;
+}
+
 
 }  // namespace executor
 }  // namespace bongo
@@ -30,6 +30,7 @@
 
 #include <boost/optional.hpp>
 #include <string>
+#include <vector>
 
 #include "bongo/base/disallow_copying.h"
 #include "bongo/executor/task_executor.h"
@@ -130,6 +131,25 @@ public:
                                 RemoteCommandRequest& request,
                                 const RemoteCommandCompletionFn& onFinish) = 0;
 
+    /**
+     * A command to start, as passed to startCommands().
+     */
+    struct CommandToStart {
+        TaskExecutor::CallbackHandle cbHandle;
+        RemoteCommandRequest request;
+        RemoteCommandCompletionFn onFinish;
+    };
+
+    /**
+     * Starts asynchronous execution of each command in "commands", as if by calling
+     * startCommand() on each in order, and returns the status startCommand() would have returned
+     * for each. The requests are mutated as by startCommand().
+     *
+     * The default implementation starts the commands one at a time; implementations may instead
+     * register the whole batch at once.
+     */
+    virtual std::vector<Status> startCommands(std::vector<CommandToStart>* commands);
+
     /**
      * Requests cancelation of the network activity associated with "cbHandle" if it has not yet
      * completed.
@@ -178,6 +178,7 @@ void NetworkInterfaceASIO::shutdown() {
     for (auto&& worker : _serviceRunners) {
         worker.join();
     }
+    _shutdownPipelines();
     LOG(2) << "NetworkInterfaceASIO shutdown successfully";
 }
 
@@ -251,13 +252,40 @@ Status NetworkInterfaceASIO::startCommand(const TaskExecutor::CallbackHandle& cb
                                           RemoteCommandRequest& request,
                                           const RemoteCommandCompletionFn& onFinish) {
     BONGO_ASIO_INVARIANT(onFinish, "Invalid completion function");
-    {
+    if (!_isPipelining()) {
         stdx::lock_guard<stdx::mutex> lk(_inProgressMutex);
         const auto insertResult = _inGetConnection.emplace(cbHandle);
         // We should never see the same CallbackHandle added twice
         BONGO_ASIO_INVARIANT_INLOCK(insertResult.second, "Same CallbackHandle added twice");
     }
 
+    return _startRegisteredCommand(cbHandle, request, onFinish);
+}
+
+std::vector<Status> NetworkInterfaceASIO::startCommands(std::vector<CommandToStart>* commands) {
+    if (!_isPipelining()) {
+        // Register the whole batch under a single acquisition of _inProgressMutex.
+        stdx::lock_guard<stdx::mutex> lk(_inProgressMutex);
+        for (auto&& command : *commands) {
+            BONGO_ASIO_INVARIANT_INLOCK(command.onFinish, "Invalid completion function");
+            const auto insertResult = _inGetConnection.emplace(command.cbHandle);
+            // We should never see the same CallbackHandle added twice
+            BONGO_ASIO_INVARIANT_INLOCK(insertResult.second, "Same CallbackHandle added twice");
+        }
+    }
+
+    std::vector<Status> statuses;
+    statuses.reserve(commands->size());
+    for (auto&& command : *commands) {
+        statuses.push_back(
+            _startRegisteredCommand(command.cbHandle, command.request, command.onFinish));
+    }
+    return statuses;
+}
+
+Status NetworkInterfaceASIO::_startRegisteredCommand(const TaskExecutor::CallbackHandle& cbHandle,
+                                                     RemoteCommandRequest& request,
+                                                     const RemoteCommandCompletionFn& onFinish) {
     if (inShutdown()) {
         return {ErrorCodes::ShutdownInProgress, "NetworkInterfaceASIO shutdown in progress"};
     }
@@ -271,6 +299,10 @@ Status NetworkInterfaceASIO::startCommand(const TaskExecutor::CallbackHandle& cb
         return statusMetadata;
     }
 
+    if (_isPipelining()) {
+        return _startPipelinedCommand(cbHandle, request, onFinish);
+    }
+
     auto nextStep = [this, getConnectionStartTime, cbHandle, request, onFinish](
         StatusWith<ConnectionPool::ConnectionHandle> swConn) {
 
@@ -426,6 +458,13 @@ Status NetworkInterfaceASIO::startCommand(const TaskExecutor::CallbackHandle& cb
 }
 
 void NetworkInterfaceASIO::cancelCommand(const TaskExecutor::CallbackHandle& cbHandle) {
+    if (_isPipelining()) {
+        if (_cancelPipelinedCommand(cbHandle)) {
+            _numCanceledOps.fetchAndAdd(1);
+        }
+        return;
+    }
+
     stdx::lock_guard<stdx::mutex> lk(_inProgressMutex);
 
     // If we found a matching cbHandle in _inGetConnection, then
@@ -97,6 +97,7 @@ class NetworkInterfaceASIO final : public NetworkInterface {
     friend class connection_pool_asio::ASIOTimer;
     friend class connection_pool_asio::ASIOImpl;
     class AsyncOp;
+    class PipelinedConnection;
 
 public:
     struct Options {
@@ -108,6 +109,11 @@ public:
         std::unique_ptr<NetworkConnectionHook> networkConnectionHook;
         std::unique_ptr<AsyncStreamFactoryInterface> streamFactory;
         std::unique_ptr<rpc::EgressMetadataHook> metadataHook;
+
+        // The number of commands which may be in flight on one egress connection at a time. By
+        // default each command runs alone on its own connection; larger values pipeline
+        // commands to the same host over shared connections, matching replies by responseTo.
+        size_t maxPipelineDepth = 1;
     };
 
     NetworkInterfaceASIO(Options = Options());
@@ -131,6 +137,7 @@ public:
     Status startCommand(const TaskExecutor::CallbackHandle& cbHandle,
                         RemoteCommandRequest& request,
                         const RemoteCommandCompletionFn& onFinish) override;
+    std::vector<Status> startCommands(std::vector<CommandToStart>* commands) override;
     void cancelCommand(const TaskExecutor::CallbackHandle& cbHandle) override;
     Status setAlarm(Date_t when, const stdx::function<void()>& action) override;
 
@@ -455,6 +462,23 @@ private:
 
     void _asyncRunCommand(AsyncOp* op, NetworkOpHandler handler);
 
+    // Runs a command whose handle startCommand() or startCommands() has already registered.
+    Status _startRegisteredCommand(const TaskExecutor::CallbackHandle& cbHandle,
+                                   RemoteCommandRequest& request,
+                                   const RemoteCommandCompletionFn& onFinish);
+
+    bool _isPipelining() const {
+        return _options.maxPipelineDepth > 1;
+    }
+
+    // Pipelined command execution, used when _options.maxPipelineDepth is greater than one
+    Status _startPipelinedCommand(const TaskExecutor::CallbackHandle& cbHandle,
+                                  RemoteCommandRequest& request,
+                                  const RemoteCommandCompletionFn& onFinish);
+    bool _cancelPipelinedCommand(const TaskExecutor::CallbackHandle& cbHandle);
+    void _removePipelinedConnection(PipelinedConnection* conn);
+    void _shutdownPipelines();
+
     std::string _getDiagnosticString_inlock(AsyncOp* currentOp);
 
     // Helpers for debugging crashes
@@ -476,6 +500,12 @@ private:
 
     std::unique_ptr<AsyncStreamFactoryInterface> _streamFactory;
 
+    // Connections multiplexing pipelined commands, by host. These must outlive _connectionPool,
+    // whose pending requests may call back into them as it is destroyed.
+    stdx::mutex _pipelineMutex;
+    stdx::unordered_map<HostAndPort, std::vector<std::shared_ptr<PipelinedConnection>>>
+        _pipelines;
+
     ConnectionPool _connectionPool;
 
     // If it is necessary to hold this lock while accessing a particular operation with
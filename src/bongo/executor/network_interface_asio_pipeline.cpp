@@ -0,0 +1,669 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kASIO
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/executor/network_interface_asio.h"
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/base/system_error.h"
+#include "bongo/executor/async_stream_interface.h"
+#include "bongo/executor/async_timer_interface.h"
+#include "bongo/executor/connection_pool_asio.h"
+#include "bongo/rpc/factory.h"
+#include "bongo/rpc/request_builder_interface.h"
+#include "bongo/stdx/unordered_set.h"
+#include "bongo/util/log.h"
+#include "bongo/util/bongoutils/str.h"
+#include "bongo/util/net/message.h"
+
+namespace bongo {
+namespace executor {
+
+namespace {
+
+using ResponseStatus = TaskExecutor::ResponseStatus;
+
+Message messageFromRequest(const RemoteCommandRequest& request, rpc::Protocol protocol) {
+    return rpc::makeRequestBuilder(protocol)
+        ->setDatabase(request.dbname)
+        .setCommandName(request.cmdObj.firstElementFieldName())
+        .setCommandArgs(request.cmdObj)
+        .setMetadata(request.metadata)
+        .done();
+}
+
+Status statusFromErrorCode(const std::error_code& ec) {
+    ErrorCodes::Error errorCode = (ec.category() == bongoErrorCategory())
+        ? ErrorCodes::fromInt(ec.value())
+        : ErrorCodes::HostUnreachable;
+    return {errorCode, ec.message()};
+}
+
+}  // namespace
+
+/**
+ * A connection checked out of the pool which multiplexes up to maxPipelineDepth commands to a
+ * single host. Requests are written back to back as they are queued, and a single reader loop
+ * routes each reply to its command by the reply's responseTo id, so a slow reply does not hold a
+ * connection per command hostage.
+ *
+ * Commands queue while the connection is being established. Once a connection has no commands
+ * left it is closed to new work and handed back to the pool; if it still owes replies to
+ * commands that timed out or were canceled it is returned as failed, since the stream is no
+ * longer in a known state.
+ *
+ * All stream operations run on the strand of the AsyncOp that owns the pooled connection. All
+ * other state is guarded by _mutex, as commands are queued and canceled from executor threads.
+ */
+class NetworkInterfaceASIO::PipelinedConnection final
+    : public std::enable_shared_from_this<NetworkInterfaceASIO::PipelinedConnection> {
+    BONGO_DISALLOW_COPYING(PipelinedConnection);
+
+public:
+    PipelinedConnection(NetworkInterfaceASIO* owner, HostAndPort target)
+        : _owner(owner), _target(std::move(target)) {}
+
+    /**
+     * Checks a connection out of the pool. Commands queued before it is ready are written as soon
+     * as it is.
+     */
+    void connect(Milliseconds timeout) {
+        auto self = shared_from_this();
+        _owner->_connectionPool.get(
+            _target, timeout, [self](StatusWith<ConnectionPool::ConnectionHandle> swConn) {
+                self->_onConnected(std::move(swConn));
+            });
+    }
+
+    /**
+     * Queues a command on this connection. Returns false if the connection already has
+     * maxPipelineDepth commands in flight or is closed to new work.
+     */
+    bool tryEnqueue(const TaskExecutor::CallbackHandle& cbHandle,
+                    const RemoteCommandRequest& request,
+                    const RemoteCommandCompletionFn& onFinish,
+                    Date_t start) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_state == State::kClosed || _pending.size() >= _owner->_options.maxPipelineDepth) {
+            return false;
+        }
+
+        // The message id is assigned up front so the reply can be routed by responseTo.
+        const int32_t id = nextMessageId();
+        auto& cmd = _pending[id];
+        cmd.cbHandle = cbHandle;
+        cmd.request = request;
+        cmd.onFinish = onFinish;
+        cmd.start = start;
+
+        if (request.timeout != RemoteCommandRequest::kNoTimeout) {
+            try {
+                cmd.timeoutAlarm = _owner->_timerFactory->make(&_owner->_strand, request.timeout);
+            } catch (std::system_error& e) {
+                severe() << "Failed to construct timer for pipelined command: " << e.what();
+                fassertFailed(40390);
+            }
+            auto self = shared_from_this();
+            cmd.timeoutAlarm->asyncWait([self, id](std::error_code ec) {
+                if (!ec) {
+                    self->_timeOut(id);
+                }
+            });
+        }
+
+        _writeQueue.push_back(id);
+        _startWritingIfIdle_inlock();
+        return true;
+    }
+
+    /**
+     * Completes the command with the given handle as canceled. Returns false if it is not
+     * running on this connection.
+     */
+    bool cancel(const TaskExecutor::CallbackHandle& cbHandle) {
+        boost::optional<PendingCommand> cmd;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            auto it = std::find_if(_pending.begin(), _pending.end(), [&](const PendingEntry& kv) {
+                return kv.second.cbHandle == cbHandle;
+            });
+            if (it == _pending.end()) {
+                return false;
+            }
+            cmd.emplace(std::move(it->second));
+            _pending.erase(it);
+        }
+
+        auto elapsed = _owner->now() - cmd->start;
+        _complete(std::move(*cmd), {ErrorCodes::CallbackCanceled, "Callback canceled", elapsed});
+        _checkIdle();
+        return true;
+    }
+
+    /**
+     * Gives the pooled connection back without completing outstanding commands. Only used once
+     * the io_service has been stopped, so no handlers will run again.
+     */
+    void abandon() {
+        ConnectionPool::ConnectionHandle handle;
+        std::unique_ptr<AsyncOp> op;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _state = State::kClosed;
+            _pending.clear();
+            _writeQueue.clear();
+            handle = std::move(_handle);
+            op = std::move(_op);
+        }
+
+        if (handle) {
+            auto asioConn = static_cast<connection_pool_asio::ASIOConnection*>(handle.get());
+            asioConn->bindAsyncOp(std::move(op));
+            asioConn->indicateFailure(
+                {ErrorCodes::ShutdownInProgress, "NetworkInterfaceASIO shutdown in progress"});
+        }
+    }
+
+    const HostAndPort& target() const {
+        return _target;
+    }
+
+private:
+    enum class State { kConnecting, kReady, kClosed };
+
+    struct PendingCommand {
+        TaskExecutor::CallbackHandle cbHandle;
+        RemoteCommandRequest request;
+        RemoteCommandCompletionFn onFinish;
+        Date_t start;
+        std::unique_ptr<AsyncTimerInterface> timeoutAlarm;
+        boost::optional<AsyncCommand> command;
+    };
+
+    using PendingEntry = std::pair<const int32_t, PendingCommand>;
+
+    void _onConnected(StatusWith<ConnectionPool::ConnectionHandle> swConn) {
+        if (!swConn.isOK()) {
+            auto status = swConn.getStatus();
+            if (status.code() == ErrorCodes::NetworkInterfaceExceededTimeLimit) {
+                status = Status(ErrorCodes::ExceededTimeLimit, status.reason());
+            }
+            return _fail(status);
+        }
+
+        auto asioConn =
+            static_cast<connection_pool_asio::ASIOConnection*>(swConn.getValue().get());
+
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        if (_state == State::kClosed) {
+            // Every command was canceled or timed out while we connected. The stream is fine.
+            lk.unlock();
+            asioConn->indicateSuccess();
+            return;
+        }
+
+        _op = asioConn->releaseAsyncOp();
+        _op->clearStateTransitions();
+        _handle = std::move(swConn.getValue());
+        _state = State::kReady;
+
+        if (!_writeQueue.empty()) {
+            _startWritingIfIdle_inlock();
+            return;
+        }
+
+        lk.unlock();
+        _checkIdle();
+    }
+
+    void _startWritingIfIdle_inlock() {
+        if (_state != State::kReady || _writing) {
+            return;
+        }
+        _writing = true;
+        auto self = shared_from_this();
+        _op->strand().post([self] { self->_writeNext(); });
+    }
+
+    void _writeNext() {
+        std::vector<std::pair<PendingCommand, Status>> failed;
+        bool startReading = false;
+        bool wrote = false;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_state == State::kClosed) {
+                _writing = false;
+            }
+
+            while (_state != State::kClosed && !_writeQueue.empty()) {
+                const int32_t id = _writeQueue.front();
+                _writeQueue.pop_front();
+
+                // Commands which were canceled or timed out before being written are skipped.
+                auto it = _pending.find(id);
+                if (it == _pending.end()) {
+                    continue;
+                }
+
+                auto toSend = messageFromRequest(it->second.request, _op->operationProtocol());
+                toSend.header().setId(id);
+                toSend.header().setResponseToMsgId(0);
+
+                auto swm = _op->connection().getCompressorManager().compressMessage(toSend);
+                if (!swm.isOK()) {
+                    failed.emplace_back(std::move(it->second), swm.getStatus());
+                    _pending.erase(it);
+                    continue;
+                }
+
+                _outgoing = std::move(swm.getValue());
+                it->second.command.emplace(&_op->connection(),
+                                           Message(_outgoing.sharedBuffer()),
+                                           it->second.start,
+                                           _target);
+                _unanswered.insert(id);
+                startReading = !_reading;
+                _reading = true;
+                wrote = true;
+                break;
+            }
+
+            if (!wrote) {
+                _writing = false;
+            }
+        }
+
+        for (auto&& cmd : failed) {
+            _complete(std::move(cmd.first), {std::move(cmd.second), Milliseconds(0)});
+        }
+
+        if (!wrote) {
+            _maybeRelease();
+            return _checkIdle();
+        }
+
+        auto self = shared_from_this();
+        _op->connection().stream().write(asio::buffer(_outgoing.buf(), _outgoing.size()),
+                                         [self](std::error_code ec, std::size_t) {
+                                             if (ec) {
+                                                 return self->_onStreamError(ec, false);
+                                             }
+                                             self->_writeNext();
+                                         });
+
+        if (startReading) {
+            _readHeader();
+        }
+    }
+
+    void _readHeader() {
+        auto self = shared_from_this();
+        _op->connection().stream().read(
+            asio::buffer(_header.view().view2ptr(), sizeof(decltype(_header))),
+            [self](std::error_code ec, std::size_t) {
+                if (ec) {
+                    return self->_onStreamError(ec, true);
+                }
+                self->_readBody();
+            });
+    }
+
+    void _readBody() {
+        int len = _header.constView().getMessageLength();
+        if (static_cast<size_t>(len) < sizeof(MSGHEADER::Value) ||
+            static_cast<size_t>(len) > MaxMessageSizeBytes) {
+            warning() << "recv(): message len " << len << " is invalid. "
+                      << "Min " << sizeof(MSGHEADER::Value) << " Max: " << MaxMessageSizeBytes;
+            return _onStreamError(make_error_code(ErrorCodes::InvalidLength), true);
+        }
+
+        int z = (len + 1023) & 0xfffffc00;
+        invariant(z >= len);
+        _toRecv.setData(SharedBuffer::allocate(z));
+        MsgData::View mdView = _toRecv.buf();
+
+        const int headerLen = sizeof(MSGHEADER::Value);
+        memcpy(mdView.view2ptr(), &_header, headerLen);
+
+        auto self = shared_from_this();
+        _op->connection().stream().read(asio::buffer(mdView.data(), len - headerLen),
+                                        [self](std::error_code ec, std::size_t) {
+                                            if (ec) {
+                                                return self->_onStreamError(ec, true);
+                                            }
+                                            self->_onReply();
+                                        });
+    }
+
+    void _onReply() {
+        const int32_t responseTo = _toRecv.header().getResponseToMsgId();
+        boost::optional<PendingCommand> cmd;
+        bool unexpected = false;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_state == State::kClosed) {
+                _reading = false;
+            } else if (_unanswered.erase(responseTo) == 0) {
+                unexpected = true;
+                _reading = false;
+            } else {
+                // Replies to commands which already timed out or were canceled are dropped.
+                auto it = _pending.find(responseTo);
+                if (it != _pending.end()) {
+                    cmd.emplace(std::move(it->second));
+                    _pending.erase(it);
+                }
+            }
+        }
+
+        if (unexpected) {
+            return _fail({ErrorCodes::ProtocolError,
+                          str::stream() << "got unexpected response id " << responseTo
+                                        << " from "
+                                        << _target});
+        }
+
+        if (cmd) {
+            // _reading is still set, so the connection cannot be released under us here.
+            cmd->command->toRecv() = std::move(_toRecv);
+            auto response = cmd->command->response(
+                _op.get(), _op->operationProtocol(), _owner->now(), _owner->_metadataHook.get());
+            _complete(std::move(*cmd), std::move(response));
+        }
+
+        bool readMore = false;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_reading) {
+                readMore = _state != State::kClosed && !_unanswered.empty();
+                _reading = readMore;
+            }
+        }
+
+        if (readMore) {
+            return _readHeader();
+        }
+        _checkIdle();
+        _maybeRelease();
+    }
+
+    void _onStreamError(std::error_code ec, bool reader) {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            (reader ? _reading : _writing) = false;
+        }
+        _fail(statusFromErrorCode(ec));
+        _maybeRelease();
+    }
+
+    void _timeOut(int32_t id) {
+        boost::optional<PendingCommand> cmd;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            auto it = _pending.find(id);
+            if (it == _pending.end()) {
+                return;
+            }
+            cmd.emplace(std::move(it->second));
+            _pending.erase(it);
+        }
+
+        LOG(2) << "Request " << cmd->request.id << " timed out"
+               << ", timeout was " << cmd->request.timeout;
+        auto elapsed = _owner->now() - cmd->start;
+        _complete(std::move(*cmd),
+                  {ErrorCodes::ExceededTimeLimit, "Remote command timed out", elapsed});
+        _checkIdle();
+    }
+
+    /**
+     * Fails every command on this connection with the given status and closes it.
+     */
+    void _fail(Status status) {
+        std::vector<PendingCommand> failed;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_state == State::kClosed) {
+                return;
+            }
+            _close_inlock(status);
+            for (auto&& kv : _pending) {
+                failed.push_back(std::move(kv.second));
+            }
+            _pending.clear();
+            _writeQueue.clear();
+        }
+
+        LOG(2) << "Pipelined connection to " << _target << " failed: " << redact(status);
+        _owner->_removePipelinedConnection(this);
+
+        const auto now = _owner->now();
+        for (auto&& cmd : failed) {
+            const auto elapsed = now - cmd.start;
+            _complete(std::move(cmd), {status, elapsed});
+        }
+        _maybeRelease();
+    }
+
+    /**
+     * Closes the connection to new work once it has no commands left.
+     */
+    void _checkIdle() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_state != State::kReady || !_pending.empty() || !_writeQueue.empty() || _writing) {
+                return;
+            }
+            _close_inlock(_unanswered.empty()
+                              ? Status::OK()
+                              : Status(ErrorCodes::OperationFailed,
+                                       "Pipelined connection closed with replies outstanding"));
+        }
+
+        _owner->_removePipelinedConnection(this);
+        _maybeRelease();
+    }
+
+    void _close_inlock(Status status) {
+        _state = State::kClosed;
+        _closeStatus = std::move(status);
+
+        if (_op && (_reading || _writing)) {
+            auto self = shared_from_this();
+            _op->strand().post([self] {
+                stdx::lock_guard<stdx::mutex> lk(self->_mutex);
+                if (self->_op) {
+                    self->_op->connection().cancel();
+                }
+            });
+        }
+    }
+
+    /**
+     * Returns the connection to the pool once it is closed and no stream operations remain.
+     */
+    void _maybeRelease() {
+        ConnectionPool::ConnectionHandle handle;
+        std::unique_ptr<AsyncOp> op;
+        Status status = Status::OK();
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_state != State::kClosed || _reading || _writing || !_handle) {
+                return;
+            }
+            handle = std::move(_handle);
+            op = std::move(_op);
+            status = _closeStatus;
+        }
+
+        op->setResponseMetadata(BSONObj());
+
+        auto asioConn = static_cast<connection_pool_asio::ASIOConnection*>(handle.get());
+        asioConn->bindAsyncOp(std::move(op));
+        if (status.isOK()) {
+            asioConn->indicateUsed();
+            asioConn->indicateSuccess();
+        } else {
+            asioConn->indicateFailure(status);
+        }
+    }
+
+    void _complete(PendingCommand&& cmd, ResponseStatus rs) {
+        if (cmd.timeoutAlarm) {
+            cmd.timeoutAlarm->cancel();
+        }
+
+        if (rs.status.code() == ErrorCodes::ExceededTimeLimit) {
+            _owner->_numTimedOutOps.fetchAndAdd(1);
+        }
+
+        if (rs.isOK()) {
+            _owner->_numSucceededOps.fetchAndAdd(1);
+        } else if (rs.status.code() != ErrorCodes::CallbackCanceled) {
+            LOG(2) << "Failed to execute command: " << redact(cmd.request.toString())
+                   << " reason: " << redact(rs.status);
+            _owner->_numFailedOps.fetchAndAdd(1);
+        }
+
+        cmd.onFinish(rs);
+        _owner->signalWorkAvailable();
+    }
+
+    NetworkInterfaceASIO* const _owner;
+    const HostAndPort _target;
+
+    stdx::mutex _mutex;
+    State _state = State::kConnecting;
+    Status _closeStatus = Status::OK();
+
+    // Held while the connection is checked out of the pool.
+    ConnectionPool::ConnectionHandle _handle;
+    std::unique_ptr<AsyncOp> _op;
+
+    // Commands by request message id, including those not yet written.
+    stdx::unordered_map<int32_t, PendingCommand> _pending;
+    std::deque<int32_t> _writeQueue;
+
+    // Ids of requests written whose replies have not been read, including those whose commands
+    // have since timed out or been canceled.
+    stdx::unordered_set<int32_t> _unanswered;
+
+    // Whether a write or a read is outstanding on the stream.
+    bool _writing = false;
+    bool _reading = false;
+
+    // Only touched on the strand.
+    Message _outgoing;
+    MSGHEADER::Value _header;
+    Message _toRecv;
+};
+
+Status NetworkInterfaceASIO::_startPipelinedCommand(const TaskExecutor::CallbackHandle& cbHandle,
+                                                    RemoteCommandRequest& request,
+                                                    const RemoteCommandCompletionFn& onFinish) {
+    const auto start = now();
+
+    std::shared_ptr<PipelinedConnection> toConnect;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_pipelineMutex);
+        auto& conns = _pipelines[request.target];
+        for (auto&& conn : conns) {
+            if (conn->tryEnqueue(cbHandle, request, onFinish, start)) {
+                return Status::OK();
+            }
+        }
+
+        toConnect = std::make_shared<PipelinedConnection>(this, request.target);
+        invariant(toConnect->tryEnqueue(cbHandle, request, onFinish, start));
+        conns.push_back(toConnect);
+    }
+
+    // The pool may call back inline, so we must not hold _pipelineMutex here.
+    toConnect->connect(request.timeout);
+    return Status::OK();
+}
+
+bool NetworkInterfaceASIO::_cancelPipelinedCommand(const TaskExecutor::CallbackHandle& cbHandle) {
+    std::vector<std::shared_ptr<PipelinedConnection>> conns;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_pipelineMutex);
+        for (auto&& kv : _pipelines) {
+            conns.insert(conns.end(), kv.second.begin(), kv.second.end());
+        }
+    }
+
+    for (auto&& conn : conns) {
+        if (conn->cancel(cbHandle)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NetworkInterfaceASIO::_removePipelinedConnection(PipelinedConnection* conn) {
+    stdx::lock_guard<stdx::mutex> lk(_pipelineMutex);
+    auto it = _pipelines.find(conn->target());
+    if (it == _pipelines.end()) {
+        return;
+    }
+
+    auto& conns = it->second;
+    conns.erase(std::remove_if(conns.begin(),
+                               conns.end(),
+                               [conn](const std::shared_ptr<PipelinedConnection>& other) {
+                                   return other.get() == conn;
+                               }),
+                conns.end());
+    if (conns.empty()) {
+        _pipelines.erase(it);
+    }
+}
+
+void NetworkInterfaceASIO::_shutdownPipelines() {
+    decltype(_pipelines) pipelines;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_pipelineMutex);
+        pipelines.swap(_pipelines);
+    }
+
+    for (auto&& kv : pipelines) {
+        for (auto&& conn : kv.second) {
+            conn->abandon();
+        }
+    }
+}
+
+}  // namespace executor
+}  // namespace bongo
@@ -0,0 +1,421 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kASIO
+
+#include "bongo/platform/basic.h"
+
+#include <algorithm>
+#include <asio.hpp>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "bongo/db/jsobj.h"
+#include "bongo/db/wire_version.h"
+#include "bongo/executor/async_stream_factory.h"
+#include "bongo/executor/async_timer_asio.h"
+#include "bongo/executor/network_interface_asio.h"
+#include "bongo/executor/network_interface_asio_test_utils.h"
+#include "bongo/executor/remote_command_request.h"
+#include "bongo/executor/remote_command_response.h"
+#include "bongo/platform/atomic_word.h"
+#include "bongo/rpc/factory.h"
+#include "bongo/rpc/reply_builder_interface.h"
+#include "bongo/rpc/request_interface.h"
+#include "bongo/stdx/chrono.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/log.h"
+#include "bongo/util/net/hostandport.h"
+#include "bongo/util/net/message.h"
+#include "bongo/util/timer.h"
+
+namespace bongo {
+namespace executor {
+namespace {
+
+using asio::ip::tcp;
+
+/**
+ * A stand-in for a shard listening on the loopback interface. It answers every command with
+ * {echo: <command>, ok: 1}. Like a real shard it runs the commands on each connection one at a
+ * time in the order they arrive, each taking a fixed service time plus any 'sleepMillis' in the
+ * command, and the reply arrives a fixed network latency after the command is done.
+ */
+class MockShard {
+public:
+    MockShard(Milliseconds latency, Microseconds serviceTime)
+        : _latency(latency),
+          _serviceTime(serviceTime),
+          _acceptor(_ioService, tcp::endpoint(asio::ip::address_v4::loopback(), 0)) {
+        _acceptThread = stdx::thread([this] { _acceptLoop(); });
+    }
+
+    ~MockShard() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _inShutdown = true;
+            for (auto&& conn : _connections) {
+                std::error_code ec;
+                conn->socket.shutdown(tcp::socket::shutdown_both, ec);
+            }
+            _cv.notify_all();
+        }
+
+        // Wake up the acceptor, which sees we are shutting down.
+        std::error_code ec;
+        tcp::socket waker(_ioService);
+        waker.connect(_acceptor.local_endpoint(), ec);
+        _acceptThread.join();
+
+        for (auto&& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    HostAndPort host() const {
+        return HostAndPort("127.0.0.1", _acceptor.local_endpoint().port());
+    }
+
+    int connectionsAccepted() const {
+        return _accepted.load();
+    }
+
+private:
+    struct Connection {
+        explicit Connection(asio::io_service& ioService) : socket(ioService) {}
+
+        tcp::socket socket;
+        std::deque<std::pair<stdx::chrono::steady_clock::time_point, Message>> replies;
+        stdx::chrono::steady_clock::time_point busyUntil;
+        bool closed = false;
+    };
+
+    void _acceptLoop() {
+        while (true) {
+            auto conn = std::make_shared<Connection>(_ioService);
+            std::error_code ec;
+            _acceptor.accept(conn->socket, ec);
+
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_inShutdown) {
+                return;
+            }
+            if (ec) {
+                continue;
+            }
+
+            _accepted.fetchAndAdd(1);
+            _connections.push_back(conn);
+            _threads.emplace_back([this, conn] { _readLoop(conn); });
+            _threads.emplace_back([this, conn] { _writeLoop(conn); });
+        }
+    }
+
+    void _readLoop(std::shared_ptr<Connection> conn) {
+        while (true) {
+            MSGHEADER::Value header;
+            std::error_code ec;
+            asio::read(conn->socket, asio::buffer(header.view().view2ptr(), sizeof(header)), ec);
+            if (ec) {
+                break;
+            }
+
+            const int len = header.constView().getMessageLength();
+            Message request(SharedBuffer::allocate(len));
+            memcpy(request.buf(), header.view().view2ptr(), sizeof(header));
+            asio::read(conn->socket,
+                       asio::buffer(request.buf() + sizeof(header), len - sizeof(header)),
+                       ec);
+            if (ec) {
+                break;
+            }
+
+            Milliseconds delay{0};
+            auto reply = _makeReply(request, &delay);
+
+            // The command starts once the commands before it on the connection are done.
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            conn->busyUntil = std::max(conn->busyUntil, stdx::chrono::steady_clock::now()) +
+                (_serviceTime + delay).toSystemDuration();
+            conn->replies.emplace_back(conn->busyUntil + _latency.toSystemDuration(),
+                                       std::move(reply));
+            _cv.notify_all();
+        }
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        conn->closed = true;
+        _cv.notify_all();
+    }
+
+    void _writeLoop(std::shared_ptr<Connection> conn) {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        while (true) {
+            _cv.wait(lk, [&] { return _inShutdown || conn->closed || !conn->replies.empty(); });
+            if (_inShutdown || conn->closed) {
+                return;
+            }
+
+            const auto due = conn->replies.front().first;
+            if (stdx::chrono::steady_clock::now() < due) {
+                _cv.wait_until(lk, due);
+                continue;
+            }
+
+            auto reply = std::move(conn->replies.front().second);
+            conn->replies.pop_front();
+
+            lk.unlock();
+            std::error_code ec;
+            asio::write(conn->socket, asio::buffer(reply.buf(), reply.size()), ec);
+            lk.lock();
+            if (ec) {
+                return;
+            }
+        }
+    }
+
+    static Message _makeReply(const Message& request, Milliseconds* delay) {
+        auto parsed = rpc::makeRequest(&request);
+
+        BSONObjBuilder bob;
+        if (parsed->getCommandName() == "isMaster") {
+            bob.append("ismaster", true);
+            bob.append("minWireVersion", WireSpec::instance().incoming.minWireVersion);
+            bob.append("maxWireVersion", WireSpec::instance().incoming.maxWireVersion);
+        } else {
+            bob.append("echo", parsed->getCommandArgs());
+            *delay = Milliseconds(parsed->getCommandArgs()["sleepMillis"].numberInt());
+        }
+        bob.append("ok", 1.0);
+
+        auto reply = rpc::makeReplyBuilder(parsed->getProtocol())
+                         ->setCommandReply(bob.done())
+                         .setMetadata(BSONObj())
+                         .done();
+        reply.header().setId(nextMessageId());
+        reply.header().setResponseToMsgId(request.header().getId());
+        return reply;
+    }
+
+    const Milliseconds _latency;
+    const Microseconds _serviceTime;
+
+    asio::io_service _ioService;
+    tcp::acceptor _acceptor;
+    stdx::thread _acceptThread;
+    AtomicInt32 _accepted;
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+    bool _inShutdown = false;
+    std::vector<std::shared_ptr<Connection>> _connections;
+    std::vector<stdx::thread> _threads;
+};
+
+class NetworkInterfaceASIOPipelineTest : public bongo::unittest::Test {
+public:
+    void startShard(Milliseconds latency, Microseconds serviceTime = Microseconds(0)) {
+        _shard = stdx::make_unique<MockShard>(latency, serviceTime);
+    }
+
+    void startNet(size_t maxPipelineDepth) {
+        NetworkInterfaceASIO::Options options;
+        options.streamFactory = stdx::make_unique<AsyncStreamFactory>();
+        options.timerFactory = stdx::make_unique<AsyncTimerFactoryASIO>();
+        options.connectionPoolOptions.maxConnections = 256u;
+        options.maxPipelineDepth = maxPipelineDepth;
+        _net = stdx::make_unique<NetworkInterfaceASIO>(std::move(options));
+        _net->startup();
+    }
+
+    void tearDown() override {
+        if (_net && !_net->inShutdown()) {
+            _net->shutdown();
+        }
+    }
+
+    NetworkInterfaceASIO& net() {
+        return *_net;
+    }
+
+    MockShard& shard() {
+        return *_shard;
+    }
+
+    RemoteCommandRequest makeRequest(BSONObj cmdObj,
+                                     Milliseconds timeout = RemoteCommandRequest::kNoTimeout) {
+        return {shard().host(), "admin", cmdObj, BSONObj(), nullptr, timeout};
+    }
+
+    RemoteCommandResponse runCommandSync(const TaskExecutor::CallbackHandle& cbHandle,
+                                         RemoteCommandRequest request) {
+        Deferred<RemoteCommandResponse> deferred;
+        ASSERT_OK(net().startCommand(
+            cbHandle, request, [deferred](RemoteCommandResponse resp) mutable {
+                deferred.emplace(std::move(resp));
+            }));
+        return deferred.get();
+    }
+
+    /**
+     * Runs 'total' commands, keeping 'concurrency' of them in flight at all times. Every reply
+     * must echo the command it answers. Returns the number of commands run per second.
+     */
+    double runConcurrently(int total, int concurrency) {
+        stdx::mutex mutex;
+        stdx::condition_variable cv;
+        int started = 0;
+        int finished = 0;
+        int mismatched = 0;
+
+        stdx::function<void()> startNext = [&] {
+            int seq;
+            {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                if (started == total) {
+                    return;
+                }
+                seq = started++;
+            }
+
+            // This also runs on the network thread, where we cannot use ASSERT.
+            auto request = makeRequest(BSON("ping" << 1 << "seq" << seq));
+            invariantOK(net().startCommand(
+                makeCallbackHandle(), request, [&, seq](const RemoteCommandResponse& resp) {
+                    {
+                        stdx::lock_guard<stdx::mutex> lk(mutex);
+                        if (!resp.isOK() || resp.data["echo"]["seq"].numberInt() != seq) {
+                            ++mismatched;
+                        }
+                        if (++finished == total) {
+                            cv.notify_all();
+                        }
+                    }
+                    startNext();
+                }));
+        };
+
+        Timer timer;
+        for (int i = 0; i < concurrency; ++i) {
+            startNext();
+        }
+
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        cv.wait(lk, [&] { return finished == total; });
+        const auto elapsedMicros = timer.micros();
+
+        ASSERT_EQ(0, mismatched);
+        return total * 1000000.0 / std::max(elapsedMicros, 1LL);
+    }
+
+private:
+    std::unique_ptr<MockShard> _shard;
+    std::unique_ptr<NetworkInterfaceASIO> _net;
+};
+
+TEST_F(NetworkInterfaceASIOPipelineTest, RepliesAreMatchedToTheirCommands) {
+    const int kCommands = 64;
+    const size_t kDepth = 16;
+
+    startShard(Milliseconds(20));
+    startNet(kDepth);
+
+    runConcurrently(kCommands, kCommands);
+
+    // Every command shared one of four connections rather than opening its own.
+    ASSERT_LTE(shard().connectionsAccepted(), static_cast<int>(kCommands / kDepth) + 1);
+}
+
+TEST_F(NetworkInterfaceASIOPipelineTest, ThroughputHoldsWithFewerConnections) {
+    const int kCommands = 4096;
+    const int kConcurrency = 64;
+
+    // The commands pipelined on a connection wait for each other, but not for the round trip.
+    const Milliseconds kLatency(5);
+    const Microseconds kServiceTime(100);
+
+    startShard(kLatency, kServiceTime);
+    startNet(1);
+    const auto unpipelinedOpsPerSec = runConcurrently(kCommands, kConcurrency);
+    const auto unpipelinedConnections = shard().connectionsAccepted();
+    tearDown();
+
+    startShard(kLatency, kServiceTime);
+    startNet(16);
+    const auto pipelinedOpsPerSec = runConcurrently(kCommands, kConcurrency);
+    const auto pipelinedConnections = shard().connectionsAccepted();
+
+    log() << "THROUGHPUT unpipelined: " << unpipelinedOpsPerSec << " ops/s over "
+          << unpipelinedConnections << " connections";
+    log() << "THROUGHPUT pipelined depth 16: " << pipelinedOpsPerSec << " ops/s over "
+          << pipelinedConnections << " connections";
+
+    ASSERT_LTE(pipelinedConnections * 10, unpipelinedConnections);
+    ASSERT_GTE(pipelinedOpsPerSec * 2, unpipelinedOpsPerSec);
+}
+
+TEST_F(NetworkInterfaceASIOPipelineTest, TimedOutCommandDoesNotPoisonNextCommand) {
+    startShard(Milliseconds(0));
+    startNet(16);
+
+    auto slow = runCommandSync(makeCallbackHandle(),
+                               makeRequest(BSON("ping" << 1 << "sleepMillis" << 2000),
+                                           Milliseconds(100)));
+    ASSERT_EQ(ErrorCodes::ExceededTimeLimit, slow.status);
+
+    // The connection still owes the slow reply, so it is discarded rather than reused.
+    auto fast = runCommandSync(makeCallbackHandle(), makeRequest(BSON("ping" << 1 << "seq" << 7)));
+    ASSERT_OK(fast.status);
+    ASSERT_EQ(7, fast.data["echo"]["seq"].numberInt());
+    ASSERT_EQ(2, shard().connectionsAccepted());
+}
+
+TEST_F(NetworkInterfaceASIOPipelineTest, CancelPipelinedCommand) {
+    startShard(Milliseconds(0));
+    startNet(16);
+
+    auto cbHandle = makeCallbackHandle();
+    auto request = makeRequest(BSON("ping" << 1 << "sleepMillis" << 2000));
+    Deferred<RemoteCommandResponse> deferred;
+    ASSERT_OK(net().startCommand(cbHandle, request, [deferred](RemoteCommandResponse resp) mutable {
+        deferred.emplace(std::move(resp));
+    }));
+
+    net().cancelCommand(cbHandle);
+    ASSERT_EQ(ErrorCodes::CallbackCanceled, deferred.get().status);
+    ASSERT_EQ(1u, net().getNumCanceledOps());
+}
+
+}  // namespace
+}  // namespace executor
+}  // namespace bongo
@@ -50,13 +50,15 @@ class NetworkConnectionHook;
 std::unique_ptr<NetworkInterface> makeNetworkInterface(std::string instanceName);
 
 /**
- * Returns a new NetworkInterface with the given connection hook set.
+ * Returns a new NetworkInterface with the given connection hook set. A maxPipelineDepth greater
+ * than one lets that many commands share each egress connection.
  */
 std::unique_ptr<NetworkInterface> makeNetworkInterface(
     std::string instanceName,
     std::unique_ptr<NetworkConnectionHook> hook,
     std::unique_ptr<rpc::EgressMetadataHook> metadataHook,
-    ConnectionPool::Options options = ConnectionPool::Options());
+    ConnectionPool::Options options = ConnectionPool::Options(),
+    size_t maxPipelineDepth = 1);
 
 }  // namespace executor
 }  // namespace bongo
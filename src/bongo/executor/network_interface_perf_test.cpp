@@ -30,7 +30,9 @@
 
 #include "bongo/platform/basic.h"
 
+#include <algorithm>
 #include <exception>
+#include <vector>
 
 #include "bongo/base/status_with.h"
 #include "bongo/bson/bsonmisc.h"
@@ -38,13 +40,17 @@
 #include "bongo/executor/async_stream_factory.h"
 #include "bongo/executor/async_stream_interface.h"
 #include "bongo/executor/async_timer_asio.h"
+#include "bongo/executor/connection_pool.h"
 #include "bongo/executor/network_interface_asio.h"
 #include "bongo/executor/network_interface_asio_test_utils.h"
 #include "bongo/executor/task_executor.h"
+#include "bongo/executor/thread_pool_task_executor.h"
 #include "bongo/stdx/memory.h"
+#include "bongo/stdx/thread.h"
 #include "bongo/unittest/integration_test.h"
 #include "bongo/unittest/unittest.h"
 #include "bongo/util/assert_util.h"
+#include "bongo/util/concurrency/thread_pool.h"
 #include "bongo/util/log.h"
 #include "bongo/util/net/hostandport.h"
 #include "bongo/util/scopeguard.h"
@@ -109,6 +115,294 @@ TEST(NetworkInterfaceASIO, SerialPerf) {
     log() << "THROUGHPUT asio ping ops/s: " << result;
 }
 
+/**
+ * A connection that sets up and refreshes instantly and never fails, so that checking
+ * connections out of the pool and back in is all that gets measured.
+ */
+class InstantConnection final : public ConnectionPool::ConnectionInterface {
+public:
+    InstantConnection(const HostAndPort& hostAndPort, size_t generation)
+        : _hostAndPort(hostAndPort), _generation(generation) {}
+
+    void indicateSuccess() override {
+        _status = Status::OK();
+    }
+
+    void indicateFailure(Status status) override {
+        _status = std::move(status);
+    }
+
+    const HostAndPort& getHostAndPort() const override {
+        return _hostAndPort;
+    }
+
+    bool isHealthy() override {
+        return true;
+    }
+
+    void setTimeout(Milliseconds timeout, TimeoutCallback cb) override {}
+
+    void cancelTimeout() override {}
+
+private:
+    void indicateUsed() override {
+        _lastUsed = Date_t::now();
+    }
+
+    Date_t getLastUsed() const override {
+        return _lastUsed;
+    }
+
+    const Status& getStatus() const override {
+        return _status;
+    }
+
+    void setup(Milliseconds timeout, SetupCallback cb) override {
+        cb(this, Status::OK());
+    }
+
+    void resetToUnknown() override {
+        _status = ConnectionPool::kConnectionStateUnknown;
+    }
+
+    void refresh(Milliseconds timeout, RefreshCallback cb) override {
+        cb(this, Status::OK());
+    }
+
+    size_t getGeneration() const override {
+        return _generation;
+    }
+
+    const HostAndPort _hostAndPort;
+    const size_t _generation;
+    Date_t _lastUsed = Date_t::now();
+    Status _status = Status::OK();
+};
+
+class NullTimer final : public ConnectionPool::TimerInterface {
+public:
+    void setTimeout(Milliseconds timeout, TimeoutCallback cb) override {}
+
+    void cancelTimeout() override {}
+};
+
+class InstantConnectionFactory final : public ConnectionPool::DependentTypeFactoryInterface {
+public:
+    std::unique_ptr<ConnectionPool::ConnectionInterface> makeConnection(
+        const HostAndPort& hostAndPort, size_t generation) override {
+        return stdx::make_unique<InstantConnection>(hostAndPort, generation);
+    }
+
+    std::unique_ptr<ConnectionPool::TimerInterface> makeTimer() override {
+        return stdx::make_unique<NullTimer>();
+    }
+
+    Date_t now() override {
+        return Date_t::now();
+    }
+};
+
+const std::size_t checkoutsPerThread = 200000;
+
+/**
+ * Has 'numThreads' threads check connections out of one pool and straight back in, spread
+ * round-robin over 'numHosts' hosts, and returns the total checkouts per second.
+ */
+long long checkoutsPerSecond(std::size_t numThreads, std::size_t numHosts) {
+    ConnectionPool pool(stdx::make_unique<InstantConnectionFactory>(), "perf");
+
+    std::vector<HostAndPort> hosts;
+    for (std::size_t i = 0; i < numHosts; ++i) {
+        hosts.emplace_back("localhost", 20000 + static_cast<int>(i));
+    }
+
+    std::atomic<std::size_t> completed(0);  // NOLINT
+    const auto callback = [&](StatusWith<ConnectionPool::ConnectionHandle> swConn) {
+        uassertStatusOK(swConn.getStatus());
+        swConn.getValue()->indicateSuccess();
+        ++completed;
+    };
+
+    Timer t;
+    std::vector<stdx::thread> threads;
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&, i] {
+            for (std::size_t j = 0; j < checkoutsPerThread; ++j) {
+                pool.get(hosts[(i + j) % numHosts], Milliseconds(-1), callback);
+            }
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+
+    // Requests that had to queue are served by whichever thread returned a connection, so all
+    // of them are done by now.
+    invariant(completed.load() == numThreads * checkoutsPerThread);
+
+    return static_cast<long long>(numThreads * checkoutsPerThread) * 1000000 /
+        std::max<long long>(t.micros(), 1);
+}
+
+TEST(ConnectionPool, MultiThreadedCheckoutPerf) {
+    for (std::size_t numHosts : {1, 16}) {
+        for (std::size_t numThreads : {1, 4, 16}) {
+            log() << "THROUGHPUT connection pool checkouts/s with " << numThreads
+                  << " threads over " << numHosts
+                  << " hosts: " << checkoutsPerSecond(numThreads, numHosts);
+        }
+    }
+}
+
+/**
+ * A network interface that answers every command as soon as it is started, so that only the
+ * executor's own scheduling work is measured.
+ */
+class InstantNetworkInterface final : public NetworkInterface {
+public:
+    std::string getDiagnosticString() override {
+        return "InstantNetworkInterface";
+    }
+
+    void appendConnectionStats(ConnectionPoolStats* stats) const override {}
+
+    void startup() override {}
+
+    void shutdown() override {
+        _inShutdown.store(true);
+    }
+
+    bool inShutdown() const override {
+        return _inShutdown.load();
+    }
+
+    void waitForWork() override {}
+
+    void waitForWorkUntil(Date_t when) override {}
+
+    void signalWorkAvailable() override {}
+
+    Date_t now() override {
+        return Date_t::now();
+    }
+
+    std::string getHostName() override {
+        return "localhost";
+    }
+
+    Status startCommand(const TaskExecutor::CallbackHandle& cbHandle,
+                        RemoteCommandRequest& request,
+                        const RemoteCommandCompletionFn& onFinish) override {
+        onFinish(RemoteCommandResponse(BSON("ok" << 1), BSONObj(), Milliseconds(0)));
+        return Status::OK();
+    }
+
+    void cancelCommand(const TaskExecutor::CallbackHandle& cbHandle) override {}
+
+    Status setAlarm(Date_t when, const stdx::function<void()>& action) override {
+        return {ErrorCodes::IllegalOperation, "alarms are not supported"};
+    }
+
+    bool onNetworkThread() override {
+        return false;
+    }
+
+private:
+    std::atomic<bool> _inShutdown{false};  // NOLINT
+};
+
+const std::size_t broadcastsPerThread = 200;
+
+/**
+ * Has 'numThreads' threads each send 'broadcastsPerThread' broadcasts of one command to
+ * 'numTargets' hosts through a single executor, waiting for every reply of a broadcast before
+ * sending the next, and returns the total broadcasts per second. If 'batched' is true each
+ * broadcast is scheduled with one scheduleRemoteCommands() call, otherwise with one
+ * scheduleRemoteCommand() call per target.
+ */
+long long broadcastsPerSecond(std::size_t numThreads, std::size_t numTargets, bool batched) {
+    ThreadPool::Options poolOptions;
+    poolOptions.poolName = "BroadcastPerf";
+    poolOptions.minThreads = 4;
+    poolOptions.maxThreads = 4;
+    ThreadPoolTaskExecutor executor(stdx::make_unique<ThreadPool>(poolOptions),
+                                    stdx::make_unique<InstantNetworkInterface>());
+    executor.startup();
+    auto guard = MakeGuard([&] {
+        executor.shutdown();
+        executor.join();
+    });
+
+    const auto cmdObj = BSON("ping" << 1);
+    std::vector<RemoteCommandRequest> requests;
+    for (std::size_t i = 0; i < numTargets; ++i) {
+        requests.emplace_back(HostAndPort("localhost", 20000 + static_cast<int>(i)),
+                              "admin",
+                              cmdObj,
+                              BSONObj(),
+                              nullptr,
+                              Milliseconds(-1));
+    }
+
+    Timer t;
+    std::vector<stdx::thread> threads;
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&] {
+            stdx::mutex mtx;
+            stdx::condition_variable cv;
+            std::size_t remaining = 0;
+
+            const auto callback = [&](const TaskExecutor::RemoteCommandCallbackArgs& args) {
+                uassertStatusOK(args.response.status);
+                stdx::lock_guard<stdx::mutex> lk(mtx);
+                if (--remaining == 0) {
+                    cv.notify_one();
+                }
+            };
+
+            std::vector<TaskExecutor::RemoteCommandBatchEntry> batch;
+            for (auto&& request : requests) {
+                batch.push_back({request, callback});
+            }
+
+            for (std::size_t j = 0; j < broadcastsPerThread; ++j) {
+                {
+                    stdx::lock_guard<stdx::mutex> lk(mtx);
+                    remaining = numTargets;
+                }
+                if (batched) {
+                    for (auto&& swHandle : executor.scheduleRemoteCommands(batch)) {
+                        uassertStatusOK(swHandle.getStatus());
+                    }
+                } else {
+                    for (auto&& request : requests) {
+                        uassertStatusOK(executor.scheduleRemoteCommand(request, callback));
+                    }
+                }
+                stdx::unique_lock<stdx::mutex> lk(mtx);
+                cv.wait(lk, [&] { return remaining == 0; });
+            }
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+
+    return static_cast<long long>(numThreads * broadcastsPerThread) * 1000000 /
+        std::max<long long>(t.micros(), 1);
+}
+
+TEST(TaskExecutor, BroadcastSchedulingPerf) {
+    for (std::size_t numTargets : {16, 128}) {
+        for (std::size_t numThreads : {1, 8}) {
+            log() << "THROUGHPUT executor broadcasts/s to " << numTargets << " targets with "
+                  << numThreads
+                  << " threads, per-command: " << broadcastsPerSecond(numThreads, numTargets, false)
+                  << ", batched: " << broadcastsPerSecond(numThreads, numTargets, true);
+        }
+    }
+}
+
 }  // namespace
 }  // namespace executor
 }  // namespace bongo
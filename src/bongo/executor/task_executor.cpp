@@ -67,6 +67,16 @@ TaskExecutor::RemoteCommandCallbackArgs::RemoteCommandCallbackArgs(
     const ResponseStatus& theResponse)
     : executor(theExecutor), myHandle(theHandle), request(theRequest), response(theResponse) {}
 
+std::vector<StatusWith<TaskExecutor::CallbackHandle>> TaskExecutor::scheduleRemoteCommands(
+    const std::vector<RemoteCommandBatchEntry>& batch) {
+    std::vector<StatusWith<CallbackHandle>> cbHandles;
+    cbHandles.reserve(batch.size());
+    for (auto&& entry : batch) {
+        cbHandles.push_back(scheduleRemoteCommand(entry.request, entry.cb));
+    }
+    return cbHandles;
+}
+
 TaskExecutor::CallbackState* TaskExecutor::getCallbackFromHandle(const CallbackHandle& cbHandle) {
     return cbHandle.getCallback();
 }
@@ -31,6 +31,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "bongo/base/disallow_copying.h"
 #include "bongo/base/status.h"
@@ -105,6 +106,15 @@ public:
      */
     using RemoteCommandCallbackFn = stdx::function<void(const RemoteCommandCallbackArgs&)>;
 
+    /**
+     * A remote command and the callback to run with its result, as passed to
+     * scheduleRemoteCommands().
+     */
+    struct RemoteCommandBatchEntry {
+        RemoteCommandRequest request;
+        RemoteCommandCallbackFn cb;
+    };
+
     virtual ~TaskExecutor();
 
     /**
@@ -215,6 +225,20 @@ public:
     virtual StatusWith<CallbackHandle> scheduleRemoteCommand(const RemoteCommandRequest& request,
                                                              const RemoteCommandCallbackFn& cb) = 0;
 
+    /**
+     * Schedules each remote command in "batch", such as the requests of a scatter-gather fanout,
+     * as if by calling scheduleRemoteCommand() on each entry in order.
+     *
+     * Returns what scheduleRemoteCommand() would have returned for each entry, in order.
+     *
+     * The default implementation schedules the entries one at a time; implementations may
+     * instead enqueue the whole batch at once.
+     *
+     * May be called by client threads or callbacks running in the executor.
+     */
+    virtual std::vector<StatusWith<CallbackHandle>> scheduleRemoteCommands(
+        const std::vector<RemoteCommandBatchEntry>& batch);
+
     /**
      * If the callback referenced by "cbHandle" hasn't already executed, marks it as
      * canceled and runnable.
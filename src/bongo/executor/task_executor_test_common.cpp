@@ -396,6 +396,63 @@ COMMON_EXECUTOR_TEST(ScheduleRemoteCommand) {
     ASSERT_EQUALS(ErrorCodes::NoSuchKey, status1);
 }
 
+COMMON_EXECUTOR_TEST(ScheduleRemoteCommands) {
+    NetworkInterfaceMock* net = getNet();
+    TaskExecutor& executor = getExecutor();
+    launchExecutorThread();
+    const int kNumTargets = 3;
+    std::vector<Status> statuses(kNumTargets, getDetectableErrorStatus());
+    std::vector<TaskExecutor::RemoteCommandBatchEntry> batch;
+    for (int i = 0; i < kNumTargets; ++i) {
+        const RemoteCommandRequest request(HostAndPort("localhost", 27017 + i),
+                                           "mydb",
+                                           BSON("whatsUp"
+                                                << "doc"),
+                                           nullptr);
+        batch.push_back({request,
+                         stdx::bind(setStatusOnRemoteCommandCompletion,
+                                    stdx::placeholders::_1,
+                                    request,
+                                    &statuses[i])});
+    }
+    auto cbHandles = executor.scheduleRemoteCommands(batch);
+    ASSERT_EQUALS(static_cast<size_t>(kNumTargets), cbHandles.size());
+    net->enterNetwork();
+    for (int i = 0; i < kNumTargets; ++i) {
+        ASSERT(net->hasReadyRequests());
+        NetworkInterfaceMock::NetworkOperationIterator noi = net->getNextReadyRequest();
+        net->scheduleResponse(noi, net->now(), {ErrorCodes::NoSuchKey, "I'm missing"});
+    }
+    net->runReadyNetworkOperations();
+    ASSERT(!net->hasReadyRequests());
+    net->exitNetwork();
+    for (auto&& cbHandle : cbHandles) {
+        executor.wait(unittest::assertGet(cbHandle));
+    }
+    executor.shutdown();
+    joinExecutorThread();
+    for (auto&& status : statuses) {
+        ASSERT_EQUALS(ErrorCodes::NoSuchKey, status);
+    }
+}
+
+COMMON_EXECUTOR_TEST(ScheduleRemoteCommandsButShutdown) {
+    TaskExecutor& executor = getExecutor();
+    const RemoteCommandRequest request(HostAndPort("localhost", 27017),
+                                       "mydb",
+                                       BSON("whatsUp"
+                                            << "doc"),
+                                       nullptr);
+    std::vector<TaskExecutor::RemoteCommandBatchEntry> batch(
+        2, {request, [](const TaskExecutor::RemoteCommandCallbackArgs&) {}});
+    launchExecutorThread();
+    executor.shutdown();
+    joinExecutorThread();
+    for (auto&& cbHandle : executor.scheduleRemoteCommands(batch)) {
+        ASSERT_EQUALS(ErrorCodes::ShutdownInProgress, cbHandle.getStatus());
+    }
+}
+
 COMMON_EXECUTOR_TEST(ScheduleAndCancelRemoteCommand) {
     TaskExecutor& executor = getExecutor();
     Status status1 = getDetectableErrorStatus();
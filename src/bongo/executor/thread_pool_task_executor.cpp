@@ -332,44 +332,99 @@ void remoteCommandFailedEarly(const TaskExecutor::CallbackArgs& cbData,
 
 StatusWith<TaskExecutor::CallbackHandle> ThreadPoolTaskExecutor::scheduleRemoteCommand(
     const RemoteCommandRequest& request, const RemoteCommandCallbackFn& cb) {
+    RemoteCommandRequest scheduledRequest = prepareRemoteCommandRequest(request);
+    auto wq = makeRemoteCommandWorkQueue(scheduledRequest, cb);
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    auto cbHandle = enqueueCallbackState_inlock(&_networkInProgressQueue, &wq);
+    if (!cbHandle.isOK())
+        return cbHandle;
+    const auto cbState = _networkInProgressQueue.back();
+    LOG(3) << "Scheduling remote command request: " << redact(scheduledRequest.toString());
+    lk.unlock();
+    _net->startCommand(cbHandle.getValue(),
+                       scheduledRequest,
+                       makeRemoteCommandCompletionFn(scheduledRequest, cbState, cb));
+    return cbHandle;
+}
+
+std::vector<StatusWith<TaskExecutor::CallbackHandle>>
+ThreadPoolTaskExecutor::scheduleRemoteCommands(const std::vector<RemoteCommandBatchEntry>& batch) {
+    // Do all allocations up front, so that the whole batch is enqueued under a single acquisition
+    // of _mutex and handed to the network interface in one call.
+    std::vector<NetworkInterface::CommandToStart> commands;
+    commands.reserve(batch.size());
+    WorkQueue wq;
+    for (auto&& entry : batch) {
+        commands.push_back({CallbackHandle(), prepareRemoteCommandRequest(entry.request), {}});
+        auto singleton = makeRemoteCommandWorkQueue(commands.back().request, entry.cb);
+        wq.splice(wq.end(), singleton);
+    }
+
+    std::vector<std::shared_ptr<CallbackState>> cbStates(wq.begin(), wq.end());
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_inShutdown) {
+            return std::vector<StatusWith<CallbackHandle>>(
+                batch.size(), Status(ErrorCodes::ShutdownInProgress, "Shutdown in progress"));
+        }
+        _networkInProgressQueue.splice(_networkInProgressQueue.end(), wq);
+    }
+    LOG(3) << "Scheduling batch of " << batch.size() << " remote command requests";
+
+    std::vector<StatusWith<CallbackHandle>> cbHandles;
+    cbHandles.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto& command = commands[i];
+        setCallbackForHandle(&command.cbHandle, cbStates[i]);
+        command.onFinish = makeRemoteCommandCompletionFn(command.request, cbStates[i], batch[i].cb);
+        cbHandles.push_back(command.cbHandle);
+    }
+
+    _net->startCommands(&commands);
+    return cbHandles;
+}
+
+RemoteCommandRequest ThreadPoolTaskExecutor::prepareRemoteCommandRequest(
+    const RemoteCommandRequest& request) {
     RemoteCommandRequest scheduledRequest = request;
     if (request.timeout == RemoteCommandRequest::kNoTimeout) {
         scheduledRequest.expirationDate = RemoteCommandRequest::kNoExpirationDate;
     } else {
         scheduledRequest.expirationDate = _net->now() + scheduledRequest.timeout;
     }
+    return scheduledRequest;
+}
 
+ThreadPoolTaskExecutor::WorkQueue ThreadPoolTaskExecutor::makeRemoteCommandWorkQueue(
+    const RemoteCommandRequest& scheduledRequest, const RemoteCommandCallbackFn& cb) {
     // In case the request fails to even get a connection from the pool,
     // we wrap the callback in a method that prepares its input parameters.
     auto wq = makeSingletonWorkQueue([scheduledRequest, cb](const CallbackArgs& cbData) {
         remoteCommandFailedEarly(cbData, cb, scheduledRequest);
     });
     wq.front()->isNetworkOperation = true;
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-    auto cbHandle = enqueueCallbackState_inlock(&_networkInProgressQueue, &wq);
-    if (!cbHandle.isOK())
-        return cbHandle;
-    const auto cbState = _networkInProgressQueue.back();
-    LOG(3) << "Scheduling remote command request: " << redact(scheduledRequest.toString());
-    lk.unlock();
-    _net->startCommand(
-        cbHandle.getValue(),
-        scheduledRequest,
-        [this, scheduledRequest, cbState, cb](const ResponseStatus& response) {
-            using std::swap;
-            CallbackFn newCb = [cb, scheduledRequest, response](const CallbackArgs& cbData) {
-                remoteCommandFinished(cbData, cb, scheduledRequest, response);
-            };
-            stdx::unique_lock<stdx::mutex> lk(_mutex);
-            if (_inShutdown) {
-                return;
-            }
-            LOG(3) << "Received remote response: "
-                   << redact(response.isOK() ? response.toString() : response.status.toString());
-            swap(cbState->callback, newCb);
-            scheduleIntoPool_inlock(&_networkInProgressQueue, cbState->iter, std::move(lk));
-        });
-    return cbHandle;
+    return wq;
+}
+
+stdx::function<void(const TaskExecutor::ResponseStatus&)>
+ThreadPoolTaskExecutor::makeRemoteCommandCompletionFn(
+    const RemoteCommandRequest& scheduledRequest,
+    std::shared_ptr<CallbackState> cbState,
+    const RemoteCommandCallbackFn& cb) {
+    return [this, scheduledRequest, cbState, cb](const ResponseStatus& response) {
+        using std::swap;
+        CallbackFn newCb = [cb, scheduledRequest, response](const CallbackArgs& cbData) {
+            remoteCommandFinished(cbData, cb, scheduledRequest, response);
+        };
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        if (_inShutdown) {
+            return;
+        }
+        LOG(3) << "Received remote response: "
+               << redact(response.isOK() ? response.toString() : response.status.toString());
+        swap(cbState->callback, newCb);
+        scheduleIntoPool_inlock(&_networkInProgressQueue, cbState->iter, std::move(lk));
+    };
 }
 
 void ThreadPoolTaskExecutor::cancel(const CallbackHandle& cbHandle) {
@@ -78,6 +78,8 @@ public:
     StatusWith<CallbackHandle> scheduleWorkAt(Date_t when, const CallbackFn& work) override;
     StatusWith<CallbackHandle> scheduleRemoteCommand(const RemoteCommandRequest& request,
                                                      const RemoteCommandCallbackFn& cb) override;
+    std::vector<StatusWith<CallbackHandle>> scheduleRemoteCommands(
+        const std::vector<RemoteCommandBatchEntry>& batch) override;
     void cancel(const CallbackHandle& cbHandle) override;
     void wait(const CallbackHandle& cbHandle) override;
 
@@ -103,6 +105,27 @@ private:
      */
     static WorkQueue makeSingletonWorkQueue(CallbackFn work, Date_t when = {});
 
+    /**
+     * Returns a copy of "request" with its expiration date set from its timeout.
+     */
+    RemoteCommandRequest prepareRemoteCommandRequest(const RemoteCommandRequest& request);
+
+    /**
+     * Returns an object suitable for passing to enqueueCallbackState_inlock that represents
+     * running "cb" with the result of "scheduledRequest". Should be called outside of _mutex.
+     */
+    static WorkQueue makeRemoteCommandWorkQueue(const RemoteCommandRequest& scheduledRequest,
+                                                const RemoteCommandCallbackFn& cb);
+
+    /**
+     * Returns the function the network interface calls when "scheduledRequest" completes, which
+     * schedules "cbState" to run "cb" with the response.
+     */
+    stdx::function<void(const ResponseStatus&)> makeRemoteCommandCompletionFn(
+        const RemoteCommandRequest& scheduledRequest,
+        std::shared_ptr<CallbackState> cbState,
+        const RemoteCommandCallbackFn& cb);
+
     /**
      * Moves the single callback in "wq" to the end of "queue". It is required that "wq" was
      * produced via a call to makeSingletonWorkQueue().
@@ -48,7 +48,7 @@ CommandReplyBuilder::CommandReplyBuilder(Message&& message) : _message{std::move
 
 CommandReplyBuilder& CommandReplyBuilder::setRawCommandReply(const BSONObj& commandReply) {
     invariant(_state == State::kCommandReply);
-    commandReply.appendSelfToBufBuilder(_builder);
+    _appendObject(commandReply);
     _state = State::kMetadata;
     return *this;
 }
@@ -81,7 +81,7 @@ Status CommandReplyBuilder::addOutputDocs(DocumentRange outputDocs) {
 
 Status CommandReplyBuilder::addOutputDoc(const BSONObj& outputDoc) {
     invariant(_state == State::kOutputDocs);
-    outputDoc.appendSelfToBufBuilder(_builder);
+    _appendObject(outputDoc);
     return Status::OK();
 }
 
@@ -102,13 +102,23 @@ void CommandReplyBuilder::reset() {
     _builder.reset();
     _builder.skip(bongo::MsgData::MsgDataHeaderSize);
     _message.reset();
+    _outOfLineBytes = 0;
     _state = State::kCommandReply;
 }
 
+void CommandReplyBuilder::_appendObject(const BSONObj& obj) {
+    if (obj.isOwned() && obj.objsize() >= Message::kMinOutOfLineSegmentBytes) {
+        _message.addSegment(_builder.len(), obj.sharedBuffer(), obj.objdata(), obj.objsize());
+        _outOfLineBytes += obj.objsize();
+        return;
+    }
+    obj.appendSelfToBufBuilder(_builder);
+}
+
 Message CommandReplyBuilder::done() {
     invariant(_state == State::kOutputDocs);
     MsgData::View msg = _builder.buf();
-    msg.setLen(_builder.len());
+    msg.setLen(_builder.len() + _outOfLineBytes);
     msg.setOperation(dbCommandReply);
     _message.setData(_builder.release());
     _state = State::kDone;
@@ -79,10 +79,18 @@ public:
     Message done() final;
 
 private:
+    /**
+     * Appends 'obj' to the reply, either by copying it or, for large owned objects, by splicing
+     * its storage into the message as an out-of-line segment.
+     */
+    void _appendObject(const BSONObj& obj);
+
     // Default values are all empty.
     BufBuilder _builder{};
     Message _message;
     State _state{State::kCommandReply};
+    // Bytes of the reply held in out-of-line segments of _message rather than in _builder.
+    std::size_t _outOfLineBytes{0};
 };
 
 }  // namespace rpc
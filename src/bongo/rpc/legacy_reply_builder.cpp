@@ -73,7 +73,11 @@ LegacyReplyBuilder& LegacyReplyBuilder::setCommandReply(Status nonOKStatus,
 
 LegacyReplyBuilder& LegacyReplyBuilder::setRawCommandReply(const BSONObj& commandReply) {
     invariant(_state == State::kCommandReply);
-    commandReply.appendSelfToBufBuilder(_builder);
+    if (commandReply.isOwned() && commandReply.objsize() >= Message::kMinOutOfLineSegmentBytes) {
+        _outOfLineReply = commandReply;
+    } else {
+        commandReply.appendSelfToBufBuilder(_builder);
+    }
     _state = State::kMetadata;
     return *this;
 }
@@ -96,6 +100,11 @@ LegacyReplyBuilder& LegacyReplyBuilder::setMetadata(const BSONObj& metadata) {
     invariant(shardingMetadata.isOK() || shardingMetadata.getStatus() == ErrorCodes::NoSuchKey);
 
     if (shardingMetadata.isOK()) {
+        if (!_outOfLineReply.isEmpty()) {
+            _outOfLineReply.appendSelfToBufBuilder(_builder);
+            _outOfLineReply = BSONObj();
+        }
+
         // Write the sharding metadata in to the end of the object. The third parameter is needed
         // because we already have skipped some bytes for the message header.
         BSONObjBuilder resumedBuilder(
@@ -137,6 +146,7 @@ void LegacyReplyBuilder::reset() {
     _message.reset();
     _state = State::kCommandReply;
     _staleConfigError = false;
+    _outOfLineReply = BSONObj();
 }
 
 
@@ -152,7 +162,17 @@ Message LegacyReplyBuilder::done() {
         qr.setResultFlagsToOk();
     }
 
-    qr.msgdata().setLen(_builder.len());
+    std::size_t outOfLineBytes = 0;
+    if (!_outOfLineReply.isEmpty()) {
+        outOfLineBytes = _outOfLineReply.objsize();
+        _message.addSegment(_builder.len(),
+                            _outOfLineReply.sharedBuffer(),
+                            _outOfLineReply.objdata(),
+                            outOfLineBytes);
+        _outOfLineReply = BSONObj();
+    }
+
+    qr.msgdata().setLen(_builder.len() + outOfLineBytes);
     qr.msgdata().setOperation(opReply);
     qr.setCursorId(0);
     qr.setStartingFrom(0);
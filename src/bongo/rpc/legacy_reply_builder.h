@@ -31,6 +31,7 @@
 #include <memory>
 
 #include "bongo/base/status.h"
+#include "bongo/bson/bsonobj.h"
 #include "bongo/bson/util/builder.h"
 #include "bongo/rpc/document_range.h"
 #include "bongo/rpc/protocol.h"
@@ -74,6 +75,9 @@ private:
     State _state{State::kCommandReply};
     // For stale config errors we need to set the correct ResultFlag.
     bool _staleConfigError{false};
+    // A large owned command reply that done() splices into the message instead of copying. It is
+    // copied into _builder after all if metadata has to be appended to it.
+    BSONObj _outOfLineReply;
 };
 
 }  // namespace rpc
@@ -36,6 +36,7 @@
 #include "bongo/rpc/document_range.h"
 #include "bongo/rpc/legacy_reply.h"
 #include "bongo/rpc/legacy_reply_builder.h"
+#include "bongo/rpc/metadata.h"
 #include "bongo/unittest/death_test.h"
 #include "bongo/unittest/unittest.h"
 
@@ -156,6 +157,98 @@ TEST(LegacyReplyBuilder, MemAccess) {
     ASSERT_BSONOBJ_EQ(parsed.getCommandReply(), commandReply);
 }
 
+BSONObj buildLargeCommand() {
+    BSONObjBuilder bob;
+    bob.append("ok", 1.0);
+    bob.append("data", std::string(2 * Message::kMinOutOfLineSegmentBytes, 'x'));
+    return bob.obj();
+}
+
+std::size_t totalBufferBytes(const Message& msg) {
+    std::size_t total = 0;
+    msg.forEachBuffer([&total](const char*, std::size_t len) { total += len; });
+    return total;
+}
+
+TEST(CommandReplyBuilder, LargeObjectsAreSentOutOfLine) {
+    BSONObj metadata = buildMetadata();
+    BSONObj commandReply = buildLargeCommand();
+    BSONObj outputDoc = buildLargeCommand();
+    rpc::CommandReplyBuilder replyBuilder;
+    replyBuilder.setCommandReply(commandReply);
+    replyBuilder.setMetadata(metadata);
+    ASSERT_OK(replyBuilder.addOutputDoc(outputDoc));
+    auto msg = replyBuilder.done();
+
+    ASSERT_TRUE(msg.isMultiPart());
+    ASSERT_EQ(static_cast<std::size_t>(msg.size()), totalBufferBytes(msg));
+
+    msg.flatten();
+    ASSERT_FALSE(msg.isMultiPart());
+
+    rpc::CommandReply parsed(&msg);
+
+    ASSERT_BSONOBJ_EQ(parsed.getMetadata(), metadata);
+    ASSERT_BSONOBJ_EQ(parsed.getCommandReply(), commandReply);
+    auto outputDocs = parsed.getOutputDocs();
+    auto it = outputDocs.begin();
+    ASSERT_BSONOBJ_EQ(*it, outputDoc);
+    ASSERT_TRUE(++it == outputDocs.end());
+}
+
+TEST(CommandReplyBuilder, UnownedLargeObjectsAreCopied) {
+    BSONObj commandReply = buildLargeCommand();
+    rpc::CommandReplyBuilder replyBuilder;
+    replyBuilder.setCommandReply(BSONObj(commandReply.objdata()));
+    replyBuilder.setMetadata(buildMetadata());
+    auto msg = replyBuilder.done();
+
+    ASSERT_FALSE(msg.isMultiPart());
+
+    rpc::CommandReply parsed(&msg);
+    ASSERT_BSONOBJ_EQ(parsed.getCommandReply(), commandReply);
+}
+
+TEST(LegacyReplyBuilder, LargeReplyIsSentOutOfLine) {
+    BSONObj commandReply = buildLargeCommand();
+    rpc::LegacyReplyBuilder replyBuilder;
+    replyBuilder.setRawCommandReply(commandReply);
+    replyBuilder.setMetadata(rpc::makeEmptyMetadata());
+    auto msg = replyBuilder.done();
+
+    ASSERT_TRUE(msg.isMultiPart());
+    ASSERT_EQ(static_cast<std::size_t>(msg.size()), totalBufferBytes(msg));
+
+    msg.flatten();
+    rpc::LegacyReply parsed(&msg);
+
+    ASSERT_BSONOBJ_EQ(parsed.getCommandReply(), commandReply);
+}
+
+TEST(Message, AdjacentSegmentsAreMerged) {
+    BSONObj first = buildLargeCommand();
+    auto owner = first.sharedBuffer();
+    const char* data = first.objdata();
+    const std::size_t half = first.objsize() / 2;
+
+    Message msg;
+    msg.addSegment(MsgData::MsgDataHeaderSize, owner, data, half);
+    msg.addSegment(MsgData::MsgDataHeaderSize, owner, data + half, first.objsize() - half);
+
+    auto head = SharedBuffer::allocate(MsgData::MsgDataHeaderSize);
+    MsgData::View(head.get()).setLen(MsgData::MsgDataHeaderSize + first.objsize());
+    msg.setData(std::move(head));
+
+    std::vector<std::size_t> lengths;
+    msg.forEachBuffer([&lengths](const char*, std::size_t len) { lengths.push_back(len); });
+    ASSERT_EQ(2U, lengths.size());
+    ASSERT_EQ(static_cast<std::size_t>(MsgData::MsgDataHeaderSize), lengths[0]);
+    ASSERT_EQ(static_cast<std::size_t>(first.objsize()), lengths[1]);
+
+    msg.flatten();
+    ASSERT_BSONOBJ_EQ(first, BSONObj(msg.singleData().data()));
+}
+
 template <typename T>
 void testRoundTrip(rpc::ReplyBuilderInterface& replyBuilder) {
     auto metadata = buildMetadata();
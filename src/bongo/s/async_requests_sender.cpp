@@ -161,17 +161,20 @@ void AsyncRequestsSender::_scheduleRequestsIfNeeded(OperationContext* txn) {
         return;
     }
 
-    // Schedule remote work on hosts for which we have not sent a request or need to retry.
+    // Schedule remote work on hosts for which we have not sent a request or need to retry. The
+    // whole fanout is handed to the executor at once, so that it is enqueued in a single step.
+    std::vector<size_t> batchRemoteIndexes;
+    std::vector<executor::TaskExecutor::RemoteCommandBatchEntry> batch;
     for (size_t i = 0; i < _remotes.size(); ++i) {
         auto& remote = _remotes[i];
 
         // If we have not yet received a response or error for this remote, and we do not have an
         // outstanding request for this remote, schedule remote work to send the command.
         if (!remote.swResponse && !remote.cbHandle.isValid()) {
-            auto scheduleStatus = _scheduleRequest_inlock(txn, i);
-            if (!scheduleStatus.isOK()) {
+            auto swEntry = _prepareRequest_inlock(txn, i);
+            if (!swEntry.isOK()) {
                 // Being unable to schedule a request to a remote is a non-retriable error.
-                remote.swResponse = std::move(scheduleStatus);
+                remote.swResponse = swEntry.getStatus();
 
                 // If partial results are not allowed, stop scheduling requests on other remotes and
                 // just wait for outstanding requests to come back.
@@ -179,12 +182,36 @@ void AsyncRequestsSender::_scheduleRequestsIfNeeded(OperationContext* txn) {
                     _stopRetrying = true;
                     break;
                 }
+                continue;
             }
+
+            batchRemoteIndexes.push_back(i);
+            batch.push_back(std::move(swEntry.getValue()));
+        }
+    }
+
+    if (batch.empty()) {
+        return;
+    }
+
+    auto cbHandles = _executor->scheduleRemoteCommands(batch);
+    for (size_t i = 0; i < cbHandles.size(); ++i) {
+        auto& remote = _remotes[batchRemoteIndexes[i]];
+        if (!cbHandles[i].isOK()) {
+            // Being unable to schedule a request to a remote is a non-retriable error.
+            remote.swResponse = cbHandles[i].getStatus();
+            if (!_allowPartialResults) {
+                _stopRetrying = true;
+            }
+            continue;
         }
+
+        remote.cbHandle = cbHandles[i].getValue();
     }
 }
 
-Status AsyncRequestsSender::_scheduleRequest_inlock(OperationContext* txn, size_t remoteIndex) {
+StatusWith<executor::TaskExecutor::RemoteCommandBatchEntry>
+AsyncRequestsSender::_prepareRequest_inlock(OperationContext* txn, size_t remoteIndex) {
     auto& remote = _remotes[remoteIndex];
 
     invariant(!remote.cbHandle.isValid());
@@ -198,16 +225,10 @@ Status AsyncRequestsSender::_scheduleRequest_inlock(OperationContext* txn, size_
     executor::RemoteCommandRequest request(
         remote.getTargetHost(), _db, remote.cmdObj, _metadataObj, txn);
 
-    auto callbackStatus = _executor->scheduleRemoteCommand(
-        request,
+    return executor::TaskExecutor::RemoteCommandBatchEntry{
+        std::move(request),
         stdx::bind(
-            &AsyncRequestsSender::_handleResponse, this, stdx::placeholders::_1, txn, remoteIndex));
-    if (!callbackStatus.isOK()) {
-        return callbackStatus.getStatus();
-    }
-
-    remote.cbHandle = callbackStatus.getValue();
-    return Status::OK();
+            &AsyncRequestsSender::_handleResponse, this, stdx::placeholders::_1, txn, remoteIndex)};
 }
 
 void AsyncRequestsSender::_handleResponse(
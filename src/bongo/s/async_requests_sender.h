@@ -155,21 +155,23 @@ private:
      * Replaces _notification with a new notification.
      *
      * If _stopRetrying is false, for each remote that does not have a response or outstanding
-     * request, schedules work to send the command to the remote.
+     * request, schedules work to send the command to the remote. The requests are handed to the
+     * executor as a single batch.
      *
      * Invalid to call if there is an existing Notification and it has not yet been signaled.
      */
     void _scheduleRequestsIfNeeded(OperationContext* txn);
 
     /**
-     * Helper to schedule a command to a remote.
+     * Helper to build the request, and its callback, which sends the command to a remote.
      *
      * The 'remoteIndex' gives the position of the remote node from which we are retrieving the
      * batch in '_remotes'.
      *
-     * Returns success if the command to retrieve the next batch was scheduled successfully.
+     * Returns an error if the remote's host could not be resolved.
      */
-    Status _scheduleRequest_inlock(OperationContext* txn, size_t remoteIndex);
+    StatusWith<executor::TaskExecutor::RemoteCommandBatchEntry> _prepareRequest_inlock(
+        OperationContext* txn, size_t remoteIndex);
 
     /**
      * The callback for a remote command.
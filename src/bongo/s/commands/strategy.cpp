@@ -45,7 +45,6 @@
 #include "bongo/db/lasterror.h"
 #include "bongo/db/matcher/extensions_callback_noop.h"
 #include "bongo/db/namespace_string.h"
-#include "bongo/db/query/find_common.h"
 #include "bongo/db/query/getmore_request.h"
 #include "bongo/db/query/query_request.h"
 #include "bongo/db/stats/counters.h"
@@ -126,7 +125,9 @@ void execCommandHandler(OperationContext* txn,
 
     execCommandClient(txn, command, queryFlags, request.getDatabase().rawData(), cmdObj, result);
 
-    replyBuilder->setCommandReply(result.done()).setMetadata(rpc::makeEmptyMetadata());
+    // obj() rather than done() so that the reply owns its buffer, which lets large replies be
+    // sent without another copy.
+    replyBuilder->setCommandReply(result.obj()).setMetadata(rpc::makeEmptyMetadata());
 }
 
 BONGO_INITIALIZER(InitializeCommandExecCommandHandler)(InitializerContext* const) {
@@ -237,7 +238,7 @@ void Strategy::queryOp(OperationContext* txn, const NamespaceString& nss, DbMess
     int numResults = 0;
     OpQueryReplyBuilder reply;
     for (auto&& obj : batch) {
-        obj.appendSelfToBufBuilder(reply.bufBuilderForResults());
+        reply.appendResult(obj);
         numResults++;
     }
 
@@ -445,23 +446,22 @@ void Strategy::getMore(OperationContext* txn, const NamespaceString& nss, DbMess
     }
     uassertStatusOK(cursorResponse.getStatus());
 
-    // Build the response document.
-    BufBuilder buffer(FindCommon::kInitReplyBufferSize);
+    // Build the response. Documents that still share the buffers of the shard responses are
+    // spliced into it rather than copied.
+    OpQueryReplyBuilder reply;
 
     int numResults = 0;
     for (const auto& obj : cursorResponse.getValue().getBatch()) {
-        buffer.appendBuf((void*)obj.objdata(), obj.objsize());
+        reply.appendResult(obj);
         ++numResults;
     }
 
-    replyToQuery(0,
-                 client->session(),
-                 dbm->msg(),
-                 buffer.buf(),
-                 buffer.len(),
-                 numResults,
-                 cursorResponse.getValue().getNumReturnedSoFar().value_or(0),
-                 cursorResponse.getValue().getCursorId());
+    reply.send(client->session(),
+               0,  // query result flags
+               dbm->msg(),
+               numResults,
+               cursorResponse.getValue().getNumReturnedSoFar().value_or(0),
+               cursorResponse.getValue().getCursorId());
 }
 
 void Strategy::killCursors(OperationContext* txn, DbMessage* dbm) {
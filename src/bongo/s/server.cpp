@@ -85,7 +85,7 @@
 #include "bongo/s/version_bongos.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/stdx/thread.h"
-#include "bongo/transport/transport_layer_legacy.h"
+#include "bongo/transport/transport_layer_factory.h"
 #include "bongo/util/admin_access.h"
 #include "bongo/util/cmdline_utils/censor_cmdline.h"
 #include "bongo/util/concurrency/thread_name.h"
@@ -145,6 +145,15 @@ static void cleanupTask() {
         if (serviceContext)
             serviceContext->setKillAllOperations();
 
+        // Stop handing requests to the service executor, and give in-flight ones (which have
+        // just been interrupted) a chance to finish.
+        if (serviceContext && serviceContext->getServiceExecutor()) {
+            auto status = serviceContext->getServiceExecutor()->shutdown();
+            if (!status.isOK()) {
+                log(LogComponent::kNetwork) << "shutdown: " << status;
+            }
+        }
+
         if (auto cursorManager = Grid::get(txn)->getCursorManager()) {
             cursorManager->shutdown();
         }
@@ -239,21 +248,20 @@ static ExitCode runBongosServer() {
 
     _initWireSpec();
 
-    transport::TransportLayerLegacy::Options opts;
-    opts.port = serverGlobalParams.port;
-    opts.ipList = serverGlobalParams.bind_ip;
-
     auto sep =
         stdx::make_unique<ServiceEntryPointBongos>(getGlobalServiceContext()->getTransportLayer());
     auto sepPtr = sep.get();
 
     getGlobalServiceContext()->setServiceEntryPoint(std::move(sep));
+    getGlobalServiceContext()->setServiceExecutor(transport::makeServiceExecutor());
 
-    auto transportLayer = stdx::make_unique<transport::TransportLayerLegacy>(opts, sepPtr);
-    auto res = transportLayer->setup();
-    if (!res.isOK()) {
+    auto swTransportLayer = transport::makeAndSetupTransportLayer(
+        serverGlobalParams.bind_ip, serverGlobalParams.port, sepPtr);
+    if (!swTransportLayer.isOK()) {
+        error() << "Failed to set up listener: " << swTransportLayer.getStatus();
         return EXIT_NET_ERROR;
     }
+    auto transportLayer = std::move(swTransportLayer.getValue());
 
     // Add sharding hooks to both connection pools - ShardingConnectionHook includes auth hooks
     globalConnPool.addHook(new ShardingConnectionHook(
@@ -333,6 +341,14 @@ static ExitCode runBongosServer() {
 
     PeriodicTask::startRunningPeriodicTasks();
 
+    if (auto svcExec = getGlobalServiceContext()->getServiceExecutor()) {
+        auto status = svcExec->start();
+        if (!status.isOK()) {
+            error() << "Failed to start the service executor: " << status;
+            return EXIT_NET_ERROR;
+        }
+    }
+
     auto start = getGlobalServiceContext()->addAndStartTransportLayer(std::move(transportLayer));
     if (!start.isOK()) {
         return EXIT_NET_ERROR;
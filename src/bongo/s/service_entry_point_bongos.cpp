@@ -69,6 +69,16 @@ BSONObj buildErrReply(const DBException& ex) {
 ServiceEntryPointBongos::ServiceEntryPointBongos(TransportLayer* tl) : _tl(tl) {}
 
 void ServiceEntryPointBongos::startSession(transport::SessionHandle session) {
+    if (auto executor = getGlobalServiceContext()->getServiceExecutor()) {
+        launchServiceEntryStateMachine(
+            std::move(session),
+            executor,
+            [this](const transport::SessionHandle& session, Message* message) {
+                _processMessage(session, message);
+            });
+        return;
+    }
+
     launchWrappedServiceEntryWorkerThread(
         std::move(session),
         [this](const transport::SessionHandle& session) { _sessionLoop(session); });
@@ -78,9 +88,6 @@ void ServiceEntryPointBongos::_sessionLoop(const transport::SessionHandle& sessi
     int64_t counter = 0;
 
     while (true) {
-        // Release any cached egress connections for client back to pool before destroying
-        auto guard = MakeGuard(ShardConnection::releaseMyConnections);
-
         Message message;
 
         // Source a Message from the client
@@ -100,84 +107,94 @@ void ServiceEntryPointBongos::_sessionLoop(const transport::SessionHandle& sessi
             uassertStatusOK(status);
         }
 
-        auto txn = cc().makeOperationContext();
+        _processMessage(session, &message);
 
-        const int32_t msgId = message.header().getId();
+        if ((counter++ & 0xf) == 0) {
+            markThreadIdle();
+        }
+    }
+}
 
-        const NetworkOp op = message.operation();
+void ServiceEntryPointBongos::_processMessage(const transport::SessionHandle& session,
+                                              Message* messagePtr) {
+    // Release any cached egress connections for client back to pool before destroying
+    auto guard = MakeGuard(ShardConnection::releaseMyConnections);
 
-        // This exception will not be returned to the caller, but will be logged and will close the
-        // connection
-        uassert(ErrorCodes::IllegalOperation,
-                str::stream() << "Message type " << op << " is not supported.",
-                op > dbMsg);
+    Message& message = *messagePtr;
 
-        // Start a new LastError session. Any exceptions thrown from here onwards will be returned
-        // to the caller (if the type of the message permits it).
-        ClusterLastErrorInfo::get(txn->getClient()).newRequest();
-        LastError::get(txn->getClient()).startRequest();
+    auto txn = cc().makeOperationContext();
 
-        DbMessage dbm(message);
+    const int32_t msgId = message.header().getId();
 
-        NamespaceString nss;
+    const NetworkOp op = message.operation();
 
-        try {
+    // This exception will not be returned to the caller, but will be logged and will close the
+    // connection
+    uassert(ErrorCodes::IllegalOperation,
+            str::stream() << "Message type " << op << " is not supported.",
+            op > dbMsg);
 
-            if (dbm.messageShouldHaveNs()) {
-                nss = NamespaceString(StringData(dbm.getns()));
+    // Start a new LastError session. Any exceptions thrown from here onwards will be returned
+    // to the caller (if the type of the message permits it).
+    ClusterLastErrorInfo::get(txn->getClient()).newRequest();
+    LastError::get(txn->getClient()).startRequest();
 
-                uassert(ErrorCodes::InvalidNamespace,
-                        str::stream() << "Invalid ns [" << nss.ns() << "]",
-                        nss.isValid());
+    DbMessage dbm(message);
 
-                uassert(ErrorCodes::IllegalOperation,
-                        "Can't use 'local' database through bongos",
-                        nss.db() != NamespaceString::kLocalDb);
-            }
+    NamespaceString nss;
 
-            AuthorizationSession::get(txn->getClient())->startRequest(txn.get());
-
-            LOG(3) << "Request::process begin ns: " << nss << " msg id: " << msgId
-                   << " op: " << networkOpToString(op);
-
-            switch (op) {
-                case dbQuery:
-                    if (nss.isCommand() || nss.isSpecialCommand()) {
-                        Strategy::clientCommandOp(txn.get(), nss, &dbm);
-                    } else {
-                        Strategy::queryOp(txn.get(), nss, &dbm);
-                    }
-                    break;
-                case dbGetMore:
-                    Strategy::getMore(txn.get(), nss, &dbm);
-                    break;
-                case dbKillCursors:
-                    Strategy::killCursors(txn.get(), &dbm);
-                    break;
-                default:
-                    Strategy::writeOp(txn.get(), &dbm);
-                    break;
-            }
+    try {
 
-            LOG(3) << "Request::process end ns: " << nss << " msg id: " << msgId
-                   << " op: " << networkOpToString(op);
+        if (dbm.messageShouldHaveNs()) {
+            nss = NamespaceString(StringData(dbm.getns()));
 
-        } catch (const DBException& ex) {
-            LOG(1) << "Exception thrown"
-                   << " while processing " << networkOpToString(op) << " op"
-                   << " for " << nss.ns() << causedBy(ex);
+            uassert(ErrorCodes::InvalidNamespace,
+                    str::stream() << "Invalid ns [" << nss.ns() << "]",
+                    nss.isValid());
 
-            if (op == dbQuery || op == dbGetMore) {
-                replyToQuery(ResultFlag_ErrSet, session, message, buildErrReply(ex));
-            }
+            uassert(ErrorCodes::IllegalOperation,
+                    "Can't use 'local' database through bongos",
+                    nss.db() != NamespaceString::kLocalDb);
+        }
 
-            // We *always* populate the last error for now
-            LastError::get(txn->getClient()).setLastError(ex.getCode(), ex.what());
+        AuthorizationSession::get(txn->getClient())->startRequest(txn.get());
+
+        LOG(3) << "Request::process begin ns: " << nss << " msg id: " << msgId
+               << " op: " << networkOpToString(op);
+
+        switch (op) {
+            case dbQuery:
+                if (nss.isCommand() || nss.isSpecialCommand()) {
+                    Strategy::clientCommandOp(txn.get(), nss, &dbm);
+                } else {
+                    Strategy::queryOp(txn.get(), nss, &dbm);
+                }
+                break;
+            case dbGetMore:
+                Strategy::getMore(txn.get(), nss, &dbm);
+                break;
+            case dbKillCursors:
+                Strategy::killCursors(txn.get(), &dbm);
+                break;
+            default:
+                Strategy::writeOp(txn.get(), &dbm);
+                break;
         }
 
-        if ((counter++ & 0xf) == 0) {
-            markThreadIdle();
+        LOG(3) << "Request::process end ns: " << nss << " msg id: " << msgId
+               << " op: " << networkOpToString(op);
+
+    } catch (const DBException& ex) {
+        LOG(1) << "Exception thrown"
+               << " while processing " << networkOpToString(op) << " op"
+               << " for " << nss.ns() << causedBy(ex);
+
+        if (op == dbQuery || op == dbGetMore) {
+            replyToQuery(ResultFlag_ErrSet, session, message, buildErrReply(ex));
         }
+
+        // We *always* populate the last error for now
+        LastError::get(txn->getClient()).setLastError(ex.getCode(), ex.what());
     }
 }
 
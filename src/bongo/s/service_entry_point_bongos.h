@@ -35,6 +35,8 @@
 
 namespace bongo {
 
+class Message;
+
 namespace transport {
 class Session;
 class TransportLayer;
@@ -42,7 +44,8 @@ class TransportLayer;
 
 /**
  * The entry point from the TransportLayer into Bongos. startSession() spawns and
- * detaches a new thread for each incoming connection (transport::Session).
+ * detaches a new thread for each incoming connection (transport::Session), unless the
+ * ServiceContext has a ServiceExecutor, in which case requests are run on its threads.
  */
 class ServiceEntryPointBongos final : public ServiceEntryPoint {
     BONGO_DISALLOW_COPYING(ServiceEntryPointBongos);
@@ -57,6 +60,12 @@ public:
 private:
     void _sessionLoop(const transport::SessionHandle& session);
 
+    /**
+     * Runs a single Message sourced from 'session', replying to it if the operation calls for
+     * a reply.
+     */
+    void _processMessage(const transport::SessionHandle& session, Message* message);
+
     transport::TransportLayer* _tl;
 };
 
@@ -32,6 +32,7 @@
 
 #include "bongo/s/sharding_initialization.h"
 
+#include <algorithm>
 #include <string>
 
 #include "bongo/base/status.h"
@@ -82,6 +83,9 @@ BONGO_EXPORT_STARTUP_SERVER_PARAMETER(ShardingTaskExecutorPoolRefreshRequirement
 BONGO_EXPORT_STARTUP_SERVER_PARAMETER(ShardingTaskExecutorPoolRefreshTimeoutMS,
                                       int,
                                       ConnectionPool::kDefaultRefreshTimeout.count());
+// Commands the task executor pool may have in flight on each shard connection; 1 disables
+// pipelining.
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(ShardingTaskExecutorPoolMaxPipelineDepth, int, 1);
 
 namespace {
 
@@ -115,7 +119,8 @@ std::unique_ptr<ShardingCatalogClient> makeCatalogClient(ServiceContext* service
 std::unique_ptr<TaskExecutorPool> makeTaskExecutorPool(
     std::unique_ptr<NetworkInterface> fixedNet,
     rpc::ShardingEgressMetadataHookBuilder metadataHookBuilder,
-    ConnectionPool::Options connPoolOptions) {
+    ConnectionPool::Options connPoolOptions,
+    size_t maxPipelineDepth) {
     std::vector<std::unique_ptr<executor::TaskExecutor>> executors;
 
     for (size_t i = 0; i < TaskExecutorPool::getSuggestedPoolSize(); ++i) {
@@ -123,7 +128,8 @@ std::unique_ptr<TaskExecutorPool> makeTaskExecutorPool(
             "NetworkInterfaceASIO-TaskExecutorPool-" + std::to_string(i),
             stdx::make_unique<ShardingNetworkConnectionHook>(),
             metadataHookBuilder(),
-            connPoolOptions);
+            connPoolOptions,
+            maxPipelineDepth);
         auto netPtr = net.get();
         auto exec = stdx::make_unique<ThreadPoolTaskExecutor>(
             stdx::make_unique<NetworkInterfaceThreadPool>(netPtr), std::move(net));
@@ -183,7 +189,9 @@ Status initializeGlobalShardingState(OperationContext* txn,
                                        hookBuilder(),
                                        connPoolOptions);
     auto networkPtr = network.get();
-    auto executorPool = makeTaskExecutorPool(std::move(network), hookBuilder, connPoolOptions);
+    const size_t maxPipelineDepth = std::max(ShardingTaskExecutorPoolMaxPipelineDepth, 1);
+    auto executorPool =
+        makeTaskExecutorPool(std::move(network), hookBuilder, connPoolOptions, maxPipelineDepth);
     executorPool->startup();
 
     auto shardRegistry(stdx::make_unique<ShardRegistry>(std::move(shardFactory), configCS));
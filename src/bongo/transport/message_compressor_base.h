@@ -39,6 +39,8 @@ namespace bongo {
 enum class MessageCompressor : uint8_t {
     kNoop = 0,
     kSnappy = 1,
+    kZlib = 2,
+    kZstd = 3,
     kExtended = 255,
 };
 
@@ -113,6 +115,34 @@ public:
         return _decompressBytesOut.loadRelaxed();
     }
 
+    /*
+     * This returns the total time, in microseconds, spent in compressData
+     */
+    int64_t getCompressTimeMicros() const {
+        return _compressMicros.loadRelaxed();
+    }
+
+    /*
+     * This returns the total time, in microseconds, spent in decompressData
+     */
+    int64_t getDecompressTimeMicros() const {
+        return _decompressMicros.loadRelaxed();
+    }
+
+    /*
+     * Called by the MessageCompressorManager to account for the time spent in compressData.
+     * This is wall-clock time, so it includes any time the calling thread was not scheduled.
+     */
+    void counterHitCompressTime(int64_t micros) {
+        _compressMicros.addAndFetch(micros);
+    }
+
+    /*
+     * Called by the MessageCompressorManager to account for the time spent in decompressData
+     */
+    void counterHitDecompressTime(int64_t micros) {
+        _decompressMicros.addAndFetch(micros);
+    }
 
 protected:
     /*
@@ -147,5 +177,8 @@ private:
 
     AtomicInt64 _decompressBytesIn;
     AtomicInt64 _decompressBytesOut;
+
+    AtomicInt64 _compressMicros;
+    AtomicInt64 _decompressMicros;
 };
 }  // namespace bongo
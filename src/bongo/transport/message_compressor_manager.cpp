@@ -40,6 +40,7 @@
 #include "bongo/transport/session.h"
 #include "bongo/util/log.h"
 #include "bongo/util/net/message.h"
+#include "bongo/util/timer.h"
 
 namespace bongo {
 namespace {
@@ -85,6 +86,14 @@ StatusWith<Message> MessageCompressorManager::compressMessage(const Message& msg
     if (_negotiated.size() == 0) {
         return {msg};
     }
+
+    if (msg.isMultiPart()) {
+        // The compressors need their input contiguous in memory.
+        Message flatMsg(msg);
+        flatMsg.flatten();
+        return compressMessage(flatMsg);
+    }
+
     auto compressor = _negotiated[0];
 
     LOG(3) << "Compressing message with " << compressor->getName();
@@ -114,7 +123,9 @@ StatusWith<Message> MessageCompressorManager::compressMessage(const Message& msg
     compressionHeader.serialize(&output);
     ConstDataRange input(inputHeader.data(), inputHeader.data() + inputHeader.dataLen());
 
+    Timer timer;
     auto sws = compressor->compressData(input, output);
+    compressor->counterHitCompressTime(timer.micros());
 
     if (!sws.isOK())
         return sws.getStatus();
@@ -146,7 +157,9 @@ StatusWith<Message> MessageCompressorManager::decompressMessage(const Message& m
 
     DataRangeCursor output(outMessage.data(), outMessage.data() + outMessage.dataLen());
 
+    Timer timer;
     auto sws = compressor->decompressData(input, output);
+    compressor->counterHitDecompressTime(timer.micros());
 
     if (!sws.isOK())
         return sws.getStatus();
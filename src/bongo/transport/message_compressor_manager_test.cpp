@@ -29,10 +29,15 @@
 #include "bongo/platform/basic.h"
 
 #include "bongo/bson/bsonobjbuilder.h"
+#include "bongo/config.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/transport/message_compressor_manager.h"
 #include "bongo/transport/message_compressor_noop.h"
 #include "bongo/transport/message_compressor_registry.h"
+#include "bongo/transport/message_compressor_zlib.h"
+#ifdef BONGO_CONFIG_ZSTD_COMPRESSOR
+#include "bongo/transport/message_compressor_zstd.h"
+#endif
 #include "bongo/unittest/unittest.h"
 #include "bongo/util/net/message.h"
 
@@ -182,5 +187,64 @@ TEST(SnappyMessageCompressor, Fidelity) {
     checkFidelity(testMessage, stdx::make_unique<NoopMessageCompressor>());
 }
 
+TEST(ZlibMessageCompressor, Fidelity) {
+    auto testMessage = buildMessage();
+    checkFidelity(testMessage, stdx::make_unique<ZlibMessageCompressor>());
+}
+
+TEST(ZlibMessageCompressor, CountsBytes) {
+    auto testMessage = buildMessage();
+    ZlibMessageCompressor compressor;
+    const auto inputView = testMessage.singleData();
+    ConstDataRange input(inputView.data(), inputView.data() + inputView.dataLen());
+
+    std::vector<char> compressed(compressor.getMaxCompressedSize(input.length()));
+    auto swCompressed =
+        compressor.compressData(input, DataRange(compressed.data(), compressed.size()));
+    ASSERT_OK(swCompressed.getStatus());
+    ASSERT_EQ(compressor.getCompressedBytesIn(), inputView.dataLen());
+    ASSERT_EQ(compressor.getCompressedBytesOut(), static_cast<int64_t>(swCompressed.getValue()));
+
+    std::vector<char> decompressed(inputView.dataLen());
+    auto swDecompressed = compressor.decompressData(
+        ConstDataRange(compressed.data(), swCompressed.getValue()),
+        DataRange(decompressed.data(), decompressed.size()));
+    ASSERT_OK(swDecompressed.getStatus());
+    ASSERT_EQ(swDecompressed.getValue(), static_cast<size_t>(inputView.dataLen()));
+    ASSERT_EQ(compressor.getDecompressedBytesIn(), static_cast<int64_t>(swCompressed.getValue()));
+    ASSERT_EQ(compressor.getDecompressedBytesOut(), inputView.dataLen());
+    ASSERT_EQ(memcmp(decompressed.data(), inputView.data(), inputView.dataLen()), 0);
+}
+
+TEST(ZlibMessageCompressor, RejectsCorruptInput) {
+    ZlibMessageCompressor compressor;
+    const std::string garbage = "this is not zlib data";
+    std::vector<char> output(1024);
+    auto sw = compressor.decompressData(ConstDataRange(garbage.data(), garbage.size()),
+                                        DataRange(output.data(), output.size()));
+    ASSERT_EQ(ErrorCodes::BadValue, sw.getStatus());
+}
+
+#ifdef BONGO_CONFIG_ZSTD_COMPRESSOR
+TEST(ZstdMessageCompressor, Fidelity) {
+    auto testMessage = buildMessage();
+    checkFidelity(testMessage, stdx::make_unique<ZstdMessageCompressor>());
+}
+
+TEST(ZstdMessageCompressor, FidelityAtLowestLevel) {
+    auto testMessage = buildMessage();
+    checkFidelity(testMessage, stdx::make_unique<ZstdMessageCompressor>(1));
+}
+
+TEST(ZstdMessageCompressor, RejectsCorruptInput) {
+    ZstdMessageCompressor compressor;
+    const std::string garbage = "this is not zstd data";
+    std::vector<char> output(1024);
+    auto sw = compressor.decompressData(ConstDataRange(garbage.data(), garbage.size()),
+                                        DataRange(output.data(), output.size()));
+    ASSERT_EQ(ErrorCodes::BadValue, sw.getStatus());
+}
+#endif
+
 }  // namespace bongo
 }  // namespace
@@ -31,6 +31,7 @@
 #include "bongo/transport/message_compressor_registry.h"
 
 #include "bongo/base/init.h"
+#include "bongo/config.h"
 #include "bongo/stdx/memory.h"
 #include "bongo/transport/message_compressor_noop.h"
 #include "bongo/transport/message_compressor_snappy.h"
@@ -47,6 +48,10 @@ StringData getMessageCompressorName(MessageCompressor id) {
             return "noop"_sd;
         case MessageCompressor::kSnappy:
             return "snappy"_sd;
+        case MessageCompressor::kZlib:
+            return "zlib"_sd;
+        case MessageCompressor::kZstd:
+            return "zstd"_sd;
         default:
             fassert(40269, "Invalid message compressor ID");
     }
@@ -115,6 +120,18 @@ Status addMessageCompressionOptions(moe::OptionSection* options, bool forShell)
     if (forShell)
         ret.hidden();
 
+#ifdef BONGO_CONFIG_ZSTD_COMPRESSOR
+    auto zstdLevel =
+        options
+            ->addOptionChaining("net.compression.zstdCompressionLevel",
+                                "networkMessageZstdCompressionLevel",
+                                moe::Int,
+                                "Compression level for the zstd network message compressor")
+            .setDefault(moe::Value(3));
+    if (forShell)
+        zstdLevel.hidden();
+#endif
+
     return Status::OK();
 }
 
@@ -0,0 +1,103 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kNetwork
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/transport/message_compressor_zstd.h"
+
+#include <zstd.h>
+
+#include "bongo/base/init.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/transport/message_compressor_registry.h"
+#include "bongo/util/bongoutils/str.h"
+#include "bongo/util/options_parser/startup_options.h"
+
+namespace bongo {
+
+constexpr int ZstdMessageCompressor::kDefaultLevel;
+
+ZstdMessageCompressor::ZstdMessageCompressor(int level)
+    : MessageCompressorBase(MessageCompressor::kZstd), _level(level) {}
+
+std::size_t ZstdMessageCompressor::getMaxCompressedSize(size_t inputSize) {
+    return ZSTD_compressBound(inputSize);
+}
+
+StatusWith<std::size_t> ZstdMessageCompressor::compressData(ConstDataRange input,
+                                                            DataRange output) {
+    size_t ret = ZSTD_compress(
+        const_cast<char*>(output.data()), output.length(), input.data(), input.length(), _level);
+
+    if (ZSTD_isError(ret)) {
+        return Status{ErrorCodes::InternalError,
+                      str::stream() << "ZSTD_compress failed: " << ZSTD_getErrorName(ret)};
+    }
+
+    counterHitCompress(input.length(), ret);
+    return {ret};
+}
+
+StatusWith<std::size_t> ZstdMessageCompressor::decompressData(ConstDataRange input,
+                                                              DataRange output) {
+    size_t ret = ZSTD_decompress(
+        const_cast<char*>(output.data()), output.length(), input.data(), input.length());
+
+    if (ZSTD_isError(ret)) {
+        return Status{ErrorCodes::BadValue, "Compressed message was invalid or corrupted"};
+    }
+
+    counterHitDecompress(input.length(), ret);
+    return {ret};
+}
+
+
+BONGO_INITIALIZER_GENERAL(ZstdMessageCompressorInit,
+                          ("EndStartupOptionHandling"),
+                          ("AllCompressorsRegistered"))
+(InitializerContext* context) {
+    int level = ZstdMessageCompressor::kDefaultLevel;
+    const auto& params = optionenvironment::startupOptionsParsed;
+    if (params.count("net.compression.zstdCompressionLevel")) {
+        level = params["net.compression.zstdCompressionLevel"].as<int>();
+    }
+    if (level < 1 || level > ZSTD_maxCLevel()) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "zstd compression level must be between 1 and "
+                                    << ZSTD_maxCLevel()
+                                    << ", got "
+                                    << level);
+    }
+
+    auto& compressorRegistry = MessageCompressorRegistry::get();
+    compressorRegistry.registerImplementation(stdx::make_unique<ZstdMessageCompressor>(level));
+    return Status::OK();
+}
+}  // namespace bongo
@@ -34,13 +34,19 @@
 
 #include "bongo/db/client.h"
 #include "bongo/db/server_options.h"
+#include "bongo/db/service_context.h"
 #include "bongo/stdx/memory.h"
+#include "bongo/transport/service_executor.h"
 #include "bongo/transport/session.h"
+#include "bongo/transport/ticket.h"
 #include "bongo/transport/transport_layer.h"
 #include "bongo/util/assert_util.h"
+#include "bongo/util/concurrency/thread_name.h"
 #include "bongo/util/debug_util.h"
 #include "bongo/util/log.h"
+#include "bongo/util/net/message.h"
 #include "bongo/util/net/socket_exception.h"
+#include "bongo/util/net/thread_idle_callback.h"
 #include "bongo/util/quick_exit.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
@@ -56,26 +62,13 @@ namespace bongo {
 namespace {
 
 /**
- * This object takes ownership of transport::SessionHandle.
+ * Runs 'task' on behalf of a client session. Returns false if the task threw an exception that
+ * should close the connection. Any other exception terminates the process.
  */
-struct Context {
-    Context(transport::SessionHandle session,
-            stdx::function<void(const transport::SessionHandle&)> task)
-        : session(std::move(session)), task(std::move(task)) {}
-
-    transport::SessionHandle session;
-    stdx::function<void(const transport::SessionHandle&)> task;
-};
-
-void* runFunc(void* ptr) {
-    std::unique_ptr<Context> ctx(static_cast<Context*>(ptr));
-
-    auto tl = ctx->session->getTransportLayer();
-    Client::initThread("conn", ctx->session);
-    setThreadName(std::string(str::stream() << "conn" << ctx->session->id()));
-
+bool runSessionTask(const stdx::function<void()>& task) {
     try {
-        ctx->task(ctx->session);
+        task();
+        return true;
     } catch (const AssertionException& e) {
         log() << "AssertionException handling request, closing client connection: " << e;
     } catch (const SocketException& e) {
@@ -87,20 +80,136 @@ void* runFunc(void* ptr) {
         error() << "Uncaught std::exception: " << e.what() << ", terminating";
         quickExit(EXIT_UNCAUGHT);
     }
+    return false;
+}
 
-    tl->end(ctx->session);
+/**
+ * Ends 'session' on its TransportLayer and logs the connection count.
+ */
+void endSession(const transport::SessionHandle& session) {
+    auto tl = session->getTransportLayer();
+    tl->end(session);
 
     if (!serverGlobalParams.quiet.load()) {
         auto conns = tl->sessionStats().numOpenSessions;
         const char* word = (conns == 1 ? " connection" : " connections");
-        log() << "end connection " << ctx->session->remote() << " (" << conns << word
-              << " now open)";
+        log() << "end connection " << session->remote() << " (" << conns << word << " now open)";
     }
+}
+
+/**
+ * This object takes ownership of transport::SessionHandle.
+ */
+struct Context {
+    Context(transport::SessionHandle session,
+            stdx::function<void(const transport::SessionHandle&)> task)
+        : session(std::move(session)), task(std::move(task)) {}
+
+    transport::SessionHandle session;
+    stdx::function<void(const transport::SessionHandle&)> task;
+};
+
+void* runFunc(void* ptr) {
+    std::unique_ptr<Context> ctx(static_cast<Context*>(ptr));
+
+    Client::initThread("conn", ctx->session);
+    setThreadName(std::string(str::stream() << "conn" << ctx->session->id()));
+
+    runSessionTask([&ctx] { ctx->task(ctx->session); });
+
+    endSession(ctx->session);
 
     Client::destroy();
 
     return nullptr;
 }
+
+/**
+ * Drives a session through source -> handle -> source... without owning a thread. Sourcing
+ * completes on the TransportLayer's threads, and handling runs on the ServiceExecutor. Each step
+ * holds a reference to the state machine, which is destroyed once the session has ended.
+ */
+class ServiceStateMachine : public std::enable_shared_from_this<ServiceStateMachine> {
+public:
+    using HandleRequestFn = stdx::function<void(const transport::SessionHandle&, Message*)>;
+
+    ServiceStateMachine(transport::SessionHandle session,
+                        transport::ServiceExecutor* executor,
+                        HandleRequestFn handleRequest)
+        : _session(std::move(session)),
+          _executor(executor),
+          _handleRequest(std::move(handleRequest)) {}
+
+    void start() {
+        _client = getGlobalServiceContext()->makeClient(
+            str::stream() << "conn" << _session->id(), _session);
+        _sourceMessage();
+    }
+
+private:
+    void _sourceMessage() {
+        _inMessage.reset();
+        auto self = shared_from_this();
+        _session->sourceMessage(&_inMessage).asyncWait([self](Status status) {
+            self->_sourceCallback(std::move(status));
+        });
+    }
+
+    void _sourceCallback(Status status) {
+        if (!status.isOK()) {
+            if (!ErrorCodes::isInterruption(status.code()) &&
+                !ErrorCodes::isNetworkError(status.code()) &&
+                status != transport::TransportLayer::TicketSessionClosedStatus) {
+                log() << "Error receiving request from client, closing client connection: "
+                      << status;
+            }
+            _end();
+            return;
+        }
+
+        auto self = shared_from_this();
+        auto scheduled = _executor->schedule([self] { self->_processMessage(); });
+        if (!scheduled.isOK()) {
+            log() << "Unable to schedule request, closing client connection: " << scheduled;
+            _end();
+        }
+    }
+
+    void _processMessage() {
+        const std::string workerThreadName = getThreadName();
+        setThreadName(_client->desc());
+        Client::setCurrent(std::move(_client));
+
+        const bool keepGoing = runSessionTask([this] { _handleRequest(_session, &_inMessage); });
+
+        _client = Client::releaseCurrent();
+        setThreadName(workerThreadName);
+
+        if ((_counter++ & 0xf) == 0) {
+            markThreadIdle();
+        }
+
+        if (keepGoing) {
+            _sourceMessage();
+        } else {
+            _end();
+        }
+    }
+
+    void _end() {
+        endSession(_session);
+        _client.reset();
+    }
+
+    const transport::SessionHandle _session;
+    transport::ServiceExecutor* const _executor;
+    const HandleRequestFn _handleRequest;
+
+    ServiceContext::UniqueClient _client;
+    Message _inMessage;
+    int64_t _counter = 0;
+};
+
 }  // namespace
 
 void launchWrappedServiceEntryWorkerThread(
@@ -155,4 +264,13 @@ void launchWrappedServiceEntryWorkerThread(
     }
 }
 
+void launchServiceEntryStateMachine(
+    transport::SessionHandle session,
+    transport::ServiceExecutor* executor,
+    stdx::function<void(const transport::SessionHandle&, Message*)> handleRequest) {
+    auto ssm = std::make_shared<ServiceStateMachine>(
+        std::move(session), executor, std::move(handleRequest));
+    ssm->start();
+}
+
 }  // namespace bongo
@@ -33,7 +33,27 @@
 
 namespace bongo {
 
+class Message;
+
+namespace transport {
+class ServiceExecutor;
+}  // namespace transport
+
 void launchWrappedServiceEntryWorkerThread(
     transport::SessionHandle session, stdx::function<void(const transport::SessionHandle&)> task);
 
+/**
+ * Runs 'session' without dedicating a thread to it. Messages are sourced asynchronously from the
+ * session's TransportLayer, and each sourced Message is handed to 'handleRequest' on a thread
+ * owned by 'executor', with the session's Client attached to that thread for the duration of the
+ * call. 'handleRequest' is responsible for sinking any reply.
+ *
+ * The session ends when sourcing fails, when 'handleRequest' throws, or when the executor stops
+ * accepting work. This function returns immediately.
+ */
+void launchServiceEntryStateMachine(
+    transport::SessionHandle session,
+    transport::ServiceExecutor* executor,
+    stdx::function<void(const transport::SessionHandle&, Message*)> handleRequest);
+
 }  // namespace bongo
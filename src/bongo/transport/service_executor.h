@@ -0,0 +1,83 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/base/status.h"
+#include "bongo/stdx/functional.h"
+
+namespace bongo {
+
+class BSONObjBuilder;
+
+namespace transport {
+
+/**
+ * A ServiceExecutor runs the work of processing client requests on behalf of the
+ * ServiceEntryPoint. Implementations decide which threads the work runs on and how many of
+ * them exist at any given time.
+ */
+class ServiceExecutor {
+    BONGO_DISALLOW_COPYING(ServiceExecutor);
+
+public:
+    using Task = stdx::function<void()>;
+
+    virtual ~ServiceExecutor() = default;
+
+    /**
+     * Starts the ServiceExecutor. This must be called before any tasks are scheduled.
+     */
+    virtual Status start() = 0;
+
+    /**
+     * Schedules a task to run on the ServiceExecutor. Returns a non-OK Status if the task could
+     * not be scheduled, for instance because the executor is shutting down; in that case the
+     * task will never run.
+     */
+    virtual Status schedule(Task task) = 0;
+
+    /**
+     * Stops accepting new tasks, discards queued tasks that have not started yet, and waits for
+     * running tasks to finish.
+     */
+    virtual Status shutdown() = 0;
+
+    /**
+     * Appends statistics about the task queue and worker threads to "bob". These are reported
+     * in the "network" section of serverStatus.
+     */
+    virtual void appendStats(BSONObjBuilder* bob) const = 0;
+
+protected:
+    ServiceExecutor() = default;
+};
+
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,309 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kExecutor
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/transport/service_executor_adaptive.h"
+
+#include <algorithm>
+
+#include "bongo/bson/bsonobjbuilder.h"
+#include "bongo/util/assert_util.h"
+#include "bongo/util/concurrency/thread_name.h"
+#include "bongo/util/concurrency/threadlocal.h"
+#include "bongo/util/log.h"
+#include "bongo/util/bongoutils/str.h"
+#include "bongo/util/processinfo.h"
+
+namespace bongo {
+namespace transport {
+
+namespace {
+
+// How long shutdown() waits for running tasks to drain before giving up.
+const Milliseconds kShutdownTimeout = Seconds(10);
+
+// The executor whose worker is running on this thread, if any. A task that shuts its own executor
+// down (e.g. the shutdown command) must not wait for its own thread to exit.
+BONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL const ServiceExecutorAdaptive* currentExecutor;
+
+ServiceExecutorAdaptive::Options cleanUpOptions(ServiceExecutorAdaptive::Options opts) {
+    ProcessInfo p;
+    const std::size_t cores =
+        std::max<std::size_t>(1, p.getNumAvailableCores().value_or(p.getNumCores()));
+
+    if (opts.reservedThreads == 0) {
+        opts.reservedThreads = cores;
+    }
+    if (opts.maxThreads == 0) {
+        opts.maxThreads = std::max(opts.reservedThreads, cores * 10);
+    }
+    if (opts.reservedThreads > opts.maxThreads) {
+        severe() << "Tried to create a service executor with " << opts.reservedThreads
+                 << " reserved threads, which is more than the configured maximum of "
+                 << opts.maxThreads;
+        fassertFailed(40388);
+    }
+    if (opts.stuckThreadTimeout <= Milliseconds(0) || opts.maxIdleThreadAge <= Milliseconds(0)) {
+        severe() << "Tried to create a service executor with non-positive timeouts";
+        fassertFailed(40389);
+    }
+    return opts;
+}
+
+}  // namespace
+
+ServiceExecutorAdaptive::ServiceExecutorAdaptive(Options opts)
+    : _options(cleanUpOptions(std::move(opts))) {}
+
+ServiceExecutorAdaptive::~ServiceExecutorAdaptive() {
+    auto status = shutdown();
+    if (!status.isOK()) {
+        warning() << "Waiting for service executor threads to exit during destruction: "
+                  << status;
+    }
+
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _threadExited.wait(lk, [this] { return _threadsRunning == 0; });
+}
+
+Status ServiceExecutorAdaptive::start() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_state != State::kPreStart) {
+        return Status(ErrorCodes::IllegalOperation, "service executor was already started");
+    }
+    _state = State::kRunning;
+    _lastDequeueTimeMicros = curTimeMicros64();
+
+    for (std::size_t i = 0; i < _options.reservedThreads; ++i) {
+        _startWorkerThread_inlock("reserve");
+    }
+
+    try {
+        _controllerThread = stdx::thread(&ServiceExecutorAdaptive::_controllerThreadRoutine, this);
+    } catch (const std::exception& ex) {
+        return Status(ErrorCodes::InternalError,
+                      str::stream() << "Failed to start service executor controller thread: "
+                                    << ex.what());
+    }
+
+    log() << "Started adaptive service executor with " << _threadsRunning
+          << " reserved threads and a maximum of " << _options.maxThreads;
+    return Status::OK();
+}
+
+Status ServiceExecutorAdaptive::schedule(Task task) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_state != State::kRunning) {
+        return Status(ErrorCodes::ShutdownInProgress,
+                      "service executor is not accepting new tasks");
+    }
+
+    _tasks.push_back({std::move(task), curTimeMicros64()});
+    ++_totalQueued;
+    _workAvailable.notify_one();
+    return Status::OK();
+}
+
+Status ServiceExecutorAdaptive::shutdown() {
+    std::deque<QueuedTask> discarded;
+    stdx::thread controller;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_state == State::kShutdown) {
+            return Status::OK();
+        }
+        _state = State::kShutdown;
+        discarded.swap(_tasks);
+        controller = std::move(_controllerThread);
+        _workAvailable.notify_all();
+        _controllerWakeup.notify_all();
+    }
+
+    // Tasks may own sessions, so destroy them without holding the mutex.
+    discarded.clear();
+    if (controller.joinable()) {
+        controller.join();
+    }
+
+    const std::size_t ownThreads = (currentExecutor == this) ? 1 : 0;
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    const bool drained = _threadExited.wait_for(lk, kShutdownTimeout.toSystemDuration(), [&] {
+        return _threadsRunning == ownThreads;
+    });
+    if (!drained) {
+        return Status(ErrorCodes::ExceededTimeLimit,
+                      str::stream() << "service executor still has " << _threadsRunning
+                                    << " running threads after " << kShutdownTimeout);
+    }
+    return Status::OK();
+}
+
+void ServiceExecutorAdaptive::appendStats(BSONObjBuilder* bob) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    const auto now = curTimeMicros64();
+
+    bob->append("executor", "adaptive");
+    bob->appendNumber("threadsRunning", static_cast<long long>(_threadsRunning));
+    bob->appendNumber("threadsInUse", static_cast<long long>(_threadsInUse));
+    bob->appendNumber("reservedThreads", static_cast<long long>(_options.reservedThreads));
+    bob->appendNumber("maxThreads", static_cast<long long>(_options.maxThreads));
+    bob->appendNumber("tasksQueued", static_cast<long long>(_tasks.size()));
+    bob->appendNumber("oldestQueuedTaskMicros",
+                      static_cast<long long>(
+                          _tasks.empty() ? 0 : now - _tasks.front().enqueueTimeMicros));
+    bob->appendNumber("totalQueued", static_cast<long long>(_totalQueued));
+    bob->appendNumber("totalExecuted", static_cast<long long>(_totalExecuted));
+    bob->appendNumber("totalTimeQueuedMicros", static_cast<long long>(_totalTimeQueuedMicros));
+    bob->appendNumber("totalTimeExecutingMicros",
+                      static_cast<long long>(_totalTimeExecutingMicros));
+    bob->appendNumber("threadsStarted", static_cast<long long>(_threadsStarted));
+    bob->appendNumber("threadsStartedForStuckQueue",
+                      static_cast<long long>(_threadsStartedForStuckQueue));
+    bob->appendNumber("threadsRetired", static_cast<long long>(_threadsRetired));
+}
+
+void ServiceExecutorAdaptive::_startWorkerThread_inlock(const char* reason) {
+    invariant(_state == State::kRunning);
+    if (_threadsRunning >= _options.maxThreads) {
+        LOG(2) << "Not starting new service executor thread because it already has "
+               << _threadsRunning << ", its maximum";
+        return;
+    }
+
+    const std::string threadName = str::stream() << "serviceExecutor-" << _nextThreadId++;
+    try {
+        stdx::thread(&ServiceExecutorAdaptive::_workerThreadRoutine, this, threadName).detach();
+    } catch (const std::exception& ex) {
+        error() << "Failed to start " << threadName << "; " << _threadsRunning
+                << " other thread(s) still running; caught exception: " << redact(ex.what());
+        return;
+    }
+
+    ++_threadsRunning;
+    ++_threadsStarted;
+    LOG(1) << "Started " << threadName << " (" << reason << "); " << _threadsRunning
+           << " service executor thread(s) now running";
+}
+
+void ServiceExecutorAdaptive::_workerThreadRoutine(std::string threadName) {
+    setThreadName(threadName);
+    currentExecutor = this;
+
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    while (_state == State::kRunning) {
+        if (_tasks.empty()) {
+            const auto waitResult =
+                _workAvailable.wait_for(lk, _options.maxIdleThreadAge.toSystemDuration());
+            if (waitResult == stdx::cv_status::timeout && _tasks.empty() &&
+                _threadsRunning > _options.reservedThreads) {
+                ++_threadsRetired;
+                LOG(1) << "Retiring " << threadName << " after being idle for "
+                       << _options.maxIdleThreadAge;
+                break;
+            }
+            continue;
+        }
+
+        auto task = std::move(_tasks.front().task);
+        const auto startTime = curTimeMicros64();
+        _totalTimeQueuedMicros += startTime - _tasks.front().enqueueTimeMicros;
+        _tasks.pop_front();
+        _lastDequeueTimeMicros = startTime;
+        ++_threadsInUse;
+        lk.unlock();
+
+        try {
+            task();
+        } catch (...) {
+            severe() << "Exception escaped task in service executor: " << exceptionToStatus();
+            std::terminate();
+        }
+
+        // Release whatever the task captured before reporting the thread as idle again.
+        task = nullptr;
+        lk.lock();
+        --_threadsInUse;
+        ++_totalExecuted;
+        _totalTimeExecutingMicros += curTimeMicros64() - startTime;
+    }
+
+    currentExecutor = nullptr;
+    --_threadsRunning;
+    _threadExited.notify_all();
+}
+
+void ServiceExecutorAdaptive::_controllerThreadRoutine() {
+    setThreadName("serviceExecutorController");
+
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    while (_state == State::kRunning) {
+        _controllerWakeup.wait_for(lk, _options.stuckThreadTimeout.toSystemDuration());
+        if (_state != State::kRunning) {
+            break;
+        }
+
+        // Replace reserved threads that could not be started.
+        while (_threadsRunning < _options.reservedThreads) {
+            const auto before = _threadsRunning;
+            _startWorkerThread_inlock("reserve");
+            if (_threadsRunning == before) {
+                break;
+            }
+        }
+
+        if (_tasks.empty() || _threadsInUse < _threadsRunning) {
+            continue;
+        }
+
+        // Every thread is busy and nothing has come off the queue for a while: the running tasks
+        // are most likely blocked, so add a thread to keep the queue moving.
+        const auto lastProgress =
+            std::max(_lastDequeueTimeMicros, _tasks.front().enqueueTimeMicros);
+        const auto stalledFor =
+            Microseconds(static_cast<long long>(curTimeMicros64() - lastProgress));
+        if (stalledFor < _options.stuckThreadTimeout) {
+            continue;
+        }
+
+        const auto before = _threadsRunning;
+        _startWorkerThread_inlock("stuck queue");
+        if (_threadsRunning > before) {
+            ++_threadsStartedForStuckQueue;
+            _lastDequeueTimeMicros = curTimeMicros64();
+        } else {
+            LOG(1) << "Service executor queue has been stalled for " << stalledFor
+                   << " with " << _tasks.size() << " queued task(s)";
+        }
+    }
+}
+
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,142 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/transport/service_executor.h"
+#include "bongo/util/time_support.h"
+
+namespace bongo {
+namespace transport {
+
+/**
+ * A ServiceExecutor that runs tasks on a bounded pool of worker threads whose size adapts to
+ * the workload.
+ *
+ * The pool keeps "reservedThreads" workers running at all times. A controller thread watches the
+ * task queue, and when tasks are waiting but every worker has been busy for longer than
+ * "stuckThreadTimeout" (typically because they are all blocked in I/O or waiting on locks), it
+ * starts another worker, up to "maxThreads". Workers above the reserve retire once they have
+ * been idle for "maxIdleThreadAge".
+ */
+class ServiceExecutorAdaptive final : public ServiceExecutor {
+    BONGO_DISALLOW_COPYING(ServiceExecutorAdaptive);
+
+public:
+    struct Options {
+        // Number of worker threads that are always kept running. Zero means one per available
+        // core.
+        std::size_t reservedThreads = 0;
+
+        // Upper bound on the number of worker threads. Zero means ten per available core.
+        std::size_t maxThreads = 0;
+
+        // How long the queue may go without any task being picked up, while all workers are
+        // busy, before the controller starts an additional worker.
+        Milliseconds stuckThreadTimeout{250};
+
+        // How long a worker above the reserve may sit idle before it exits.
+        Milliseconds maxIdleThreadAge{10000};
+    };
+
+    explicit ServiceExecutorAdaptive(Options opts);
+
+    /**
+     * Shuts the executor down if that has not already happened. All worker threads must have
+     * exited by the time the destructor returns.
+     */
+    ~ServiceExecutorAdaptive();
+
+    Status start() override;
+    Status schedule(Task task) override;
+    Status shutdown() override;
+    void appendStats(BSONObjBuilder* bob) const override;
+
+    /**
+     * Returns the options this executor runs with, with defaults resolved.
+     */
+    const Options& getOptions() const {
+        return _options;
+    }
+
+private:
+    enum class State { kPreStart, kRunning, kShutdown };
+
+    struct QueuedTask {
+        Task task;
+        std::uint64_t enqueueTimeMicros;
+    };
+
+    void _startWorkerThread_inlock(const char* reason);
+    void _workerThreadRoutine(std::string threadName);
+    void _controllerThreadRoutine();
+
+    const Options _options;
+
+    mutable stdx::mutex _mutex;
+
+    // Signalled when a task is queued or the executor shuts down.
+    stdx::condition_variable _workAvailable;
+
+    // Signalled when the controller should wake up early, i.e. on shutdown.
+    stdx::condition_variable _controllerWakeup;
+
+    // Signalled whenever a worker thread exits.
+    stdx::condition_variable _threadExited;
+
+    State _state = State::kPreStart;
+    std::deque<QueuedTask> _tasks;
+    stdx::thread _controllerThread;
+
+    std::size_t _threadsRunning = 0;
+    std::size_t _threadsInUse = 0;
+    std::uint64_t _nextThreadId = 0;
+
+    // Last time a worker picked a task off the queue; used to detect that the pool is stuck.
+    std::uint64_t _lastDequeueTimeMicros = 0;
+
+    // Cumulative statistics, reported through appendStats().
+    std::uint64_t _totalQueued = 0;
+    std::uint64_t _totalExecuted = 0;
+    std::uint64_t _totalTimeQueuedMicros = 0;
+    std::uint64_t _totalTimeExecutingMicros = 0;
+    std::uint64_t _threadsStarted = 0;
+    std::uint64_t _threadsStartedForStuckQueue = 0;
+    std::uint64_t _threadsRetired = 0;
+};
+
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,209 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include <boost/optional.hpp>
+
+#include "bongo/bson/bsonobj.h"
+#include "bongo/bson/bsonobjbuilder.h"
+#include "bongo/platform/atomic_word.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/transport/service_executor_adaptive.h"
+#include "bongo/unittest/death_test.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/time_support.h"
+
+namespace bongo {
+namespace transport {
+namespace {
+
+BSONObj getStats(const ServiceExecutor& executor) {
+    BSONObjBuilder bob;
+    executor.appendStats(&bob);
+    return bob.obj();
+}
+
+/**
+ * Polls the executor's stats until "field" equals "expected", or fails after ten seconds.
+ */
+void waitForStat(const ServiceExecutor& executor, StringData field, long long expected) {
+    const auto deadline = Date_t::now() + Seconds(10);
+    BSONObj stats;
+    while (Date_t::now() < deadline) {
+        stats = getStats(executor);
+        if (stats[field].safeNumberLong() == expected) {
+            return;
+        }
+        sleepmillis(5);
+    }
+    FAIL(str::stream() << "Timed out waiting for " << field << " to be " << expected
+                       << "; last stats: " << stats);
+}
+
+/**
+ * A latch that blocked tasks wait on until the test releases them.
+ */
+class Gate {
+public:
+    void wait() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _cv.wait(lk, [this] { return _open; });
+    }
+
+    void open() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _open = true;
+        _cv.notify_all();
+    }
+
+private:
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+    bool _open = false;
+};
+
+ServiceExecutorAdaptive::Options makeOptions(std::size_t reserved, std::size_t max) {
+    ServiceExecutorAdaptive::Options opts;
+    opts.reservedThreads = reserved;
+    opts.maxThreads = max;
+    opts.stuckThreadTimeout = Milliseconds(10);
+    opts.maxIdleThreadAge = Milliseconds(50);
+    return opts;
+}
+
+TEST(ServiceExecutorAdaptiveTest, DefaultsDeriveFromCoreCount) {
+    ServiceExecutorAdaptive executor({});
+    ASSERT_GTE(executor.getOptions().reservedThreads, 1U);
+    ASSERT_EQ(executor.getOptions().maxThreads, executor.getOptions().reservedThreads * 10);
+}
+
+TEST(ServiceExecutorAdaptiveTest, RunsScheduledTasks) {
+    ServiceExecutorAdaptive executor(makeOptions(2, 4));
+    ASSERT_OK(executor.start());
+
+    AtomicInt32 ran;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_OK(executor.schedule([&ran] { ran.fetchAndAdd(1); }));
+    }
+    waitForStat(executor, "totalExecuted", 100);
+    ASSERT_EQ(ran.load(), 100);
+
+    auto stats = getStats(executor);
+    ASSERT_EQ(stats["totalQueued"].safeNumberLong(), 100);
+    ASSERT_EQ(stats["tasksQueued"].safeNumberLong(), 0);
+    ASSERT_EQ(stats["threadsRunning"].safeNumberLong(), 2);
+
+    ASSERT_OK(executor.shutdown());
+}
+
+TEST(ServiceExecutorAdaptiveTest, CannotStartTwice) {
+    ServiceExecutorAdaptive executor(makeOptions(1, 1));
+    ASSERT_OK(executor.start());
+    ASSERT_EQ(ErrorCodes::IllegalOperation, executor.start());
+}
+
+TEST(ServiceExecutorAdaptiveTest, GrowsWhenAllThreadsAreBlockedAndShrinksWhenIdle) {
+    ServiceExecutorAdaptive executor(makeOptions(1, 3));
+    ASSERT_OK(executor.start());
+
+    Gate gate;
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_OK(executor.schedule([&gate] { gate.wait(); }));
+    }
+
+    // Every task blocks, so the controller keeps adding threads until it reaches the maximum,
+    // leaving the remaining tasks queued.
+    waitForStat(executor, "threadsRunning", 3);
+    waitForStat(executor, "threadsInUse", 3);
+    auto stats = getStats(executor);
+    ASSERT_EQ(stats["tasksQueued"].safeNumberLong(), 2);
+    ASSERT_EQ(stats["threadsStartedForStuckQueue"].safeNumberLong(), 2);
+
+    gate.open();
+    waitForStat(executor, "totalExecuted", 5);
+
+    // The extra threads retire once they have been idle long enough.
+    waitForStat(executor, "threadsRunning", 1);
+    ASSERT_EQ(getStats(executor)["threadsRetired"].safeNumberLong(), 2);
+
+    ASSERT_OK(executor.shutdown());
+}
+
+TEST(ServiceExecutorAdaptiveTest, ShutdownRejectsNewTasksAndDiscardsQueuedOnes) {
+    ServiceExecutorAdaptive executor(makeOptions(1, 1));
+    ASSERT_OK(executor.start());
+
+    Gate gate;
+    AtomicInt32 ran;
+    ASSERT_OK(executor.schedule([&] {
+        gate.wait();
+        ran.fetchAndAdd(1);
+    }));
+    ASSERT_OK(executor.schedule([&ran] { ran.fetchAndAdd(1); }));
+    waitForStat(executor, "threadsInUse", 1);
+
+    stdx::thread shutdownThread([&] { ASSERT_OK(executor.shutdown()); });
+    waitForStat(executor, "tasksQueued", 0);
+    gate.open();
+    shutdownThread.join();
+
+    ASSERT_EQ(ran.load(), 1);
+    ASSERT_EQ(ErrorCodes::ShutdownInProgress, executor.schedule([] {}));
+}
+
+TEST(ServiceExecutorAdaptiveTest, TaskCanShutDownItsOwnExecutor) {
+    ServiceExecutorAdaptive executor(makeOptions(1, 1));
+    ASSERT_OK(executor.start());
+
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    boost::optional<Status> result;
+    ASSERT_OK(executor.schedule([&] {
+        auto status = executor.shutdown();
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        result = status;
+        cv.notify_all();
+    }));
+
+    stdx::unique_lock<stdx::mutex> lk(mutex);
+    cv.wait(lk, [&] { return static_cast<bool>(result); });
+    ASSERT_OK(*result);
+}
+
+DEATH_TEST(ServiceExecutorAdaptiveTest,
+           ReservedMoreThanMaxDies,
+           "which is more than the configured maximum") {
+    ServiceExecutorAdaptive executor(makeOptions(4, 2));
+}
+
+}  // namespace
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,615 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kNetwork
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/transport/transport_layer_asio.h"
+
+#include <algorithm>
+#include <iterator>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "bongo/base/checked_cast.h"
+#include "bongo/base/system_error.h"
+#include "bongo/config.h"
+#include "bongo/db/server_options.h"
+#include "bongo/db/stats/counters.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/transport/message_compressor_manager.h"
+#include "bongo/transport/service_entry_point.h"
+#include "bongo/util/assert_util.h"
+#include "bongo/util/log.h"
+#include "bongo/util/net/listen.h"
+#include "bongo/util/net/sockaddr.h"
+#include "bongo/util/net/ssl_options.h"
+#include "bongo/util/processinfo.h"
+
+namespace bongo {
+namespace transport {
+namespace {
+
+const size_t kHeaderSize = sizeof(MSGHEADER::Value);
+
+// "GET " interpreted as a little-endian message length.
+const int32_t kHTTPGetMessageLength = 542393671;
+
+struct lock_weak {
+    template <typename T>
+    std::shared_ptr<T> operator()(const std::weak_ptr<T>& p) const {
+        return p.lock();
+    }
+};
+
+HostAndPort endpointToHostAndPort(const asio::generic::stream_protocol::endpoint& endpoint) {
+    switch (endpoint.protocol().family()) {
+        case AF_INET:
+        case AF_INET6: {
+            asio::ip::tcp::endpoint tcpEndpoint;
+            tcpEndpoint.resize(endpoint.size());
+            memcpy(tcpEndpoint.data(), endpoint.data(), endpoint.size());
+            return HostAndPort(tcpEndpoint.address().to_string(), tcpEndpoint.port());
+        }
+#ifndef _WIN32
+        case AF_UNIX: {
+            asio::local::stream_protocol::endpoint localEndpoint;
+            localEndpoint.resize(endpoint.size());
+            memcpy(localEndpoint.data(), endpoint.data(), endpoint.size());
+            auto path = localEndpoint.path();
+            return HostAndPort(path.empty() ? "anonymous unix socket" : path, 0);
+        }
+#endif  // _WIN32
+        default: { BONGO_UNREACHABLE; }
+    }
+}
+
+Status errorCodeToStatus(const std::error_code& ec) {
+    if (ec.category() == bongoErrorCategory()) {
+        return {ErrorCodes::Error(ec.value()), ec.message()};
+    }
+
+    // Anything the socket itself reports means the remote end is gone.
+    return {ErrorCodes::HostUnreachable, ec.message()};
+}
+
+}  // namespace
+
+TransportLayerASIO::ASIOSession::ASIOSession(TransportLayerASIO* tl,
+                                             GenericSocket socket,
+                                             long long connectionId)
+    : _tl(tl), _socket(std::move(socket)), _connectionId(connectionId) {
+    std::error_code ec;
+    auto family = _socket.local_endpoint(ec).protocol().family();
+    if (!ec && (family == AF_INET || family == AF_INET6)) {
+        _socket.set_option(asio::ip::tcp::no_delay(true), ec);
+        if (ec) {
+            LOG(1) << "Failed to disable nagle on connection #" << _connectionId << ": "
+                   << ec.message();
+        }
+    }
+
+    _remote = endpointToHostAndPort(_socket.remote_endpoint(ec));
+    if (ec) {
+        LOG(1) << "Unable to get remote endpoint of connection #" << _connectionId << ": "
+               << ec.message();
+    }
+    _local = endpointToHostAndPort(_socket.local_endpoint(ec));
+    if (ec) {
+        LOG(1) << "Unable to get local endpoint of connection #" << _connectionId << ": "
+               << ec.message();
+    }
+}
+
+TransportLayerASIO::ASIOSession::~ASIOSession() {
+    _tl->_destroy(*this);
+
+    std::error_code ec;
+    _socket.close(ec);
+    if (ec) {
+        LOG(1) << "Error closing connection #" << _connectionId << ": " << ec.message();
+    }
+}
+
+bool TransportLayerASIO::ASIOSession::close() {
+    if (_closed.swap(true)) {
+        return false;
+    }
+
+    // shutdown() does not touch the reactor's bookkeeping, so unlike close() it is safe to call
+    // while another thread has an operation outstanding on this socket.
+    std::error_code ec;
+    _socket.shutdown(GenericSocket::shutdown_both, ec);
+    if (ec && ec != asio::error::not_connected) {
+        LOG(1) << "Error shutting down connection #" << _connectionId << ": " << ec.message();
+    }
+    return true;
+}
+
+TransportLayerASIO::ASIOTicket::ASIOTicket(const ASIOSessionHandle& session, Date_t expiration)
+    : _session(session), _sessionId(session->id()), _expiration(expiration) {}
+
+SessionId TransportLayerASIO::ASIOTicket::sessionId() const {
+    return _sessionId;
+}
+
+Date_t TransportLayerASIO::ASIOTicket::expiration() const {
+    return _expiration;
+}
+
+void TransportLayerASIO::ASIOTicket::fill(bool sync, TicketCallback&& cb) {
+    _fillSync = sync;
+    _fillCallback = std::move(cb);
+
+    _fillSession = _session.lock();
+    if (!_fillSession || _fillSession->isClosed()) {
+        return finishFill(TransportLayer::TicketSessionClosedStatus);
+    }
+
+    fillImpl();
+}
+
+void TransportLayerASIO::ASIOTicket::finishFill(Status status) {
+    // The callback may destroy this ticket, so take everything we need off of 'this' first.
+    auto cb = std::move(_fillCallback);
+    _fillSession.reset();
+    cb(std::move(status));
+}
+
+TransportLayerASIO::ASIOSourceTicket::ASIOSourceTicket(const ASIOSessionHandle& session,
+                                                       Date_t expiration,
+                                                       Message* msg)
+    : ASIOTicket(session, expiration), _target(msg) {}
+
+void TransportLayerASIO::ASIOSourceTicket::fillImpl() {
+    _buffer = SharedBuffer::allocate(kHeaderSize);
+    session()->read(isSync(),
+                    asio::buffer(_buffer.get(), kHeaderSize),
+                    [this](const std::error_code& ec, size_t size) { _headerCallback(ec, size); });
+}
+
+void TransportLayerASIO::ASIOSourceTicket::_headerCallback(const std::error_code& ec,
+                                                           size_t size) {
+    if (ec) {
+        return finishFill(errorCodeToStatus(ec));
+    }
+
+    const auto len = MSGHEADER::ConstView(_buffer.get()).getMessageLength();
+    if (len == kHTTPGetMessageLength) {
+        LOG(3) << "attempt to access BongoDB over HTTP on the native driver port.";
+        return finishFill({ErrorCodes::ProtocolError, "HTTP is not supported on this port"});
+    } else if (len < 0 || static_cast<size_t>(len) < kHeaderSize ||
+               static_cast<size_t>(len) > MaxMessageSizeBytes) {
+        warning() << "recv(): message len " << len << " is invalid. "
+                  << "Min " << kHeaderSize << " Max: " << MaxMessageSizeBytes;
+        return finishFill({ErrorCodes::ProtocolError,
+                           str::stream() << "Received message of invalid length " << len});
+    }
+
+    if (static_cast<size_t>(len) == kHeaderSize) {
+        return _bodyCallback(ec, 0);
+    }
+
+    _buffer.realloc(len);
+    MsgData::View msgView(_buffer.get());
+    session()->read(isSync(),
+                    asio::buffer(msgView.data(), msgView.dataLen()),
+                    [this](const std::error_code& ec, size_t size) { _bodyCallback(ec, size); });
+}
+
+void TransportLayerASIO::ASIOSourceTicket::_bodyCallback(const std::error_code& ec, size_t size) {
+    if (ec) {
+        return finishFill(errorCodeToStatus(ec));
+    }
+
+    _target->setData(std::move(_buffer));
+    networkCounter.hitPhysical(_target->size(), 0);
+
+    if (_target->operation() == dbCompressed) {
+        auto swm = MessageCompressorManager::forSession(session()->shared_from_this())
+                       .decompressMessage(*_target);
+        if (!swm.isOK()) {
+            return finishFill(swm.getStatus());
+        }
+        *_target = std::move(swm.getValue());
+    }
+
+    networkCounter.hitLogical(_target->size(), 0);
+    finishFill(Status::OK());
+}
+
+TransportLayerASIO::ASIOSinkTicket::ASIOSinkTicket(const ASIOSessionHandle& session,
+                                                   Date_t expiration,
+                                                   const Message& msg)
+    : ASIOTicket(session, expiration), _msgToSend(msg) {}
+
+void TransportLayerASIO::ASIOSinkTicket::fillImpl() {
+    networkCounter.hitLogical(0, _msgToSend.size());
+
+    auto swm = MessageCompressorManager::forSession(session()->shared_from_this())
+                   .compressMessage(_msgToSend);
+    if (!swm.isOK()) {
+        return finishFill(swm.getStatus());
+    }
+    _msgToSend = std::move(swm.getValue());
+
+    _buffers.clear();
+    _msgToSend.forEachBuffer([this](const char* data, std::size_t len) {
+        _buffers.emplace_back(data, len);
+    });
+
+    session()->write(isSync(), _buffers, [this](const std::error_code& ec, size_t size) {
+        _sinkCallback(ec, size);
+    });
+}
+
+void TransportLayerASIO::ASIOSinkTicket::_sinkCallback(const std::error_code& ec, size_t size) {
+    if (ec) {
+        return finishFill(errorCodeToStatus(ec));
+    }
+
+    networkCounter.hitPhysical(0, size);
+    finishFill(Status::OK());
+}
+
+TransportLayerASIO::TransportLayerASIO(const TransportLayerASIO::Options& opts,
+                                       ServiceEntryPoint* sep)
+    : _sep(sep), _running(false), _options(opts) {}
+
+TransportLayerASIO::~TransportLayerASIO() = default;
+
+Status TransportLayerASIO::setup() {
+#ifdef BONGO_CONFIG_SSL
+    if (sslGlobalParams.sslMode.load() != SSLParams::SSLMode_disabled) {
+        return {ErrorCodes::InvalidOptions,
+                "The asio transport layer does not support SSL; use the legacy transport layer"};
+    }
+#endif
+
+    Listener::checkTicketNumbers();
+
+#ifndef _WIN32
+    const bool useUnixSockets = !serverGlobalParams.noUnixSocket;
+#else
+    const bool useUnixSockets = false;
+#endif
+
+    for (const auto& addr : ipToAddrs(_options.ipList.c_str(), _options.port, useUnixSockets)) {
+        if (!addr.isValid()) {
+            return {ErrorCodes::BadValue,
+                    str::stream() << "Invalid address to listen on: " << addr.toString()};
+        }
+
+        const asio::generic::stream_protocol::endpoint endpoint(addr.raw(), addr.addressSize);
+
+#ifndef _WIN32
+        if (addr.getType() == AF_UNIX && ::unlink(addr.getAddr().c_str()) == -1 &&
+            errno != ENOENT) {
+            error() << "Failed to unlink socket file " << addr << " "
+                    << errnoWithDescription(errno);
+            fassertFailedNoTrace(40385);
+        }
+#endif
+
+        GenericAcceptor acceptor(_ioService);
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(GenericAcceptor::reuse_address(true));
+        if (addr.getType() == AF_INET6) {
+            // IPv6 can also accept IPv4 connections as mapped addresses (::ffff:127.0.0.1)
+            // That causes a conflict if we don't do set it to IPV6_ONLY
+            acceptor.set_option(asio::ip::v6_only(true));
+        }
+
+        std::error_code ec;
+        acceptor.bind(endpoint, ec);
+        if (ec) {
+            error() << "listen(): bind() failed " << ec.message()
+                    << " for socket: " << addr.toString();
+            return errorCodeToStatus(ec);
+        }
+
+#ifndef _WIN32
+        if (addr.getType() == AF_UNIX) {
+            if (::chmod(addr.getAddr().c_str(), serverGlobalParams.unixSocketPermissions) == -1) {
+                error() << "Failed to chmod socket file " << addr << " "
+                        << errnoWithDescription(errno);
+                fassertFailedNoTrace(40386);
+            }
+            ListeningSockets::get()->addPath(addr.getAddr());
+        }
+#endif
+
+        _acceptors.emplace_back(std::move(acceptor));
+    }
+
+    if (_acceptors.empty()) {
+        return {ErrorCodes::BadValue, "No valid addresses to listen on"};
+    }
+
+    return Status::OK();
+}
+
+Status TransportLayerASIO::start() {
+    if (_running.swap(true)) {
+        return {ErrorCodes::InternalError, "TransportLayer is already running"};
+    }
+
+    for (auto& acceptor : _acceptors) {
+        std::error_code ec;
+        acceptor.listen(asio::socket_base::max_connections, ec);
+        if (ec) {
+            error() << "listen(): listen() failed " << ec.message();
+            return errorCodeToStatus(ec);
+        }
+
+        auto endpoint = acceptor.local_endpoint(ec);
+        if (!ec) {
+            log() << "waiting for connections on port " << endpointToHostAndPort(endpoint);
+        }
+        _acceptConnection(acceptor);
+    }
+
+    auto ioThreads = _options.ioThreads;
+    if (ioThreads <= 0) {
+        ProcessInfo p;
+        ioThreads = p.getNumAvailableCores().value_or(p.getNumCores());
+    }
+
+    _ioServiceWork = stdx::make_unique<asio::io_service::work>(_ioService);
+    for (int i = 0; i < ioThreads; ++i) {
+        _ioThreads.emplace_back([this, i] {
+            setThreadName(str::stream() << "transport-asio-" << i);
+            std::error_code ec;
+            _ioService.run(ec);
+            if (ec) {
+                severe() << "Failure in transport layer io_service.run(): " << ec.message();
+                fassertFailed(40387);
+            }
+        });
+    }
+
+    return Status::OK();
+}
+
+std::vector<int> TransportLayerASIO::listenerPorts() const {
+    std::vector<int> ports;
+    for (const auto& acceptor : _acceptors) {
+        std::error_code ec;
+        auto endpoint = acceptor.local_endpoint(ec);
+        const auto family = endpoint.protocol().family();
+        if (!ec && (family == AF_INET || family == AF_INET6)) {
+            ports.push_back(endpointToHostAndPort(endpoint).port());
+        }
+    }
+    return ports;
+}
+
+void TransportLayerASIO::_acceptConnection(GenericAcceptor& acceptor) {
+    auto peerSocket = std::make_shared<GenericSocket>(_ioService);
+    acceptor.async_accept(*peerSocket, [this, peerSocket, &acceptor](const std::error_code& ec) {
+        if (ec == asio::error::operation_aborted) {
+            // The acceptor was closed by shutdown().
+            return;
+        }
+
+        if (ec) {
+            log() << "Error accepting new connection: " << ec.message();
+        } else {
+            _handleNewConnection(std::move(*peerSocket));
+        }
+
+        if (_running.load()) {
+            _acceptConnection(acceptor);
+        }
+    });
+}
+
+void TransportLayerASIO::_handleNewConnection(GenericSocket socket) {
+    if (!Listener::globalTicketHolder.tryAcquire()) {
+        log() << "connection refused because too many open connections: "
+              << Listener::globalTicketHolder.used();
+        return;
+    }
+
+    const long long connectionId = Listener::globalConnectionNumber.addAndFetch(1);
+    auto session = std::make_shared<ASIOSession>(this, std::move(socket), connectionId);
+
+    if (!serverGlobalParams.quiet.load()) {
+        int conns = Listener::globalTicketHolder.used();
+        const char* word = (conns == 1 ? " connection" : " connections");
+        log() << "connection accepted from " << session->remote() << " #" << connectionId << " ("
+              << conns << word << " now open)";
+    }
+
+    stdx::list<std::weak_ptr<ASIOSession>> list;
+    auto it = list.emplace(list.begin(), session);
+
+    {
+        // Add the new session to our list
+        stdx::lock_guard<stdx::mutex> lk(_sessionsMutex);
+        session->setIter(it);
+        _sessions.splice(_sessions.begin(), list, it);
+    }
+
+    invariant(_sep);
+    _sep->startSession(std::move(session));
+}
+
+Ticket TransportLayerASIO::sourceMessage(const SessionHandle& session,
+                                         Message* message,
+                                         Date_t expiration) {
+    auto asioSession = checked_pointer_cast<ASIOSession>(session);
+    return Ticket(this, stdx::make_unique<ASIOSourceTicket>(asioSession, expiration, message));
+}
+
+Ticket TransportLayerASIO::sinkMessage(const SessionHandle& session,
+                                       const Message& message,
+                                       Date_t expiration) {
+    auto asioSession = checked_pointer_cast<ASIOSession>(session);
+    return Ticket(this, stdx::make_unique<ASIOSinkTicket>(asioSession, expiration, message));
+}
+
+TransportLayerASIO::ASIOTicket* TransportLayerASIO::_checkTicket(const Ticket& ticket,
+                                                                 Status* status) {
+    if (!_running.load()) {
+        *status = TransportLayer::ShutdownStatus;
+        return nullptr;
+    }
+
+    if (ticket.expiration() < Date_t::now()) {
+        *status = Ticket::ExpiredStatus;
+        return nullptr;
+    }
+
+    return checked_cast<ASIOTicket*>(getTicketImpl(ticket));
+}
+
+Status TransportLayerASIO::wait(Ticket&& ticket) {
+    // Take ownership of the ticket so that it is alive for the duration of the fill.
+    Ticket ownedTicket(std::move(ticket));
+
+    Status waitStatus = Status::OK();
+    auto asioTicket = _checkTicket(ownedTicket, &waitStatus);
+    if (!asioTicket) {
+        return waitStatus;
+    }
+
+    asioTicket->fill(true, [&waitStatus](Status result) { waitStatus = std::move(result); });
+    return waitStatus;
+}
+
+void TransportLayerASIO::asyncWait(Ticket&& ticket, TicketCallback callback) {
+    // The completion handler owns the ticket, so that it stays alive while its I/O is
+    // outstanding on the io_service.
+    auto ownedTicket = std::make_shared<Ticket>(std::move(ticket));
+
+    Status status = Status::OK();
+    auto asioTicket = _checkTicket(*ownedTicket, &status);
+    if (!asioTicket) {
+        return callback(status);
+    }
+
+    asioTicket->fill(false, [ownedTicket, callback](Status status) { callback(status); });
+}
+
+TransportLayer::Stats TransportLayerASIO::sessionStats() {
+    Stats stats;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_sessionsMutex);
+        stats.numOpenSessions = _sessions.size();
+    }
+
+    stats.numAvailableSessions = Listener::globalTicketHolder.available();
+    stats.numCreatedSessions = Listener::globalConnectionNumber.load();
+
+    return stats;
+}
+
+void TransportLayerASIO::end(const SessionHandle& session) {
+    auto asioSession = checked_pointer_cast<ASIOSession>(session);
+    _closeSession(asioSession.get());
+}
+
+void TransportLayerASIO::_closeSession(ASIOSession* session) {
+    if (session->close()) {
+        Listener::globalTicketHolder.release();
+    }
+}
+
+// Capture all of the weak pointers behind the lock, to delay their expiry until we leave the
+// locking context. This function requires proof of locking, by passing the lock guard.
+auto TransportLayerASIO::_lockAllSessions(const stdx::unique_lock<stdx::mutex>&) const
+    -> std::vector<ASIOSessionHandle> {
+    using std::begin;
+    using std::end;
+    std::vector<ASIOSessionHandle> result;
+    std::transform(begin(_sessions), end(_sessions), std::back_inserter(result), lock_weak());
+    // Skip expired weak pointers.
+    result.erase(std::remove(begin(result), end(result), nullptr), end(result));
+    return result;
+}
+
+void TransportLayerASIO::endAllSessions(Session::TagMask tags) {
+    log() << "asio transport layer closing all connections";
+
+    std::vector<ASIOSessionHandle> sessions;
+    {
+        stdx::unique_lock<stdx::mutex> lk(_sessionsMutex);
+        sessions = _lockAllSessions(lk);
+    }
+
+    for (auto&& session : sessions) {
+        if (session->getTags() & tags) {
+            log() << "Skip closing connection for connection # " << session->connectionId();
+        } else {
+            _closeSession(session.get());
+        }
+    }
+
+    // The shared_ptrs in 'sessions' are released here, outside of _sessionsMutex, because the
+    // last one out destroys its session and must take the mutex to unlink it.
+}
+
+void TransportLayerASIO::shutdown() {
+    if (!_running.swap(false)) {
+        return;
+    }
+
+    // Acceptors are not thread-safe, so close them from an I/O thread, where their pending
+    // accepts complete.
+    _ioService.post([this] {
+        for (auto& acceptor : _acceptors) {
+            std::error_code ec;
+            acceptor.close(ec);
+        }
+    });
+
+    endAllSessions(Session::kEmptyTagMask);
+
+    // Let the I/O threads drain: every outstanding operation has been completed with an error by
+    // the closes above, and no new ones can be started now that _running is false.
+    _ioServiceWork.reset();
+    for (auto& thread : _ioThreads) {
+        thread.join();
+    }
+    _ioThreads.clear();
+}
+
+void TransportLayerASIO::_destroy(ASIOSession& session) {
+    _closeSession(&session);
+
+    stdx::lock_guard<stdx::mutex> lk(_sessionsMutex);
+    _sessions.erase(session.getIter());
+}
+
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,324 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <asio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bongo/platform/atomic_word.h"
+#include "bongo/stdx/list.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/transport/ticket_impl.h"
+#include "bongo/transport/transport_layer.h"
+#include "bongo/util/net/hostandport.h"
+
+namespace bongo {
+
+class ServiceEntryPoint;
+
+namespace transport {
+
+/**
+ * A TransportLayer implementation built on ASIO.
+ *
+ * Rather than dedicating a blocked thread to every connection, all sockets are registered with a
+ * single asio::io_service (epoll on Linux) that is run by a small, fixed pool of I/O threads.
+ * Tickets run through asyncWait() are completed on those I/O threads; tickets run through wait()
+ * perform their I/O on the calling thread, so ServiceEntryPoints written against the
+ * synchronous Ticket interface keep working unchanged.
+ *
+ * SSL is not supported by this implementation; setup() fails if SSL is enabled.
+ */
+class TransportLayerASIO final : public TransportLayer {
+    BONGO_DISALLOW_COPYING(TransportLayerASIO);
+
+public:
+    struct Options {
+        int port = 0;        // port to bind to
+        std::string ipList;  // addresses to bind to
+
+        // Number of threads running the io_service. Zero means one per available core.
+        int ioThreads = 0;
+    };
+
+    TransportLayerASIO(const Options& opts, ServiceEntryPoint* sep);
+
+    ~TransportLayerASIO();
+
+    /**
+     * Binds the listening sockets. Must be called, and succeed, before start().
+     */
+    Status setup();
+    Status start() override;
+
+    Ticket sourceMessage(const SessionHandle& session,
+                         Message* message,
+                         Date_t expiration = Ticket::kNoExpirationDate) override;
+
+    Ticket sinkMessage(const SessionHandle& session,
+                       const Message& message,
+                       Date_t expiration = Ticket::kNoExpirationDate) override;
+
+    Status wait(Ticket&& ticket) override;
+    void asyncWait(Ticket&& ticket, TicketCallback callback) override;
+
+    Stats sessionStats() override;
+
+    void end(const SessionHandle& session) override;
+    void endAllSessions(transport::Session::TagMask tags) override;
+
+    void shutdown() override;
+
+    /**
+     * Returns the ports the TCP acceptors are bound to. Only valid after setup(); useful when
+     * binding to port 0.
+     */
+    std::vector<int> listenerPorts() const;
+
+private:
+    class ASIOSession;
+    class ASIOTicket;
+    class ASIOSourceTicket;
+    class ASIOSinkTicket;
+
+    using ASIOSessionHandle = std::shared_ptr<ASIOSession>;
+    using SessionEntry = stdx::list<std::weak_ptr<ASIOSession>>::iterator;
+    using GenericAcceptor = asio::basic_socket_acceptor<asio::generic::stream_protocol>;
+    using GenericSocket = asio::generic::stream_protocol::socket;
+
+    /**
+     * An implementation of the Session interface for this TransportLayer. Owns the socket.
+     */
+    class ASIOSession : public Session {
+        BONGO_DISALLOW_COPYING(ASIOSession);
+
+    public:
+        ASIOSession(TransportLayerASIO* tl, GenericSocket socket, long long connectionId);
+
+        ~ASIOSession();
+
+        TransportLayer* getTransportLayer() const override {
+            return _tl;
+        }
+
+        const HostAndPort& remote() const override {
+            return _remote;
+        }
+
+        const HostAndPort& local() const override {
+            return _local;
+        }
+
+        long long connectionId() const {
+            return _connectionId;
+        }
+
+        bool isClosed() const {
+            return _closed.load();
+        }
+
+        /**
+         * Shuts the socket down in both directions, which completes any outstanding operation
+         * with an error. The descriptor itself is closed when the session is destroyed. Returns
+         * true if this call is the one that closed the session.
+         */
+        bool close();
+
+        /**
+         * Reads enough data to fill 'buffers', either synchronously on the calling thread or
+         * asynchronously on an I/O thread. 'handler' is always invoked with the result.
+         */
+        template <typename MutableBufferSequence, typename CompleteHandler>
+        void read(bool sync, const MutableBufferSequence& buffers, CompleteHandler&& handler) {
+            if (sync) {
+                std::error_code ec;
+                auto size = asio::read(_socket, buffers, ec);
+                handler(ec, size);
+            } else {
+                asio::async_read(_socket, buffers, std::forward<CompleteHandler>(handler));
+            }
+        }
+
+        /**
+         * Writes all of 'buffers', with the same threading behavior as read().
+         */
+        template <typename ConstBufferSequence, typename CompleteHandler>
+        void write(bool sync, const ConstBufferSequence& buffers, CompleteHandler&& handler) {
+            if (sync) {
+                std::error_code ec;
+                auto size = asio::write(_socket, buffers, ec);
+                handler(ec, size);
+            } else {
+                asio::async_write(_socket, buffers, std::forward<CompleteHandler>(handler));
+            }
+        }
+
+        void setIter(SessionEntry it) {
+            _entry = std::move(it);
+        }
+
+        SessionEntry getIter() const {
+            return _entry;
+        }
+
+    private:
+        TransportLayerASIO* const _tl;
+        GenericSocket _socket;
+        const long long _connectionId;
+
+        HostAndPort _remote;
+        HostAndPort _local;
+
+        AtomicWord<bool> _closed{false};
+
+        // A handle to this session's entry in the TL's session list
+        SessionEntry _entry;
+    };
+
+    /**
+     * Base TicketImpl for this TransportLayer. Subclasses implement fillImpl() as a chain of
+     * session reads or writes that ends with a call to finishFill().
+     */
+    class ASIOTicket : public TicketImpl {
+        BONGO_DISALLOW_COPYING(ASIOTicket);
+
+    public:
+        ASIOTicket(const ASIOSessionHandle& session, Date_t expiration);
+
+        SessionId sessionId() const override;
+        Date_t expiration() const override;
+
+        /**
+         * Runs this ticket's I/O, on the calling thread if 'sync' is true and on an I/O thread
+         * otherwise. 'cb' is invoked exactly once, after which this ticket must not be touched
+         * by the caller again, since 'cb' is allowed to destroy it.
+         */
+        void fill(bool sync, TicketCallback&& cb);
+
+    protected:
+        virtual void fillImpl() = 0;
+
+        /**
+         * Completes the fill. Must be the last thing a subclass does with 'this'.
+         */
+        void finishFill(Status status);
+
+        bool isSync() const {
+            return _fillSync;
+        }
+
+        /**
+         * The session being filled. Held strongly for the duration of the fill.
+         */
+        ASIOSession* session() const {
+            return _fillSession.get();
+        }
+
+    private:
+        std::weak_ptr<ASIOSession> _session;
+        SessionId _sessionId;
+        Date_t _expiration;
+
+        ASIOSessionHandle _fillSession;
+        TicketCallback _fillCallback;
+        bool _fillSync = false;
+    };
+
+    /**
+     * Reads a message header, then the message body, then decompresses it if needed.
+     */
+    class ASIOSourceTicket : public ASIOTicket {
+    public:
+        ASIOSourceTicket(const ASIOSessionHandle& session, Date_t expiration, Message* msg);
+
+    protected:
+        void fillImpl() override;
+
+    private:
+        void _headerCallback(const std::error_code& ec, size_t size);
+        void _bodyCallback(const std::error_code& ec, size_t size);
+
+        SharedBuffer _buffer;
+        Message* _target;
+    };
+
+    /**
+     * Compresses a message if the session negotiated a compressor, then writes it out.
+     */
+    class ASIOSinkTicket : public ASIOTicket {
+    public:
+        ASIOSinkTicket(const ASIOSessionHandle& session, Date_t expiration, const Message& msg);
+
+    protected:
+        void fillImpl() override;
+
+    private:
+        void _sinkCallback(const std::error_code& ec, size_t size);
+
+        Message _msgToSend;
+        // The ranges of _msgToSend, gathered into a single write.
+        std::vector<asio::const_buffer> _buffers;
+    };
+
+    /**
+     * Performs the checks shared by wait() and asyncWait(). Returns the ticket's implementation,
+     * or nullptr with 'status' set if the ticket cannot be run.
+     */
+    ASIOTicket* _checkTicket(const Ticket& ticket, Status* status);
+
+    void _acceptConnection(GenericAcceptor& acceptor);
+    void _handleNewConnection(GenericSocket socket);
+
+    void _closeSession(ASIOSession* session);
+    void _destroy(ASIOSession& session);
+
+    std::vector<ASIOSessionHandle> _lockAllSessions(const stdx::unique_lock<stdx::mutex>&) const;
+
+    ServiceEntryPoint* _sep;
+
+    // The io_service must outlive the acceptors and every session's socket.
+    asio::io_service _ioService;
+    std::unique_ptr<asio::io_service::work> _ioServiceWork;
+    std::vector<GenericAcceptor> _acceptors;
+    std::vector<stdx::thread> _ioThreads;
+
+    // TransportLayerASIO holds non-owning pointers to all of its sessions.
+    mutable stdx::mutex _sessionsMutex;
+    stdx::list<std::weak_ptr<ASIOSession>> _sessions;
+
+    AtomicWord<bool> _running;
+
+    Options _options;
+};
+
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,211 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include <asio.hpp>
+#include <boost/optional.hpp>
+#include <vector>
+
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/transport/service_entry_point.h"
+#include "bongo/transport/transport_layer_asio.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/net/message.h"
+
+namespace bongo {
+namespace transport {
+namespace {
+
+/**
+ * A ServiceEntryPoint that just collects the sessions it is handed.
+ */
+class CollectingServiceEntryPoint : public ServiceEntryPoint {
+public:
+    void startSession(SessionHandle session) override {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _sessions.push_back(std::move(session));
+        _cv.notify_all();
+    }
+
+    SessionHandle waitForSession() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _cv.wait(lk, [&] { return !_sessions.empty(); });
+        auto session = std::move(_sessions.back());
+        _sessions.pop_back();
+        return session;
+    }
+
+private:
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+    std::vector<SessionHandle> _sessions;
+};
+
+Message buildMessage(const std::string& data) {
+    const auto bufferSize = MsgData::MsgDataHeaderSize + data.size();
+    auto buf = SharedBuffer::allocate(bufferSize);
+    MsgData::View testView(buf.get());
+    testView.setId(123456);
+    testView.setResponseToMsgId(654321);
+    testView.setOperation(dbQuery);
+    testView.setLen(bufferSize);
+    memcpy(testView.data(), data.data(), data.size());
+    return Message{buf};
+}
+
+class TransportLayerASIOTest : public unittest::Test {
+public:
+    void setUp() override {
+        TransportLayerASIO::Options opts;
+        opts.ipList = "127.0.0.1";
+        opts.port = 0;
+        opts.ioThreads = 2;
+
+        _tl = stdx::make_unique<TransportLayerASIO>(opts, &_sep);
+        ASSERT_OK(_tl->setup());
+        ASSERT_OK(_tl->start());
+
+        auto ports = _tl->listenerPorts();
+        ASSERT_EQ(ports.size(), 1UL);
+        _client.connect(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), ports[0]));
+        _session = _sep.waitForSession();
+    }
+
+    void tearDown() override {
+        _session.reset();
+        _tl->shutdown();
+    }
+
+protected:
+    CollectingServiceEntryPoint _sep;
+    std::unique_ptr<TransportLayerASIO> _tl;
+
+    asio::io_service _clientService;
+    asio::ip::tcp::socket _client{_clientService};
+
+    SessionHandle _session;
+};
+
+TEST_F(TransportLayerASIOTest, SourceMessageSync) {
+    auto sent = buildMessage("Hello, world!");
+    asio::write(_client, asio::buffer(sent.buf(), sent.size()));
+
+    Message received;
+    ASSERT_OK(_tl->wait(_tl->sourceMessage(_session, &received)));
+    ASSERT_EQ(received.size(), sent.size());
+    ASSERT_EQ(received.header().getId(), 123456);
+    ASSERT_EQ(memcmp(received.buf(), sent.buf(), sent.size()), 0);
+}
+
+TEST_F(TransportLayerASIOTest, SourceAndSinkMessageAsync) {
+    auto sent = buildMessage(std::string(64 * 1024, 'x'));
+    asio::write(_client, asio::buffer(sent.buf(), sent.size()));
+
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    boost::optional<Status> result;
+    auto callback = [&](Status status) {
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        result = status;
+        cv.notify_all();
+    };
+    auto waitForResult = [&] {
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        cv.wait(lk, [&] { return bool(result); });
+        auto status = *result;
+        result = boost::none;
+        return status;
+    };
+
+    Message received;
+    _tl->asyncWait(_tl->sourceMessage(_session, &received), callback);
+    ASSERT_OK(waitForResult());
+    ASSERT_EQ(received.size(), sent.size());
+    ASSERT_EQ(memcmp(received.buf(), sent.buf(), sent.size()), 0);
+
+    auto reply = buildMessage("pong");
+    _tl->asyncWait(_tl->sinkMessage(_session, reply), callback);
+    ASSERT_OK(waitForResult());
+
+    std::vector<char> echoed(reply.size());
+    asio::read(_client, asio::buffer(echoed));
+    ASSERT_EQ(memcmp(echoed.data(), reply.buf(), reply.size()), 0);
+}
+
+TEST_F(TransportLayerASIOTest, InvalidMessageLengthFails) {
+    auto sent = buildMessage("Hello, world!");
+    MsgData::View(sent.buf()).setLen(4);
+    asio::write(_client, asio::buffer(sent.buf(), sent.size()));
+
+    Message received;
+    ASSERT_EQ(_tl->wait(_tl->sourceMessage(_session, &received)).code(),
+              ErrorCodes::ProtocolError);
+}
+
+TEST_F(TransportLayerASIOTest, RemoteCloseFailsSource) {
+    _client.close();
+
+    Message received;
+    auto status = _tl->wait(_tl->sourceMessage(_session, &received));
+    ASSERT_TRUE(ErrorCodes::isNetworkError(status.code()));
+}
+
+TEST_F(TransportLayerASIOTest, EndSessionFailsPendingSource) {
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    boost::optional<Status> result;
+
+    Message received;
+    _tl->asyncWait(_tl->sourceMessage(_session, &received), [&](Status status) {
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        result = status;
+        cv.notify_all();
+    });
+
+    _tl->end(_session);
+
+    stdx::unique_lock<stdx::mutex> lk(mutex);
+    cv.wait(lk, [&] { return bool(result); });
+    ASSERT_NOT_OK(*result);
+    ASSERT_EQ(_tl->sessionStats().numOpenSessions, 1UL);
+}
+
+TEST_F(TransportLayerASIOTest, ShutdownFailsNewTickets) {
+    _tl->shutdown();
+
+    Message received;
+    ASSERT_EQ(_tl->wait(_tl->sourceMessage(_session, &received)),
+              TransportLayer::ShutdownStatus);
+}
+
+}  // namespace
+}  // namespace transport
+}  // namespace bongo
@@ -0,0 +1,143 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/transport/transport_layer_factory.h"
+
+#include "bongo/base/init.h"
+#include "bongo/db/server_parameters.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/transport/service_executor_adaptive.h"
+#include "bongo/transport/transport_layer_asio.h"
+#include "bongo/transport/transport_layer_legacy.h"
+
+namespace bongo {
+namespace transport {
+
+namespace {
+
+const char kTransportLayerASIO[] = "asio";
+const char kTransportLayerLegacy[] = "legacy";
+
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(transportLayer, std::string, kTransportLayerLegacy);
+
+// Number of I/O threads for the asio transport layer. Zero means one per available core.
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(transportLayerASIOThreads, int, 0);
+
+const char kServiceExecutorAdaptive[] = "adaptive";
+const char kServiceExecutorSynchronous[] = "synchronous";
+
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(serviceExecutor, std::string, kServiceExecutorSynchronous);
+
+// Sizing of the adaptive service executor. Zero thread counts mean "derive from the number of
+// available cores"; see ServiceExecutorAdaptive::Options.
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(adaptiveServiceExecutorReservedThreads, int, 0);
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(adaptiveServiceExecutorMaxThreads, int, 0);
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(adaptiveServiceExecutorStuckThreadTimeoutMillis, int, 250);
+BONGO_EXPORT_STARTUP_SERVER_PARAMETER(adaptiveServiceExecutorMaxIdleThreadAgeMillis, int, 10000);
+
+BONGO_INITIALIZER(transportLayer)(InitializerContext*) {
+    if ((transportLayer != kTransportLayerASIO) && (transportLayer != kTransportLayerLegacy)) {
+        return Status(ErrorCodes::BadValue, "unsupported transport layer: " + transportLayer);
+    }
+    if (transportLayerASIOThreads < 0) {
+        return Status(ErrorCodes::BadValue, "transportLayerASIOThreads must not be negative");
+    }
+
+    if ((serviceExecutor != kServiceExecutorAdaptive) &&
+        (serviceExecutor != kServiceExecutorSynchronous)) {
+        return Status(ErrorCodes::BadValue, "unsupported service executor: " + serviceExecutor);
+    }
+    if (serviceExecutor == kServiceExecutorAdaptive && transportLayer != kTransportLayerASIO) {
+        return Status(ErrorCodes::BadValue,
+                      "the adaptive service executor requires transportLayer=asio");
+    }
+    if (adaptiveServiceExecutorReservedThreads < 0 || adaptiveServiceExecutorMaxThreads < 0) {
+        return Status(ErrorCodes::BadValue,
+                      "adaptive service executor thread counts must not be negative");
+    }
+    if (adaptiveServiceExecutorMaxThreads > 0 &&
+        adaptiveServiceExecutorReservedThreads > adaptiveServiceExecutorMaxThreads) {
+        return Status(ErrorCodes::BadValue,
+                      "adaptiveServiceExecutorReservedThreads must not be greater than "
+                      "adaptiveServiceExecutorMaxThreads");
+    }
+    if (adaptiveServiceExecutorStuckThreadTimeoutMillis <= 0 ||
+        adaptiveServiceExecutorMaxIdleThreadAgeMillis <= 0) {
+        return Status(ErrorCodes::BadValue, "adaptive service executor timeouts must be positive");
+    }
+    return Status::OK();
+}
+
+}  // namespace
+
+StatusWith<std::unique_ptr<TransportLayer>> makeAndSetupTransportLayer(const std::string& ipList,
+                                                                       int port,
+                                                                       ServiceEntryPoint* sep) {
+    if (transportLayer == kTransportLayerASIO) {
+        TransportLayerASIO::Options opts;
+        opts.port = port;
+        opts.ipList = ipList;
+        opts.ioThreads = transportLayerASIOThreads;
+
+        auto tl = stdx::make_unique<TransportLayerASIO>(opts, sep);
+        auto res = tl->setup();
+        if (!res.isOK()) {
+            return res;
+        }
+        return {std::move(tl)};
+    }
+
+    TransportLayerLegacy::Options opts;
+    opts.port = port;
+    opts.ipList = ipList;
+
+    auto tl = stdx::make_unique<TransportLayerLegacy>(opts, sep);
+    auto res = tl->setup();
+    if (!res.isOK()) {
+        return res;
+    }
+    return {std::move(tl)};
+}
+
+std::unique_ptr<ServiceExecutor> makeServiceExecutor() {
+    if (serviceExecutor != kServiceExecutorAdaptive) {
+        return nullptr;
+    }
+
+    ServiceExecutorAdaptive::Options opts;
+    opts.reservedThreads = adaptiveServiceExecutorReservedThreads;
+    opts.maxThreads = adaptiveServiceExecutorMaxThreads;
+    opts.stuckThreadTimeout = Milliseconds(adaptiveServiceExecutorStuckThreadTimeoutMillis);
+    opts.maxIdleThreadAge = Milliseconds(adaptiveServiceExecutorMaxIdleThreadAgeMillis);
+    return stdx::make_unique<ServiceExecutorAdaptive>(opts);
+}
+
+}  // namespace transport
+}  // namespace bongo
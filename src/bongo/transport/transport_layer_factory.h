@@ -0,0 +1,61 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "bongo/base/status_with.h"
+#include "bongo/transport/service_executor.h"
+#include "bongo/transport/transport_layer.h"
+
+namespace bongo {
+
+class ServiceEntryPoint;
+
+namespace transport {
+
+/**
+ * Creates the ingress TransportLayer selected by the "transportLayer" startup parameter
+ * ("legacy" or "asio"), listening on 'port' on the comma separated addresses in 'ipList', and
+ * binds its listening sockets. The returned TransportLayer has not been started.
+ */
+StatusWith<std::unique_ptr<TransportLayer>> makeAndSetupTransportLayer(const std::string& ipList,
+                                                                       int port,
+                                                                       ServiceEntryPoint* sep);
+
+/**
+ * Creates the ServiceExecutor selected by the "serviceExecutor" startup parameter. Returns
+ * nullptr for "synchronous", in which case every session runs on its own thread. The returned
+ * executor has not been started.
+ */
+std::unique_ptr<ServiceExecutor> makeServiceExecutor();
+
+}  // namespace transport
+}  // namespace bongo
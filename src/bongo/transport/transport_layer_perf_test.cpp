@@ -0,0 +1,116 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * Measures how the fixture server copes with large numbers of mostly idle connections: the
+ * resident memory each connection costs, and the p99 latency of a ping issued while they are
+ * open. Run it against fixtures started with "--setParameter transportLayer=legacy" and
+ * "--setParameter transportLayer=asio" to compare thread-per-connection against the
+ * event-driven transport layer. The client's open file limit must allow the largest tier.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kNetwork
+
+#include "bongo/platform/basic.h"
+
+#include <algorithm>
+#include <asio.hpp>
+#include <vector>
+
+#include "bongo/client/connection_string.h"
+#include "bongo/client/dbclientinterface.h"
+#include "bongo/db/jsobj.h"
+#include "bongo/unittest/integration_test.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/log.h"
+#include "bongo/util/net/hostandport.h"
+#include "bongo/util/timer.h"
+
+namespace bongo {
+namespace transport {
+namespace {
+
+const std::size_t kConnectionTiers[] = {10000, 20000, 50000};
+const std::size_t kPingsPerTier = 10000;
+
+long long residentMB(DBClientConnection& conn) {
+    BSONObj status;
+    ASSERT_TRUE(conn.runCommand("admin", BSON("serverStatus" << 1), status));
+    return status["mem"]["resident"].numberLong();
+}
+
+Microseconds pingP99(DBClientConnection& conn) {
+    std::vector<Microseconds> latencies;
+    latencies.reserve(kPingsPerTier);
+
+    for (std::size_t i = 0; i < kPingsPerTier; ++i) {
+        BSONObj result;
+        Timer timer;
+        ASSERT_TRUE(conn.runCommand("admin", BSON("ping" << 1), result));
+        latencies.push_back(Microseconds(timer.micros()));
+    }
+
+    auto p99 = latencies.begin() + (latencies.size() * 99) / 100;
+    std::nth_element(latencies.begin(), p99, latencies.end());
+    return *p99;
+}
+
+TEST(TransportLayerPerf, IdleConnectionScaling) {
+    const auto server = unittest::getFixtureConnectionString().getServers()[0];
+
+    DBClientConnection conn;
+    ASSERT_OK(conn.connect(server, "TransportLayerPerf"));
+    const auto baselineMB = residentMB(conn);
+
+    asio::io_service service;
+    asio::ip::tcp::resolver resolver(service);
+    const auto endpoint = *resolver.resolve({server.host(), std::to_string(server.port())});
+
+    std::vector<asio::ip::tcp::socket> idle;
+    for (auto tier : kConnectionTiers) {
+        while (idle.size() < tier) {
+            asio::ip::tcp::socket socket(service);
+            std::error_code ec;
+            socket.connect(endpoint, ec);
+            if (ec) {
+                log() << "stopping at " << idle.size() << " connections: " << ec.message();
+                return;
+            }
+            idle.push_back(std::move(socket));
+        }
+
+        const auto p99 = pingP99(conn);
+        const auto deltaMB = std::max(residentMB(conn) - baselineMB, 1LL);
+        log() << "THROUGHPUT " << tier << " idle connections: " << (tier * 1024) / deltaMB
+              << " connections/GB (" << deltaMB << "MB resident), ping p99 " << p99;
+    }
+}
+
+}  // namespace
+}  // namespace transport
+}  // namespace bongo
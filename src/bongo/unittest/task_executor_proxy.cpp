@@ -97,6 +97,11 @@ StatusWith<executor::TaskExecutor::CallbackHandle> TaskExecutorProxy::scheduleRe
     return _executor->scheduleRemoteCommand(request, cb);
 }
 
+std::vector<StatusWith<executor::TaskExecutor::CallbackHandle>>
+TaskExecutorProxy::scheduleRemoteCommands(const std::vector<RemoteCommandBatchEntry>& batch) {
+    return _executor->scheduleRemoteCommands(batch);
+}
+
 void TaskExecutorProxy::cancel(const CallbackHandle& cbHandle) {
     _executor->cancel(cbHandle);
 }
@@ -64,6 +64,8 @@ public:
     virtual StatusWith<CallbackHandle> scheduleWorkAt(Date_t when, const CallbackFn& work) override;
     virtual StatusWith<CallbackHandle> scheduleRemoteCommand(
         const executor::RemoteCommandRequest& request, const RemoteCommandCallbackFn& cb) override;
+    virtual std::vector<StatusWith<CallbackHandle>> scheduleRemoteCommands(
+        const std::vector<RemoteCommandBatchEntry>& batch) override;
     virtual void cancel(const CallbackHandle& cbHandle) override;
     virtual void wait(const CallbackHandle& cbHandle) override;
     virtual void appendConnectionStats(executor::ConnectionPoolStats* stats) const override;
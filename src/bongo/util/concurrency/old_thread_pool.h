@@ -32,13 +32,13 @@
 
 #include "bongo/base/disallow_copying.h"
 #include "bongo/stdx/functional.h"
-#include "bongo/util/concurrency/thread_pool.h"
+#include "bongo/util/concurrency/work_stealing_thread_pool.h"
 
 namespace bongo {
 
 /**
  * Implementation of a fixed-size pool of threads that can perform scheduled
- * tasks.
+ * tasks, backed by a WorkStealingThreadPool.
  *
  * Deprecated.  Use ThreadPool from thread_pool.h, instead.
  */
@@ -55,7 +55,7 @@ public:
                            const std::string& threadNamePrefix = "");
 
     std::size_t getNumThreads() const;
-    ThreadPool::Stats getStats() const;
+    WorkStealingThreadPool::Stats getStats() const;
 
     // Launches the worker threads; call exactly once, if and only if
     // you used the DoNotStartThreadsTag form of the constructor.
@@ -93,7 +93,7 @@ public:
     }
 
 private:
-    ThreadPool _pool;
+    WorkStealingThreadPool _pool;
 };
 
 }  // namespace bongo
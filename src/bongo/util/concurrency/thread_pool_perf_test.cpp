@@ -0,0 +1,54 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/base/init.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/util/concurrency/thread_pool.h"
+#include "bongo/util/concurrency/thread_pool_perf_test_common.h"
+#include "bongo/util/concurrency/work_stealing_thread_pool.h"
+
+namespace {
+using namespace bongo;
+
+BONGO_INITIALIZER(ThreadPoolPerfTests)(InitializerContext*) {
+    addPerfTestsForThreadPool("ThreadPoolPerf", [](std::size_t numThreads) {
+        ThreadPool::Options options;
+        options.minThreads = options.maxThreads = numThreads;
+        return stdx::make_unique<ThreadPool>(options);
+    });
+    addPerfTestsForThreadPool("WorkStealingThreadPoolPerf", [](std::size_t numThreads) {
+        WorkStealingThreadPool::Options options;
+        options.numThreads = numThreads;
+        return stdx::make_unique<WorkStealingThreadPool>(options);
+    });
+    return Status::OK();
+}
+
+}  // namespace
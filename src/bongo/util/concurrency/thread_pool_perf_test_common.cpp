@@ -0,0 +1,218 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kDefault
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/util/concurrency/thread_pool_perf_test_common.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "bongo/platform/atomic_word.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/assert_util.h"
+#include "bongo/util/concurrency/thread_pool_interface.h"
+#include "bongo/util/log.h"
+#include "bongo/util/bongoutils/str.h"
+#include "bongo/util/time_support.h"
+#include "bongo/util/timer.h"
+
+namespace bongo {
+namespace {
+
+using ThreadPoolFactory = stdx::function<std::unique_ptr<ThreadPoolInterface>(std::size_t)>;
+
+const std::vector<std::size_t> kThreadCounts{1, 2, 4, 8, 16, 32, 64};
+
+// Every task does this many iterations of busy work, so that the pools are measured on tasks of
+// roughly the size of applying an oplog entry rather than on empty ones.
+const std::size_t kIterationsPerTask = 500;
+
+/**
+ * Busy work that the compiler cannot optimize away.
+ */
+void doWork() {
+    static AtomicUInt64 sink;
+    unsigned long long x = 0;
+    for (std::size_t i = 0; i < kIterationsPerTask; ++i) {
+        x = x * 6364136223846793005ULL + i;
+    }
+    if (x == 0) {
+        sink.fetchAndAdd(1);
+    }
+}
+
+/**
+ * Counts finished tasks and their queued time, and lets the benchmark thread wait for all of
+ * them to finish.
+ */
+class Completion {
+public:
+    explicit Completion(std::size_t numTasks) : _remaining(numTasks) {}
+
+    void taskDone(unsigned long long scheduledMicros) {
+        const auto now = curTimeMicros64();
+        _totalQueuedMicros.fetchAndAdd(now > scheduledMicros ? now - scheduledMicros : 0);
+        _numDone.fetchAndAdd(1);
+        if (_remaining.subtractAndFetch(1) == 0) {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _done = true;
+            _cv.notify_all();
+        }
+    }
+
+    void wait() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _cv.wait(lk, [this] { return _done; });
+    }
+
+    unsigned long long totalQueuedMicros() const {
+        return _totalQueuedMicros.load();
+    }
+
+    unsigned long long numDone() const {
+        return _numDone.load();
+    }
+
+private:
+    AtomicUInt64 _remaining;
+    AtomicUInt64 _numDone;
+    AtomicUInt64 _totalQueuedMicros;
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+    bool _done = false;
+};
+
+void logResult(const std::string& testName,
+               std::size_t numThreads,
+               std::size_t numTasks,
+               long long micros,
+               const Completion& completion) {
+    log() << "THROUGHPUT " << testName << " with " << numThreads
+          << " threads: " << static_cast<long long>(numTasks) * 1000000 / std::max(micros, 1LL)
+          << " tasks/s, mean queued time "
+          << completion.totalQueuedMicros() / std::max<std::size_t>(numTasks, 1) << "us";
+}
+
+/**
+ * Four threads outside the pool schedule small independent tasks, the way the oplog applier
+ * hands batches to the replication writer pool.
+ */
+void runExternalScheduling(const std::string& testName, const ThreadPoolFactory& makeThreadPool) {
+    const std::size_t numProducers = 4;
+    const std::size_t tasksPerProducer = 16384;
+    const std::size_t numTasks = numProducers * tasksPerProducer;
+    for (auto numThreads : kThreadCounts) {
+        auto pool = makeThreadPool(numThreads);
+        pool->startup();
+        Completion completion(numTasks);
+
+        Timer t;
+        std::vector<stdx::thread> producers;
+        for (std::size_t i = 0; i < numProducers; ++i) {
+            producers.emplace_back([&] {
+                for (std::size_t j = 0; j < tasksPerProducer; ++j) {
+                    const auto scheduledMicros = curTimeMicros64();
+                    uassertStatusOK(pool->schedule([&completion, scheduledMicros] {
+                        doWork();
+                        completion.taskDone(scheduledMicros);
+                    }));
+                }
+            });
+        }
+        for (auto&& producer : producers) {
+            producer.join();
+        }
+        completion.wait();
+        logResult(testName, numThreads, numTasks, t.micros(), completion);
+        ASSERT_EQ(completion.numDone(), numTasks);
+
+        pool->shutdown();
+        pool->join();
+    }
+}
+
+/**
+ * Tasks recursively split a range in two and schedule both halves from inside the pool until
+ * they reach single elements, so that the pool itself is the main source of its tasks.
+ */
+void runForkJoin(const std::string& testName, const ThreadPoolFactory& makeThreadPool) {
+    const std::size_t numLeaves = 32768;
+    const std::size_t numTasks = 2 * numLeaves - 1;
+    for (auto numThreads : kThreadCounts) {
+        auto pool = makeThreadPool(numThreads);
+        pool->startup();
+        Completion completion(numTasks);
+        AtomicUInt64 numLeavesDone;
+
+        stdx::function<void(std::size_t, unsigned long long)> split;
+        split = [&](std::size_t size, unsigned long long scheduledMicros) {
+            if (size > 1) {
+                for (auto half : {size / 2, size - size / 2}) {
+                    const auto now = curTimeMicros64();
+                    uassertStatusOK(pool->schedule([&split, half, now] { split(half, now); }));
+                }
+            } else {
+                doWork();
+                numLeavesDone.fetchAndAdd(1);
+            }
+            completion.taskDone(scheduledMicros);
+        };
+
+        Timer t;
+        const auto scheduledMicros = curTimeMicros64();
+        uassertStatusOK(
+            pool->schedule([&split, scheduledMicros] { split(numLeaves, scheduledMicros); }));
+        completion.wait();
+        logResult(testName, numThreads, numTasks, t.micros(), completion);
+        ASSERT_EQ(completion.numDone(), numTasks);
+        ASSERT_EQ(numLeavesDone.load(), numLeaves);
+
+        pool->shutdown();
+        pool->join();
+    }
+}
+
+}  // namespace
+
+void addPerfTestsForThreadPool(const std::string& suiteName, ThreadPoolFactory makeThreadPool) {
+    auto suite = unittest::Suite::getSuite(suiteName);
+    suite->add(str::stream() << suiteName << "::ExternalScheduling", [suiteName, makeThreadPool] {
+        runExternalScheduling(suiteName + "::ExternalScheduling", makeThreadPool);
+    });
+    suite->add(str::stream() << suiteName << "::ForkJoin", [suiteName, makeThreadPool] {
+        runForkJoin(suiteName + "::ForkJoin", makeThreadPool);
+    });
+}
+
+}  // namespace bongo
@@ -31,8 +31,10 @@
 
 #include "bongo/util/concurrency/ticketholder.h"
 
+#include <algorithm>
 #include <iostream>
 
+#include "bongo/bson/bsonobjbuilder.h"
 #include "bongo/util/log.h"
 #include "bongo/util/bongoutils/str.h"
 
@@ -71,7 +73,7 @@ bool TicketHolder::tryAcquire() {
     return true;
 }
 
-void TicketHolder::waitForTicket() {
+void TicketHolder::_waitForTicket() {
     while (0 != sem_wait(&_sem)) {
         switch (errno) {
             case EINTR:
@@ -83,9 +85,25 @@ void TicketHolder::waitForTicket() {
 }
 
 void TicketHolder::release() {
+    _numReleased.fetchAndAdd(1);
+    if (_tryRetire()) {
+        return;
+    }
     _check(sem_post(&_sem));
 }
 
+bool TicketHolder::_tryRetire() {
+    int numToRetire = _numToRetire.load();
+    while (numToRetire > 0) {
+        const int previous = _numToRetire.compareAndSwap(numToRetire, numToRetire - 1);
+        if (previous == numToRetire) {
+            return true;
+        }
+        numToRetire = previous;
+    }
+    return false;
+}
+
 Status TicketHolder::resize(int newSize) {
     stdx::lock_guard<stdx::mutex> lk(_resizeMutex);
 
@@ -99,13 +117,20 @@ Status TicketHolder::resize(int newSize) {
                                     << "; given "
                                     << newSize);
 
+    // Growing first takes back tickets that are still due to be retired.
     while (_outof.load() < newSize) {
-        release();
+        if (!_tryRetire()) {
+            _check(sem_post(&_sem));
+        }
         _outof.fetchAndAdd(1);
     }
 
+    // Shrinking does not wait for tickets in use: those not available now are retired by
+    // release() as they come back.
     while (_outof.load() > newSize) {
-        waitForTicket();
+        if (!tryAcquire()) {
+            _numToRetire.fetchAndAdd(1);
+        }
         _outof.subtractAndFetch(1);
     }
 
@@ -120,7 +145,7 @@ int TicketHolder::available() const {
 }
 
 int TicketHolder::used() const {
-    return outof() - available();
+    return outof() + _numToRetire.load() - available();
 }
 
 int TicketHolder::outof() const {
@@ -138,7 +163,7 @@ bool TicketHolder::tryAcquire() {
     return _tryAcquire();
 }
 
-void TicketHolder::waitForTicket() {
+void TicketHolder::_waitForTicket() {
     stdx::unique_lock<stdx::mutex> lk(_mutex);
 
     while (!_tryAcquire()) {
@@ -147,6 +172,7 @@ void TicketHolder::waitForTicket() {
 }
 
 void TicketHolder::release() {
+    _numReleased.fetchAndAdd(1);
     {
         stdx::lock_guard<stdx::mutex> lk(_mutex);
         _num++;
@@ -199,4 +225,185 @@ bool TicketHolder::_tryAcquire() {
     return true;
 }
 #endif
+
+void TicketHolder::waitForTicket() {
+    waitForTicket(Priority::kNormal);
 }
+
+void TicketHolder::waitForTicket(Priority priority) {
+    const bool isNormalPriority = priority == Priority::kNormal;
+    if ((isNormalPriority || _numNormalPriorityWaiting.load() == 0) && tryAcquire()) {
+        return;
+    }
+
+    auto& numWaiting = isNormalPriority ? _numNormalPriorityWaiting : _numLowPriorityWaiting;
+    numWaiting.fetchAndAdd(1);
+    if (!isNormalPriority) {
+        _standAsideForNormalPriority();
+    }
+    _waitForTicket();
+
+    // The count of waiters is lowered before the count of the other priority's waiters is
+    // checked, and _standAsideForNormalPriority() raises its count before checking ours, so a
+    // kLow caller either sees no kNormal waiters or is woken here.
+    if (numWaiting.subtractAndFetch(1) == 0 && isNormalPriority &&
+        _numLowPriorityWaiting.load() != 0) {
+        stdx::lock_guard<stdx::mutex> lk(_priorityMutex);
+        _noNormalPriorityWaiters.notify_all();
+    }
+}
+
+void TicketHolder::_standAsideForNormalPriority() {
+    const Milliseconds maxDelay(_lowPriorityMaxDelayMillis.load());
+    if (maxDelay <= Milliseconds(0) || _numNormalPriorityWaiting.load() == 0) {
+        return;
+    }
+
+    _numLowPriorityDelayed.fetchAndAdd(1);
+    stdx::unique_lock<stdx::mutex> lk(_priorityMutex);
+    _noNormalPriorityWaiters.wait_for(lk, maxDelay.toSystemDuration(), [this] {
+        return _numNormalPriorityWaiting.load() == 0;
+    });
+}
+
+long long TicketHolder::numReleased() const {
+    return _numReleased.load();
+}
+
+int TicketHolder::numWaiting() const {
+    return _numNormalPriorityWaiting.load() + _numLowPriorityWaiting.load();
+}
+
+long long TicketHolder::numLowPriorityDelayed() const {
+    return _numLowPriorityDelayed.load();
+}
+
+void TicketHolder::setLowPriorityMaxDelay(Milliseconds maxDelay) {
+    _lowPriorityMaxDelayMillis.store(durationCount<Milliseconds>(maxDelay));
+}
+
+namespace {
+
+// How far the baseline hold time moves towards a higher sample on each adjustment, so that a
+// lasting change in the workload eventually becomes the new baseline.
+const double kBaselineDrift = 0.01;
+
+}  // namespace
+
+AdaptiveTicketSizer::AdaptiveTicketSizer(TicketHolder* holder, Options options)
+    : _holder(holder), _options(std::move(options)), _lastNumReleased(holder->numReleased()) {
+    invariant(_options.minTickets > 0);
+    invariant(_options.minTickets <= _options.maxTickets);
+}
+
+Status AdaptiveTicketSizer::resize(int newSize) {
+    stdx::lock_guard<stdx::mutex> lk(_resizeMutex);
+    return _holder->resize(newSize);
+}
+
+AdaptiveTicketSizer::Decision AdaptiveTicketSizer::adjust(Milliseconds elapsed, double pressure) {
+    // Held until the holder is resized, so that resize() cannot change its size in between.
+    stdx::lock_guard<stdx::mutex> resizeLk(_resizeMutex);
+
+    const int outof = _holder->outof();
+    const int used = _holder->used();
+    const int numWaiting = _holder->numWaiting();
+    const long long numReleased = _holder->numReleased();
+
+    Decision decision = Decision::kHold;
+    int newSize = outof;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        const long long released = numReleased - _lastNumReleased;
+        _lastNumReleased = numReleased;
+        _lastPressure = pressure;
+
+        // By Little's law, the tickets in use are the release rate times the mean hold time.
+        bool haveHoldTime = false;
+        if (released > 0 && used > 0 && elapsed > Milliseconds(0)) {
+            _lastHoldMicros = used * static_cast<double>(durationCount<Microseconds>(elapsed)) /
+                static_cast<double>(released);
+            if (_baselineHoldMicros == 0 || _lastHoldMicros < _baselineHoldMicros) {
+                _baselineHoldMicros = _lastHoldMicros;
+            } else {
+                _baselineHoldMicros += (_lastHoldMicros - _baselineHoldMicros) * kBaselineDrift;
+            }
+            haveHoldTime = true;
+        }
+
+        if (pressure >= _options.pressureThreshold) {
+            decision = Decision::kShrinkForPressure;
+            newSize = static_cast<int>(outof * _options.shrinkFactor);
+        } else if (haveHoldTime && used >= outof / 2 &&
+                   _lastHoldMicros > _baselineHoldMicros * _options.latencyTolerance) {
+            decision = Decision::kShrinkForLatency;
+            newSize = static_cast<int>(outof * _options.shrinkFactor);
+        } else if (numWaiting > 0) {
+            decision = Decision::kGrow;
+            newSize = outof + _options.growStep;
+        }
+        newSize = std::max(_options.minTickets, std::min(_options.maxTickets, newSize));
+        if (newSize == outof) {
+            decision = Decision::kHold;
+        }
+    }
+
+    if (decision != Decision::kHold) {
+        Status status = _holder->resize(newSize);
+        if (!status.isOK()) {
+            warning() << "Failed to resize tickets from " << outof << " to " << newSize << ": "
+                      << status;
+            decision = Decision::kHold;
+        } else {
+            LOG(1) << "Resized tickets from " << outof << " to " << newSize << " ("
+                   << decisionToString(decision) << "); " << used << " in use, " << numWaiting
+                   << " waiting, storage engine pressure " << pressure;
+        }
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _lastDecision = decision;
+    switch (decision) {
+        case Decision::kHold:
+            break;
+        case Decision::kGrow:
+            ++_numGrown;
+            break;
+        case Decision::kShrinkForLatency:
+            ++_numShrunkForLatency;
+            break;
+        case Decision::kShrinkForPressure:
+            ++_numShrunkForPressure;
+            break;
+    }
+    return decision;
+}
+
+void AdaptiveTicketSizer::appendStats(BSONObjBuilder* builder) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    builder->append("lastDecision", decisionToString(_lastDecision));
+    builder->append("holdTimeMicros", static_cast<long long>(_lastHoldMicros));
+    builder->append("baselineHoldTimeMicros", static_cast<long long>(_baselineHoldMicros));
+    builder->append("storageEnginePressure", _lastPressure);
+    builder->append("waiting", _holder->numWaiting());
+    builder->append("grown", _numGrown);
+    builder->append("shrunkForLatency", _numShrunkForLatency);
+    builder->append("shrunkForPressure", _numShrunkForPressure);
+    builder->append("lowPriorityDelayed", _holder->numLowPriorityDelayed());
+}
+
+const char* AdaptiveTicketSizer::decisionToString(Decision decision) {
+    switch (decision) {
+        case Decision::kHold:
+            return "hold";
+        case Decision::kGrow:
+            return "grow";
+        case Decision::kShrinkForLatency:
+            return "shrinkForLatency";
+        case Decision::kShrinkForPressure:
+            return "shrinkForPressure";
+    }
+    BONGO_UNREACHABLE;
+}
+
+}  // namespace bongo
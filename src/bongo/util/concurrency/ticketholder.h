@@ -31,16 +31,27 @@
 #endif
 
 #include "bongo/base/disallow_copying.h"
+#include "bongo/platform/atomic_word.h"
 #include "bongo/stdx/condition_variable.h"
 #include "bongo/stdx/mutex.h"
 #include "bongo/util/concurrency/mutex.h"
+#include "bongo/util/time_support.h"
 
 namespace bongo {
 
+class BSONObjBuilder;
+
 class TicketHolder {
     BONGO_DISALLOW_COPYING(TicketHolder);
 
 public:
+    /**
+     * How urgently a caller needs its ticket. While low priority waiting is enabled (see
+     * setLowPriorityMaxDelay()), a kLow caller that cannot get a ticket at once stands aside
+     * for up to that long while any kNormal callers are waiting.
+     */
+    enum class Priority { kNormal, kLow };
+
     explicit TicketHolder(int num);
     ~TicketHolder();
 
@@ -48,8 +59,14 @@ public:
 
     void waitForTicket();
 
+    void waitForTicket(Priority priority);
+
     void release();
 
+    /**
+     * Changes the number of tickets. Shrinking does not wait for tickets in use: any beyond the
+     * new size are retired as they are released.
+     */
     Status resize(int newSize);
 
     int available() const;
@@ -58,13 +75,62 @@ public:
 
     int outof() const;
 
+    /**
+     * Number of tickets released since construction.
+     */
+    long long numReleased() const;
+
+    /**
+     * Number of callers waiting for a ticket, at either priority.
+     */
+    int numWaiting() const;
+
+    /**
+     * Number of times a kLow caller has stood aside for kNormal ones.
+     */
+    long long numLowPriorityDelayed() const;
+
+    /**
+     * Sets how long a kLow caller may stand aside for kNormal ones. Zero, the default, disables
+     * low priority waiting, so that both priorities queue alike.
+     */
+    void setLowPriorityMaxDelay(Milliseconds maxDelay);
+
 private:
+    /**
+     * Blocks until a ticket is acquired, regardless of priority.
+     */
+    void _waitForTicket();
+
+    /**
+     * Lets kNormal callers go first, for up to the low priority max delay.
+     */
+    void _standAsideForNormalPriority();
+
+    AtomicInt64 _numReleased;
+    AtomicInt32 _numNormalPriorityWaiting;
+    AtomicInt32 _numLowPriorityWaiting;
+    AtomicInt64 _numLowPriorityDelayed;
+    AtomicInt64 _lowPriorityMaxDelayMillis;
+
+    // Signaled when the last kNormal waiter gets its ticket while kLow callers are waiting.
+    stdx::mutex _priorityMutex;
+    stdx::condition_variable _noNormalPriorityWaiters;
+
 #if defined(__linux__)
+    /**
+     * Takes one off the count of tickets to retire, if any are due. Returns whether it did.
+     */
+    bool _tryRetire();
+
     mutable sem_t _sem;
 
     // You can read _outof without a lock, but have to hold _resizeMutex to change.
     AtomicInt32 _outof;
     stdx::mutex _resizeMutex;
+
+    // Tickets in use that a shrink has taken off _outof, to be dropped rather than released.
+    AtomicInt32 _numToRetire;
 #else
     bool _tryAcquire();
 
@@ -121,4 +187,82 @@ public:
 private:
     TicketHolder* _holder;
 };
-}
+
+/**
+ * Adaptive mode for a TicketHolder: resizes it so that it admits as many concurrent operations
+ * as the system can serve without latency or storage engine pressure building up.
+ *
+ * Each call to adjust() samples the holder. The rate of released tickets and the number in use
+ * give the mean time a ticket is held, by Little's law. That is compared against the lowest
+ * recently seen. The holder shrinks multiplicatively when the caller reports pressure at or
+ * above Options::pressureThreshold, or when hold times exceed the baseline by more than
+ * Options::latencyTolerance. Otherwise it grows additively while callers are queued for tickets.
+ *
+ * adjust() must be called from one thread at a time; appendStats() and resize() may be called
+ * from any.
+ */
+class AdaptiveTicketSizer {
+    BONGO_DISALLOW_COPYING(AdaptiveTicketSizer);
+
+public:
+    struct Options {
+        // Bounds on the number of tickets.
+        int minTickets = 16;
+        int maxTickets = 256;
+
+        // Hold times above this multiple of the baseline count as degraded.
+        double latencyTolerance = 2.0;
+
+        // Pressure, as reported by the caller, at or above which the holder shrinks.
+        double pressureThreshold = 1.0;
+
+        // Factor by which the holder shrinks, and tickets by which it grows, per adjustment.
+        double shrinkFactor = 0.9;
+        int growStep = 4;
+    };
+
+    enum class Decision { kHold, kGrow, kShrinkForLatency, kShrinkForPressure };
+
+    AdaptiveTicketSizer(TicketHolder* holder, Options options);
+
+    /**
+     * Samples the holder, "elapsed" after the previous call, and resizes it if warranted.
+     * "pressure" is a measure of storage engine pressure, where 1.0 means that the engine has
+     * started making operations do its housekeeping.
+     */
+    Decision adjust(Milliseconds elapsed, double pressure);
+
+    /**
+     * Resizes the holder on behalf of another caller, such as a server parameter, without
+     * interleaving with adjust().
+     */
+    Status resize(int newSize);
+
+    /**
+     * Appends the current state and counts of past decisions, for serverStatus.
+     */
+    void appendStats(BSONObjBuilder* builder) const;
+
+    static const char* decisionToString(Decision decision);
+
+private:
+    TicketHolder* const _holder;
+    const Options _options;
+
+    // Serializes resizing the holder, by adjust() or resize().
+    stdx::mutex _resizeMutex;
+
+    // Guards everything below.
+    mutable stdx::mutex _mutex;
+
+    long long _lastNumReleased;
+    double _lastHoldMicros = 0;
+    double _baselineHoldMicros = 0;
+    double _lastPressure = 0;
+    Decision _lastDecision = Decision::kHold;
+    long long _numGrown = 0;
+    long long _numShrunkForLatency = 0;
+    long long _numShrunkForPressure = 0;
+};
+
+}  // namespace bongo
@@ -0,0 +1,233 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "bongo/platform/basic.h"
+
+#include <vector>
+
+#include "bongo/bson/bsonobjbuilder.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/concurrency/ticketholder.h"
+#include "bongo/util/time_support.h"
+
+namespace {
+using namespace bongo;
+
+void acquireTickets(TicketHolder* holder, int num) {
+    for (int i = 0; i < num; ++i) {
+        ASSERT_TRUE(holder->tryAcquire());
+    }
+}
+
+void releaseTickets(TicketHolder* holder, int num) {
+    for (int i = 0; i < num; ++i) {
+        holder->release();
+    }
+}
+
+void waitForWaiters(TicketHolder* holder, int num) {
+    while (holder->numWaiting() != num) {
+        sleepmillis(1);
+    }
+}
+
+AdaptiveTicketSizer::Options makeOptions(int minTickets, int maxTickets) {
+    AdaptiveTicketSizer::Options options;
+    options.minTickets = minTickets;
+    options.maxTickets = maxTickets;
+    return options;
+}
+
+TEST(TicketHolderTest, LowPriorityWaitsBehindNormalPriority) {
+    TicketHolder holder(1);
+    holder.setLowPriorityMaxDelay(Seconds(60));
+    acquireTickets(&holder, 1);
+
+    stdx::mutex mutex;
+    std::vector<TicketHolder::Priority> order;
+    const auto waitAndRecord = [&](TicketHolder::Priority priority) {
+        holder.waitForTicket(priority);
+        {
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            order.push_back(priority);
+        }
+        holder.release();
+    };
+
+    stdx::thread normal(waitAndRecord, TicketHolder::Priority::kNormal);
+    waitForWaiters(&holder, 1);
+    stdx::thread low(waitAndRecord, TicketHolder::Priority::kLow);
+    waitForWaiters(&holder, 2);
+    while (holder.numLowPriorityDelayed() != 1) {
+        sleepmillis(1);
+    }
+
+    holder.release();
+    normal.join();
+    low.join();
+
+    ASSERT_EQ(2U, order.size());
+    ASSERT(order[0] == TicketHolder::Priority::kNormal);
+    ASSERT(order[1] == TicketHolder::Priority::kLow);
+    ASSERT_EQ(1, holder.available());
+}
+
+TEST(TicketHolderTest, LowPriorityQueuesAlikeByDefault) {
+    TicketHolder holder(1);
+    acquireTickets(&holder, 1);
+
+    stdx::thread normal([&] {
+        holder.waitForTicket(TicketHolder::Priority::kNormal);
+        holder.release();
+    });
+    waitForWaiters(&holder, 1);
+    stdx::thread low([&] {
+        holder.waitForTicket(TicketHolder::Priority::kLow);
+        holder.release();
+    });
+    waitForWaiters(&holder, 2);
+
+    holder.release();
+    normal.join();
+    low.join();
+    ASSERT_EQ(0, holder.numLowPriorityDelayed());
+}
+
+#if defined(__linux__)
+TEST(TicketHolderTest, ShrinkRetiresTicketsInUseAsTheyAreReleased) {
+    TicketHolder holder(10);
+    acquireTickets(&holder, 8);
+
+    ASSERT_OK(holder.resize(5));
+    ASSERT_EQ(5, holder.outof());
+    ASSERT_EQ(0, holder.available());
+    ASSERT_EQ(8, holder.used());
+
+    releaseTickets(&holder, 3);
+    ASSERT_EQ(0, holder.available());
+    ASSERT_EQ(5, holder.used());
+
+    releaseTickets(&holder, 1);
+    ASSERT_EQ(1, holder.available());
+    ASSERT_EQ(4, holder.used());
+}
+
+TEST(TicketHolderTest, GrowTakesBackTicketsDueToBeRetired) {
+    TicketHolder holder(10);
+    acquireTickets(&holder, 10);
+
+    ASSERT_OK(holder.resize(6));
+    ASSERT_OK(holder.resize(8));
+    ASSERT_EQ(0, holder.available());
+    ASSERT_EQ(10, holder.used());
+
+    releaseTickets(&holder, 3);
+    ASSERT_EQ(1, holder.available());
+    ASSERT_EQ(7, holder.used());
+
+    ASSERT_OK(holder.resize(12));
+    ASSERT_EQ(5, holder.available());
+    ASSERT_EQ(7, holder.used());
+}
+#endif
+
+TEST(AdaptiveTicketSizerTest, HoldsWhenNobodyWaits) {
+    TicketHolder holder(32);
+    AdaptiveTicketSizer sizer(&holder, makeOptions(16, 64));
+    acquireTickets(&holder, 8);
+    ASSERT(AdaptiveTicketSizer::Decision::kHold == sizer.adjust(Seconds(1), 0.5));
+    ASSERT_EQ(32, holder.outof());
+    releaseTickets(&holder, 8);
+}
+
+TEST(AdaptiveTicketSizerTest, GrowsWhileCallersWait) {
+    TicketHolder holder(16);
+    AdaptiveTicketSizer sizer(&holder, makeOptions(16, 18));
+    acquireTickets(&holder, 16);
+    stdx::thread waiter([&] {
+        holder.waitForTicket();
+        holder.release();
+    });
+    waitForWaiters(&holder, 1);
+
+    ASSERT(AdaptiveTicketSizer::Decision::kGrow == sizer.adjust(Seconds(1), 0.5));
+    waiter.join();
+    ASSERT_EQ(18, holder.outof());
+
+    // Already at the maximum.
+    acquireTickets(&holder, 2);
+    stdx::thread secondWaiter([&] {
+        holder.waitForTicket();
+        holder.release();
+    });
+    waitForWaiters(&holder, 1);
+    ASSERT(AdaptiveTicketSizer::Decision::kHold == sizer.adjust(Seconds(1), 0.5));
+    ASSERT_EQ(18, holder.outof());
+    releaseTickets(&holder, 1);
+    secondWaiter.join();
+    releaseTickets(&holder, 17);
+}
+
+TEST(AdaptiveTicketSizerTest, ShrinksUnderStorageEnginePressure) {
+    TicketHolder holder(100);
+    AdaptiveTicketSizer sizer(&holder, makeOptions(85, 128));
+    ASSERT(AdaptiveTicketSizer::Decision::kShrinkForPressure == sizer.adjust(Seconds(1), 1.0));
+    ASSERT_EQ(90, holder.outof());
+    ASSERT(AdaptiveTicketSizer::Decision::kShrinkForPressure == sizer.adjust(Seconds(1), 2.0));
+    ASSERT_EQ(85, holder.outof());
+    ASSERT(AdaptiveTicketSizer::Decision::kHold == sizer.adjust(Seconds(1), 2.0));
+    ASSERT_EQ(85, holder.outof());
+}
+
+TEST(AdaptiveTicketSizerTest, ShrinksWhenHoldTimeDegrades) {
+    TicketHolder holder(32);
+    AdaptiveTicketSizer sizer(&holder, makeOptions(16, 64));
+
+    // 16 tickets in use and 16 released in a second: tickets are held for a second each.
+    acquireTickets(&holder, 16);
+    releaseTickets(&holder, 16);
+    acquireTickets(&holder, 16);
+    ASSERT(AdaptiveTicketSizer::Decision::kHold == sizer.adjust(Seconds(1), 0.5));
+
+    // Now only 2 are released in a second, so tickets are held for 8 seconds each.
+    releaseTickets(&holder, 2);
+    acquireTickets(&holder, 2);
+    ASSERT(AdaptiveTicketSizer::Decision::kShrinkForLatency == sizer.adjust(Seconds(1), 0.5));
+    ASSERT_EQ(28, holder.outof());
+
+    BSONObjBuilder builder;
+    sizer.appendStats(&builder);
+    BSONObj stats = builder.obj();
+    ASSERT_EQ(1, stats["shrunkForLatency"].numberLong());
+    ASSERT_EQ(8000000, stats["holdTimeMicros"].numberLong());
+    releaseTickets(&holder, 16);
+}
+
+}  // namespace
@@ -0,0 +1,379 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kExecutor
+
+#include "bongo/platform/basic.h"
+
+#include "bongo/util/concurrency/work_stealing_thread_pool.h"
+
+#include <algorithm>
+
+#include "bongo/base/status.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/util/assert_util.h"
+#include "bongo/util/concurrency/thread_name.h"
+#include "bongo/util/concurrency/threadlocal.h"
+#include "bongo/util/log.h"
+#include "bongo/util/scopeguard.h"
+#include "bongo/util/bongoutils/str.h"
+
+namespace bongo {
+
+namespace {
+
+// Counter used to assign unique names to otherwise-unnamed thread pools.
+AtomicInt32 nextUnnamedThreadPoolId{1};
+
+// The pool, if any, whose worker thread this is, and that worker's index.
+BONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL const WorkStealingThreadPool* currentPool = nullptr;
+BONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL size_t currentWorkerIndex = 0;
+
+/**
+ * Sets defaults and checks bounds limits on "options", and returns it.
+ */
+WorkStealingThreadPool::Options cleanUpOptions(WorkStealingThreadPool::Options&& options) {
+    if (options.poolName.empty()) {
+        options.poolName = str::stream() << "WorkStealingThreadPool"
+                                         << nextUnnamedThreadPoolId.fetchAndAdd(1);
+    }
+    if (options.threadNamePrefix.empty()) {
+        options.threadNamePrefix = str::stream() << options.poolName << '-';
+    }
+    if (options.numThreads < 1) {
+        severe() << "Tried to create pool " << options.poolName << " with "
+                 << options.numThreads << " threads but it must have at least 1";
+        fassertFailed(40391);
+    }
+    return options;
+}
+
+}  // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(Options options)
+    : _options(cleanUpOptions(std::move(options))) {
+    for (size_t i = 0; i < _options.numThreads; ++i) {
+        _workers.emplace_back(stdx::make_unique<Worker>());
+    }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _shutdown_inlock();
+    if (shutdownComplete != _state) {
+        _join_inlock(&lk);
+    }
+
+    if (shutdownComplete != _state) {
+        severe() << "Failed to shutdown pool during destruction";
+        fassertFailed(40392);
+    }
+    invariant(_threads.empty());
+    invariant(_numPendingTasks.load() == 0);
+}
+
+void WorkStealingThreadPool::startup() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_state != preStart) {
+        severe() << "Attempting to start pool " << _options.poolName
+                 << ", but it has already started";
+        fassertFailed(40393);
+    }
+    _setState_inlock(running);
+    invariant(_threads.empty());
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        const std::string threadName = str::stream() << _options.threadNamePrefix << i;
+        _threads.emplace_back(
+            stdx::bind(&WorkStealingThreadPool::_workerThreadBody, this, i, threadName));
+    }
+}
+
+void WorkStealingThreadPool::shutdown() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _shutdown_inlock();
+}
+
+void WorkStealingThreadPool::_shutdown_inlock() {
+    switch (_state) {
+        case preStart:
+        case running:
+            _shutdownStarted.store(true);
+            _setState_inlock(joinRequired);
+            _workAvailable.notify_all();
+            return;
+        case joinRequired:
+        case joining:
+        case shutdownComplete:
+            return;
+    }
+    BONGO_UNREACHABLE;
+}
+
+void WorkStealingThreadPool::join() {
+    try {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _join_inlock(&lk);
+    } catch (...) {
+        severe() << "Exception escaped join in thread pool " << _options.poolName << ": "
+                 << exceptionToStatus();
+        std::terminate();
+    }
+}
+
+void WorkStealingThreadPool::_join_inlock(stdx::unique_lock<stdx::mutex>* lk) {
+    _stateChange.wait(*lk, [this] {
+        switch (_state) {
+            case preStart:
+            case running:
+                return false;
+            case joinRequired:
+                return true;
+            case joining:
+            case shutdownComplete:
+                severe() << "Attempted to join pool " << _options.poolName << " more than once";
+                fassertFailed(40394);
+        }
+        BONGO_UNREACHABLE;
+    });
+    _setState_inlock(joining);
+    std::vector<stdx::thread> threadsToJoin;
+    swap(threadsToJoin, _threads);
+    lk->unlock();
+
+    // A schedule() call that got past the shutdown check before shutdown() still lands its task,
+    // so wait for those before draining.
+    while (_numSchedulers.load() != 0) {
+        stdx::this_thread::yield();
+    }
+
+    // Lend a hand draining the deques. If the pool never started, this runs every task.
+    QueuedTask task;
+    while (_takeTask(_workers.size(), &task)) {
+        _runTask(nullptr, &task);
+    }
+    for (auto& t : threadsToJoin) {
+        t.join();
+    }
+    lk->lock();
+    invariant(_state == joining);
+    _setState_inlock(shutdownComplete);
+}
+
+Status WorkStealingThreadPool::schedule(Task task) {
+    _numSchedulers.fetchAndAdd(1);
+    ON_BLOCK_EXIT([this] { _numSchedulers.subtractAndFetch(1); });
+    if (_shutdownStarted.load()) {
+        return Status(ErrorCodes::ShutdownInProgress,
+                      str::stream() << "Shutdown of thread pool " << _options.poolName
+                                    << " in progress");
+    }
+
+    // Count the task before pushing it, so that a worker which sees no pending tasks cannot go to
+    // sleep with this one on its deque.
+    _numPendingTasks.fetchAndAdd(1);
+    const size_t workerIndex = currentPool == this
+        ? currentWorkerIndex
+        : _nextWorker.fetchAndAdd(1) % _workers.size();
+    auto& worker = *_workers[workerIndex];
+    {
+        stdx::lock_guard<stdx::mutex> lk(worker.mutex);
+        worker.tasks.push_back({std::move(task), curTimeMicros64()});
+        worker.numTasks.fetchAndAdd(1);
+    }
+
+    if (_numIdleThreads.load() != 0 && _numSearchingThreads.load() == 0) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _workAvailable.notify_one();
+    }
+    return Status::OK();
+}
+
+void WorkStealingThreadPool::waitForIdle() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _numIdleWaiters.fetchAndAdd(1);
+    _poolIsIdle.wait(
+        lk, [this] { return _numPendingTasks.load() == 0 && _numRunningTasks.load() == 0; });
+    _numIdleWaiters.subtractAndFetch(1);
+}
+
+WorkStealingThreadPool::Stats WorkStealingThreadPool::getStats() const {
+    Stats result;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        result.options = _options;
+        result.numThreads = _threads.size();
+    }
+    result.numIdleThreads = _numIdleThreads.load();
+    result.numPendingTasks = static_cast<size_t>(std::max(0LL, _numPendingTasks.load()));
+    result.numTasksExecuted = 0;
+    result.numTasksStolen = 0;
+    unsigned long long totalQueuedMicros = 0;
+    unsigned long long maxQueuedMicros = 0;
+    unsigned long long totalRunMicros = 0;
+    for (auto&& worker : _workers) {
+        result.numTasksExecuted += worker->numTasksExecuted.load();
+        result.numTasksStolen += worker->numTasksStolen.load();
+        totalQueuedMicros += worker->totalQueuedMicros.load();
+        maxQueuedMicros = std::max(maxQueuedMicros, worker->maxQueuedMicros.load());
+        totalRunMicros += worker->totalRunMicros.load();
+    }
+    result.totalQueuedTime = Microseconds(static_cast<long long>(totalQueuedMicros));
+    result.maxQueuedTime = Microseconds(static_cast<long long>(maxQueuedMicros));
+    result.totalRunTime = Microseconds(static_cast<long long>(totalRunMicros));
+    return result;
+}
+
+void WorkStealingThreadPool::_workerThreadBody(WorkStealingThreadPool* pool,
+                                               size_t workerIndex,
+                                               const std::string& threadName) {
+    setThreadName(threadName);
+    pool->_options.onCreateThread(threadName);
+    const auto poolName = pool->_options.poolName;
+    LOG(1) << "starting thread in pool " << poolName;
+    currentPool = pool;
+    currentWorkerIndex = workerIndex;
+    try {
+        pool->_consumeTasks(workerIndex);
+    } catch (...) {
+        severe() << "Exception reached top of stack in thread pool " << poolName << ": "
+                 << exceptionToStatus();
+        std::terminate();
+    }
+    currentPool = nullptr;
+    LOG(1) << "shutting down thread in pool " << poolName;
+}
+
+void WorkStealingThreadPool::_consumeTasks(size_t workerIndex) {
+    Worker* const worker = _workers[workerIndex].get();
+    QueuedTask task;
+    while (true) {
+        _numSearchingThreads.fetchAndAdd(1);
+        const bool found = _takeTask(workerIndex, &task);
+        if (_numSearchingThreads.subtractAndFetch(1) == 0 && found &&
+            _numPendingTasks.load() != 0 && _numIdleThreads.load() != 0) {
+            // The last searcher found work and there is more, so hand the search on to an idle
+            // worker before running this task.
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _workAvailable.notify_one();
+        }
+        if (found) {
+            _runTask(worker, &task);
+            continue;
+        }
+
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        if (_state != running && _numPendingTasks.load() == 0) {
+            return;
+        }
+
+        // This thread stopped searching and raises _numIdleThreads before checking
+        // _numPendingTasks, while schedule() raises _numPendingTasks before checking either
+        // counter, so either this thread sees the new task or schedule() takes _mutex to wake it.
+        _numIdleThreads.fetchAndAdd(1);
+        _workAvailable.wait(
+            lk, [this] { return _numPendingTasks.load() != 0 || _state != running; });
+        _numIdleThreads.subtractAndFetch(1);
+    }
+}
+
+bool WorkStealingThreadPool::_takeTask(size_t workerIndex, QueuedTask* task) {
+    const size_t numWorkers = _workers.size();
+    for (size_t i = 0; i < numWorkers; ++i) {
+        if (_numPendingTasks.load() == 0) {
+            return false;
+        }
+        const size_t victimIndex = (workerIndex + i) % numWorkers;
+        auto& victim = *_workers[victimIndex];
+        if (victim.numTasks.load() == 0) {
+            continue;
+        }
+        stdx::lock_guard<stdx::mutex> lk(victim.mutex);
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        victim.numTasks.subtractAndFetch(1);
+        if (victimIndex == workerIndex) {
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        } else {
+            *task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            if (workerIndex < numWorkers) {
+                _workers[workerIndex]->numTasksStolen.fetchAndAdd(1);
+            }
+        }
+
+        // Count the task as running before it stops being pending, so that waitForIdle() never
+        // sees neither.
+        _numRunningTasks.fetchAndAdd(1);
+        _numPendingTasks.subtractAndFetch(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingThreadPool::_runTask(Worker* worker, QueuedTask* task) {
+    try {
+        LOG(3) << "Executing a task on behalf of pool " << _options.poolName;
+        const auto startMicros = curTimeMicros64();
+        task->task();
+        task->task = nullptr;
+        if (worker) {
+            const auto endMicros = curTimeMicros64();
+            const auto queuedMicros =
+                startMicros > task->queuedMicros ? startMicros - task->queuedMicros : 0;
+            worker->numTasksExecuted.fetchAndAdd(1);
+            worker->totalQueuedMicros.fetchAndAdd(queuedMicros);
+            if (queuedMicros > worker->maxQueuedMicros.load()) {
+                worker->maxQueuedMicros.store(queuedMicros);
+            }
+            worker->totalRunMicros.fetchAndAdd(endMicros > startMicros ? endMicros - startMicros
+                                                                       : 0);
+        }
+    } catch (...) {
+        severe() << "Exception escaped task in thread pool " << _options.poolName << ": "
+                 << exceptionToStatus();
+        std::terminate();
+    }
+
+    if (_numRunningTasks.subtractAndFetch(1) == 0 && _numPendingTasks.load() == 0 &&
+        _numIdleWaiters.load() != 0) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _poolIsIdle.notify_all();
+    }
+}
+
+void WorkStealingThreadPool::_setState_inlock(const LifecycleState newState) {
+    if (newState == _state) {
+        return;
+    }
+    _state = newState;
+    _stateChange.notify_all();
+}
+
+}  // namespace bongo
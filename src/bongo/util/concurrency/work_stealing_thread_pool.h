@@ -0,0 +1,252 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bongo/base/disallow_copying.h"
+#include "bongo/platform/atomic_word.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/functional.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/stdx/thread.h"
+#include "bongo/util/concurrency/thread_pool_interface.h"
+#include "bongo/util/time_support.h"
+
+namespace bongo {
+
+class Status;
+
+/**
+ * A fixed-size thread pool in which every worker thread owns a deque of tasks.
+ *
+ * Tasks scheduled by a worker thread of the pool go on that worker's own deque, and tasks
+ * scheduled from any other thread are spread round-robin over the workers' deques. A worker runs
+ * the tasks on its own deque in the order they were queued, and once its deque is empty it steals
+ * the most recently queued task from another worker. Workers therefore only contend with each
+ * other when one of them runs dry, rather than on every schedule() and every task, as they do on
+ * the single queue of ThreadPool.
+ *
+ * Tasks are not guaranteed to start in the order they were scheduled unless the pool has only
+ * one thread.
+ */
+class WorkStealingThreadPool final : public ThreadPoolInterface {
+    BONGO_DISALLOW_COPYING(WorkStealingThreadPool);
+
+public:
+    /**
+     * Structure used to configure an instance of WorkStealingThreadPool.
+     */
+    struct Options {
+        // Name of the thread pool. If this string is empty, the pool will be assigned a
+        // name unique to the current process.
+        std::string poolName;
+
+        // Prefix used to name threads for logging purposes.
+        //
+        // An integer will be appended to this string to create the thread name for each thread in
+        // the pool. If you leave this empty, the prefix will be the pool name followed by a
+        // hyphen.
+        std::string threadNamePrefix;
+
+        // Number of worker threads in the pool. All of them are started by startup(), and they
+        // run until the pool is shut down.
+        size_t numThreads = 8;
+
+        // This function is run before each worker thread begins consuming tasks.
+        using OnCreateThreadFn = stdx::function<void(const std::string& threadName)>;
+        OnCreateThreadFn onCreateThread = [](const std::string&) {};
+    };
+
+    /**
+     * Structure used to return information about the thread pool via getStats().
+     */
+    struct Stats {
+        // The options for the instance of the pool returning these stats.
+        Options options;
+
+        // The number of threads currently in the pool, idle or active.
+        size_t numThreads;
+
+        // The number of threads waiting for work.
+        size_t numIdleThreads;
+
+        // The number of tasks waiting to be executed by the pool.
+        size_t numPendingTasks;
+
+        // The number of tasks the worker threads have executed.
+        unsigned long long numTasksExecuted;
+
+        // How many of those tasks a worker took from another worker's deque.
+        unsigned long long numTasksStolen;
+
+        // Total and maximum time those tasks spent queued before they started.
+        Microseconds totalQueuedTime;
+        Microseconds maxQueuedTime;
+
+        // Total time spent running those tasks.
+        Microseconds totalRunTime;
+    };
+
+    /**
+     * Constructs a thread pool, configured with the given "options".
+     */
+    explicit WorkStealingThreadPool(Options options);
+
+    ~WorkStealingThreadPool() override;
+
+    void startup() override;
+    void shutdown() override;
+    void join() override;
+    Status schedule(Task task) override;
+
+    /**
+     * Blocks the caller until there are no pending or running tasks on this pool.
+     *
+     * Has the same caveats as ThreadPool::waitForIdle(). May not be called by a task in the thread
+     * pool.
+     */
+    void waitForIdle();
+
+    /**
+     * Returns statistics about the thread pool's utilization.
+     */
+    Stats getStats() const;
+
+private:
+    struct QueuedTask {
+        Task task;
+        unsigned long long queuedMicros;
+    };
+
+    /**
+     * The deque and counters of one worker thread.
+     */
+    struct Worker {
+        // Guards "tasks". The owning thread takes from the front and thieves from the back.
+        stdx::mutex mutex;
+        std::deque<QueuedTask> tasks;
+
+        // tasks.size(), so that thieves can pass over empty deques without locking them.
+        AtomicUInt32 numTasks;
+
+        // Only ever written by the owning thread.
+        AtomicUInt64 numTasksExecuted;
+        AtomicUInt64 numTasksStolen;
+        AtomicUInt64 totalQueuedMicros;
+        AtomicUInt64 maxQueuedMicros;
+        AtomicUInt64 totalRunMicros;
+    };
+
+    /**
+     * Lifecycle states, with the same meaning and legal transitions as in ThreadPool.
+     */
+    enum LifecycleState { preStart, running, joinRequired, joining, shutdownComplete };
+
+    /**
+     * Thread body of the worker with index "workerIndex".
+     */
+    static void _workerThreadBody(WorkStealingThreadPool* pool,
+                                  size_t workerIndex,
+                                  const std::string& threadName);
+
+    /**
+     * Run loop of the worker with index "workerIndex", invoked by _workerThreadBody. Returns once
+     * the pool is shutting down and no tasks are left.
+     */
+    void _consumeTasks(size_t workerIndex);
+
+    /**
+     * Takes the next task for the worker with index "workerIndex" into "task": the oldest on its
+     * own deque, or failing that one stolen from another worker. An index of _workers.size() only
+     * steals. Returns false if every deque was empty.
+     */
+    bool _takeTask(size_t workerIndex, QueuedTask* task);
+
+    /**
+     * Runs "task", accounting for it in the counters of "worker" if that is not null.
+     */
+    void _runTask(Worker* worker, QueuedTask* task);
+
+    void _shutdown_inlock();
+    void _join_inlock(stdx::unique_lock<stdx::mutex>* lk);
+    void _setState_inlock(LifecycleState newState);
+
+    // These are the options with which the pool was configured at construction time.
+    const Options _options;
+
+    // One per worker thread, created at construction so that tasks can be scheduled before
+    // startup(). Never resized afterwards.
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Guards _state and _threads, and is the mutex for the condition variables below.
+    mutable stdx::mutex _mutex;
+
+    LifecycleState _state = preStart;
+
+    // Set by shutdown(), after which schedule() refuses new tasks.
+    AtomicBool _shutdownStarted{false};
+
+    // Number of schedule() calls in progress; join() waits for these to land their tasks.
+    AtomicUInt32 _numSchedulers{0};
+
+    // Number of tasks queued on the deques. It is raised before a task is pushed, so it may
+    // briefly count a task that is not on any deque yet.
+    AtomicInt64 _numPendingTasks{0};
+
+    // Number of tasks being run.
+    AtomicInt64 _numRunningTasks{0};
+
+    // Number of workers looking through the deques for a task. schedule() leaves waking an idle
+    // worker to them while there are any, so that a burst of tasks does not wake every worker.
+    AtomicUInt32 _numSearchingThreads{0};
+
+    // Number of workers waiting on _workAvailable, and of callers waiting on _poolIsIdle.
+    AtomicUInt32 _numIdleThreads{0};
+    AtomicUInt32 _numIdleWaiters{0};
+
+    // Round-robin cursor for tasks scheduled from outside the pool.
+    AtomicUInt32 _nextWorker{0};
+
+    // Signaled when tasks are queued while workers are idle, or when the pool shuts down.
+    stdx::condition_variable _workAvailable;
+
+    // Signaled when the last running task finishes with nothing pending.
+    stdx::condition_variable _poolIsIdle;
+
+    // Signaled whenever _state changes.
+    stdx::condition_variable _stateChange;
+
+    std::vector<stdx::thread> _threads;
+};
+
+}  // namespace bongo
@@ -0,0 +1,162 @@
+/**
+ *    Copyright (C) 2017 BongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define BONGO_LOG_DEFAULT_COMPONENT ::bongo::logger::LogComponent::kDefault
+
+#include "bongo/platform/basic.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "bongo/base/init.h"
+#include "bongo/stdx/condition_variable.h"
+#include "bongo/stdx/memory.h"
+#include "bongo/stdx/mutex.h"
+#include "bongo/unittest/barrier.h"
+#include "bongo/unittest/death_test.h"
+#include "bongo/unittest/unittest.h"
+#include "bongo/util/concurrency/thread_pool_test_common.h"
+#include "bongo/util/concurrency/work_stealing_thread_pool.h"
+
+namespace {
+using namespace bongo;
+
+BONGO_INITIALIZER(WorkStealingThreadPoolCommonTests)(InitializerContext*) {
+    addTestsForThreadPool("WorkStealingThreadPoolCommon", []() {
+        return stdx::make_unique<WorkStealingThreadPool>(WorkStealingThreadPool::Options());
+    });
+    return Status::OK();
+}
+
+WorkStealingThreadPool::Options makeOptions(size_t numThreads) {
+    WorkStealingThreadPool::Options options;
+    options.numThreads = numThreads;
+    return options;
+}
+
+TEST(WorkStealingThreadPoolTest, StartsAllThreadsAtStartup) {
+    WorkStealingThreadPool pool(makeOptions(4));
+    ASSERT_EQ(0U, pool.getStats().numThreads);
+    pool.startup();
+    ASSERT_EQ(4U, pool.getStats().numThreads);
+    pool.shutdown();
+    pool.join();
+    ASSERT_EQ(0U, pool.getStats().numThreads);
+}
+
+TEST(WorkStealingThreadPoolTest, SingleThreadRunsTasksInScheduleOrder) {
+    WorkStealingThreadPool pool(makeOptions(1));
+    std::vector<int> order;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_OK(pool.schedule([&order, i] { order.push_back(i); }));
+    }
+    pool.startup();
+    pool.waitForIdle();
+    ASSERT_EQ(100U, order.size());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(i, order[i]);
+    }
+}
+
+TEST(WorkStealingThreadPoolTest, WaitForIdleWaitsForTasksScheduledByTasks) {
+    WorkStealingThreadPool pool(makeOptions(4));
+    pool.startup();
+    AtomicUInt32 count;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_OK(pool.schedule([&] {
+            count.fetchAndAdd(1);
+            ASSERT_OK(pool.schedule([&] { count.fetchAndAdd(1); }));
+        }));
+    }
+    pool.waitForIdle();
+    ASSERT_EQ(200U, count.load());
+
+    auto stats = pool.getStats();
+    ASSERT_EQ(200U, stats.numTasksExecuted);
+    ASSERT_EQ(0U, stats.numPendingTasks);
+    ASSERT_LTE(stats.maxQueuedTime, stats.totalQueuedTime);
+}
+
+TEST(WorkStealingThreadPoolTest, IdleWorkerStealsFromBlockedWorker) {
+    WorkStealingThreadPool pool(makeOptions(2));
+    pool.startup();
+
+    // The first task queues more tasks on its own worker's deque and then blocks until they have
+    // all run, so the only way for them to run is for the other worker to steal them.
+    const size_t numChildren = 10;
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    size_t numChildrenRun = 0;
+    ASSERT_OK(pool.schedule([&] {
+        for (size_t i = 0; i < numChildren; ++i) {
+            ASSERT_OK(pool.schedule([&] {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                ++numChildrenRun;
+                cv.notify_all();
+            }));
+        }
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        cv.wait(lk, [&] { return numChildrenRun == numChildren; });
+    }));
+    pool.waitForIdle();
+
+    auto stats = pool.getStats();
+    ASSERT_EQ(numChildren + 1, stats.numTasksExecuted);
+    ASSERT_GTE(stats.numTasksStolen, numChildren);
+}
+
+TEST(WorkStealingThreadPoolTest, RunsOnCreateThreadFunctionBeforeConsumingTasks) {
+    stdx::mutex mutex;
+    std::vector<std::string> threadNames;
+    auto options = makeOptions(2);
+    options.threadNamePrefix = "mythread";
+    options.onCreateThread = [&](const std::string& threadName) {
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        threadNames.push_back(threadName);
+    };
+    WorkStealingThreadPool pool(options);
+    pool.startup();
+
+    // Each worker has to run one of these before either can finish.
+    unittest::Barrier barrier(2U);
+    ASSERT_OK(pool.schedule([&barrier] { barrier.countDownAndWait(); }));
+    ASSERT_OK(pool.schedule([&barrier] { barrier.countDownAndWait(); }));
+    pool.waitForIdle();
+
+    stdx::lock_guard<stdx::mutex> lk(mutex);
+    std::sort(threadNames.begin(), threadNames.end());
+    ASSERT_EQ(2U, threadNames.size());
+    ASSERT_EQ("mythread0", threadNames[0]);
+    ASSERT_EQ("mythread1", threadNames[1]);
+}
+
+DEATH_TEST(WorkStealingThreadPoolTest, ZeroThreadsDies, "it must have at least 1") {
+    WorkStealingThreadPool pool(makeOptions(0));
+}
+
+}  // namespace
@@ -32,6 +32,8 @@
 
 #include "bongo/util/elapsed_tracker.h"
 
+#include <algorithm>
+
 #include "bongo/util/clock_source.h"
 
 namespace bongo {
@@ -62,6 +64,10 @@ bool ElapsedTracker::intervalHasElapsed() {
     return false;
 }
 
+int32_t ElapsedTracker::hitsBeforeMark() const {
+    return std::max(_hitsBetweenMarks - _pings, 1);
+}
+
 void ElapsedTracker::resetLastTime() {
     _pings = 0;
     _last = _clock->now();
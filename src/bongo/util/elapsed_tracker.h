@@ -49,6 +49,20 @@ public:
      */
     bool intervalHasElapsed();
 
+    /**
+     * Counts 'hits' iterations without checking the triggers, as if intervalHasElapsed() had been
+     * called for each of them and returned false.
+     */
+    void addHits(int32_t hits) {
+        _pings += hits;
+    }
+
+    /**
+     * Returns how many iterations, counting the one intervalHasElapsed() was last called for, can
+     * go by before the iteration count trigger goes off. This is always at least one.
+     */
+    int32_t hitsBeforeMark() const;
+
     void resetLastTime();
 
 private:
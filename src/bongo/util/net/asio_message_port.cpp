@@ -467,6 +467,13 @@ void ASIOMessagingPort::say(Message& toSend, int responseTo) {
 
 void ASIOMessagingPort::say(const Message& toSend) {
     invariant(!toSend.empty());
+    if (toSend.isMultiPart()) {
+        toSend.forEachBuffer([this](const char* data, std::size_t len) {
+            send(data, static_cast<int>(len), nullptr);
+        });
+        return;
+    }
+
     auto buf = toSend.buf();
     if (buf) {
         send(buf, MsgData::ConstView(buf).getLen(), nullptr);
@@ -47,6 +47,12 @@ const int DEFAULT_MAX_CONN = 1000000;
 
 class ServiceContext;
 
+/**
+ * Expands a comma separated list of IPs into the addresses to listen on. An empty list means all
+ * interfaces, plus the unix domain socket for 'port' if 'useUnixSockets' is true.
+ */
+std::vector<SockAddr> ipToAddrs(const char* ips, int port, bool useUnixSockets);
+
 class Listener {
     BONGO_DISALLOW_COPYING(Listener);
 
@@ -30,7 +30,10 @@
 
 #include "bongo/util/net/message.h"
 
+#include <cstring>
+
 #include "bongo/platform/atomic_word.h"
+#include "bongo/util/assert_util.h"
 
 namespace bongo {
 
@@ -42,4 +45,21 @@ int32_t nextMessageId() {
     return NextMsgId.fetchAndAdd(1);
 }
 
+void Message::flatten() {
+    if (_segments.empty()) {
+        return;
+    }
+
+    auto flat = SharedBuffer::allocate(size());
+    char* cursor = flat.get();
+    forEachBuffer([&cursor](const char* data, std::size_t len) {
+        memcpy(cursor, data, len);
+        cursor += len;
+    });
+    invariant(cursor == flat.get() + size());
+
+    _buf = std::move(flat);
+    _segments.clear();
+}
+
 }  // namespace bongo
@@ -29,12 +29,14 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include "bongo/base/data_type_endian.h"
 #include "bongo/base/data_view.h"
 #include "bongo/base/encoded_value_storage.h"
 #include "bongo/base/static_assert.h"
 #include "bongo/util/bongoutils/str.h"
+#include "bongo/util/shared_buffer.h"
 
 namespace bongo {
 
@@ -378,8 +380,24 @@ inline int ConstView::dataLen() const {
 
 }  // namespace MsgData
 
+/**
+ * A wire protocol message.
+ *
+ * A Message normally lives in a single buffer that starts with the header. Reply builders may
+ * additionally splice out-of-line segments into it: read-only ranges of memory, such as the
+ * storage of large BSONObjs, that belong on the wire at a given offset of the first buffer but are
+ * not copied into it. The header's length always covers the whole message, including segments.
+ * Such multi-part messages are written with a single gather (writev/sendmsg) call, and must be
+ * flatten()ed before anything that needs the message contiguous in memory looks at them.
+ */
 class Message {
 public:
+    /**
+     * Out-of-line data is only worth the extra iovec and the retained reference for objects at
+     * least this large; anything smaller is cheaper to copy.
+     */
+    static const int kMinOutOfLineSegmentBytes = 16 * 1024;
+
     Message() = default;
     explicit Message(SharedBuffer data) : _buf(std::move(data)) {}
 
@@ -393,7 +411,7 @@ public:
     }
 
     MsgData::View singleData() const {
-        massert(13273, "single data buffer expected", _buf);
+        massert(13273, "single data buffer expected", _buf && _segments.empty());
         return header();
     }
 
@@ -414,6 +432,7 @@ public:
 
     void reset() {
         _buf = {};
+        _segments.clear();
     }
 
     // use to set first buffer if empty
@@ -435,6 +454,10 @@ public:
         d.setOperation(operation);
     }
 
+    /**
+     * Returns the first buffer of the message. For multi-part messages, this only holds the
+     * bytes up to the first segment and between segments; see forEachBuffer().
+     */
     char* buf() {
         return _buf.get();
     }
@@ -443,6 +466,70 @@ public:
         return _buf.get();
     }
 
+    /**
+     * Splices 'len' bytes at 'data' into the message, to be sent right after the first 'offset'
+     * bytes of the first buffer (and after any segment previously added at that offset). 'owner'
+     * must keep 'data' alive; it is retained for as long as the message is. Offsets must be added
+     * in non-decreasing order. The caller is responsible for setting the header's length to the
+     * full size of the message.
+     *
+     * A segment that directly continues the previous one in the same owner's memory is merged into
+     * it, so that runs of documents sliced out of one buffer go out as a single iovec.
+     */
+    void addSegment(std::size_t offset,
+                    ConstSharedBuffer owner,
+                    const char* data,
+                    std::size_t len) {
+        if (!_segments.empty()) {
+            auto& last = _segments.back();
+            invariant(last.offset <= offset);
+            if (last.offset == offset && last.owner.get() == owner.get() &&
+                last.data + last.len == data) {
+                last.len += len;
+                return;
+            }
+        }
+        _segments.push_back({offset, std::move(owner), data, len});
+    }
+
+    bool isMultiPart() const {
+        return !_segments.empty();
+    }
+
+    /**
+     * Invokes 'fn(const char* data, std::size_t len)' for each contiguous range of the message,
+     * in wire order. Together, the ranges make up size() bytes.
+     */
+    template <typename Fn>
+    void forEachBuffer(Fn&& fn) const {
+        if (!_buf) {
+            return;
+        }
+        std::size_t firstBufferLen = size();
+        for (const auto& segment : _segments) {
+            firstBufferLen -= segment.len;
+        }
+
+        std::size_t pos = 0;
+        for (const auto& segment : _segments) {
+            if (segment.offset > pos) {
+                fn(_buf.get() + pos, segment.offset - pos);
+                pos = segment.offset;
+            }
+            if (segment.len) {
+                fn(segment.data, segment.len);
+            }
+        }
+        if (firstBufferLen > pos) {
+            fn(_buf.get() + pos, firstBufferLen - pos);
+        }
+    }
+
+    /**
+     * Copies a multi-part message into a single buffer. Does nothing for single-buffer messages.
+     */
+    void flatten();
+
     std::string toString() const;
 
     SharedBuffer sharedBuffer() {
@@ -454,7 +541,15 @@ public:
     }
 
 private:
+    struct Segment {
+        std::size_t offset;
+        ConstSharedBuffer owner;
+        const char* data;
+        std::size_t len;
+    };
+
     SharedBuffer _buf;
+    std::vector<Segment> _segments;
 };
 
 /**
@@ -200,6 +200,16 @@ void MessagingPort::say(Message& toSend, int responseTo) {
 
 void MessagingPort::say(const Message& toSend) {
     invariant(!toSend.empty());
+    if (toSend.isMultiPart()) {
+        // Gather the parts with a single sendmsg() rather than copying them together.
+        std::vector<std::pair<char*, int>> buffers;
+        toSend.forEachBuffer([&buffers](const char* data, std::size_t len) {
+            buffers.emplace_back(const_cast<char*>(data), static_cast<int>(len));
+        });
+        send(buffers, "say");
+        return;
+    }
+
     auto buf = toSend.buf();
     if (buf) {
         send(buf, MsgData::ConstView(buf).getLen(), "say");
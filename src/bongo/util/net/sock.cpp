@@ -39,6 +39,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -543,7 +544,7 @@ void Socket::send(const vector<pair<char*, int>>& data, const char* context) {
     _send(data, context);
 #else
     vector<struct iovec> d(data.size());
-    int i = 0;
+    size_t i = 0;
     for (vector<pair<char*, int>>::const_iterator j = data.begin(); j != data.end(); ++j) {
         if (j->second > 0) {
             d[i].iov_base = j->first;
@@ -555,9 +556,14 @@ void Socket::send(const vector<pair<char*, int>>& data, const char* context) {
     struct msghdr meta;
     memset(&meta, 0, sizeof(meta));
     meta.msg_iov = &d[0];
-    meta.msg_iovlen = d.size();
 
-    while (meta.msg_iovlen > 0) {
+    // Only the first 'i' entries are in use, since empty buffers were skipped.
+    size_t iovRemaining = i;
+
+    while (iovRemaining > 0) {
+        // sendmsg() rejects more than IOV_MAX entries, so send long lists in several calls.
+        meta.msg_iovlen = std::min<size_t>(iovRemaining, IOV_MAX);
+
         int ret = -1;
         if (BONGO_FAIL_POINT(throwSockExcep)) {
 #if defined(_WIN32)
@@ -589,7 +595,7 @@ void Socket::send(const vector<pair<char*, int>>& data, const char* context) {
                 } else {
                     ret -= i->iov_len;
                     ++i;
-                    --(meta.msg_iovlen);
+                    --iovRemaining;
                 }
             }
         }
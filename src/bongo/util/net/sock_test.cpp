@@ -343,5 +343,31 @@ TEST_F(SocketFailPointTest, TestFailedRecvsDontRecv) {
     ASSERT_TRUE(tryRecv());
 }
 
+TEST(SocketTest, SendVectorWithManyBuffers) {
+    const SocketPair sockets = socketPair(SOCK_STREAM);
+    ASSERT_TRUE(sockets.first);
+    ASSERT_TRUE(sockets.second);
+
+    // More buffers than a single sendmsg() call accepts, with some empty ones mixed in.
+    std::vector<std::string> pieces;
+    for (int i = 0; i < 3000; ++i) {
+        pieces.push_back(i % 7 == 0 ? std::string() : std::to_string(i));
+    }
+
+    std::vector<std::pair<char*, int>> data;
+    std::string expected;
+    for (auto&& piece : pieces) {
+        data.emplace_back(const_cast<char*>(piece.data()), static_cast<int>(piece.size()));
+        expected += piece;
+    }
+
+    std::string received(expected.size(), '\0');
+    stdx::thread reader(
+        [&] { sockets.second->recv(&received[0], static_cast<int>(received.size())); });
+    sockets.first->send(data, "SocketTest::SendVectorWithManyBuffers");
+    reader.join();
+
+    ASSERT_EQ(expected, received);
+}
 
 }  // namespace